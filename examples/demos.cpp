@@ -108,15 +108,13 @@ int demo1(int argc, char *argv[])
                     double measure = 0;
                     if (type == GAIA_LINESTRING || type == GAIA_MULTILINESTRING)
                     {
-                        int status = gaiaGeomCollLength(collection->get(),
-                                                        &measure);
+                        measure = Measure::getLength(collection->get());
                         std::cout << "length=" << measure << " ";
                     }
 
                     if (type == GAIA_POLYGON || type == GAIA_MULTIPOLYGON)
                     {
-                        int status = gaiaGeomCollArea(collection->get(),
-                                                      &measure);
+                        measure = Measure::getArea(collection->get());
                         std::cout << "area=" << measure << " ";
                     }
                     continue;
@@ -9,6 +9,7 @@
 #pragma warning(disable:4996)
 #include "SpatiaLiteCpp/SpatiaLiteCpp.h"
 
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -609,6 +610,44 @@ int exShapeFile(std::string filename, int srid)
 
 }
 
+/**
+ * Read Shapefile records within a window using the sidecar index
+ * @param[in] filename Shapefile path
+ * @param[in] srid SRID code
+ * @returns 0 if success otherwise failure
+ */
+int exShapeFileWindow(std::string filename, int srid)
+{
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Read Shapefile window" << std::endl;
+    std::cout << "----------------------------------------" << std::endl;
+
+    ShapefilePtr shapefile(new Shapefile(gaiaAllocShapefile()));
+    gaiaOpenShpRead(shapefile->get(), filename.c_str(), "UTF-8", "UTF-8");
+    if (shapefile->get()->Valid == 0)
+    {
+        std::cout << "Failed to read Shapefile" << std::endl;
+        return 1;
+    }
+
+    // Load (or build) the quadtree sidecar and read candidates only
+    ShapefileIndexPtr index(ShapefileIndex::open(filename));
+    std::vector<int> records = index->query(-125.0, 30.0, -115.0, 40.0);
+    for (int i = 0; i < (int)records.size(); i++)
+    {
+        if (!shapefile->readEntity(records.at(i), srid)) continue;
+        gaiaGeomCollPtr geometry = shapefile->get()->Dbf->Geometry;
+        std::cout << "Record #" << records.at(i) << ": " <<
+            SpatialDatabase::getGeometryName(gaiaGeometryType(geometry)) <<
+            std::endl;
+    }
+    std::cout << "Number of Shapes in window: " << records.size() << std::endl;
+
+    return 0;
+
+}
+
 /**
  * Print summary of database table
  * @param[in] db    Source database
@@ -652,6 +691,7 @@ int exSummary(SpatialDatabase const & db,
 
 }
 
+#if SPATIALITECPP_USE_GEOS
 /**
  * Find number of geometries that touch each geometry in table
  * @param[in] db       Source database
@@ -680,6 +720,7 @@ int exVirtualShapeTouch(SpatialDatabase const & db,
         SQLite::Column namei = getColumn(db, table, name, i);
         SQLite::Column blobi = getColumn(db, table, geometry, i);
         GeometryCollectionPtr collectioni(new GeometryCollection(blobi));
+        PreparedGeometry preparedi(collectioni->get());
 
         int numTouches = 0;
         for (int j = i+1; j < numGeometries; j++)
@@ -687,10 +728,11 @@ int exVirtualShapeTouch(SpatialDatabase const & db,
 
             SQLite::Column namej = getColumn(db, table, name, j);
             SQLite::Column blobj = getColumn(db, table, geometry, j);
-            GeometryCollectionPtr collectionj(new GeometryCollection(blobj));
+            UniqueGeometryCollection collectionj(gaiaFromSpatiaLiteBlobWkb(
+                static_cast<const unsigned char *>(blobj.getBlob()),
+                blobj.getBytes()));
 
-            bool touches = gaiaGeomCollTouches(collectioni->get(),
-                                               collectionj->get()) != 0;
+            bool touches = preparedi.touches(collectionj.get());
             if (touches) numTouches++;
 
         }
@@ -702,6 +744,7 @@ int exVirtualShapeTouch(SpatialDatabase const & db,
     return 0;
 
 }
+#endif
 
 /**
  * Print summary of Vector Layer List
@@ -969,17 +1012,15 @@ int exWfsSchema(std::string const & filename, std::string const & layer)
 }
 
 /**
- * Write database geometries to various spatial file formats (GeoJSON, GML, KML,
+ * Stream database features to various spatial file formats (GeoJSON, GML, KML,
  * WKT). Output files will be written to "table.ex.kml", "table.ex.json", etc.
  * @param[in] db       Source database
  * @param[in] table    Database table to query
- * @param[in] name     Item name column header name
  * @param[in] geometry Table geometry column header name
  * @returns 0 if success otherwise failure
  */
 int exWriteFormats(SpatialDatabase const & db,
                    std::string const & table,
-                   std::string const & name,
                    std::string const & geometry)
 {
 
@@ -988,59 +1029,31 @@ int exWriteFormats(SpatialDatabase const & db,
     std::cout << "----------------------------------------" << std::endl;
 
     // ==================================================
-    // Merge all geometries
+    // Stream all rows with their properties to each format
     // --------------------------------------------------
-    gaiaGeomCollPtr gc = gaiaAllocGeomColl();
-    GeometryCollectionPtr collection(new GeometryCollection(gc));
-    exMergeGeometries(db, table, name, geometry, collection);
-    if (!collection)
-    {
-        throw std::runtime_error("Invalid collection geometry!");
-    }
-
-    // ==================================================
-    // Write geometry to various formats
-    // --------------------------------------------------
-    std::cout << "Writing merged collection " << std::endl;
-
-    // Write geometry to GeoJSON
-    OutputBufferPtr geojson(new OutputBuffer(new gaiaOutBuffer()));
-    gaiaOutGeoJSON(geojson->get(), collection->get(), 6, 5);
-    if (geojson->isValid())
-    {
-        std::string filename = table + ".ex.json";
-        std::ofstream file(filename.c_str());
-        file << geojson->get()->Buffer << std::endl;
-    }
-
-    // Write geometry to GML
-    OutputBufferPtr gml(new OutputBuffer(new gaiaOutBuffer()));
-    gaiaOutGml(gml->get(), 2, 6, collection->get());
-    if (gml->isValid())
+    const char * extensions[] = {".ex.json", ".ex.gml", ".ex.kml", ".ex.wkt"};
+    const int formats[] = {FeatureWriter::GEOJSON,
+                           FeatureWriter::GML,
+                           FeatureWriter::KML,
+                           FeatureWriter::WKT};
+    for (int i = 0; i < 4; i++)
     {
-        std::string filename = table + ".ex.gml";
-        std::ofstream file(filename.c_str());
-        file << gml->get()->Buffer << std::endl;
-    }
-
-    // Write geometry to KML
-    OutputBufferPtr kml(new OutputBuffer(new gaiaOutBuffer()));
-    gaiaOutFullKml(kml->get(), "test", "", collection->get(), 6);
-    if (kml->isValid())
-    {
-        std::string filename = table + ".ex.kml";
-        std::ofstream file(filename.c_str());
-        file << kml->get()->Buffer << std::endl;
-    }
-
-    // Write geometry to WKT
-    OutputBufferPtr wkt(new OutputBuffer(new gaiaOutBuffer()));
-    gaiaOutWkt(wkt->get(), collection->get());
-    if (wkt->isValid())
-    {
-        std::string filename = table + ".ex.wkt";
-        std::ofstream file(filename.c_str());
-        file << wkt->get()->Buffer << std::endl;
+        std::string filename = table + extensions[i];
+        FILE * file = std::fopen(filename.c_str(), "wb");
+        if (!file) throw std::runtime_error("Failed to open output file!");
+        try
+        {
+            FeatureWriterPtr writer(new FeatureWriter(fileno(file), formats[i]));
+            long long count = writer->writeTable(db, table, geometry);
+            std::cout << "Wrote " << count << " features to " << filename
+                      << " in " << writer->getWrites() << " writes" << std::endl;
+        }
+        catch (...)
+        {
+            std::fclose(file);
+            throw;
+        }
+        std::fclose(file);
     }
 
     return 0;
@@ -1153,6 +1166,9 @@ int examples()
         // Read Shapefile
         exShapeFile(fileshp, code);
 
+        // Read Shapefile window
+        exShapeFileWindow(fileshp, code);
+
         // Summary of file database
         exSummary(db, table);
 
@@ -1165,8 +1181,10 @@ int examples()
         // Copy virtual shapefile to database
         exVirtualShapeCopy(shapecopy, table, fileshp, encoding, srid, target);
 
+#if SPATIALITECPP_USE_GEOS
         // Computing touch spatial predicate
         exVirtualShapeTouch(shapecopy, target, name, geometry);
+#endif
 
         // Open WFS catalog
         exWfsCatalog(filewfs);
@@ -1178,7 +1196,7 @@ int examples()
         exWfsSchema(filesch, layersch);
 
         // Write file to various spatial formats
-        exWriteFormats(db, table, name, geometry);
+        exWriteFormats(db, table, geometry);
 
         // Create XML Blobs
         exXmlBlob();
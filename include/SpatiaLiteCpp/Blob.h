@@ -15,9 +15,15 @@ extern "C"
 #include "spatialite.h"
 }
 
+#include <vector>
+
 namespace SpatiaLite
 {
 
+    // Forward declarations
+    class CoordinateBuffer;
+    class GeometryArena;
+
     /**
      * Blob buffer data type
      */
@@ -31,6 +37,29 @@ namespace SpatiaLite
 
     public:
 
+        /**
+         * @brief Options of the TWKB encoder
+         */
+        struct SPATIALITECPP_ABI TwkbOptions
+        {
+            /**
+             * @brief Seven decimal digits for X and Y, none for Z and M,
+             *        no bounding box and no ids
+             */
+            TwkbOptions();
+
+            bool bbox;                       ///< Writes the bounding box
+            std::vector<sqlite3_int64> ids;  ///< Ids of the members of a
+                                             ///< multi geometry or
+                                             ///< collection, if not empty
+            int precision;                   ///< Decimal digits of X and Y,
+                                             ///< from -7 to 7
+            int precisionM;                  ///< Decimal digits of M, from
+                                             ///< 0 to 7
+            int precisionZ;                  ///< Decimal digits of Z, from
+                                             ///< 0 to 7
+        };
+
         /**
          * @brief Takes ownership of an existing BLOB pointer
          * @param[in] blob Source blob
@@ -44,6 +73,93 @@ namespace SpatiaLite
          */
         static void clean(BlobType buffer);
 
+        /**
+         * @brief Decodes a SpatiaLite BLOB-Geometry.
+         * @details The header is checked once and each coordinate run is
+         *          copied into its Coords array in one pass, byte-swapped
+         *          if the BLOB and host byte orders differ, instead of one
+         *          gaiaSetPoint per vertex. The geometry is the same as the
+         *          one gaiaFromSpatiaLiteBlobWkb builds, which decodes the
+         *          compressed, TinyPoint and malformed BLOBs this does not.
+         * @param[in] blob Source BLOB
+         * @param[in] size Size of BLOB
+         * @returns Geometry or null if the BLOB is invalid
+         * @warning Caller must free the geometry. Should be owned by a
+         *          GeometryCollection.
+         */
+        static gaiaGeomCollPtr fromSpatiaLiteBlobWkb(const unsigned char * blob,
+                                                     int size);
+
+        /**
+         * @brief Decodes a SpatiaLite BLOB-Geometry into an arena.
+         * @details Same as fromSpatiaLiteBlobWkb, with the geometry built
+         *          from arena blocks. BLOBs left to gaiaFromSpatiaLiteBlobWkb
+         *          are decoded on the heap and copied into the arena.
+         * @param[in] blob  Source BLOB
+         * @param[in] size  Size of BLOB
+         * @param[in] arena Arena that owns the geometry
+         * @returns Arena geometry or null if the BLOB is invalid
+         * @throws std::runtime_error if the arena fails to allocate
+         * @warning The geometry must not be freed nor owned by a
+         *          GeometryCollection, and lives as long as the arena.
+         */
+        static gaiaGeomCollPtr fromSpatiaLiteBlobWkb(const unsigned char * blob,
+                                                     int size,
+                                                     GeometryArena & arena);
+
+        /**
+         * @brief Decodes a TWKB geometry.
+         * @param[in]  twkb Source TWKB
+         * @param[in]  size Size of TWKB
+         * @param[in]  srid SRID of the geometry, which TWKB does not carry
+         * @param[out] used Bytes read. If null, the TWKB must fill the size.
+         * @param[out] ids  Member ids, if present, or null
+         * @returns Geometry or null if the TWKB is invalid
+         * @warning Caller must free the geometry. Should be owned by a
+         *          GeometryCollection.
+         */
+        static gaiaGeomCollPtr fromTwkb(const unsigned char * twkb,
+                                        int size,
+                                        int srid = 0,
+                                        int * used = 0,
+                                        std::vector<sqlite3_int64> * ids = 0);
+
+        /**
+         * @brief Decodes a TWKB geometry into an arena.
+         * @param[in]  twkb  Source TWKB
+         * @param[in]  size  Size of TWKB
+         * @param[in]  arena Arena that owns the geometry
+         * @param[in]  srid  SRID of the geometry, which TWKB does not carry
+         * @param[out] used  Bytes read. If null, the TWKB must fill the size.
+         * @returns Arena geometry or null if the TWKB is invalid
+         * @throws std::runtime_error if the arena fails to allocate
+         * @warning The geometry must not be freed nor owned by a
+         *          GeometryCollection, and lives as long as the arena.
+         */
+        static gaiaGeomCollPtr fromTwkb(const unsigned char * twkb,
+                                        int size,
+                                        GeometryArena & arena,
+                                        int srid = 0,
+                                        int * used = 0);
+
+        /**
+         * @brief Decodes the points of a TWKB geometry into a coordinate
+         *        buffer.
+         * @details Points are appended without building a geometry. Missing
+         *          Z and M values are zero and extra ones are dropped.
+         * @param[in]     twkb   Source TWKB
+         * @param[in]     size   Size of TWKB
+         * @param[in,out] buffer Buffer the points are appended to
+         * @param[out]    parts  Buffer index of the first point of each
+         *                       point, line and ring, or null
+         * @returns Bytes read or zero if the TWKB is invalid, in which case
+         *          the buffer and parts are left as they were
+         */
+        static int fromTwkb(const unsigned char * twkb,
+                            int size,
+                            CoordinateBuffer & buffer,
+                            std::vector<int> * parts = 0);
+
         /**
          * @brief Creates a Compressed BLOB-Geometry.
          * @param[in] geometry Input geometry collection
@@ -82,6 +198,33 @@ namespace SpatiaLite
          */
         static Blob * toSpatiaLiteBlobWkb(gaiaGeomCollPtr geometry);
 
+        /**
+         * @brief Encodes a Geometry object into TWKB notation.
+         * @details Coordinates are rounded to the precision and stored as
+         *          varint deltas from the previous point. A geometry that
+         *          mixes points, lines and polygons becomes a collection.
+         * @param[in] geometry Input geometry collection
+         * @param[in] options  Precision, bounding box and ids
+         * @returns New pointer to TWKB blob
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer. Should be owned by a BlobPtr.
+         */
+        static Blob * toTwkb(gaiaGeomCollPtr geometry,
+                             TwkbOptions const & options = TwkbOptions());
+
+        /**
+         * @brief Appends a Geometry object in TWKB notation to a buffer.
+         * @details Reusing the buffer avoids an allocation per geometry, and
+         *          a payload of many geometries is their concatenation.
+         * @param[in]     geometry Input geometry collection
+         * @param[in,out] output   Buffer the TWKB is appended to
+         * @param[in]     options  Precision, bounding box and ids
+         * @throws std::runtime_error on failure, leaving the buffer as it was
+         */
+        static void toTwkb(gaiaGeomCollPtr geometry,
+                           std::vector<unsigned char> & output,
+                           TwkbOptions const & options = TwkbOptions());
+
         /**
          * @brief Encodes a Geometry object into WKB notation.
          * @param[in] geometry Input geometry collection
@@ -0,0 +1,206 @@
+/**
+ * @file    BlobEncoding.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main BlobEncoding class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <string>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class Blob;
+    class GeometryArena;
+    class SpatialDatabase;
+
+    /**
+     * @brief Encoding policy of a geometry column.
+     * @details Geometries are stored either as plain SpatiaLite BLOBs, as
+     *          SpatiaLite compressed BLOBs (float deltas), or quantized:
+     *          TWKB (see Blob::toTwkb) between a 0x80 marker byte and the
+     *          SRID, and a 0xFE trailer. Quantized BLOBs are the
+     *          smallest but are lossy, and SpatiaLite SQL functions cannot
+     *          read them, so only unregistered columns are quantized.
+     *          decode() reads all three, and the library's own readers go
+     *          through it. measure() encodes a sample of a column
+     *          every way and times the decoding, and select() picks a mode
+     *          from those statistics.
+     */
+    class SPATIALITECPP_ABI BlobEncoding : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Encoding modes
+         */
+        enum Mode
+        {
+            UNCOMPRESSED,  ///< SpatiaLite BLOB
+            COMPRESSED,    ///< SpatiaLite compressed BLOB
+            QUANTIZED      ///< Quantized integer deltas
+        };
+
+        /**
+         * @brief Encoded sizes and decode costs of a sample
+         */
+        struct Statistics
+        {
+            long long geometries;      ///< Geometries sampled
+            long long bytes[3];        ///< Encoded bytes, per mode
+            double decodeTime[3];      ///< Mean decode nanoseconds, per mode
+            double maxError;           ///< Largest coordinate change when
+                                       ///< quantized
+        };
+
+        /**
+         * @brief Outcome of re-encoding a column
+         */
+        struct Report
+        {
+            long long rows;            ///< Rows re-encoded
+            long long bytesBefore;     ///< Geometry bytes before
+            long long bytesAfter;      ///< Geometry bytes after
+        };
+
+        /**
+         * @brief Creates an encoding policy
+         * @param[in] mode      Mode value
+         * @param[in] precision Decimal digits kept by QUANTIZED, from -7
+         *                      to 7. Z and M keep between 0 and 7.
+         * @throws std::runtime_error on invalid arguments
+         */
+        explicit BlobEncoding(int mode = UNCOMPRESSED, int precision = 7);
+
+        /**
+         * @brief Destructor
+         */
+        ~BlobEncoding();
+
+        /**
+         * @brief Re-encodes every geometry of a column with this policy
+         * @details Runs inside a savepoint of the caller's connection. NULL
+         *          and unreadable values are left as they are. Columns
+         *          registered in geometry_columns cannot be quantized, as
+         *          SpatiaLite triggers and spatial indexes would reject or
+         *          drop their rows.
+         * @param[in] database Spatial database, writable
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name
+         * @returns Rows and bytes before and after
+         * @throws std::runtime_error on failure, or if a registered column
+         *         would be quantized
+         */
+        Report apply(SpatialDatabase const & database,
+                     std::string const & table,
+                     std::string const & geometry) const;
+
+        /**
+         * @brief Decodes a geometry BLOB of any mode
+         * @param[in] blob BLOB
+         * @param[in] size BLOB size
+         * @returns Geometry to free with gaiaFreeGeomColl, or null if the
+         *          BLOB is invalid
+         */
+        static gaiaGeomCollPtr decode(const unsigned char * blob, int size);
+
+        /**
+         * @brief Decodes a geometry BLOB of any mode into an arena
+         * @param[in] blob  BLOB
+         * @param[in] size  BLOB size
+         * @param[in] arena Arena that owns the geometry
+         * @returns Arena geometry, or null if the BLOB is invalid
+         * @throws std::runtime_error if the arena fails to allocate
+         * @warning The geometry must not be freed and lives as long as the
+         *          arena.
+         */
+        static gaiaGeomCollPtr decode(const unsigned char * blob,
+                                      int size,
+                                      GeometryArena & arena);
+
+        /**
+         * @brief Encodes a geometry with this policy
+         * @param[in] geometry Geometry
+         * @returns New pointer to the BLOB
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer. Should be owned by a BlobPtr.
+         */
+        Blob * encode(gaiaGeomCollPtr geometry) const;
+
+        /**
+         * @returns Mode value
+         */
+        int getMode() const;
+
+        /**
+         * @returns Decimal digits kept by QUANTIZED
+         */
+        int getPrecision() const;
+
+        /**
+         * @brief Encodes a sample of a column in every mode
+         * @param[in] database   Spatial database
+         * @param[in] table      Table name
+         * @param[in] geometry   Geometry column name
+         * @param[in] precision  Decimal digits kept by QUANTIZED
+         * @param[in] sampleSize Number of geometries sampled, from the start
+         *                       of the table
+         * @returns Sizes, decode times and quantization error
+         * @throws std::runtime_error on failure
+         */
+        static Statistics measure(SpatialDatabase const & database,
+                                  std::string const & table,
+                                  std::string const & geometry,
+                                  int precision = 7,
+                                  int sampleSize = 1000);
+
+        /**
+         * @brief Chooses a mode from sample statistics
+         * @details The smaller of COMPRESSED and QUANTIZED is chosen if it
+         *          saves at least the minimum fraction of the uncompressed
+         *          size. QUANTIZED must also save that fraction over
+         *          COMPRESSED, which SQL functions can still read, and is
+         *          only considered if the sample's quantization error is
+         *          within the tolerance.
+         * @param[in] statistics    Sample statistics
+         * @param[in] minimumSaving Fraction of bytes a mode must save
+         * @param[in] tolerance     Largest coordinate change allowed. The
+         *                          default only allows lossless samples.
+         * @returns Mode value
+         */
+        static int select(Statistics const & statistics,
+                          double minimumSaving = 0.1,
+                          double tolerance = 0);
+
+    private:
+
+        // Disallow copying and assignment
+        BlobEncoding & operator=(const BlobEncoding &);
+        BlobEncoding(const BlobEncoding &);
+
+        /**
+         * @brief Mode value
+         */
+        int _mode;
+
+        /**
+         * @brief Decimal digits kept by QUANTIZED
+         */
+        int _precision;
+
+    };
+
+}
@@ -7,6 +7,7 @@
  */
 #pragma once
 
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
 #include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
 
 namespace SpatiaLite
@@ -14,9 +15,11 @@ namespace SpatiaLite
 
     /**
      * @brief RAII management of a buffer array.
+     * @details Not copyable since the buffer would be released twice. See
+     *          UniqueBuffer for a move-only alternative.
      */
     template <class T>
-    class Buffer
+    class Buffer : public PtrBase
     {
 
     public:
@@ -51,6 +54,10 @@ namespace SpatiaLite
             return this->_buffer;
         }
 
+        // Disallow copying and assignment
+        Buffer(const Buffer &) = delete;
+        Buffer & operator=(const Buffer &) = delete;
+
     private:
 
         /**
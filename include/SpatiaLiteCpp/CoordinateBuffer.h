@@ -0,0 +1,307 @@
+/**
+ * @file    CoordinateBuffer.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main CoordinateBuffer class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class LineString;
+    class Ring;
+
+    /**
+     * @brief Structure-of-arrays coordinate storage.
+     * @details Coordinates are kept in contiguous x[], y[], z[] and m[]
+     *          arrays that are carved out of a single allocation, instead of
+     *          the interleaved gaia Coords arrays or the linked gaiaPoint
+     *          nodes of a gaiaDynamicLine. Points are appended builder-style
+     *          with geometric growth. Conversions from and to gaia Coords
+     *          arrays are a single pass over the source without intermediate
+     *          allocations.
+     */
+    class SPATIALITECPP_ABI CoordinateBuffer : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Creates an empty buffer
+         * @param[in] dimensions Coordinate dimensions type. One of:
+         *                       GAIA_XY, GAIA_XY_Z, GAIA_XY_M, GAIA_XY_Z_M
+         * @param[in] capacity   Number of points to reserve
+         * @throws std::runtime_error on invalid dimensions
+         */
+        explicit CoordinateBuffer(int dimensions = GAIA_XY,
+                                  int capacity = 0);
+
+        /**
+         * @brief Releases the coordinate arrays
+         */
+        ~CoordinateBuffer();
+
+        /**
+         * @brief Appends a point
+         * @param[in] x Point x-coordinate
+         * @param[in] y Point y-coordinate
+         * @param[in] z Point z-coordinate (ignored without Z dimension)
+         * @param[in] m Point measurement (ignored without M dimension)
+         */
+        void append(double x, double y, double z = 0, double m = 0);
+
+        /**
+         * @brief Removes all points but keeps the allocated capacity
+         */
+        void clear();
+
+        /**
+         * @brief Copies interleaved gaia coordinates into a new buffer.
+         * @param[in] coords     Source Coords array
+         * @param[in] points     Number of points in the array
+         * @param[in] dimensions Dimension model of the array
+         * @returns New CoordinateBuffer pointer
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer.
+         *          Should be owned by a CoordinateBufferPtr.
+         */
+        static CoordinateBuffer * fromCoords(const double * coords,
+                                             int points,
+                                             int dimensions);
+
+        /**
+         * @brief Copies the vertices of a dynamic line into a new buffer.
+         * @param[in] line Source dynamic line
+         * @param[in] dimensions Dimension model of the new buffer
+         * @returns New CoordinateBuffer pointer
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer.
+         *          Should be owned by a CoordinateBufferPtr.
+         */
+        static CoordinateBuffer * fromDynamicLine(gaiaDynamicLinePtr line,
+                                                  int dimensions = GAIA_XY);
+
+        /**
+         * @brief Copies the vertices of a line string into a new buffer.
+         * @param[in] line Source line string
+         * @returns New CoordinateBuffer pointer
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer.
+         *          Should be owned by a CoordinateBufferPtr.
+         */
+        static CoordinateBuffer * fromLineString(gaiaLinestringPtr line);
+
+        /**
+         * @brief Copies the vertices of a ring into a new buffer.
+         * @param[in] ring Source ring
+         * @returns New CoordinateBuffer pointer
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer.
+         *          Should be owned by a CoordinateBufferPtr.
+         */
+        static CoordinateBuffer * fromRing(gaiaRingPtr ring);
+
+        /**
+         * @brief Computes the bounding box of the points.
+         * @param[out] minx Minimum x-coordinate
+         * @param[out] miny Minimum y-coordinate
+         * @param[out] maxx Maximum x-coordinate
+         * @param[out] maxy Maximum y-coordinate
+         * @returns False if the buffer is empty otherwise true
+         */
+        bool getBounds(double & minx,
+                       double & miny,
+                       double & maxx,
+                       double & maxy) const;
+
+        /**
+         * @returns Number of points the buffer can hold without growing
+         */
+        int getCapacity() const;
+
+        /**
+         * @returns Coordinate dimensions type
+         */
+        int getDimensions() const;
+
+        /**
+         * @brief Computes the planar length of the points as a path.
+         * @returns Length in coordinate units
+         */
+        double getLength() const;
+
+        /**
+         * @brief Computes the planar (shoelace) area of the points as a
+         *        closed ring.
+         * @returns Absolute area in squared coordinate units
+         */
+        double getArea() const;
+
+        /**
+         * @returns Number of points
+         */
+        int getSize() const;
+
+        /**
+         * @returns x-coordinate array
+         */
+        const double * getX() const;
+
+        /**
+         * @returns x-coordinate array
+         */
+        double * getX();
+
+        /**
+         * @returns y-coordinate array
+         */
+        const double * getY() const;
+
+        /**
+         * @returns y-coordinate array
+         */
+        double * getY();
+
+        /**
+         * @returns z-coordinate array or NULL without Z dimension
+         */
+        const double * getZ() const;
+
+        /**
+         * @returns z-coordinate array or NULL without Z dimension
+         */
+        double * getZ();
+
+        /**
+         * @returns Measurement array or NULL without M dimension
+         */
+        const double * getM() const;
+
+        /**
+         * @returns Measurement array or NULL without M dimension
+         */
+        double * getM();
+
+        /**
+         * @brief Reserves space for a number of points
+         * @param[in] capacity Number of points
+         */
+        void reserve(int capacity);
+
+        /**
+         * @brief Writes the points into an interleaved gaia Coords array.
+         * @param[out] coords Destination array of getSize() points with the
+         *                    same dimension model as the buffer (e.g. the
+         *                    Coords of a line allocated with
+         *                    gaiaAllocLinestring)
+         */
+        void toCoords(double * coords) const;
+
+        /**
+         * @brief Creates a line string from the points.
+         * @returns New LineString pointer
+         * @warning Caller must delete pointer.
+         *          Should be owned by a LineStringPtr.
+         */
+        LineString * toLineString() const;
+
+        /**
+         * @brief Creates a ring from the points.
+         * @returns New Ring pointer
+         * @warning Caller must delete pointer. Should be owned by a RingPtr.
+         */
+        Ring * toRing() const;
+
+        /**
+         * @brief Applies an affine transformation in place:
+         *        x' = a * x + b * y + xoff, y' = d * x + e * y + yoff
+         * @param[in] a    x scale
+         * @param[in] b    x shear
+         * @param[in] d    y shear
+         * @param[in] e    y scale
+         * @param[in] xoff x offset
+         * @param[in] yoff y offset
+         */
+        void transform(double a,
+                       double b,
+                       double d,
+                       double e,
+                       double xoff,
+                       double yoff);
+
+        /**
+         * @brief Removes the points past a size but keeps the allocated
+         *        capacity
+         * @param[in] size Number of points to keep. Larger sizes are ignored.
+         */
+        void truncate(int size);
+
+        /**
+         * @brief Number of doubles per point of a dimension model
+         * @param[in] dimensions Coordinate dimensions type
+         * @returns 2, 3 or 4
+         * @throws std::runtime_error on invalid dimensions
+         */
+        static int getStride(int dimensions);
+
+    private:
+
+        // Disallow copying and assignment
+        CoordinateBuffer & operator=(const CoordinateBuffer &);
+        CoordinateBuffer(const CoordinateBuffer &);
+
+        /**
+         * @brief Block holding all coordinate arrays
+         */
+        double * _block;
+
+        /**
+         * @brief Number of points the block can hold
+         */
+        int _capacity;
+
+        /**
+         * @brief Coordinate dimensions type
+         */
+        int _dimensions;
+
+        /**
+         * @brief Number of points
+         */
+        int _size;
+
+        /**
+         * @brief x-coordinate array
+         */
+        double * _x;
+
+        /**
+         * @brief y-coordinate array
+         */
+        double * _y;
+
+        /**
+         * @brief z-coordinate array or NULL
+         */
+        double * _z;
+
+        /**
+         * @brief Measurement array or NULL
+         */
+        double * _m;
+
+    };
+
+}
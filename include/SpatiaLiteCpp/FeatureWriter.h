@@ -0,0 +1,248 @@
+/**
+ * @file    FeatureWriter.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main FeatureWriter class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/OutputBuffer.h"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class SpatialDatabase;
+
+    /**
+     * @brief Streaming writer of feature collections to a file descriptor.
+     * @details Features are serialized one at a time into a fixed-size
+     *          buffer that is written to the descriptor in large blocks
+     *          whenever it fills up, so memory use does not depend on the
+     *          number of features. Each geometry is converted with the
+     *          spatialite output functions into a reused text buffer and
+     *          the other columns of the row become feature properties.
+     *          The descriptor may be a file, pipe or socket and is not
+     *          closed by the writer. A writer is not thread-safe.
+     */
+    class SPATIALITECPP_ABI FeatureWriter : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Output formats
+         */
+        enum Format
+        {
+            GEOJSON = 0,  ///< GeoJSON FeatureCollection
+            GML = 1,      ///< GML 3 feature collection
+            KML = 2,      ///< KML document of placemarks
+            WKT = 3       ///< Tab-separated WKT and property columns
+        };
+
+        /**
+         * @brief Creates a writer
+         * @param[in] fd        Open file descriptor to write to
+         * @param[in] format    Format enumeration value
+         * @param[in] precision Number of decimal digits of coordinates
+         * @param[in] capacity  Size in bytes of the output buffer
+         * @throws std::runtime_error on invalid arguments
+         */
+        FeatureWriter(int fd,
+                      int format,
+                      int precision = 6,
+                      size_t capacity = 64 * 1024);
+
+        /**
+         * @brief Releases the buffers without flushing
+         */
+        ~FeatureWriter();
+
+        /**
+         * @brief Writes the collection header
+         * @param[in] name Collection name used by GML and KML. Resets the
+         *                 feature count.
+         * @throws std::runtime_error on failure
+         */
+        void begin(std::string const & name = "features");
+
+        /**
+         * @brief Writes the collection footer and flushes the buffer
+         * @throws std::runtime_error on failure
+         */
+        void finish();
+
+        /**
+         * @brief Writes the buffered bytes to the file descriptor
+         * @throws std::runtime_error on failure
+         */
+        void flush();
+
+        /**
+         * @returns Number of bytes written to the file descriptor
+         */
+        long long getBytes() const;
+
+        /**
+         * @returns Size in bytes of the output buffer
+         */
+        size_t getCapacity() const;
+
+        /**
+         * @returns Number of features written
+         */
+        long long getFeatureCount() const;
+
+        /**
+         * @returns Number of write calls made on the file descriptor
+         */
+        long long getWrites() const;
+
+        /**
+         * @brief Writes a feature without properties
+         * @param[in] geometry Feature geometry or null
+         * @throws std::runtime_error on failure
+         */
+        void write(gaiaGeomCollPtr geometry);
+
+        /**
+         * @brief Writes the current row of a cursor as a feature
+         * @details The geometry column is decoded from its SpatiaLite blob
+         *          and every other column becomes a property named after
+         *          the column. Null and blob values are written as null or
+         *          left out, depending on the format.
+         * @param[in] row            Statement positioned on a row
+         * @param[in] geometryColumn Index of the geometry column
+         * @throws std::runtime_error on failure
+         */
+        void write(sqlite3_stmt * row, int geometryColumn);
+
+        /**
+         * @brief Writes a whole table as a feature collection
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name
+         * @returns Number of features written
+         * @throws std::runtime_error on failure
+         */
+        long long writeTable(SpatialDatabase const & database,
+                             std::string const & table,
+                             std::string const & geometry);
+
+    private:
+
+        // Disallow copying and assignment
+        FeatureWriter & operator=(const FeatureWriter &);
+        FeatureWriter(const FeatureWriter &);
+
+        /**
+         * @brief Appends bytes to the output buffer
+         * @param[in] data Bytes to append
+         * @param[in] size Number of bytes
+         */
+        void append(const char * data, size_t size);
+
+        /**
+         * @brief Appends a null-terminated string
+         * @param[in] text String to append
+         */
+        void append(const char * text);
+
+        /**
+         * @brief Appends a string escaped for the output format
+         * @param[in] text String to append
+         */
+        void appendEscaped(const char * text);
+
+        /**
+         * @brief Appends the serialized geometry
+         */
+        void appendGeometry();
+
+        /**
+         * @brief Appends a property value
+         * @param[in] row    Statement positioned on a row
+         * @param[in] column Column index
+         */
+        void appendValue(sqlite3_stmt * row, int column);
+
+        /**
+         * @brief Serializes a geometry into the text buffer
+         * @param[in] geometry Geometry or null
+         */
+        void serialize(gaiaGeomCollPtr geometry);
+
+        /**
+         * @brief Writes bytes to the file descriptor
+         * @param[in] data Bytes to write
+         * @param[in] size Number of bytes
+         */
+        void writeAll(const char * data, size_t size);
+
+        /**
+         * @brief Output buffer
+         */
+        std::vector<char> _buffer;
+
+        /**
+         * @brief Number of bytes written to the file descriptor
+         */
+        long long _bytes;
+
+        /**
+         * @brief Number of features written
+         */
+        long long _count;
+
+        /**
+         * @brief Output file descriptor
+         */
+        int _fd;
+
+        /**
+         * @brief Output format
+         */
+        int _format;
+
+        /**
+         * @brief Collection name as an XML element name
+         */
+        std::string _name;
+
+        /**
+         * @brief Coordinate precision
+         */
+        int _precision;
+
+        /**
+         * @brief Reused geometry text buffer
+         */
+        OutputBuffer _text;
+
+        /**
+         * @brief Number of buffered bytes
+         */
+        size_t _used;
+
+        /**
+         * @brief Number of write calls
+         */
+        long long _writes;
+
+    };
+
+}
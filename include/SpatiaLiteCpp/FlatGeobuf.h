@@ -0,0 +1,351 @@
+/**
+ * @file    FlatGeobuf.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main FlatGeobuf class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class SpatialDatabase;
+
+    /**
+     * @brief FlatGeobuf file, written from a cursor and read memory-mapped.
+     * @details A FlatGeobuf file holds a header, an optional packed Hilbert
+     *          R-tree of the feature boxes and the features, each encoded
+     *          as a size-prefixed FlatBuffer in little-endian order. The
+     *          export stages the encoded features in a scratch file next
+     *          to the output, then writes them sorted along the Hilbert
+     *          curve behind the header and the index. An opened file stays
+     *          mapped: window searches walk the index in place and
+     *          features are decoded straight from the mapping, so nothing
+     *          is loaded into SQLite unless imported. Features are
+     *          addressed by their byte offset in the feature section, as
+     *          in the index. An opened file is read-only and may be read
+     *          from many threads.
+     */
+    class SPATIALITECPP_ABI FlatGeobuf : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Column types, numbered as in the format
+         */
+        enum ColumnType
+        {
+            BYTE,      ///< Signed 8-bit integer
+            UBYTE,     ///< Unsigned 8-bit integer
+            BOOL,      ///< Boolean
+            SHORT,     ///< Signed 16-bit integer
+            USHORT,    ///< Unsigned 16-bit integer
+            INT,       ///< Signed 32-bit integer
+            UINT,      ///< Unsigned 32-bit integer
+            LONG,      ///< Signed 64-bit integer
+            ULONG,     ///< Unsigned 64-bit integer
+            FLOAT,     ///< Single precision
+            DOUBLE,    ///< Double precision
+            STRING,    ///< UTF-8 text
+            JSON,      ///< JSON text
+            DATETIME,  ///< ISO 8601 text
+            BINARY     ///< Bytes
+        };
+
+        /**
+         * @brief Feature property column
+         */
+        struct Column
+        {
+            std::string name;  ///< Column name
+            int type;          ///< ColumnType value
+        };
+
+        /**
+         * @brief Unmaps the file
+         */
+        ~FlatGeobuf();
+
+        /**
+         * @brief Binds the properties of a feature to statement parameters
+         * @details Columns the feature has no value for are bound to NULL.
+         *          Text and bytes are bound without copying and stay valid
+         *          while the file is open.
+         * @param[in] feature   Feature offset
+         * @param[in] statement Prepared statement
+         * @param[in] first     Parameter of the first column
+         * @throws std::runtime_error on invalid features or bind failures
+         */
+        void bindProperties(unsigned long long feature,
+                            sqlite3_stmt * statement,
+                            int first = 1) const;
+
+        /**
+         * @brief Writes the rows of a cursor to a file
+         * @details Column types come from the declared types of the first
+         *          row, or from its values for expressions. The SRID and
+         *          dimensions come from the first geometry, and other
+         *          geometries are converted to those dimensions. Rows with
+         *          a NULL or unreadable geometry are written without one.
+         * @param[in] cursor         Statement that has not been stepped.
+         *                           It is stepped to the end and neither
+         *                           reset nor finalized.
+         * @param[in] geometryColumn Index of the geometry column
+         * @param[in] filename       Output file, replaced if it exists
+         * @param[in] name           Dataset name
+         * @param[in] nodeSize       Children per index node, or zero for no
+         *                           index
+         * @returns Number of features written
+         * @throws std::runtime_error on failure
+         */
+        static long long exportQuery(sqlite3_stmt * cursor,
+                                     int geometryColumn,
+                                     std::string const & filename,
+                                     std::string const & name = "features",
+                                     int nodeSize = 16);
+
+        /**
+         * @brief Writes a whole table to a file
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name, also the dataset name
+         * @param[in] geometry Geometry column name
+         * @param[in] filename Output file, replaced if it exists
+         * @param[in] nodeSize Children per index node, or zero for no index
+         * @returns Number of features written
+         * @throws std::runtime_error on failure
+         */
+        static long long exportTable(SpatialDatabase const & database,
+                                     std::string const & table,
+                                     std::string const & geometry,
+                                     std::string const & filename,
+                                     int nodeSize = 16);
+
+        /**
+         * @brief Gets the extent of the features
+         * @param[out] minx Minimum x-coordinate
+         * @param[out] miny Minimum y-coordinate
+         * @param[out] maxx Maximum x-coordinate
+         * @param[out] maxy Maximum y-coordinate
+         * @returns False if the header has no extent otherwise true
+         */
+        bool getBounds(double & minx,
+                       double & miny,
+                       double & maxx,
+                       double & maxy) const;
+
+        /**
+         * @returns Property columns
+         */
+        std::vector<Column> const & getColumns() const;
+
+        /**
+         * @returns Number of features
+         */
+        unsigned long long getCount() const;
+
+        /**
+         * @returns Coordinate dimensions type
+         */
+        int getDimensions() const;
+
+        /**
+         * @returns Size in bytes of the feature section, which is one past
+         *          the last feature offset
+         */
+        unsigned long long getFeaturesSize() const;
+
+        /**
+         * @brief Decodes the geometry of a feature
+         * @param[in] feature Feature offset
+         * @returns Geometry or null if the feature has none
+         * @throws std::runtime_error on invalid features
+         * @warning Caller must free the geometry. Should be owned by a
+         *          GeometryCollection.
+         */
+        gaiaGeomCollPtr getGeometry(unsigned long long feature) const;
+
+        /**
+         * @returns Geometry type of all features, or zero if mixed
+         */
+        int getGeometryType() const;
+
+        /**
+         * @returns Dataset name
+         */
+        std::string const & getName() const;
+
+        /**
+         * @returns Children per index node, or zero without an index
+         */
+        int getNodeSize() const;
+
+        /**
+         * @returns SRID, or zero if the file has no CRS code
+         */
+        int getSrid() const;
+
+        /**
+         * @brief Inserts every feature into a table
+         * @details The table is created if missing, with a column per
+         *          property and a BLOB geometry column, and filled through
+         *          one prepared statement inside a single savepoint. If the
+         *          database has spatial metadata, a geometry column not yet
+         *          registered is then registered with RecoverGeometryColumn()
+         *          and indexed by CreateSpatialIndex().
+         * @param[in] database Spatial database, writable
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name
+         * @returns Number of rows inserted
+         * @throws std::runtime_error on failure
+         */
+        long long importTable(SpatialDatabase const & database,
+                              std::string const & table,
+                              std::string const & geometry) const;
+
+        /**
+         * @param[in] feature Feature offset
+         * @returns Offset of the following feature, getFeaturesSize()
+         *          after the last one
+         * @throws std::runtime_error on invalid features
+         */
+        unsigned long long next(unsigned long long feature) const;
+
+        /**
+         * @brief Memory-maps a file
+         * @param[in] filename FlatGeobuf file
+         * @returns Opened file
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer. Should be owned by a
+         *          FlatGeobufPtr.
+         */
+        static FlatGeobuf * open(std::string const & filename);
+
+        /**
+         * @brief Finds the features whose box intersects a window
+         * @details Uses the index, or scans every feature without one.
+         * @param[in]  minx     Minimum x-coordinate
+         * @param[in]  miny     Minimum y-coordinate
+         * @param[in]  maxx     Maximum x-coordinate
+         * @param[in]  maxy     Maximum y-coordinate
+         * @param[out] features Feature offsets appended in file order
+         * @returns Number of features found
+         * @throws std::runtime_error on invalid files
+         */
+        size_t search(double minx,
+                      double miny,
+                      double maxx,
+                      double maxy,
+                      std::vector<unsigned long long> & features) const;
+
+    private:
+
+        // Disallow copying and assignment
+        FlatGeobuf & operator=(const FlatGeobuf &);
+        FlatGeobuf(const FlatGeobuf &);
+
+        /**
+         * @brief Creates a file with nothing mapped
+         */
+        FlatGeobuf();
+
+        /**
+         * @brief Property columns
+         */
+        std::vector<Column> _columns;
+
+        /**
+         * @brief Number of features
+         */
+        unsigned long long _count;
+
+        /**
+         * @brief Coordinate dimensions type
+         */
+        int _dimensions;
+
+        /**
+         * @brief Set if the header has an extent
+         */
+        bool _extent;
+
+        /**
+         * @brief First byte of the feature section
+         */
+        const unsigned char * _features;
+
+        /**
+         * @brief Size in bytes of the feature section
+         */
+        unsigned long long _featuresSize;
+
+        /**
+         * @brief Geometry type of all features, or zero
+         */
+        int _geometryType;
+
+        /**
+         * @brief First index node, or null
+         */
+        const unsigned char * _index;
+
+        /**
+         * @brief First and one past the last node of each level, leaves
+         *        first
+         */
+        std::vector<std::pair<size_t, size_t> > _levelBounds;
+
+        /**
+         * @brief Mapped file view
+         */
+        void * _mapping;
+
+        /**
+         * @brief Size of the mapped file view
+         */
+        size_t _mappingSize;
+
+        /**
+         * @brief Extent of the features
+         */
+        double _maxx, _maxy, _minx, _miny;
+
+        /**
+         * @brief Dataset name
+         */
+        std::string _name;
+
+        /**
+         * @brief Children per index node, or zero
+         */
+        int _nodeSize;
+
+        /**
+         * @brief Number of index nodes
+         */
+        size_t _numNodes;
+
+        /**
+         * @brief SRID, or zero
+         */
+        int _srid;
+
+    };
+
+}
@@ -0,0 +1,136 @@
+/**
+ * @file    GeoJsonExporter.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeoJsonExporter class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <cstddef>
+#include <string>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class SpatialDatabase;
+
+    /**
+     * @brief Parallel export of a table to a GeoJSON FeatureCollection.
+     * @details The table is split into runs of rows that worker threads
+     *          read through their own read-only connections and serialize
+     *          independently. Finished chunks are written to the file
+     *          descriptor strictly in rowid order by the calling thread,
+     *          and at most a few chunks per worker are held in memory.
+     *          Coordinates are formatted by a dedicated number formatter
+     *          instead of printf, which dominates gaiaOutGeoJSON. The
+     *          output matches FeatureWriter apart from number formatting.
+     *          Workers see only committed data; in-memory databases are
+     *          read by a single worker over the caller's connection.
+     */
+    class SPATIALITECPP_ABI GeoJsonExporter : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Creates an exporter
+         * @param[in] threads   Number of workers. Zero uses the hardware
+         *                      concurrency.
+         * @param[in] precision Decimal digits of coordinates, or -1 for the
+         *                      shortest form that round-trips
+         * @param[in] chunkSize Number of rows per chunk
+         * @throws std::runtime_error on invalid arguments
+         */
+        explicit GeoJsonExporter(int threads = 0,
+                                 int precision = 6,
+                                 int chunkSize = 4096);
+
+        /**
+         * @brief Destructor
+         */
+        ~GeoJsonExporter();
+
+        /**
+         * @brief Exports a table as a FeatureCollection
+         * @details Every column other than the geometry becomes a
+         *          property, as in FeatureWriter.
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name
+         * @param[in] fd       Open file descriptor to write to
+         * @returns Number of features written
+         * @throws std::runtime_error on failure
+         */
+        long long exportTable(SpatialDatabase const & database,
+                              std::string const & table,
+                              std::string const & geometry,
+                              int fd) const;
+
+        /**
+         * @brief Formats a number as JSON text
+         * @details With a precision the value is rounded half away from
+         *          zero to that many decimals and trailing zeros are
+         *          dropped. With -1 the shortest digits that read back
+         *          exactly are found with Grisu2; values too large for
+         *          integer arithmetic at a precision are rounded from
+         *          those digits. Exponents are used as with %.17g. The
+         *          output does not depend on the locale, and non-finite
+         *          values are written as null.
+         * @param[in]  value     Number to format
+         * @param[in]  precision Decimal digits (at most 15) or -1
+         * @param[out] text      Output of at least 32 characters, not
+         *                       null-terminated
+         * @returns Number of characters written
+         */
+        static size_t formatNumber(double value, int precision, char * text);
+
+        /**
+         * @returns Number of rows per chunk
+         */
+        int getChunkSize() const;
+
+        /**
+         * @returns Decimal digits of coordinates
+         */
+        int getPrecision() const;
+
+        /**
+         * @returns Number of workers
+         */
+        int getThreadCount() const;
+
+    private:
+
+        // Disallow copying and assignment
+        GeoJsonExporter & operator=(const GeoJsonExporter &);
+        GeoJsonExporter(const GeoJsonExporter &);
+
+        /**
+         * @brief Number of rows per chunk
+         */
+        int _chunkSize;
+
+        /**
+         * @brief Decimal digits of coordinates
+         */
+        int _precision;
+
+        /**
+         * @brief Number of workers
+         */
+        int _threads;
+
+    };
+
+}
@@ -0,0 +1,104 @@
+/**
+ * @file    GeoParquetExporter.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeoParquetExporter class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+#include <string>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class SpatialDatabase;
+
+    /**
+     * @brief Parallel export of a table to a GeoParquet file.
+     * @details The table is split into runs of rows that worker threads
+     *          read through their own read-only connections, as in
+     *          GeoJsonExporter, and encode as complete row groups. The
+     *          calling thread writes the row groups in rowid order and
+     *          finishes the file with its metadata. Attribute columns are
+     *          typed from SpatialDatabase::getTypes: integer types become
+     *          INT64, real types DOUBLE, text and date types UTF8 strings
+     *          and the rest byte arrays. The geometry column is written as
+     *          WKB with GeoParquet 1.1 metadata, followed by a bbox struct
+     *          column whose per row group statistics allow readers to skip
+     *          row groups outside a window. SRIDs other than 4326 are
+     *          written as an unknown crs with an extra srid key, since
+     *          PROJJSON cannot be produced without PROJ. Pages are PLAIN
+     *          encoded and uncompressed, so the Thrift metadata is written
+     *          directly without a Parquet library. Workers see only
+     *          committed data; in-memory databases are read by a single
+     *          worker over the caller's connection.
+     */
+    class SPATIALITECPP_ABI GeoParquetExporter : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Creates an exporter
+         * @param[in] threads      Number of workers. Zero uses the hardware
+         *                         concurrency.
+         * @param[in] rowGroupSize Number of rows per row group
+         * @throws std::runtime_error on invalid arguments
+         */
+        explicit GeoParquetExporter(int threads = 0, int rowGroupSize = 65536);
+
+        /**
+         * @brief Destructor
+         */
+        ~GeoParquetExporter();
+
+        /**
+         * @brief Exports a table
+         * @details Rows with a NULL or unreadable geometry have a null
+         *          geometry and bbox.
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name
+         * @param[in] filename Output file, replaced if it exists
+         * @returns Number of rows written
+         * @throws std::runtime_error on failure
+         */
+        long long exportTable(SpatialDatabase const & database,
+                              std::string const & table,
+                              std::string const & geometry,
+                              std::string const & filename) const;
+
+        /**
+         * @returns Number of rows per row group
+         */
+        int getRowGroupSize() const;
+
+        /**
+         * @returns Number of workers
+         */
+        int getThreadCount() const;
+
+    private:
+
+        // Disallow copying and assignment
+        GeoParquetExporter & operator=(const GeoParquetExporter &);
+        GeoParquetExporter(const GeoParquetExporter &);
+
+        /**
+         * @brief Number of rows per row group
+         */
+        int _rowGroupSize;
+
+        /**
+         * @brief Number of workers
+         */
+        int _threads;
+
+    };
+
+}
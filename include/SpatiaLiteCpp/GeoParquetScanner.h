@@ -0,0 +1,254 @@
+/**
+ * @file    GeoParquetScanner.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeoParquetScanner class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+}
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief Column-at-a-time reader of GeoParquet files.
+     * @details The file is memory-mapped and its metadata parsed once.
+     *          Each column chunk of a row group is decoded on request into
+     *          plain arrays, so aggregations run over contiguous values
+     *          without SQLite. Byte array values point into the mapping
+     *          instead of being copied. Row groups can be pruned with the
+     *          statistics of the bbox column written by GeoParquetExporter.
+     *          Flat schemas and structs of required or optional fields are
+     *          supported, with PLAIN encoded, uncompressed data pages as
+     *          written by GeoParquetExporter. An opened file is read-only
+     *          and may be read from many threads.
+     */
+    class SPATIALITECPP_ABI GeoParquetScanner : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Physical types, numbered as in the format
+         */
+        enum ColumnType
+        {
+            BOOLEAN,              ///< Bit-packed booleans
+            INT32,                ///< Signed 32-bit integer
+            INT64,                ///< Signed 64-bit integer
+            INT96,                ///< Legacy timestamp, not supported
+            FLOAT,                ///< Single precision
+            DOUBLE,               ///< Double precision
+            BYTE_ARRAY,           ///< Length-prefixed bytes
+            FIXED_LEN_BYTE_ARRAY  ///< Fixed-size bytes
+        };
+
+        /**
+         * @brief Leaf column
+         */
+        struct Column
+        {
+            std::string name;  ///< Dotted path from the root
+            int type;          ///< ColumnType value
+            int typeLength;    ///< Size of fixed-size byte arrays
+            int maxLevel;      ///< Definition level of a present value
+        };
+
+        /**
+         * @brief Values of one column chunk, one entry per row. Only the
+         *        array matching the column type is filled.
+         */
+        struct ColumnData
+        {
+            std::vector<char> valid;                   ///< Zero for NULL
+            std::vector<sqlite3_int64> integers;       ///< BOOLEAN, INT32, INT64
+            std::vector<double> doubles;               ///< FLOAT, DOUBLE
+            std::vector<const unsigned char *> bytes;  ///< Byte arrays
+            std::vector<size_t> sizes;                 ///< Byte array sizes
+        };
+
+        /**
+         * @brief Unmaps the file
+         */
+        ~GeoParquetScanner();
+
+        /**
+         * @param[in] name Dotted column path
+         * @returns Index of the column or -1 if not found
+         */
+        int findColumn(std::string const & name) const;
+
+        /**
+         * @returns Leaf columns
+         */
+        std::vector<Column> const & getColumns() const;
+
+        /**
+         * @returns GeoParquet metadata JSON, empty if the file has none
+         */
+        std::string const & getGeoMetadata() const;
+
+        /**
+         * @returns Index of the primary geometry column or -1
+         */
+        int getGeometryColumn() const;
+
+        /**
+         * @returns Number of rows
+         */
+        long long getRowCount() const;
+
+        /**
+         * @brief Gets the extent of a row group from its bbox statistics
+         * @param[in]  group Row group
+         * @param[out] minx  Minimum x-coordinate
+         * @param[out] miny  Minimum y-coordinate
+         * @param[out] maxx  Maximum x-coordinate
+         * @param[out] maxy  Maximum y-coordinate
+         * @returns False if the row group has no bbox statistics
+         * @throws std::runtime_error on invalid row groups
+         */
+        bool getRowGroupBounds(int group,
+                               double & minx,
+                               double & miny,
+                               double & maxx,
+                               double & maxy) const;
+
+        /**
+         * @returns Number of row groups
+         */
+        int getRowGroupCount() const;
+
+        /**
+         * @param[in] group Row group
+         * @returns Number of rows in a row group
+         * @throws std::runtime_error on invalid row groups
+         */
+        long long getRowGroupRows(int group) const;
+
+        /**
+         * @brief Memory-maps a file and reads its metadata
+         * @param[in] filename Parquet file
+         * @returns Opened file
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer. Should be owned by a
+         *          GeoParquetScannerPtr.
+         */
+        static GeoParquetScanner * open(std::string const & filename);
+
+        /**
+         * @brief Decodes a column chunk
+         * @param[in]  group  Row group
+         * @param[in]  column Column index
+         * @param[out] data   Values, replacing its contents and reusing its
+         *                    storage
+         * @throws std::runtime_error on invalid or unsupported chunks
+         */
+        void readColumn(int group, int column, ColumnData & data) const;
+
+        /**
+         * @brief Finds the row groups that may intersect a window
+         * @details Row groups without bbox statistics are always selected.
+         * @param[in]  minx   Minimum x-coordinate
+         * @param[in]  miny   Minimum y-coordinate
+         * @param[in]  maxx   Maximum x-coordinate
+         * @param[in]  maxy   Maximum y-coordinate
+         * @param[out] groups Row groups appended in file order
+         * @returns Number of row groups selected
+         */
+        size_t selectRowGroups(double minx,
+                               double miny,
+                               double maxx,
+                               double maxy,
+                               std::vector<int> & groups) const;
+
+    private:
+
+        // Disallow copying and assignment
+        GeoParquetScanner & operator=(const GeoParquetScanner &);
+        GeoParquetScanner(const GeoParquetScanner &);
+
+        /**
+         * @brief Column chunk metadata
+         */
+        struct Chunk
+        {
+            int codec;                  ///< Compression codec
+            long long values;           ///< Number of values
+            long long dataOffset;       ///< First data page
+            long long dictionaryOffset; ///< Dictionary page or -1
+            long long size;             ///< Bytes from the first page
+            bool hasStatistics;         ///< Set if min and max are known
+            double min;                 ///< Minimum of numeric columns
+            double max;                 ///< Maximum of numeric columns
+        };
+
+        /**
+         * @brief Row group metadata
+         */
+        struct RowGroup
+        {
+            long long rows;             ///< Number of rows
+            std::vector<Chunk> chunks;  ///< One per leaf column
+        };
+
+        /**
+         * @brief Creates a scanner with nothing mapped
+         */
+        GeoParquetScanner();
+
+        /**
+         * @brief Leaf columns of the bbox struct, or -1
+         */
+        int _bbox[4];
+
+        /**
+         * @brief Leaf columns
+         */
+        std::vector<Column> _columns;
+
+        /**
+         * @brief GeoParquet metadata JSON
+         */
+        std::string _geoMetadata;
+
+        /**
+         * @brief Index of the primary geometry column or -1
+         */
+        int _geometryColumn;
+
+        /**
+         * @brief Mapped file view
+         */
+        void * _mapping;
+
+        /**
+         * @brief Size of the mapped file view
+         */
+        size_t _mappingSize;
+
+        /**
+         * @brief Number of rows
+         */
+        long long _rowCount;
+
+        /**
+         * @brief Row groups
+         */
+        std::vector<RowGroup> _rowGroups;
+
+    };
+
+}
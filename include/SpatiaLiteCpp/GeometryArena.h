@@ -0,0 +1,214 @@
+/**
+ * @file    GeometryArena.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeometryArena class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <cstddef>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class GeometryCollection;
+
+    /**
+     * @brief Scoped bump allocator for gaia geometry trees.
+     * @details Geometry structs and their coordinate arrays are carved out of
+     *          large blocks instead of one malloc per struct and per array,
+     *          and are all released at once when the arena is destroyed or
+     *          reset. The trees have the same layout as the ones built with
+     *          gaiaAllocGeomColl and friends, so they can be passed to any
+     *          gaia function that reads geometries (MBR, blob encoding,
+     *          measures, GEOS predicates). Blob::fromSpatiaLiteBlobWkb,
+     *          Blob::fromTwkb and BlobEncoding::decode have overloads that
+     *          decode straight into an arena.
+     * @warning Arena geometries must not be released with gaiaFree* nor
+     *          owned by a Buffer wrapper, and must not be grown with gaia
+     *          functions that allocate (e.g. gaiaAddPointToGeomColl). Use
+     *          toHeap for geometries that outlive the arena.
+     */
+    class SPATIALITECPP_ABI GeometryArena : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Creates an empty arena
+         * @param[in] blockSize Size in bytes of each block. Larger requests
+         *                      get a block of their own.
+         */
+        explicit GeometryArena(size_t blockSize = 65536);
+
+        /**
+         * @brief Releases all blocks
+         */
+        ~GeometryArena();
+
+        /**
+         * @brief Allocates a geometry collection in the arena
+         * @param[in] dimensions Coordinate dimensions type. One of:
+         *                       GAIA_XY, GAIA_XY_Z, GAIA_XY_M, GAIA_XY_Z_M
+         * @param[in] srid       Coordinate reference system code
+         * @returns Empty geometry collection
+         * @throws std::runtime_error on invalid dimensions
+         */
+        gaiaGeomCollPtr allocGeomColl(int dimensions = GAIA_XY, int srid = 0);
+
+        /**
+         * @brief Allocates raw memory in the arena
+         * @param[in] bytes Number of bytes
+         * @returns Pointer aligned for any gaia struct or double array
+         */
+        void * allocate(size_t bytes);
+
+        /**
+         * @brief Appends a line string to a geometry
+         * @param[in] geometry Arena geometry collection
+         * @param[in] vertices Number of points
+         * @returns New line string with uninitialized coordinates
+         * @throws std::runtime_error on failure
+         */
+        gaiaLinestringPtr addLinestring(gaiaGeomCollPtr geometry,
+                                        int vertices);
+
+        /**
+         * @brief Initializes an interior ring of a polygon
+         * @param[in] polygon  Arena polygon
+         * @param[in] position Interior ring index
+         * @param[in] vertices Number of points
+         * @returns Interior ring with uninitialized coordinates
+         * @throws std::runtime_error on failure
+         */
+        gaiaRingPtr addInteriorRing(gaiaPolygonPtr polygon,
+                                    int position,
+                                    int vertices);
+
+        /**
+         * @brief Appends a point to a geometry
+         * @param[in] geometry Arena geometry collection
+         * @param[in] x        Point x-coordinate
+         * @param[in] y        Point y-coordinate
+         * @param[in] z        Point z-coordinate (ignored without Z dimension)
+         * @param[in] m        Point measurement (ignored without M dimension)
+         * @returns New point
+         * @throws std::runtime_error on failure
+         */
+        gaiaPointPtr addPoint(gaiaGeomCollPtr geometry,
+                              double x,
+                              double y,
+                              double z = 0,
+                              double m = 0);
+
+        /**
+         * @brief Appends a polygon to a geometry
+         * @param[in] geometry  Arena geometry collection
+         * @param[in] vertices  Number of exterior ring points
+         * @param[in] interiors Number of interior rings, to be initialized
+         *                      with addInteriorRing
+         * @returns New polygon with uninitialized exterior coordinates
+         * @throws std::runtime_error on failure
+         */
+        gaiaPolygonPtr addPolygon(gaiaGeomCollPtr geometry,
+                                  int vertices,
+                                  int interiors = 0);
+
+        /**
+         * @brief Copies a geometry into the arena.
+         * @param[in] geometry Heap or arena geometry collection
+         * @returns Arena geometry with the same elements, SRID, declared
+         *          type and MBR
+         * @throws std::runtime_error on failure
+         */
+        gaiaGeomCollPtr clone(gaiaGeomCollPtr geometry);
+
+        /**
+         * @returns Number of allocated blocks
+         */
+        int getBlockCount() const;
+
+        /**
+         * @returns Number of bytes handed out since creation or last reset
+         */
+        size_t getBytesUsed() const;
+
+        /**
+         * @brief Invalidates all arena geometries and keeps the first block
+         *        for reuse
+         */
+        void reset();
+
+        /**
+         * @brief Copies an arena geometry to the heap.
+         * @param[in] geometry Arena geometry collection
+         * @returns New GeometryCollection pointer independent of the arena
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer.
+         *          Should be owned by a GeometryCollectionPtr.
+         */
+        static GeometryCollection * toHeap(gaiaGeomCollPtr geometry);
+
+    private:
+
+        // Disallow copying and assignment
+        GeometryArena & operator=(const GeometryArena &);
+        GeometryArena(const GeometryArena &);
+
+        /**
+         * @brief Allocates a ring structure and its coordinates
+         * @param[in] ring       Ring to initialize
+         * @param[in] vertices   Number of points
+         * @param[in] dimensions Coordinate dimensions type
+         * @param[in] polygon    Owning polygon
+         */
+        void initRing(gaiaRingPtr ring,
+                      int vertices,
+                      int dimensions,
+                      gaiaPolygonPtr polygon);
+
+        /**
+         * @brief Size of regular blocks
+         */
+        size_t _blockSize;
+
+        /**
+         * @brief Regular blocks, the current one last
+         */
+        std::vector<char *> _blocks;
+
+        /**
+         * @brief Dedicated blocks of oversized requests
+         */
+        std::vector<char *> _large;
+
+        /**
+         * @brief Bytes handed out
+         */
+        size_t _used;
+
+        /**
+         * @brief Next free byte of the current block
+         */
+        char * _next;
+
+        /**
+         * @brief End of the current block
+         */
+        char * _end;
+
+    };
+
+}
@@ -0,0 +1,236 @@
+/**
+ * @file    GeometryCache.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeometryCache class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class GeometryCollection;
+    class SpatialDatabase;
+
+    /**
+     * @brief LRU cache of geometries decoded from table rows.
+     * @details Entries are keyed by connection (SpatialDatabase::getId,
+     *          which is never reused), table, column and rowid and tagged
+     *          with the connection data version (PRAGMA data_version and
+     *          the connection's own change count). Neither counter says
+     *          which table changed, so any write to the database, even to
+     *          an unrelated table, makes every entry of that connection
+     *          stale; each is dropped and decoded again on its next lookup.
+     *          The cache therefore suits read-mostly databases. Decoded
+     *          geometries are shared read-only through std::shared_ptr
+     *          handles that stay valid after eviction. The least recently used entries
+     *          are evicted once the estimated decoded size exceeds the
+     *          budget. A cache is not thread-safe; use one per thread, e.g.
+     *          getThreadCache().
+     */
+    class SPATIALITECPP_ABI GeometryCache : public PtrBase
+    {
+
+    public:
+
+        /**
+         * Shared read-only decoded geometry
+         */
+        typedef std::shared_ptr<const GeometryCollection> Entry;
+
+        /**
+         * @brief Creates an empty cache
+         * @param[in] budget Memory budget in bytes. Zero disables caching.
+         */
+        explicit GeometryCache(size_t budget = 64 * 1024 * 1024);
+
+        /**
+         * @brief Releases the cache references
+         */
+        ~GeometryCache();
+
+        /**
+         * @brief Removes all entries
+         */
+        void clear();
+
+        /**
+         * @brief Gets the decoded geometry of a row.
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name
+         * @param[in] column   Geometry column name
+         * @param[in] rowid    Row identifier
+         * @returns Decoded geometry or an empty handle if the row does not
+         *          exist or its value is not a geometry blob
+         * @throws std::runtime_error on failure
+         */
+        Entry get(SpatialDatabase const & database,
+                  std::string const & table,
+                  std::string const & column,
+                  sqlite3_int64 rowid);
+
+        /**
+         * @returns Memory budget in bytes
+         */
+        size_t getBudget() const;
+
+        /**
+         * @returns Estimated size in bytes of the cached geometries
+         */
+        size_t getBytes() const;
+
+        /**
+         * @returns Number of cached geometries
+         */
+        int getCount() const;
+
+        /**
+         * @returns Number of entries evicted to stay within budget
+         */
+        long long getEvictions() const;
+
+        /**
+         * @returns Number of lookups answered from the cache
+         */
+        long long getHits() const;
+
+        /**
+         * @returns Number of lookups that decoded the row
+         */
+        long long getMisses() const;
+
+        /**
+         * @returns Number of misses caused by a data version change
+         */
+        long long getStale() const;
+
+        /**
+         * @brief Estimates the decoded size of a geometry.
+         * @param[in] geometry Geometry collection
+         * @returns Size in bytes of the gaia structs and coordinate arrays
+         */
+        static size_t getSize(gaiaGeomCollPtr geometry);
+
+        /**
+         * @returns Cache of the calling thread, created disabled (zero
+         *          budget) until setBudget() is called
+         */
+        static GeometryCache & getThreadCache();
+
+        /**
+         * @brief Changes the memory budget, evicting entries as needed
+         * @param[in] budget Memory budget in bytes. Zero disables caching.
+         */
+        void setBudget(size_t budget);
+
+    private:
+
+        // Disallow copying and assignment
+        GeometryCache & operator=(const GeometryCache &);
+        GeometryCache(const GeometryCache &);
+
+        /**
+         * @brief Cache key
+         */
+        struct Key
+        {
+            sqlite3_int64 connection; ///< SpatialDatabase::getId
+            std::string table;        ///< Table name
+            std::string column;       ///< Geometry column name
+            sqlite3_int64 rowid;      ///< Row identifier
+
+            /**
+             * @returns True if this key orders before another
+             */
+            bool operator<(const Key & other) const;
+        };
+
+        /**
+         * @brief Cached geometry
+         */
+        struct Slot
+        {
+            Key key;                  ///< Cache key
+            sqlite3_int64 version;    ///< PRAGMA data_version
+            sqlite3_int64 changes;    ///< Connection change count
+            size_t bytes;             ///< Estimated decoded size
+            Entry geometry;           ///< Decoded geometry
+        };
+
+        /**
+         * @brief Entries from most to least recently used
+         */
+        typedef std::list<Slot> Slots;
+
+        /**
+         * @brief Evicts least recently used entries down to a size
+         * @param[in] bytes Target size
+         */
+        void evict(size_t bytes);
+
+        /**
+         * @brief Removes an entry
+         * @param[in] slot Entry to remove
+         */
+        void erase(Slots::iterator slot);
+
+        /**
+         * @brief Memory budget
+         */
+        size_t _budget;
+
+        /**
+         * @brief Estimated size of the entries
+         */
+        size_t _bytes;
+
+        /**
+         * @brief Number of evicted entries
+         */
+        long long _evictions;
+
+        /**
+         * @brief Number of cache hits
+         */
+        long long _hits;
+
+        /**
+         * @brief Number of cache misses
+         */
+        long long _misses;
+
+        /**
+         * @brief Number of stale entries found
+         */
+        long long _stale;
+
+        /**
+         * @brief Lookup of the entries
+         */
+        std::map<Key, Slots::iterator> _index;
+
+        /**
+         * @brief Entries in recency order
+         */
+        Slots _slots;
+
+    };
+
+}
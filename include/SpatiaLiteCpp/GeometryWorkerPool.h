@@ -0,0 +1,200 @@
+/**
+ * @file    GeometryWorkerPool.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeometryWorkerPool class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/PreparedGeometry.h"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief Thread pool evaluating GEOS predicates over geometry pairs.
+     * @details Each worker owns its own reentrant GEOS context for its whole
+     *          lifetime, so batches never share the single handle of a
+     *          SpatialDatabase connection cache. A batch is cut into chunks
+     *          dealt round-robin to per-worker queues; idle workers steal
+     *          chunks from the back of the other queues. Results are written
+     *          by task index and so come back in input order. Geometries are
+     *          only read and may appear in several tasks.
+     */
+    class SPATIALITECPP_ABI GeometryWorkerPool : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Operations beyond the PreparedGeometry::Predicate values
+         */
+        enum Operation
+        {
+            EQUALS = PreparedGeometry::WITHIN + 1, ///< Geometries are equal
+            IS_VALID = PreparedGeometry::WITHIN + 2 ///< First is valid
+        };
+
+        /**
+         * @brief Unit of work
+         */
+        struct Task
+        {
+            gaiaGeomCollPtr first;   ///< Left-hand geometry
+            gaiaGeomCollPtr second;  ///< Right-hand geometry, unused by IS_VALID
+            int operation;           ///< Predicate or Operation value
+        };
+
+        /**
+         * @brief Starts the worker threads
+         * @param[in] threads   Number of workers, 0 for the hardware count
+         * @param[in] chunkSize Tasks per scheduling chunk
+         * @throws std::runtime_error on failure
+         */
+        explicit GeometryWorkerPool(int threads = 0, int chunkSize = 64);
+
+        /**
+         * @brief Stops the workers and releases their GEOS contexts
+         */
+        ~GeometryWorkerPool();
+
+        /**
+         * @brief Evaluates a batch of tasks on the workers.
+         * @details Blocks until the batch completes. Concurrent callers are
+         *          served one batch at a time.
+         * @param[in] tasks Tasks to evaluate
+         * @returns 1 or 0 per task, in input order
+         * @throws std::runtime_error if any task fails
+         */
+        std::vector<char> evaluate(std::vector<Task> const & tasks);
+
+        /**
+         * @returns Tasks per scheduling chunk
+         */
+        int getChunkSize() const;
+
+        /**
+         * @returns Number of chunks taken from another worker's queue
+         */
+        long long getSteals() const;
+
+        /**
+         * @returns Number of worker threads
+         */
+        int getThreadCount() const;
+
+    private:
+
+        // Disallow copying and assignment
+        GeometryWorkerPool & operator=(const GeometryWorkerPool &);
+        GeometryWorkerPool(const GeometryWorkerPool &);
+
+        /**
+         * @brief Worker thread and its chunk queue
+         */
+        struct Worker;
+
+        /**
+         * @brief Takes the next chunk, stealing when the own queue is empty
+         * @param[in]  index Worker index
+         * @param[out] begin First task of the chunk
+         * @param[out] end   One past the last task of the chunk
+         * @returns False if all queues are empty
+         */
+        bool pop(size_t index, size_t & begin, size_t & end);
+
+        /**
+         * @brief Worker thread body
+         * @param[in] index Worker index
+         */
+        void run(size_t index);
+
+        /**
+         * @brief Stops the workers and waits for the started threads
+         */
+        void shutdown();
+
+        /**
+         * @brief Tasks per chunk
+         */
+        size_t _chunkSize;
+
+        /**
+         * @brief Workers still busy with the current batch
+         */
+        size_t _active;
+
+        /**
+         * @brief Signals batch completion
+         */
+        std::condition_variable _done;
+
+        /**
+         * @brief Set when a task of the current batch failed
+         */
+        std::atomic<bool> _failed;
+
+        /**
+         * @brief Batch counter waking the workers
+         */
+        unsigned long _generation;
+
+        /**
+         * @brief Guards the batch state
+         */
+        std::mutex _mutex;
+
+        /**
+         * @brief Serializes concurrent batches
+         */
+        std::mutex _mutexBatch;
+
+        /**
+         * @brief Results of the current batch
+         */
+        char * _results;
+
+        /**
+         * @brief Number of stolen chunks
+         */
+        std::atomic<long long> _steals;
+
+        /**
+         * @brief Set when the workers must exit
+         */
+        bool _stop;
+
+        /**
+         * @brief Tasks of the current batch
+         */
+        const std::vector<Task> * _tasks;
+
+        /**
+         * @brief Signals a new batch or stop
+         */
+        std::condition_variable _wake;
+
+        /**
+         * @brief Worker threads
+         */
+        std::vector<std::unique_ptr<Worker> > _workers;
+
+    };
+
+}
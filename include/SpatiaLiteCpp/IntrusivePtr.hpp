@@ -0,0 +1,331 @@
+/**
+ * @file    IntrusivePtr.hpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main IntrusivePtr class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+#include <cstddef>
+#include <utility>
+
+/**
+ * @def SPATIALITECPP_REFCOUNT_ATOMIC
+ * @brief Determines the reference counter of RefCounted objects
+ * @details Defined values:
+ *     - 0 = Plain integer. Handles to the same object must not be copied or
+ *           released concurrently.
+ *     - 1 = std::atomic integer (default)
+ *
+ *     Must be the same when building and using the library.
+ */
+#ifndef SPATIALITECPP_REFCOUNT_ATOMIC
+    #define SPATIALITECPP_REFCOUNT_ATOMIC 1
+#endif
+#if SPATIALITECPP_REFCOUNT_ATOMIC
+    #include <atomic>
+#endif
+// Default pointer type. See SpatiaLiteCpp.h.
+#ifndef SPATIALITECPP_PTRTYPE
+    #define SPATIALITECPP_PTRTYPE 1
+#endif
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief Reference counter embedded in wrapper objects.
+     * @details Used by IntrusivePtr so that the object and its count share a
+     *          single allocation. Copies of an object start with their own
+     *          count.
+     */
+    class RefCounted
+    {
+
+    public:
+
+        /**
+         * @returns Number of IntrusivePtr handles to this object
+         */
+        int getRefCount() const
+        {
+#if SPATIALITECPP_REFCOUNT_ATOMIC
+            return this->_refs.load(std::memory_order_relaxed);
+#else
+            return this->_refs;
+#endif
+        }
+
+    protected:
+
+        /**
+         * @brief Creates an unreferenced object
+         */
+        RefCounted() :
+            _refs(0)
+        {
+        }
+
+        /**
+         * @brief Creates an unreferenced copy
+         */
+        RefCounted(const RefCounted &) :
+            _refs(0)
+        {
+        }
+
+        /**
+         * @brief Keeps the current count on assignment
+         * @returns This object
+         */
+        RefCounted & operator=(const RefCounted &)
+        {
+            return *this;
+        }
+
+        /**
+         * @brief Objects are only deleted through their own type
+         */
+        ~RefCounted()
+        {
+        }
+
+    private:
+
+        template <class T> friend class IntrusivePtr;
+
+        /**
+         * @brief Adds a reference
+         */
+        void addRef() const
+        {
+#if SPATIALITECPP_REFCOUNT_ATOMIC
+            this->_refs.fetch_add(1, std::memory_order_relaxed);
+#else
+            ++this->_refs;
+#endif
+        }
+
+        /**
+         * @brief Removes a reference
+         * @returns True if it was the last reference
+         */
+        bool releaseRef() const
+        {
+#if SPATIALITECPP_REFCOUNT_ATOMIC
+            return this->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+#else
+            return --this->_refs == 0;
+#endif
+        }
+
+        /**
+         * @brief Number of references
+         */
+#if SPATIALITECPP_REFCOUNT_ATOMIC
+        mutable std::atomic<int> _refs;
+#else
+        mutable int _refs;
+#endif
+
+    };
+
+    /**
+     * @brief Base of the wrapper classes with pointer typedefs.
+     * @details RefCounted when SPATIALITECPP_PTRTYPE selects IntrusivePtr,
+     *          otherwise an empty class that adds no storage.
+     */
+#if SPATIALITECPP_PTRTYPE == 5
+    typedef RefCounted PtrBase;
+#else
+    class PtrBase
+    {
+    };
+#endif
+
+    /**
+     * @brief Shared ownership of a RefCounted object.
+     * @details Drop-in replacement of the shared pointers selected by
+     *          SPATIALITECPP_PTRTYPE without a separate control block. The
+     *          object is deleted through T when the last handle goes away.
+     */
+    template <class T>
+    class IntrusivePtr
+    {
+
+    public:
+
+        /**
+         * @brief Creates an empty handle
+         */
+        IntrusivePtr() noexcept :
+            _object(0)
+        {
+        }
+
+        /**
+         * @brief Takes shared ownership of an object
+         * @param[in] object Object pointer
+         */
+        explicit IntrusivePtr(T * object) :
+            _object(object)
+        {
+            if (this->_object) this->_object->addRef();
+        }
+
+        /**
+         * @brief Shares ownership with another handle
+         * @param[in] other Source handle
+         */
+        IntrusivePtr(const IntrusivePtr & other) :
+            _object(other._object)
+        {
+            if (this->_object) this->_object->addRef();
+        }
+
+        /**
+         * @brief Shares ownership with a handle of a derived type
+         * @param[in] other Source handle
+         */
+        template <class U>
+        IntrusivePtr(const IntrusivePtr<U> & other) :
+            _object(other.get())
+        {
+            if (this->_object) this->_object->addRef();
+        }
+
+        /**
+         * @brief Takes over ownership from another handle
+         * @param[in] other Handle left empty
+         */
+        IntrusivePtr(IntrusivePtr && other) noexcept :
+            _object(other._object)
+        {
+            other._object = 0;
+        }
+
+        /**
+         * @brief Releases the reference
+         */
+        ~IntrusivePtr()
+        {
+            if (this->_object && this->_object->releaseRef())
+            {
+                delete this->_object;
+            }
+        }
+
+        /**
+         * @brief Shares ownership with another handle
+         * @param[in] other Source handle
+         * @returns This handle
+         */
+        IntrusivePtr & operator=(IntrusivePtr other) noexcept
+        {
+            this->swap(other);
+            return *this;
+        }
+
+        /**
+         * @returns Object reference
+         */
+        T & operator*() const
+        {
+            return *this->_object;
+        }
+
+        /**
+         * @returns Object pointer
+         */
+        T * operator->() const
+        {
+            return this->_object;
+        }
+
+        /**
+         * @returns True if an object is owned
+         */
+        explicit operator bool() const noexcept
+        {
+            return this->_object != 0;
+        }
+
+        /**
+         * @returns Object pointer
+         */
+        T * get() const noexcept
+        {
+            return this->_object;
+        }
+
+        /**
+         * @brief Releases the reference and takes shared ownership of
+         *        another object
+         * @param[in] object Object pointer (optional)
+         */
+        void reset(T * object = 0)
+        {
+            IntrusivePtr(object).swap(*this);
+        }
+
+        /**
+         * @brief Exchanges objects with another handle
+         * @param[in] other Other handle
+         */
+        void swap(IntrusivePtr & other) noexcept
+        {
+            T * object = this->_object;
+            this->_object = other._object;
+            other._object = object;
+        }
+
+        /**
+         * @returns Number of handles to the object (shared_ptr naming)
+         */
+        long use_count() const
+        {
+            return this->_object ? this->_object->getRefCount() : 0;
+        }
+
+    private:
+
+        /**
+         * @brief Object pointer
+         */
+        T * _object;
+
+    };
+
+    /**
+     * @returns True if both handles point to the same object
+     */
+    template <class T, class U>
+    bool operator==(const IntrusivePtr<T> & a, const IntrusivePtr<U> & b)
+    {
+        return a.get() == b.get();
+    }
+
+    /**
+     * @returns True if the handles point to different objects
+     */
+    template <class T, class U>
+    bool operator!=(const IntrusivePtr<T> & a, const IntrusivePtr<U> & b)
+    {
+        return a.get() != b.get();
+    }
+
+    /**
+     * @brief Allocates an object and its reference count together.
+     * @param[in] args Constructor arguments
+     * @returns New handle
+     */
+    template <class T, class... Args>
+    IntrusivePtr<T> makeIntrusive(Args &&... args)
+    {
+        return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+    }
+
+}
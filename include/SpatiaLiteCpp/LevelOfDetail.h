@@ -0,0 +1,196 @@
+/**
+ * @file    LevelOfDetail.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main LevelOfDetail class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <string>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class SpatialDatabase;
+
+    /**
+     * @brief Precomputed simplifications of a geometry column.
+     * @details Each geometry is simplified at a fixed set of tolerances and
+     *          stored in the side table getTableName(), keyed by tolerance
+     *          and rowid, so overview zooms read geometries with a fraction
+     *          of their vertices. For Douglas-Peucker and Visvalingam-Whyatt
+     *          the significance of every vertex is computed once per
+     *          geometry, and each level only filters it. The topology
+     *          preserving mode runs GEOS TopologyPreserveSimplify once per
+     *          level. Rows are simplified in parallel, and the side table is
+     *          written by the calling thread.
+     */
+    class SPATIALITECPP_ABI LevelOfDetail : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Simplification methods
+         */
+        enum Method
+        {
+            DOUGLAS_PEUCKER,   ///< Vertices within tolerance of a chord removed
+            VISVALINGAM,       ///< Vertices with effective area below
+                               ///< tolerance squared removed
+            PRESERVE_TOPOLOGY  ///< GEOS Douglas-Peucker without introducing
+                               ///< invalid topology. Needs
+                               ///< SPATIALITECPP_USE_GEOS.
+        };
+
+        /**
+         * @brief Creates a level of detail definition
+         * @param[in] tolerances Positive tolerances in map units, one per
+         *                       level, in any order
+         * @param[in] method     Method value
+         * @param[in] threads    Number of workers. Zero uses the hardware
+         *                       concurrency.
+         * @param[in] chunkSize  Number of rows handed to a worker at a time
+         * @throws std::runtime_error on invalid arguments
+         */
+        explicit LevelOfDetail(std::vector<double> const & tolerances,
+                               int method = DOUGLAS_PEUCKER,
+                               int threads = 0,
+                               int chunkSize = 256);
+
+        /**
+         * @brief Destructor
+         */
+        ~LevelOfDetail();
+
+        /**
+         * @brief Simplifies every geometry of a table at every level
+         * @details The side table is created if needed and the rows of
+         *          these tolerances are replaced, inside a savepoint of the
+         *          caller's connection. Geometries that vanish at a level,
+         *          such as rings thinner than the tolerance, are stored as
+         *          NULL.
+         * @param[in] database Spatial database, writable
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name
+         * @returns Number of rows simplified
+         * @throws std::runtime_error on failure
+         */
+        long long build(SpatialDatabase const & database,
+                        std::string const & table,
+                        std::string const & geometry) const;
+
+        /**
+         * @brief Chooses the level for a display resolution
+         * @param[in] resolution Map units per pixel
+         * @returns Index into getTolerances() of the largest tolerance not
+         *          above the resolution, or -1 for full resolution
+         */
+        int getLevel(double resolution) const;
+
+        /**
+         * @returns Method value
+         */
+        int getMethod() const;
+
+        /**
+         * @brief Gets the query of the geometries for a display resolution
+         * @param[in] table      Table name
+         * @param[in] geometry   Geometry column name
+         * @param[in] resolution Map units per pixel
+         * @returns SQL selecting the rowid and the geometry BLOB of every row,
+         *          from the side table or from the table itself. The side
+         *          table query has one parameter, to be bound to
+         *          getTolerances()[getLevel(resolution)].
+         */
+        std::string getQuery(std::string const & table,
+                             std::string const & geometry,
+                             double resolution) const;
+
+        /**
+         * @returns Name of the side table of a geometry column
+         */
+        static std::string getTableName(std::string const & table,
+                                        std::string const & geometry);
+
+        /**
+         * @returns Number of workers
+         */
+        int getThreadCount() const;
+
+        /**
+         * @returns Tolerances in ascending order
+         */
+        std::vector<double> const & getTolerances() const;
+
+        /**
+         * @brief Reads one geometry for a display resolution
+         * @param[in] database   Spatial database
+         * @param[in] table      Table name
+         * @param[in] geometry   Geometry column name
+         * @param[in] rowid      Row identifier
+         * @param[in] resolution Map units per pixel
+         * @returns Geometry to free with gaiaFreeGeomColl, or null if the
+         *          row has none at that level
+         * @throws std::runtime_error on failure
+         */
+        gaiaGeomCollPtr read(SpatialDatabase const & database,
+                             std::string const & table,
+                             std::string const & geometry,
+                             sqlite3_int64 rowid,
+                             double resolution) const;
+
+        /**
+         * @brief Simplifies one geometry
+         * @param[in] geometry  Geometry
+         * @param[in] tolerance Tolerance in map units
+         * @param[in] method    Method value
+         * @returns Geometry to free with gaiaFreeGeomColl, or null if
+         *          nothing is left
+         * @throws std::runtime_error on failure
+         */
+        static gaiaGeomCollPtr simplify(gaiaGeomCollPtr geometry,
+                                        double tolerance,
+                                        int method = DOUGLAS_PEUCKER);
+
+    private:
+
+        // Disallow copying and assignment
+        LevelOfDetail & operator=(const LevelOfDetail &);
+        LevelOfDetail(const LevelOfDetail &);
+
+        /**
+         * @brief Number of rows per chunk
+         */
+        int _chunkSize;
+
+        /**
+         * @brief Method value
+         */
+        int _method;
+
+        /**
+         * @brief Number of workers
+         */
+        int _threads;
+
+        /**
+         * @brief Tolerances in ascending order
+         */
+        std::vector<double> _tolerances;
+
+    };
+
+}
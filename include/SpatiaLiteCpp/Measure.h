@@ -0,0 +1,184 @@
+/**
+ * @file    Measure.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main Measure class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief Planar measurement kernels over gaia coordinate arrays.
+     * @details The kernels operate directly on the interleaved Coords arrays
+     *          of gaiaLinestring and gaiaRing for every dimension model
+     *          (GAIA_XY, GAIA_XY_Z, GAIA_XY_M and GAIA_XY_Z_M). SSE2 and AVX2
+     *          implementations are selected at run time from the CPU
+     *          features, with a scalar fallback. Results match the scalar
+     *          kernels within floating point summation order.
+     */
+    class SPATIALITECPP_ABI Measure
+    {
+
+    public:
+
+        /**
+         * @brief Kernel implementations
+         */
+        enum InstructionSet
+        {
+            SCALAR = 0, ///< Portable C++ loops
+            SSE2   = 1, ///< 128-bit SSE2 kernels
+            AVX2   = 2  ///< 256-bit AVX2 kernels
+        };
+
+        /**
+         * @brief Computes the planar (shoelace) area of a ring.
+         * @param[in] coords     Ring Coords array
+         * @param[in] points     Number of points
+         * @param[in] dimensions Dimension model of the array
+         * @returns Absolute area. Open rings are implicitly closed.
+         * @throws std::runtime_error on invalid dimensions
+         */
+        static double getArea(const double * coords,
+                              int points,
+                              int dimensions);
+
+        /**
+         * @brief Computes the planar area of all polygons of a geometry.
+         * @details Counterpart of gaiaGeomCollArea without going through
+         *          GEOS: exterior ring areas minus interior ring areas.
+         * @param[in] geometry Input geometry collection
+         * @returns Area in squared coordinate units
+         * @throws std::runtime_error on failure
+         */
+        static double getArea(gaiaGeomCollPtr geometry);
+
+        /**
+         * @brief Computes the bounding box of a coordinate array.
+         * @param[in]  coords     Coords array
+         * @param[in]  points     Number of points
+         * @param[in]  dimensions Dimension model of the array
+         * @param[out] minx       Minimum x-coordinate
+         * @param[out] miny       Minimum y-coordinate
+         * @param[out] maxx       Maximum x-coordinate
+         * @param[out] maxy       Maximum y-coordinate
+         * @returns False if the array is empty otherwise true
+         * @throws std::runtime_error on invalid dimensions
+         */
+        static bool getBounds(const double * coords,
+                              int points,
+                              int dimensions,
+                              double & minx,
+                              double & miny,
+                              double & maxx,
+                              double & maxy);
+
+        /**
+         * @brief Computes the area centroid of a ring.
+         * @param[in]  coords     Ring Coords array
+         * @param[in]  points     Number of points
+         * @param[in]  dimensions Dimension model of the array
+         * @param[out] x          Centroid x-coordinate
+         * @param[out] y          Centroid y-coordinate
+         * @returns False if the ring has no area otherwise true
+         * @throws std::runtime_error on invalid dimensions
+         */
+        static bool getCentroid(const double * coords,
+                                int points,
+                                int dimensions,
+                                double & x,
+                                double & y);
+
+        /**
+         * @brief Computes the planar distance from a point to a geometry.
+         * @details Distance to the nearest point, segment or ring edge.
+         *          Points inside a polygon (even-odd over its rings) are at
+         *          distance zero.
+         * @param[in] geometry Input geometry collection
+         * @param[in] x        Point x-coordinate
+         * @param[in] y        Point y-coordinate
+         * @returns Distance in coordinate units or DBL_MAX if the geometry is
+         *          empty
+         * @throws std::runtime_error on failure
+         */
+        static double getDistance(gaiaGeomCollPtr geometry,
+                                  double x,
+                                  double y);
+
+        /**
+         * @returns Instruction set used by the kernels
+         */
+        static int getInstructionSet();
+
+        /**
+         * @brief Computes the planar length of a line.
+         * @param[in] coords     Line Coords array
+         * @param[in] points     Number of points
+         * @param[in] dimensions Dimension model of the array
+         * @returns Length in coordinate units
+         * @throws std::runtime_error on invalid dimensions
+         */
+        static double getLength(const double * coords,
+                                int points,
+                                int dimensions);
+
+        /**
+         * @brief Computes the planar length of all lines and polygon rings of
+         *        a geometry.
+         * @details Counterpart of gaiaGeomCollLength without going through
+         *          GEOS.
+         * @param[in] geometry Input geometry collection
+         * @returns Length in coordinate units
+         * @throws std::runtime_error on failure
+         */
+        static double getLength(gaiaGeomCollPtr geometry);
+
+        /**
+         * @brief Computes the length weighted centroid of a line.
+         * @param[in]  coords     Line Coords array
+         * @param[in]  points     Number of points
+         * @param[in]  dimensions Dimension model of the array
+         * @param[out] x          Centroid x-coordinate
+         * @param[out] y          Centroid y-coordinate
+         * @returns False if the array is empty otherwise true. A zero length
+         *          line returns its first point.
+         * @throws std::runtime_error on invalid dimensions
+         */
+        static bool getLineCentroid(const double * coords,
+                                    int points,
+                                    int dimensions,
+                                    double & x,
+                                    double & y);
+
+        /**
+         * @brief Selects the kernel implementation.
+         * @details Requests above what the CPU supports are lowered to the
+         *          best supported set. Not thread-safe while other threads
+         *          are measuring, whose work in flight may run on either
+         *          set; meant to be called at start-up or by tests.
+         * @param[in] set Requested InstructionSet
+         * @returns Instruction set now in use
+         */
+        static int setInstructionSet(int set);
+
+    private:
+
+        /**
+         * @brief Private constructor for a static class
+         */
+        Measure();
+
+    };
+
+}
@@ -15,6 +15,12 @@ extern "C"
 #include "spatialite/gaiageo.h"
 }
 
+#include <cstddef>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
 namespace SpatiaLite
 {
 
@@ -42,11 +48,49 @@ namespace SpatiaLite
          */
         ~OutputBuffer();
 
+        /**
+         * @brief Empties the text and clears the error flag but keeps the
+         *        storage for the next serialization
+         */
+        void clear();
+
+        /**
+         * @returns Allocated size in bytes
+         */
+        size_t getCapacity() const;
+
+        /**
+         * @returns Null-terminated text, empty if nothing was written. Valid
+         *          until the buffer is next written, cleared or shrunk.
+         */
+        const char * getData() const;
+
+        /**
+         * @returns Length of the text in bytes
+         */
+        size_t getSize() const;
+
+#if __cplusplus >= 201703L
+        /**
+         * @returns View of the text without copying, with the lifetime of
+         *          getData()
+         */
+        std::string_view getView() const
+        {
+            return std::string_view(this->getData(), this->getSize());
+        }
+#endif
+
         /**
          * @returns True if writing buffer is valid otherwise false.
          */
         bool isValid() const;
 
+        /**
+         * @brief Empties the text and frees the storage
+         */
+        void shrink();
+
     private:
 
         /**
@@ -0,0 +1,219 @@
+/**
+ * @file    OutputBufferPool.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main OutputBufferPool class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/OutputBuffer.h"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief Pool of output buffers that keep their storage between uses.
+     * @details Buffers are lent out empty and come back when their lease
+     *          ends, so repeated serializations (gaiaOutWkt,
+     *          gaiaOutGeoJSON, ...) reuse the already grown storage
+     *          instead of reallocating it from zero. Returned buffers whose
+     *          storage grew past the high-water capacity are freed back to
+     *          zero, and buffers beyond the idle limit are deleted. A pool
+     *          is not thread-safe; use one per thread, e.g. getThreadPool().
+     *          Leases must end before their pool is destroyed.
+     */
+    class SPATIALITECPP_ABI OutputBufferPool : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Move-only loan of a pooled buffer, returned to the pool
+         *        when destroyed or reset
+         */
+        class SPATIALITECPP_ABI Lease
+        {
+
+        public:
+
+            /**
+             * @brief Creates an empty lease
+             */
+            Lease() noexcept;
+
+            /**
+             * @brief Takes over another lease
+             * @param[in] other Lease left empty
+             */
+            Lease(Lease && other) noexcept;
+
+            /**
+             * @brief Returns the current buffer and takes over another lease
+             * @param[in] other Lease left empty
+             * @returns This lease
+             */
+            Lease & operator=(Lease && other) noexcept;
+
+            /**
+             * @brief Returns the buffer to the pool
+             */
+            ~Lease();
+
+            /**
+             * @returns True if a buffer is held
+             */
+            explicit operator bool() const noexcept;
+
+            /**
+             * @returns Held buffer
+             */
+            OutputBuffer * get() const noexcept;
+
+            /**
+             * @returns Held buffer
+             */
+            OutputBuffer * operator->() const noexcept;
+
+            /**
+             * @brief Returns the buffer to the pool early
+             */
+            void reset() noexcept;
+
+            // Disallow copying and assignment
+            Lease(const Lease &) = delete;
+            Lease & operator=(const Lease &) = delete;
+
+        private:
+
+            friend class OutputBufferPool;
+
+            /**
+             * @brief Creates a lease of a pooled buffer
+             * @param[in] pool   Owning pool
+             * @param[in] buffer Lent buffer
+             */
+            Lease(OutputBufferPool * pool, OutputBuffer * buffer) noexcept;
+
+            /**
+             * @brief Lent buffer
+             */
+            OutputBuffer * _buffer;
+
+            /**
+             * @brief Owning pool
+             */
+            OutputBufferPool * _pool;
+
+        };
+
+        /**
+         * @brief Creates an empty pool
+         * @param[in] maxCapacity High-water storage size in bytes kept by
+         *                        returned buffers
+         * @param[in] maxIdle     Number of idle buffers kept
+         */
+        explicit OutputBufferPool(size_t maxCapacity = 1024 * 1024,
+                                  int maxIdle = 8);
+
+        /**
+         * @brief Deletes the idle buffers
+         */
+        ~OutputBufferPool();
+
+        /**
+         * @brief Lends an empty buffer, reusing an idle one if possible
+         * @returns Lease of the buffer
+         */
+        Lease acquire();
+
+        /**
+         * @brief Deletes the idle buffers
+         */
+        void clear();
+
+        /**
+         * @returns Number of acquisitions served by an idle buffer
+         */
+        long long getHits() const;
+
+        /**
+         * @returns Number of idle buffers
+         */
+        int getIdleCount() const;
+
+        /**
+         * @returns High-water storage size in bytes
+         */
+        size_t getMaxCapacity() const;
+
+        /**
+         * @returns Number of idle buffers kept
+         */
+        int getMaxIdle() const;
+
+        /**
+         * @returns Number of acquisitions that created a buffer
+         */
+        long long getMisses() const;
+
+        /**
+         * @returns Pool of the calling thread
+         */
+        static OutputBufferPool & getThreadPool();
+
+        /**
+         * @returns Number of returned buffers whose storage was freed
+         */
+        long long getTrims() const;
+
+    private:
+
+        // Disallow copying and assignment
+        OutputBufferPool & operator=(const OutputBufferPool &);
+        OutputBufferPool(const OutputBufferPool &);
+
+        /**
+         * @brief Takes back a lent buffer
+         * @param[in] buffer Returned buffer
+         */
+        void release(OutputBuffer * buffer) noexcept;
+
+        /**
+         * @brief Number of hits
+         */
+        long long _hits;
+
+        /**
+         * @brief Idle buffers
+         */
+        std::vector<OutputBuffer *> _idle;
+
+        /**
+         * @brief High-water storage size
+         */
+        size_t _maxCapacity;
+
+        /**
+         * @brief Number of idle buffers kept
+         */
+        int _maxIdle;
+
+        /**
+         * @brief Number of misses
+         */
+        long long _misses;
+
+        /**
+         * @brief Number of trimmed buffers
+         */
+        long long _trims;
+
+    };
+
+}
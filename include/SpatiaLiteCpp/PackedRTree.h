@@ -0,0 +1,277 @@
+/**
+ * @file    PackedRTree.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main PackedRTree class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+#include "sqlite3.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief Static packed Hilbert R-tree of bounding boxes.
+     * @details Boxes are added once, sorted by the Hilbert value of their
+     *          centers and packed bottom-up into full nodes stored in two
+     *          flat arrays (boxes and ids), leaves first and root last.
+     *          Internal node ids hold the position of their first child.
+     *          The arrays can be saved to a file and memory-mapped back
+     *          without rebuilding. A finished tree is read-only, so window
+     *          and nearest neighbour queries may run from many threads
+     *          without locking.
+     */
+    class SPATIALITECPP_ABI PackedRTree : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Exact distance from the query point to an item, used to
+         *        refine the box distances of nearest()
+         */
+        typedef std::function<double(sqlite3_int64)> Distance;
+
+        /**
+         * @brief Creates an empty tree to fill with add()
+         * @param[in] nodeSize Children per node, at least 2
+         * @throws std::runtime_error on invalid node size
+         */
+        explicit PackedRTree(int nodeSize = 16);
+
+        /**
+         * @brief Releases the arrays or the file mapping
+         */
+        ~PackedRTree();
+
+        /**
+         * @brief Adds an item
+         * @param[in] id   Item identifier, e.g. a rowid
+         * @param[in] minx Minimum x-coordinate
+         * @param[in] miny Minimum y-coordinate
+         * @param[in] maxx Maximum x-coordinate
+         * @param[in] maxy Maximum y-coordinate
+         * @throws std::runtime_error if the tree is finished
+         */
+        void add(sqlite3_int64 id,
+                 double minx,
+                 double miny,
+                 double maxx,
+                 double maxy);
+
+        /**
+         * @brief Sorts the items and builds the nodes. Required before
+         *        queries and save().
+         * @throws std::runtime_error if the tree is already finished
+         */
+        void finish();
+
+        /**
+         * @brief Builds a tree over the rows of a geometry column.
+         * @details The bounding boxes are read from the SpatiaLite blob
+         *          headers without decoding the geometries. NULL and
+         *          non-geometry values are skipped.
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name
+         * @param[in] nodeSize Children per node
+         * @returns Finished tree with rowids as item identifiers
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer. Should be owned by a
+         *          PackedRTreePtr.
+         */
+        static PackedRTree * fromTable(SpatialDatabase const & database,
+                                       std::string const & table,
+                                       std::string const & geometry,
+                                       int nodeSize = 16);
+
+        /**
+         * @brief Gets the extent of all items
+         * @param[out] minx Minimum x-coordinate
+         * @param[out] miny Minimum y-coordinate
+         * @param[out] maxx Maximum x-coordinate
+         * @param[out] maxy Maximum y-coordinate
+         * @returns False if the tree is empty otherwise true
+         */
+        bool getBounds(double & minx,
+                       double & miny,
+                       double & maxx,
+                       double & maxy) const;
+
+        /**
+         * @returns Number of items
+         */
+        size_t getCount() const;
+
+        /**
+         * @brief Hilbert curve index of a position on a 65536 x 65536 grid
+         * @param[in] x Grid column
+         * @param[in] y Grid row
+         * @returns Position along the curve
+         */
+        static unsigned int getHilbertValue(unsigned int x, unsigned int y);
+
+        /**
+         * @returns Children per node
+         */
+        int getNodeSize() const;
+
+        /**
+         * @returns True if the tree has been finished or loaded
+         */
+        bool isFinished() const;
+
+        /**
+         * @returns True if the arrays are mapped from a file
+         */
+        bool isMapped() const;
+
+        /**
+         * @brief Memory-maps a tree written by save().
+         * @details The counts are checked against the file size and every
+         *          internal node against the level below it, so queries
+         *          never leave the arrays.
+         * @param[in] filename Tree file
+         * @returns Finished read-only tree
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer. Should be owned by a
+         *          PackedRTreePtr.
+         */
+        static PackedRTree * load(std::string const & filename);
+
+        /**
+         * @brief Finds the k items nearest to a point.
+         * @details Best-first traversal on box distances. With a distance
+         *          function, leaf boxes are refined to exact distances
+         *          before being reported.
+         * @param[in] x           Query x-coordinate
+         * @param[in] y           Query y-coordinate
+         * @param[in] k           Maximum number of neighbours
+         * @param[in] maxDistance Search radius
+         * @param[in] distance    Optional exact distance of an item
+         * @returns Neighbours ordered by increasing distance
+         * @throws std::runtime_error if the tree is not finished
+         */
+        std::vector<SpatialDatabase::Neighbor> nearest(
+            double x,
+            double y,
+            int k,
+            double maxDistance = DBL_MAX,
+            Distance const & distance = Distance()) const;
+
+        /**
+         * @brief Writes the tree in native byte order.
+         * @param[in] filename Tree file
+         * @throws std::runtime_error on failure
+         */
+        void save(std::string const & filename) const;
+
+        /**
+         * @brief Finds the items intersecting a window.
+         * @param[in]  minx    Minimum x-coordinate
+         * @param[in]  miny    Minimum y-coordinate
+         * @param[in]  maxx    Maximum x-coordinate
+         * @param[in]  maxy    Maximum y-coordinate
+         * @param[out] results Identifiers appended in index order
+         * @returns Number of items found
+         * @throws std::runtime_error if the tree is not finished
+         */
+        size_t search(double minx,
+                      double miny,
+                      double maxx,
+                      double maxy,
+                      std::vector<sqlite3_int64> & results) const;
+
+    private:
+
+        // Disallow copying and assignment
+        PackedRTree & operator=(const PackedRTree &);
+        PackedRTree(const PackedRTree &);
+
+        /**
+         * @brief Computes the level bounds from the item count
+         */
+        void initLevels();
+
+        /**
+         * @brief Finds the end of the level holding a node
+         * @param[in] node Node position
+         * @returns One past the last node of the level
+         */
+        size_t upperBound(size_t node) const;
+
+        /**
+         * @brief Node boxes as minx, miny, maxx, maxy
+         */
+        const double * _boxes;
+
+        /**
+         * @brief Owned node boxes
+         */
+        std::vector<double> _boxData;
+
+        /**
+         * @brief Set once the nodes are built
+         */
+        bool _finished;
+
+        /**
+         * @brief Leaf item identifiers and internal child positions
+         */
+        const sqlite3_int64 * _ids;
+
+        /**
+         * @brief Owned node identifiers
+         */
+        std::vector<sqlite3_int64> _idData;
+
+        /**
+         * @brief End position of each level, leaves first
+         */
+        std::vector<size_t> _levelBounds;
+
+        /**
+         * @brief Mapped file view or null
+         */
+        void * _mapping;
+
+        /**
+         * @brief Size of the mapped file view
+         */
+        size_t _mappingSize;
+
+        /**
+         * @brief Extent of all items
+         */
+        double _maxx, _maxy, _minx, _miny;
+
+        /**
+         * @brief Children per node
+         */
+        int _nodeSize;
+
+        /**
+         * @brief Number of nodes including leaves
+         */
+        size_t _numNodes;
+
+        /**
+         * @brief Number of items
+         */
+        size_t _numItems;
+
+    };
+
+}
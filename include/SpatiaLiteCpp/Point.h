@@ -20,6 +20,7 @@ namespace SpatiaLite
 
     // Forward declarations
     class Blob;
+    class PointBatch;
 
     /**
      * Point buffer data type
@@ -59,6 +60,29 @@ namespace SpatiaLite
                                             double * z = 0,
                                             double * m = 0);
 
+        /**
+         * @brief Create point geometry blobs from coordinate arrays
+         * @details Batch counterpart of makePoint. All blobs are written into
+         *          one arena of fixed-size records without per-point
+         *          allocations.
+         * @param[in] srid Coordinate reference system code
+         * @param[in] x Point x-coordinates
+         * @param[in] y Point y-coordinates
+         * @param[in] count Number of points
+         * @param[in] z Point z-coordinates (optional)
+         * @param[in] m Point measurements (optional)
+         * @returns New pointer of point geometry blobs
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer. Should be owned by a
+         *          PointBatchPtr.
+         */
+        static SpatiaLite::PointBatch * makePoints(int srid,
+                                                   const double * x,
+                                                   const double * y,
+                                                   int count,
+                                                   const double * z = 0,
+                                                   const double * m = 0);
+
     };
 
 }
@@ -0,0 +1,127 @@
+/**
+ * @file    PointBatch.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main PointBatch class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/Buffer.hpp"
+
+#include <string>
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class SpatialDatabase;
+
+    /**
+     * Point batch buffer data type
+     */
+    typedef unsigned char * PointBatchType;
+
+    /**
+     * @brief RAII management of an arena of fixed-size point BLOB-Geometry
+     *        records.
+     * @details All records share the SRID and dimension model of the batch,
+     *          so record i starts at get() + i * getRecordSize(). Each record
+     *          is byte-for-byte what gaiaMakePoint (or its Z/M/ZM variants)
+     *          produces for the same point on this host.
+     */
+    class SPATIALITECPP_ABI PointBatch : public BufferSized<PointBatchType>
+    {
+
+    public:
+
+        /**
+         * @brief Encodes points into a single arena.
+         * @param[in] srid  Coordinate reference system code
+         * @param[in] x     Point x-coordinates
+         * @param[in] y     Point y-coordinates
+         * @param[in] count Number of points
+         * @param[in] z     Point z-coordinates (optional)
+         * @param[in] m     Point measurements (optional)
+         * @returns New PointBatch pointer. Records are of type Point,
+         *          PointZ, PointM or PointZM depending on which optional
+         *          arrays are provided.
+         * @throws std::runtime_error on failure, or if the records would
+         *         take more than INT_MAX bytes
+         * @warning Caller must delete pointer. Should be owned by a
+         *          PointBatchPtr.
+         */
+        static PointBatch * create(int srid,
+                                   const double * x,
+                                   const double * y,
+                                   int count,
+                                   const double * z = 0,
+                                   const double * m = 0);
+
+        /**
+         * @param[in] index Record index
+         * @returns Pointer to the start of a record
+         */
+        const unsigned char * getBlob(int index) const;
+
+        /**
+         * @returns Number of records
+         */
+        int getCount() const;
+
+        /**
+         * @returns Size of each record in bytes
+         */
+        int getRecordSize() const;
+
+        /**
+         * @brief Inserts every record through a single prepared statement.
+         * @details Records are bound without copying. The inserts run inside
+         *          a transaction unless one is already open on the
+         *          connection.
+         * @param[in] database Target spatial database
+         * @param[in] sql      INSERT statement with a blob parameter, e.g.
+         *                     "INSERT INTO gps (geom) VALUES (?)"
+         * @param[in] column   1-based index of the blob parameter
+         * @returns Number of inserted records
+         * @throws std::runtime_error on failure
+         */
+        int insert(SpatialDatabase const & database,
+                   std::string const & sql,
+                   int column = 1) const;
+
+        /**
+         * Cleans up PointBatch arena memory
+         * @param[in] buffer Arena.
+         */
+        static void clean(PointBatchType buffer);
+
+    private:
+
+        /**
+         * @brief Takes ownership of an arena
+         * @param[in] arena  Record arena
+         * @param[in] count  Number of records
+         * @param[in] record Size of each record
+         */
+        PointBatch(PointBatchType arena, int count, int record);
+
+        /**
+         * @brief Number of records
+         */
+        int _count;
+
+        /**
+         * @brief Size of each record
+         */
+        int _record;
+
+    };
+
+}
@@ -0,0 +1,240 @@
+/**
+ * @file    PointClassifier.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main PointClassifier class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <cstddef>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class CoordinateBuffer;
+
+    /**
+     * @brief Batch point-in-polygon classifier over a set of zones.
+     * @details The polygon edges of every zone are bucketed once into a
+     *          uniform grid. Cells crossed by no edge store their zone
+     *          directly; points in the other cells run an even-odd crossing
+     *          test against the edges of their grid row, stored as
+     *          structure-of-arrays and evaluated with the SSE2 or AVX2
+     *          kernel selected by Measure::getInstructionSet() when the
+     *          classifier is built. Holes and multipolygons follow from the
+     *          even-odd rule. Points on a boundary may fall on either side.
+     *          Overlapping zones resolve to the first one. Classification
+     *          is read-only and may run on several threads.
+     */
+    class SPATIALITECPP_ABI PointClassifier : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Indexes zones identified by their position
+         * @param[in] zones      Zone geometries, only polygons are used
+         * @param[in] resolution Grid cells per axis, 0 to derive it from the
+         *                       number of edges
+         * @throws std::runtime_error on failure
+         */
+        explicit PointClassifier(std::vector<gaiaGeomCollPtr> const & zones,
+                                 int resolution = 0);
+
+        /**
+         * @brief Indexes zones with explicit identifiers
+         * @param[in] zones      Zone geometries, only polygons are used
+         * @param[in] ids        Identifier of each zone
+         * @param[in] resolution Grid cells per axis, 0 to derive it from the
+         *                       number of edges
+         * @throws std::runtime_error on failure
+         */
+        PointClassifier(std::vector<gaiaGeomCollPtr> const & zones,
+                        std::vector<int> const & ids,
+                        int resolution = 0);
+
+        /**
+         * @brief Releases the index
+         */
+        ~PointClassifier();
+
+        /**
+         * @brief Classifies one point
+         * @param[in] x Point x-coordinate
+         * @param[in] y Point y-coordinate
+         * @returns Zone identifier or -1 outside every zone
+         */
+        int classify(double x, double y) const;
+
+        /**
+         * @brief Classifies structure-of-arrays points
+         * @param[in] x       Point x-coordinates
+         * @param[in] y       Point y-coordinates
+         * @param[in] count   Number of points
+         * @param[in] threads Number of threads, 0 for the hardware count
+         * @returns Zone identifier per point or -1 outside every zone
+         */
+        std::vector<int> classify(const double * x,
+                                  const double * y,
+                                  size_t count,
+                                  int threads = 0) const;
+
+        /**
+         * @brief Classifies the points of a coordinate buffer
+         * @param[in] points  Points to classify
+         * @param[in] threads Number of threads, 0 for the hardware count
+         * @returns Zone identifier per point or -1 outside every zone
+         */
+        std::vector<int> classify(CoordinateBuffer const & points,
+                                  int threads = 0) const;
+
+        /**
+         * @returns Number of indexed polygon edges
+         */
+        int getEdgeCount() const;
+
+        /**
+         * @returns Fraction of grid cells that need a crossing test
+         */
+        double getMixedRatio() const;
+
+        /**
+         * @returns Grid cells per axis
+         */
+        int getResolution() const;
+
+        /**
+         * @returns Number of zones
+         */
+        int getZoneCount() const;
+
+    private:
+
+        // Disallow copying and assignment
+        PointClassifier & operator=(const PointClassifier &);
+        PointClassifier(const PointClassifier &);
+
+        /**
+         * @brief Edges of one zone within one grid row
+         */
+        struct Run
+        {
+            int zone;     ///< Zone index
+            int begin;    ///< First edge
+            int end;      ///< One past the last edge
+            double maxx;  ///< Largest x of the edges
+        };
+
+        /**
+         * @brief Counts the edges crossed by the ray from (px, py) towards +x
+         */
+        typedef int (*Crossings)(const double * x0,
+                                 const double * y0,
+                                 const double * y1,
+                                 const double * slope,
+                                 int n,
+                                 double px,
+                                 double py);
+
+        /**
+         * @brief Builds the index
+         * @param[in] zones      Zone geometries
+         * @param[in] resolution Requested grid resolution
+         */
+        void build(std::vector<gaiaGeomCollPtr> const & zones,
+                   int resolution);
+
+        /**
+         * @brief Classifies a point by crossing tests over its grid row
+         * @param[in] x   Point x-coordinate
+         * @param[in] y   Point y-coordinate
+         * @param[in] row Grid row of the point
+         * @returns Zone index or -1
+         */
+        int locate(double x, double y, int row) const;
+
+        /**
+         * @brief Cell value: zone index, -1 for none or -2 when mixed
+         */
+        std::vector<int> _cells;
+
+        /**
+         * @brief Grid cell height
+         */
+        double _cellHeight;
+
+        /**
+         * @brief Grid cell width
+         */
+        double _cellWidth;
+
+        /**
+         * @brief Crossing kernel of the instruction set at construction
+         */
+        Crossings _crossings;
+
+        /**
+         * @brief Slope dx/dy of each edge
+         */
+        std::vector<double> _edgeSlope;
+
+        /**
+         * @brief Start x-coordinate of each edge
+         */
+        std::vector<double> _edgeX0;
+
+        /**
+         * @brief Start y-coordinate of each edge
+         */
+        std::vector<double> _edgeY0;
+
+        /**
+         * @brief End y-coordinate of each edge
+         */
+        std::vector<double> _edgeY1;
+
+        /**
+         * @brief Number of distinct polygon edges
+         */
+        int _edges;
+
+        /**
+         * @brief Zone identifiers
+         */
+        std::vector<int> _ids;
+
+        /**
+         * @brief Grid extent
+         */
+        double _maxx, _maxy, _minx, _miny;
+
+        /**
+         * @brief Grid cells per axis
+         */
+        int _resolution;
+
+        /**
+         * @brief First run of each grid row, plus the end
+         */
+        std::vector<int> _rowRuns;
+
+        /**
+         * @brief Edge runs of all rows
+         */
+        std::vector<Run> _runs;
+
+    };
+
+}
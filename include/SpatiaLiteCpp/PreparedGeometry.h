@@ -0,0 +1,178 @@
+/**
+ * @file    PreparedGeometry.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main PreparedGeometry class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <memory>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief GEOS prepared geometry for repeated predicate evaluation.
+     * @details The left-hand geometry is converted and prepared (edge index,
+     *          point-in-polygon locator) once per thread instead of on every
+     *          call as gaiaGeomCollTouches and friends do. Each calling
+     *          thread lazily gets its own reentrant GEOS context and prepared
+     *          state, so one object can be shared read-only across threads.
+     *          Threads keep the states of the last few objects they used
+     *          without locking, and hand them back to the object when they
+     *          move on or exit, so idle states are reused by other threads
+     *          rather than accumulated per thread.
+     */
+    class SPATIALITECPP_ABI PreparedGeometry : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Spatial predicates
+         */
+        enum Predicate
+        {
+            CONTAINS = 0,          ///< Prepared contains candidate
+            CONTAINS_PROPERLY = 1, ///< Contains without boundary contact
+            COVERED_BY = 2,        ///< Prepared is covered by candidate
+            COVERS = 3,            ///< Prepared covers candidate
+            CROSSES = 4,           ///< Geometries cross
+            DISJOINT = 5,          ///< Geometries do not intersect
+            INTERSECTS = 6,        ///< Geometries intersect
+            OVERLAPS = 7,          ///< Geometries overlap
+            TOUCHES = 8,           ///< Geometries only share boundary points
+            WITHIN = 9             ///< Prepared is within candidate
+        };
+
+        /**
+         * @brief Copies a geometry for preparation
+         * @param[in] geometry Left-hand geometry of the predicates
+         * @throws std::runtime_error on failure
+         */
+        explicit PreparedGeometry(gaiaGeomCollPtr geometry);
+
+        /**
+         * @brief Releases the idle GEOS states. States still held by a
+         *        thread are released when the thread drops them.
+         */
+        ~PreparedGeometry();
+
+        /**
+         * @param[in] candidate Right-hand geometry
+         * @returns True if the prepared geometry contains the candidate
+         * @throws std::runtime_error on failure
+         */
+        bool contains(gaiaGeomCollPtr candidate) const;
+
+        /**
+         * @param[in] candidate Right-hand geometry
+         * @returns True if the prepared geometry covers the candidate
+         * @throws std::runtime_error on failure
+         */
+        bool covers(gaiaGeomCollPtr candidate) const;
+
+        /**
+         * @brief Evaluates a predicate against a candidate
+         * @param[in] predicate Predicate enumeration value
+         * @param[in] candidate Right-hand geometry
+         * @returns Predicate result
+         * @throws std::runtime_error on failure
+         */
+        bool evaluate(int predicate, gaiaGeomCollPtr candidate) const;
+
+        /**
+         * @brief Evaluates a predicate against many candidates
+         * @param[in] predicate  Predicate enumeration value
+         * @param[in] candidates Right-hand geometries
+         * @returns One result per candidate, in order
+         * @throws std::runtime_error on failure
+         */
+        std::vector<bool> evaluate(
+            int predicate,
+            std::vector<gaiaGeomCollPtr> const & candidates) const;
+
+        /**
+         * @returns Number of GEOS states prepared, at most the number of
+         *          threads that used the object at the same time
+         */
+        int getThreadCount() const;
+
+        /**
+         * @param[in] candidate Right-hand geometry
+         * @returns True if the geometries intersect
+         * @throws std::runtime_error on failure
+         */
+        bool intersects(gaiaGeomCollPtr candidate) const;
+
+        /**
+         * @param[in] candidate Right-hand geometry
+         * @returns True if the geometries touch
+         * @throws std::runtime_error on failure
+         */
+        bool touches(gaiaGeomCollPtr candidate) const;
+
+        /**
+         * @param[in] candidate Right-hand geometry
+         * @returns True if the prepared geometry is within the candidate
+         * @throws std::runtime_error on failure
+         */
+        bool within(gaiaGeomCollPtr candidate) const;
+
+    private:
+
+        // Disallow copying and assignment
+        PreparedGeometry & operator=(const PreparedGeometry &);
+        PreparedGeometry(const PreparedGeometry &);
+
+        /**
+         * @brief GEOS state used by one thread at a time
+         */
+        struct State;
+
+        /**
+         * @brief States of one object, shared with the threads holding them
+         */
+        struct Pool;
+
+        /**
+         * @brief States held by one thread
+         */
+        struct Cache;
+
+        /**
+         * @returns GEOS state of the calling thread
+         * @throws std::runtime_error on failure
+         */
+        State * getState() const;
+
+        /**
+         * @returns New GEOS context and prepared geometry
+         * @throws std::runtime_error on failure
+         */
+        State * prepare() const;
+
+        /**
+         * @brief States of this object
+         */
+        std::shared_ptr<Pool> _pool;
+
+        /**
+         * @brief WKB of the prepared geometry
+         */
+        std::vector<unsigned char> _wkb;
+
+    };
+
+}
@@ -0,0 +1,240 @@
+/**
+ * @file    Reprojector.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main Reprojector class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class CoordinateBuffer;
+    class GeometryCollection;
+    class SpatialDatabase;
+
+    /**
+     * @brief Coordinate transformation between two SRIDs, built once.
+     * @details The proj4text definitions of both SRIDs are read from
+     *          spatial_ref_sys when the object is created, and PROJ builds
+     *          the transformation once instead of per row as SQL Transform()
+     *          does. PROJ objects are not thread-safe, so each chunk checks a
+     *          worker with its own PROJ context and clone of the
+     *          transformation out of a pool, which grows when concurrent
+     *          calls find every worker busy. WGS 84 (4326) to and from Web
+     *          Mercator (3857) is computed in closed form without PROJ, and
+     *          like PROJ sets latitudes at the poles to HUGE_VAL. Coordinates are
+     *          transformed in place, and batches larger than a chunk are
+     *          split over threads. Longitudes and latitudes are in degrees.
+     *          Transformations may be called concurrently on the same
+     *          object.
+     */
+    class SPATIALITECPP_ABI Reprojector : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Builds the transformation between two SRIDs
+         * @param[in] database   Spatial database holding spatial_ref_sys
+         * @param[in] sourceSrid Source SRID
+         * @param[in] targetSrid Target SRID
+         * @param[in] threads    Number of workers. Zero uses the hardware
+         *                       concurrency.
+         * @param[in] chunkSize  Number of points, or geometries, per chunk
+         * @throws std::runtime_error if an SRID is unknown or PROJ fails
+         */
+        Reprojector(SpatialDatabase const & database,
+                    int sourceSrid,
+                    int targetSrid,
+                    int threads = 0,
+                    int chunkSize = 4096);
+
+        /**
+         * @brief Destructor
+         */
+        ~Reprojector();
+
+        /**
+         * @returns Number of points, or geometries, per chunk
+         */
+        int getChunkSize() const;
+
+        /**
+         * @returns Source SRID
+         */
+        int getSourceSrid() const;
+
+        /**
+         * @returns Target SRID
+         */
+        int getTargetSrid() const;
+
+        /**
+         * @returns Number of workers
+         */
+        int getThreadCount() const;
+
+        /**
+         * @brief Transforms coordinate arrays in place
+         * @details Points that cannot be transformed are set to HUGE_VAL.
+         * @param[in,out] x     X-coordinates
+         * @param[in,out] y     Y-coordinates
+         * @param[in,out] z     Z-coordinates, or null
+         * @param[in]     count Number of points
+         * @throws std::runtime_error on failure
+         */
+        void transform(double * x, double * y, double * z, size_t count);
+
+        /**
+         * @brief Transforms a coordinate buffer in place
+         * @param[in,out] buffer Coordinate buffer, with Z if it has one
+         * @throws std::runtime_error on failure
+         */
+        void transform(CoordinateBuffer & buffer);
+
+        /**
+         * @brief Transforms a geometry in place
+         * @details The SRID and the MBR are updated.
+         * @param[in,out] geometry Geometry
+         * @throws std::runtime_error on failure
+         */
+        void transform(gaiaGeomCollPtr geometry);
+
+        /**
+         * @brief Transforms a geometry collection in place
+         * @param[in,out] geometry Geometry collection
+         * @throws std::runtime_error on failure
+         */
+        void transform(GeometryCollection & geometry);
+
+        /**
+         * @brief Transforms a batch of geometries in place
+         * @param[in,out] geometries Geometries, null entries skipped
+         * @throws std::runtime_error on failure
+         */
+        void transform(std::vector<gaiaGeomCollPtr> const & geometries);
+
+    private:
+
+        // Disallow copying and assignment
+        Reprojector & operator=(const Reprojector &);
+        Reprojector(const Reprojector &);
+
+        /**
+         * @brief Per-worker PROJ context and transformation
+         */
+        struct Worker;
+
+        /**
+         * @brief Worker checked out of the pool for a scope
+         */
+        struct Checkout;
+
+        /**
+         * @brief Transformation kinds
+         */
+        enum Kind
+        {
+            IDENTITY,       ///< Same SRID
+            TO_MERCATOR,    ///< WGS 84 to Web Mercator
+            FROM_MERCATOR,  ///< Web Mercator to WGS 84
+            PROJ            ///< Any other pair
+        };
+
+        /**
+         * @brief Transforms strided coordinates on one worker
+         * @param[in]     worker Checked out worker, null unless the kind is
+         *                       PROJ
+         * @param[in,out] x      X-coordinates
+         * @param[in,out] y      Y-coordinates
+         * @param[in,out] z      Z-coordinates, or null
+         * @param[in]     stride Distance between points in doubles
+         * @param[in]     count  Number of points
+         * @throws std::runtime_error if PROJ fails
+         */
+        void run(Worker * worker,
+                 double * x,
+                 double * y,
+                 double * z,
+                 int stride,
+                 size_t count);
+
+        /**
+         * @brief Transforms every part of a geometry on one worker
+         * @param[in]     worker   Checked out worker, null unless the kind
+         *                         is PROJ
+         * @param[in,out] geometry Geometry
+         * @throws std::runtime_error if PROJ fails
+         */
+        void run(Worker * worker, gaiaGeomCollPtr geometry);
+
+        /**
+         * @brief Number of points, or geometries, per chunk
+         */
+        int _chunkSize;
+
+        /**
+         * @brief Workers not checked out
+         */
+        std::vector<Worker *> _idle;
+
+        /**
+         * @brief Transformation kind
+         */
+        int _kind;
+
+        /**
+         * @brief Guards the worker pool
+         */
+        std::mutex _mutex;
+
+        /**
+         * @brief Source proj4text definition
+         */
+        std::string _source;
+
+        /**
+         * @brief Source SRID
+         */
+        int _sourceSrid;
+
+        /**
+         * @brief Target proj4text definition
+         */
+        std::string _target;
+
+        /**
+         * @brief Target SRID
+         */
+        int _targetSrid;
+
+        /**
+         * @brief Number of workers
+         */
+        int _threads;
+
+        /**
+         * @brief All workers, empty unless the kind is PROJ
+         */
+        std::vector<Worker *> _workers;
+
+    };
+
+}
@@ -36,6 +36,18 @@ namespace SpatiaLite
          */
         explicit Shapefile(ShapefileType shapefile);
 
+        /**
+         * @brief Reads a single record of an opened shapefile.
+         * @details Random access counterpart of iterating gaiaReadShpEntity
+         *          so that only the records returned by a ShapefileIndex
+         *          window query need to be read.
+         * @param[in] row  Zero-based record number
+         * @param[in] srid SRID assigned to the record geometry
+         * @returns True if the record was read into get()->Dbf otherwise
+         *          false (past the last record, deleted record or error)
+         */
+        bool readEntity(int row, int srid);
+
     };
 
 }
@@ -0,0 +1,170 @@
+/**
+ * @file    ShapefileIndex.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main ShapefileIndex class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+#include <string>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief Quadtree spatial index over the records of a shapefile.
+     * @details The index is built from the record headers of the .shp file
+     *          (located through the .shx file) so no geometry is decoded. It
+     *          is persisted next to the shapefile as a ".sqx" sidecar and
+     *          answers window queries with the zero-based record numbers
+     *          expected by gaiaReadShpEntity().
+     */
+    class SPATIALITECPP_ABI ShapefileIndex : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Builds the index of a shapefile and writes its sidecar.
+         * @details Failing to write the sidecar is not an error; the index
+         *          is then only held in memory.
+         * @param[in] path  Shapefile path without extension (same convention
+         *                  as gaiaOpenShpRead)
+         * @param[in] depth Maximum quadtree depth. If zero or negative a
+         *                  depth is derived from the number of records.
+         * @returns New ShapefileIndex pointer
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer.
+         *          Should be owned by a ShapefileIndexPtr.
+         */
+        static ShapefileIndex * create(std::string const & path,
+                                       int depth = 0);
+
+        /**
+         * @brief Loads the sidecar index of a shapefile.
+         * @details The index is rebuilt (and the sidecar rewritten) if the
+         *          sidecar is missing, malformed or no longer matches the
+         *          shapefile.
+         * @param[in] path Shapefile path without extension
+         * @returns New ShapefileIndex pointer
+         * @throws std::runtime_error on failure
+         * @warning Caller must delete pointer.
+         *          Should be owned by a ShapefileIndexPtr.
+         */
+        static ShapefileIndex * open(std::string const & path);
+
+        /**
+         * @returns Maximum depth of the quadtree
+         */
+        int getDepth() const;
+
+        /**
+         * @returns Number of records in the indexed shapefile
+         */
+        int getCount() const;
+
+        /**
+         * @brief Finds the records whose MBR intersects a window.
+         * @param[in] minx Window minimum x-coordinate
+         * @param[in] miny Window minimum y-coordinate
+         * @param[in] maxx Window maximum x-coordinate
+         * @param[in] maxy Window maximum y-coordinate
+         * @returns Zero-based record numbers in ascending (file) order
+         */
+        std::vector<int> query(double minx,
+                               double miny,
+                               double maxx,
+                               double maxy) const;
+
+        /**
+         * @brief Writes the index to a sidecar file.
+         * @param[in] filename Sidecar file name
+         * @throws std::runtime_error on failure
+         */
+        void save(std::string const & filename) const;
+
+        /**
+         * @brief Sidecar file name of a shapefile
+         * @param[in] path Shapefile path without extension
+         * @returns Sidecar file name
+         */
+        static std::string getSidecar(std::string const & path);
+
+    private:
+
+        /**
+         * @brief Quadtree node stored in a flat array.
+         */
+        struct Node
+        {
+            /**
+             * @brief Node bounds (minx, miny, maxx, maxy)
+             */
+            double bounds[4];
+
+            /**
+             * @brief Index of the first record number in _entries
+             */
+            int first;
+
+            /**
+             * @brief Number of record numbers held by this node
+             */
+            int count;
+
+            /**
+             * @brief Indices of the child nodes or -1 if absent
+             */
+            int children[4];
+        };
+
+        /**
+         * @brief Creates an empty index
+         */
+        ShapefileIndex();
+
+        /**
+         * @brief Reads a sidecar file.
+         * @param[in] filename Sidecar file name
+         * @returns True if the sidecar was read otherwise false.
+         */
+        bool load(std::string const & filename);
+
+        /**
+         * @brief Maximum quadtree depth
+         */
+        int _depth;
+
+        /**
+         * @brief Size in bytes of the .shp file that was indexed
+         */
+        long long _size;
+
+        /**
+         * @brief Modification time of the .shp file that was indexed
+         */
+        long long _time;
+
+        /**
+         * @brief Record MBRs (minx, miny, maxx, maxy) by record number
+         */
+        std::vector<double> _bounds;
+
+        /**
+         * @brief Record numbers referenced by the nodes
+         */
+        std::vector<int> _entries;
+
+        /**
+         * @brief Quadtree nodes. The root is the first node.
+         */
+        std::vector<Node> _nodes;
+
+    };
+
+}
@@ -15,23 +15,52 @@
 // Include useful headers of SpatiaLiteC++
 #include "SpatiaLiteCpp/Auxiliary.h"
 #include "SpatiaLiteCpp/Blob.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
 #include "SpatiaLiteCpp/Buffer.hpp"
 #include "SpatiaLiteCpp/Checksum.h"
 #include "SpatiaLiteCpp/Converter.h"
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
 #include "SpatiaLiteCpp/Dbf.h"
 #include "SpatiaLiteCpp/DbfField.h"
 #include "SpatiaLiteCpp/DbfList.h"
 #include "SpatiaLiteCpp/DynamicLine.h"
 #include "SpatiaLiteCpp/ExifTagList.h"
+#include "SpatiaLiteCpp/FeatureWriter.h"
+#include "SpatiaLiteCpp/FlatGeobuf.h"
+#include "SpatiaLiteCpp/GeoJsonExporter.h"
+#include "SpatiaLiteCpp/GeoParquetExporter.h"
+#include "SpatiaLiteCpp/GeoParquetScanner.h"
+#include "SpatiaLiteCpp/GeometryArena.h"
+#include "SpatiaLiteCpp/GeometryCache.h"
 #include "SpatiaLiteCpp/GeometryCollection.h"
+#if SPATIALITECPP_USE_GEOS
+#include "SpatiaLiteCpp/GeometryWorkerPool.h"
+#endif
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/LevelOfDetail.h"
 #include "SpatiaLiteCpp/LineString.h"
+#include "SpatiaLiteCpp/Measure.h"
 #include "SpatiaLiteCpp/OutputBuffer.h"
+#include "SpatiaLiteCpp/OutputBufferPool.h"
+#include "SpatiaLiteCpp/PackedRTree.h"
 #include "SpatiaLiteCpp/Point.h"
+#include "SpatiaLiteCpp/PointBatch.h"
+#include "SpatiaLiteCpp/PointClassifier.h"
 #include "SpatiaLiteCpp/Polygon.h"
+#if SPATIALITECPP_USE_GEOS
+#include "SpatiaLiteCpp/PreparedGeometry.h"
+#endif
+#if SPATIALITECPP_USE_PROJ
+#include "SpatiaLiteCpp/Reprojector.h"
+#endif
 #include "SpatiaLiteCpp/Ring.h"
 #include "SpatiaLiteCpp/Shapefile.h"
+#include "SpatiaLiteCpp/ShapefileIndex.h"
 #include "SpatiaLiteCpp/SpatialDatabase.h"
+#include "SpatiaLiteCpp/TilePyramid.h"
+#include "SpatiaLiteCpp/UniqueBuffer.hpp"
 #include "SpatiaLiteCpp/VectorLayersList.h"
+#include "SpatiaLiteCpp/VectorTileEncoder.h"
 #include "SpatiaLiteCpp/WfsCatalog.h"
 #include "SpatiaLiteCpp/WfsSchema.h"
 #include "SpatiaLiteCpp/XmlBlob.h"
@@ -40,13 +69,15 @@
 /**
  * @def SPATIALITECPP_PTRTYPE
  * @brief Determines which pointer type to use
- * @details Defined values:
+ * @details Defaults to 1 in IntrusivePtr.hpp. Defined values:
  *     - 0 = Raw pointer (Caller handles memory deallocation.
  *           Should define SPATIALITECPP_PTR to a custom smart pointer.)
  *     - 1 = SRombauts/shared_ptr
  *     - 2 = std::tr1::shared_ptr
  *     - 3 = std::shared_ptr (C++11)
  *     - 4 = boost::shared_ptr
+ *     - 5 = SpatiaLite::IntrusivePtr (Count embedded in the object. See
+ *           SPATIALITECPP_REFCOUNT_ATOMIC.)
  */
 /**
  * @def SPATIALITECPP_PTR(x)
@@ -54,9 +85,6 @@
  * @details Should be defined if SPATIALITECPP_PTRTYPE = 0. For example,
  * @code #define SPATIALITECPP_PTR(x) std::shared_ptr<x> @endcode
  */
-#ifndef SPATIALITECPP_PTRTYPE
-    #define SPATIALITECPP_PTRTYPE 1
-#endif
 #if SPATIALITECPP_PTRTYPE == 1
     #include "shared_ptr.hpp"
     #define SPATIALITECPP_PTR(x) shared_ptr<x>
@@ -69,6 +97,8 @@
 #elif SPATIALITECPP_PTRTYPE == 4
     #include "boost/shared_ptr.hpp"
     #define SPATIALITECPP_PTR(x) boost::shared_ptr<x>
+#elif SPATIALITECPP_PTRTYPE == 5
+    #define SPATIALITECPP_PTR(x) SpatiaLite::IntrusivePtr<x>
 #else
     #ifndef SPATIALITECPP_PTR
         #define SPATIALITECPP_PTR(x) x*
@@ -85,6 +115,10 @@ namespace SpatiaLite
      * Blob buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::Blob) BlobPtr;
+    /**
+     * BlobEncoding pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::BlobEncoding) BlobEncodingPtr;
     /**
      * Checksum buffer pointer
      */
@@ -93,6 +127,10 @@ namespace SpatiaLite
      * Converter buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::Converter) ConverterPtr;
+    /**
+     * Coordinate buffer pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::CoordinateBuffer) CoordinateBufferPtr;
     /**
      * DBF buffer pointer
      */
@@ -113,14 +151,52 @@ namespace SpatiaLite
      * EXIF Tag List buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::ExifTagList) ExifTagListPtr;
+    /**
+     * FeatureWriter pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::FeatureWriter) FeatureWriterPtr;
+    /**
+     * FlatGeobuf pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::FlatGeobuf) FlatGeobufPtr;
+    /**
+     * GeoJsonExporter pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::GeoJsonExporter) GeoJsonExporterPtr;
+    /**
+     * GeoParquetExporter pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::GeoParquetExporter) GeoParquetExporterPtr;
+    /**
+     * GeoParquetScanner pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::GeoParquetScanner) GeoParquetScannerPtr;
     /**
      * Geometry buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::GeometryBuffer) GeometryBufferPtr;
+    /**
+     * GeometryArena pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::GeometryArena) GeometryArenaPtr;
+    /**
+     * GeometryCache pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::GeometryCache) GeometryCachePtr;
     /**
      * Geometry Collection buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::GeometryCollection) GeometryCollectionPtr;
+#if SPATIALITECPP_USE_GEOS
+    /**
+     * GeometryWorkerPool pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::GeometryWorkerPool) GeometryWorkerPoolPtr;
+#endif
+    /**
+     * LevelOfDetail pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::LevelOfDetail) LevelOfDetailPtr;
     /**
      * Line String buffer pointer
      */
@@ -129,14 +205,43 @@ namespace SpatiaLite
      * Output Buffer buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::OutputBuffer) OutputBufferPtr;
+    /**
+     * OutputBufferPool pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::OutputBufferPool) OutputBufferPoolPtr;
+    /**
+     * PackedRTree pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::PackedRTree) PackedRTreePtr;
     /**
      * Point buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::Point) PointPtr;
+
+    /**
+     * PointBatch buffer pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::PointBatch) PointBatchPtr;
+    /**
+     * PointClassifier pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::PointClassifier) PointClassifierPtr;
     /**
      * Polygon buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::Polygon) PolygonPtr;
+#if SPATIALITECPP_USE_GEOS
+    /**
+     * PreparedGeometry pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::PreparedGeometry) PreparedGeometryPtr;
+#endif
+#if SPATIALITECPP_USE_PROJ
+    /**
+     * Reprojector pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::Reprojector) ReprojectorPtr;
+#endif
     /**
      * Ring buffer pointer
      */
@@ -145,14 +250,26 @@ namespace SpatiaLite
      * Shapefile buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::Shapefile) ShapefilePtr;
+    /**
+     * Shapefile Index pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::ShapefileIndex) ShapefileIndexPtr;
     /**
      * Spatial Database buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::SpatialDatabase) SpatialDatabasePtr;
+    /**
+     * TilePyramid pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::TilePyramid) TilePyramidPtr;
     /**
      * Vector Layers List buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::VectorLayersList) VectorLayersListPtr;
+    /**
+     * VectorTileEncoder pointer
+     */
+    typedef SPATIALITECPP_PTR(SpatiaLite::VectorTileEncoder) VectorTileEncoderPtr;
     /**
      * WFS Catalog buffer pointer
      */
@@ -169,6 +286,26 @@ namespace SpatiaLite
      * XMl Document buffer pointer
      */
     typedef SPATIALITECPP_PTR(SpatiaLite::XmlDocument) XmlDocumentPtr;
+
+    /**
+     * @brief Creates a wrapper owned by the configured pointer type.
+     * @details Object and reference count share one allocation with
+     *          std::shared_ptr (make_shared) and IntrusivePtr.
+     * @param[in] args Constructor arguments
+     * @returns New wrapper pointer
+     */
+    template <class T, class... Args>
+    SPATIALITECPP_PTR(T) makePtr(Args &&... args)
+    {
+#if SPATIALITECPP_PTRTYPE == 3
+        return std::make_shared<T>(std::forward<Args>(args)...);
+#elif SPATIALITECPP_PTRTYPE == 5
+        return makeIntrusive<T>(std::forward<Args>(args)...);
+#else
+        SPATIALITECPP_PTR(T) pointer(new T(std::forward<Args>(args)...));
+        return pointer;
+#endif
+    }
 }
 
 #include "SQLiteCpp/SQLiteCpp.h"
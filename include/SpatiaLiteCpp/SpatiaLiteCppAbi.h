@@ -31,3 +31,29 @@
 #else
     #define SPATIALITECPP_ABI
 #endif
+
+/**
+ * @def SPATIALITECPP_USE_GEOS
+ * @brief Determines whether the classes built on the GEOS C API exist
+ * @details Defined values:
+ *     - 0 = Left out (CMake option SPATIALITECPP_USE_GEOS off)
+ *     - 1 = Built (default)
+ *
+ *     Must be the same when building and using the library.
+ */
+#ifndef SPATIALITECPP_USE_GEOS
+    #define SPATIALITECPP_USE_GEOS 1
+#endif
+
+/**
+ * @def SPATIALITECPP_USE_PROJ
+ * @brief Determines whether the classes built on the PROJ API exist
+ * @details Defined values:
+ *     - 0 = Left out (CMake option SPATIALITECPP_USE_PROJ off)
+ *     - 1 = Built (default)
+ *
+ *     Must be the same when building and using the library.
+ */
+#ifndef SPATIALITECPP_USE_PROJ
+    #define SPATIALITECPP_USE_PROJ 1
+#endif
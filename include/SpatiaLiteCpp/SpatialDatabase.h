@@ -7,10 +7,12 @@
  */
 #pragma once
 
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
 #include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
 
 #include "sqlite3.h"
 
+#include <cfloat>
 #include <string>
 #include <vector>
 
@@ -26,7 +28,7 @@ namespace SpatiaLite
     /**
      * @brief RAII management of a Spatialite Database Connection.
      */
-    class SPATIALITECPP_ABI SpatialDatabase
+    class SPATIALITECPP_ABI SpatialDatabase : public PtrBase
     {
 
     public:
@@ -107,6 +109,15 @@ namespace SpatiaLite
          */
         SQLite::Database * getDatabase() const;
 
+        /**
+         * @brief Reads PRAGMA data_version through a statement prepared once
+         *        per connection.
+         * @returns Data version, which changes when another connection
+         *          commits
+         * @throws std::runtime_error on failure
+         */
+        sqlite3_int64 getDataVersion() const;
+
         /**
          * @brief Get geometry type as string.
          * @param[in] type SpatiaLite type (GAIA_XXXX)
@@ -121,6 +132,12 @@ namespace SpatiaLite
          */
         std::vector<std::string> getHeaders(const std::string & name) const;
 
+        /**
+         * @returns Identifier of the connection, never reused by another
+         *          SpatialDatabase of the process
+         */
+        sqlite3_int64 getId() const;
+
         /**
          * @brief Get table types
          * @param[in] name Table name
@@ -128,6 +145,39 @@ namespace SpatiaLite
          */
         std::vector<std::string> getTypes(const std::string & name) const;
 
+        /**
+         * @brief Result of a nearest neighbour search
+         */
+        struct Neighbor
+        {
+            sqlite3_int64 id;  ///< Row identifier
+            double distance;   ///< Planar distance to the query point
+        };
+
+        /**
+         * @brief Finds the k geometries nearest to a point.
+         * @details Best-first traversal of the SpatiaLite R*Tree of the
+         *          column, reading its nodes directly from the idx_<table>_
+         *          <geometry>_node shadow table. Index boxes give lower
+         *          bounds; candidates are refined with the exact planar
+         *          distance of Measure::getDistance() before being reported,
+         *          so only rows near the point are decoded.
+         * @param[in] table       Table name
+         * @param[in] geometry    Geometry column with a spatial index
+         * @param[in] x           Query x-coordinate
+         * @param[in] y           Query y-coordinate
+         * @param[in] k           Maximum number of neighbours
+         * @param[in] maxDistance Search radius
+         * @returns Neighbours ordered by increasing distance
+         * @throws std::runtime_error if the spatial index is missing
+         */
+        std::vector<Neighbor> nearest(const std::string & table,
+                                      const std::string & geometry,
+                                      double x,
+                                      double y,
+                                      int k,
+                                      double maxDistance = DBL_MAX) const;
+
         /**
          * @brief Sanitizes all Geometry Columns making all invalid geometries
          *        to be valid.
@@ -202,6 +252,16 @@ private:
          */
         SQLite::Database * _database;
 
+        /**
+         * Connection identifier
+         */
+        sqlite3_int64 _id;
+
+        /**
+         * PRAGMA data_version statement, or null until first used
+         */
+        mutable sqlite3_stmt * _versionQuery;
+
     };
 
 }
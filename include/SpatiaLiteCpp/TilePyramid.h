@@ -0,0 +1,180 @@
+/**
+ * @file    TilePyramid.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main TilePyramid class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+#include "SpatiaLiteCpp/VectorTileEncoder.h"
+
+#include <string>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class SpatialDatabase;
+
+    /**
+     * @brief Batch generation of a vector tile pyramid into an MBTiles file.
+     * @details The tiles of a zoom range that cover a Web Mercator box are
+     *          found by walking the pyramid depth-first from zoom 0 and
+     *          probing the R*Tree spatial index, so the children of an
+     *          empty tile are never visited. Worker threads take the
+     *          non-empty tiles from the walk as it goes, encode them with
+     *          their own connection, prepared layer query and
+     *          VectorTileEncoder, and hash them with an MD5 Checksum. A single writer thread stores
+     *          them in batched transactions using the deduplicated MBTiles
+     *          layout (map and images tables behind a tiles view), so
+     *          identical tiles such as open ocean are stored once. Tiles
+     *          are stored uncompressed.
+     */
+    class SPATIALITECPP_ABI TilePyramid : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Creates a pyramid job
+         * @param[in] minZoom Lowest zoom level
+         * @param[in] maxZoom Highest zoom level
+         * @param[in] minx    Minimum Web Mercator x-coordinate
+         * @param[in] miny    Minimum Web Mercator y-coordinate
+         * @param[in] maxx    Maximum Web Mercator x-coordinate
+         * @param[in] maxy    Maximum Web Mercator y-coordinate
+         * @param[in] threads Number of encoding workers. Zero uses the
+         *                    hardware concurrency.
+         * @param[in] extent  Tile extent in pixels
+         * @param[in] buffer  Pixels kept beyond the extent on each side
+         * @throws std::runtime_error on invalid arguments
+         */
+        TilePyramid(int minZoom,
+                    int maxZoom,
+                    double minx,
+                    double miny,
+                    double maxx,
+                    double maxy,
+                    int threads = 0,
+                    int extent = 4096,
+                    int buffer = 64);
+
+        /**
+         * @brief Destructor
+         */
+        ~TilePyramid();
+
+        /**
+         * @brief Finds the non-empty tiles of the pyramid
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name, spatially indexed
+         * @returns Tiles whose buffered bounds hold an index entry, ordered
+         *          by zoom level
+         * @throws std::runtime_error on failure
+         */
+        std::vector<VectorTileEncoder::Tile> findTiles(
+            SpatialDatabase const & database,
+            std::string const & table,
+            std::string const & geometry) const;
+
+        /**
+         * @brief Generates the pyramid into an MBTiles file
+         * @details The file is created if needed. Tiles of the zoom range
+         *          and box already in it are replaced, or dropped if now
+         *          empty, along with tile data no longer referenced. Its
+         *          metadata is rewritten. Workers see only
+         *          committed data; in-memory databases are encoded by a
+         *          single worker over the caller's connection.
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name, also the layer name
+         * @param[in] geometry Geometry column name, spatially indexed
+         * @param[in] filename MBTiles file name
+         * @returns Number of tiles written
+         * @throws std::runtime_error on failure
+         */
+        long long generate(SpatialDatabase const & database,
+                           std::string const & table,
+                           std::string const & geometry,
+                           std::string const & filename);
+
+        /**
+         * @returns Number of tiles of the last run that matched an already
+         *          stored tile
+         */
+        long long getDuplicateCount() const;
+
+        /**
+         * @returns Number of tiles of the last run that had index entries
+         *          but no features after clipping
+         */
+        long long getEmptyCount() const;
+
+        /**
+         * @returns Highest zoom level
+         */
+        int getMaxZoom() const;
+
+        /**
+         * @returns Lowest zoom level
+         */
+        int getMinZoom() const;
+
+        /**
+         * @returns Number of encoding workers
+         */
+        int getThreadCount() const;
+
+    private:
+
+        // Disallow copying and assignment
+        TilePyramid & operator=(const TilePyramid &);
+        TilePyramid(const TilePyramid &);
+
+        /**
+         * @brief Web Mercator box: minx, miny, maxx, maxy
+         */
+        double _bounds[4];
+
+        /**
+         * @brief Pixels kept beyond the extent
+         */
+        int _buffer;
+
+        /**
+         * @brief Number of duplicate tiles of the last run
+         */
+        long long _duplicates;
+
+        /**
+         * @brief Number of empty tiles of the last run
+         */
+        long long _empty;
+
+        /**
+         * @brief Tile extent in pixels
+         */
+        int _extent;
+
+        /**
+         * @brief Highest zoom level
+         */
+        int _maxZoom;
+
+        /**
+         * @brief Lowest zoom level
+         */
+        int _minZoom;
+
+        /**
+         * @brief Number of encoding workers
+         */
+        int _threads;
+
+    };
+
+}
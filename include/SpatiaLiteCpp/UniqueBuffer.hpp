@@ -0,0 +1,189 @@
+/**
+ * @file    UniqueBuffer.hpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main UniqueBuffer class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+namespace SpatiaLite
+{
+
+    /**
+     * @brief Stateless deleter calling a deallocator function.
+     * @details Null buffers are not passed to the deallocator.
+     */
+    template <class T, void (*Clean)(T)>
+    struct BufferDeleter
+    {
+        /**
+         * @brief Releases a buffer
+         * @param[in] buffer Buffer to release
+         */
+        void operator()(T buffer) const
+        {
+            if (buffer) Clean(buffer);
+        }
+    };
+
+    /**
+     * @brief Move-only RAII management of a buffer array.
+     * @details Stack allocatable counterpart of Buffer. The deleter is a
+     *          template parameter, so there is no vtable, no stored function
+     *          pointer and no shared_ptr around the wrapper. Ownership is
+     *          transferred by moving.
+     */
+    template <class T, class Deleter>
+    class UniqueBuffer
+    {
+
+    public:
+
+        /**
+         * @brief Creates an empty buffer
+         */
+        UniqueBuffer() noexcept :
+            _buffer()
+        {
+        }
+
+        /**
+         * @brief Takes ownership of an existing buffer
+         * @param[in] buffer Existing buffer
+         */
+        explicit UniqueBuffer(T buffer) noexcept :
+            _buffer(buffer)
+        {
+        }
+
+        /**
+         * @brief Takes ownership of another buffer
+         * @param[in] other Buffer left empty
+         */
+        UniqueBuffer(UniqueBuffer && other) noexcept :
+            _buffer(other.release())
+        {
+        }
+
+        /**
+         * @brief Releases the current buffer and takes ownership of another
+         * @param[in] other Buffer left empty
+         * @returns This buffer
+         */
+        UniqueBuffer & operator=(UniqueBuffer && other) noexcept
+        {
+            this->reset(other.release());
+            return *this;
+        }
+
+        /**
+         * @brief Clean up pointer
+         */
+        ~UniqueBuffer()
+        {
+            Deleter()(this->_buffer);
+        }
+
+        /**
+         * @returns True if a buffer is owned
+         */
+        explicit operator bool() const noexcept
+        {
+            return this->_buffer != T();
+        }
+
+        /**
+         * @returns Raw pointer
+         */
+        T get() const noexcept
+        {
+            return this->_buffer;
+        }
+
+        /**
+         * @brief Gives up ownership without releasing the buffer
+         * @returns Raw pointer. Caller must release it.
+         */
+        T release() noexcept
+        {
+            T buffer = this->_buffer;
+            this->_buffer = T();
+            return buffer;
+        }
+
+        /**
+         * @brief Releases the current buffer and takes ownership of another
+         * @param[in] buffer New buffer (optional)
+         */
+        void reset(T buffer = T())
+        {
+            T previous = this->_buffer;
+            this->_buffer = buffer;
+            Deleter()(previous);
+        }
+
+        // Disallow copying and assignment
+        UniqueBuffer(const UniqueBuffer &) = delete;
+        UniqueBuffer & operator=(const UniqueBuffer &) = delete;
+
+    private:
+
+        /**
+         * @brief Raw pointer
+         */
+        T _buffer;
+
+    };
+
+    /**
+     * Move-only gaiaDynamicLinePtr
+     */
+    typedef UniqueBuffer<gaiaDynamicLinePtr,
+        BufferDeleter<gaiaDynamicLinePtr, gaiaFreeDynamicLine> >
+        UniqueDynamicLine;
+
+    /**
+     * Move-only gaiaGeomCollPtr
+     */
+    typedef UniqueBuffer<gaiaGeomCollPtr,
+        BufferDeleter<gaiaGeomCollPtr, gaiaFreeGeomColl> >
+        UniqueGeometryCollection;
+
+    /**
+     * Move-only gaiaLinestringPtr
+     */
+    typedef UniqueBuffer<gaiaLinestringPtr,
+        BufferDeleter<gaiaLinestringPtr, gaiaFreeLinestring> >
+        UniqueLineString;
+
+    /**
+     * Move-only gaiaPointPtr
+     */
+    typedef UniqueBuffer<gaiaPointPtr,
+        BufferDeleter<gaiaPointPtr, gaiaFreePoint> >
+        UniquePoint;
+
+    /**
+     * Move-only gaiaPolygonPtr
+     */
+    typedef UniqueBuffer<gaiaPolygonPtr,
+        BufferDeleter<gaiaPolygonPtr, gaiaFreePolygon> >
+        UniquePolygon;
+
+    /**
+     * Move-only gaiaRingPtr
+     */
+    typedef UniqueBuffer<gaiaRingPtr,
+        BufferDeleter<gaiaRingPtr, gaiaFreeRing> >
+        UniqueRing;
+
+}
@@ -0,0 +1,389 @@
+/**
+ * @file    VectorTileEncoder.h
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main VectorTileEncoder class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/IntrusivePtr.hpp"
+#include "SpatiaLiteCpp/SpatiaLiteCppAbi.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    // Forward declarations
+    class SpatialDatabase;
+
+    /**
+     * @brief Mapbox Vector Tile (MVT 2.1) encoder.
+     * @details Geometries in Web Mercator (EPSG:3857) are transformed to
+     *          tile pixels, clipped to the tile extent plus a buffer,
+     *          quantized to integers and written as zigzag delta commands.
+     *          The protobuf is written directly into buffers that keep
+     *          their storage between tiles, so an encoder should be reused.
+     *          Table layers are selected through the SpatiaLite R*Tree
+     *          spatial index and carry the other columns as attributes.
+     *          An encoder is not thread-safe; encodeTiles() runs one per
+     *          worker thread.
+     */
+    class SPATIALITECPP_ABI VectorTileEncoder : public PtrBase
+    {
+
+    public:
+
+        /**
+         * @brief Tile address
+         */
+        struct Tile
+        {
+            int z;  ///< Zoom level
+            int x;  ///< Column from the west
+            int y;  ///< Row from the north
+        };
+
+        /**
+         * @brief Tile query of a table layer, prepared once and rebound for
+         *        every tile
+         * @details Bound to the connection it was prepared on; use one per
+         *          thread.
+         */
+        class SPATIALITECPP_ABI LayerQuery
+        {
+
+        public:
+
+            /**
+             * @brief Prepares the tile query of a table
+             * @param[in] database Source spatial database
+             * @param[in] table    Table name
+             * @param[in] geometry Geometry column name, spatially indexed
+             * @throws std::runtime_error on a missing index or column
+             */
+            LayerQuery(SpatialDatabase const & database,
+                       std::string const & table,
+                       std::string const & geometry);
+
+            /**
+             * @brief Finalizes the query
+             */
+            ~LayerQuery();
+
+        private:
+
+            friend class VectorTileEncoder;
+
+            // Disallow copying and assignment
+            LayerQuery & operator=(const LayerQuery &);
+            LayerQuery(const LayerQuery &);
+
+            /**
+             * @brief Index of the geometry column
+             */
+            int _geometryColumn;
+
+            /**
+             * @brief Prepared query
+             */
+            sqlite3_stmt * _statement;
+
+            /**
+             * @brief Table name, the default layer name
+             */
+            std::string _table;
+
+        };
+
+        /**
+         * @brief Creates an encoder
+         * @param[in] extent Tile extent in pixels
+         * @param[in] buffer Pixels kept beyond the extent on each side
+         * @throws std::runtime_error on invalid arguments
+         */
+        explicit VectorTileEncoder(int extent = 4096, int buffer = 64);
+
+        /**
+         * @brief Destructor
+         */
+        ~VectorTileEncoder();
+
+        /**
+         * @brief Adds a feature without attributes to the current layer
+         * @param[in] geometry Geometry in Web Mercator
+         * @param[in] id       Feature id, omitted if negative
+         * @returns Number of features written. Mixed collections give one
+         *          feature per geometry type, parts clipped away none.
+         * @throws std::runtime_error if no layer was begun
+         */
+        int addFeature(gaiaGeomCollPtr geometry, sqlite3_int64 id = -1);
+
+        /**
+         * @brief Adds the features of a table that intersect a tile as one
+         *        layer
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name, spatially indexed
+         * @param[in] z        Zoom level
+         * @param[in] x        Tile column
+         * @param[in] y        Tile row
+         * @param[in] name     Layer name. Defaults to the table name.
+         * @returns Number of features written
+         * @throws std::runtime_error on failure
+         */
+        int addLayer(SpatialDatabase const & database,
+                     std::string const & table,
+                     std::string const & geometry,
+                     int z,
+                     int x,
+                     int y,
+                     std::string const & name = std::string());
+
+        /**
+         * @brief Adds the features of a prepared table query that intersect
+         *        a tile as one layer
+         * @param[in] query Layer query of this thread
+         * @param[in] z     Zoom level
+         * @param[in] x     Tile column
+         * @param[in] y     Tile row
+         * @param[in] name  Layer name. Defaults to the table name.
+         * @returns Number of features written
+         * @throws std::runtime_error on failure
+         */
+        int addLayer(LayerQuery & query,
+                     int z,
+                     int x,
+                     int y,
+                     std::string const & name = std::string());
+
+        /**
+         * @brief Starts a layer
+         * @param[in] name Layer name
+         * @param[in] z    Zoom level
+         * @param[in] x    Tile column
+         * @param[in] y    Tile row
+         * @throws std::runtime_error on an invalid tile or if a layer is
+         *         already begun
+         */
+        void beginLayer(std::string const & name, int z, int x, int y);
+
+        /**
+         * @brief Starts a new tile, keeping the buffer storage
+         */
+        void clear();
+
+        /**
+         * @brief Encodes tiles from a table on several threads
+         * @details Each worker owns a read-only connection to the database
+         *          file and an encoder, and takes tiles one at a time. An
+         *          in-memory database is encoded by a single worker over the
+         *          caller's connection.
+         * @param[in] database Source spatial database
+         * @param[in] table    Table name
+         * @param[in] geometry Geometry column name, spatially indexed
+         * @param[in] tiles    Tiles to encode
+         * @param[in] threads  Number of workers. Zero uses the hardware
+         *                     concurrency.
+         * @param[in] extent   Tile extent in pixels
+         * @param[in] buffer   Pixels kept beyond the extent on each side
+         * @returns One encoded tile per requested tile, in order
+         * @throws std::runtime_error on failure
+         */
+        static std::vector<std::string> encodeTiles(
+            SpatialDatabase const & database,
+            std::string const & table,
+            std::string const & geometry,
+            std::vector<Tile> const & tiles,
+            int threads = 0,
+            int extent = 4096,
+            int buffer = 64);
+
+        /**
+         * @brief Writes the current layer into the tile. Layers without
+         *        features are left out.
+         * @returns Number of features in the layer
+         * @throws std::runtime_error if no layer was begun
+         */
+        int endLayer();
+
+        /**
+         * @brief Gets the Web Mercator bounds of a tile
+         * @param[in]  z    Zoom level
+         * @param[in]  x    Tile column
+         * @param[in]  y    Tile row
+         * @param[out] minx Minimum x-coordinate
+         * @param[out] miny Minimum y-coordinate
+         * @param[out] maxx Maximum x-coordinate
+         * @param[out] maxy Maximum y-coordinate
+         * @throws std::runtime_error on an invalid tile
+         */
+        static void getBounds(int z, int x, int y,
+                              double & minx, double & miny,
+                              double & maxx, double & maxy);
+
+        /**
+         * @returns Pixels kept beyond the extent
+         */
+        int getBuffer() const;
+
+        /**
+         * @returns Encoded tile. Valid until the encoder is next changed.
+         */
+        std::string const & getData() const;
+
+        /**
+         * @returns Tile extent in pixels
+         */
+        int getExtent() const;
+
+        /**
+         * @returns Number of features written since clear()
+         */
+        long long getFeatureCount() const;
+
+    private:
+
+        // Disallow copying and assignment
+        VectorTileEncoder & operator=(const VectorTileEncoder &);
+        VectorTileEncoder(const VectorTileEncoder &);
+
+        /**
+         * @brief Adds the rows of a prepared layer query
+         * @param[in] statement      Query with the tile bounds bound
+         * @param[in] geometryColumn Index of the geometry column
+         * @returns Number of features written
+         */
+        int addRows(sqlite3_stmt * statement, int geometryColumn);
+
+        /**
+         * @brief Appends a clipped line to the commands
+         * @param[in] coords     Coordinate array
+         * @param[in] points     Number of points
+         * @param[in] dimensions Dimension model
+         * @returns Number of parts written
+         */
+        int encodeLine(const double * coords, int points, int dimensions);
+
+        /**
+         * @brief Appends the geometry commands of one type
+         * @param[in] geometry Geometry
+         * @param[in] type     MVT geometry type
+         * @returns True if anything survived clipping
+         */
+        bool encodeGeometry(gaiaGeomCollPtr geometry, int type);
+
+        /**
+         * @brief Appends a clipped ring to the commands
+         * @param[in] ring     Ring
+         * @param[in] exterior True for an exterior ring
+         * @returns True if the ring survived clipping
+         */
+        bool encodeRing(gaiaRingPtr ring, bool exterior);
+
+        /**
+         * @brief Writes the feature of the current commands and tags
+         * @param[in] type MVT geometry type
+         * @param[in] id   Feature id, omitted if negative
+         */
+        void writeFeature(int type, sqlite3_int64 id);
+
+        /**
+         * @brief Pixels kept beyond the extent
+         */
+        int _buffer;
+
+        /**
+         * @brief Geometry commands of the current feature
+         */
+        std::vector<uint32_t> _commands;
+
+        /**
+         * @brief Pen position of the current feature
+         */
+        int _cursor[2];
+
+        /**
+         * @brief Encoded tile
+         */
+        std::string _data;
+
+        /**
+         * @brief Tile extent in pixels
+         */
+        int _extent;
+
+        /**
+         * @brief Scratch feature message
+         */
+        std::string _feature;
+
+        /**
+         * @brief Number of features written
+         */
+        long long _features;
+
+        /**
+         * @brief Attribute keys of the current layer
+         */
+        std::vector<std::string> _keys;
+
+        /**
+         * @brief Index of the attribute keys
+         */
+        std::unordered_map<std::string, uint32_t> _keyIndex;
+
+        /**
+         * @brief Encoded features of the current layer
+         */
+        std::string _layer;
+
+        /**
+         * @brief Number of features of the current layer, -1 outside layers
+         */
+        int _layerFeatures;
+
+        /**
+         * @brief Name of the current layer
+         */
+        std::string _name;
+
+        /**
+         * @brief Scratch coordinate arrays for clipping and quantizing
+         */
+        std::vector<double> _scratch[3];
+
+        /**
+         * @brief Tags of the current feature
+         */
+        std::vector<uint32_t> _tags;
+
+        /**
+         * @brief World to pixel transform: x offset, y offset and scale
+         */
+        double _transform[3];
+
+        /**
+         * @brief Encoded attribute values of the current layer
+         */
+        std::vector<std::string> _values;
+
+        /**
+         * @brief Index of the encoded attribute values
+         */
+        std::unordered_map<std::string, uint32_t> _valueIndex;
+
+    };
+
+}
@@ -8,12 +8,1094 @@
 
 #include "SpatiaLiteCpp/Blob.h"
 
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/GeometryArena.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <stdexcept>
 
 namespace SpatiaLite
 {
 
+    namespace
+    {
+
+        /**
+         * @brief TWKB metadata flags
+         */
+        enum TwkbFlags
+        {
+            TWKB_BBOX = 0x01,
+            TWKB_SIZE = 0x02,
+            TWKB_IDS = 0x04,
+            TWKB_EXTENDED = 0x08,
+            TWKB_EMPTY = 0x10
+        };
+
+        /**
+         * @brief Appends an unsigned LEB128 varint
+         */
+        void appendVarint(std::vector<unsigned char> & output,
+                          unsigned long long value)
+        {
+            while (value >= 0x80)
+            {
+                output.push_back((unsigned char)((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            output.push_back((unsigned char)value);
+        }
+
+        /**
+         * @returns Zig-zag encoding of a signed value
+         */
+        unsigned long long zigzag(long long value)
+        {
+            return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+        }
+
+        /**
+         * @returns Signed value of a zig-zag encoding
+         */
+        long long unzigzag(unsigned long long value)
+        {
+            return (long long)(value >> 1) ^ -(long long)(value & 1);
+        }
+
+        /**
+         * @brief Scale factors and running delta state
+         */
+        struct Quantizer
+        {
+            double factors[4];     ///< 10^precision per ordinate
+            long long last[4];     ///< Previous quantized point
+            int dimensions;        ///< Ordinates per point
+        };
+
+        /**
+         * @brief Sets the scale factors of a dimension model and resets the
+         *        delta state. The third ordinate is Z, or M without Z.
+         */
+        void setQuantizer(Quantizer & quantizer,
+                          int model,
+                          int precision,
+                          int precisionZ,
+                          int precisionM)
+        {
+            const bool hasZ = model == GAIA_XY_Z || model == GAIA_XY_Z_M;
+            quantizer.dimensions = CoordinateBuffer::getStride(model);
+            quantizer.factors[0] = std::pow(10.0, precision);
+            quantizer.factors[1] = quantizer.factors[0];
+            quantizer.factors[2] = std::pow(10.0, hasZ ? precisionZ : precisionM);
+            quantizer.factors[3] = std::pow(10.0, precisionM);
+            for (int d = 0; d < 4; d++) quantizer.last[d] = 0;
+        }
+
+        // ==================================================
+        // TWKB encoder
+        // --------------------------------------------------
+
+        /**
+         * @brief Writer of one TWKB geometry
+         */
+        struct Writer
+        {
+            std::vector<unsigned char> & output;  ///< Destination
+            Blob::TwkbOptions const & options;    ///< Encoder options
+            int model;                            ///< Dimension model
+            Quantizer quantizer;                  ///< Scale and delta state
+
+            Writer(std::vector<unsigned char> & output,
+                   Blob::TwkbOptions const & options,
+                   int model) :
+                output(output),
+                options(options),
+                model(model)
+            {
+                setQuantizer(this->quantizer, model, options.precision,
+                             options.precisionZ, options.precisionM);
+            }
+
+            /**
+             * @brief Quantizes a point
+             */
+            void quantize(const double * coords, long long * values) const
+            {
+                for (int d = 0; d < this->quantizer.dimensions; d++)
+                {
+                    values[d] = std::llround(coords[d] * this->quantizer.factors[d]);
+                }
+            }
+
+            /**
+             * @brief Appends points as deltas from the previous point
+             */
+            void appendPoints(const double * coords, int points, int stride)
+            {
+                long long values[4];
+                for (int i = 0; i < points; i++, coords += stride)
+                {
+                    this->quantize(coords, values);
+                    for (int d = 0; d < this->quantizer.dimensions; d++)
+                    {
+                        appendVarint(this->output,
+                                     zigzag(values[d] - this->quantizer.last[d]));
+                        this->quantizer.last[d] = values[d];
+                    }
+                }
+            }
+
+            /**
+             * @brief Appends a point of a point list
+             */
+            void appendPoint(gaiaPointPtr point)
+            {
+                double coords[4];
+                this->getCoords(point, coords);
+                this->appendPoints(coords, 1, 4);
+            }
+
+            /**
+             * @brief Appends a line body
+             */
+            void appendLine(gaiaLinestringPtr line)
+            {
+                appendVarint(this->output, line->Points);
+                this->appendPoints(line->Coords, line->Points,
+                                   CoordinateBuffer::getStride(line->DimensionModel));
+            }
+
+            /**
+             * @brief Appends a polygon body
+             */
+            void appendPolygon(gaiaPolygonPtr polygon)
+            {
+                appendVarint(this->output, 1 + polygon->NumInteriors);
+                for (int i = -1; i < polygon->NumInteriors; i++)
+                {
+                    gaiaRingPtr ring = i < 0 ? polygon->Exterior : polygon->Interiors + i;
+                    appendVarint(this->output, ring->Points);
+                    this->appendPoints(ring->Coords, ring->Points,
+                                       CoordinateBuffer::getStride(ring->DimensionModel));
+                }
+            }
+
+            /**
+             * @brief Appends a header and resets the delta state
+             * @param[in] geometry Geometry whose bounding box is written, or
+             *                     null for none
+             * @param[in] ids      Whether an id list follows the count
+             */
+            void appendHeader(int type, gaiaGeomCollPtr geometry, bool ids, bool empty)
+            {
+                const bool hasZ = this->model == GAIA_XY_Z || this->model == GAIA_XY_Z_M;
+                const bool hasM = this->model == GAIA_XY_M || this->model == GAIA_XY_Z_M;
+                long long minimum[4];
+                long long maximum[4];
+                const bool bbox = geometry && !empty &&
+                                  this->getBounds(geometry, minimum, maximum);
+                this->output.push_back((unsigned char)(type |
+                                                       (zigzag(this->options.precision) << 4)));
+                this->output.push_back((unsigned char)((bbox ? TWKB_BBOX : 0) |
+                                                       (ids ? TWKB_IDS : 0) |
+                                                       (hasZ || hasM ? TWKB_EXTENDED : 0) |
+                                                       (empty ? TWKB_EMPTY : 0)));
+                if (hasZ || hasM)
+                {
+                    this->output.push_back((unsigned char)((hasZ ? 1 : 0) | (hasM ? 2 : 0) |
+                                                           (hasZ ? this->options.precisionZ << 2 : 0) |
+                                                           (hasM ? this->options.precisionM << 5 : 0)));
+                }
+                if (bbox)
+                {
+                    for (int d = 0; d < this->quantizer.dimensions; d++)
+                    {
+                        appendVarint(this->output, zigzag(minimum[d]));
+                        appendVarint(this->output, zigzag(maximum[d] - minimum[d]));
+                    }
+                }
+                for (int d = 0; d < 4; d++) this->quantizer.last[d] = 0;
+            }
+
+            /**
+             * @brief Appends the count of a multi geometry and its ids
+             */
+            void appendCount(size_t count)
+            {
+                appendVarint(this->output, count);
+                if (this->options.ids.empty()) return;
+                if (this->options.ids.size() != count)
+                {
+                    throw std::runtime_error("Invalid TWKB ids!");
+                }
+                for (size_t i = 0; i < count; i++)
+                {
+                    appendVarint(this->output, zigzag(this->options.ids[i]));
+                }
+            }
+
+            /**
+             * @brief Ordinates of a point in the model's order
+             */
+            void getCoords(gaiaPointPtr point, double * coords) const
+            {
+                int d = 2;
+                coords[0] = point->X;
+                coords[1] = point->Y;
+                if (this->model == GAIA_XY_Z || this->model == GAIA_XY_Z_M) coords[d++] = point->Z;
+                if (this->model == GAIA_XY_M || this->model == GAIA_XY_Z_M) coords[d++] = point->M;
+            }
+
+            /**
+             * @brief Extends quantized bounds with points
+             */
+            void extend(const double * coords,
+                        int points,
+                        int stride,
+                        long long * minimum,
+                        long long * maximum,
+                        bool & found) const
+            {
+                long long values[4];
+                for (int i = 0; i < points; i++, coords += stride)
+                {
+                    this->quantize(coords, values);
+                    for (int d = 0; d < this->quantizer.dimensions; d++)
+                    {
+                        if (!found || values[d] < minimum[d]) minimum[d] = values[d];
+                        if (!found || values[d] > maximum[d]) maximum[d] = values[d];
+                    }
+                    found = true;
+                }
+            }
+
+            /**
+             * @brief Quantized bounds of every point of a geometry
+             * @returns False if the geometry has no points
+             */
+            bool getBounds(gaiaGeomCollPtr geometry,
+                           long long * minimum,
+                           long long * maximum) const
+            {
+                bool found = false;
+                double coords[4];
+                for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+                {
+                    this->getCoords(p, coords);
+                    this->extend(coords, 1, 4, minimum, maximum, found);
+                }
+                for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+                {
+                    this->extend(l->Coords, l->Points,
+                                 CoordinateBuffer::getStride(l->DimensionModel),
+                                 minimum, maximum, found);
+                }
+                for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+                {
+                    for (int i = -1; i < p->NumInteriors; i++)
+                    {
+                        gaiaRingPtr ring = i < 0 ? p->Exterior : p->Interiors + i;
+                        this->extend(ring->Coords, ring->Points,
+                                     CoordinateBuffer::getStride(ring->DimensionModel),
+                                     minimum, maximum, found);
+                    }
+                }
+                return found;
+            }
+
+            /**
+             * @brief Appends a geometry
+             */
+            void appendGeometry(gaiaGeomCollPtr geometry)
+            {
+                size_t points = 0;
+                size_t lines = 0;
+                size_t polygons = 0;
+                for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next) points++;
+                for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next) lines++;
+                for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next) polygons++;
+                const int kinds = (points > 0) + (lines > 0) + (polygons > 0);
+                const int declared = geometry->DeclaredType % 1000;
+                const bool multi = declared >= GAIA_MULTIPOINT;
+                const bool ids = !this->options.ids.empty();
+                gaiaGeomCollPtr bbox = this->options.bbox ? geometry : 0;
+
+                if (kinds == 0)
+                {
+                    if (ids) throw std::runtime_error("Invalid TWKB ids!");
+                    const int type = declared >= GAIA_POINT && declared <= GAIA_GEOMETRYCOLLECTION ?
+                                     declared : GAIA_GEOMETRYCOLLECTION;
+                    this->appendHeader(type, 0, false, true);
+                }
+                else if (kinds > 1 || declared == GAIA_GEOMETRYCOLLECTION)
+                {
+                    // Every part becomes a geometry of the collection
+                    this->appendHeader(GAIA_GEOMETRYCOLLECTION, bbox, ids, false);
+                    this->appendCount(points + lines + polygons);
+                    for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+                    {
+                        this->appendHeader(GAIA_POINT, 0, false, false);
+                        this->appendPoint(p);
+                    }
+                    for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+                    {
+                        this->appendHeader(GAIA_LINESTRING, 0, false, false);
+                        this->appendLine(l);
+                    }
+                    for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+                    {
+                        this->appendHeader(GAIA_POLYGON, 0, false, false);
+                        this->appendPolygon(p);
+                    }
+                }
+                else if (points > 0)
+                {
+                    const bool single = points == 1 && !multi && !ids;
+                    this->appendHeader(single ? GAIA_POINT : GAIA_MULTIPOINT,
+                                       bbox, ids, false);
+                    if (!single) this->appendCount(points);
+                    for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+                    {
+                        this->appendPoint(p);
+                    }
+                }
+                else if (lines > 0)
+                {
+                    const bool single = lines == 1 && !multi && !ids;
+                    this->appendHeader(single ? GAIA_LINESTRING : GAIA_MULTILINESTRING,
+                                       bbox, ids, false);
+                    if (!single) this->appendCount(lines);
+                    for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+                    {
+                        this->appendLine(l);
+                    }
+                }
+                else
+                {
+                    const bool single = polygons == 1 && !multi && !ids;
+                    this->appendHeader(single ? GAIA_POLYGON : GAIA_MULTIPOLYGON,
+                                       bbox, ids, false);
+                    if (!single) this->appendCount(polygons);
+                    for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+                    {
+                        this->appendPolygon(p);
+                    }
+                }
+            }
+        };
+
+        // ==================================================
+        // TWKB decoder
+        // --------------------------------------------------
+
+        /**
+         * @brief Bounds-checked reader of a TWKB geometry
+         */
+        struct Reader
+        {
+            const unsigned char * position;  ///< Next byte
+            const unsigned char * end;       ///< One past the last byte
+            Quantizer quantizer;             ///< Scale and delta state
+            int model;                       ///< Dimension model, or -1
+                                             ///< before the first header
+
+            bool readVarint(unsigned long long & value)
+            {
+                value = 0;
+                for (int shift = 0; shift < 64; shift += 7)
+                {
+                    if (this->position >= this->end) return false;
+                    const unsigned char byte = *this->position++;
+                    value |= (unsigned long long)(byte & 0x7F) << shift;
+                    if (!(byte & 0x80)) return true;
+                }
+                return false;
+            }
+
+            bool readCount(int & count)
+            {
+                unsigned long long value = 0;
+                if (!this->readVarint(value)) return false;
+
+                // Each counted item takes at least one byte
+                if (value > (unsigned long long)(this->end - this->position))
+                {
+                    return false;
+                }
+                count = (int)value;
+                return true;
+            }
+
+            bool readCoords(double * coords)
+            {
+                for (int d = 0; d < this->quantizer.dimensions; d++)
+                {
+                    unsigned long long value = 0;
+                    if (!this->readVarint(value)) return false;
+                    this->quantizer.last[d] += unzigzag(value);
+                    coords[d] = this->quantizer.last[d] / this->quantizer.factors[d];
+                }
+                return true;
+            }
+
+            /**
+             * @brief Reads a header and resets the delta state
+             * @returns False if invalid or of other dimensions than the
+             *          geometries before it
+             */
+            bool readHeader(int & type, int & flags)
+            {
+                if (this->end - this->position < 2) return false;
+                const unsigned char header = *this->position++;
+                flags = *this->position++;
+                type = header & 0x0F;
+                if (type < GAIA_POINT || type > GAIA_GEOMETRYCOLLECTION) return false;
+                int precisionZ = 0;
+                int precisionM = 0;
+                bool hasZ = false;
+                bool hasM = false;
+                if (flags & TWKB_EXTENDED)
+                {
+                    if (this->position >= this->end) return false;
+                    const unsigned char dimensions = *this->position++;
+                    hasZ = (dimensions & 1) != 0;
+                    hasM = (dimensions & 2) != 0;
+                    precisionZ = (dimensions >> 2) & 7;
+                    precisionM = (dimensions >> 5) & 7;
+                }
+                const int found = hasZ ? (hasM ? GAIA_XY_Z_M : GAIA_XY_Z) :
+                                         (hasM ? GAIA_XY_M : GAIA_XY);
+                if (this->model < 0) this->model = found;
+                if (this->model != found) return false;
+                setQuantizer(this->quantizer, found, (int)unzigzag(header >> 4),
+                             precisionZ, precisionM);
+
+                // Sizes and bounding boxes are not needed to decode
+                unsigned long long value = 0;
+                if ((flags & TWKB_SIZE) && !this->readVarint(value)) return false;
+                if (flags & TWKB_BBOX)
+                {
+                    for (int d = 0; d < 2 * this->quantizer.dimensions; d++)
+                    {
+                        if (!this->readVarint(value)) return false;
+                    }
+                }
+                return true;
+            }
+
+            /**
+             * @brief Reads the id list of a multi geometry
+             */
+            bool readIds(int count, std::vector<sqlite3_int64> * ids)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    unsigned long long value = 0;
+                    if (!this->readVarint(value)) return false;
+                    if (ids) ids->push_back(unzigzag(value));
+                }
+                return true;
+            }
+
+            template <class Sink>
+            bool readPoints(Sink & sink, int points)
+            {
+                double coords[4];
+                for (int i = 0; i < points; i++)
+                {
+                    if (!this->readCoords(coords)) return false;
+                    sink.vertex(coords);
+                }
+                return true;
+            }
+
+            template <class Sink>
+            bool readPoint(Sink & sink)
+            {
+                double coords[4];
+                if (!this->readCoords(coords)) return false;
+                sink.point(coords);
+                return true;
+            }
+
+            template <class Sink>
+            bool readLine(Sink & sink)
+            {
+                int points = 0;
+                if (!this->readCount(points)) return false;
+                sink.line(points);
+                return this->readPoints(sink, points);
+            }
+
+            template <class Sink>
+            bool readPolygon(Sink & sink)
+            {
+                int rings = 0;
+                int points = 0;
+                if (!this->readCount(rings)) return false;
+                if (rings == 0) return true;
+                if (!this->readCount(points)) return false;
+                sink.polygon(rings, points);
+                if (!this->readPoints(sink, points)) return false;
+                for (int i = 0; i < rings - 1; i++)
+                {
+                    if (!this->readCount(points)) return false;
+                    sink.ring(i, points);
+                    if (!this->readPoints(sink, points)) return false;
+                }
+                return true;
+            }
+
+            /**
+             * @brief Reads a member of a collection
+             */
+            template <class Sink>
+            bool readMember(Sink & sink, int depth)
+            {
+                int type = 0;
+                int flags = 0;
+                if (!this->readHeader(type, flags)) return false;
+                return this->readBody(sink, type, flags, depth, 0);
+            }
+
+            /**
+             * @brief Reads the body that follows a header
+             * @param[in]  depth Nesting level of collections
+             * @param[out] ids   Member ids, or null
+             */
+            template <class Sink>
+            bool readBody(Sink & sink,
+                          int type,
+                          int flags,
+                          int depth,
+                          std::vector<sqlite3_int64> * ids)
+            {
+                if (flags & TWKB_EMPTY) return true;
+                if (type == GAIA_POINT) return this->readPoint(sink);
+                if (type == GAIA_LINESTRING) return this->readLine(sink);
+                if (type == GAIA_POLYGON) return this->readPolygon(sink);
+
+                int count = 0;
+                if (!this->readCount(count)) return false;
+                if ((flags & TWKB_IDS) && !this->readIds(count, ids)) return false;
+                for (int i = 0; i < count; i++)
+                {
+                    bool valid = false;
+                    switch (type)
+                    {
+                    case GAIA_MULTIPOINT:
+                        valid = this->readPoint(sink);
+                        break;
+                    case GAIA_MULTILINESTRING:
+                        valid = this->readLine(sink);
+                        break;
+                    case GAIA_MULTIPOLYGON:
+                        valid = this->readPolygon(sink);
+                        break;
+                    default:
+                        valid = depth < 8 && this->readMember(sink, depth + 1);
+                    }
+                    if (!valid) return false;
+                }
+                return true;
+            }
+        };
+
+        // ==================================================
+        // Geometry builders, on the heap or in an arena if set
+        // --------------------------------------------------
+
+        gaiaGeomCollPtr allocGeometry(int model, GeometryArena * arena)
+        {
+            if (arena) return arena->allocGeomColl(model);
+            switch (model)
+            {
+            case GAIA_XY_Z:
+                return gaiaAllocGeomCollXYZ();
+            case GAIA_XY_M:
+                return gaiaAllocGeomCollXYM();
+            case GAIA_XY_Z_M:
+                return gaiaAllocGeomCollXYZM();
+            default:
+                return gaiaAllocGeomColl();
+            }
+        }
+
+        void freeGeometry(gaiaGeomCollPtr geometry, GeometryArena * arena)
+        {
+            // Arena memory goes with the arena
+            if (!arena) gaiaFreeGeomColl(geometry);
+        }
+
+        void addPoint(gaiaGeomCollPtr geometry,
+                      const double * coords,
+                      GeometryArena * arena)
+        {
+            switch (geometry->DimensionModel)
+            {
+            case GAIA_XY_Z:
+                if (arena) arena->addPoint(geometry, coords[0], coords[1], coords[2]);
+                else gaiaAddPointToGeomCollXYZ(geometry, coords[0], coords[1], coords[2]);
+                break;
+            case GAIA_XY_M:
+                if (arena) arena->addPoint(geometry, coords[0], coords[1], 0, coords[2]);
+                else gaiaAddPointToGeomCollXYM(geometry, coords[0], coords[1], coords[2]);
+                break;
+            case GAIA_XY_Z_M:
+                if (arena)
+                {
+                    arena->addPoint(geometry, coords[0], coords[1], coords[2], coords[3]);
+                }
+                else
+                {
+                    gaiaAddPointToGeomCollXYZM(geometry, coords[0], coords[1],
+                                               coords[2], coords[3]);
+                }
+                break;
+            default:
+                if (arena) arena->addPoint(geometry, coords[0], coords[1]);
+                else gaiaAddPointToGeomColl(geometry, coords[0], coords[1]);
+            }
+        }
+
+        gaiaLinestringPtr addLine(gaiaGeomCollPtr geometry,
+                                  int points,
+                                  GeometryArena * arena)
+        {
+            if (arena) return arena->addLinestring(geometry, points);
+            return gaiaAddLinestringToGeomColl(geometry, points);
+        }
+
+        gaiaPolygonPtr addPolygon(gaiaGeomCollPtr geometry,
+                                  int points,
+                                  int interiors,
+                                  GeometryArena * arena)
+        {
+            if (arena) return arena->addPolygon(geometry, points, interiors);
+            return gaiaAddPolygonToGeomColl(geometry, points, interiors);
+        }
+
+        gaiaRingPtr addRing(gaiaPolygonPtr polygon,
+                            int index,
+                            int points,
+                            GeometryArena * arena)
+        {
+            if (arena) return arena->addInteriorRing(polygon, index, points);
+            return gaiaAddInteriorRing(polygon, index, points);
+        }
+
+        /**
+         * @brief Builds a geometry from decoded points
+         */
+        struct GeometrySink
+        {
+            gaiaGeomCollPtr geometry;  ///< Destination
+            GeometryArena * arena;     ///< Arena of the geometry, or null
+            gaiaPolygonPtr current;    ///< Polygon being read
+            double * cursor;           ///< Next coordinate
+            int stride;                ///< Ordinates per point
+
+            void point(const double * coords)
+            {
+                addPoint(this->geometry, coords, this->arena);
+            }
+
+            void line(int points)
+            {
+                this->cursor = addLine(this->geometry, points, this->arena)->Coords;
+            }
+
+            void polygon(int rings, int points)
+            {
+                this->current = addPolygon(this->geometry, points, rings - 1, this->arena);
+                this->cursor = this->current->Exterior->Coords;
+            }
+
+            void ring(int index, int points)
+            {
+                this->cursor = addRing(this->current, index, points, this->arena)->Coords;
+            }
+
+            void vertex(const double * coords)
+            {
+                for (int d = 0; d < this->stride; d++) this->cursor[d] = coords[d];
+                this->cursor += this->stride;
+            }
+        };
+
+        /**
+         * @brief Appends decoded points to a coordinate buffer
+         */
+        struct BufferSink
+        {
+            CoordinateBuffer * buffer;  ///< Destination
+            std::vector<int> * parts;   ///< First point of each part, or null
+            int model;                  ///< Dimension model of the TWKB
+
+            void point(const double * coords)
+            {
+                this->line(1);
+                this->vertex(coords);
+            }
+
+            void line(int)
+            {
+                if (this->parts) this->parts->push_back(this->buffer->getSize());
+            }
+
+            void polygon(int, int points)
+            {
+                this->line(points);
+            }
+
+            void ring(int, int points)
+            {
+                this->line(points);
+            }
+
+            void vertex(const double * coords)
+            {
+                switch (this->model)
+                {
+                case GAIA_XY_Z:
+                    this->buffer->append(coords[0], coords[1], coords[2], 0);
+                    break;
+                case GAIA_XY_M:
+                    this->buffer->append(coords[0], coords[1], 0, coords[2]);
+                    break;
+                case GAIA_XY_Z_M:
+                    this->buffer->append(coords[0], coords[1], coords[2], coords[3]);
+                    break;
+                default:
+                    this->buffer->append(coords[0], coords[1]);
+                }
+            }
+        };
+
+        // ==================================================
+        // SpatiaLite BLOB decoder
+        // --------------------------------------------------
+
+        /**
+         * @returns Value with its eight bytes reversed
+         */
+        unsigned long long swap64(unsigned long long value)
+        {
+            value = ((value & 0x00FF00FF00FF00FFULL) << 8) |
+                    ((value >> 8) & 0x00FF00FF00FF00FFULL);
+            value = ((value & 0x0000FFFF0000FFFFULL) << 16) |
+                    ((value >> 16) & 0x0000FFFF0000FFFFULL);
+            return (value << 32) | (value >> 32);
+        }
+
+        /**
+         * @brief Copies doubles out of a BLOB, reversing the bytes of each
+         *        one if the BLOB and host byte orders differ. The swap loop
+         *        has no branches, so compilers vectorize it.
+         */
+        void copyCoords(double * coords,
+                        const unsigned char * bytes,
+                        size_t count,
+                        bool swap)
+        {
+            if (!swap)
+            {
+                std::memcpy(coords, bytes, count * sizeof(double));
+                return;
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                unsigned long long value;
+                std::memcpy(&value, bytes + 8 * i, 8);
+                value = swap64(value);
+                std::memcpy(coords + i, &value, 8);
+            }
+        }
+
+        /**
+         * @brief Bounds-checked reader of a SpatiaLite BLOB body. Anything
+         *        unexpected fails the read, and the BLOB is then left to
+         *        gaiaFromSpatiaLiteBlobWkb.
+         */
+        struct BlobReader
+        {
+            const unsigned char * position;  ///< Next byte
+            const unsigned char * end;       ///< End marker
+            gaiaGeomCollPtr geometry;        ///< Destination
+            GeometryArena * arena;           ///< Arena of the geometry, or null
+            int base;                        ///< Class type offset of the
+                                             ///< dimension model
+            int stride;                      ///< Ordinates per point
+            bool swap;                       ///< Set if byte orders differ
+
+            bool readInt(int & value)
+            {
+                if (this->end - this->position < 4) return false;
+                unsigned int word;
+                std::memcpy(&word, this->position, 4);
+                if (this->swap)
+                {
+                    word = (word >> 24) | ((word >> 8) & 0xFF00) |
+                           ((word << 8) & 0xFF0000) | (word << 24);
+                }
+                value = (int)word;
+                this->position += 4;
+                return true;
+            }
+
+            /**
+             * @returns Start of the coordinates of a run of points, or null
+             *          if they do not fit
+             */
+            const unsigned char * readCoords(int points)
+            {
+                const long long bytes = 8LL * this->stride * points;
+                if (points < 0 || bytes > this->end - this->position) return 0;
+                const unsigned char * coords = this->position;
+                this->position += bytes;
+                return coords;
+            }
+
+            bool readPoint()
+            {
+                const unsigned char * bytes = this->readCoords(1);
+                if (!bytes) return false;
+                double c[4];
+                copyCoords(c, bytes, this->stride, this->swap);
+                addPoint(this->geometry, c, this->arena);
+                return true;
+            }
+
+            bool readLine()
+            {
+                int points = 0;
+                if (!this->readInt(points)) return false;
+                const unsigned char * bytes = this->readCoords(points);
+                if (!bytes) return false;
+                gaiaLinestringPtr line = addLine(this->geometry, points, this->arena);
+                copyCoords(line->Coords, bytes, (size_t)points * this->stride, this->swap);
+                return true;
+            }
+
+            bool readPolygon()
+            {
+                int rings = 0;
+                if (!this->readInt(rings)) return false;
+
+                // Each ring needs at least its point count
+                if (rings < 1 || rings > (this->end - this->position) / 4) return false;
+                gaiaPolygonPtr polygon = 0;
+                for (int r = 0; r < rings; r++)
+                {
+                    int points = 0;
+                    if (!this->readInt(points)) return false;
+                    const unsigned char * bytes = this->readCoords(points);
+                    if (!bytes) return false;
+                    gaiaRingPtr ring = 0;
+                    if (r == 0)
+                    {
+                        polygon = addPolygon(this->geometry, points, rings - 1, this->arena);
+                        ring = polygon->Exterior;
+                    }
+                    else
+                    {
+                        ring = addRing(polygon, r - 1, points, this->arena);
+                    }
+                    copyCoords(ring->Coords, bytes, (size_t)points * this->stride, this->swap);
+                }
+                return true;
+            }
+
+            /**
+             * @brief Reads a point, line string or polygon of the geometry's
+             *        dimension model
+             * @param[in] type Class type
+             */
+            bool readElement(int type)
+            {
+                if (type == this->base + GAIA_POINT) return this->readPoint();
+                if (type == this->base + GAIA_LINESTRING) return this->readLine();
+                if (type == this->base + GAIA_POLYGON) return this->readPolygon();
+                return false;
+            }
+
+            bool readCollection()
+            {
+                int count = 0;
+                if (!this->readInt(count) || count < 0) return false;
+                for (int i = 0; i < count; i++)
+                {
+                    if (this->position == this->end ||
+                        *this->position != GAIA_MARK_ENTITY)
+                    {
+                        return false;
+                    }
+                    this->position++;
+                    int type = 0;
+                    if (!this->readInt(type) || !this->readElement(type)) return false;
+                }
+                return true;
+            }
+        };
+
+        /**
+         * @brief Decodes a BLOB with gaiaFromSpatiaLiteBlobWkb, copied into an
+         *        arena if set
+         */
+        gaiaGeomCollPtr decodeGaiaBlob(const unsigned char * blob,
+                                       int size,
+                                       GeometryArena * arena)
+        {
+            gaiaGeomCollPtr geometry = gaiaFromSpatiaLiteBlobWkb(blob, size);
+            if (!arena || !geometry) return geometry;
+            gaiaGeomCollPtr copy = 0;
+            try
+            {
+                copy = arena->clone(geometry);
+            }
+            catch (...)
+            {
+                gaiaFreeGeomColl(geometry);
+                throw;
+            }
+            gaiaFreeGeomColl(geometry);
+            return copy;
+        }
+
+        /**
+         * @brief Decodes a SpatiaLite BLOB-Geometry on the heap or in an arena
+         */
+        gaiaGeomCollPtr decodeBlob(const unsigned char * blob,
+                                   int size,
+                                   GeometryArena * arena)
+        {
+            if (!blob || size < 1) return 0;
+
+            // ==================================================
+            // Only uncompressed classes are decoded here
+            // --------------------------------------------------
+            if (size < 45 ||
+                blob[0] != GAIA_MARK_START ||
+                blob[38] != GAIA_MARK_MBR ||
+                blob[size - 1] != GAIA_MARK_END ||
+                (blob[1] != GAIA_LITTLE_ENDIAN && blob[1] != GAIA_BIG_ENDIAN))
+            {
+                return decodeGaiaBlob(blob, size, arena);
+            }
+            const int arch = gaiaEndianArch();
+            const int little = blob[1] == GAIA_LITTLE_ENDIAN;
+            const int type = gaiaImport32(blob + 39, little, arch);
+            const int declared = type % 1000;
+            if (type < 0 || type >= 4000 ||
+                declared < GAIA_POINT || declared > GAIA_GEOMETRYCOLLECTION)
+            {
+                return decodeGaiaBlob(blob, size, arena);
+            }
+
+            BlobReader reader;
+            reader.position = blob + 43;
+            reader.end = blob + size - 1;
+            reader.base = type - declared;
+            reader.swap = little != arch;
+            switch (reader.base)
+            {
+            case 1000:
+                reader.geometry = allocGeometry(GAIA_XY_Z, arena);
+                break;
+            case 2000:
+                reader.geometry = allocGeometry(GAIA_XY_M, arena);
+                break;
+            case 3000:
+                reader.geometry = allocGeometry(GAIA_XY_Z_M, arena);
+                break;
+            default:
+                reader.geometry = allocGeometry(GAIA_XY, arena);
+            }
+            reader.arena = arena;
+            reader.stride = CoordinateBuffer::getStride(reader.geometry->DimensionModel);
+            const bool valid = declared <= GAIA_POLYGON ?
+                reader.readElement(type) : reader.readCollection();
+            if (!valid || reader.position != reader.end)
+            {
+                freeGeometry(reader.geometry, arena);
+                return decodeGaiaBlob(blob, size, arena);
+            }
+
+            // ==================================================
+            // Header fields are set as gaiaFromSpatiaLiteBlobWkb leaves them
+            // --------------------------------------------------
+            gaiaGeomCollPtr geometry = reader.geometry;
+            geometry->Srid = gaiaImport32(blob + 2, little, arch);
+            geometry->endian_arch = (char)arch;
+            geometry->endian = (char)little;
+            geometry->blob = blob;
+            geometry->size = size;
+            geometry->offset = size - 1;
+            geometry->MinX = gaiaImport64(blob + 6, little, arch);
+            geometry->MinY = gaiaImport64(blob + 14, little, arch);
+            geometry->MaxX = gaiaImport64(blob + 22, little, arch);
+            geometry->MaxY = gaiaImport64(blob + 30, little, arch);
+            geometry->DeclaredType = declared;
+            return geometry;
+        }
+
+        /**
+         * @brief Decodes a TWKB geometry on the heap or in an arena
+         */
+        gaiaGeomCollPtr decodeTwkb(const unsigned char * twkb,
+                                   int size,
+                                   int srid,
+                                   int * used,
+                                   std::vector<sqlite3_int64> * ids,
+                                   GeometryArena * arena)
+        {
+            if (!twkb || size < 2) return 0;
+            Reader reader;
+            reader.position = twkb;
+            reader.end = twkb + size;
+            reader.model = -1;
+            int type = 0;
+            int flags = 0;
+            if (!reader.readHeader(type, flags)) return 0;
+
+            // ==================================================
+            // The first header gives the dimensions of the geometry
+            // --------------------------------------------------
+            GeometrySink sink;
+            sink.geometry = allocGeometry(reader.model, arena);
+            sink.arena = arena;
+            sink.current = 0;
+            sink.cursor = 0;
+            sink.stride = reader.quantizer.dimensions;
+            const size_t known = ids ? ids->size() : 0;
+            if (!reader.readBody(sink, type, flags, 0, ids) ||
+                (!used && reader.position != reader.end))
+            {
+                if (ids) ids->resize(known);
+                freeGeometry(sink.geometry, arena);
+                return 0;
+            }
+            if (used) *used = (int)(reader.position - twkb);
+            sink.geometry->Srid = srid;
+            sink.geometry->DeclaredType = type;
+            gaiaMbrGeometry(sink.geometry);
+            return sink.geometry;
+        }
+
+    }
+
+    Blob::TwkbOptions::TwkbOptions() :
+        bbox(false),
+        ids(),
+        precision(7),
+        precisionM(0),
+        precisionZ(0)
+    {
+    }
+
     Blob::Blob(BlobType blob, int size) :
         BufferSized<BlobType>(blob, size, Blob::clean)
     {
@@ -27,6 +1109,64 @@ namespace SpatiaLite
         }
     }
 
+    gaiaGeomCollPtr Blob::fromSpatiaLiteBlobWkb(const unsigned char * blob, int size)
+    {
+        return decodeBlob(blob, size, 0);
+    }
+
+    gaiaGeomCollPtr Blob::fromSpatiaLiteBlobWkb(const unsigned char * blob,
+                                                int size,
+                                                GeometryArena & arena)
+    {
+        return decodeBlob(blob, size, &arena);
+    }
+
+    gaiaGeomCollPtr Blob::fromTwkb(const unsigned char * twkb,
+                                   int size,
+                                   int srid,
+                                   int * used,
+                                   std::vector<sqlite3_int64> * ids)
+    {
+        return decodeTwkb(twkb, size, srid, used, ids, 0);
+    }
+
+    gaiaGeomCollPtr Blob::fromTwkb(const unsigned char * twkb,
+                                   int size,
+                                   GeometryArena & arena,
+                                   int srid,
+                                   int * used)
+    {
+        return decodeTwkb(twkb, size, srid, used, 0, &arena);
+    }
+
+    int Blob::fromTwkb(const unsigned char * twkb,
+                       int size,
+                       CoordinateBuffer & buffer,
+                       std::vector<int> * parts)
+    {
+        if (!twkb || size < 2) return 0;
+        Reader reader;
+        reader.position = twkb;
+        reader.end = twkb + size;
+        reader.model = -1;
+        int type = 0;
+        int flags = 0;
+        if (!reader.readHeader(type, flags)) return 0;
+        BufferSink sink;
+        sink.buffer = &buffer;
+        sink.parts = parts;
+        sink.model = reader.model;
+        const int points = buffer.getSize();
+        const size_t known = parts ? parts->size() : 0;
+        if (!reader.readBody(sink, type, flags, 0, 0))
+        {
+            buffer.truncate(points);
+            if (parts) parts->resize(known);
+            return 0;
+        }
+        return (int)(reader.position - twkb);
+    }
+
     Blob * Blob::toCompressedBlobWkb(gaiaGeomCollPtr geometry)
     {
         int size = 0;
@@ -66,6 +1206,40 @@ namespace SpatiaLite
         return new SpatiaLite::Blob(blob, size);
     }
 
+    Blob * Blob::toTwkb(gaiaGeomCollPtr geometry, TwkbOptions const & options)
+    {
+        std::vector<unsigned char> output;
+        Blob::toTwkb(geometry, output, options);
+        BlobType blob = (BlobType)std::malloc(output.size());
+        if (!blob) throw std::runtime_error("Failed to convert to TWKB!");
+        std::memcpy(blob, &output[0], output.size());
+        return new SpatiaLite::Blob(blob, (int)output.size());
+    }
+
+    void Blob::toTwkb(gaiaGeomCollPtr geometry,
+                      std::vector<unsigned char> & output,
+                      TwkbOptions const & options)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        if (options.precision < -7 || options.precision > 7 ||
+            options.precisionZ < 0 || options.precisionZ > 7 ||
+            options.precisionM < 0 || options.precisionM > 7)
+        {
+            throw std::runtime_error("Invalid TWKB precision!");
+        }
+        const size_t start = output.size();
+        try
+        {
+            Writer writer(output, options, geometry->DimensionModel);
+            writer.appendGeometry(geometry);
+        }
+        catch (...)
+        {
+            output.resize(start);
+            throw;
+        }
+    }
+
     Blob * Blob::toWkb(gaiaGeomCollPtr geometry)
     {
         int size = 0;
@@ -0,0 +1,463 @@
+/**
+ * @file    BlobEncoding.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main BlobEncoding class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/BlobEncoding.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/Blob.h"
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/GeometryArena.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        /**
+         * @brief First byte of a quantized BLOB
+         */
+        const unsigned char QUANTIZED_MARK = 0x80;
+
+        /**
+         * @brief Last byte of a quantized BLOB (as GAIA_MARK_END)
+         */
+        const unsigned char QUANTIZED_END = 0xFE;
+
+        /**
+         * @brief Smallest quantized BLOB: marker, SRID, TWKB type and
+         *        metadata bytes, and trailer
+         */
+        const int QUANTIZED_MIN_SIZE = 5;
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Appends an unsigned LEB128 varint
+         */
+        void appendVarint(std::vector<unsigned char> & output,
+                          unsigned long long value)
+        {
+            while (value >= 0x80)
+            {
+                output.push_back((unsigned char)((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            output.push_back((unsigned char)value);
+        }
+
+        /**
+         * @returns Number of ordinates of a dimension model
+         */
+        int getDimensions(int model)
+        {
+            return CoordinateBuffer::getStride(model);
+        }
+
+        /**
+         * @brief Decodes a quantized BLOB
+         * @details The TWKB must fill the BLOB up to the trailer.
+         * @returns Geometry, in the arena if set, or null if invalid
+         */
+        gaiaGeomCollPtr decodeQuantized(const unsigned char * blob,
+                                        int size,
+                                        GeometryArena * arena = 0)
+        {
+            // Zig-zag varint SRID after the marker
+            size--;
+            unsigned long long srid = 0;
+            int i = 1;
+            for (int shift = 0; ; shift += 7, i++)
+            {
+                if (i >= size || shift >= 64) return 0;
+                srid |= (unsigned long long)(blob[i] & 0x7F) << shift;
+                if (!(blob[i] & 0x80)) break;
+            }
+            i++;
+            const long long value = (long long)(srid >> 1) ^ -(long long)(srid & 1);
+            int used = 0;
+            gaiaGeomCollPtr geometry = arena ?
+                Blob::fromTwkb(blob + i, size - i, *arena, (int)value, &used) :
+                Blob::fromTwkb(blob + i, size - i, (int)value, &used);
+            if (geometry && used != size - i)
+            {
+                if (!arena) gaiaFreeGeomColl(geometry);
+                return 0;
+            }
+            return geometry;
+        }
+
+        /**
+         * @returns True if a BLOB is framed as a quantized BLOB
+         */
+        bool isQuantized(const unsigned char * blob, int size)
+        {
+            return size >= QUANTIZED_MIN_SIZE &&
+                   blob[0] == QUANTIZED_MARK &&
+                   blob[size - 1] == QUANTIZED_END;
+        }
+
+        /**
+         * @brief Encodes a geometry into a quantized BLOB
+         */
+        void encodeQuantized(std::vector<unsigned char> & output,
+                             gaiaGeomCollPtr geometry,
+                             int precision)
+        {
+            const long long srid = geometry->Srid;
+            Blob::TwkbOptions options;
+            options.precision = precision;
+            options.precisionZ = std::max(precision, 0);
+            options.precisionM = options.precisionZ;
+            output.clear();
+            output.push_back(QUANTIZED_MARK);
+            appendVarint(output, ((unsigned long long)srid << 1) ^
+                                 (unsigned long long)(srid >> 63));
+            Blob::toTwkb(geometry, output, options);
+            output.push_back(QUANTIZED_END);
+        }
+
+        // ==================================================
+        // Statistics helpers
+        // --------------------------------------------------
+
+        /**
+         * @returns Largest ordinate difference of two coordinate arrays
+         */
+        double getError(const double * a, const double * b, int count)
+        {
+            double error = 0;
+            for (int i = 0; i < count; i++)
+            {
+                const double d = std::fabs(a[i] - b[i]);
+                if (d > error) error = d;
+            }
+            return error;
+        }
+
+        /**
+         * @returns Largest ordinate difference of two geometries of the
+         *          same layout, or infinity if their layouts differ
+         */
+        double getError(gaiaGeomCollPtr a, gaiaGeomCollPtr b)
+        {
+            double error = 0;
+            gaiaPointPtr p = a->FirstPoint;
+            gaiaPointPtr q = b->FirstPoint;
+            for (; p && q; p = p->Next, q = q->Next)
+            {
+                const double pc[4] = {p->X, p->Y, p->Z, p->M};
+                const double qc[4] = {q->X, q->Y, q->Z, q->M};
+                error = std::max(error, getError(pc, qc, 4));
+            }
+            if (p || q) return HUGE_VAL;
+            gaiaLinestringPtr l = a->FirstLinestring;
+            gaiaLinestringPtr m = b->FirstLinestring;
+            for (; l && m; l = l->Next, m = m->Next)
+            {
+                if (l->Points != m->Points) return HUGE_VAL;
+                error = std::max(error, getError(l->Coords, m->Coords,
+                                                 l->Points * getDimensions(l->DimensionModel)));
+            }
+            if (l || m) return HUGE_VAL;
+            gaiaPolygonPtr s = a->FirstPolygon;
+            gaiaPolygonPtr t = b->FirstPolygon;
+            for (; s && t; s = s->Next, t = t->Next)
+            {
+                if (s->NumInteriors != t->NumInteriors) return HUGE_VAL;
+                for (int i = -1; i < s->NumInteriors; i++)
+                {
+                    gaiaRingPtr r = i < 0 ? s->Exterior : s->Interiors + i;
+                    gaiaRingPtr u = i < 0 ? t->Exterior : t->Interiors + i;
+                    if (r->Points != u->Points) return HUGE_VAL;
+                    error = std::max(error, getError(r->Coords, u->Coords,
+                                                     r->Points * getDimensions(r->DimensionModel)));
+                }
+            }
+            if (s || t) return HUGE_VAL;
+            return error;
+        }
+
+    }
+
+    BlobEncoding::BlobEncoding(int mode, int precision) :
+        _mode(mode),
+        _precision(precision)
+    {
+        if (mode < UNCOMPRESSED || mode > QUANTIZED)
+        {
+            throw std::runtime_error("Invalid mode!");
+        }
+        if (precision < -7 || precision > 7)
+        {
+            throw std::runtime_error("Invalid precision!");
+        }
+    }
+
+    BlobEncoding::~BlobEncoding()
+    {
+    }
+
+    BlobEncoding::Report BlobEncoding::apply(SpatialDatabase const & database,
+                                             std::string const & table,
+                                             std::string const & geometry) const
+    {
+        SQLite::Database & connection = *database.getDatabase();
+        const std::string column = quoteName(geometry);
+
+        // ==================================================
+        // SpatiaLite triggers and spatial indexes only read SpatiaLite
+        // BLOBs, so registered columns are never quantized
+        // --------------------------------------------------
+        if (this->_mode == QUANTIZED && connection.tableExists("geometry_columns"))
+        {
+            SQLite::Statement registered(connection,
+                                         "SELECT 1 FROM geometry_columns WHERE "
+                                         "Lower(f_table_name) = Lower(?) AND "
+                                         "Lower(f_geometry_column) = Lower(?)");
+            registered.bind(1, table);
+            registered.bind(2, geometry);
+            if (registered.executeStep())
+            {
+                throw std::runtime_error("Cannot quantize a registered geometry column!");
+            }
+        }
+
+        // Qualified so that a missing column is not read as a string
+        SQLite::Statement select(connection,
+                                 "SELECT t.rowid, t." + column + " FROM " +
+                                 quoteName(table) + " AS t WHERE t.rowid > ? "
+                                 "ORDER BY t.rowid LIMIT 1024");
+        SQLite::Statement update(connection,
+                                 "UPDATE " + quoteName(table) + " SET " +
+                                 column + " = ? WHERE rowid = ?");
+        Report report = {0, 0, 0};
+
+        // ==================================================
+        // Rows are read in pages by rowid, so no read is open on the
+        // table while it is updated
+        // --------------------------------------------------
+        connection.exec("SAVEPOINT blob_encoding");
+        try
+        {
+            std::vector<sqlite3_int64> ids;
+            std::vector<std::string> blobs;
+            sqlite3_int64 last = LLONG_MIN;
+            int fetched = 0;
+            ids.reserve(1024);
+            blobs.reserve(1024);
+            do
+            {
+                ids.clear();
+                blobs.clear();
+                fetched = 0;
+                select.bind(1, last);
+                while (select.executeStep())
+                {
+                    fetched++;
+                    last = select.getColumn(0).getInt64();
+                    SQLite::Column value = select.getColumn(1);
+                    if (value.getType() != SQLITE_BLOB) continue;
+                    ids.push_back(last);
+                    blobs.push_back(std::string((const char *)value.getBlob(),
+                                                value.getBytes()));
+                }
+                select.reset();
+                for (size_t i = 0; i < ids.size(); i++)
+                {
+                    gaiaGeomCollPtr decoded = decode(
+                        (const unsigned char *)blobs[i].data(), (int)blobs[i].size());
+                    if (!decoded) continue;
+                    std::unique_ptr<Blob> encoded;
+                    try
+                    {
+                        encoded.reset(this->encode(decoded));
+                    }
+                    catch (...)
+                    {
+                        gaiaFreeGeomColl(decoded);
+                        throw;
+                    }
+                    gaiaFreeGeomColl(decoded);
+                    update.bind(1, encoded->get(), encoded->getSize());
+                    update.bind(2, ids[i]);
+                    update.exec();
+                    update.reset();
+                    report.rows++;
+                    report.bytesBefore += (long long)blobs[i].size();
+                    report.bytesAfter += encoded->getSize();
+                }
+            } while (fetched == 1024);
+        }
+        catch (...)
+        {
+            connection.exec("ROLLBACK TO blob_encoding");
+            connection.exec("RELEASE blob_encoding");
+            throw;
+        }
+        connection.exec("RELEASE blob_encoding");
+        return report;
+    }
+
+    gaiaGeomCollPtr BlobEncoding::decode(const unsigned char * blob, int size)
+    {
+        if (!blob || size < 1) return 0;
+        if (isQuantized(blob, size)) return decodeQuantized(blob, size);
+        return Blob::fromSpatiaLiteBlobWkb(blob, size);
+    }
+
+    gaiaGeomCollPtr BlobEncoding::decode(const unsigned char * blob,
+                                         int size,
+                                         GeometryArena & arena)
+    {
+        if (!blob || size < 1) return 0;
+        if (isQuantized(blob, size)) return decodeQuantized(blob, size, &arena);
+        return Blob::fromSpatiaLiteBlobWkb(blob, size, arena);
+    }
+
+    Blob * BlobEncoding::encode(gaiaGeomCollPtr geometry) const
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        if (this->_mode == COMPRESSED) return Blob::toCompressedBlobWkb(geometry);
+        if (this->_mode == UNCOMPRESSED) return Blob::toSpatiaLiteBlobWkb(geometry);
+        std::vector<unsigned char> output;
+        encodeQuantized(output, geometry, this->_precision);
+        BlobType blob = (BlobType)std::malloc(output.size());
+        if (!blob) throw std::runtime_error("Failed to quantize blob!");
+        std::memcpy(blob, &output[0], output.size());
+        return new SpatiaLite::Blob(blob, (int)output.size());
+    }
+
+    int BlobEncoding::getMode() const
+    {
+        return this->_mode;
+    }
+
+    int BlobEncoding::getPrecision() const
+    {
+        return this->_precision;
+    }
+
+    BlobEncoding::Statistics BlobEncoding::measure(SpatialDatabase const & database,
+                                                   std::string const & table,
+                                                   std::string const & geometry,
+                                                   int precision,
+                                                   int sampleSize)
+    {
+        if (precision < -7 || precision > 7)
+        {
+            throw std::runtime_error("Invalid precision!");
+        }
+        if (sampleSize < 1) throw std::runtime_error("Invalid sample size!");
+        SQLite::Statement select(*database.getDatabase(),
+                                 "SELECT t." + quoteName(geometry) + " FROM " +
+                                 quoteName(table) + " AS t LIMIT ?");
+        select.bind(1, sampleSize);
+
+        // ==================================================
+        // Encode the sample every way, then time each decoding on its own
+        // --------------------------------------------------
+        Statistics statistics = {0, {0, 0, 0}, {0, 0, 0}, 0};
+        std::vector<std::string> encoded[3];
+        std::vector<unsigned char> quantized;
+        while (select.executeStep())
+        {
+            SQLite::Column value = select.getColumn(0);
+            if (value.getType() != SQLITE_BLOB) continue;
+            gaiaGeomCollPtr decoded = decode((const unsigned char *)value.getBlob(),
+                                             value.getBytes());
+            if (!decoded) continue;
+            std::unique_ptr<Blob> blob;
+            try
+            {
+                blob.reset(Blob::toSpatiaLiteBlobWkb(decoded));
+                encoded[UNCOMPRESSED].push_back(
+                    std::string((const char *)blob->get(), blob->getSize()));
+                blob.reset(Blob::toCompressedBlobWkb(decoded));
+                encoded[COMPRESSED].push_back(
+                    std::string((const char *)blob->get(), blob->getSize()));
+                encodeQuantized(quantized, decoded, precision);
+                encoded[QUANTIZED].push_back(
+                    std::string((const char *)&quantized[0], quantized.size()));
+            }
+            catch (...)
+            {
+                gaiaFreeGeomColl(decoded);
+                throw;
+            }
+
+            gaiaGeomCollPtr rounded = decodeQuantized(&quantized[0],
+                                                      (int)quantized.size());
+            if (rounded)
+            {
+                statistics.maxError = std::max(statistics.maxError,
+                                               getError(decoded, rounded));
+                gaiaFreeGeomColl(rounded);
+            }
+            gaiaFreeGeomColl(decoded);
+            statistics.geometries++;
+        }
+
+        for (int mode = UNCOMPRESSED; mode <= QUANTIZED; mode++)
+        {
+            std::vector<std::string> const & blobs = encoded[mode];
+            const std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            for (size_t i = 0; i < blobs.size(); i++)
+            {
+                statistics.bytes[mode] += (long long)blobs[i].size();
+                gaiaGeomCollPtr decoded = decode(
+                    (const unsigned char *)blobs[i].data(), (int)blobs[i].size());
+                if (decoded) gaiaFreeGeomColl(decoded);
+            }
+            const double elapsed = (double)
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+            if (!blobs.empty()) statistics.decodeTime[mode] = elapsed / blobs.size();
+        }
+        return statistics;
+    }
+
+    int BlobEncoding::select(Statistics const & statistics,
+                             double minimumSaving,
+                             double tolerance)
+    {
+        const double uncompressed = (double)statistics.bytes[UNCOMPRESSED];
+        const double compressed = (double)statistics.bytes[COMPRESSED];
+        const double quantized = (double)statistics.bytes[QUANTIZED];
+        if (uncompressed <= 0) return UNCOMPRESSED;
+        const double limit = 1 - minimumSaving;
+        if (statistics.maxError <= tolerance &&
+            quantized <= limit * uncompressed && quantized <= limit * compressed)
+        {
+            return QUANTIZED;
+        }
+        if (compressed <= limit * uncompressed) return COMPRESSED;
+        return UNCOMPRESSED;
+    }
+
+}
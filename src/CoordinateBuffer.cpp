@@ -0,0 +1,374 @@
+/**
+ * @file    CoordinateBuffer.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main CoordinateBuffer class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+
+#include "SpatiaLiteCpp/LineString.h"
+#include "SpatiaLiteCpp/Ring.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace SpatiaLite
+{
+
+    CoordinateBuffer::CoordinateBuffer(int dimensions, int capacity) :
+        _block(0),
+        _capacity(0),
+        _dimensions(dimensions),
+        _size(0),
+        _x(0),
+        _y(0),
+        _z(0),
+        _m(0)
+    {
+        CoordinateBuffer::getStride(dimensions);
+        this->reserve(capacity);
+    }
+
+    CoordinateBuffer::~CoordinateBuffer()
+    {
+        delete [] this->_block;
+    }
+
+    void CoordinateBuffer::append(double x, double y, double z, double m)
+    {
+        if (this->_size == this->_capacity)
+        {
+            this->reserve(this->_capacity < 8 ? 8 : this->_capacity * 2);
+        }
+        this->_x[this->_size] = x;
+        this->_y[this->_size] = y;
+        if (this->_z) this->_z[this->_size] = z;
+        if (this->_m) this->_m[this->_size] = m;
+        this->_size++;
+    }
+
+    void CoordinateBuffer::clear()
+    {
+        this->_size = 0;
+    }
+
+    CoordinateBuffer * CoordinateBuffer::fromCoords(const double * coords,
+                                                    int points,
+                                                    int dimensions)
+    {
+        if (!coords && points > 0) throw std::runtime_error("Invalid coordinates!");
+        int stride = CoordinateBuffer::getStride(dimensions);
+        CoordinateBuffer * buffer = new CoordinateBuffer(dimensions, points);
+        double * x = buffer->_x;
+        double * y = buffer->_y;
+        for (int i = 0; i < points; i++)
+        {
+            x[i] = coords[i * stride];
+            y[i] = coords[i * stride + 1];
+        }
+        if (buffer->_z)
+        {
+            double * z = buffer->_z;
+            for (int i = 0; i < points; i++) z[i] = coords[i * stride + 2];
+        }
+        if (buffer->_m)
+        {
+            double * m = buffer->_m;
+            int offset = stride - 1;
+            for (int i = 0; i < points; i++) m[i] = coords[i * stride + offset];
+        }
+        buffer->_size = points;
+        return buffer;
+    }
+
+    CoordinateBuffer * CoordinateBuffer::fromDynamicLine(
+        gaiaDynamicLinePtr line,
+        int dimensions)
+    {
+        if (!line) throw std::runtime_error("Invalid dynamic line!");
+        int points = 0;
+        for (gaiaPointPtr p = line->First; p; p = p->Next) points++;
+        CoordinateBuffer * buffer = new CoordinateBuffer(dimensions, points);
+        for (gaiaPointPtr p = line->First; p; p = p->Next)
+        {
+            buffer->append(p->X, p->Y, p->Z, p->M);
+        }
+        return buffer;
+    }
+
+    CoordinateBuffer * CoordinateBuffer::fromLineString(gaiaLinestringPtr line)
+    {
+        if (!line) throw std::runtime_error("Invalid line string!");
+        return CoordinateBuffer::fromCoords(line->Coords,
+                                            line->Points,
+                                            line->DimensionModel);
+    }
+
+    CoordinateBuffer * CoordinateBuffer::fromRing(gaiaRingPtr ring)
+    {
+        if (!ring) throw std::runtime_error("Invalid ring!");
+        return CoordinateBuffer::fromCoords(ring->Coords,
+                                            ring->Points,
+                                            ring->DimensionModel);
+    }
+
+    double CoordinateBuffer::getArea() const
+    {
+        const int n = this->_size;
+        if (n < 3) return 0;
+        const double * x = this->_x;
+        const double * y = this->_y;
+        double sum = 0;
+        for (int i = 0; i < n - 1; i++)
+        {
+            sum += x[i] * y[i + 1] - x[i + 1] * y[i];
+        }
+        sum += x[n - 1] * y[0] - x[0] * y[n - 1];
+        return std::fabs(sum) / 2;
+    }
+
+    bool CoordinateBuffer::getBounds(double & minx,
+                                     double & miny,
+                                     double & maxx,
+                                     double & maxy) const
+    {
+        const int n = this->_size;
+        if (n == 0) return false;
+        const double * x = this->_x;
+        const double * y = this->_y;
+        double x0 = x[0], x1 = x[0], y0 = y[0], y1 = y[0];
+        for (int i = 1; i < n; i++)
+        {
+            x0 = x[i] < x0 ? x[i] : x0;
+            x1 = x[i] > x1 ? x[i] : x1;
+            y0 = y[i] < y0 ? y[i] : y0;
+            y1 = y[i] > y1 ? y[i] : y1;
+        }
+        minx = x0;
+        miny = y0;
+        maxx = x1;
+        maxy = y1;
+        return true;
+    }
+
+    int CoordinateBuffer::getCapacity() const
+    {
+        return this->_capacity;
+    }
+
+    int CoordinateBuffer::getDimensions() const
+    {
+        return this->_dimensions;
+    }
+
+    double CoordinateBuffer::getLength() const
+    {
+        const int n = this->_size;
+        const double * x = this->_x;
+        const double * y = this->_y;
+        double length = 0;
+        for (int i = 1; i < n; i++)
+        {
+            double dx = x[i] - x[i - 1];
+            double dy = y[i] - y[i - 1];
+            length += std::sqrt(dx * dx + dy * dy);
+        }
+        return length;
+    }
+
+    int CoordinateBuffer::getSize() const
+    {
+        return this->_size;
+    }
+
+    int CoordinateBuffer::getStride(int dimensions)
+    {
+        if (dimensions == GAIA_XY) return 2;
+        if (dimensions == GAIA_XY_Z || dimensions == GAIA_XY_M) return 3;
+        if (dimensions == GAIA_XY_Z_M) return 4;
+        throw std::runtime_error("Invalid dimension model!");
+    }
+
+    const double * CoordinateBuffer::getX() const
+    {
+        return this->_x;
+    }
+
+    double * CoordinateBuffer::getX()
+    {
+        return this->_x;
+    }
+
+    const double * CoordinateBuffer::getY() const
+    {
+        return this->_y;
+    }
+
+    double * CoordinateBuffer::getY()
+    {
+        return this->_y;
+    }
+
+    const double * CoordinateBuffer::getZ() const
+    {
+        return this->_z;
+    }
+
+    double * CoordinateBuffer::getZ()
+    {
+        return this->_z;
+    }
+
+    const double * CoordinateBuffer::getM() const
+    {
+        return this->_m;
+    }
+
+    double * CoordinateBuffer::getM()
+    {
+        return this->_m;
+    }
+
+    void CoordinateBuffer::reserve(int capacity)
+    {
+        if (capacity <= this->_capacity) return;
+
+        // ==================================================
+        // Carve all arrays out of one block
+        // --------------------------------------------------
+        int stride = CoordinateBuffer::getStride(this->_dimensions);
+        double * block = new double[(size_t)capacity * stride];
+        double * x = block;
+        double * y = x + capacity;
+        double * z = 0;
+        double * m = 0;
+        double * next = y + capacity;
+        if (this->_dimensions == GAIA_XY_Z ||
+            this->_dimensions == GAIA_XY_Z_M)
+        {
+            z = next;
+            next += capacity;
+        }
+        if (this->_dimensions == GAIA_XY_M ||
+            this->_dimensions == GAIA_XY_Z_M)
+        {
+            m = next;
+        }
+
+        // ==================================================
+        // Move existing points
+        // --------------------------------------------------
+        size_t bytes = sizeof(double) * this->_size;
+        if (bytes > 0)
+        {
+            std::memcpy(x, this->_x, bytes);
+            std::memcpy(y, this->_y, bytes);
+            if (z) std::memcpy(z, this->_z, bytes);
+            if (m) std::memcpy(m, this->_m, bytes);
+        }
+
+        delete [] this->_block;
+        this->_block = block;
+        this->_capacity = capacity;
+        this->_x = x;
+        this->_y = y;
+        this->_z = z;
+        this->_m = m;
+    }
+
+    void CoordinateBuffer::toCoords(double * coords) const
+    {
+        const int n = this->_size;
+        const int stride = CoordinateBuffer::getStride(this->_dimensions);
+        for (int i = 0; i < n; i++)
+        {
+            coords[i * stride] = this->_x[i];
+            coords[i * stride + 1] = this->_y[i];
+        }
+        if (this->_z)
+        {
+            for (int i = 0; i < n; i++) coords[i * stride + 2] = this->_z[i];
+        }
+        if (this->_m)
+        {
+            int offset = stride - 1;
+            for (int i = 0; i < n; i++) coords[i * stride + offset] = this->_m[i];
+        }
+    }
+
+    LineString * CoordinateBuffer::toLineString() const
+    {
+        gaiaLinestringPtr line = 0;
+        if (this->_dimensions == GAIA_XY_Z)
+        {
+            line = gaiaAllocLinestringXYZ(this->_size);
+        }
+        else if (this->_dimensions == GAIA_XY_M)
+        {
+            line = gaiaAllocLinestringXYM(this->_size);
+        }
+        else if (this->_dimensions == GAIA_XY_Z_M)
+        {
+            line = gaiaAllocLinestringXYZM(this->_size);
+        }
+        else
+        {
+            line = gaiaAllocLinestring(this->_size);
+        }
+        LineString * wrapper = new LineString(line);
+        this->toCoords(line->Coords);
+        return wrapper;
+    }
+
+    Ring * CoordinateBuffer::toRing() const
+    {
+        gaiaRingPtr ring = 0;
+        if (this->_dimensions == GAIA_XY_Z)
+        {
+            ring = gaiaAllocRingXYZ(this->_size);
+        }
+        else if (this->_dimensions == GAIA_XY_M)
+        {
+            ring = gaiaAllocRingXYM(this->_size);
+        }
+        else if (this->_dimensions == GAIA_XY_Z_M)
+        {
+            ring = gaiaAllocRingXYZM(this->_size);
+        }
+        else
+        {
+            ring = gaiaAllocRing(this->_size);
+        }
+        Ring * wrapper = new Ring(ring);
+        this->toCoords(ring->Coords);
+        return wrapper;
+    }
+
+    void CoordinateBuffer::transform(double a,
+                                     double b,
+                                     double d,
+                                     double e,
+                                     double xoff,
+                                     double yoff)
+    {
+        const int n = this->_size;
+        double * x = this->_x;
+        double * y = this->_y;
+        for (int i = 0; i < n; i++)
+        {
+            double xi = x[i];
+            double yi = y[i];
+            x[i] = a * xi + b * yi + xoff;
+            y[i] = d * xi + e * yi + yoff;
+        }
+    }
+
+    void CoordinateBuffer::truncate(int size)
+    {
+        if (size >= 0 && size < this->_size) this->_size = size;
+    }
+
+}
@@ -0,0 +1,580 @@
+/**
+ * @file    FeatureWriter.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main FeatureWriter class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/FeatureWriter.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @returns True if the character may appear in an XML element name
+         */
+        bool isNameChar(char c, bool first)
+        {
+            if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_')
+            {
+                return true;
+            }
+            return !first && ((c >= '0' && c <= '9') || c == '-' || c == '.');
+        }
+
+        /**
+         * @returns Column name made into a valid XML element name
+         */
+        std::string toElementName(const char * name)
+        {
+            std::string element(name ? name : "");
+            if (element.empty()) return "_";
+            for (size_t i = 0; i < element.size(); i++)
+            {
+                if (!isNameChar(element[i], i == 0)) element[i] = '_';
+            }
+            return element;
+        }
+
+    }
+
+    FeatureWriter::FeatureWriter(int fd,
+                                 int format,
+                                 int precision,
+                                 size_t capacity) :
+        _buffer(),
+        _bytes(0),
+        _count(0),
+        _fd(fd),
+        _format(format),
+        _name(),
+        _precision(precision),
+        _text(new gaiaOutBuffer()),
+        _used(0),
+        _writes(0)
+    {
+        if (fd < 0) throw std::runtime_error("Invalid file descriptor!");
+        if (format < FeatureWriter::GEOJSON || format > FeatureWriter::WKT)
+        {
+            throw std::runtime_error("Invalid format!");
+        }
+        if (precision < 0 || precision > 17)
+        {
+            throw std::runtime_error("Invalid precision!");
+        }
+        if (capacity == 0) throw std::runtime_error("Invalid buffer capacity!");
+        this->_buffer.resize(capacity);
+    }
+
+    FeatureWriter::~FeatureWriter()
+    {
+    }
+
+    void FeatureWriter::append(const char * data, size_t size)
+    {
+        if (size > this->_buffer.size() - this->_used)
+        {
+            this->flush();
+
+            // Larger than the whole buffer: bypass it
+            if (size >= this->_buffer.size())
+            {
+                this->writeAll(data, size);
+                return;
+            }
+        }
+        std::memcpy(&this->_buffer[this->_used], data, size);
+        this->_used += size;
+    }
+
+    void FeatureWriter::append(const char * text)
+    {
+        this->append(text, std::strlen(text));
+    }
+
+    void FeatureWriter::appendEscaped(const char * text)
+    {
+        const char * run = text;
+        const char * c = text;
+        for (; *c; c++)
+        {
+            const unsigned char u = (unsigned char)*c;
+            const char * replacement = 0;
+            char code[8];
+
+            // ==================================================
+            // Pick the escape sequence of special characters
+            // --------------------------------------------------
+            if (this->_format == FeatureWriter::GEOJSON)
+            {
+                if (u == '"') replacement = "\\\"";
+                else if (u == '\\') replacement = "\\\\";
+                else if (u < 0x20)
+                {
+                    std::snprintf(code, sizeof(code), "\\u%04x", u);
+                    replacement = code;
+                }
+            }
+            else if (this->_format == FeatureWriter::WKT)
+            {
+                if (u == '\t' || u == '\n' || u == '\r') replacement = " ";
+            }
+            else
+            {
+                if (u == '&') replacement = "&amp;";
+                else if (u == '<') replacement = "&lt;";
+                else if (u == '>') replacement = "&gt;";
+                else if (u == '"') replacement = "&quot;";
+                else if (u == '\'') replacement = "&apos;";
+            }
+            if (!replacement) continue;
+
+            // ==================================================
+            // Copy the plain run before it in one piece
+            // --------------------------------------------------
+            this->append(run, c - run);
+            this->append(replacement);
+            run = c + 1;
+        }
+        this->append(run, c - run);
+    }
+
+    void FeatureWriter::appendGeometry()
+    {
+        if (this->_text.getSize() > 0)
+        {
+            this->append(this->_text.getData(), this->_text.getSize());
+        }
+        else if (this->_format == FeatureWriter::GEOJSON)
+        {
+            this->append("null");
+        }
+
+        // ==================================================
+        // Keep the allocation for the next feature unless an
+        // unusually large geometry grew it past the buffer size
+        // --------------------------------------------------
+        if (this->_text.getCapacity() > this->_buffer.size())
+        {
+            this->_text.shrink();
+        }
+        else
+        {
+            this->_text.clear();
+        }
+    }
+
+    void FeatureWriter::appendValue(sqlite3_stmt * row, int column)
+    {
+        const int type = sqlite3_column_type(row, column);
+        if (type == SQLITE_INTEGER)
+        {
+            char number[32];
+            std::snprintf(number, sizeof(number), "%lld",
+                          (long long)sqlite3_column_int64(row, column));
+            this->append(number);
+        }
+        else if (type == SQLITE_FLOAT)
+        {
+            const double value = sqlite3_column_double(row, column);
+            if (!std::isfinite(value))
+            {
+                if (this->_format == FeatureWriter::GEOJSON) this->append("null");
+                return;
+            }
+
+            // 15 digits unless they do not round-trip
+            char number[32];
+            std::snprintf(number, sizeof(number), "%.15g", value);
+            if (std::strtod(number, 0) != value)
+            {
+                std::snprintf(number, sizeof(number), "%.17g", value);
+            }
+            this->append(number);
+        }
+        else if (type == SQLITE_TEXT)
+        {
+            const char * text = (const char *)sqlite3_column_text(row, column);
+            if (this->_format == FeatureWriter::GEOJSON) this->append("\"", 1);
+            this->appendEscaped(text ? text : "");
+            if (this->_format == FeatureWriter::GEOJSON) this->append("\"", 1);
+        }
+        else if (this->_format == FeatureWriter::GEOJSON)
+        {
+            this->append("null");
+        }
+    }
+
+    void FeatureWriter::begin(std::string const & name)
+    {
+        this->_name = toElementName(name.c_str());
+        this->_count = 0;
+        switch (this->_format)
+        {
+        case FeatureWriter::GEOJSON:
+            this->append("{\"type\":\"FeatureCollection\",\"features\":[");
+            break;
+        case FeatureWriter::GML:
+            this->append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                         "<gml:FeatureCollection"
+                         " xmlns:gml=\"http://www.opengis.net/gml\">\n");
+            break;
+        case FeatureWriter::KML:
+            this->append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                         "<kml xmlns=\"http://www.opengis.net/kml/2.2\">"
+                         "<Document><name>");
+            this->appendEscaped(name.c_str());
+            this->append("</name>\n");
+            break;
+        default:
+            // WKT writes its column header with the first feature
+            break;
+        }
+    }
+
+    void FeatureWriter::finish()
+    {
+        switch (this->_format)
+        {
+        case FeatureWriter::GEOJSON:
+            this->append("\n]}\n");
+            break;
+        case FeatureWriter::GML:
+            this->append("</gml:FeatureCollection>\n");
+            break;
+        case FeatureWriter::KML:
+            this->append("</Document></kml>\n");
+            break;
+        default:
+            if (this->_count == 0) this->append("WKT\n");
+            break;
+        }
+        this->flush();
+    }
+
+    void FeatureWriter::flush()
+    {
+        if (this->_used == 0) return;
+        const size_t used = this->_used;
+        this->_used = 0;
+        this->writeAll(&this->_buffer[0], used);
+    }
+
+    long long FeatureWriter::getBytes() const
+    {
+        return this->_bytes;
+    }
+
+    size_t FeatureWriter::getCapacity() const
+    {
+        return this->_buffer.size();
+    }
+
+    long long FeatureWriter::getFeatureCount() const
+    {
+        return this->_count;
+    }
+
+    long long FeatureWriter::getWrites() const
+    {
+        return this->_writes;
+    }
+
+    void FeatureWriter::serialize(gaiaGeomCollPtr geometry)
+    {
+        gaiaOutBufferPtr text = this->_text.get();
+        if (!geometry) return;
+        switch (this->_format)
+        {
+        case FeatureWriter::GEOJSON:
+            gaiaOutGeoJSON(text, geometry, this->_precision, 0);
+            break;
+        case FeatureWriter::GML:
+            gaiaOutGml(text, 3, this->_precision, geometry);
+            break;
+        case FeatureWriter::KML:
+            gaiaOutBareKml(text, geometry, this->_precision);
+            break;
+        default:
+            gaiaOutWktEx(text, geometry, this->_precision);
+            break;
+        }
+        if (text->Error)
+        {
+            this->_text.shrink();
+            throw std::runtime_error("Failed to serialize geometry!");
+        }
+    }
+
+    void FeatureWriter::write(gaiaGeomCollPtr geometry)
+    {
+        this->serialize(geometry);
+        switch (this->_format)
+        {
+        case FeatureWriter::GEOJSON:
+            this->append(this->_count ? ",\n" : "\n");
+            this->append("{\"type\":\"Feature\",\"geometry\":");
+            this->appendGeometry();
+            this->append(",\"properties\":{}}");
+            break;
+        case FeatureWriter::GML:
+            this->append("<gml:featureMember><");
+            this->append(this->_name.c_str());
+            this->append("><geometryProperty>");
+            this->appendGeometry();
+            this->append("</geometryProperty></");
+            this->append(this->_name.c_str());
+            this->append("></gml:featureMember>\n");
+            break;
+        case FeatureWriter::KML:
+            this->append("<Placemark>");
+            this->appendGeometry();
+            this->append("</Placemark>\n");
+            break;
+        default:
+            if (this->_count == 0) this->append("WKT\n");
+            this->appendGeometry();
+            this->append("\n", 1);
+            break;
+        }
+        this->_count++;
+    }
+
+    void FeatureWriter::write(sqlite3_stmt * row, int geometryColumn)
+    {
+        if (!row) throw std::runtime_error("Invalid statement!");
+        const int columns = sqlite3_column_count(row);
+        if (geometryColumn < 0 || geometryColumn >= columns)
+        {
+            throw std::runtime_error("Invalid geometry column!");
+        }
+
+        // ==================================================
+        // Decode and serialize the geometry
+        // --------------------------------------------------
+        if (sqlite3_column_type(row, geometryColumn) == SQLITE_BLOB)
+        {
+            gaiaGeomCollPtr geometry = BlobEncoding::decode(
+                (const unsigned char *)sqlite3_column_blob(row, geometryColumn),
+                sqlite3_column_bytes(row, geometryColumn));
+            if (geometry)
+            {
+                try
+                {
+                    this->serialize(geometry);
+                }
+                catch (...)
+                {
+                    gaiaFreeGeomColl(geometry);
+                    throw;
+                }
+                gaiaFreeGeomColl(geometry);
+            }
+        }
+
+        // ==================================================
+        // Write the feature and its properties
+        // --------------------------------------------------
+        switch (this->_format)
+        {
+        case FeatureWriter::GEOJSON:
+            {
+                this->append(this->_count ? ",\n" : "\n");
+                this->append("{\"type\":\"Feature\",\"geometry\":");
+                this->appendGeometry();
+                this->append(",\"properties\":{");
+                bool first = true;
+                for (int i = 0; i < columns; i++)
+                {
+                    if (i == geometryColumn) continue;
+                    this->append(first ? "\"" : ",\"");
+                    this->appendEscaped(sqlite3_column_name(row, i));
+                    this->append("\":");
+                    this->appendValue(row, i);
+                    first = false;
+                }
+                this->append("}}");
+            }
+            break;
+        case FeatureWriter::GML:
+            {
+                this->append("<gml:featureMember><");
+                this->append(this->_name.c_str());
+                this->append("><geometryProperty>");
+                this->appendGeometry();
+                this->append("</geometryProperty>");
+                for (int i = 0; i < columns; i++)
+                {
+                    const int type = sqlite3_column_type(row, i);
+                    if (i == geometryColumn) continue;
+                    if (type == SQLITE_NULL || type == SQLITE_BLOB) continue;
+                    const std::string name =
+                        toElementName(sqlite3_column_name(row, i));
+                    this->append("<");
+                    this->append(name.c_str());
+                    this->append(">");
+                    this->appendValue(row, i);
+                    this->append("</");
+                    this->append(name.c_str());
+                    this->append(">");
+                }
+                this->append("</");
+                this->append(this->_name.c_str());
+                this->append("></gml:featureMember>\n");
+            }
+            break;
+        case FeatureWriter::KML:
+            this->append("<Placemark><ExtendedData>");
+            for (int i = 0; i < columns; i++)
+            {
+                const int type = sqlite3_column_type(row, i);
+                if (i == geometryColumn) continue;
+                if (type == SQLITE_NULL || type == SQLITE_BLOB) continue;
+                this->append("<Data name=\"");
+                this->appendEscaped(sqlite3_column_name(row, i));
+                this->append("\"><value>");
+                this->appendValue(row, i);
+                this->append("</value></Data>");
+            }
+            this->append("</ExtendedData>");
+            this->appendGeometry();
+            this->append("</Placemark>\n");
+            break;
+        default:
+            if (this->_count == 0)
+            {
+                this->append("WKT");
+                for (int i = 0; i < columns; i++)
+                {
+                    if (i == geometryColumn) continue;
+                    this->append("\t", 1);
+                    this->appendEscaped(sqlite3_column_name(row, i));
+                }
+                this->append("\n", 1);
+            }
+            this->appendGeometry();
+            for (int i = 0; i < columns; i++)
+            {
+                if (i == geometryColumn) continue;
+                this->append("\t", 1);
+                this->appendValue(row, i);
+            }
+            this->append("\n", 1);
+            break;
+        }
+        this->_count++;
+    }
+
+    void FeatureWriter::writeAll(const char * data, size_t size)
+    {
+        while (size > 0)
+        {
+#ifdef _WIN32
+            const unsigned int chunk =
+                size > 0x40000000 ? 0x40000000 : (unsigned int)size;
+            const int written = _write(this->_fd, data, chunk);
+#else
+            const ssize_t written = ::write(this->_fd, data, size);
+#endif
+            if (written < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Failed to write output!");
+            }
+            this->_writes++;
+            this->_bytes += written;
+            data += written;
+            size -= written;
+        }
+    }
+
+    long long FeatureWriter::writeTable(SpatialDatabase const & database,
+                                        std::string const & table,
+                                        std::string const & geometry)
+    {
+        sqlite3 * handle = database.getDatabase()->getHandle();
+        sqlite3_stmt * statement = 0;
+        const std::string sql = "SELECT * FROM " + quoteName(table);
+        if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &statement, 0) !=
+            SQLITE_OK)
+        {
+            throw std::runtime_error("Failed to read table!");
+        }
+
+        // ==================================================
+        // Find the geometry column
+        // --------------------------------------------------
+        int geometryColumn = -1;
+        for (int i = 0; i < sqlite3_column_count(statement); i++)
+        {
+            if (sqlite3_stricmp(sqlite3_column_name(statement, i),
+                                geometry.c_str()) == 0)
+            {
+                geometryColumn = i;
+                break;
+            }
+        }
+        if (geometryColumn < 0)
+        {
+            sqlite3_finalize(statement);
+            throw std::runtime_error("Geometry column not found!");
+        }
+
+        // ==================================================
+        // Stream the rows
+        // --------------------------------------------------
+        try
+        {
+            this->begin(table);
+            int result = SQLITE_ROW;
+            while ((result = sqlite3_step(statement)) == SQLITE_ROW)
+            {
+                this->write(statement, geometryColumn);
+            }
+            if (result != SQLITE_DONE)
+            {
+                throw std::runtime_error("Failed to read table!");
+            }
+            this->finish();
+        }
+        catch (...)
+        {
+            sqlite3_finalize(statement);
+            throw;
+        }
+        sqlite3_finalize(statement);
+        return this->_count;
+    }
+
+}
@@ -0,0 +1,1952 @@
+/**
+ * @file    FlatGeobuf.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main FlatGeobuf class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/FlatGeobuf.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/Blob.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/PackedRTree.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // File signature of format version 3
+        const unsigned char FGB_MAGIC[8] = {'f', 'g', 'b', 3, 'f', 'g', 'b', 0};
+
+        // Index node: minx, miny, maxx, maxy and offset
+        const size_t FGB_NODE_SIZE = 40;
+
+        // Nesting limit of geometry parts
+        const int FGB_MAX_DEPTH = 8;
+
+        // Header fields
+        const int HEADER_NAME = 0;
+        const int HEADER_ENVELOPE = 1;
+        const int HEADER_GEOMETRY_TYPE = 2;
+        const int HEADER_HAS_Z = 3;
+        const int HEADER_HAS_M = 4;
+        const int HEADER_COLUMNS = 7;
+        const int HEADER_FEATURES_COUNT = 8;
+        const int HEADER_INDEX_NODE_SIZE = 9;
+        const int HEADER_CRS = 10;
+
+        // Column, CRS, feature and geometry fields
+        const int COLUMN_NAME = 0;
+        const int COLUMN_TYPE = 1;
+        const int CRS_ORG = 0;
+        const int CRS_CODE = 1;
+        const int FEATURE_GEOMETRY = 0;
+        const int FEATURE_PROPERTIES = 1;
+        const int GEOMETRY_ENDS = 0;
+        const int GEOMETRY_XY = 1;
+        const int GEOMETRY_Z = 2;
+        const int GEOMETRY_M = 3;
+        const int GEOMETRY_TYPE = 6;
+        const int GEOMETRY_PARTS = 7;
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Appends a little-endian unsigned value
+         */
+        void appendScalar(std::vector<unsigned char> & output,
+                          unsigned long long value,
+                          int size)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                output.push_back((unsigned char)(value >> (8 * i)));
+            }
+        }
+
+        /**
+         * @brief Writes a little-endian unsigned value
+         */
+        void putScalar(unsigned char * output, unsigned long long value, int size)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                output[i] = (unsigned char)(value >> (8 * i));
+            }
+        }
+
+        /**
+         * @returns Little-endian unsigned value
+         */
+        unsigned long long getScalar(const unsigned char * input, int size)
+        {
+            unsigned long long value = 0;
+            for (int i = size - 1; i >= 0; i--)
+            {
+                value = (value << 8) | input[i];
+            }
+            return value;
+        }
+
+        /**
+         * @returns Bits of a double
+         */
+        unsigned long long fromDouble(double value)
+        {
+            unsigned long long bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        /**
+         * @returns Little-endian double
+         */
+        double getDouble(const unsigned char * input)
+        {
+            const unsigned long long bits = getScalar(input, 8);
+            double value = 0;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        /**
+         * @brief Maps a whole file read-only
+         */
+        void * mapFile(std::string const & filename, size_t & size)
+        {
+#ifdef _WIN32
+            HANDLE file = CreateFileA(filename.c_str(),
+                                      GENERIC_READ,
+                                      FILE_SHARE_READ,
+                                      0,
+                                      OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL,
+                                      0);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error("Failed to open FlatGeobuf file!");
+            }
+            LARGE_INTEGER length;
+            if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+            {
+                CloseHandle(file);
+                throw std::runtime_error("Invalid FlatGeobuf file!");
+            }
+            HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+            CloseHandle(file);
+            if (!mapping) throw std::runtime_error("Failed to map FlatGeobuf file!");
+            void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (!view) throw std::runtime_error("Failed to map FlatGeobuf file!");
+            size = (size_t)length.QuadPart;
+            return view;
+#else
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("Failed to open FlatGeobuf file!");
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0)
+            {
+                close(fd);
+                throw std::runtime_error("Invalid FlatGeobuf file!");
+            }
+            void * view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (view == MAP_FAILED)
+            {
+                throw std::runtime_error("Failed to map FlatGeobuf file!");
+            }
+            size = (size_t)info.st_size;
+            return view;
+#endif
+        }
+
+        /**
+         * @brief Releases a file view
+         */
+        void unmapFile(void * view, size_t size)
+        {
+#ifdef _WIN32
+            (void)size;
+            UnmapViewOfFile(view);
+#else
+            munmap(view, size);
+#endif
+        }
+
+        /**
+         * @brief Computes the node range of each index level, leaves first,
+         *        for a tree stored root first
+         * @returns Number of nodes
+         */
+        size_t getLevelBounds(unsigned long long items,
+                              int nodeSize,
+                              std::vector<std::pair<size_t, size_t> > & bounds)
+        {
+            std::vector<size_t> counts;
+            size_t count = (size_t)items;
+            size_t nodes = count;
+            counts.push_back(count);
+            do
+            {
+                count = (count + nodeSize - 1) / nodeSize;
+                nodes += count;
+                counts.push_back(count);
+            }
+            while (count != 1);
+            bounds.clear();
+            size_t end = nodes;
+            for (size_t i = 0; i < counts.size(); i++)
+            {
+                end -= counts[i];
+                bounds.push_back(std::make_pair(end, end + counts[i]));
+            }
+            return nodes;
+        }
+
+        // ==================================================
+        // FlatBuffers writer
+        // --------------------------------------------------
+
+        /**
+         * @brief Front-to-back FlatBuffers builder. Objects are written
+         *        after the fields that refer to them, which are patched
+         *        once the objects are placed.
+         */
+        struct Builder
+        {
+            /**
+             * @brief Table field
+             */
+            struct Field
+            {
+                int id;                    ///< Field number
+                int size;                  ///< Size in bytes
+                unsigned long long value;  ///< Scalar value
+                bool offset;               ///< Set for references
+                size_t position;           ///< Placement in the buffer
+            };
+
+            std::vector<unsigned char> data;  ///< Size prefix and buffer
+
+            /**
+             * @brief Starts a size-prefixed buffer with its root reference
+             */
+            void begin()
+            {
+                this->data.assign(8, 0);
+            }
+
+            /**
+             * @brief Writes the size prefix
+             */
+            void finish()
+            {
+                while (this->data.size() % 8) this->data.push_back(0);
+                putScalar(&this->data[0], this->data.size() - 4, 4);
+            }
+
+            /**
+             * @brief Points a reference at a position
+             */
+            void patch(size_t field, size_t target)
+            {
+                putScalar(&this->data[field], target - field, 4);
+            }
+
+            /**
+             * @brief Writes a table with its vtable in front
+             * @returns Table position
+             */
+            size_t table(std::vector<Field> & fields)
+            {
+                int count = 0;
+                for (size_t i = 0; i < fields.size(); i++)
+                {
+                    count = std::max(count, fields[i].id + 1);
+                }
+                while (this->data.size() % 2) this->data.push_back(0);
+                const size_t vtable = this->data.size();
+                const size_t vtableSize = 4 + 2 * count;
+                const size_t start = (vtable + vtableSize + 3) & ~(size_t)3;
+
+                // Widest fields first so they pad the least
+                std::vector<size_t> order(fields.size());
+                for (size_t i = 0; i < order.size(); i++) order[i] = i;
+                for (size_t i = 1; i < order.size(); i++)
+                {
+                    for (size_t j = i; j > 0 &&
+                         fields[order[j]].size > fields[order[j - 1]].size; j--)
+                    {
+                        std::swap(order[j], order[j - 1]);
+                    }
+                }
+                size_t end = start + 4;
+                for (size_t i = 0; i < order.size(); i++)
+                {
+                    Field & field = fields[order[i]];
+                    end = (end + field.size - 1) / field.size * field.size;
+                    field.position = end;
+                    end += field.size;
+                }
+
+                std::vector<size_t> slots(count, 0);
+                for (size_t i = 0; i < fields.size(); i++)
+                {
+                    slots[fields[i].id] = fields[i].position - start;
+                }
+                appendScalar(this->data, vtableSize, 2);
+                appendScalar(this->data, end - start, 2);
+                for (int i = 0; i < count; i++) appendScalar(this->data, slots[i], 2);
+                this->data.resize(start, 0);
+                appendScalar(this->data, start - vtable, 4);
+                this->data.resize(end, 0);
+                for (size_t i = 0; i < fields.size(); i++)
+                {
+                    if (fields[i].offset) continue;
+                    putScalar(&this->data[fields[i].position],
+                              fields[i].value,
+                              fields[i].size);
+                }
+                return start;
+            }
+
+            /**
+             * @brief Starts a vector referred to by a field
+             */
+            void vector(size_t field, size_t count, int elementSize)
+            {
+                const size_t alignment = std::max(elementSize, 4);
+                while (this->data.size() % 4 ||
+                       (this->data.size() + 4) % alignment)
+                {
+                    this->data.push_back(0);
+                }
+                this->patch(field, this->data.size());
+                appendScalar(this->data, count, 4);
+            }
+
+            /**
+             * @brief Writes a vector of bytes
+             */
+            void bytes(size_t field, const unsigned char * bytes, size_t count)
+            {
+                this->vector(field, count, 1);
+                this->data.insert(this->data.end(), bytes, bytes + count);
+            }
+
+            /**
+             * @brief Writes a vector of doubles
+             */
+            void doubles(size_t field, std::vector<double> const & values)
+            {
+                this->vector(field, values.size(), 8);
+                for (size_t i = 0; i < values.size(); i++)
+                {
+                    appendScalar(this->data, fromDouble(values[i]), 8);
+                }
+            }
+
+            /**
+             * @brief Writes a string
+             */
+            void string(size_t field, std::string const & text)
+            {
+                this->vector(field, text.size(), 1);
+                this->data.insert(this->data.end(), text.begin(), text.end());
+                this->data.push_back(0);
+            }
+        };
+
+        /**
+         * @brief Adds a table field
+         */
+        void addField(std::vector<Builder::Field> & fields,
+                      int id,
+                      int size,
+                      unsigned long long value,
+                      bool offset = false)
+        {
+            Builder::Field field = {id, size, value, offset, 0};
+            fields.push_back(field);
+        }
+
+        /**
+         * @returns Position of a table field
+         */
+        size_t getField(std::vector<Builder::Field> const & fields, int id)
+        {
+            for (size_t i = 0; i < fields.size(); i++)
+            {
+                if (fields[i].id == id) return fields[i].position;
+            }
+            return 0;
+        }
+
+        // ==================================================
+        // Geometry encoder
+        // --------------------------------------------------
+
+        /**
+         * @brief Geometry in the layout of the format
+         */
+        struct Part
+        {
+            int type;                     ///< Geometry type
+            std::vector<unsigned int> ends;  ///< End point of each ring or line
+            std::vector<double> xy;       ///< Interleaved x and y
+            std::vector<double> z;        ///< Z values
+            std::vector<double> m;        ///< M values
+        };
+
+        /**
+         * @brief Converts gaia geometries to parts of one dimension model
+         */
+        struct Shape
+        {
+            int model;                ///< Output dimension model
+            Part root;                ///< Geometry
+            std::vector<Part> parts;  ///< Members of the root, reused
+            size_t count;             ///< Members in use
+
+            /**
+             * @brief Empties a part keeping its storage
+             */
+            static void reset(Part & part, int type)
+            {
+                part.type = type;
+                part.ends.clear();
+                part.xy.clear();
+                part.z.clear();
+                part.m.clear();
+            }
+
+            Part & addPart(int type)
+            {
+                if (this->count == this->parts.size()) this->parts.push_back(Part());
+                Part & part = this->parts[this->count++];
+                reset(part, type);
+                return part;
+            }
+
+            void addVertex(Part & part, double x, double y, double z, double m) const
+            {
+                part.xy.push_back(x);
+                part.xy.push_back(y);
+                if (this->model == GAIA_XY_Z || this->model == GAIA_XY_Z_M) part.z.push_back(z);
+                if (this->model == GAIA_XY_M || this->model == GAIA_XY_Z_M) part.m.push_back(m);
+            }
+
+            void addCoords(Part & part, const double * coords, int points, int source) const
+            {
+                const int stride = CoordinateBuffer::getStride(source);
+                const bool hasZ = source == GAIA_XY_Z || source == GAIA_XY_Z_M;
+                const bool hasM = source == GAIA_XY_M || source == GAIA_XY_Z_M;
+                for (int i = 0; i < points; i++, coords += stride)
+                {
+                    this->addVertex(part, coords[0], coords[1],
+                                    hasZ ? coords[2] : 0,
+                                    hasM ? coords[hasZ ? 3 : 2] : 0);
+                }
+            }
+
+            void addPolygon(Part & part, gaiaPolygonPtr polygon) const
+            {
+                for (int i = -1; i < polygon->NumInteriors; i++)
+                {
+                    gaiaRingPtr ring = i < 0 ? polygon->Exterior : polygon->Interiors + i;
+                    this->addCoords(part, ring->Coords, ring->Points, ring->DimensionModel);
+                    if (polygon->NumInteriors > 0)
+                    {
+                        part.ends.push_back((unsigned int)(part.xy.size() / 2));
+                    }
+                }
+            }
+
+            /**
+             * @brief Converts a geometry
+             * @returns False if it has no points
+             */
+            bool build(gaiaGeomCollPtr geometry)
+            {
+                int points = 0;
+                int lines = 0;
+                int polygons = 0;
+                for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next) points++;
+                for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next) lines++;
+                for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next) polygons++;
+                const int kinds = (points > 0) + (lines > 0) + (polygons > 0);
+                const int declared = geometry->DeclaredType % 1000;
+                const bool multi = declared >= GAIA_MULTIPOINT;
+                this->count = 0;
+                if (kinds == 0) return false;
+
+                if (kinds > 1 || declared == GAIA_GEOMETRYCOLLECTION)
+                {
+                    reset(this->root, GAIA_GEOMETRYCOLLECTION);
+                    for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+                    {
+                        this->addVertex(this->addPart(GAIA_POINT), p->X, p->Y, p->Z, p->M);
+                    }
+                    for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+                    {
+                        this->addCoords(this->addPart(GAIA_LINESTRING),
+                                        l->Coords, l->Points, l->DimensionModel);
+                    }
+                    for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+                    {
+                        this->addPolygon(this->addPart(GAIA_POLYGON), p);
+                    }
+                }
+                else if (points > 0)
+                {
+                    reset(this->root, points == 1 && !multi ? GAIA_POINT : GAIA_MULTIPOINT);
+                    for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+                    {
+                        this->addVertex(this->root, p->X, p->Y, p->Z, p->M);
+                    }
+                }
+                else if (lines > 0)
+                {
+                    const bool single = lines == 1 && !multi;
+                    reset(this->root, single ? GAIA_LINESTRING : GAIA_MULTILINESTRING);
+                    for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+                    {
+                        this->addCoords(this->root, l->Coords, l->Points, l->DimensionModel);
+                        if (!single)
+                        {
+                            this->root.ends.push_back((unsigned int)(this->root.xy.size() / 2));
+                        }
+                    }
+                }
+                else if (polygons == 1 && !multi)
+                {
+                    reset(this->root, GAIA_POLYGON);
+                    this->addPolygon(this->root, geometry->FirstPolygon);
+                }
+                else
+                {
+                    reset(this->root, GAIA_MULTIPOLYGON);
+                    for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+                    {
+                        this->addPolygon(this->addPart(GAIA_POLYGON), p);
+                    }
+                }
+                return true;
+            }
+        };
+
+        /**
+         * @brief Writes a geometry table referred to by a field
+         */
+        void writeGeometry(Builder & builder,
+                           size_t reference,
+                           Part const & part,
+                           const Part * parts,
+                           size_t count)
+        {
+            std::vector<Builder::Field> fields;
+            if (!part.ends.empty()) addField(fields, GEOMETRY_ENDS, 4, 0, true);
+            if (!part.xy.empty()) addField(fields, GEOMETRY_XY, 4, 0, true);
+            if (!part.z.empty()) addField(fields, GEOMETRY_Z, 4, 0, true);
+            if (!part.m.empty()) addField(fields, GEOMETRY_M, 4, 0, true);
+            addField(fields, GEOMETRY_TYPE, 1, part.type);
+            if (count > 0) addField(fields, GEOMETRY_PARTS, 4, 0, true);
+            builder.patch(reference, builder.table(fields));
+
+            if (!part.ends.empty())
+            {
+                builder.vector(getField(fields, GEOMETRY_ENDS), part.ends.size(), 4);
+                for (size_t i = 0; i < part.ends.size(); i++)
+                {
+                    appendScalar(builder.data, part.ends[i], 4);
+                }
+            }
+            if (!part.xy.empty()) builder.doubles(getField(fields, GEOMETRY_XY), part.xy);
+            if (!part.z.empty()) builder.doubles(getField(fields, GEOMETRY_Z), part.z);
+            if (!part.m.empty()) builder.doubles(getField(fields, GEOMETRY_M), part.m);
+            if (count > 0)
+            {
+                builder.vector(getField(fields, GEOMETRY_PARTS), count, 4);
+                const size_t slots = builder.data.size();
+                builder.data.resize(slots + 4 * count, 0);
+                for (size_t i = 0; i < count; i++)
+                {
+                    writeGeometry(builder, slots + 4 * i, parts[i], 0, 0);
+                }
+            }
+        }
+
+        /**
+         * @brief Infers the column type of a cursor column
+         */
+        int getColumnType(sqlite3_stmt * cursor, int column)
+        {
+            const char * declared = sqlite3_column_decltype(cursor, column);
+            if (declared && *declared)
+            {
+                // SQLite type affinity rules, and dates kept as text
+                std::string type(declared);
+                for (size_t i = 0; i < type.size(); i++)
+                {
+                    type[i] = (char)std::toupper((unsigned char)type[i]);
+                }
+                if (type.find("INT") != std::string::npos) return FlatGeobuf::LONG;
+                if (type.find("CHAR") != std::string::npos ||
+                    type.find("CLOB") != std::string::npos ||
+                    type.find("TEXT") != std::string::npos)
+                {
+                    return FlatGeobuf::STRING;
+                }
+                if (type.find("BLOB") != std::string::npos) return FlatGeobuf::BINARY;
+                if (type.find("DATE") != std::string::npos ||
+                    type.find("TIME") != std::string::npos)
+                {
+                    return FlatGeobuf::DATETIME;
+                }
+                return FlatGeobuf::DOUBLE;
+            }
+            switch (sqlite3_column_type(cursor, column))
+            {
+            case SQLITE_INTEGER:
+                return FlatGeobuf::LONG;
+            case SQLITE_FLOAT:
+                return FlatGeobuf::DOUBLE;
+            case SQLITE_BLOB:
+                return FlatGeobuf::BINARY;
+            default:
+                return FlatGeobuf::STRING;
+            }
+        }
+
+        /**
+         * @brief Appends the non-NULL properties of the current row
+         */
+        void appendProperties(std::vector<unsigned char> & output,
+                              sqlite3_stmt * cursor,
+                              std::vector<FlatGeobuf::Column> const & columns,
+                              std::vector<int> const & indices)
+        {
+            output.clear();
+            for (size_t i = 0; i < columns.size(); i++)
+            {
+                const int column = indices[i];
+                if (sqlite3_column_type(cursor, column) == SQLITE_NULL) continue;
+                appendScalar(output, i, 2);
+                switch (columns[i].type)
+                {
+                case FlatGeobuf::LONG:
+                    appendScalar(output, (unsigned long long)sqlite3_column_int64(cursor, column), 8);
+                    break;
+                case FlatGeobuf::DOUBLE:
+                    appendScalar(output, fromDouble(sqlite3_column_double(cursor, column)), 8);
+                    break;
+                case FlatGeobuf::BINARY:
+                {
+                    const unsigned char * blob =
+                        (const unsigned char *)sqlite3_column_blob(cursor, column);
+                    const int size = sqlite3_column_bytes(cursor, column);
+                    appendScalar(output, size, 4);
+                    if (size > 0) output.insert(output.end(), blob, blob + size);
+                    break;
+                }
+                default:
+                {
+                    const unsigned char * text = sqlite3_column_text(cursor, column);
+                    const int size = sqlite3_column_bytes(cursor, column);
+                    appendScalar(output, size, 4);
+                    if (size > 0) output.insert(output.end(), text, text + size);
+                }
+                }
+            }
+        }
+
+        /**
+         * @brief Staged feature
+         */
+        struct Staged
+        {
+            double box[4];              ///< Feature box, inverted if none
+            unsigned long long offset;  ///< Offset in the scratch file
+            unsigned int size;          ///< Size with prefix
+            unsigned int hilbert;       ///< Position along the curve
+        };
+
+        // ==================================================
+        // FlatBuffers reader
+        // --------------------------------------------------
+
+        /**
+         * @brief Bounds-checked view of a table
+         */
+        struct Table
+        {
+            const unsigned char * data;  ///< Buffer
+            size_t size;                 ///< Buffer size
+            size_t position;             ///< Table position
+            size_t vtable;               ///< Vtable position
+            size_t vtableSize;           ///< Vtable size
+
+            bool open(const unsigned char * buffer, size_t bytes, size_t at)
+            {
+                this->data = buffer;
+                this->size = bytes;
+                this->position = at;
+                if (at < 4 || at > bytes || bytes - at < 4) return false;
+                const long long offset = (int)getScalar(buffer + at, 4);
+                const long long vtable = (long long)at - offset;
+                if (vtable < 0 || (size_t)vtable + 4 > bytes) return false;
+                this->vtable = (size_t)vtable;
+                this->vtableSize = (size_t)getScalar(buffer + vtable, 2);
+                const size_t inlineSize = (size_t)getScalar(buffer + vtable + 2, 2);
+                return this->vtableSize >= 4 &&
+                       this->vtable + this->vtableSize <= bytes &&
+                       inlineSize >= 4 && inlineSize <= bytes - at;
+            }
+
+            /**
+             * @returns Field position, or zero if absent or out of bounds
+             */
+            size_t field(int id, size_t bytes) const
+            {
+                const size_t slot = 4 + 2 * (size_t)id;
+                if (slot + 2 > this->vtableSize) return 0;
+                const size_t offset = (size_t)getScalar(this->data + this->vtable + slot, 2);
+                if (offset == 0) return 0;
+                const size_t at = this->position + offset;
+                if (at > this->size || this->size - at < bytes) return 0;
+                return at;
+            }
+
+            unsigned long long scalar(int id, int bytes, unsigned long long fallback) const
+            {
+                const size_t at = this->field(id, bytes);
+                return at ? getScalar(this->data + at, bytes) : fallback;
+            }
+
+            /**
+             * @returns Target of a reference, or zero if absent or invalid
+             */
+            size_t target(int id) const
+            {
+                const size_t at = this->field(id, 4);
+                if (!at) return 0;
+                const size_t to = at + (size_t)getScalar(this->data + at, 4);
+                return to < this->size ? to : 0;
+            }
+
+            bool has(int id) const
+            {
+                return this->field(id, 4) != 0;
+            }
+
+            bool child(int id, Table & table) const
+            {
+                const size_t at = this->target(id);
+                return at && table.open(this->data, this->size, at);
+            }
+
+            /**
+             * @returns False if present but invalid. Absent vectors are
+             *          empty.
+             */
+            bool vector(int id, size_t elementSize, size_t & start, size_t & count) const
+            {
+                start = 0;
+                count = 0;
+                if (!this->has(id)) return true;
+                const size_t at = this->target(id);
+                if (!at || this->size - at < 4) return false;
+                count = (size_t)getScalar(this->data + at, 4);
+                start = at + 4;
+                return count <= (this->size - start) / elementSize;
+            }
+
+            bool string(int id, std::string & text) const
+            {
+                size_t start = 0;
+                size_t count = 0;
+                if (!this->vector(id, 1, start, count)) return false;
+                text.assign((const char *)this->data + start, count);
+                return true;
+            }
+        };
+
+        /**
+         * @brief Opens the root table of a size-prefixed buffer
+         * @param[in]  buffer Size prefix
+         * @param[in]  bytes  Bytes available from the prefix
+         * @param[out] used   Size of the buffer with its prefix
+         */
+        bool openRoot(const unsigned char * buffer,
+                      unsigned long long bytes,
+                      Table & table,
+                      unsigned long long & used)
+        {
+            if (bytes < 8) return false;
+            const unsigned long long size = getScalar(buffer, 4);
+            if (size < 4 || size > bytes - 4) return false;
+            used = 4 + size;
+            return table.open(buffer + 4, (size_t)size,
+                              (size_t)getScalar(buffer + 4, 4));
+        }
+
+        /**
+         * @brief Coordinate vectors of a geometry table
+         */
+        struct Vertices
+        {
+            const unsigned char * data;  ///< Buffer
+            size_t xy;                   ///< First x
+            size_t z;                    ///< First z, or zero
+            size_t m;                    ///< First m, or zero
+            size_t points;               ///< Number of points
+            size_t ends;                 ///< First end, or zero
+            size_t parts;                ///< Number of ends
+
+            bool open(Table const & table)
+            {
+                size_t count = 0;
+                size_t zCount = 0;
+                size_t mCount = 0;
+                this->data = table.data;
+                if (!table.vector(GEOMETRY_XY, 8, this->xy, count) ||
+                    !table.vector(GEOMETRY_Z, 8, this->z, zCount) ||
+                    !table.vector(GEOMETRY_M, 8, this->m, mCount) ||
+                    !table.vector(GEOMETRY_ENDS, 4, this->ends, this->parts))
+                {
+                    return false;
+                }
+                this->points = count / 2;
+                if (zCount == 0) this->z = 0;
+                if (mCount == 0) this->m = 0;
+                if ((zCount && zCount != this->points) ||
+                    (mCount && mCount != this->points))
+                {
+                    return false;
+                }
+
+                // Ends must rise to the last point
+                size_t last = 0;
+                for (size_t i = 0; i < this->parts; i++)
+                {
+                    const size_t end = (size_t)getScalar(this->data + this->ends + 4 * i, 4);
+                    if (end <= last || end > this->points) return false;
+                    last = end;
+                }
+                return this->parts == 0 || last == this->points;
+            }
+
+            /**
+             * @returns End of a part, all points without ends
+             */
+            size_t getEnd(size_t part) const
+            {
+                if (this->parts == 0) return this->points;
+                return (size_t)getScalar(this->data + this->ends + 4 * part, 4);
+            }
+
+            /**
+             * @brief Writes points in a gaia dimension model
+             */
+            void getCoords(double * coords, size_t first, size_t count, int model) const
+            {
+                const bool hasZ = model == GAIA_XY_Z || model == GAIA_XY_Z_M;
+                const bool hasM = model == GAIA_XY_M || model == GAIA_XY_Z_M;
+                const int stride = CoordinateBuffer::getStride(model);
+                for (size_t i = first; i < first + count; i++, coords += stride)
+                {
+                    coords[0] = getDouble(this->data + this->xy + 16 * i);
+                    coords[1] = getDouble(this->data + this->xy + 16 * i + 8);
+                    if (hasZ) coords[2] = this->z ? getDouble(this->data + this->z + 8 * i) : 0;
+                    if (hasM)
+                    {
+                        coords[hasZ ? 3 : 2] =
+                            this->m ? getDouble(this->data + this->m + 8 * i) : 0;
+                    }
+                }
+            }
+        };
+
+        /**
+         * @brief Adds a point of a geometry table to a geometry
+         */
+        void addPoint(gaiaGeomCollPtr geometry, Vertices const & vertices, size_t index)
+        {
+            double coords[4] = {0, 0, 0, 0};
+            vertices.getCoords(coords, index, 1, geometry->DimensionModel);
+            switch (geometry->DimensionModel)
+            {
+            case GAIA_XY_Z:
+                gaiaAddPointToGeomCollXYZ(geometry, coords[0], coords[1], coords[2]);
+                break;
+            case GAIA_XY_M:
+                gaiaAddPointToGeomCollXYM(geometry, coords[0], coords[1], coords[2]);
+                break;
+            case GAIA_XY_Z_M:
+                gaiaAddPointToGeomCollXYZM(geometry, coords[0], coords[1],
+                                           coords[2], coords[3]);
+                break;
+            default:
+                gaiaAddPointToGeomColl(geometry, coords[0], coords[1]);
+            }
+        }
+
+        /**
+         * @brief Decodes a geometry table into a geometry
+         * @param[in] type Known geometry type, or zero to read it
+         */
+        bool readGeometry(Table const & table, int type, gaiaGeomCollPtr geometry, int depth)
+        {
+            if (depth > FGB_MAX_DEPTH) return false;
+            if (type == 0) type = (int)table.scalar(GEOMETRY_TYPE, 1, 0);
+            const int model = geometry->DimensionModel;
+
+            if (type == GAIA_MULTIPOLYGON || type == GAIA_GEOMETRYCOLLECTION)
+            {
+                size_t start = 0;
+                size_t count = 0;
+                if (!table.vector(GEOMETRY_PARTS, 4, start, count)) return false;
+                for (size_t i = 0; i < count; i++)
+                {
+                    const size_t at = start + 4 * i;
+                    Table part;
+                    if (!part.open(table.data, table.size,
+                                   at + (size_t)getScalar(table.data + at, 4)) ||
+                        !readGeometry(part,
+                                      type == GAIA_MULTIPOLYGON ? GAIA_POLYGON : 0,
+                                      geometry,
+                                      depth + 1))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            Vertices vertices;
+            if (!vertices.open(table)) return false;
+            switch (type)
+            {
+            case GAIA_POINT:
+            case GAIA_MULTIPOINT:
+                for (size_t i = 0; i < vertices.points; i++) addPoint(geometry, vertices, i);
+                return true;
+            case GAIA_LINESTRING:
+            case GAIA_MULTILINESTRING:
+            {
+                size_t first = 0;
+                for (size_t i = 0; first < vertices.points; i++)
+                {
+                    const size_t end = vertices.getEnd(i);
+                    gaiaLinestringPtr line =
+                        gaiaAddLinestringToGeomColl(geometry, (int)(end - first));
+                    vertices.getCoords(line->Coords, first, end - first, model);
+                    first = end;
+                }
+                return true;
+            }
+            case GAIA_POLYGON:
+            {
+                if (vertices.points == 0) return true;
+                const size_t rings = vertices.parts ? vertices.parts : 1;
+                size_t end = vertices.getEnd(0);
+                gaiaPolygonPtr polygon =
+                    gaiaAddPolygonToGeomColl(geometry, (int)end, (int)rings - 1);
+                vertices.getCoords(polygon->Exterior->Coords, 0, end, model);
+                for (size_t i = 1; i < rings; i++)
+                {
+                    const size_t first = end;
+                    end = vertices.getEnd(i);
+                    gaiaRingPtr ring = gaiaAddInteriorRing(polygon, (int)i - 1,
+                                                           (int)(end - first));
+                    vertices.getCoords(ring->Coords, first, end - first, model);
+                }
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * @brief Extends a box with the points of a geometry table
+         */
+        bool extendBounds(Table const & table, double * box, int depth)
+        {
+            if (depth > FGB_MAX_DEPTH) return false;
+            Vertices vertices;
+            if (!vertices.open(table)) return false;
+            for (size_t i = 0; i < vertices.points; i++)
+            {
+                double coords[2];
+                vertices.getCoords(coords, i, 1, GAIA_XY);
+                box[0] = std::min(box[0], coords[0]);
+                box[1] = std::min(box[1], coords[1]);
+                box[2] = std::max(box[2], coords[0]);
+                box[3] = std::max(box[3], coords[1]);
+            }
+            size_t start = 0;
+            size_t count = 0;
+            if (!table.vector(GEOMETRY_PARTS, 4, start, count)) return false;
+            for (size_t i = 0; i < count; i++)
+            {
+                const size_t at = start + 4 * i;
+                Table part;
+                if (!part.open(table.data, table.size,
+                               at + (size_t)getScalar(table.data + at, 4)) ||
+                    !extendBounds(part, box, depth + 1))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Registers an imported geometry column and indexes it
+         * @details Does nothing without spatial metadata or if the column
+         *          is already registered.
+         * @throws std::runtime_error on failure
+         */
+        void registerColumn(SQLite::Database & connection,
+                            std::string const & table,
+                            std::string const & geometry,
+                            int srid,
+                            int type,
+                            int dimensions)
+        {
+            if (!connection.tableExists("geometry_columns")) return;
+            SQLite::Statement registered(connection,
+                                         "SELECT 1 FROM geometry_columns WHERE "
+                                         "Lower(f_table_name) = Lower(?) AND "
+                                         "Lower(f_geometry_column) = Lower(?)");
+            registered.bind(1, table);
+            registered.bind(2, geometry);
+            if (registered.executeStep()) return;
+
+            const char * model = "XY";
+            switch (dimensions)
+            {
+            case GAIA_XY_Z: model = "XYZ"; break;
+            case GAIA_XY_M: model = "XYM"; break;
+            case GAIA_XY_Z_M: model = "XYZM"; break;
+            }
+            SQLite::Statement recover(connection,
+                                      "SELECT RecoverGeometryColumn(?, ?, ?, ?, ?)");
+            recover.bind(1, table);
+            recover.bind(2, geometry);
+            recover.bind(3, srid);
+            recover.bind(4, type == 0 ? std::string("GEOMETRY") :
+                                        SpatialDatabase::getGeometryName(type));
+            recover.bind(5, model);
+            if (!recover.executeStep() || recover.getColumn(0).getInt() != 1)
+            {
+                throw std::runtime_error("Failed to register geometry column!");
+            }
+
+            // Indexes the rows already inserted as idx_<table>_<geometry>
+            SQLite::Statement index(connection, "SELECT CreateSpatialIndex(?, ?)");
+            index.bind(1, table);
+            index.bind(2, geometry);
+            if (!index.executeStep() || index.getColumn(0).getInt() != 1)
+            {
+                throw std::runtime_error("Failed to create spatial index!");
+            }
+        }
+
+    }
+
+    FlatGeobuf::FlatGeobuf() :
+        _columns(),
+        _count(0),
+        _dimensions(GAIA_XY),
+        _extent(false),
+        _features(0),
+        _featuresSize(0),
+        _geometryType(0),
+        _index(0),
+        _levelBounds(),
+        _mapping(0),
+        _mappingSize(0),
+        _maxx(0),
+        _maxy(0),
+        _minx(0),
+        _miny(0),
+        _name(),
+        _nodeSize(0),
+        _numNodes(0),
+        _srid(0)
+    {
+    }
+
+    FlatGeobuf::~FlatGeobuf()
+    {
+        if (this->_mapping) unmapFile(this->_mapping, this->_mappingSize);
+    }
+
+    void FlatGeobuf::bindProperties(unsigned long long feature,
+                                    sqlite3_stmt * statement,
+                                    int first) const
+    {
+        Table root;
+        unsigned long long used = 0;
+        if (feature >= this->_featuresSize ||
+            !openRoot(this->_features + feature, this->_featuresSize - feature, root, used))
+        {
+            throw std::runtime_error("Invalid FlatGeobuf feature!");
+        }
+        for (size_t i = 0; i < this->_columns.size(); i++)
+        {
+            if (sqlite3_bind_null(statement, first + (int)i) != SQLITE_OK)
+            {
+                throw std::runtime_error("Failed to bind property!");
+            }
+        }
+
+        // ==================================================
+        // Column index and value pairs
+        // --------------------------------------------------
+        size_t position = 0;
+        size_t size = 0;
+        if (!root.vector(FEATURE_PROPERTIES, 1, position, size))
+        {
+            throw std::runtime_error("Invalid FlatGeobuf feature!");
+        }
+        const unsigned char * data = root.data + position;
+        size_t at = 0;
+        while (at < size)
+        {
+            if (size - at < 2) throw std::runtime_error("Invalid FlatGeobuf feature!");
+            const size_t column = (size_t)getScalar(data + at, 2);
+            at += 2;
+            if (column >= this->_columns.size())
+            {
+                throw std::runtime_error("Invalid FlatGeobuf feature!");
+            }
+            const int type = this->_columns[column].type;
+            const int parameter = first + (int)column;
+            size_t width = 0;
+            switch (type)
+            {
+            case BYTE: case UBYTE: case BOOL: width = 1; break;
+            case SHORT: case USHORT: width = 2; break;
+            case INT: case UINT: case FLOAT: width = 4; break;
+            case LONG: case ULONG: case DOUBLE: width = 8; break;
+            default: width = 4;
+            }
+            if (size - at < width) throw std::runtime_error("Invalid FlatGeobuf feature!");
+            const unsigned long long bits = getScalar(data + at, (int)width);
+            at += width;
+
+            int result = SQLITE_OK;
+            switch (type)
+            {
+            case BYTE:
+                result = sqlite3_bind_int64(statement, parameter, (signed char)bits);
+                break;
+            case SHORT:
+                result = sqlite3_bind_int64(statement, parameter, (short)bits);
+                break;
+            case INT:
+                result = sqlite3_bind_int64(statement, parameter, (int)bits);
+                break;
+            case UBYTE: case BOOL: case USHORT: case UINT: case LONG: case ULONG:
+                result = sqlite3_bind_int64(statement, parameter, (sqlite3_int64)bits);
+                break;
+            case FLOAT:
+            {
+                const unsigned int single = (unsigned int)bits;
+                float value = 0;
+                std::memcpy(&value, &single, sizeof(value));
+                result = sqlite3_bind_double(statement, parameter, value);
+                break;
+            }
+            case DOUBLE:
+            {
+                double value = 0;
+                std::memcpy(&value, &bits, sizeof(value));
+                result = sqlite3_bind_double(statement, parameter, value);
+                break;
+            }
+            default:
+                if (size - at < bits) throw std::runtime_error("Invalid FlatGeobuf feature!");
+                if (type == BINARY)
+                {
+                    result = sqlite3_bind_blob(statement, parameter, data + at,
+                                               (int)bits, SQLITE_STATIC);
+                }
+                else
+                {
+                    result = sqlite3_bind_text(statement, parameter,
+                                               (const char *)data + at,
+                                               (int)bits, SQLITE_STATIC);
+                }
+                at += (size_t)bits;
+            }
+            if (result != SQLITE_OK) throw std::runtime_error("Failed to bind property!");
+        }
+    }
+
+    long long FlatGeobuf::exportQuery(sqlite3_stmt * cursor,
+                                      int geometryColumn,
+                                      std::string const & filename,
+                                      std::string const & name,
+                                      int nodeSize)
+    {
+        if (!cursor) throw std::runtime_error("Invalid cursor!");
+        if (geometryColumn < 0 || geometryColumn >= sqlite3_column_count(cursor))
+        {
+            throw std::runtime_error("Invalid geometry column!");
+        }
+        if (nodeSize != 0 && (nodeSize < 2 || nodeSize > 65535))
+        {
+            throw std::runtime_error("Invalid node size!");
+        }
+
+        const std::string scratchName = filename + ".features";
+        const std::string temporary = filename + ".tmp";
+        FILE * scratch = std::fopen(scratchName.c_str(), "wb");
+        if (!scratch) throw std::runtime_error("Failed to open FlatGeobuf file!");
+        FILE * file = 0;
+        void * mapping = 0;
+        size_t mappingSize = 0;
+        long long count = 0;
+        try
+        {
+            // ==================================================
+            // Encode the rows into the scratch file
+            // --------------------------------------------------
+            std::vector<Column> columns;
+            std::vector<int> indices;
+            std::vector<Staged> staged;
+            std::vector<unsigned char> properties;
+            Builder builder;
+            Shape shape;
+            shape.model = -1;
+            shape.count = 0;
+            int geometryType = -1;
+            int srid = 0;
+            unsigned long long scratchSize = 0;
+            double extent[4] = {DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX};
+            int result = SQLITE_ROW;
+            while ((result = sqlite3_step(cursor)) == SQLITE_ROW)
+            {
+                if (count == 0)
+                {
+                    for (int i = 0; i < sqlite3_column_count(cursor); i++)
+                    {
+                        if (i == geometryColumn) continue;
+                        Column column = {sqlite3_column_name(cursor, i),
+                                         getColumnType(cursor, i)};
+                        columns.push_back(column);
+                        indices.push_back(i);
+                    }
+                }
+
+                gaiaGeomCollPtr geometry = 0;
+                if (sqlite3_column_type(cursor, geometryColumn) == SQLITE_BLOB)
+                {
+                    geometry = BlobEncoding::decode(
+                        (const unsigned char *)sqlite3_column_blob(cursor, geometryColumn),
+                        sqlite3_column_bytes(cursor, geometryColumn));
+                }
+                Staged entry = {{HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL},
+                                scratchSize, 0, 0};
+                bool valid = false;
+                if (geometry)
+                {
+                    if (shape.model < 0)
+                    {
+                        shape.model = geometry->DimensionModel;
+                        srid = geometry->Srid;
+                    }
+                    valid = shape.build(geometry);
+                    if (valid)
+                    {
+                        gaiaMbrGeometry(geometry);
+                        entry.box[0] = geometry->MinX;
+                        entry.box[1] = geometry->MinY;
+                        entry.box[2] = geometry->MaxX;
+                        entry.box[3] = geometry->MaxY;
+                    }
+                    gaiaFreeGeomColl(geometry);
+                }
+                if (valid)
+                {
+                    geometryType = geometryType < 0 || geometryType == shape.root.type ?
+                                   shape.root.type : 0;
+                    for (int d = 0; d < 2; d++)
+                    {
+                        extent[d] = std::min(extent[d], entry.box[d]);
+                        extent[d + 2] = std::max(extent[d + 2], entry.box[d + 2]);
+                    }
+                }
+                appendProperties(properties, cursor, columns, indices);
+
+                std::vector<Builder::Field> fields;
+                if (valid) addField(fields, FEATURE_GEOMETRY, 4, 0, true);
+                if (!properties.empty()) addField(fields, FEATURE_PROPERTIES, 4, 0, true);
+                builder.begin();
+                builder.patch(4, builder.table(fields));
+                if (valid)
+                {
+                    writeGeometry(builder, getField(fields, FEATURE_GEOMETRY), shape.root,
+                                  shape.count ? &shape.parts[0] : 0, shape.count);
+                }
+                if (!properties.empty())
+                {
+                    builder.bytes(getField(fields, FEATURE_PROPERTIES),
+                                  &properties[0], properties.size());
+                }
+                builder.finish();
+                if (std::fwrite(&builder.data[0], 1, builder.data.size(), scratch) !=
+                    builder.data.size())
+                {
+                    throw std::runtime_error("Failed to write FlatGeobuf file!");
+                }
+                entry.size = (unsigned int)builder.data.size();
+                scratchSize += entry.size;
+                staged.push_back(entry);
+                count++;
+            }
+            if (result != SQLITE_DONE)
+            {
+                throw std::runtime_error(sqlite3_errmsg(sqlite3_db_handle(cursor)));
+            }
+            const int closed = std::fclose(scratch);
+            scratch = 0;
+            if (closed != 0) throw std::runtime_error("Failed to write FlatGeobuf file!");
+
+            // ==================================================
+            // Order the features along the Hilbert curve
+            // --------------------------------------------------
+            const bool indexed = nodeSize > 0 && count > 0;
+            const bool bounded = extent[0] <= extent[2];
+            std::vector<size_t> order(staged.size());
+            for (size_t i = 0; i < order.size(); i++) order[i] = i;
+            if (indexed && bounded)
+            {
+                const double width = extent[2] - extent[0];
+                const double height = extent[3] - extent[1];
+                for (size_t i = 0; i < staged.size(); i++)
+                {
+                    const double * box = staged[i].box;
+                    if (box[0] > box[2])
+                    {
+                        staged[i].hilbert = 0xFFFFFFFF;
+                        continue;
+                    }
+                    unsigned int hx = width > 0 ? (unsigned int)std::floor(
+                        65535 * ((box[0] + box[2]) / 2 - extent[0]) / width) : 0;
+                    unsigned int hy = height > 0 ? (unsigned int)std::floor(
+                        65535 * ((box[1] + box[3]) / 2 - extent[1]) / height) : 0;
+                    staged[i].hilbert = PackedRTree::getHilbertValue(hx, hy);
+                }
+                std::stable_sort(order.begin(), order.end(),
+                                 [&staged](size_t a, size_t b)
+                                 {
+                                     return staged[a].hilbert < staged[b].hilbert;
+                                 });
+            }
+
+            // ==================================================
+            // Header
+            // --------------------------------------------------
+            std::vector<Builder::Field> fields;
+            addField(fields, HEADER_NAME, 4, 0, true);
+            if (bounded) addField(fields, HEADER_ENVELOPE, 4, 0, true);
+            addField(fields, HEADER_GEOMETRY_TYPE, 1, geometryType < 0 ? 0 : geometryType);
+            if (shape.model == GAIA_XY_Z || shape.model == GAIA_XY_Z_M)
+            {
+                addField(fields, HEADER_HAS_Z, 1, 1);
+            }
+            if (shape.model == GAIA_XY_M || shape.model == GAIA_XY_Z_M)
+            {
+                addField(fields, HEADER_HAS_M, 1, 1);
+            }
+            if (!columns.empty()) addField(fields, HEADER_COLUMNS, 4, 0, true);
+            addField(fields, HEADER_FEATURES_COUNT, 8, (unsigned long long)count);
+            addField(fields, HEADER_INDEX_NODE_SIZE, 2, indexed ? nodeSize : 0);
+            if (srid > 0) addField(fields, HEADER_CRS, 4, 0, true);
+            builder.begin();
+            builder.patch(4, builder.table(fields));
+            builder.string(getField(fields, HEADER_NAME), name);
+            if (bounded)
+            {
+                builder.doubles(getField(fields, HEADER_ENVELOPE),
+                                std::vector<double>(extent, extent + 4));
+            }
+            if (!columns.empty())
+            {
+                builder.vector(getField(fields, HEADER_COLUMNS), columns.size(), 4);
+                const size_t slots = builder.data.size();
+                builder.data.resize(slots + 4 * columns.size(), 0);
+                for (size_t i = 0; i < columns.size(); i++)
+                {
+                    std::vector<Builder::Field> column;
+                    addField(column, COLUMN_NAME, 4, 0, true);
+                    addField(column, COLUMN_TYPE, 1, columns[i].type);
+                    builder.patch(slots + 4 * i, builder.table(column));
+                    builder.string(getField(column, COLUMN_NAME), columns[i].name);
+                }
+            }
+            if (srid > 0)
+            {
+                std::vector<Builder::Field> crs;
+                addField(crs, CRS_ORG, 4, 0, true);
+                addField(crs, CRS_CODE, 4, (unsigned int)srid);
+                builder.patch(getField(fields, HEADER_CRS), builder.table(crs));
+                builder.string(getField(crs, CRS_ORG), "EPSG");
+            }
+            builder.finish();
+
+            // ==================================================
+            // Index, root first, with feature byte offsets in the leaves
+            // --------------------------------------------------
+            std::vector<unsigned char> index;
+            if (indexed)
+            {
+                std::vector<std::pair<size_t, size_t> > levels;
+                const size_t nodes = getLevelBounds(count, nodeSize, levels);
+                std::vector<double> boxes(4 * nodes);
+                std::vector<unsigned long long> offsets(nodes);
+                unsigned long long offset = 0;
+                for (size_t i = 0; i < order.size(); i++)
+                {
+                    const size_t leaf = levels[0].first + i;
+                    std::memcpy(&boxes[4 * leaf], staged[order[i]].box, 4 * sizeof(double));
+                    offsets[leaf] = offset;
+                    offset += staged[order[i]].size;
+                }
+                for (size_t level = 0; level + 1 < levels.size(); level++)
+                {
+                    size_t position = levels[level].first;
+                    size_t parent = levels[level + 1].first;
+                    while (position < levels[level].second)
+                    {
+                        double box[4] = {HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+                        offsets[parent] = position;
+                        for (int j = 0; j < nodeSize && position < levels[level].second;
+                             j++, position++)
+                        {
+                            box[0] = std::min(box[0], boxes[4 * position]);
+                            box[1] = std::min(box[1], boxes[4 * position + 1]);
+                            box[2] = std::max(box[2], boxes[4 * position + 2]);
+                            box[3] = std::max(box[3], boxes[4 * position + 3]);
+                        }
+                        std::memcpy(&boxes[4 * parent], box, sizeof(box));
+                        parent++;
+                    }
+                }
+                index.reserve(nodes * FGB_NODE_SIZE);
+                for (size_t i = 0; i < nodes; i++)
+                {
+                    for (int d = 0; d < 4; d++)
+                    {
+                        appendScalar(index, fromDouble(boxes[4 * i + d]), 8);
+                    }
+                    appendScalar(index, offsets[i], 8);
+                }
+            }
+
+            // ==================================================
+            // Write a temporary file and move it into place so a
+            // mapped copy of the old file stays valid
+            // --------------------------------------------------
+            if (scratchSize > 0) mapping = mapFile(scratchName, mappingSize);
+            file = std::fopen(temporary.c_str(), "wb");
+            if (!file) throw std::runtime_error("Failed to open FlatGeobuf file!");
+            bool written =
+                std::fwrite(FGB_MAGIC, 1, sizeof(FGB_MAGIC), file) == sizeof(FGB_MAGIC) &&
+                std::fwrite(&builder.data[0], 1, builder.data.size(), file) ==
+                    builder.data.size() &&
+                (index.empty() ||
+                 std::fwrite(&index[0], 1, index.size(), file) == index.size());
+            for (size_t i = 0; written && i < order.size(); i++)
+            {
+                Staged const & entry = staged[order[i]];
+                written = std::fwrite((const char *)mapping + entry.offset, 1,
+                                      entry.size, file) == entry.size;
+            }
+            written = std::fclose(file) == 0 && written;
+            file = 0;
+            if (!written)
+            {
+                throw std::runtime_error("Failed to write FlatGeobuf file!");
+            }
+            if (mapping) unmapFile(mapping, mappingSize);
+            mapping = 0;
+            std::remove(scratchName.c_str());
+#ifdef _WIN32
+            // rename does not replace an existing file on Windows
+            std::remove(filename.c_str());
+#endif
+            if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+            {
+                throw std::runtime_error("Failed to write FlatGeobuf file!");
+            }
+        }
+        catch (...)
+        {
+            if (scratch) std::fclose(scratch);
+            if (file) std::fclose(file);
+            if (mapping) unmapFile(mapping, mappingSize);
+            std::remove(scratchName.c_str());
+            std::remove(temporary.c_str());
+            throw;
+        }
+        return count;
+    }
+
+    long long FlatGeobuf::exportTable(SpatialDatabase const & database,
+                                      std::string const & table,
+                                      std::string const & geometry,
+                                      std::string const & filename,
+                                      int nodeSize)
+    {
+        sqlite3 * handle = database.getDatabase()->getHandle();
+        sqlite3_stmt * statement = 0;
+        const std::string sql = "SELECT * FROM " + quoteName(table);
+        if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &statement, 0) != SQLITE_OK)
+        {
+            throw std::runtime_error("Failed to read table!");
+        }
+        int geometryColumn = -1;
+        for (int i = 0; i < sqlite3_column_count(statement); i++)
+        {
+            if (sqlite3_stricmp(sqlite3_column_name(statement, i),
+                                geometry.c_str()) == 0)
+            {
+                geometryColumn = i;
+                break;
+            }
+        }
+        if (geometryColumn < 0)
+        {
+            sqlite3_finalize(statement);
+            throw std::runtime_error("Geometry column not found!");
+        }
+        long long count = 0;
+        try
+        {
+            count = exportQuery(statement, geometryColumn, filename, table, nodeSize);
+        }
+        catch (...)
+        {
+            sqlite3_finalize(statement);
+            throw;
+        }
+        sqlite3_finalize(statement);
+        return count;
+    }
+
+    bool FlatGeobuf::getBounds(double & minx,
+                               double & miny,
+                               double & maxx,
+                               double & maxy) const
+    {
+        if (!this->_extent) return false;
+        minx = this->_minx;
+        miny = this->_miny;
+        maxx = this->_maxx;
+        maxy = this->_maxy;
+        return true;
+    }
+
+    std::vector<FlatGeobuf::Column> const & FlatGeobuf::getColumns() const
+    {
+        return this->_columns;
+    }
+
+    unsigned long long FlatGeobuf::getCount() const
+    {
+        return this->_count;
+    }
+
+    int FlatGeobuf::getDimensions() const
+    {
+        return this->_dimensions;
+    }
+
+    unsigned long long FlatGeobuf::getFeaturesSize() const
+    {
+        return this->_featuresSize;
+    }
+
+    gaiaGeomCollPtr FlatGeobuf::getGeometry(unsigned long long feature) const
+    {
+        Table root;
+        unsigned long long used = 0;
+        if (feature >= this->_featuresSize ||
+            !openRoot(this->_features + feature, this->_featuresSize - feature, root, used))
+        {
+            throw std::runtime_error("Invalid FlatGeobuf feature!");
+        }
+        if (!root.has(FEATURE_GEOMETRY)) return 0;
+        Table table;
+        if (!root.child(FEATURE_GEOMETRY, table))
+        {
+            throw std::runtime_error("Invalid FlatGeobuf feature!");
+        }
+
+        gaiaGeomCollPtr geometry = 0;
+        switch (this->_dimensions)
+        {
+        case GAIA_XY_Z:
+            geometry = gaiaAllocGeomCollXYZ();
+            break;
+        case GAIA_XY_M:
+            geometry = gaiaAllocGeomCollXYM();
+            break;
+        case GAIA_XY_Z_M:
+            geometry = gaiaAllocGeomCollXYZM();
+            break;
+        default:
+            geometry = gaiaAllocGeomColl();
+        }
+        int type = this->_geometryType;
+        if (type == 0) type = (int)table.scalar(GEOMETRY_TYPE, 1, 0);
+        if (!readGeometry(table, type, geometry, 0))
+        {
+            gaiaFreeGeomColl(geometry);
+            throw std::runtime_error("Invalid FlatGeobuf feature!");
+        }
+        geometry->Srid = this->_srid;
+        geometry->DeclaredType = type;
+        gaiaMbrGeometry(geometry);
+        return geometry;
+    }
+
+    int FlatGeobuf::getGeometryType() const
+    {
+        return this->_geometryType;
+    }
+
+    std::string const & FlatGeobuf::getName() const
+    {
+        return this->_name;
+    }
+
+    int FlatGeobuf::getNodeSize() const
+    {
+        return this->_nodeSize;
+    }
+
+    int FlatGeobuf::getSrid() const
+    {
+        return this->_srid;
+    }
+
+    long long FlatGeobuf::importTable(SpatialDatabase const & database,
+                                      std::string const & table,
+                                      std::string const & geometry) const
+    {
+        SQLite::Database & connection = *database.getDatabase();
+        std::string definition;
+        std::string names;
+        std::string values;
+        for (size_t i = 0; i < this->_columns.size(); i++)
+        {
+            const std::string name = quoteName(this->_columns[i].name);
+            const char * type = "INTEGER";
+            switch (this->_columns[i].type)
+            {
+            case FLOAT: case DOUBLE: type = "DOUBLE"; break;
+            case STRING: case JSON: case DATETIME: type = "TEXT"; break;
+            case BINARY: type = "BLOB"; break;
+            }
+            definition += name + " " + type + ", ";
+            names += name + ", ";
+            values += "?, ";
+        }
+        connection.exec("CREATE TABLE IF NOT EXISTS " + quoteName(table) + " (" +
+                        definition + quoteName(geometry) + " BLOB)");
+        const std::string sql = "INSERT INTO " + quoteName(table) + " (" + names +
+                                quoteName(geometry) + ") VALUES (" + values + "?)";
+        sqlite3_stmt * insert = 0;
+        if (sqlite3_prepare_v2(connection.getHandle(), sql.c_str(), -1, &insert, 0) !=
+            SQLITE_OK)
+        {
+            throw std::runtime_error("Failed to prepare insert!");
+        }
+
+        // ==================================================
+        // Rebind one prepared statement per row, all inside one savepoint
+        // --------------------------------------------------
+        const int geometryParameter = (int)this->_columns.size() + 1;
+        long long count = 0;
+        connection.exec("SAVEPOINT flatgeobuf_import");
+        try
+        {
+            for (unsigned long long feature = 0; feature < this->_featuresSize;
+                 feature = this->next(feature))
+            {
+                this->bindProperties(feature, insert, 1);
+                std::unique_ptr<Blob> blob;
+                gaiaGeomCollPtr decoded = this->getGeometry(feature);
+                if (decoded)
+                {
+                    try
+                    {
+                        blob.reset(Blob::toSpatiaLiteBlobWkb(decoded));
+                    }
+                    catch (...)
+                    {
+                        gaiaFreeGeomColl(decoded);
+                        throw;
+                    }
+                    gaiaFreeGeomColl(decoded);
+                }
+                const int bound = blob ?
+                    sqlite3_bind_blob(insert, geometryParameter, blob->get(),
+                                      blob->getSize(), SQLITE_STATIC) :
+                    sqlite3_bind_null(insert, geometryParameter);
+                if (bound != SQLITE_OK || sqlite3_step(insert) != SQLITE_DONE)
+                {
+                    throw std::runtime_error(sqlite3_errmsg(connection.getHandle()));
+                }
+                sqlite3_reset(insert);
+                count++;
+            }
+            registerColumn(connection, table, geometry, this->_srid,
+                           this->_geometryType, this->_dimensions);
+        }
+        catch (...)
+        {
+            sqlite3_finalize(insert);
+            connection.exec("ROLLBACK TO flatgeobuf_import");
+            connection.exec("RELEASE flatgeobuf_import");
+            throw;
+        }
+        sqlite3_finalize(insert);
+        connection.exec("RELEASE flatgeobuf_import");
+        return count;
+    }
+
+    unsigned long long FlatGeobuf::next(unsigned long long feature) const
+    {
+        if (feature >= this->_featuresSize || this->_featuresSize - feature < 4)
+        {
+            throw std::runtime_error("Invalid FlatGeobuf feature!");
+        }
+        const unsigned long long size = getScalar(this->_features + feature, 4);
+        if (size > this->_featuresSize - feature - 4)
+        {
+            throw std::runtime_error("Invalid FlatGeobuf feature!");
+        }
+        return feature + 4 + size;
+    }
+
+    FlatGeobuf * FlatGeobuf::open(std::string const & filename)
+    {
+        std::unique_ptr<FlatGeobuf> file(new FlatGeobuf());
+        file->_mapping = mapFile(filename, file->_mappingSize);
+        const unsigned char * data = static_cast<const unsigned char *>(file->_mapping);
+        const size_t size = file->_mappingSize;
+
+        // ==================================================
+        // Signature of any version 3 file and header
+        // --------------------------------------------------
+        Table header;
+        unsigned long long used = 0;
+        if (size < sizeof(FGB_MAGIC) ||
+            std::memcmp(data, FGB_MAGIC, 4) != 0 ||
+            std::memcmp(data + 4, FGB_MAGIC + 4, 3) != 0 ||
+            !openRoot(data + sizeof(FGB_MAGIC), size - sizeof(FGB_MAGIC), header, used))
+        {
+            throw std::runtime_error("Invalid FlatGeobuf file!");
+        }
+        const bool hasZ = header.scalar(HEADER_HAS_Z, 1, 0) != 0;
+        const bool hasM = header.scalar(HEADER_HAS_M, 1, 0) != 0;
+        file->_dimensions = hasZ ? (hasM ? GAIA_XY_Z_M : GAIA_XY_Z) :
+                                   (hasM ? GAIA_XY_M : GAIA_XY);
+        file->_geometryType = (int)header.scalar(HEADER_GEOMETRY_TYPE, 1, 0);
+        file->_count = header.scalar(HEADER_FEATURES_COUNT, 8, 0);
+        file->_nodeSize = (int)header.scalar(HEADER_INDEX_NODE_SIZE, 2, 16);
+        if (file->_geometryType > GAIA_GEOMETRYCOLLECTION ||
+            !header.string(HEADER_NAME, file->_name))
+        {
+            throw std::runtime_error("Invalid FlatGeobuf file!");
+        }
+
+        size_t start = 0;
+        size_t count = 0;
+        if (!header.vector(HEADER_ENVELOPE, 8, start, count))
+        {
+            throw std::runtime_error("Invalid FlatGeobuf file!");
+        }
+        if (count >= 4)
+        {
+            file->_extent = true;
+            file->_minx = getDouble(header.data + start);
+            file->_miny = getDouble(header.data + start + 8);
+            file->_maxx = getDouble(header.data + start + 16);
+            file->_maxy = getDouble(header.data + start + 24);
+        }
+        if (!header.vector(HEADER_COLUMNS, 4, start, count))
+        {
+            throw std::runtime_error("Invalid FlatGeobuf file!");
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            const size_t at = start + 4 * i;
+            Table table;
+            Column column;
+            if (!table.open(header.data, header.size,
+                            at + (size_t)getScalar(header.data + at, 4)) ||
+                !table.string(COLUMN_NAME, column.name))
+            {
+                throw std::runtime_error("Invalid FlatGeobuf file!");
+            }
+            column.type = (int)table.scalar(COLUMN_TYPE, 1, 0);
+            if (column.type > BINARY) throw std::runtime_error("Invalid FlatGeobuf file!");
+            file->_columns.push_back(column);
+        }
+        Table crs;
+        if (header.child(HEADER_CRS, crs))
+        {
+            file->_srid = (int)crs.scalar(CRS_CODE, 4, 0);
+        }
+
+        // ==================================================
+        // Index and feature sections
+        // --------------------------------------------------
+        size_t position = sizeof(FGB_MAGIC) + (size_t)used;
+        if (file->_nodeSize == 1) throw std::runtime_error("Invalid FlatGeobuf file!");
+        if (file->_nodeSize > 0 && file->_count > 0)
+        {
+            file->_numNodes = getLevelBounds(file->_count, file->_nodeSize,
+                                             file->_levelBounds);
+            if (file->_numNodes > (size - position) / FGB_NODE_SIZE)
+            {
+                throw std::runtime_error("Invalid FlatGeobuf file!");
+            }
+            file->_index = data + position;
+            position += file->_numNodes * FGB_NODE_SIZE;
+        }
+        else
+        {
+            file->_nodeSize = 0;
+        }
+        file->_features = data + position;
+        file->_featuresSize = size - position;
+        return file.release();
+    }
+
+    size_t FlatGeobuf::search(double minx,
+                              double miny,
+                              double maxx,
+                              double maxy,
+                              std::vector<unsigned long long> & features) const
+    {
+        const size_t before = features.size();
+        if (!this->_index)
+        {
+            // Scan the features without an index
+            for (unsigned long long feature = 0; feature < this->_featuresSize;
+                 feature = this->next(feature))
+            {
+                Table root;
+                Table table;
+                unsigned long long used = 0;
+                double box[4] = {HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+                if (!openRoot(this->_features + feature,
+                              this->_featuresSize - feature, root, used) ||
+                    (root.has(FEATURE_GEOMETRY) &&
+                     (!root.child(FEATURE_GEOMETRY, table) ||
+                      !extendBounds(table, box, 0))))
+                {
+                    throw std::runtime_error("Invalid FlatGeobuf feature!");
+                }
+                if (maxx < box[0] || maxy < box[1] || minx > box[2] || miny > box[3])
+                {
+                    continue;
+                }
+                features.push_back(feature);
+            }
+            return features.size() - before;
+        }
+
+        // ==================================================
+        // Walk the index from the root, which is the first node
+        // --------------------------------------------------
+        const size_t leaves = this->_levelBounds[0].first;
+        std::vector<std::pair<size_t, size_t> > stack;
+        stack.push_back(std::make_pair((size_t)0, this->_levelBounds.size() - 1));
+        while (!stack.empty())
+        {
+            const size_t node = stack.back().first;
+            const size_t level = stack.back().second;
+            stack.pop_back();
+            const size_t end = std::min(node + (size_t)this->_nodeSize,
+                                        this->_levelBounds[level].second);
+            for (size_t position = node; position < end; position++)
+            {
+                const unsigned char * item = this->_index + position * FGB_NODE_SIZE;
+                if (maxx < getDouble(item) || maxy < getDouble(item + 8) ||
+                    minx > getDouble(item + 16) || miny > getDouble(item + 24))
+                {
+                    continue;
+                }
+                const unsigned long long offset = getScalar(item + 32, 8);
+                if (position >= leaves)
+                {
+                    if (offset >= this->_featuresSize)
+                    {
+                        throw std::runtime_error("Invalid FlatGeobuf index!");
+                    }
+                    features.push_back(offset);
+                }
+                else
+                {
+                    // Children sit on the next level down
+                    if (level == 0 ||
+                        offset < this->_levelBounds[level - 1].first ||
+                        offset >= this->_levelBounds[level - 1].second)
+                    {
+                        throw std::runtime_error("Invalid FlatGeobuf index!");
+                    }
+                    stack.push_back(std::make_pair((size_t)offset, level - 1));
+                }
+            }
+        }
+        std::sort(features.begin() + before, features.end());
+        return features.size() - before;
+    }
+
+}
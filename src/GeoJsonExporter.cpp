@@ -0,0 +1,1168 @@
+/**
+ * @file    GeoJsonExporter.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeoJsonExporter class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/GeoJsonExporter.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdint.h>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // Powers of ten exactly representable as doubles and integers
+        const long long POWERS[] =
+        {
+            1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL,
+            10000000LL, 100000000LL, 1000000000LL, 10000000000LL,
+            100000000000LL, 1000000000000LL, 10000000000000LL,
+            100000000000000LL, 1000000000000000LL
+        };
+
+        // Largest scaled value formatted with integer arithmetic
+        const double SCALED_LIMIT = 9.0e15;
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Writes the decimal digits of an unsigned integer
+         * @returns Number of characters written
+         */
+        size_t formatUnsigned(unsigned long long value, char * text)
+        {
+            char digits[24];
+            size_t count = 0;
+            do
+            {
+                digits[count++] = (char)('0' + value % 10);
+                value /= 10;
+            } while (value);
+            for (size_t i = 0; i < count; i++) text[i] = digits[count - 1 - i];
+            return count;
+        }
+
+        /**
+         * @brief Writes the decimal digits of a signed integer
+         * @returns Number of characters written
+         */
+        size_t formatInteger(long long value, char * text)
+        {
+            if (value >= 0) return formatUnsigned(value, text);
+            text[0] = '-';
+            return 1 + formatUnsigned(0ULL - (unsigned long long)value, text + 1);
+        }
+
+        /**
+         * @brief Floating-point number f * 2^e with a 64-bit significand
+         */
+        struct DiyFp
+        {
+            uint64_t f;  ///< Significand
+            int e;       ///< Binary exponent
+        };
+
+        /**
+         * @brief Cached power of ten c * 2^e = 10^k
+         */
+        struct CachedPower
+        {
+            uint64_t f;  ///< Significand
+            int e;       ///< Binary exponent
+            int k;       ///< Decimal exponent
+        };
+
+        // Normalized powers of ten 10^-300 to 10^324 in steps of eight
+        const CachedPower CACHED_POWERS[] =
+        {
+            {0xAB70FE17C79AC6CAULL, -1060, -300},
+            {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+            {0xBE5691EF416BD60CULL, -1007, -284},
+            {0x8DD01FAD907FFC3CULL, -980, -276},
+            {0xD3515C2831559A83ULL, -954, -268},
+            {0x9D71AC8FADA6C9B5ULL, -927, -260},
+            {0xEA9C227723EE8BCBULL, -901, -252},
+            {0xAECC49914078536DULL, -874, -244},
+            {0x823C12795DB6CE57ULL, -847, -236},
+            {0xC21094364DFB5637ULL, -821, -228},
+            {0x9096EA6F3848984FULL, -794, -220},
+            {0xD77485CB25823AC7ULL, -768, -212},
+            {0xA086CFCD97BF97F4ULL, -741, -204},
+            {0xEF340A98172AACE5ULL, -715, -196},
+            {0xB23867FB2A35B28EULL, -688, -188},
+            {0x84C8D4DFD2C63F3BULL, -661, -180},
+            {0xC5DD44271AD3CDBAULL, -635, -172},
+            {0x936B9FCEBB25C996ULL, -608, -164},
+            {0xDBAC6C247D62A584ULL, -582, -156},
+            {0xA3AB66580D5FDAF6ULL, -555, -148},
+            {0xF3E2F893DEC3F126ULL, -529, -140},
+            {0xB5B5ADA8AAFF80B8ULL, -502, -132},
+            {0x87625F056C7C4A8BULL, -475, -124},
+            {0xC9BCFF6034C13053ULL, -449, -116},
+            {0x964E858C91BA2655ULL, -422, -108},
+            {0xDFF9772470297EBDULL, -396, -100},
+            {0xA6DFBD9FB8E5B88FULL, -369, -92},
+            {0xF8A95FCF88747D94ULL, -343, -84},
+            {0xB94470938FA89BCFULL, -316, -76},
+            {0x8A08F0F8BF0F156BULL, -289, -68},
+            {0xCDB02555653131B6ULL, -263, -60},
+            {0x993FE2C6D07B7FACULL, -236, -52},
+            {0xE45C10C42A2B3B06ULL, -210, -44},
+            {0xAA242499697392D3ULL, -183, -36},
+            {0xFD87B5F28300CA0EULL, -157, -28},
+            {0xBCE5086492111AEBULL, -130, -20},
+            {0x8CBCCC096F5088CCULL, -103, -12},
+            {0xD1B71758E219652CULL, -77, -4},
+            {0x9C40000000000000ULL, -50, 4},
+            {0xE8D4A51000000000ULL, -24, 12},
+            {0xAD78EBC5AC620000ULL, 3, 20},
+            {0x813F3978F8940984ULL, 30, 28},
+            {0xC097CE7BC90715B3ULL, 56, 36},
+            {0x8F7E32CE7BEA5C70ULL, 83, 44},
+            {0xD5D238A4ABE98068ULL, 109, 52},
+            {0x9F4F2726179A2245ULL, 136, 60},
+            {0xED63A231D4C4FB27ULL, 162, 68},
+            {0xB0DE65388CC8ADA8ULL, 189, 76},
+            {0x83C7088E1AAB65DBULL, 216, 84},
+            {0xC45D1DF942711D9AULL, 242, 92},
+            {0x924D692CA61BE758ULL, 269, 100},
+            {0xDA01EE641A708DEAULL, 295, 108},
+            {0xA26DA3999AEF774AULL, 322, 116},
+            {0xF209787BB47D6B85ULL, 348, 124},
+            {0xB454E4A179DD1877ULL, 375, 132},
+            {0x865B86925B9BC5C2ULL, 402, 140},
+            {0xC83553C5C8965D3DULL, 428, 148},
+            {0x952AB45CFA97A0B3ULL, 455, 156},
+            {0xDE469FBD99A05FE3ULL, 481, 164},
+            {0xA59BC234DB398C25ULL, 508, 172},
+            {0xF6C69A72A3989F5CULL, 534, 180},
+            {0xB7DCBF5354E9BECEULL, 561, 188},
+            {0x88FCF317F22241E2ULL, 588, 196},
+            {0xCC20CE9BD35C78A5ULL, 614, 204},
+            {0x98165AF37B2153DFULL, 641, 212},
+            {0xE2A0B5DC971F303AULL, 667, 220},
+            {0xA8D9D1535CE3B396ULL, 694, 228},
+            {0xFB9B7CD9A4A7443CULL, 720, 236},
+            {0xBB764C4CA7A44410ULL, 747, 244},
+            {0x8BAB8EEFB6409C1AULL, 774, 252},
+            {0xD01FEF10A657842CULL, 800, 260},
+            {0x9B10A4E5E9913129ULL, 827, 268},
+            {0xE7109BFBA19C0C9DULL, 853, 276},
+            {0xAC2820D9623BF429ULL, 880, 284},
+            {0x80444B5E7AA7CF85ULL, 907, 292},
+            {0xBF21E44003ACDD2DULL, 933, 300},
+            {0x8E679C2F5E44FF8FULL, 960, 308},
+            {0xD433179D9C8CB841ULL, 986, 316},
+            {0x9E19DB92B4E31BA9ULL, 1013, 324},
+        };
+
+        // Target range of the binary exponent of the scaled boundaries
+        const int GRISU_ALPHA = -60;
+
+        /**
+         * @returns x - y for x and y of the same exponent
+         */
+        DiyFp subtract(DiyFp const & x, DiyFp const & y)
+        {
+            DiyFp result = {x.f - y.f, x.e};
+            return result;
+        }
+
+        /**
+         * @returns x * y with the upper half of the product rounded
+         */
+        DiyFp multiply(DiyFp const & x, DiyFp const & y)
+        {
+            const uint64_t a = x.f >> 32;
+            const uint64_t b = x.f & 0xFFFFFFFFu;
+            const uint64_t c = y.f >> 32;
+            const uint64_t d = y.f & 0xFFFFFFFFu;
+            const uint64_t ac = a * c;
+            const uint64_t bc = b * c;
+            const uint64_t ad = a * d;
+            const uint64_t bd = b * d;
+            const uint64_t middle = (bd >> 32) + (ad & 0xFFFFFFFFu) +
+                                    (bc & 0xFFFFFFFFu) + (1u << 31);
+            DiyFp result = {ac + (ad >> 32) + (bc >> 32) + (middle >> 32),
+                            x.e + y.e + 64};
+            return result;
+        }
+
+        /**
+         * @returns x shifted so that its highest bit is set
+         */
+        DiyFp normalize(DiyFp x)
+        {
+            while ((x.f >> 63) == 0)
+            {
+                x.f <<= 1;
+                x.e--;
+            }
+            return x;
+        }
+
+        /**
+         * @brief Removes digits above the upper boundary towards the
+         *        value while the result stays inside the boundaries
+         */
+        void roundDigits(char * digits,
+                         int count,
+                         uint64_t distance,
+                         uint64_t delta,
+                         uint64_t rest,
+                         uint64_t ten)
+        {
+            while (rest < distance && delta - rest >= ten &&
+                   (rest + ten < distance ||
+                    distance - rest > rest + ten - distance))
+            {
+                digits[count - 1]--;
+                rest += ten;
+            }
+        }
+
+        /**
+         * @brief Grisu2 shortest digits of a positive finite double
+         * @details Finds the shortest digits between the boundaries of the
+         *          value, scaled by a cached power of ten so that only
+         *          64-bit integer arithmetic is needed. The digits always
+         *          read back as the value and are the shortest possible
+         *          for nearly all doubles. The result does not depend on
+         *          the locale.
+         * @param[in]  value    Positive finite value
+         * @param[out] digits   At least 17 digits, not null-terminated
+         * @param[out] exponent Decimal exponent of the last digit
+         * @returns Number of digits
+         */
+        int getShortestDigits(double value, char * digits, int & exponent)
+        {
+            // ==================================================
+            // Value and the midpoints to its neighbours
+            // --------------------------------------------------
+            uint64_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            const uint64_t hidden = 1ULL << 52;
+            const uint64_t fraction = bits & (hidden - 1);
+            const int biased = (int)(bits >> 52);
+            DiyFp v = {fraction, 1 - 1075};
+            if (biased != 0)
+            {
+                v.f = fraction + hidden;
+                v.e = biased - 1075;
+            }
+            DiyFp upper = {2 * v.f + 1, v.e - 1};
+            DiyFp lower = {2 * v.f - 1, v.e - 1};
+            if (fraction == 0 && biased > 1)
+            {
+                // The lower neighbour is closer at a power of two
+                lower.f = 4 * v.f - 1;
+                lower.e = v.e - 2;
+            }
+            upper = normalize(upper);
+            lower.f <<= lower.e - upper.e;
+            lower.e = upper.e;
+            v = normalize(v);
+
+            // ==================================================
+            // Scale into the exponent range of the digit generation
+            // --------------------------------------------------
+            const int f = GRISU_ALPHA - upper.e - 1;
+            const int k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+            const CachedPower & cached = CACHED_POWERS[(300 + k + 7) / 8];
+            const DiyFp power = {cached.f, cached.e};
+            const DiyFp w = multiply(v, power);
+            DiyFp high = multiply(upper, power);
+            DiyFp low = multiply(lower, power);
+            high.f--;
+            low.f++;
+            exponent = -cached.k;
+
+            // ==================================================
+            // Integral digits of the upper boundary
+            // --------------------------------------------------
+            uint64_t delta = subtract(high, low).f;
+            uint64_t distance = subtract(high, w).f;
+            const int shift = -high.e;
+            const uint64_t one = 1ULL << shift;
+            uint32_t integral = (uint32_t)(high.f >> shift);
+            uint64_t rest = high.f & (one - 1);
+            uint32_t ten = 1000000000;
+            int remaining = 10;
+            while (ten > integral && remaining > 1)
+            {
+                ten /= 10;
+                remaining--;
+            }
+            int count = 0;
+            while (remaining > 0)
+            {
+                digits[count++] = (char)('0' + integral / ten);
+                integral %= ten;
+                remaining--;
+                const uint64_t left = ((uint64_t)integral << shift) + rest;
+                if (left <= delta)
+                {
+                    exponent += remaining;
+                    roundDigits(digits, count, distance, delta, left,
+                                (uint64_t)ten << shift);
+                    return count;
+                }
+                ten /= 10;
+            }
+
+            // ==================================================
+            // Fractional digits until inside the boundaries
+            // --------------------------------------------------
+            for (;;)
+            {
+                rest *= 10;
+                digits[count++] = (char)('0' + (rest >> shift));
+                rest &= one - 1;
+                delta *= 10;
+                distance *= 10;
+                exponent--;
+                if (rest <= delta) break;
+            }
+            roundDigits(digits, count, distance, delta, rest, one);
+            return count;
+        }
+
+        /**
+         * @brief Rounds digits half away from zero to a number of decimals
+         * @param[in,out] digits   Digits, trailing zeros dropped
+         * @param[in,out] count    Number of digits, zero if nothing is left
+         * @param[in,out] exponent Decimal exponent of the last digit
+         * @param[in]     decimals Number of decimals kept
+         */
+        void roundDecimals(char * digits,
+                           int & count,
+                           int & exponent,
+                           int decimals)
+        {
+            const int keep = count + exponent + decimals;
+            if (keep >= count) return;
+            if (keep < 0)
+            {
+                count = 0;
+                return;
+            }
+            const bool up = digits[keep] >= '5';
+            exponent += count - keep;
+            count = keep;
+            if (up)
+            {
+                int i = count - 1;
+                while (i >= 0 && digits[i] == '9') i--;
+                if (i < 0)
+                {
+                    // All nines carry into a new leading one
+                    digits[0] = '1';
+                    exponent += count;
+                    count = 1;
+                    return;
+                }
+                digits[i]++;
+                exponent += count - 1 - i;
+                count = i + 1;
+            }
+            while (count > 0 && digits[count - 1] == '0')
+            {
+                count--;
+                exponent++;
+            }
+        }
+
+        /**
+         * @brief Appends a string with JSON escapes
+         */
+        void appendEscaped(std::string & output, const char * text)
+        {
+            const char * run = text;
+            const char * c = text;
+            for (; *c; c++)
+            {
+                const unsigned char u = (unsigned char)*c;
+                if (u >= 0x20 && u != '"' && u != '\\') continue;
+                output.append(run, c - run);
+                if (u == '"') output.append("\\\"", 2);
+                else if (u == '\\') output.append("\\\\", 2);
+                else
+                {
+                    char code[8];
+                    std::snprintf(code, sizeof(code), "\\u%04x", u);
+                    output.append(code, 6);
+                }
+                run = c + 1;
+            }
+            output.append(run, c - run);
+        }
+
+        /**
+         * @brief Appends a coordinate array [x,y] or [x,y,z]
+         */
+        void appendPosition(std::string & output,
+                            double x,
+                            double y,
+                            const double * z,
+                            int precision)
+        {
+            char text[104];
+            size_t size = 0;
+            text[size++] = '[';
+            size += GeoJsonExporter::formatNumber(x, precision, text + size);
+            text[size++] = ',';
+            size += GeoJsonExporter::formatNumber(y, precision, text + size);
+            if (z)
+            {
+                text[size++] = ',';
+                size += GeoJsonExporter::formatNumber(*z, precision, text + size);
+            }
+            text[size++] = ']';
+            output.append(text, size);
+        }
+
+        /**
+         * @brief Appends the positions of a coordinate array
+         */
+        void appendPositions(std::string & output,
+                             const double * coords,
+                             int points,
+                             int dimensions,
+                             int precision)
+        {
+            const int stride = CoordinateBuffer::getStride(dimensions);
+            const bool hasZ =
+                dimensions == GAIA_XY_Z || dimensions == GAIA_XY_Z_M;
+            output += '[';
+            for (int i = 0; i < points; i++)
+            {
+                const double * c = coords + i * stride;
+                if (i) output += ',';
+                appendPosition(output, c[0], c[1], hasZ ? c + 2 : 0, precision);
+            }
+            output += ']';
+        }
+
+        /**
+         * @brief Appends the rings of a polygon
+         */
+        void appendRings(std::string & output,
+                         gaiaPolygonPtr polygon,
+                         int precision)
+        {
+            output += '[';
+            gaiaRingPtr ring = polygon->Exterior;
+            appendPositions(output, ring->Coords, ring->Points,
+                            ring->DimensionModel, precision);
+            for (int i = 0; i < polygon->NumInteriors; i++)
+            {
+                ring = polygon->Interiors + i;
+                output += ',';
+                appendPositions(output, ring->Coords, ring->Points,
+                                ring->DimensionModel, precision);
+            }
+            output += ']';
+        }
+
+        /**
+         * @brief Appends a point position
+         */
+        void appendPoint(std::string & output, gaiaPointPtr point, int precision)
+        {
+            const bool hasZ = point->DimensionModel == GAIA_XY_Z ||
+                              point->DimensionModel == GAIA_XY_Z_M;
+            appendPosition(output, point->X, point->Y,
+                           hasZ ? &point->Z : 0, precision);
+        }
+
+        /**
+         * @brief Appends a GeoJSON geometry object, using the same type
+         *        rules as gaiaOutGeoJSON
+         */
+        void appendGeometry(std::string & output,
+                            gaiaGeomCollPtr geometry,
+                            int precision)
+        {
+            int points = 0;
+            int lines = 0;
+            int polygons = 0;
+            for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next) points++;
+            for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+            {
+                lines++;
+            }
+            for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+            {
+                polygons++;
+            }
+            if (points + lines + polygons == 0)
+            {
+                output.append("null", 4);
+                return;
+            }
+            const int declared = geometry->DeclaredType % 1000;
+
+            // ==================================================
+            // Single homogeneous collections
+            // --------------------------------------------------
+            if (declared != GAIA_GEOMETRYCOLLECTION)
+            {
+                if (lines == 0 && polygons == 0)
+                {
+                    if (points == 1 && declared != GAIA_MULTIPOINT)
+                    {
+                        output.append("{\"type\":\"Point\",\"coordinates\":");
+                        appendPoint(output, geometry->FirstPoint, precision);
+                        output += '}';
+                        return;
+                    }
+                    output.append("{\"type\":\"MultiPoint\",\"coordinates\":[");
+                    for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+                    {
+                        if (p != geometry->FirstPoint) output += ',';
+                        appendPoint(output, p, precision);
+                    }
+                    output.append("]}", 2);
+                    return;
+                }
+                if (points == 0 && polygons == 0)
+                {
+                    gaiaLinestringPtr line = geometry->FirstLinestring;
+                    if (lines == 1 && declared != GAIA_MULTILINESTRING)
+                    {
+                        output.append("{\"type\":\"LineString\",\"coordinates\":");
+                        appendPositions(output, line->Coords, line->Points,
+                                        line->DimensionModel, precision);
+                        output += '}';
+                        return;
+                    }
+                    output.append(
+                        "{\"type\":\"MultiLineString\",\"coordinates\":[");
+                    for (; line; line = line->Next)
+                    {
+                        if (line != geometry->FirstLinestring) output += ',';
+                        appendPositions(output, line->Coords, line->Points,
+                                        line->DimensionModel, precision);
+                    }
+                    output.append("]}", 2);
+                    return;
+                }
+                if (points == 0 && lines == 0)
+                {
+                    gaiaPolygonPtr polygon = geometry->FirstPolygon;
+                    if (polygons == 1 && declared != GAIA_MULTIPOLYGON)
+                    {
+                        output.append("{\"type\":\"Polygon\",\"coordinates\":");
+                        appendRings(output, polygon, precision);
+                        output += '}';
+                        return;
+                    }
+                    output.append("{\"type\":\"MultiPolygon\",\"coordinates\":[");
+                    for (; polygon; polygon = polygon->Next)
+                    {
+                        if (polygon != geometry->FirstPolygon) output += ',';
+                        appendRings(output, polygon, precision);
+                    }
+                    output.append("]}", 2);
+                    return;
+                }
+            }
+
+            // ==================================================
+            // Mixed content as a collection of simple geometries
+            // --------------------------------------------------
+            output.append("{\"type\":\"GeometryCollection\",\"geometries\":[");
+            bool first = true;
+            for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+            {
+                output.append(first ? "" : ",");
+                output.append("{\"type\":\"Point\",\"coordinates\":");
+                appendPoint(output, p, precision);
+                output += '}';
+                first = false;
+            }
+            for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+            {
+                output.append(first ? "" : ",");
+                output.append("{\"type\":\"LineString\",\"coordinates\":");
+                appendPositions(output, l->Coords, l->Points,
+                                l->DimensionModel, precision);
+                output += '}';
+                first = false;
+            }
+            for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+            {
+                output.append(first ? "" : ",");
+                output.append("{\"type\":\"Polygon\",\"coordinates\":");
+                appendRings(output, p, precision);
+                output += '}';
+                first = false;
+            }
+            output.append("]}", 2);
+        }
+
+        /**
+         * @brief Appends a row as a feature preceded by a comma
+         */
+        void appendFeature(std::string & output,
+                           sqlite3_stmt * row,
+                           int geometryColumn,
+                           std::vector<std::string> const & keys,
+                           int precision)
+        {
+            output.append(",\n{\"type\":\"Feature\",\"geometry\":");
+            gaiaGeomCollPtr geometry = 0;
+            if (sqlite3_column_type(row, geometryColumn) == SQLITE_BLOB)
+            {
+                geometry = BlobEncoding::decode(
+                    (const unsigned char *)sqlite3_column_blob(row, geometryColumn),
+                    sqlite3_column_bytes(row, geometryColumn));
+            }
+            if (geometry)
+            {
+                appendGeometry(output, geometry, precision);
+                gaiaFreeGeomColl(geometry);
+            }
+            else
+            {
+                output.append("null", 4);
+            }
+
+            // ==================================================
+            // Properties with pre-escaped keys
+            // --------------------------------------------------
+            output.append(",\"properties\":{");
+            char number[32];
+            for (int i = 0; i < (int)keys.size(); i++)
+            {
+                if (i == geometryColumn) continue;
+                output.append(keys[i]);
+                switch (sqlite3_column_type(row, i))
+                {
+                case SQLITE_INTEGER:
+                    output.append(number,
+                                  formatInteger(sqlite3_column_int64(row, i),
+                                                number));
+                    break;
+                case SQLITE_FLOAT:
+                    output.append(number,
+                                  GeoJsonExporter::formatNumber(
+                                      sqlite3_column_double(row, i),
+                                      -1,
+                                      number));
+                    break;
+                case SQLITE_TEXT:
+                    {
+                        const char * text =
+                            (const char *)sqlite3_column_text(row, i);
+                        output += '"';
+                        appendEscaped(output, text ? text : "");
+                        output += '"';
+                    }
+                    break;
+                default:
+                    output.append("null", 4);
+                    break;
+                }
+            }
+            output.append("}}", 2);
+        }
+
+        /**
+         * @brief Writes bytes to a file descriptor
+         */
+        void writeAll(int fd, const char * data, size_t size)
+        {
+            while (size > 0)
+            {
+#ifdef _WIN32
+                const unsigned int chunk =
+                    size > 0x40000000 ? 0x40000000 : (unsigned int)size;
+                const int written = _write(fd, data, chunk);
+#else
+                const ssize_t written = ::write(fd, data, size);
+#endif
+                if (written < 0)
+                {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("Failed to write output!");
+                }
+                data += written;
+                size -= written;
+            }
+        }
+
+        /**
+         * @brief State shared by the workers and the writer
+         */
+        struct ExportState
+        {
+            std::string filename;           ///< Database file, empty if shared
+            sqlite3 * shared;               ///< Caller connection if no file
+            std::string sql;                ///< Chunk query
+            int geometryColumn;             ///< Geometry column index
+            std::vector<std::string> keys;  ///< Escaped property keys
+            int precision;                  ///< Coordinate precision
+            std::vector<sqlite3_int64> bounds; ///< First and last rowid by chunk
+            size_t chunks;                  ///< Number of chunks
+
+            std::mutex mutex;               ///< Guards the fields below
+            std::condition_variable changed;///< Signals any change
+            size_t window;                  ///< Chunks held at most
+            size_t claimed;                 ///< Next chunk to serialize
+            size_t written;                 ///< Next chunk to write
+            std::vector<std::string> slots; ///< Serialized chunks by slot
+            std::vector<long long> counts;  ///< Features per slot
+            std::vector<char> ready;        ///< Slot holds its chunk
+            bool failed;                    ///< Export aborted
+            std::string error;              ///< First error message
+        };
+
+        /**
+         * @brief Aborts the export with an error
+         */
+        void fail(ExportState & state, const char * message)
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.failed) state.error = message;
+            state.failed = true;
+            state.changed.notify_all();
+        }
+
+        /**
+         * @brief Finalizes a statement on scope exit
+         */
+        struct StatementGuard
+        {
+            sqlite3_stmt * statement;  ///< Owned statement
+            ~StatementGuard() { sqlite3_finalize(this->statement); }
+        };
+
+        /**
+         * @brief Collects the first and last rowid of every run of rows
+         */
+        void splitRows(sqlite3 * handle, std::string const & table,
+                       sqlite3_int64 rows, std::vector<sqlite3_int64> & bounds)
+        {
+            StatementGuard guard = {0};
+            const std::string sql = "SELECT rowid FROM " + quoteName(table) +
+                                    " ORDER BY rowid";
+            if (sqlite3_prepare_v2(handle, sql.c_str(), -1,
+                                   &guard.statement, 0) != SQLITE_OK)
+            {
+                throw std::runtime_error("Failed to read table!");
+            }
+            sqlite3_int64 count = 0;
+            sqlite3_int64 rowid = 0;
+            int result = SQLITE_ROW;
+            while ((result = sqlite3_step(guard.statement)) == SQLITE_ROW)
+            {
+                rowid = sqlite3_column_int64(guard.statement, 0);
+                if (count % rows == 0) bounds.push_back(rowid);
+                if (++count % rows == 0) bounds.push_back(rowid);
+            }
+            if (result != SQLITE_DONE)
+            {
+                throw std::runtime_error("Failed to read table!");
+            }
+            if (bounds.size() % 2) bounds.push_back(rowid);
+        }
+
+        /**
+         * @brief Serializes chunks until none are left
+         */
+        void exportChunks(ExportState * state)
+        {
+            try
+            {
+                // ==================================================
+                // Own read-only connection unless the database is in memory
+                // --------------------------------------------------
+                SQLite::Database * connection = 0;
+                if (!state->shared)
+                {
+                    connection = new SQLite::Database(state->filename,
+                                                      SQLITE_OPEN_READONLY);
+                }
+                std::unique_ptr<SQLite::Database> owner(connection);
+                sqlite3 * handle =
+                    connection ? connection->getHandle() : state->shared;
+                StatementGuard guard = {0};
+                if (sqlite3_prepare_v2(handle, state->sql.c_str(), -1,
+                                       &guard.statement, 0) != SQLITE_OK)
+                {
+                    throw std::runtime_error("Failed to read table!");
+                }
+                sqlite3_stmt * statement = guard.statement;
+                size_t reserve = 0;
+
+                for (;;)
+                {
+                    // ==================================================
+                    // Claim the next chunk once the writer is close enough
+                    // --------------------------------------------------
+                    size_t chunk = 0;
+                    {
+                        std::unique_lock<std::mutex> lock(state->mutex);
+                        while (!state->failed &&
+                               state->claimed < state->chunks &&
+                               state->claimed >= state->written + state->window)
+                        {
+                            state->changed.wait(lock);
+                        }
+                        if (state->failed || state->claimed >= state->chunks)
+                        {
+                            return;
+                        }
+                        chunk = state->claimed++;
+                    }
+
+                    // ==================================================
+                    // Serialize its rows
+                    // --------------------------------------------------
+                    std::string text;
+                    long long count = 0;
+                    text.reserve(reserve);
+                    sqlite3_bind_int64(statement, 1, state->bounds[2 * chunk]);
+                    sqlite3_bind_int64(statement, 2, state->bounds[2 * chunk + 1]);
+                    int result = SQLITE_ROW;
+                    while ((result = sqlite3_step(statement)) == SQLITE_ROW)
+                    {
+                        appendFeature(text, statement, state->geometryColumn,
+                                      state->keys, state->precision);
+                        count++;
+                    }
+                    sqlite3_reset(statement);
+                    if (result != SQLITE_DONE)
+                    {
+                        throw std::runtime_error("Failed to read table!");
+                    }
+                    if (text.size() > reserve) reserve = text.size();
+
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    const size_t slot = chunk % state->window;
+                    state->slots[slot].swap(text);
+                    state->counts[slot] = count;
+                    state->ready[slot] = 1;
+                    state->changed.notify_all();
+                }
+            }
+            catch (std::exception & e)
+            {
+                fail(*state, e.what());
+            }
+        }
+
+    }
+
+    GeoJsonExporter::GeoJsonExporter(int threads, int precision, int chunkSize) :
+        _chunkSize(chunkSize),
+        _precision(precision),
+        _threads(threads)
+    {
+        if (threads < 0) throw std::runtime_error("Invalid thread count!");
+        if (precision < -1 || precision > 15)
+        {
+            throw std::runtime_error("Invalid precision!");
+        }
+        if (chunkSize < 1) throw std::runtime_error("Invalid chunk size!");
+        if (this->_threads == 0)
+        {
+            this->_threads = (int)std::thread::hardware_concurrency();
+        }
+        if (this->_threads == 0) this->_threads = 1;
+    }
+
+    GeoJsonExporter::~GeoJsonExporter()
+    {
+    }
+
+    long long GeoJsonExporter::exportTable(SpatialDatabase const & database,
+                                           std::string const & table,
+                                           std::string const & geometry,
+                                           int fd) const
+    {
+        if (fd < 0) throw std::runtime_error("Invalid file descriptor!");
+        sqlite3 * handle = database.getDatabase()->getHandle();
+        ExportState state;
+        state.sql = "SELECT * FROM " + quoteName(table) +
+                    " WHERE rowid BETWEEN ? AND ? ORDER BY rowid";
+        state.precision = this->_precision;
+
+        // ==================================================
+        // Find the geometry column and escape the property keys
+        // --------------------------------------------------
+        {
+            StatementGuard guard = {0};
+            if (sqlite3_prepare_v2(handle, state.sql.c_str(), -1,
+                                   &guard.statement, 0) != SQLITE_OK)
+            {
+                throw std::runtime_error("Failed to read table!");
+            }
+            state.geometryColumn = -1;
+            bool first = true;
+            for (int i = 0; i < sqlite3_column_count(guard.statement); i++)
+            {
+                const char * name = sqlite3_column_name(guard.statement, i);
+                std::string key;
+                if (sqlite3_stricmp(name, geometry.c_str()) == 0 &&
+                    state.geometryColumn < 0)
+                {
+                    state.geometryColumn = i;
+                }
+                else
+                {
+                    key = first ? "\"" : ",\"";
+                    appendEscaped(key, name);
+                    key += "\":";
+                    first = false;
+                }
+                state.keys.push_back(key);
+            }
+            if (state.geometryColumn < 0)
+            {
+                throw std::runtime_error("Geometry column not found!");
+            }
+        }
+
+        // ==================================================
+        // Split the rows into chunks of equal count, sparse rowids or not
+        // --------------------------------------------------
+        splitRows(handle, table, this->_chunkSize, state.bounds);
+        state.chunks = state.bounds.size() / 2;
+
+        // ==================================================
+        // Workers need the database file to open their own connections
+        // --------------------------------------------------
+        const char * filename = sqlite3_db_filename(handle, "main");
+        int threads = this->_threads;
+        state.shared = 0;
+        if (filename && *filename) state.filename = filename;
+        else
+        {
+            state.shared = handle;
+            threads = 1;
+        }
+        if ((size_t)threads > state.chunks) threads = (int)state.chunks;
+        state.window = 2 * (size_t)(threads > 0 ? threads : 1);
+        state.claimed = 0;
+        state.written = 0;
+        state.slots.resize(state.window);
+        state.counts.assign(state.window, 0);
+        state.ready.assign(state.window, 0);
+        state.failed = false;
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; i++)
+        {
+            workers.push_back(std::thread(exportChunks, &state));
+        }
+
+        // ==================================================
+        // Write the chunks in order as they complete
+        // --------------------------------------------------
+        long long count = 0;
+        try
+        {
+            static const char header[] =
+                "{\"type\":\"FeatureCollection\",\"features\":[";
+            writeAll(fd, header, sizeof(header) - 1);
+            bool first = true;
+            for (size_t chunk = 0; chunk < state.chunks; chunk++)
+            {
+                std::string text;
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    const size_t slot = chunk % state.window;
+                    while (!state.failed && !state.ready[slot])
+                    {
+                        state.changed.wait(lock);
+                    }
+                    if (state.failed) break;
+                    text.swap(state.slots[slot]);
+                    count += state.counts[slot];
+                    state.ready[slot] = 0;
+                    state.written++;
+                    state.changed.notify_all();
+                }
+                if (text.empty()) continue;
+
+                // The first feature is not preceded by a comma
+                const size_t skip = first ? 1 : 0;
+                writeAll(fd, text.data() + skip, text.size() - skip);
+                first = false;
+            }
+        }
+        catch (std::exception & e)
+        {
+            fail(state, e.what());
+        }
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+        if (state.failed) throw std::runtime_error(state.error);
+        static const char footer[] = "\n]}\n";
+        writeAll(fd, footer, sizeof(footer) - 1);
+        return count;
+    }
+
+    size_t GeoJsonExporter::formatNumber(double value, int precision, char * text)
+    {
+        if (!std::isfinite(value))
+        {
+            std::memcpy(text, "null", 4);
+            return 4;
+        }
+
+        // ==================================================
+        // Fixed decimals with integer arithmetic
+        // --------------------------------------------------
+        if (precision >= 0 && precision <= 15)
+        {
+            const double scaled = value * (double)POWERS[precision];
+            if (std::fabs(scaled) < SCALED_LIMIT)
+            {
+                const long long rounded = std::llround(scaled);
+                if (rounded == 0)
+                {
+                    text[0] = '0';
+                    return 1;
+                }
+                size_t size = 0;
+                unsigned long long magnitude = rounded < 0 ?
+                    0ULL - (unsigned long long)rounded :
+                    (unsigned long long)rounded;
+                if (rounded < 0) text[size++] = '-';
+                const unsigned long long scale = POWERS[precision];
+                size += formatUnsigned(magnitude / scale, text + size);
+                unsigned long long fraction = magnitude % scale;
+                if (fraction == 0) return size;
+
+                // Fraction digits with leading zeros, trailing zeros dropped
+                int digits = precision;
+                while (fraction % 10 == 0)
+                {
+                    fraction /= 10;
+                    digits--;
+                }
+                text[size++] = '.';
+                for (int i = digits - 1; i >= 0; i--)
+                {
+                    text[size + i] = (char)('0' + fraction % 10);
+                    fraction /= 10;
+                }
+                return size + digits;
+            }
+        }
+
+        // ==================================================
+        // Shortest digits that round-trip, then the precision
+        // --------------------------------------------------
+        char digits[24];
+        int count = 0;
+        int exponent = 0;
+        if (value != 0)
+        {
+            count = getShortestDigits(std::fabs(value), digits, exponent);
+            if (precision >= 0)
+            {
+                roundDecimals(digits, count, exponent, precision);
+            }
+        }
+        if (count == 0)
+        {
+            text[0] = '0';
+            return 1;
+        }
+        size_t size = 0;
+        if (value < 0) text[size++] = '-';
+
+        // ==================================================
+        // Plain notation for moderate magnitudes as with %.17g
+        // --------------------------------------------------
+        const int point = count + exponent;
+        if (point >= -3 && point <= 17)
+        {
+            if (point <= 0)
+            {
+                text[size++] = '0';
+                text[size++] = '.';
+                for (int i = point; i < 0; i++) text[size++] = '0';
+                std::memcpy(text + size, digits, count);
+                return size + count;
+            }
+            if (point >= count)
+            {
+                std::memcpy(text + size, digits, count);
+                size += count;
+                for (int i = count; i < point; i++) text[size++] = '0';
+                return size;
+            }
+            std::memcpy(text + size, digits, point);
+            size += point;
+            text[size++] = '.';
+            std::memcpy(text + size, digits + point, count - point);
+            return size + count - point;
+        }
+        text[size++] = digits[0];
+        if (count > 1)
+        {
+            text[size++] = '.';
+            std::memcpy(text + size, digits + 1, count - 1);
+            size += count - 1;
+        }
+        text[size++] = 'e';
+        text[size++] = point - 1 < 0 ? '-' : '+';
+        const int scientific = point - 1 < 0 ? 1 - point : point - 1;
+        if (scientific < 10) text[size++] = '0';
+        return size + formatUnsigned(scientific, text + size);
+    }
+
+    int GeoJsonExporter::getChunkSize() const
+    {
+        return this->_chunkSize;
+    }
+
+    int GeoJsonExporter::getPrecision() const
+    {
+        return this->_precision;
+    }
+
+    int GeoJsonExporter::getThreadCount() const
+    {
+        return this->_threads;
+    }
+
+}
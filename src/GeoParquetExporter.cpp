@@ -0,0 +1,1097 @@
+/**
+ * @file    GeoParquetExporter.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeoParquetExporter class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/GeoParquetExporter.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+#include "SpatiaLiteCpp/GeoJsonExporter.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+extern "C"
+{
+#include "sqlite3.h"
+#include "spatialite/gaiageo.h"
+}
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // Parquet physical types
+        const int PARQUET_INT64 = 2;
+        const int PARQUET_DOUBLE = 5;
+        const int PARQUET_BYTE_ARRAY = 6;
+
+        // Parquet enumerations
+        const int PARQUET_OPTIONAL = 1;
+        const int PARQUET_REQUIRED = 0;
+        const int PARQUET_UTF8 = 0;
+        const int PARQUET_PLAIN = 0;
+        const int PARQUET_RLE = 3;
+        const int PARQUET_UNCOMPRESSED = 0;
+        const int PARQUET_DATA_PAGE = 0;
+
+        // Thrift compact protocol types
+        const int THRIFT_I16 = 4;
+        const int THRIFT_I32 = 5;
+        const int THRIFT_I64 = 6;
+        const int THRIFT_BINARY = 8;
+        const int THRIFT_LIST = 9;
+        const int THRIFT_STRUCT = 12;
+
+        // Names of the bbox struct fields
+        const char * const BBOX_FIELDS[4] = {"xmin", "ymin", "xmax", "ymax"};
+
+        // GeoParquet geometry type names by gaia type
+        const char * const GEOMETRY_TYPES[7] =
+        {
+            "Point", "LineString", "Polygon", "MultiPoint",
+            "MultiLineString", "MultiPolygon", "GeometryCollection"
+        };
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Appends a little-endian unsigned value
+         */
+        void appendScalar(std::vector<unsigned char> & output,
+                          unsigned long long value,
+                          int size)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                output.push_back((unsigned char)(value >> (8 * i)));
+            }
+        }
+
+        /**
+         * @returns Bits of a double
+         */
+        unsigned long long fromDouble(double value)
+        {
+            unsigned long long bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        /**
+         * @brief Appends an unsigned LEB128 varint
+         */
+        void appendVarint(std::vector<unsigned char> & output, unsigned long long value)
+        {
+            while (value >= 0x80)
+            {
+                output.push_back((unsigned char)(value | 0x80));
+                value >>= 7;
+            }
+            output.push_back((unsigned char)value);
+        }
+
+        /**
+         * @brief Appends a string with JSON escapes
+         */
+        void appendEscaped(std::string & output, std::string const & text)
+        {
+            for (size_t i = 0; i < text.size(); i++)
+            {
+                const unsigned char c = (unsigned char)text[i];
+                if (c == '"' || c == '\\')
+                {
+                    output += '\\';
+                    output += (char)c;
+                }
+                else if (c < 0x20)
+                {
+                    char code[8];
+                    std::snprintf(code, sizeof(code), "\\u%04x", c);
+                    output += code;
+                }
+                else
+                {
+                    output += (char)c;
+                }
+            }
+        }
+
+        /**
+         * @brief Appends a number as JSON text
+         */
+        void appendNumber(std::string & output, double value)
+        {
+            char text[32];
+            output.append(text, GeoJsonExporter::formatNumber(value, -1, text));
+        }
+
+        // ==================================================
+        // Thrift compact protocol writer
+        // --------------------------------------------------
+
+        /**
+         * @brief Writes Thrift structs in the compact protocol
+         */
+        struct Thrift
+        {
+            std::vector<unsigned char> & output;  ///< Encoded bytes
+            std::vector<int> fields;              ///< Last field id per struct
+
+            explicit Thrift(std::vector<unsigned char> & bytes) :
+                output(bytes),
+                fields(1, 0)
+            {
+            }
+
+            void header(int id, int type)
+            {
+                const int delta = id - this->fields.back();
+                if (delta > 0 && delta <= 15)
+                {
+                    this->output.push_back((unsigned char)((delta << 4) | type));
+                }
+                else
+                {
+                    this->output.push_back((unsigned char)type);
+                    appendVarint(this->output, ((unsigned int)id << 1) ^ (unsigned int)(id >> 31));
+                }
+                this->fields.back() = id;
+            }
+
+            void integer(long long value)
+            {
+                appendVarint(this->output,
+                             ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+            }
+
+            void i16(int id, int value)
+            {
+                this->header(id, THRIFT_I16);
+                this->integer(value);
+            }
+
+            void i32(int id, int value)
+            {
+                this->header(id, THRIFT_I32);
+                this->integer(value);
+            }
+
+            void i64(int id, long long value)
+            {
+                this->header(id, THRIFT_I64);
+                this->integer(value);
+            }
+
+            void binary(const void * data, size_t size)
+            {
+                appendVarint(this->output, size);
+                const unsigned char * bytes = static_cast<const unsigned char *>(data);
+                this->output.insert(this->output.end(), bytes, bytes + size);
+            }
+
+            void binary(int id, const void * data, size_t size)
+            {
+                this->header(id, THRIFT_BINARY);
+                this->binary(data, size);
+            }
+
+            void string(int id, std::string const & text)
+            {
+                this->binary(id, text.data(), text.size());
+            }
+
+            void list(int id, int type, size_t size)
+            {
+                this->header(id, THRIFT_LIST);
+                if (size < 15)
+                {
+                    this->output.push_back((unsigned char)((size << 4) | type));
+                }
+                else
+                {
+                    this->output.push_back((unsigned char)(0xF0 | type));
+                    appendVarint(this->output, size);
+                }
+            }
+
+            /**
+             * @brief Starts a struct field, or a list element without an id
+             */
+            void begin(int id = 0)
+            {
+                if (id) this->header(id, THRIFT_STRUCT);
+                this->fields.push_back(0);
+            }
+
+            void end()
+            {
+                this->output.push_back(0);
+                this->fields.pop_back();
+            }
+        };
+
+        // ==================================================
+        // Row group encoding
+        // --------------------------------------------------
+
+        /**
+         * @brief Leaf column of the file
+         */
+        struct Leaf
+        {
+            std::string name;  ///< Field name
+            int type;          ///< Physical type
+            bool utf8;         ///< Set for text
+            int source;        ///< Statement column, or -1 for bbox fields
+        };
+
+        /**
+         * @brief Maps a declared SQLite type to a leaf column
+         */
+        Leaf getLeaf(std::string const & name, std::string const & declared, int source)
+        {
+            std::string type(declared);
+            for (size_t i = 0; i < type.size(); i++)
+            {
+                type[i] = (char)std::toupper((unsigned char)type[i]);
+            }
+            Leaf leaf = {name, PARQUET_DOUBLE, false, source};
+            if (type.find("INT") != std::string::npos)
+            {
+                leaf.type = PARQUET_INT64;
+            }
+            else if (type.find("CHAR") != std::string::npos ||
+                     type.find("CLOB") != std::string::npos ||
+                     type.find("TEXT") != std::string::npos ||
+                     type.find("DATE") != std::string::npos ||
+                     type.find("TIME") != std::string::npos)
+            {
+                leaf.type = PARQUET_BYTE_ARRAY;
+                leaf.utf8 = true;
+            }
+            else if (type.empty() || type.find("BLOB") != std::string::npos)
+            {
+                leaf.type = PARQUET_BYTE_ARRAY;
+            }
+            return leaf;
+        }
+
+        /**
+         * @brief Values and statistics of one column chunk
+         */
+        struct ChunkBuilder
+        {
+            std::vector<unsigned char> levels;  ///< Definition level per row
+            std::vector<unsigned char> values;  ///< PLAIN encoded values
+            long long nulls;                    ///< Number of NULLs
+            bool bounded;                       ///< Set once min and max are known
+            sqlite3_int64 minInteger;           ///< Minimum of INT64 columns
+            sqlite3_int64 maxInteger;           ///< Maximum of INT64 columns
+            double minDouble;                   ///< Minimum of DOUBLE columns
+            double maxDouble;                   ///< Maximum of DOUBLE columns
+
+            void reset()
+            {
+                this->levels.clear();
+                this->values.clear();
+                this->nulls = 0;
+                this->bounded = false;
+                this->minInteger = this->maxInteger = 0;
+                this->minDouble = this->maxDouble = 0;
+            }
+
+            void addNull()
+            {
+                this->levels.push_back(0);
+                this->nulls++;
+            }
+
+            void addInteger(sqlite3_int64 value)
+            {
+                this->levels.push_back(1);
+                appendScalar(this->values, (unsigned long long)value, 8);
+                this->minInteger = this->bounded ? std::min(this->minInteger, value) : value;
+                this->maxInteger = this->bounded ? std::max(this->maxInteger, value) : value;
+                this->bounded = true;
+            }
+
+            void addDouble(double value)
+            {
+                this->levels.push_back(1);
+                appendScalar(this->values, fromDouble(value), 8);
+                if (std::isnan(value)) return;
+                this->minDouble = this->bounded ? std::min(this->minDouble, value) : value;
+                this->maxDouble = this->bounded ? std::max(this->maxDouble, value) : value;
+                this->bounded = true;
+            }
+
+            void addBytes(const void * data, size_t size)
+            {
+                this->levels.push_back(1);
+                appendScalar(this->values, size, 4);
+                const unsigned char * bytes = static_cast<const unsigned char *>(data);
+                this->values.insert(this->values.end(), bytes, bytes + size);
+            }
+        };
+
+        /**
+         * @brief Placement and statistics of a written column chunk
+         */
+        struct ChunkInfo
+        {
+            size_t offset;         ///< Offset in the row group
+            size_t size;           ///< Size with the page header
+            long long nulls;       ///< Number of NULLs
+            bool bounded;          ///< Set if min and max are known
+            unsigned long long min;  ///< PLAIN encoded minimum
+            unsigned long long max;  ///< PLAIN encoded maximum
+        };
+
+        /**
+         * @brief Encoded row group
+         */
+        struct RowGroup
+        {
+            std::vector<unsigned char> bytes;  ///< Column chunks
+            std::vector<ChunkInfo> chunks;     ///< One per leaf
+            long long rows;                    ///< Number of rows
+            unsigned int types;                ///< Geometry types seen
+            int srid;                          ///< SRID of the first geometry
+            double box[4];                     ///< Extent of the geometries
+        };
+
+        /**
+         * @brief Appends a column chunk as a single data page
+         */
+        void appendChunk(RowGroup & group, ChunkBuilder const & builder, int type)
+        {
+            // Definition levels as runs of the RLE/bit-packed hybrid
+            std::vector<unsigned char> levels(4, 0);
+            for (size_t i = 0; i < builder.levels.size();)
+            {
+                size_t end = i + 1;
+                while (end < builder.levels.size() && builder.levels[end] == builder.levels[i])
+                {
+                    end++;
+                }
+                appendVarint(levels, (unsigned long long)(end - i) << 1);
+                levels.push_back(builder.levels[i]);
+                i = end;
+            }
+            const size_t length = levels.size() - 4;
+            for (int i = 0; i < 4; i++) levels[i] = (unsigned char)(length >> (8 * i));
+
+            const size_t pageSize = levels.size() + builder.values.size();
+            ChunkInfo info = {group.bytes.size(), 0, builder.nulls, builder.bounded, 0, 0};
+            Thrift page(group.bytes);
+            page.i32(1, PARQUET_DATA_PAGE);
+            page.i32(2, (int)pageSize);
+            page.i32(3, (int)pageSize);
+            page.begin(5);
+            page.i32(1, (int)builder.levels.size());
+            page.i32(2, PARQUET_PLAIN);
+            page.i32(3, PARQUET_RLE);
+            page.i32(4, PARQUET_RLE);
+            page.end();
+            page.end();
+            group.bytes.insert(group.bytes.end(), levels.begin(), levels.end());
+            group.bytes.insert(group.bytes.end(), builder.values.begin(), builder.values.end());
+            info.size = group.bytes.size() - info.offset;
+            if (type == PARQUET_INT64)
+            {
+                info.min = (unsigned long long)builder.minInteger;
+                info.max = (unsigned long long)builder.maxInteger;
+            }
+            else if (type == PARQUET_DOUBLE)
+            {
+                info.min = fromDouble(builder.minDouble);
+                info.max = fromDouble(builder.maxDouble);
+            }
+            else
+            {
+                info.bounded = false;
+            }
+            group.chunks.push_back(info);
+        }
+
+        /**
+         * @brief State shared by the workers and the writer
+         */
+        struct ExportState
+        {
+            std::string filename;           ///< Database file, empty if shared
+            sqlite3 * shared;               ///< Caller connection if no file
+            std::string sql;                ///< Row group query
+            int geometryColumn;             ///< Geometry column index
+            std::vector<Leaf> leaves;       ///< Columns, then the bbox fields
+            std::vector<sqlite3_int64> bounds; ///< First and last rowid by group
+            size_t groups;                  ///< Number of row groups
+
+            std::mutex mutex;               ///< Guards the fields below
+            std::condition_variable changed;///< Signals any change
+            size_t window;                  ///< Row groups held at most
+            size_t claimed;                 ///< Next row group to encode
+            size_t written;                 ///< Next row group to write
+            std::vector<RowGroup> slots;    ///< Encoded row groups by slot
+            std::vector<char> ready;        ///< Slot holds its row group
+            bool failed;                    ///< Export aborted
+            std::string error;              ///< First error message
+        };
+
+        /**
+         * @brief Aborts the export with an error
+         */
+        void fail(ExportState & state, const char * message)
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.failed) state.error = message;
+            state.failed = true;
+            state.changed.notify_all();
+        }
+
+        /**
+         * @brief Finalizes a statement on scope exit
+         */
+        struct StatementGuard
+        {
+            sqlite3_stmt * statement;  ///< Owned statement
+            ~StatementGuard() { sqlite3_finalize(this->statement); }
+        };
+
+        /**
+         * @brief Appends the geometry of the current row and its bbox
+         */
+        void addGeometry(RowGroup & group,
+                         sqlite3_stmt * statement,
+                         int column,
+                         ChunkBuilder & wkb,
+                         ChunkBuilder * bbox)
+        {
+            gaiaGeomCollPtr geometry = 0;
+            if (sqlite3_column_type(statement, column) == SQLITE_BLOB)
+            {
+                geometry = BlobEncoding::decode(
+                    (const unsigned char *)sqlite3_column_blob(statement, column),
+                    sqlite3_column_bytes(statement, column));
+            }
+            unsigned char * bytes = 0;
+            int size = 0;
+            if (geometry) gaiaToWkb(geometry, &bytes, &size);
+            if (!bytes)
+            {
+                gaiaFreeGeomColl(geometry);
+                wkb.addNull();
+                for (int i = 0; i < 4; i++) bbox[i].addNull();
+                return;
+            }
+            wkb.addBytes(bytes, size);
+            std::free(bytes);
+
+            gaiaMbrGeometry(geometry);
+            const double box[4] = {geometry->MinX, geometry->MinY,
+                                   geometry->MaxX, geometry->MaxY};
+            for (int i = 0; i < 4; i++) bbox[i].addDouble(box[i]);
+            if (group.types == 0) group.srid = geometry->Srid;
+            const int type = geometry->DeclaredType % 1000;
+            if (type >= GAIA_POINT && type <= GAIA_GEOMETRYCOLLECTION)
+            {
+                const bool hasZ = geometry->DimensionModel == GAIA_XY_Z ||
+                                  geometry->DimensionModel == GAIA_XY_Z_M;
+                group.types |= 1u << (type - 1 + (hasZ ? 7 : 0));
+            }
+            else
+            {
+                group.types |= 1u << 14;
+            }
+            gaiaFreeGeomColl(geometry);
+            group.box[0] = std::min(group.box[0], box[0]);
+            group.box[1] = std::min(group.box[1], box[1]);
+            group.box[2] = std::max(group.box[2], box[2]);
+            group.box[3] = std::max(group.box[3], box[3]);
+        }
+
+        /**
+         * @brief Collects the first and last rowid of every run of rows
+         */
+        void splitRows(sqlite3 * handle, std::string const & table,
+                       sqlite3_int64 rows, std::vector<sqlite3_int64> & bounds)
+        {
+            StatementGuard guard = {0};
+            const std::string sql = "SELECT rowid FROM " + quoteName(table) +
+                                    " ORDER BY rowid";
+            if (sqlite3_prepare_v2(handle, sql.c_str(), -1,
+                                   &guard.statement, 0) != SQLITE_OK)
+            {
+                throw std::runtime_error("Failed to read table!");
+            }
+            sqlite3_int64 count = 0;
+            sqlite3_int64 rowid = 0;
+            int result = SQLITE_ROW;
+            while ((result = sqlite3_step(guard.statement)) == SQLITE_ROW)
+            {
+                rowid = sqlite3_column_int64(guard.statement, 0);
+                if (count % rows == 0) bounds.push_back(rowid);
+                if (++count % rows == 0) bounds.push_back(rowid);
+            }
+            if (result != SQLITE_DONE)
+            {
+                throw std::runtime_error("Failed to read table!");
+            }
+            if (bounds.size() % 2) bounds.push_back(rowid);
+        }
+
+        /**
+         * @brief Encodes row groups until none are left
+         */
+        void exportGroups(ExportState * state)
+        {
+            try
+            {
+                // ==================================================
+                // Own read-only connection unless the database is in memory
+                // --------------------------------------------------
+                SQLite::Database * connection = 0;
+                if (!state->shared)
+                {
+                    connection = new SQLite::Database(state->filename,
+                                                      SQLITE_OPEN_READONLY);
+                }
+                std::unique_ptr<SQLite::Database> owner(connection);
+                sqlite3 * handle =
+                    connection ? connection->getHandle() : state->shared;
+                StatementGuard guard = {0};
+                if (sqlite3_prepare_v2(handle, state->sql.c_str(), -1,
+                                       &guard.statement, 0) != SQLITE_OK)
+                {
+                    throw std::runtime_error("Failed to read table!");
+                }
+                sqlite3_stmt * statement = guard.statement;
+                std::vector<ChunkBuilder> builders(state->leaves.size());
+                ChunkBuilder * bbox = &builders[builders.size() - 4];
+
+                for (;;)
+                {
+                    // ==================================================
+                    // Claim the next range once the writer is close enough
+                    // --------------------------------------------------
+                    size_t index = 0;
+                    {
+                        std::unique_lock<std::mutex> lock(state->mutex);
+                        while (!state->failed &&
+                               state->claimed < state->groups &&
+                               state->claimed >= state->written + state->window)
+                        {
+                            state->changed.wait(lock);
+                        }
+                        if (state->failed || state->claimed >= state->groups)
+                        {
+                            return;
+                        }
+                        index = state->claimed++;
+                    }
+
+                    // ==================================================
+                    // Collect the column values of its rows
+                    // --------------------------------------------------
+                    RowGroup group;
+                    group.rows = 0;
+                    group.types = 0;
+                    group.srid = 0;
+                    group.box[0] = group.box[1] = HUGE_VAL;
+                    group.box[2] = group.box[3] = -HUGE_VAL;
+                    for (size_t i = 0; i < builders.size(); i++) builders[i].reset();
+                    sqlite3_bind_int64(statement, 1, state->bounds[2 * index]);
+                    sqlite3_bind_int64(statement, 2, state->bounds[2 * index + 1]);
+                    int result = SQLITE_ROW;
+                    while ((result = sqlite3_step(statement)) == SQLITE_ROW)
+                    {
+                        for (size_t i = 0; i + 4 < builders.size(); i++)
+                        {
+                            const int column = state->leaves[i].source;
+                            ChunkBuilder & builder = builders[i];
+                            if (column == state->geometryColumn)
+                            {
+                                addGeometry(group, statement, column, builder, bbox);
+                            }
+                            else if (sqlite3_column_type(statement, column) == SQLITE_NULL)
+                            {
+                                builder.addNull();
+                            }
+                            else if (state->leaves[i].type == PARQUET_INT64)
+                            {
+                                builder.addInteger(sqlite3_column_int64(statement, column));
+                            }
+                            else if (state->leaves[i].type == PARQUET_DOUBLE)
+                            {
+                                builder.addDouble(sqlite3_column_double(statement, column));
+                            }
+                            else if (state->leaves[i].utf8)
+                            {
+                                const unsigned char * text = sqlite3_column_text(statement, column);
+                                builder.addBytes(text, sqlite3_column_bytes(statement, column));
+                            }
+                            else
+                            {
+                                const void * blob = sqlite3_column_blob(statement, column);
+                                builder.addBytes(blob, sqlite3_column_bytes(statement, column));
+                            }
+                        }
+                        group.rows++;
+                    }
+                    sqlite3_reset(statement);
+                    if (result != SQLITE_DONE)
+                    {
+                        throw std::runtime_error("Failed to read table!");
+                    }
+
+                    // ==================================================
+                    // Encode the column chunks
+                    // --------------------------------------------------
+                    if (group.rows > 0)
+                    {
+                        size_t reserve = 0;
+                        for (size_t i = 0; i < builders.size(); i++)
+                        {
+                            reserve += 64 + builders[i].levels.size() / 8 +
+                                       builders[i].values.size();
+                        }
+                        group.bytes.reserve(reserve);
+                        for (size_t i = 0; i < builders.size(); i++)
+                        {
+                            appendChunk(group, builders[i], state->leaves[i].type);
+                        }
+                    }
+
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    const size_t slot = index % state->window;
+                    std::swap(state->slots[slot], group);
+                    state->ready[slot] = 1;
+                    state->changed.notify_all();
+                }
+            }
+            catch (std::exception & e)
+            {
+                fail(*state, e.what());
+            }
+        }
+
+        /**
+         * @brief Writes bytes to a file
+         */
+        void writeAll(FILE * file, const void * data, size_t size)
+        {
+            if (size > 0 && std::fwrite(data, 1, size, file) != size)
+            {
+                throw std::runtime_error("Failed to write output!");
+            }
+        }
+
+        /**
+         * @brief Column chunk metadata of a written row group
+         */
+        struct WrittenGroup
+        {
+            long long offset;               ///< File offset
+            long long size;                 ///< Size in bytes
+            long long rows;                 ///< Number of rows
+            std::vector<ChunkInfo> chunks;  ///< Column chunks
+        };
+
+        /**
+         * @brief Builds the GeoParquet metadata
+         */
+        std::string getGeoMetadata(std::string const & geometry,
+                                   unsigned int types,
+                                   int srid,
+                                   const double * box)
+        {
+            std::string name;
+            appendEscaped(name, geometry);
+            std::string json = "{\"version\":\"1.1.0\",\"primary_column\":\"" + name +
+                               "\",\"columns\":{\"" + name +
+                               "\":{\"encoding\":\"WKB\",\"geometry_types\":[";
+
+            // Types are listed only when every geometry has a known type
+            if (!(types & (1u << 14)))
+            {
+                bool first = true;
+                for (int i = 0; i < 14; i++)
+                {
+                    if (!(types & (1u << i))) continue;
+                    json += first ? "\"" : ",\"";
+                    json += GEOMETRY_TYPES[i % 7];
+                    json += i >= 7 ? " Z\"" : "\"";
+                    first = false;
+                }
+            }
+            json += "]";
+            if (box[0] <= box[2])
+            {
+                json += ",\"bbox\":[";
+                for (int i = 0; i < 4; i++)
+                {
+                    if (i) json += ",";
+                    appendNumber(json, box[i]);
+                }
+                json += "]";
+            }
+            json += ",\"covering\":{\"bbox\":{";
+            for (int i = 0; i < 4; i++)
+            {
+                if (i) json += ",";
+                json += std::string("\"") + BBOX_FIELDS[i] + "\":[\"bbox\",\"" +
+                        BBOX_FIELDS[i] + "\"]";
+            }
+            json += "}}";
+
+            // EPSG:4326 is stored longitude first, which is the default.
+            // Other CRSs need full PROJJSON, which takes PROJ to produce,
+            // so they are marked unknown and the SRID is kept on its own
+            if (srid <= 0)
+            {
+                json += ",\"crs\":null";
+            }
+            else if (srid != 4326)
+            {
+                char code[64];
+                std::snprintf(code, sizeof(code), ",\"crs\":null,\"srid\":%d", srid);
+                json += code;
+            }
+            json += "}}}";
+            return json;
+        }
+
+        /**
+         * @brief Appends the file metadata
+         */
+        void appendFooter(std::vector<unsigned char> & output,
+                          std::vector<Leaf> const & leaves,
+                          std::vector<WrittenGroup> const & groups,
+                          long long rows,
+                          std::string const & geo)
+        {
+            Thrift footer(output);
+            footer.i32(1, 1);
+
+            // Schema: the root, the columns, then the bbox struct
+            footer.list(2, THRIFT_STRUCT, leaves.size() + 2);
+            footer.begin();
+            footer.string(4, "schema");
+            footer.i32(5, (int)leaves.size() - 3);
+            footer.end();
+            for (size_t i = 0; i < leaves.size(); i++)
+            {
+                if (i + 4 == leaves.size())
+                {
+                    footer.begin();
+                    footer.i32(3, PARQUET_OPTIONAL);
+                    footer.string(4, "bbox");
+                    footer.i32(5, 4);
+                    footer.end();
+                }
+                footer.begin();
+                footer.i32(1, leaves[i].type);
+                footer.i32(3, leaves[i].source < 0 ? PARQUET_REQUIRED : PARQUET_OPTIONAL);
+                footer.string(4, leaves[i].name);
+                if (leaves[i].utf8) footer.i32(6, PARQUET_UTF8);
+                footer.end();
+            }
+            footer.i64(3, rows);
+
+            footer.list(4, THRIFT_STRUCT, groups.size());
+            for (size_t g = 0; g < groups.size(); g++)
+            {
+                WrittenGroup const & group = groups[g];
+                footer.begin();
+                footer.list(1, THRIFT_STRUCT, leaves.size());
+                for (size_t i = 0; i < leaves.size(); i++)
+                {
+                    ChunkInfo const & chunk = group.chunks[i];
+                    const long long offset = group.offset + (long long)chunk.offset;
+                    footer.begin();
+                    footer.i64(2, offset);
+                    footer.begin(3);
+                    footer.i32(1, leaves[i].type);
+                    footer.list(2, THRIFT_I32, 2);
+                    footer.integer(PARQUET_PLAIN);
+                    footer.integer(PARQUET_RLE);
+                    footer.list(3, THRIFT_BINARY, leaves[i].source < 0 ? 2 : 1);
+                    if (leaves[i].source < 0) footer.binary("bbox", 4);
+                    footer.binary(leaves[i].name.data(), leaves[i].name.size());
+                    footer.i32(4, PARQUET_UNCOMPRESSED);
+                    footer.i64(5, group.rows);
+                    footer.i64(6, (long long)chunk.size);
+                    footer.i64(7, (long long)chunk.size);
+                    footer.i64(9, offset);
+                    footer.begin(12);
+                    footer.i64(3, chunk.nulls);
+                    if (chunk.bounded)
+                    {
+                        unsigned char max[8];
+                        unsigned char min[8];
+                        for (int b = 0; b < 8; b++)
+                        {
+                            max[b] = (unsigned char)(chunk.max >> (8 * b));
+                            min[b] = (unsigned char)(chunk.min >> (8 * b));
+                        }
+                        footer.binary(5, max, 8);
+                        footer.binary(6, min, 8);
+                    }
+                    footer.end();
+                    footer.end();
+                    footer.end();
+                }
+                footer.i64(2, group.size);
+                footer.i64(3, group.rows);
+                footer.i64(5, group.offset);
+                footer.i64(6, group.size);
+                footer.i16(7, (int)g);
+                footer.end();
+            }
+
+            footer.list(5, THRIFT_STRUCT, 1);
+            footer.begin();
+            footer.string(1, "geo");
+            footer.string(2, geo);
+            footer.end();
+            footer.string(6, "SpatiaLiteCpp");
+
+            // Statistics follow the type defined order
+            footer.list(7, THRIFT_STRUCT, leaves.size());
+            for (size_t i = 0; i < leaves.size(); i++)
+            {
+                footer.begin();
+                footer.begin(1);
+                footer.end();
+                footer.end();
+            }
+            footer.end();
+        }
+
+    }
+
+    GeoParquetExporter::GeoParquetExporter(int threads, int rowGroupSize) :
+        _rowGroupSize(rowGroupSize),
+        _threads(threads)
+    {
+        if (threads < 0) throw std::runtime_error("Invalid thread count!");
+        if (rowGroupSize < 1) throw std::runtime_error("Invalid row group size!");
+        if (this->_threads == 0)
+        {
+            this->_threads = (int)std::thread::hardware_concurrency();
+        }
+        if (this->_threads == 0) this->_threads = 1;
+    }
+
+    GeoParquetExporter::~GeoParquetExporter()
+    {
+    }
+
+    long long GeoParquetExporter::exportTable(SpatialDatabase const & database,
+                                              std::string const & table,
+                                              std::string const & geometry,
+                                              std::string const & filename) const
+    {
+        sqlite3 * handle = database.getDatabase()->getHandle();
+        ExportState state;
+        state.sql = "SELECT * FROM " + quoteName(table) +
+                    " WHERE rowid BETWEEN ? AND ? ORDER BY rowid";
+
+        // ==================================================
+        // Type the columns from their declarations
+        // --------------------------------------------------
+        {
+            StatementGuard guard = {0};
+            if (sqlite3_prepare_v2(handle, state.sql.c_str(), -1,
+                                   &guard.statement, 0) != SQLITE_OK)
+            {
+                throw std::runtime_error("Failed to read table!");
+            }
+            const std::vector<std::string> types = database.getTypes(table);
+            const int count = sqlite3_column_count(guard.statement);
+            if ((int)types.size() != count)
+            {
+                throw std::runtime_error("Failed to read table!");
+            }
+            state.geometryColumn = -1;
+            for (int i = 0; i < count; i++)
+            {
+                const char * name = sqlite3_column_name(guard.statement, i);
+                Leaf leaf = getLeaf(name, types[i], i);
+                if (sqlite3_stricmp(name, geometry.c_str()) == 0 &&
+                    state.geometryColumn < 0)
+                {
+                    state.geometryColumn = i;
+                    leaf.type = PARQUET_BYTE_ARRAY;
+                    leaf.utf8 = false;
+                }
+                state.leaves.push_back(leaf);
+            }
+            if (state.geometryColumn < 0)
+            {
+                throw std::runtime_error("Geometry column not found!");
+            }
+            for (int i = 0; i < 4; i++)
+            {
+                Leaf leaf = {BBOX_FIELDS[i], PARQUET_DOUBLE, false, -1};
+                state.leaves.push_back(leaf);
+            }
+        }
+
+        // ==================================================
+        // Split the rows into row groups of equal count, sparse rowids or not
+        // --------------------------------------------------
+        splitRows(handle, table, this->_rowGroupSize, state.bounds);
+        state.groups = state.bounds.size() / 2;
+
+        // ==================================================
+        // Workers need the database file to open their own connections
+        // --------------------------------------------------
+        const char * source = sqlite3_db_filename(handle, "main");
+        int threads = this->_threads;
+        state.shared = 0;
+        if (source && *source) state.filename = source;
+        else
+        {
+            state.shared = handle;
+            threads = 1;
+        }
+        if ((size_t)threads > state.groups) threads = (int)state.groups;
+        state.window = 2 * (size_t)(threads > 0 ? threads : 1);
+        state.claimed = 0;
+        state.written = 0;
+        state.slots.resize(state.window);
+        state.ready.assign(state.window, 0);
+        state.failed = false;
+
+        const std::string temporary = filename + ".tmp";
+        FILE * file = std::fopen(temporary.c_str(), "wb");
+        if (!file) throw std::runtime_error("Failed to open output!");
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; i++)
+        {
+            workers.push_back(std::thread(exportGroups, &state));
+        }
+
+        // ==================================================
+        // Write the row groups in order as they complete
+        // --------------------------------------------------
+        long long count = 0;
+        std::vector<WrittenGroup> written;
+        unsigned int types = 0;
+        int srid = 0;
+        double box[4] = {HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+        long long offset = 4;
+        try
+        {
+            writeAll(file, "PAR1", 4);
+            for (size_t index = 0; index < state.groups; index++)
+            {
+                RowGroup group;
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    const size_t slot = index % state.window;
+                    while (!state.failed && !state.ready[slot])
+                    {
+                        state.changed.wait(lock);
+                    }
+                    if (state.failed) break;
+                    std::swap(group, state.slots[slot]);
+                    state.ready[slot] = 0;
+                    state.written++;
+                    state.changed.notify_all();
+                }
+                if (group.rows == 0) continue;
+
+                writeAll(file, &group.bytes[0], group.bytes.size());
+                WrittenGroup entry = {offset, (long long)group.bytes.size(),
+                                      group.rows, group.chunks};
+                written.push_back(entry);
+                offset += entry.size;
+                count += group.rows;
+                if (types == 0) srid = group.srid;
+                types |= group.types;
+                box[0] = std::min(box[0], group.box[0]);
+                box[1] = std::min(box[1], group.box[1]);
+                box[2] = std::max(box[2], group.box[2]);
+                box[3] = std::max(box[3], group.box[3]);
+            }
+        }
+        catch (std::exception & e)
+        {
+            fail(state, e.what());
+        }
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+
+        // ==================================================
+        // Metadata, its size and the closing magic
+        // --------------------------------------------------
+        try
+        {
+            if (state.failed) throw std::runtime_error(state.error);
+            std::vector<unsigned char> footer;
+            appendFooter(footer, state.leaves, written, count,
+                         getGeoMetadata(state.leaves[state.geometryColumn].name,
+                                        types, srid, box));
+            appendScalar(footer, footer.size(), 4);
+            footer.insert(footer.end(), "PAR1", "PAR1" + 4);
+            writeAll(file, &footer[0], footer.size());
+            const int closed = std::fclose(file);
+            file = 0;
+            if (closed != 0) throw std::runtime_error("Failed to write output!");
+#ifdef _WIN32
+            // rename does not replace an existing file on Windows
+            std::remove(filename.c_str());
+#endif
+            if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+            {
+                throw std::runtime_error("Failed to write output!");
+            }
+        }
+        catch (...)
+        {
+            if (file) std::fclose(file);
+            std::remove(temporary.c_str());
+            throw;
+        }
+        return count;
+    }
+
+    int GeoParquetExporter::getRowGroupSize() const
+    {
+        return this->_rowGroupSize;
+    }
+
+    int GeoParquetExporter::getThreadCount() const
+    {
+        return this->_threads;
+    }
+
+}
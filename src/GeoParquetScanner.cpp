@@ -0,0 +1,989 @@
+/**
+ * @file    GeoParquetScanner.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeoParquetScanner class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/GeoParquetScanner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // Parquet enumerations
+        const int PARQUET_REQUIRED = 0;
+        const int PARQUET_OPTIONAL = 1;
+        const int PARQUET_PLAIN = 0;
+        const int PARQUET_RLE = 3;
+        const int PARQUET_UNCOMPRESSED = 0;
+        const int PARQUET_DATA_PAGE = 0;
+
+        // Thrift compact protocol types
+        const int THRIFT_TRUE = 1;
+        const int THRIFT_FALSE = 2;
+        const int THRIFT_BYTE = 3;
+        const int THRIFT_I16 = 4;
+        const int THRIFT_I32 = 5;
+        const int THRIFT_I64 = 6;
+        const int THRIFT_DOUBLE = 7;
+        const int THRIFT_BINARY = 8;
+        const int THRIFT_LIST = 9;
+        const int THRIFT_SET = 10;
+        const int THRIFT_MAP = 11;
+        const int THRIFT_STRUCT = 12;
+
+        // Nesting limit of schemas and Thrift structs
+        const int MAX_DEPTH = 32;
+
+        // Names of the bbox struct fields
+        const char * const BBOX_FIELDS[4] = {"bbox.xmin", "bbox.ymin",
+                                             "bbox.xmax", "bbox.ymax"};
+
+        /**
+         * @returns Little-endian unsigned value
+         */
+        unsigned long long getScalar(const unsigned char * input, int size)
+        {
+            unsigned long long value = 0;
+            for (int i = size - 1; i >= 0; i--)
+            {
+                value = (value << 8) | input[i];
+            }
+            return value;
+        }
+
+        /**
+         * @returns Little-endian double
+         */
+        double getDouble(const unsigned char * input)
+        {
+            const unsigned long long bits = getScalar(input, 8);
+            double value = 0;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        /**
+         * @brief Maps a whole file read-only
+         */
+        void * mapFile(std::string const & filename, size_t & size)
+        {
+#ifdef _WIN32
+            HANDLE file = CreateFileA(filename.c_str(),
+                                      GENERIC_READ,
+                                      FILE_SHARE_READ,
+                                      0,
+                                      OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL,
+                                      0);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error("Failed to open Parquet file!");
+            }
+            LARGE_INTEGER length;
+            if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+            {
+                CloseHandle(file);
+                throw std::runtime_error("Invalid Parquet file!");
+            }
+            HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+            CloseHandle(file);
+            if (!mapping) throw std::runtime_error("Failed to map Parquet file!");
+            void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (!view) throw std::runtime_error("Failed to map Parquet file!");
+            size = (size_t)length.QuadPart;
+            return view;
+#else
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("Failed to open Parquet file!");
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0)
+            {
+                close(fd);
+                throw std::runtime_error("Invalid Parquet file!");
+            }
+            void * view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (view == MAP_FAILED)
+            {
+                throw std::runtime_error("Failed to map Parquet file!");
+            }
+            size = (size_t)info.st_size;
+            return view;
+#endif
+        }
+
+        /**
+         * @brief Releases a file view
+         */
+        void unmapFile(void * view, size_t size)
+        {
+#ifdef _WIN32
+            (void)size;
+            UnmapViewOfFile(view);
+#else
+            munmap(view, size);
+#endif
+        }
+
+        // ==================================================
+        // Thrift compact protocol reader
+        // --------------------------------------------------
+
+        /**
+         * @brief Bounds-checked reader of Thrift structs in the compact
+         *        protocol
+         */
+        struct Thrift
+        {
+            const unsigned char * data;  ///< Encoded bytes
+            size_t size;                 ///< Number of bytes
+            size_t position;             ///< Read position
+            std::vector<int> fields;     ///< Last field id per struct
+            bool value;                  ///< Value of the last bool field
+
+            Thrift(const unsigned char * bytes, size_t count) :
+                data(bytes),
+                size(count),
+                position(0),
+                fields(1, 0),
+                value(false)
+            {
+            }
+
+            static void fail()
+            {
+                throw std::runtime_error("Invalid Parquet metadata!");
+            }
+
+            unsigned char byte()
+            {
+                if (this->position >= this->size) fail();
+                return this->data[this->position++];
+            }
+
+            unsigned long long varint()
+            {
+                unsigned long long result = 0;
+                for (int shift = 0; shift < 64; shift += 7)
+                {
+                    const unsigned char b = this->byte();
+                    result |= (unsigned long long)(b & 0x7F) << shift;
+                    if (!(b & 0x80)) return result;
+                }
+                fail();
+                return 0;
+            }
+
+            long long integer()
+            {
+                const unsigned long long bits = this->varint();
+                return (long long)(bits >> 1) ^ -(long long)(bits & 1);
+            }
+
+            /**
+             * @brief Reads a length-prefixed byte string in place
+             */
+            const unsigned char * binary(size_t & length)
+            {
+                const unsigned long long count = this->varint();
+                if (count > this->size - this->position) fail();
+                const unsigned char * bytes = this->data + this->position;
+                this->position += (size_t)count;
+                length = (size_t)count;
+                return bytes;
+            }
+
+            std::string string()
+            {
+                size_t length = 0;
+                const unsigned char * bytes = this->binary(length);
+                return std::string((const char *)bytes, length);
+            }
+
+            /**
+             * @brief Reads a field header
+             * @returns False at the end of the struct
+             */
+            bool field(int & id, int & type)
+            {
+                const unsigned char header = this->byte();
+                if (header == 0) return false;
+                type = header & 0x0F;
+                const int delta = header >> 4;
+                if (delta) id = this->fields.back() + delta;
+                else id = (int)this->integer();
+                this->fields.back() = id;
+                if (type == THRIFT_TRUE || type == THRIFT_FALSE)
+                {
+                    this->value = type == THRIFT_TRUE;
+                }
+                return true;
+            }
+
+            void list(int & type, size_t & count)
+            {
+                const unsigned char header = this->byte();
+                type = header & 0x0F;
+                count = header >> 4;
+                if (count == 15) count = (size_t)this->varint();
+
+                // Every element takes at least a byte
+                if (count > this->size - this->position) fail();
+            }
+
+            void begin()
+            {
+                if (this->fields.size() > (size_t)MAX_DEPTH) fail();
+                this->fields.push_back(0);
+            }
+
+            void end()
+            {
+                this->fields.pop_back();
+            }
+
+            /**
+             * @brief Skips a value, with bool fields already read
+             */
+            void skip(int type, bool element = false)
+            {
+                size_t count = 0;
+                size_t length = 0;
+                int inner = 0;
+                int id = 0;
+                switch (type)
+                {
+                case THRIFT_TRUE:
+                case THRIFT_FALSE:
+                    if (element) this->byte();
+                    break;
+                case THRIFT_BYTE:
+                    this->byte();
+                    break;
+                case THRIFT_I16:
+                case THRIFT_I32:
+                case THRIFT_I64:
+                    this->varint();
+                    break;
+                case THRIFT_DOUBLE:
+                    if (this->size - this->position < 8) fail();
+                    this->position += 8;
+                    break;
+                case THRIFT_BINARY:
+                    this->binary(length);
+                    break;
+                case THRIFT_LIST:
+                case THRIFT_SET:
+                    this->list(inner, count);
+                    this->begin();
+                    for (size_t i = 0; i < count; i++) this->skip(inner, true);
+                    this->end();
+                    break;
+                case THRIFT_MAP:
+                {
+                    count = (size_t)this->varint();
+                    if (count == 0) break;
+                    if (count > this->size - this->position) fail();
+                    const unsigned char types = this->byte();
+                    this->begin();
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        this->skip(types >> 4, true);
+                        this->skip(types & 0x0F, true);
+                    }
+                    this->end();
+                    break;
+                }
+                case THRIFT_STRUCT:
+                    this->begin();
+                    while (this->field(id, inner)) this->skip(inner);
+                    this->end();
+                    break;
+                default:
+                    fail();
+                }
+            }
+        };
+
+        /**
+         * @brief Schema element
+         */
+        struct Element
+        {
+            int type;          ///< Physical type, or -1 for groups
+            int typeLength;    ///< Size of fixed-size byte arrays
+            int repetition;    ///< Repetition type
+            std::string name;  ///< Field name
+            int children;      ///< Number of children
+        };
+
+        /**
+         * @brief Reads a schema element
+         */
+        Element readElement(Thrift & thrift)
+        {
+            Element element = {-1, 0, PARQUET_REQUIRED, std::string(), 0};
+            int id = 0;
+            int type = 0;
+            thrift.begin();
+            while (thrift.field(id, type))
+            {
+                if (id == 1 && type == THRIFT_I32) element.type = (int)thrift.integer();
+                else if (id == 2 && type == THRIFT_I32) element.typeLength = (int)thrift.integer();
+                else if (id == 3 && type == THRIFT_I32) element.repetition = (int)thrift.integer();
+                else if (id == 4 && type == THRIFT_BINARY) element.name = thrift.string();
+                else if (id == 5 && type == THRIFT_I32) element.children = (int)thrift.integer();
+                else thrift.skip(type);
+            }
+            thrift.end();
+            return element;
+        }
+
+        /**
+         * @brief Adds the leaf columns below a group
+         * @returns Index of the element after the group
+         */
+        size_t addLeaves(std::vector<Element> const & elements,
+                         size_t index,
+                         std::string const & prefix,
+                         int level,
+                         int depth,
+                         std::vector<GeoParquetScanner::Column> & columns)
+        {
+            if (depth > MAX_DEPTH) Thrift::fail();
+            const int children = elements[index].children;
+            index++;
+            for (int i = 0; i < children; i++)
+            {
+                if (index >= elements.size()) Thrift::fail();
+                Element const & element = elements[index];
+                if (element.repetition != PARQUET_REQUIRED &&
+                    element.repetition != PARQUET_OPTIONAL)
+                {
+                    throw std::runtime_error("Unsupported Parquet schema!");
+                }
+                const int next = level + (element.repetition == PARQUET_OPTIONAL ? 1 : 0);
+                const std::string name = prefix + element.name;
+                if (element.children > 0)
+                {
+                    index = addLeaves(elements, index, name + ".", next, depth + 1, columns);
+                    continue;
+                }
+                if (element.type < GeoParquetScanner::BOOLEAN ||
+                    element.type > GeoParquetScanner::FIXED_LEN_BYTE_ARRAY)
+                {
+                    Thrift::fail();
+                }
+                GeoParquetScanner::Column column = {name, element.type,
+                                                    element.typeLength, next};
+                columns.push_back(column);
+                index++;
+            }
+            return index;
+        }
+
+        /**
+         * @brief Reads column statistics as doubles
+         */
+        void readStatistics(Thrift & thrift, int physical, bool & known, double & min, double & max)
+        {
+            const unsigned char * values[4] = {0, 0, 0, 0};
+            size_t sizes[4] = {0, 0, 0, 0};
+            int id = 0;
+            int type = 0;
+            thrift.begin();
+            while (thrift.field(id, type))
+            {
+                // Deprecated max and min, then max_value and min_value
+                const int slot = id == 1 ? 0 : id == 2 ? 1 : id == 5 ? 2 : id == 6 ? 3 : -1;
+                if (slot >= 0 && type == THRIFT_BINARY)
+                {
+                    values[slot] = thrift.binary(sizes[slot]);
+                }
+                else
+                {
+                    thrift.skip(type);
+                }
+            }
+            thrift.end();
+
+            const int first = values[2] && values[3] ? 2 : 0;
+            const unsigned char * high = values[first];
+            const unsigned char * low = values[first + 1];
+            const size_t width = physical == GeoParquetScanner::INT32 ||
+                                 physical == GeoParquetScanner::FLOAT ? 4 : 8;
+            known = false;
+            if (!high || !low || sizes[first] != width || sizes[first + 1] != width)
+            {
+                return;
+            }
+            known = true;
+            switch (physical)
+            {
+            case GeoParquetScanner::INT32:
+                min = (int)getScalar(low, 4);
+                max = (int)getScalar(high, 4);
+                break;
+            case GeoParquetScanner::INT64:
+                min = (double)(long long)getScalar(low, 8);
+                max = (double)(long long)getScalar(high, 8);
+                break;
+            case GeoParquetScanner::FLOAT:
+            {
+                const unsigned int a = (unsigned int)getScalar(low, 4);
+                const unsigned int b = (unsigned int)getScalar(high, 4);
+                float value = 0;
+                std::memcpy(&value, &a, 4);
+                min = value;
+                std::memcpy(&value, &b, 4);
+                max = value;
+                break;
+            }
+            case GeoParquetScanner::DOUBLE:
+                min = getDouble(low);
+                max = getDouble(high);
+                break;
+            default:
+                known = false;
+            }
+        }
+
+        /**
+         * @brief Decodes levels of the RLE/bit-packed hybrid encoding
+         */
+        void readLevels(const unsigned char * data,
+                        size_t size,
+                        int bitWidth,
+                        size_t count,
+                        std::vector<unsigned char> & levels)
+        {
+            levels.clear();
+            Thrift reader(data, size);
+            const size_t width = (size_t)(bitWidth + 7) / 8;
+            while (levels.size() < count)
+            {
+                const unsigned long long header = reader.varint();
+                if (header & 1)
+                {
+                    // Groups of eight values, least significant bit first
+                    const unsigned long long groups = header >> 1;
+                    if (groups > (size - reader.position) / (size_t)bitWidth)
+                    {
+                        throw std::runtime_error("Invalid Parquet page!");
+                    }
+                    const unsigned char * bits = data + reader.position;
+                    const size_t values = (size_t)groups * 8;
+                    for (size_t i = 0; i < values && levels.size() < count; i++)
+                    {
+                        unsigned int level = 0;
+                        for (int b = 0; b < bitWidth; b++)
+                        {
+                            const size_t bit = i * bitWidth + b;
+                            level |= ((bits[bit / 8] >> (bit % 8)) & 1u) << b;
+                        }
+                        levels.push_back((unsigned char)level);
+                    }
+                    reader.position += (size_t)groups * bitWidth;
+                }
+                else
+                {
+                    const unsigned long long run = header >> 1;
+                    if (run == 0 || width > size - reader.position)
+                    {
+                        throw std::runtime_error("Invalid Parquet page!");
+                    }
+                    const unsigned char level =
+                        (unsigned char)getScalar(data + reader.position, (int)width);
+                    reader.position += width;
+                    const size_t end = (size_t)std::min<unsigned long long>(count, levels.size() + run);
+                    levels.resize(end, level);
+                }
+            }
+        }
+
+    }
+
+    GeoParquetScanner::GeoParquetScanner() :
+        _columns(),
+        _geoMetadata(),
+        _geometryColumn(-1),
+        _mapping(0),
+        _mappingSize(0),
+        _rowCount(0),
+        _rowGroups()
+    {
+        for (int i = 0; i < 4; i++) this->_bbox[i] = -1;
+    }
+
+    GeoParquetScanner::~GeoParquetScanner()
+    {
+        if (this->_mapping) unmapFile(this->_mapping, this->_mappingSize);
+    }
+
+    int GeoParquetScanner::findColumn(std::string const & name) const
+    {
+        for (size_t i = 0; i < this->_columns.size(); i++)
+        {
+            if (this->_columns[i].name == name) return (int)i;
+        }
+        return -1;
+    }
+
+    std::vector<GeoParquetScanner::Column> const & GeoParquetScanner::getColumns() const
+    {
+        return this->_columns;
+    }
+
+    std::string const & GeoParquetScanner::getGeoMetadata() const
+    {
+        return this->_geoMetadata;
+    }
+
+    int GeoParquetScanner::getGeometryColumn() const
+    {
+        return this->_geometryColumn;
+    }
+
+    long long GeoParquetScanner::getRowCount() const
+    {
+        return this->_rowCount;
+    }
+
+    bool GeoParquetScanner::getRowGroupBounds(int group,
+                                              double & minx,
+                                              double & miny,
+                                              double & maxx,
+                                              double & maxy) const
+    {
+        if (group < 0 || group >= (int)this->_rowGroups.size())
+        {
+            throw std::runtime_error("Invalid row group!");
+        }
+        const std::vector<Chunk> & chunks = this->_rowGroups[group].chunks;
+        for (int i = 0; i < 4; i++)
+        {
+            if (this->_bbox[i] < 0 || !chunks[this->_bbox[i]].hasStatistics) return false;
+        }
+        minx = chunks[this->_bbox[0]].min;
+        miny = chunks[this->_bbox[1]].min;
+        maxx = chunks[this->_bbox[2]].max;
+        maxy = chunks[this->_bbox[3]].max;
+        return true;
+    }
+
+    int GeoParquetScanner::getRowGroupCount() const
+    {
+        return (int)this->_rowGroups.size();
+    }
+
+    long long GeoParquetScanner::getRowGroupRows(int group) const
+    {
+        if (group < 0 || group >= (int)this->_rowGroups.size())
+        {
+            throw std::runtime_error("Invalid row group!");
+        }
+        return this->_rowGroups[group].rows;
+    }
+
+    GeoParquetScanner * GeoParquetScanner::open(std::string const & filename)
+    {
+        std::unique_ptr<GeoParquetScanner> scanner(new GeoParquetScanner());
+        scanner->_mapping = mapFile(filename, scanner->_mappingSize);
+        const unsigned char * data = static_cast<const unsigned char *>(scanner->_mapping);
+        const size_t size = scanner->_mappingSize;
+
+        // ==================================================
+        // Magic at both ends and the metadata before the footer
+        // --------------------------------------------------
+        if (size < 12 || std::memcmp(data, "PAR1", 4) != 0 ||
+            std::memcmp(data + size - 4, "PAR1", 4) != 0)
+        {
+            throw std::runtime_error("Invalid Parquet file!");
+        }
+        const size_t length = (size_t)getScalar(data + size - 8, 4);
+        if (length > size - 12) throw std::runtime_error("Invalid Parquet file!");
+        const size_t end = size - 8 - length;
+        Thrift thrift(data + end, length);
+
+        std::vector<Element> elements;
+        int id = 0;
+        int type = 0;
+        size_t count = 0;
+        int inner = 0;
+        while (thrift.field(id, type))
+        {
+            if (id == 2 && type == THRIFT_LIST)
+            {
+                thrift.list(inner, count);
+                if (inner != THRIFT_STRUCT) Thrift::fail();
+                for (size_t i = 0; i < count; i++) elements.push_back(readElement(thrift));
+            }
+            else if (id == 3 && type == THRIFT_I64)
+            {
+                scanner->_rowCount = thrift.integer();
+            }
+            else if (id == 4 && type == THRIFT_LIST)
+            {
+                // ==================================================
+                // Row groups
+                // --------------------------------------------------
+                thrift.list(inner, count);
+                if (inner != THRIFT_STRUCT) Thrift::fail();
+                for (size_t g = 0; g < count; g++)
+                {
+                    RowGroup group;
+                    group.rows = 0;
+                    thrift.begin();
+                    while (thrift.field(id, type))
+                    {
+                        if (id == 3 && type == THRIFT_I64)
+                        {
+                            group.rows = thrift.integer();
+                            continue;
+                        }
+                        if (id != 1 || type != THRIFT_LIST)
+                        {
+                            thrift.skip(type);
+                            continue;
+                        }
+                        size_t chunks = 0;
+                        thrift.list(inner, chunks);
+                        if (inner != THRIFT_STRUCT) Thrift::fail();
+                        for (size_t c = 0; c < chunks; c++)
+                        {
+                            Chunk chunk = {PARQUET_UNCOMPRESSED, 0, -1, -1, 0, false, 0, 0};
+                            int physical = -1;
+                            thrift.begin();
+                            while (thrift.field(id, type))
+                            {
+                                if (id == 1 && type == THRIFT_BINARY)
+                                {
+                                    throw std::runtime_error("Unsupported Parquet file!");
+                                }
+                                if (id != 3 || type != THRIFT_STRUCT)
+                                {
+                                    thrift.skip(type);
+                                    continue;
+                                }
+                                thrift.begin();
+                                while (thrift.field(id, type))
+                                {
+                                    if (id == 1 && type == THRIFT_I32) physical = (int)thrift.integer();
+                                    else if (id == 4 && type == THRIFT_I32) chunk.codec = (int)thrift.integer();
+                                    else if (id == 5 && type == THRIFT_I64) chunk.values = thrift.integer();
+                                    else if (id == 7 && type == THRIFT_I64) chunk.size = thrift.integer();
+                                    else if (id == 9 && type == THRIFT_I64) chunk.dataOffset = thrift.integer();
+                                    else if (id == 11 && type == THRIFT_I64) chunk.dictionaryOffset = thrift.integer();
+                                    else if (id == 12 && type == THRIFT_STRUCT)
+                                    {
+                                        readStatistics(thrift, physical, chunk.hasStatistics,
+                                                       chunk.min, chunk.max);
+                                    }
+                                    else thrift.skip(type);
+                                }
+                                thrift.end();
+                            }
+                            thrift.end();
+
+                            // Pages must lie between the magic and the metadata
+                            const long long first =
+                                chunk.dictionaryOffset > 0 ? chunk.dictionaryOffset : chunk.dataOffset;
+                            if (first < 4 || chunk.size < 0 || chunk.values < 0 ||
+                                (unsigned long long)first > end ||
+                                (unsigned long long)chunk.size > end - (size_t)first)
+                            {
+                                throw std::runtime_error("Invalid Parquet file!");
+                            }
+                            group.chunks.push_back(chunk);
+                        }
+                    }
+                    thrift.end();
+                    scanner->_rowGroups.push_back(group);
+                }
+            }
+            else if (id == 5 && type == THRIFT_LIST)
+            {
+                thrift.list(inner, count);
+                if (inner != THRIFT_STRUCT) Thrift::fail();
+                for (size_t i = 0; i < count; i++)
+                {
+                    std::string key;
+                    std::string value;
+                    thrift.begin();
+                    while (thrift.field(id, type))
+                    {
+                        if (id == 1 && type == THRIFT_BINARY) key = thrift.string();
+                        else if (id == 2 && type == THRIFT_BINARY) value = thrift.string();
+                        else thrift.skip(type);
+                    }
+                    thrift.end();
+                    if (key == "geo") scanner->_geoMetadata = value;
+                }
+            }
+            else
+            {
+                thrift.skip(type);
+            }
+        }
+
+        // ==================================================
+        // Leaf columns, one chunk each in every row group
+        // --------------------------------------------------
+        if (elements.empty()) throw std::runtime_error("Invalid Parquet file!");
+        if (addLeaves(elements, 0, std::string(), 0, 0, scanner->_columns) != elements.size())
+        {
+            throw std::runtime_error("Invalid Parquet file!");
+        }
+        for (size_t g = 0; g < scanner->_rowGroups.size(); g++)
+        {
+            if (scanner->_rowGroups[g].chunks.size() != scanner->_columns.size() ||
+                scanner->_rowGroups[g].rows < 0)
+            {
+                throw std::runtime_error("Invalid Parquet file!");
+            }
+        }
+        for (int i = 0; i < 4; i++) scanner->_bbox[i] = scanner->findColumn(BBOX_FIELDS[i]);
+
+        // ==================================================
+        // Primary geometry column named in the metadata
+        // --------------------------------------------------
+        const std::string key = "\"primary_column\"";
+        const size_t found = scanner->_geoMetadata.find(key);
+        if (found != std::string::npos)
+        {
+            const std::string & json = scanner->_geoMetadata;
+            size_t position = json.find('"', json.find(':', found + key.size()));
+            std::string name;
+            while (position != std::string::npos && ++position < json.size() &&
+                   json[position] != '"')
+            {
+                if (json[position] == '\\' && position + 1 < json.size()) position++;
+                name += json[position];
+            }
+            scanner->_geometryColumn = scanner->findColumn(name);
+        }
+        return scanner.release();
+    }
+
+    void GeoParquetScanner::readColumn(int group, int column, ColumnData & data) const
+    {
+        if (group < 0 || group >= (int)this->_rowGroups.size() ||
+            column < 0 || column >= (int)this->_columns.size())
+        {
+            throw std::runtime_error("Invalid column chunk!");
+        }
+        const Chunk & chunk = this->_rowGroups[group].chunks[column];
+        const Column & info = this->_columns[column];
+        if (chunk.codec != PARQUET_UNCOMPRESSED)
+        {
+            throw std::runtime_error("Unsupported Parquet compression!");
+        }
+        if (chunk.dictionaryOffset > 0 || info.type == INT96)
+        {
+            throw std::runtime_error("Unsupported Parquet encoding!");
+        }
+        data.valid.clear();
+        data.integers.clear();
+        data.doubles.clear();
+        data.bytes.clear();
+        data.sizes.clear();
+        data.valid.reserve((size_t)std::min<long long>(chunk.values, 1 << 20));
+
+        int bitWidth = 0;
+        while ((1 << bitWidth) <= info.maxLevel) bitWidth++;
+        const unsigned char * base = static_cast<const unsigned char *>(this->_mapping);
+        size_t position = (size_t)chunk.dataOffset;
+        const size_t end = position + (size_t)chunk.size;
+        std::vector<unsigned char> levels;
+        while ((long long)data.valid.size() < chunk.values)
+        {
+            // ==================================================
+            // Page header
+            // --------------------------------------------------
+            Thrift header(base + position, end - position);
+            int pageType = -1;
+            long long pageSize = -1;
+            long long values = -1;
+            int encoding = -1;
+            int levelEncoding = -1;
+            int id = 0;
+            int type = 0;
+            while (header.field(id, type))
+            {
+                if (id == 1 && type == THRIFT_I32) pageType = (int)header.integer();
+                else if (id == 3 && type == THRIFT_I32) pageSize = header.integer();
+                else if (id == 5 && type == THRIFT_STRUCT)
+                {
+                    header.begin();
+                    while (header.field(id, type))
+                    {
+                        if (id == 1 && type == THRIFT_I32) values = header.integer();
+                        else if (id == 2 && type == THRIFT_I32) encoding = (int)header.integer();
+                        else if (id == 3 && type == THRIFT_I32) levelEncoding = (int)header.integer();
+                        else header.skip(type);
+                    }
+                    header.end();
+                }
+                else header.skip(type);
+            }
+            if (pageType != PARQUET_DATA_PAGE || encoding != PARQUET_PLAIN ||
+                (info.maxLevel > 0 && levelEncoding != PARQUET_RLE))
+            {
+                throw std::runtime_error("Unsupported Parquet encoding!");
+            }
+            position += header.position;
+            if (pageSize < 0 || values < 0 || (unsigned long long)pageSize > end - position ||
+                values > chunk.values - (long long)data.valid.size())
+            {
+                throw std::runtime_error("Invalid Parquet page!");
+            }
+            const unsigned char * page = base + position;
+            size_t remaining = (size_t)pageSize;
+            position += remaining;
+
+            // ==================================================
+            // Definition levels, all present without any
+            // --------------------------------------------------
+            if (info.maxLevel > 0)
+            {
+                if (remaining < 4) throw std::runtime_error("Invalid Parquet page!");
+                const size_t length = (size_t)getScalar(page, 4);
+                if (length > remaining - 4) throw std::runtime_error("Invalid Parquet page!");
+                readLevels(page + 4, length, bitWidth, (size_t)values, levels);
+                page += 4 + length;
+                remaining -= 4 + length;
+            }
+            else
+            {
+                levels.assign((size_t)values, 0);
+            }
+
+            // ==================================================
+            // PLAIN values of the present rows
+            // --------------------------------------------------
+            size_t bit = 0;
+            for (size_t i = 0; i < (size_t)values; i++)
+            {
+                const bool present = levels[i] == info.maxLevel;
+                data.valid.push_back(present ? 1 : 0);
+                size_t width = 0;
+                switch (info.type)
+                {
+                case BOOLEAN:
+                    if (present)
+                    {
+                        if (bit / 8 >= remaining) throw std::runtime_error("Invalid Parquet page!");
+                        data.integers.push_back((page[bit / 8] >> (bit % 8)) & 1);
+                        bit++;
+                    }
+                    else data.integers.push_back(0);
+                    continue;
+                case INT32:
+                case FLOAT:
+                    width = 4;
+                    break;
+                case INT64:
+                case DOUBLE:
+                    width = 8;
+                    break;
+                case FIXED_LEN_BYTE_ARRAY:
+                    width = (size_t)info.typeLength;
+                    break;
+                default:
+                    width = 4;
+                }
+                if (!present)
+                {
+                    if (info.type == INT32 || info.type == INT64) data.integers.push_back(0);
+                    else if (info.type == FLOAT || info.type == DOUBLE) data.doubles.push_back(0);
+                    else
+                    {
+                        data.bytes.push_back(0);
+                        data.sizes.push_back(0);
+                    }
+                    continue;
+                }
+                if (width > remaining) throw std::runtime_error("Invalid Parquet page!");
+                switch (info.type)
+                {
+                case INT32:
+                    data.integers.push_back((int)getScalar(page, 4));
+                    break;
+                case INT64:
+                    data.integers.push_back((sqlite3_int64)getScalar(page, 8));
+                    break;
+                case FLOAT:
+                {
+                    const unsigned int single = (unsigned int)getScalar(page, 4);
+                    float value = 0;
+                    std::memcpy(&value, &single, sizeof(value));
+                    data.doubles.push_back(value);
+                    break;
+                }
+                case DOUBLE:
+                    data.doubles.push_back(getDouble(page));
+                    break;
+                case FIXED_LEN_BYTE_ARRAY:
+                    data.bytes.push_back(page);
+                    data.sizes.push_back(width);
+                    break;
+                default:
+                {
+                    const size_t size = (size_t)getScalar(page, 4);
+                    if (size > remaining - 4) throw std::runtime_error("Invalid Parquet page!");
+                    data.bytes.push_back(page + 4);
+                    data.sizes.push_back(size);
+                    width += size;
+                }
+                }
+                page += width;
+                remaining -= width;
+            }
+        }
+    }
+
+    size_t GeoParquetScanner::selectRowGroups(double minx,
+                                              double miny,
+                                              double maxx,
+                                              double maxy,
+                                              std::vector<int> & groups) const
+    {
+        size_t count = 0;
+        for (int g = 0; g < (int)this->_rowGroups.size(); g++)
+        {
+            double bounds[4];
+            if (this->getRowGroupBounds(g, bounds[0], bounds[1], bounds[2], bounds[3]) &&
+                (maxx < bounds[0] || maxy < bounds[1] || minx > bounds[2] || miny > bounds[3]))
+            {
+                continue;
+            }
+            groups.push_back(g);
+            count++;
+        }
+        return count;
+    }
+
+}
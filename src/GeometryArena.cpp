@@ -0,0 +1,296 @@
+/**
+ * @file    GeometryArena.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeometryArena class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/GeometryArena.h"
+
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/GeometryCollection.h"
+
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // Alignment of every allocation
+        const size_t ARENA_ALIGN = 16;
+
+        /**
+         * @brief Allocates a block
+         */
+        char * allocBlock(size_t bytes)
+        {
+            char * block = static_cast<char *>(std::malloc(bytes));
+            if (!block) throw std::runtime_error("Failed to allocate arena!");
+            return block;
+        }
+
+    }
+
+    GeometryArena::GeometryArena(size_t blockSize) :
+        _blockSize(blockSize < 1024 ? 1024 : blockSize),
+        _blocks(),
+        _large(),
+        _used(0),
+        _next(0),
+        _end(0)
+    {
+    }
+
+    GeometryArena::~GeometryArena()
+    {
+        for (size_t i = 0; i < this->_blocks.size(); i++)
+        {
+            std::free(this->_blocks[i]);
+        }
+        for (size_t i = 0; i < this->_large.size(); i++)
+        {
+            std::free(this->_large[i]);
+        }
+    }
+
+    gaiaGeomCollPtr GeometryArena::allocGeomColl(int dimensions, int srid)
+    {
+        CoordinateBuffer::getStride(dimensions);
+        gaiaGeomCollPtr geometry =
+            static_cast<gaiaGeomCollPtr>(this->allocate(sizeof(gaiaGeomColl)));
+        std::memset(geometry, 0, sizeof(gaiaGeomColl));
+        geometry->Srid = srid;
+        geometry->endian_arch = (char)gaiaEndianArch();
+        geometry->endian = ' ';
+        geometry->MinX = DBL_MAX;
+        geometry->MinY = DBL_MAX;
+        geometry->MaxX = -DBL_MAX;
+        geometry->MaxY = -DBL_MAX;
+        geometry->DimensionModel = dimensions;
+        geometry->DeclaredType = GAIA_UNKNOWN;
+        return geometry;
+    }
+
+    void * GeometryArena::allocate(size_t bytes)
+    {
+        bytes = (bytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+        if (bytes == 0) bytes = ARENA_ALIGN;
+        this->_used += bytes;
+
+        // ==================================================
+        // Oversized requests get a block of their own
+        // --------------------------------------------------
+        if (bytes > this->_blockSize / 4)
+        {
+            char * block = allocBlock(bytes);
+            this->_large.push_back(block);
+            return block;
+        }
+
+        // ==================================================
+        // Bump allocate, starting a new block when full
+        // --------------------------------------------------
+        if ((size_t)(this->_end - this->_next) < bytes)
+        {
+            char * block = allocBlock(this->_blockSize);
+            this->_blocks.push_back(block);
+            this->_next = block;
+            this->_end = block + this->_blockSize;
+        }
+        void * memory = this->_next;
+        this->_next += bytes;
+        return memory;
+    }
+
+    gaiaRingPtr GeometryArena::addInteriorRing(gaiaPolygonPtr polygon,
+                                               int position,
+                                               int vertices)
+    {
+        if (!polygon) throw std::runtime_error("Invalid polygon!");
+        if (position < 0 || position >= polygon->NumInteriors)
+        {
+            throw std::runtime_error("Invalid interior ring position!");
+        }
+        gaiaRingPtr ring = polygon->Interiors + position;
+        this->initRing(ring, vertices, polygon->DimensionModel, polygon);
+        return ring;
+    }
+
+    gaiaLinestringPtr GeometryArena::addLinestring(gaiaGeomCollPtr geometry,
+                                                   int vertices)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        if (vertices < 0) throw std::runtime_error("Invalid vertex count!");
+        const int dimensions = geometry->DimensionModel;
+        const int stride = CoordinateBuffer::getStride(dimensions);
+        gaiaLinestringPtr line = static_cast<gaiaLinestringPtr>(
+            this->allocate(sizeof(gaiaLinestring)));
+        std::memset(line, 0, sizeof(gaiaLinestring));
+        line->Points = vertices;
+        line->Coords = static_cast<double *>(
+            this->allocate(sizeof(double) * stride * vertices));
+        line->MinX = DBL_MAX;
+        line->MinY = DBL_MAX;
+        line->MaxX = -DBL_MAX;
+        line->MaxY = -DBL_MAX;
+        line->DimensionModel = dimensions;
+        if (!geometry->FirstLinestring) geometry->FirstLinestring = line;
+        if (geometry->LastLinestring) geometry->LastLinestring->Next = line;
+        geometry->LastLinestring = line;
+        return line;
+    }
+
+    gaiaPointPtr GeometryArena::addPoint(gaiaGeomCollPtr geometry,
+                                         double x,
+                                         double y,
+                                         double z,
+                                         double m)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        const int dimensions = geometry->DimensionModel;
+        gaiaPointPtr point =
+            static_cast<gaiaPointPtr>(this->allocate(sizeof(gaiaPoint)));
+        std::memset(point, 0, sizeof(gaiaPoint));
+        point->X = x;
+        point->Y = y;
+        if (dimensions == GAIA_XY_Z || dimensions == GAIA_XY_Z_M) point->Z = z;
+        if (dimensions == GAIA_XY_M || dimensions == GAIA_XY_Z_M) point->M = m;
+        point->DimensionModel = dimensions;
+        point->Prev = geometry->LastPoint;
+        if (!geometry->FirstPoint) geometry->FirstPoint = point;
+        if (geometry->LastPoint) geometry->LastPoint->Next = point;
+        geometry->LastPoint = point;
+        return point;
+    }
+
+    gaiaPolygonPtr GeometryArena::addPolygon(gaiaGeomCollPtr geometry,
+                                             int vertices,
+                                             int interiors)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        if (interiors < 0) throw std::runtime_error("Invalid interior count!");
+        const int dimensions = geometry->DimensionModel;
+        gaiaPolygonPtr polygon =
+            static_cast<gaiaPolygonPtr>(this->allocate(sizeof(gaiaPolygon)));
+        std::memset(polygon, 0, sizeof(gaiaPolygon));
+        polygon->Exterior =
+            static_cast<gaiaRingPtr>(this->allocate(sizeof(gaiaRing)));
+        this->initRing(polygon->Exterior, vertices, dimensions, polygon);
+        polygon->NumInteriors = interiors;
+        if (interiors > 0)
+        {
+            size_t bytes = sizeof(gaiaRing) * interiors;
+            polygon->Interiors =
+                static_cast<gaiaRingPtr>(this->allocate(bytes));
+            std::memset(polygon->Interiors, 0, bytes);
+        }
+        polygon->MinX = DBL_MAX;
+        polygon->MinY = DBL_MAX;
+        polygon->MaxX = -DBL_MAX;
+        polygon->MaxY = -DBL_MAX;
+        polygon->DimensionModel = dimensions;
+        if (!geometry->FirstPolygon) geometry->FirstPolygon = polygon;
+        if (geometry->LastPolygon) geometry->LastPolygon->Next = polygon;
+        geometry->LastPolygon = polygon;
+        return polygon;
+    }
+
+    gaiaGeomCollPtr GeometryArena::clone(gaiaGeomCollPtr geometry)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        const int dimensions = geometry->DimensionModel;
+        const size_t stride = CoordinateBuffer::getStride(dimensions);
+        gaiaGeomCollPtr copy = this->allocGeomColl(dimensions, geometry->Srid);
+        for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+        {
+            this->addPoint(copy, p->X, p->Y, p->Z, p->M);
+        }
+        for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+        {
+            gaiaLinestringPtr line = this->addLinestring(copy, l->Points);
+            std::memcpy(line->Coords, l->Coords,
+                        sizeof(double) * stride * l->Points);
+        }
+        for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+        {
+            gaiaPolygonPtr polygon = this->addPolygon(copy, p->Exterior->Points,
+                                                      p->NumInteriors);
+            std::memcpy(polygon->Exterior->Coords, p->Exterior->Coords,
+                        sizeof(double) * stride * p->Exterior->Points);
+            for (int i = 0; i < p->NumInteriors; i++)
+            {
+                gaiaRingPtr ring = this->addInteriorRing(polygon, i,
+                                                         p->Interiors[i].Points);
+                std::memcpy(ring->Coords, p->Interiors[i].Coords,
+                            sizeof(double) * stride * ring->Points);
+            }
+        }
+        copy->DeclaredType = geometry->DeclaredType;
+        copy->MinX = geometry->MinX;
+        copy->MinY = geometry->MinY;
+        copy->MaxX = geometry->MaxX;
+        copy->MaxY = geometry->MaxY;
+        return copy;
+    }
+
+    int GeometryArena::getBlockCount() const
+    {
+        return (int)(this->_blocks.size() + this->_large.size());
+    }
+
+    size_t GeometryArena::getBytesUsed() const
+    {
+        return this->_used;
+    }
+
+    void GeometryArena::initRing(gaiaRingPtr ring,
+                                 int vertices,
+                                 int dimensions,
+                                 gaiaPolygonPtr polygon)
+    {
+        if (vertices < 0) throw std::runtime_error("Invalid vertex count!");
+        const int stride = CoordinateBuffer::getStride(dimensions);
+        std::memset(ring, 0, sizeof(gaiaRing));
+        ring->Points = vertices;
+        ring->Coords = static_cast<double *>(
+            this->allocate(sizeof(double) * stride * vertices));
+        ring->MinX = DBL_MAX;
+        ring->MinY = DBL_MAX;
+        ring->MaxX = -DBL_MAX;
+        ring->MaxY = -DBL_MAX;
+        ring->DimensionModel = dimensions;
+        ring->Link = polygon;
+    }
+
+    void GeometryArena::reset()
+    {
+        for (size_t i = 0; i < this->_large.size(); i++)
+        {
+            std::free(this->_large[i]);
+        }
+        this->_large.clear();
+        for (size_t i = 1; i < this->_blocks.size(); i++)
+        {
+            std::free(this->_blocks[i]);
+        }
+        if (this->_blocks.size() > 1) this->_blocks.resize(1);
+        this->_next = this->_blocks.empty() ? 0 : this->_blocks[0];
+        this->_end = this->_blocks.empty() ? 0 : this->_next + this->_blockSize;
+        this->_used = 0;
+    }
+
+    GeometryCollection * GeometryArena::toHeap(gaiaGeomCollPtr geometry)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        gaiaGeomCollPtr copy = gaiaCloneGeomColl(geometry);
+        if (!copy) throw std::runtime_error("Failed to copy geometry!");
+        return new GeometryCollection(copy);
+    }
+
+}
@@ -0,0 +1,233 @@
+/**
+ * @file    GeometryCache.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeometryCache class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/GeometryCache.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/GeometryCollection.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <stdexcept>
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+    }
+
+    bool GeometryCache::Key::operator<(const Key & other) const
+    {
+        if (this->connection != other.connection)
+        {
+            return this->connection < other.connection;
+        }
+        if (this->rowid != other.rowid) return this->rowid < other.rowid;
+        int compare = this->table.compare(other.table);
+        if (compare != 0) return compare < 0;
+        return this->column < other.column;
+    }
+
+    GeometryCache::GeometryCache(size_t budget) :
+        _budget(budget),
+        _bytes(0),
+        _evictions(0),
+        _hits(0),
+        _misses(0),
+        _stale(0),
+        _index(),
+        _slots()
+    {
+    }
+
+    GeometryCache::~GeometryCache()
+    {
+    }
+
+    void GeometryCache::clear()
+    {
+        this->_index.clear();
+        this->_slots.clear();
+        this->_bytes = 0;
+    }
+
+    void GeometryCache::erase(Slots::iterator slot)
+    {
+        this->_bytes -= slot->bytes;
+        this->_index.erase(slot->key);
+        this->_slots.erase(slot);
+    }
+
+    void GeometryCache::evict(size_t bytes)
+    {
+        while (this->_bytes > bytes && !this->_slots.empty())
+        {
+            Slots::iterator last = this->_slots.end();
+            this->erase(--last);
+            this->_evictions++;
+        }
+    }
+
+    GeometryCache::Entry GeometryCache::get(SpatialDatabase const & database,
+                                            std::string const & table,
+                                            std::string const & column,
+                                            sqlite3_int64 rowid)
+    {
+        sqlite3 * handle = database.getDatabase()->getHandle();
+        const sqlite3_int64 version = database.getDataVersion();
+        const sqlite3_int64 changes = sqlite3_total_changes(handle);
+
+        Key key;
+        key.connection = database.getId();
+        key.table = table;
+        key.column = column;
+        key.rowid = rowid;
+
+        // ==================================================
+        // Answer from the cache if the entry is current
+        // --------------------------------------------------
+        std::map<Key, Slots::iterator>::iterator found = this->_index.find(key);
+        if (found != this->_index.end())
+        {
+            Slots::iterator slot = found->second;
+            if (slot->version == version && slot->changes == changes)
+            {
+                this->_hits++;
+                this->_slots.splice(this->_slots.begin(), this->_slots, slot);
+                return slot->geometry;
+            }
+            this->_stale++;
+            this->erase(slot);
+        }
+        this->_misses++;
+
+        // ==================================================
+        // Decode the row
+        // --------------------------------------------------
+        std::string sql = "SELECT " + quoteName(column) +
+                          " FROM " + quoteName(table) +
+                          " WHERE rowid = ?";
+        SQLite::Statement query(*database.getDatabase(), sql);
+        query.bind(1, rowid);
+        if (!query.executeStep()) return Entry();
+        SQLite::Column value = query.getColumn(0);
+        if (value.getType() != SQLITE_BLOB) return Entry();
+        gaiaGeomCollPtr geometry = BlobEncoding::decode(
+            (const unsigned char *)value.getBlob(),
+            value.getBytes());
+        if (!geometry) return Entry();
+        Entry entry(new GeometryCollection(geometry));
+
+        // ==================================================
+        // Keep it if it fits the budget
+        // --------------------------------------------------
+        const size_t bytes = GeometryCache::getSize(geometry);
+        if (bytes > this->_budget) return entry;
+        this->evict(this->_budget - bytes);
+        Slot slot;
+        slot.key = key;
+        slot.version = version;
+        slot.changes = changes;
+        slot.bytes = bytes;
+        slot.geometry = entry;
+        this->_slots.push_front(slot);
+        this->_index[key] = this->_slots.begin();
+        this->_bytes += bytes;
+        return entry;
+    }
+
+    size_t GeometryCache::getBudget() const
+    {
+        return this->_budget;
+    }
+
+    size_t GeometryCache::getBytes() const
+    {
+        return this->_bytes;
+    }
+
+    int GeometryCache::getCount() const
+    {
+        return (int)this->_index.size();
+    }
+
+    long long GeometryCache::getEvictions() const
+    {
+        return this->_evictions;
+    }
+
+    long long GeometryCache::getHits() const
+    {
+        return this->_hits;
+    }
+
+    long long GeometryCache::getMisses() const
+    {
+        return this->_misses;
+    }
+
+    size_t GeometryCache::getSize(gaiaGeomCollPtr geometry)
+    {
+        if (!geometry) return 0;
+        size_t bytes = sizeof(gaiaGeomColl);
+        for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+        {
+            bytes += sizeof(gaiaPoint);
+        }
+        for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+        {
+            bytes += sizeof(gaiaLinestring) + sizeof(double) * l->Points *
+                     CoordinateBuffer::getStride(l->DimensionModel);
+        }
+        for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+        {
+            bytes += sizeof(gaiaPolygon) + sizeof(gaiaRing) * (1 + p->NumInteriors);
+            gaiaRingPtr ring = p->Exterior;
+            bytes += sizeof(double) * ring->Points *
+                     CoordinateBuffer::getStride(ring->DimensionModel);
+            for (int i = 0; i < p->NumInteriors; i++)
+            {
+                ring = p->Interiors + i;
+                bytes += sizeof(double) * ring->Points *
+                         CoordinateBuffer::getStride(ring->DimensionModel);
+            }
+        }
+        return bytes;
+    }
+
+    long long GeometryCache::getStale() const
+    {
+        return this->_stale;
+    }
+
+    GeometryCache & GeometryCache::getThreadCache()
+    {
+        static thread_local GeometryCache cache(0);
+        return cache;
+    }
+
+    void GeometryCache::setBudget(size_t budget)
+    {
+        this->_budget = budget;
+        this->evict(budget);
+    }
+
+}
@@ -10,6 +10,7 @@
 
 #include "SpatiaLiteCpp/Auxiliary.h"
 #include "SpatiaLiteCpp/Blob.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
 #include "SpatiaLiteCpp/SpatialDatabase.h"
 
 #include "SQLiteCpp/SQLiteCpp.h"
@@ -23,7 +24,7 @@ namespace SpatiaLite
     }
 
     GeometryCollection::GeometryCollection(SQLite::Column const & blob) :
-        Buffer<GeometryCollectionType>(gaiaFromSpatiaLiteBlobWkb(
+        Buffer<GeometryCollectionType>(BlobEncoding::decode(
                                            (const unsigned char*)blob.getBlob(),
                                            blob.getBytes()),
                                        gaiaFreeGeomColl)
@@ -31,7 +32,7 @@ namespace SpatiaLite
     }
 
     GeometryCollection::GeometryCollection(SpatiaLite::Blob const & blob) :
-        Buffer<GeometryCollectionType>(gaiaFromSpatiaLiteBlobWkb(
+        Buffer<GeometryCollectionType>(BlobEncoding::decode(
                                            blob.get(),
                                            blob.getSize()),
                                        gaiaFreeGeomColl)
@@ -0,0 +1,322 @@
+/**
+ * @file    GeometryWorkerPool.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main GeometryWorkerPool class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/GeometryWorkerPool.h"
+
+#include "geos_c.h"
+
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace SpatiaLite
+{
+
+    struct GeometryWorkerPool::Worker
+    {
+        std::thread thread;                                 ///< Worker thread
+        std::mutex mutex;                                   ///< Guards chunks
+        std::deque<std::pair<size_t, size_t> > chunks;      ///< Task ranges
+    };
+
+    namespace
+    {
+
+        /**
+         * @brief Converts a gaia geometry with a worker's GEOS context
+         * @returns Converted geometry or null on failure
+         */
+        GEOSGeometry * toGeos(GEOSContextHandle_t handle,
+                              GEOSWKBReader * reader,
+                              gaiaGeomCollPtr geometry)
+        {
+            if (!geometry) return 0;
+            unsigned char * wkb = 0;
+            int size = 0;
+            gaiaToWkb(geometry, &wkb, &size);
+            if (!wkb) return 0;
+            GEOSGeometry * converted =
+                GEOSWKBReader_read_r(handle, reader, wkb, size);
+            gaiaFree(wkb);
+            return converted;
+        }
+
+        /**
+         * @brief Calls the GEOS predicate of an operation
+         * @returns 0, 1 or 2 on failure
+         */
+        char evaluatePair(int operation,
+                          GEOSContextHandle_t handle,
+                          const GEOSGeometry * first,
+                          const GEOSGeometry * second)
+        {
+            switch (operation)
+            {
+            case PreparedGeometry::CONTAINS:
+                return GEOSContains_r(handle, first, second);
+            case PreparedGeometry::CONTAINS_PROPERLY:
+            {
+                // GEOS only offers this predicate on prepared geometries
+                const GEOSPreparedGeometry * prepared =
+                    GEOSPrepare_r(handle, first);
+                if (!prepared) return 2;
+                char result =
+                    GEOSPreparedContainsProperly_r(handle, prepared, second);
+                GEOSPreparedGeom_destroy_r(handle, prepared);
+                return result;
+            }
+            case PreparedGeometry::COVERED_BY:
+                return GEOSCoveredBy_r(handle, first, second);
+            case PreparedGeometry::COVERS:
+                return GEOSCovers_r(handle, first, second);
+            case PreparedGeometry::CROSSES:
+                return GEOSCrosses_r(handle, first, second);
+            case PreparedGeometry::DISJOINT:
+                return GEOSDisjoint_r(handle, first, second);
+            case PreparedGeometry::INTERSECTS:
+                return GEOSIntersects_r(handle, first, second);
+            case PreparedGeometry::OVERLAPS:
+                return GEOSOverlaps_r(handle, first, second);
+            case PreparedGeometry::TOUCHES:
+                return GEOSTouches_r(handle, first, second);
+            case PreparedGeometry::WITHIN:
+                return GEOSWithin_r(handle, first, second);
+            case GeometryWorkerPool::EQUALS:
+                return GEOSEquals_r(handle, first, second);
+            default:
+                return 2;
+            }
+        }
+
+        /**
+         * @brief Evaluates one task
+         * @returns 0, 1 or 2 on failure
+         */
+        char evaluateTask(GEOSContextHandle_t handle,
+                          GEOSWKBReader * reader,
+                          GeometryWorkerPool::Task const & task)
+        {
+            if (task.operation < PreparedGeometry::CONTAINS ||
+                task.operation > GeometryWorkerPool::IS_VALID)
+            {
+                return 2;
+            }
+            GEOSGeometry * first = toGeos(handle, reader, task.first);
+            if (!first) return 2;
+            if (task.operation == GeometryWorkerPool::IS_VALID)
+            {
+                char result = GEOSisValid_r(handle, first);
+                GEOSGeom_destroy_r(handle, first);
+                return result;
+            }
+            GEOSGeometry * second = toGeos(handle, reader, task.second);
+            if (!second)
+            {
+                GEOSGeom_destroy_r(handle, first);
+                return 2;
+            }
+            char result = evaluatePair(task.operation, handle, first, second);
+            GEOSGeom_destroy_r(handle, second);
+            GEOSGeom_destroy_r(handle, first);
+            return result;
+        }
+
+    }
+
+    GeometryWorkerPool::GeometryWorkerPool(int threads, int chunkSize) :
+        _chunkSize(chunkSize < 1 ? 1 : chunkSize),
+        _active(0),
+        _done(),
+        _failed(false),
+        _generation(0),
+        _mutex(),
+        _mutexBatch(),
+        _results(0),
+        _steals(0),
+        _stop(false),
+        _tasks(0),
+        _wake(),
+        _workers()
+    {
+        if (threads < 0) throw std::runtime_error("Invalid thread count!");
+        if (threads == 0) threads = (int)std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+        for (int i = 0; i < threads; i++)
+        {
+            this->_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        }
+        try
+        {
+            for (size_t i = 0; i < this->_workers.size(); i++)
+            {
+                this->_workers[i]->thread =
+                    std::thread(&GeometryWorkerPool::run, this, i);
+            }
+        }
+        catch (...)
+        {
+            // Threads already started must not outlive the pool
+            this->shutdown();
+            throw;
+        }
+    }
+
+    GeometryWorkerPool::~GeometryWorkerPool()
+    {
+        this->shutdown();
+    }
+
+    std::vector<char> GeometryWorkerPool::evaluate(
+        std::vector<Task> const & tasks)
+    {
+        std::vector<char> results(tasks.size(), 0);
+        if (tasks.empty()) return results;
+        std::lock_guard<std::mutex> batch(this->_mutexBatch);
+
+        // ==================================================
+        // Deal the chunks round-robin to the worker queues
+        // --------------------------------------------------
+        const size_t count = this->_workers.size();
+        size_t chunk = 0;
+        for (size_t begin = 0; begin < tasks.size(); begin += this->_chunkSize)
+        {
+            size_t end = begin + this->_chunkSize;
+            if (end > tasks.size()) end = tasks.size();
+            Worker * worker = this->_workers[chunk++ % count].get();
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->chunks.push_back(std::make_pair(begin, end));
+        }
+
+        // ==================================================
+        // Wake the workers and wait for the batch
+        // --------------------------------------------------
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_tasks = &tasks;
+        this->_results = &results[0];
+        this->_failed = false;
+        this->_active = count;
+        this->_generation++;
+        this->_wake.notify_all();
+        while (this->_active > 0) this->_done.wait(lock);
+        this->_tasks = 0;
+        this->_results = 0;
+        if (this->_failed)
+        {
+            throw std::runtime_error("Failed to evaluate geometry task!");
+        }
+        return results;
+    }
+
+    int GeometryWorkerPool::getChunkSize() const
+    {
+        return (int)this->_chunkSize;
+    }
+
+    long long GeometryWorkerPool::getSteals() const
+    {
+        return this->_steals;
+    }
+
+    int GeometryWorkerPool::getThreadCount() const
+    {
+        return (int)this->_workers.size();
+    }
+
+    bool GeometryWorkerPool::pop(size_t index, size_t & begin, size_t & end)
+    {
+        const size_t count = this->_workers.size();
+        for (size_t k = 0; k < count; k++)
+        {
+            Worker * worker = this->_workers[(index + k) % count].get();
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            if (worker->chunks.empty()) continue;
+            if (k == 0)
+            {
+                begin = worker->chunks.front().first;
+                end = worker->chunks.front().second;
+                worker->chunks.pop_front();
+            }
+            else
+            {
+                begin = worker->chunks.back().first;
+                end = worker->chunks.back().second;
+                worker->chunks.pop_back();
+                this->_steals++;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void GeometryWorkerPool::run(size_t index)
+    {
+        GEOSContextHandle_t handle = GEOS_init_r();
+        GEOSWKBReader * reader = handle ? GEOSWKBReader_create_r(handle) : 0;
+        unsigned long generation = 0;
+        for (;;)
+        {
+            const std::vector<Task> * tasks = 0;
+            char * results = 0;
+            {
+                std::unique_lock<std::mutex> lock(this->_mutex);
+                while (!this->_stop && this->_generation == generation)
+                {
+                    this->_wake.wait(lock);
+                }
+                if (this->_stop) break;
+                generation = this->_generation;
+                tasks = this->_tasks;
+                results = this->_results;
+            }
+
+            // ==================================================
+            // Drain own queue then steal until all are empty
+            // --------------------------------------------------
+            size_t begin = 0;
+            size_t end = 0;
+            while (this->pop(index, begin, end))
+            {
+                for (size_t i = begin; i < end && !this->_failed; i++)
+                {
+                    char result = reader ?
+                        evaluateTask(handle, reader, (*tasks)[i]) : 2;
+                    if (result == 2)
+                    {
+                        this->_failed = true;
+                        break;
+                    }
+                    results[i] = result;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            if (--this->_active == 0) this->_done.notify_all();
+        }
+        if (reader) GEOSWKBReader_destroy_r(handle, reader);
+        if (handle) GEOS_finish_r(handle);
+    }
+
+    void GeometryWorkerPool::shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_stop = true;
+        }
+        this->_wake.notify_all();
+        for (size_t i = 0; i < this->_workers.size(); i++)
+        {
+            if (this->_workers[i]->thread.joinable())
+            {
+                this->_workers[i]->thread.join();
+            }
+        }
+    }
+
+}
@@ -0,0 +1,1004 @@
+/**
+ * @file    LevelOfDetail.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main LevelOfDetail class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/LevelOfDetail.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#if SPATIALITECPP_USE_GEOS
+#include "geos_c.h"
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Finalizes a statement on scope exit
+         */
+        struct StatementGuard
+        {
+            sqlite3_stmt * statement;  ///< Owned statement
+            ~StatementGuard() { sqlite3_finalize(this->statement); }
+        };
+
+        /**
+         * @brief Douglas-Peucker span still to split
+         */
+        struct Span
+        {
+            int first;   ///< First vertex
+            int last;    ///< Last vertex
+            double cap;  ///< Significance of the vertex that created it
+        };
+
+        /**
+         * @brief Per-thread work arrays, kept between geometries
+         */
+        struct Scratch
+        {
+            std::vector<double> significance;  ///< Per vertex of all parts
+            std::vector<Span> spans;           ///< Douglas-Peucker stack
+            std::vector<int> previous;         ///< Visvalingam links
+            std::vector<int> next;             ///< Visvalingam links
+            std::vector<double> areas;         ///< Visvalingam areas
+            std::vector<std::pair<double, int> > heap; ///< Visvalingam heap
+        };
+
+#if SPATIALITECPP_USE_GEOS
+        /**
+         * @brief Reentrant GEOS context with WKB converters
+         */
+        struct GeosContext
+        {
+            GEOSContextHandle_t handle;  ///< Context
+            GEOSWKBReader * reader;      ///< WKB reader
+            GEOSWKBWriter * writer;      ///< WKB writer
+
+            GeosContext() :
+                handle(GEOS_init_r()),
+                reader(0),
+                writer(0)
+            {
+                if (!this->handle)
+                {
+                    throw std::runtime_error("Failed to create GEOS context!");
+                }
+                this->reader = GEOSWKBReader_create_r(this->handle);
+                this->writer = GEOSWKBWriter_create_r(this->handle);
+            }
+
+            ~GeosContext()
+            {
+                if (this->writer) GEOSWKBWriter_destroy_r(this->handle, this->writer);
+                if (this->reader) GEOSWKBReader_destroy_r(this->handle, this->reader);
+                GEOS_finish_r(this->handle);
+            }
+
+        private:
+
+            // Disallow copying and assignment
+            GeosContext & operator=(const GeosContext &);
+            GeosContext(const GeosContext &);
+        };
+#else
+        /**
+         * @brief Stand-in for the GEOS context of builds without GEOS
+         */
+        struct GeosContext
+        {
+            GeosContext()
+            {
+                throw std::runtime_error("GEOS support not built!");
+            }
+        };
+#endif
+
+        /**
+         * @returns Squared distance from a point to a segment
+         */
+        double getDistance2(const double * p, const double * a, const double * b)
+        {
+            const double dx = b[0] - a[0];
+            const double dy = b[1] - a[1];
+            const double length2 = dx * dx + dy * dy;
+            double t = 0;
+            if (length2 > 0)
+            {
+                t = ((p[0] - a[0]) * dx + (p[1] - a[1]) * dy) / length2;
+                t = t < 0 ? 0 : (t > 1 ? 1 : t);
+            }
+            const double ex = p[0] - (a[0] + t * dx);
+            const double ey = p[1] - (a[1] + t * dy);
+            return ex * ex + ey * ey;
+        }
+
+        /**
+         * @returns Area of a triangle
+         */
+        double getArea(const double * a, const double * b, const double * c)
+        {
+            const double area = (b[0] - a[0]) * (c[1] - a[1]) -
+                                (c[0] - a[0]) * (b[1] - a[1]);
+            return (area < 0 ? -area : area) / 2;
+        }
+
+        /**
+         * @brief Computes Douglas-Peucker significances
+         * @details A vertex is kept at tolerance t exactly when its
+         *          significance is above t squared. Closed rings are first
+         *          split at the vertex farthest from their start.
+         */
+        void getDouglasPeucker(const double * coords,
+                               int points,
+                               int stride,
+                               bool ring,
+                               double * significance,
+                               Scratch & scratch)
+        {
+            for (int i = 0; i < points; i++) significance[i] = 0;
+            significance[0] = DBL_MAX;
+            significance[points - 1] = DBL_MAX;
+            std::vector<Span> & spans = scratch.spans;
+            spans.clear();
+            if (ring && points > 3)
+            {
+                int farthest = 1;
+                double distance = -1;
+                for (int i = 1; i < points - 1; i++)
+                {
+                    const double d = getDistance2(coords + i * stride,
+                                                  coords, coords);
+                    if (d > distance)
+                    {
+                        distance = d;
+                        farthest = i;
+                    }
+                }
+                significance[farthest] = DBL_MAX;
+                Span head = {0, farthest, DBL_MAX};
+                Span tail = {farthest, points - 1, DBL_MAX};
+                spans.push_back(head);
+                spans.push_back(tail);
+            }
+            else
+            {
+                Span all = {0, points - 1, DBL_MAX};
+                spans.push_back(all);
+            }
+
+            while (!spans.empty())
+            {
+                const Span span = spans.back();
+                spans.pop_back();
+                if (span.last - span.first < 2) continue;
+                const double * a = coords + span.first * stride;
+                const double * b = coords + span.last * stride;
+                int farthest = span.first + 1;
+                double distance = -1;
+                for (int i = span.first + 1; i < span.last; i++)
+                {
+                    const double d = getDistance2(coords + i * stride, a, b);
+                    if (d > distance)
+                    {
+                        distance = d;
+                        farthest = i;
+                    }
+                }
+
+                // A vertex never outlives the split that exposed it
+                const double value = std::min(distance, span.cap);
+                significance[farthest] = value;
+                Span head = {span.first, farthest, value};
+                Span tail = {farthest, span.last, value};
+                spans.push_back(head);
+                spans.push_back(tail);
+            }
+        }
+
+        /**
+         * @brief Computes Visvalingam-Whyatt effective areas
+         * @details Vertices are removed smallest area first, and each
+         *          removal's area is raised to the largest removed so far
+         *          so that levels nest. Lines keep their end points, rings
+         *          four vertices.
+         */
+        void getVisvalingam(const double * coords,
+                            int points,
+                            int stride,
+                            bool ring,
+                            double * significance,
+                            Scratch & scratch)
+        {
+            std::vector<int> & previous = scratch.previous;
+            std::vector<int> & next = scratch.next;
+            std::vector<double> & areas = scratch.areas;
+            std::vector<std::pair<double, int> > & heap = scratch.heap;
+            typedef std::greater<std::pair<double, int> > Order;
+            previous.resize(points);
+            next.resize(points);
+            areas.resize(points);
+            heap.clear();
+            for (int i = 0; i < points; i++)
+            {
+                previous[i] = i - 1;
+                next[i] = i + 1;
+                significance[i] = DBL_MAX;
+                if (i == 0 || i == points - 1) continue;
+                areas[i] = getArea(coords + (i - 1) * stride,
+                                   coords + i * stride,
+                                   coords + (i + 1) * stride);
+                heap.push_back(std::make_pair(areas[i], i));
+            }
+            std::make_heap(heap.begin(), heap.end(), Order());
+
+            int remaining = points;
+            const int minimum = ring ? 4 : 2;
+            double largest = 0;
+            while (!heap.empty() && remaining > minimum)
+            {
+                std::pop_heap(heap.begin(), heap.end(), Order());
+                const std::pair<double, int> top = heap.back();
+                heap.pop_back();
+                const int i = top.second;
+
+                // Skip removed vertices and areas that were recomputed
+                if (significance[i] != DBL_MAX || top.first != areas[i]) continue;
+                largest = std::max(largest, top.first);
+                significance[i] = largest;
+                remaining--;
+
+                const int p = previous[i];
+                const int n = next[i];
+                next[p] = n;
+                previous[n] = p;
+                if (p > 0)
+                {
+                    areas[p] = getArea(coords + previous[p] * stride,
+                                       coords + p * stride,
+                                       coords + n * stride);
+                    heap.push_back(std::make_pair(areas[p], p));
+                    std::push_heap(heap.begin(), heap.end(), Order());
+                }
+                if (n < points - 1)
+                {
+                    areas[n] = getArea(coords + p * stride,
+                                       coords + n * stride,
+                                       coords + next[n] * stride);
+                    heap.push_back(std::make_pair(areas[n], n));
+                    std::push_heap(heap.begin(), heap.end(), Order());
+                }
+            }
+        }
+
+        /**
+         * @brief Computes the significance of every line and ring vertex,
+         *        in the order lines, then exterior and interior rings
+         */
+        void getSignificance(gaiaGeomCollPtr geometry, int method, Scratch & scratch)
+        {
+            size_t count = 0;
+            for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+            {
+                count += l->Points;
+            }
+            for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+            {
+                count += p->Exterior->Points;
+                for (int i = 0; i < p->NumInteriors; i++)
+                {
+                    count += p->Interiors[i].Points;
+                }
+            }
+            scratch.significance.resize(count);
+            double * significance = scratch.significance.data();
+
+            for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+            {
+                if (l->Points > 0)
+                {
+                    const int stride = CoordinateBuffer::getStride(l->DimensionModel);
+                    if (method == LevelOfDetail::VISVALINGAM)
+                    {
+                        getVisvalingam(l->Coords, l->Points, stride, false,
+                                       significance, scratch);
+                    }
+                    else
+                    {
+                        getDouglasPeucker(l->Coords, l->Points, stride, false,
+                                          significance, scratch);
+                    }
+                }
+                significance += l->Points;
+            }
+            for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+            {
+                for (int i = -1; i < p->NumInteriors; i++)
+                {
+                    gaiaRingPtr r = i < 0 ? p->Exterior : p->Interiors + i;
+                    if (r->Points > 0)
+                    {
+                        const int stride =
+                            CoordinateBuffer::getStride(r->DimensionModel);
+                        if (method == LevelOfDetail::VISVALINGAM)
+                        {
+                            getVisvalingam(r->Coords, r->Points, stride, true,
+                                           significance, scratch);
+                        }
+                        else
+                        {
+                            getDouglasPeucker(r->Coords, r->Points, stride, true,
+                                              significance, scratch);
+                        }
+                    }
+                    significance += r->Points;
+                }
+            }
+        }
+
+        /**
+         * @returns Number of vertices kept at a threshold
+         */
+        int countKept(const double * significance, int points, double threshold)
+        {
+            int kept = 0;
+            for (int i = 0; i < points; i++)
+            {
+                if (significance[i] > threshold) kept++;
+            }
+            return kept;
+        }
+
+        /**
+         * @brief Copies the kept vertices of a part
+         */
+        void copyKept(const double * coords,
+                      const double * significance,
+                      int points,
+                      int stride,
+                      double threshold,
+                      double * output)
+        {
+            for (int i = 0; i < points; i++)
+            {
+                if (significance[i] > threshold)
+                {
+                    std::memcpy(output, coords + i * stride, stride * sizeof(double));
+                    output += stride;
+                }
+            }
+        }
+
+        /**
+         * @returns Empty geometry of a dimension model
+         */
+        gaiaGeomCollPtr allocGeometry(int dimensions)
+        {
+            if (dimensions == GAIA_XY_Z) return gaiaAllocGeomCollXYZ();
+            if (dimensions == GAIA_XY_M) return gaiaAllocGeomCollXYM();
+            if (dimensions == GAIA_XY_Z_M) return gaiaAllocGeomCollXYZM();
+            return gaiaAllocGeomColl();
+        }
+
+        /**
+         * @brief Builds the geometry of the vertices above a threshold
+         * @returns Geometry, or null if nothing is left
+         */
+        gaiaGeomCollPtr filterGeometry(gaiaGeomCollPtr geometry,
+                                       const double * significance,
+                                       double threshold)
+        {
+            gaiaGeomCollPtr result = allocGeometry(geometry->DimensionModel);
+            result->Srid = geometry->Srid;
+            result->DeclaredType = geometry->DeclaredType;
+            bool empty = true;
+
+            for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+            {
+                switch (result->DimensionModel)
+                {
+                case GAIA_XY_Z:
+                    gaiaAddPointToGeomCollXYZ(result, p->X, p->Y, p->Z);
+                    break;
+                case GAIA_XY_M:
+                    gaiaAddPointToGeomCollXYM(result, p->X, p->Y, p->M);
+                    break;
+                case GAIA_XY_Z_M:
+                    gaiaAddPointToGeomCollXYZM(result, p->X, p->Y, p->Z, p->M);
+                    break;
+                default:
+                    gaiaAddPointToGeomColl(result, p->X, p->Y);
+                }
+                empty = false;
+            }
+
+            for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+            {
+                const int kept = countKept(significance, l->Points, threshold);
+                if (kept >= 2)
+                {
+                    gaiaLinestringPtr line = gaiaAddLinestringToGeomColl(result, kept);
+                    copyKept(l->Coords, significance, l->Points,
+                             CoordinateBuffer::getStride(l->DimensionModel),
+                             threshold, line->Coords);
+                    empty = false;
+                }
+                significance += l->Points;
+            }
+
+            // ==================================================
+            // Rings left with fewer than four vertices are dropped, and a
+            // polygon goes with its exterior ring
+            // --------------------------------------------------
+            for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+            {
+                gaiaRingPtr exterior = p->Exterior;
+                const int kept = countKept(significance, exterior->Points, threshold);
+                const double * interior = significance + exterior->Points;
+                int interiors = 0;
+                for (int i = 0; i < p->NumInteriors; i++)
+                {
+                    const int points = p->Interiors[i].Points;
+                    if (countKept(interior, points, threshold) >= 4) interiors++;
+                    interior += points;
+                }
+                if (kept >= 4)
+                {
+                    gaiaPolygonPtr polygon =
+                        gaiaAddPolygonToGeomColl(result, kept, interiors);
+                    copyKept(exterior->Coords, significance, exterior->Points,
+                             CoordinateBuffer::getStride(exterior->DimensionModel),
+                             threshold, polygon->Exterior->Coords);
+                    interior = significance + exterior->Points;
+                    int position = 0;
+                    for (int i = 0; i < p->NumInteriors; i++)
+                    {
+                        gaiaRingPtr r = p->Interiors + i;
+                        const int count = countKept(interior, r->Points, threshold);
+                        if (count >= 4)
+                        {
+                            gaiaRingPtr ring =
+                                gaiaAddInteriorRing(polygon, position++, count);
+                            copyKept(r->Coords, interior, r->Points,
+                                     CoordinateBuffer::getStride(r->DimensionModel),
+                                     threshold, ring->Coords);
+                        }
+                        interior += r->Points;
+                    }
+                    empty = false;
+                }
+                significance = interior;
+            }
+
+            if (empty)
+            {
+                gaiaFreeGeomColl(result);
+                return 0;
+            }
+            return result;
+        }
+
+        /**
+         * @brief Simplifies with GEOS, preserving topology
+         * @returns Geometry, or null if nothing is left
+         */
+        gaiaGeomCollPtr simplifyTopology(GeosContext & context,
+                                         gaiaGeomCollPtr geometry,
+                                         double tolerance)
+        {
+#if SPATIALITECPP_USE_GEOS
+            unsigned char * wkb = 0;
+            int size = 0;
+            gaiaToWkb(geometry, &wkb, &size);
+            if (!wkb) throw std::runtime_error("Failed to convert geometry!");
+            GEOSGeometry * input =
+                GEOSWKBReader_read_r(context.handle, context.reader, wkb, size);
+            gaiaFree(wkb);
+            if (!input) throw std::runtime_error("Failed to convert geometry!");
+            GEOSGeometry * output =
+                GEOSTopologyPreserveSimplify_r(context.handle, input, tolerance);
+            GEOSGeom_destroy_r(context.handle, input);
+            if (!output) throw std::runtime_error("Failed to simplify geometry!");
+            size_t length = 0;
+            unsigned char * bytes = GEOSWKBWriter_write_r(context.handle,
+                                                          context.writer,
+                                                          output,
+                                                          &length);
+            GEOSGeom_destroy_r(context.handle, output);
+            if (!bytes) throw std::runtime_error("Failed to convert geometry!");
+            gaiaGeomCollPtr result = gaiaFromWkb(bytes, (unsigned int)length);
+            GEOSFree_r(context.handle, bytes);
+            if (!result) return 0;
+            if (!result->FirstPoint && !result->FirstLinestring &&
+                !result->FirstPolygon)
+            {
+                gaiaFreeGeomColl(result);
+                return 0;
+            }
+            result->Srid = geometry->Srid;
+            return result;
+#else
+            // Never reached: the context cannot be created
+            (void)context;
+            (void)geometry;
+            (void)tolerance;
+            return 0;
+#endif
+        }
+
+        /**
+         * @brief Rows handed to a worker
+         */
+        struct Chunk
+        {
+            std::vector<sqlite3_int64> ids;   ///< Row identifiers
+            std::vector<std::string> input;   ///< Geometry BLOBs
+            std::vector<std::string> output;  ///< Simplified BLOBs, per level
+            std::vector<char> present;        ///< Output is not NULL
+            bool done;                        ///< Output is ready
+        };
+
+        /**
+         * @brief State shared by the workers and the calling thread
+         */
+        struct BuildState
+        {
+            std::vector<double> tolerances; ///< Tolerances
+            int method;                     ///< Method value
+
+            std::mutex mutex;               ///< Guards the fields below
+            std::condition_variable changed;///< Signals any change
+            std::vector<Chunk> slots;       ///< Chunks by slot
+            size_t claimed;                 ///< Next chunk to simplify
+            size_t filled;                  ///< Chunks read
+            bool finished;                  ///< All rows read
+            bool failed;                    ///< Build aborted
+            std::string error;              ///< First error message
+        };
+
+        /**
+         * @brief Aborts the build with an error
+         */
+        void fail(BuildState & state, const char * message)
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.failed) state.error = message;
+            state.failed = true;
+            state.changed.notify_all();
+        }
+
+        /**
+         * @brief Simplifies the rows of a chunk at every level
+         */
+        void simplifyChunk(BuildState & state,
+                           Chunk & chunk,
+                           Scratch & scratch,
+                           GeosContext * context)
+        {
+            const size_t levels = state.tolerances.size();
+            chunk.output.resize(chunk.ids.size() * levels);
+            chunk.present.assign(chunk.ids.size() * levels, 0);
+            for (size_t row = 0; row < chunk.ids.size(); row++)
+            {
+                std::string const & input = chunk.input[row];
+                if (input.empty()) continue;
+                gaiaGeomCollPtr geometry = BlobEncoding::decode(
+                    (const unsigned char *)input.data(),
+                    (int)input.size());
+                if (!geometry) continue;
+                if (!context) getSignificance(geometry, state.method, scratch);
+                const int total = (int)scratch.significance.size();
+                int previous = -1;
+
+                for (size_t level = 0; level < levels; level++)
+                {
+                    std::string & output = chunk.output[row * levels + level];
+                    const double tolerance = state.tolerances[level];
+                    gaiaGeomCollPtr simplified = 0;
+                    if (context)
+                    {
+                        simplified = simplifyTopology(*context, geometry, tolerance);
+                    }
+                    else
+                    {
+                        // Levels nest, so an unchanged count is an unchanged
+                        // geometry
+                        const double threshold = tolerance * tolerance;
+                        const int kept = countKept(scratch.significance.data(),
+                                                   total, threshold);
+                        if (kept == total)
+                        {
+                            output = input;
+                            chunk.present[row * levels + level] = 1;
+                            previous = kept;
+                            continue;
+                        }
+                        if (kept == previous)
+                        {
+                            output = chunk.output[row * levels + level - 1];
+                            chunk.present[row * levels + level] =
+                                chunk.present[row * levels + level - 1];
+                            continue;
+                        }
+                        previous = kept;
+                        simplified = filterGeometry(geometry,
+                                                    scratch.significance.data(),
+                                                    threshold);
+                    }
+                    if (!simplified)
+                    {
+                        output.clear();
+                        continue;
+                    }
+                    unsigned char * blob = 0;
+                    int size = 0;
+                    gaiaToSpatiaLiteBlobWkb(simplified, &blob, &size);
+                    gaiaFreeGeomColl(simplified);
+                    if (!blob) continue;
+                    output.assign((const char *)blob, size);
+                    gaiaFree(blob);
+                    chunk.present[row * levels + level] = 1;
+                }
+                gaiaFreeGeomColl(geometry);
+            }
+        }
+
+        /**
+         * @brief Simplifies chunks until none are left
+         */
+        void simplifyChunks(BuildState * state)
+        {
+            try
+            {
+                Scratch scratch;
+                std::unique_ptr<GeosContext> context;
+                if (state->method == LevelOfDetail::PRESERVE_TOPOLOGY)
+                {
+                    context.reset(new GeosContext());
+                }
+                for (;;)
+                {
+                    Chunk * chunk = 0;
+                    {
+                        std::unique_lock<std::mutex> lock(state->mutex);
+                        while (!state->failed && !state->finished &&
+                               state->claimed >= state->filled)
+                        {
+                            state->changed.wait(lock);
+                        }
+                        if (state->failed || state->claimed >= state->filled)
+                        {
+                            return;
+                        }
+                        chunk = &state->slots[state->claimed++ %
+                                              state->slots.size()];
+                    }
+                    simplifyChunk(*state, *chunk, scratch, context.get());
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    chunk->done = true;
+                    state->changed.notify_all();
+                }
+            }
+            catch (std::exception & e)
+            {
+                fail(*state, e.what());
+            }
+        }
+
+    }
+
+    LevelOfDetail::LevelOfDetail(std::vector<double> const & tolerances,
+                                 int method,
+                                 int threads,
+                                 int chunkSize) :
+        _chunkSize(chunkSize),
+        _method(method),
+        _threads(threads),
+        _tolerances(tolerances)
+    {
+        if (tolerances.empty()) throw std::runtime_error("No tolerances!");
+        for (size_t i = 0; i < tolerances.size(); i++)
+        {
+            if (!(tolerances[i] > 0))
+            {
+                throw std::runtime_error("Invalid tolerance!");
+            }
+        }
+        if (method < DOUGLAS_PEUCKER || method > PRESERVE_TOPOLOGY)
+        {
+            throw std::runtime_error("Invalid method!");
+        }
+#if !SPATIALITECPP_USE_GEOS
+        if (method == PRESERVE_TOPOLOGY)
+        {
+            throw std::runtime_error("GEOS support not built!");
+        }
+#endif
+        if (threads < 0) throw std::runtime_error("Invalid thread count!");
+        if (chunkSize < 1) throw std::runtime_error("Invalid chunk size!");
+        std::sort(this->_tolerances.begin(), this->_tolerances.end());
+        this->_tolerances.erase(std::unique(this->_tolerances.begin(),
+                                            this->_tolerances.end()),
+                                this->_tolerances.end());
+        if (this->_threads == 0)
+        {
+            this->_threads = (int)std::thread::hardware_concurrency();
+        }
+        if (this->_threads == 0) this->_threads = 1;
+    }
+
+    LevelOfDetail::~LevelOfDetail()
+    {
+    }
+
+    long long LevelOfDetail::build(SpatialDatabase const & database,
+                                   std::string const & table,
+                                   std::string const & geometry) const
+    {
+        SQLite::Database & connection = *database.getDatabase();
+        sqlite3 * handle = connection.getHandle();
+        const std::string lod = quoteName(getTableName(table, geometry));
+        const size_t levels = this->_tolerances.size();
+
+        // Qualified so that a missing column is not read as a string
+        StatementGuard select = {0};
+        const std::string sql = "SELECT t.rowid, t." + quoteName(geometry) +
+                                " FROM " + quoteName(table) + " AS t";
+        if (sqlite3_prepare_v2(handle, sql.c_str(), -1,
+                               &select.statement, 0) != SQLITE_OK)
+        {
+            throw std::runtime_error("Failed to read table!");
+        }
+
+        // ==================================================
+        // Replace the rows of these tolerances inside a savepoint
+        // --------------------------------------------------
+        connection.exec("SAVEPOINT level_of_detail");
+        BuildState state;
+        state.tolerances = this->_tolerances;
+        state.method = this->_method;
+        state.slots.resize(2 * (size_t)this->_threads);
+        state.claimed = 0;
+        state.filled = 0;
+        state.finished = false;
+        state.failed = false;
+        std::vector<std::thread> workers;
+        long long count = 0;
+        try
+        {
+            connection.exec("CREATE TABLE IF NOT EXISTS " + lod +
+                            " (tolerance DOUBLE NOT NULL, "
+                            "pkid INTEGER NOT NULL, geometry BLOB, "
+                            "PRIMARY KEY (tolerance, pkid)) WITHOUT ROWID");
+            SQLite::Statement remove(connection,
+                                     "DELETE FROM " + lod + " WHERE tolerance = ?");
+            for (size_t i = 0; i < levels; i++)
+            {
+                remove.bind(1, this->_tolerances[i]);
+                remove.exec();
+                remove.reset();
+            }
+            SQLite::Statement insert(connection,
+                                     "INSERT INTO " + lod +
+                                     " (tolerance, pkid, geometry) "
+                                     "VALUES (?, ?, ?)");
+
+            for (int i = 0; i < this->_threads; i++)
+            {
+                workers.push_back(std::thread(simplifyChunks, &state));
+            }
+
+            // ==================================================
+            // Read chunks ahead of the workers and store finished ones
+            // in order
+            // --------------------------------------------------
+            const size_t window = state.slots.size();
+            size_t filled = 0;
+            size_t written = 0;
+            bool more = true;
+            for (;;)
+            {
+                while (more && filled < written + window)
+                {
+                    Chunk & chunk = state.slots[filled % window];
+                    chunk.ids.clear();
+                    chunk.input.resize(this->_chunkSize);
+                    int result = SQLITE_ROW;
+                    while (chunk.ids.size() < (size_t)this->_chunkSize &&
+                           (result = sqlite3_step(select.statement)) == SQLITE_ROW)
+                    {
+                        std::string & input = chunk.input[chunk.ids.size()];
+                        input.clear();
+                        if (sqlite3_column_type(select.statement, 1) == SQLITE_BLOB)
+                        {
+                            input.assign((const char *)sqlite3_column_blob(
+                                             select.statement, 1),
+                                         sqlite3_column_bytes(select.statement, 1));
+                        }
+                        chunk.ids.push_back(sqlite3_column_int64(select.statement, 0));
+                    }
+                    if (result != SQLITE_ROW && result != SQLITE_DONE)
+                    {
+                        throw std::runtime_error("Failed to read table!");
+                    }
+                    if (chunk.ids.size() < (size_t)this->_chunkSize) more = false;
+                    if (chunk.ids.empty()) break;
+                    count += (long long)chunk.ids.size();
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    chunk.done = false;
+                    state.filled++;
+                    filled++;
+                    state.changed.notify_all();
+                }
+                if (!more)
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    state.finished = true;
+                    state.changed.notify_all();
+                }
+                if (written == filled) break;
+
+                Chunk & chunk = state.slots[written % window];
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    while (!state.failed && !chunk.done) state.changed.wait(lock);
+                    if (state.failed) break;
+                }
+                for (size_t row = 0; row < chunk.ids.size(); row++)
+                {
+                    for (size_t level = 0; level < levels; level++)
+                    {
+                        const size_t index = row * levels + level;
+                        insert.bind(1, this->_tolerances[level]);
+                        insert.bind(2, (sqlite3_int64)chunk.ids[row]);
+                        if (chunk.present[index])
+                        {
+                            insert.bind(3, chunk.output[index].data(),
+                                        (int)chunk.output[index].size());
+                        }
+                        else
+                        {
+                            insert.bind(3);
+                        }
+                        insert.exec();
+                        insert.reset();
+                    }
+                }
+                written++;
+            }
+        }
+        catch (std::exception & e)
+        {
+            fail(state, e.what());
+        }
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+        if (state.failed)
+        {
+            connection.exec("ROLLBACK TO level_of_detail");
+            connection.exec("RELEASE level_of_detail");
+            throw std::runtime_error(state.error);
+        }
+        connection.exec("RELEASE level_of_detail");
+        return count;
+    }
+
+    int LevelOfDetail::getLevel(double resolution) const
+    {
+        return (int)(std::upper_bound(this->_tolerances.begin(),
+                                      this->_tolerances.end(),
+                                      resolution) -
+                     this->_tolerances.begin()) - 1;
+    }
+
+    int LevelOfDetail::getMethod() const
+    {
+        return this->_method;
+    }
+
+    std::string LevelOfDetail::getQuery(std::string const & table,
+                                        std::string const & geometry,
+                                        double resolution) const
+    {
+        const int level = this->getLevel(resolution);
+        if (level < 0)
+        {
+            return "SELECT t.rowid, t." + quoteName(geometry) +
+                   " FROM " + quoteName(table) + " AS t";
+        }
+        return "SELECT pkid, geometry FROM " +
+               quoteName(getTableName(table, geometry)) +
+               " WHERE tolerance = ?";
+    }
+
+    std::string LevelOfDetail::getTableName(std::string const & table,
+                                            std::string const & geometry)
+    {
+        return table + "_" + geometry + "_lod";
+    }
+
+    int LevelOfDetail::getThreadCount() const
+    {
+        return this->_threads;
+    }
+
+    std::vector<double> const & LevelOfDetail::getTolerances() const
+    {
+        return this->_tolerances;
+    }
+
+    gaiaGeomCollPtr LevelOfDetail::read(SpatialDatabase const & database,
+                                        std::string const & table,
+                                        std::string const & geometry,
+                                        sqlite3_int64 rowid,
+                                        double resolution) const
+    {
+        const int level = this->getLevel(resolution);
+        const std::string sql = level < 0 ?
+            "SELECT t." + quoteName(geometry) + " FROM " + quoteName(table) +
+            " AS t WHERE t.rowid = ?" :
+            "SELECT geometry FROM " + quoteName(getTableName(table, geometry)) +
+            " WHERE pkid = ? AND tolerance = ?";
+        SQLite::Statement query(*database.getDatabase(), sql);
+        query.bind(1, (sqlite3_int64)rowid);
+        if (level >= 0) query.bind(2, this->_tolerances[level]);
+        if (!query.executeStep()) return 0;
+        SQLite::Column column = query.getColumn(0);
+        if (column.getType() != SQLITE_BLOB) return 0;
+        return BlobEncoding::decode(
+            (const unsigned char *)column.getBlob(),
+            column.getBytes());
+    }
+
+    gaiaGeomCollPtr LevelOfDetail::simplify(gaiaGeomCollPtr geometry,
+                                            double tolerance,
+                                            int method)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        if (tolerance < 0) throw std::runtime_error("Invalid tolerance!");
+        if (method == PRESERVE_TOPOLOGY)
+        {
+            GeosContext context;
+            return simplifyTopology(context, geometry, tolerance);
+        }
+        if (method != DOUGLAS_PEUCKER && method != VISVALINGAM)
+        {
+            throw std::runtime_error("Invalid method!");
+        }
+        Scratch scratch;
+        getSignificance(geometry, method, scratch);
+        return filterGeometry(geometry, scratch.significance.data(),
+                              tolerance * tolerance);
+    }
+
+}
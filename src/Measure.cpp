@@ -0,0 +1,719 @@
+/**
+ * @file    Measure.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main Measure class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/Measure.h"
+
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__) || \
+    defined(_M_X64) || defined(_M_IX86)
+    #define SPATIALITECPP_X86 1
+    #include <emmintrin.h>
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define SPATIALITECPP_TARGET(x) __attribute__((target(x)))
+#else
+    #define SPATIALITECPP_TARGET(x)
+#endif
+
+namespace
+{
+
+    /**
+     * @brief Kernel table. Ring and line kernels only cover the segments
+     *        between consecutive points; closing segments are added by the
+     *        callers.
+     */
+    struct Kernels
+    {
+        /// Writes minx, miny, maxx, maxy of n >= 1 points
+        void (*bounds)(const double *, int, int, double *);
+        /// Sum of segment lengths
+        double (*length)(const double *, int, int);
+        /// Sum of segment cross products (twice the signed area)
+        double (*cross)(const double *, int, int);
+        /// Sums of (xi + xj) * c, (yi + yj) * c and c with c the cross product
+        void (*centroid)(const double *, int, int, double *);
+        /// Sums of (xi + xj) * l, (yi + yj) * l and l with l the length
+        void (*lineCentroid)(const double *, int, int, double *);
+    };
+
+    // ==================================================
+    // Scalar kernels
+    // --------------------------------------------------
+
+    void boundsScalar(const double * p, int n, int s, double * out)
+    {
+        double minx = p[0], miny = p[1], maxx = p[0], maxy = p[1];
+        for (int i = 1; i < n; i++)
+        {
+            const double * q = p + (size_t)i * s;
+            minx = q[0] < minx ? q[0] : minx;
+            miny = q[1] < miny ? q[1] : miny;
+            maxx = q[0] > maxx ? q[0] : maxx;
+            maxy = q[1] > maxy ? q[1] : maxy;
+        }
+        out[0] = minx;
+        out[1] = miny;
+        out[2] = maxx;
+        out[3] = maxy;
+    }
+
+    double lengthScalar(const double * p, int n, int s)
+    {
+        double sum = 0;
+        for (int i = 0; i + 1 < n; i++)
+        {
+            const double * a = p + (size_t)i * s;
+            const double * b = a + s;
+            double dx = b[0] - a[0];
+            double dy = b[1] - a[1];
+            sum += std::sqrt(dx * dx + dy * dy);
+        }
+        return sum;
+    }
+
+    double crossScalar(const double * p, int n, int s)
+    {
+        double sum = 0;
+        for (int i = 0; i + 1 < n; i++)
+        {
+            const double * a = p + (size_t)i * s;
+            const double * b = a + s;
+            sum += a[0] * b[1] - b[0] * a[1];
+        }
+        return sum;
+    }
+
+    void centroidScalar(const double * p, int n, int s, double * out)
+    {
+        double sx = 0, sy = 0, sc = 0;
+        for (int i = 0; i + 1 < n; i++)
+        {
+            const double * a = p + (size_t)i * s;
+            const double * b = a + s;
+            double c = a[0] * b[1] - b[0] * a[1];
+            sx += (a[0] + b[0]) * c;
+            sy += (a[1] + b[1]) * c;
+            sc += c;
+        }
+        out[0] = sx;
+        out[1] = sy;
+        out[2] = sc;
+    }
+
+    void lineCentroidScalar(const double * p, int n, int s, double * out)
+    {
+        double sx = 0, sy = 0, sl = 0;
+        for (int i = 0; i + 1 < n; i++)
+        {
+            const double * a = p + (size_t)i * s;
+            const double * b = a + s;
+            double dx = b[0] - a[0];
+            double dy = b[1] - a[1];
+            double l = std::sqrt(dx * dx + dy * dy);
+            sx += (a[0] + b[0]) * l;
+            sy += (a[1] + b[1]) * l;
+            sl += l;
+        }
+        out[0] = sx;
+        out[1] = sy;
+        out[2] = sl;
+    }
+
+    const Kernels SCALAR_KERNELS =
+    {
+        boundsScalar,
+        lengthScalar,
+        crossScalar,
+        centroidScalar,
+        lineCentroidScalar
+    };
+
+#ifdef SPATIALITECPP_X86
+
+    // ==================================================
+    // SSE2 kernels. Each vector holds the (x, y) pair of
+    // one point so every dimension model is handled by
+    // the stride alone.
+    // --------------------------------------------------
+
+    SPATIALITECPP_TARGET("sse2")
+    inline __m128d swapSse2(__m128d v)
+    {
+        return _mm_shuffle_pd(v, v, 1);
+    }
+
+    SPATIALITECPP_TARGET("sse2")
+    void boundsSse2(const double * p, int n, int s, double * out)
+    {
+        __m128d lo = _mm_loadu_pd(p);
+        __m128d hi = lo;
+        for (int i = 1; i < n; i++)
+        {
+            __m128d v = _mm_loadu_pd(p + (size_t)i * s);
+            lo = _mm_min_pd(lo, v);
+            hi = _mm_max_pd(hi, v);
+        }
+        _mm_storeu_pd(out, lo);
+        _mm_storeu_pd(out + 2, hi);
+    }
+
+    SPATIALITECPP_TARGET("sse2")
+    double lengthSse2(const double * p, int n, int s)
+    {
+        __m128d acc = _mm_setzero_pd();
+        int i = 0;
+        for (; i + 2 < n; i += 2)
+        {
+            const double * q = p + (size_t)i * s;
+            __m128d a = _mm_loadu_pd(q);
+            __m128d b = _mm_loadu_pd(q + s);
+            __m128d c = _mm_loadu_pd(q + 2 * s);
+            __m128d d1 = _mm_sub_pd(b, a);
+            __m128d d2 = _mm_sub_pd(c, b);
+            d1 = _mm_mul_pd(d1, d1);
+            d2 = _mm_mul_pd(d2, d2);
+            __m128d sq = _mm_add_pd(_mm_unpacklo_pd(d1, d2),
+                                    _mm_unpackhi_pd(d1, d2));
+            acc = _mm_add_pd(acc, _mm_sqrt_pd(sq));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        return lanes[0] + lanes[1] + lengthScalar(p + (size_t)i * s, n - i, s);
+    }
+
+    SPATIALITECPP_TARGET("sse2")
+    double crossSse2(const double * p, int n, int s)
+    {
+        __m128d acc = _mm_setzero_pd();
+        __m128d a = _mm_loadu_pd(p);
+        for (int i = 0; i + 1 < n; i++)
+        {
+            __m128d b = _mm_loadu_pd(p + (size_t)(i + 1) * s);
+            // (xa * yb, ya * xb) - (ya * xb, xa * yb) = (c, -c)
+            __m128d prod = _mm_mul_pd(a, swapSse2(b));
+            acc = _mm_add_pd(acc, _mm_sub_pd(prod, swapSse2(prod)));
+            a = b;
+        }
+        return _mm_cvtsd_f64(acc);
+    }
+
+    SPATIALITECPP_TARGET("sse2")
+    void centroidSse2(const double * p, int n, int s, double * out)
+    {
+        __m128d sum = _mm_setzero_pd();
+        __m128d area = _mm_setzero_pd();
+        __m128d a = _mm_loadu_pd(p);
+        for (int i = 0; i + 1 < n; i++)
+        {
+            __m128d b = _mm_loadu_pd(p + (size_t)(i + 1) * s);
+            __m128d prod = _mm_mul_pd(a, swapSse2(b));
+            __m128d c = _mm_sub_pd(prod, swapSse2(prod));
+            sum = _mm_add_pd(sum, _mm_mul_pd(_mm_add_pd(a, b),
+                                             _mm_unpacklo_pd(c, c)));
+            area = _mm_add_pd(area, c);
+            a = b;
+        }
+        _mm_storeu_pd(out, sum);
+        out[2] = _mm_cvtsd_f64(area);
+    }
+
+    SPATIALITECPP_TARGET("sse2")
+    void lineCentroidSse2(const double * p, int n, int s, double * out)
+    {
+        __m128d sum = _mm_setzero_pd();
+        __m128d total = _mm_setzero_pd();
+        __m128d a = _mm_loadu_pd(p);
+        for (int i = 0; i + 1 < n; i++)
+        {
+            __m128d b = _mm_loadu_pd(p + (size_t)(i + 1) * s);
+            __m128d d = _mm_sub_pd(b, a);
+            d = _mm_mul_pd(d, d);
+            __m128d l = _mm_sqrt_pd(_mm_add_pd(d, swapSse2(d)));
+            sum = _mm_add_pd(sum, _mm_mul_pd(_mm_add_pd(a, b), l));
+            total = _mm_add_pd(total, l);
+            a = b;
+        }
+        _mm_storeu_pd(out, sum);
+        out[2] = _mm_cvtsd_f64(total);
+    }
+
+    const Kernels SSE2_KERNELS =
+    {
+        boundsSse2,
+        lengthSse2,
+        crossSse2,
+        centroidSse2,
+        lineCentroidSse2
+    };
+
+    // ==================================================
+    // AVX2 kernels. Each vector holds the (x, y) pairs of
+    // two points.
+    // --------------------------------------------------
+
+    SPATIALITECPP_TARGET("avx2")
+    inline __m256d pairAvx2(const double * a, const double * b)
+    {
+        return _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(a)),
+                                    _mm_loadu_pd(b), 1);
+    }
+
+    SPATIALITECPP_TARGET("avx2")
+    inline double sumEvenAvx2(__m256d v)
+    {
+        double lanes[4];
+        _mm256_storeu_pd(lanes, v);
+        return lanes[0] + lanes[2];
+    }
+
+    SPATIALITECPP_TARGET("avx2")
+    void boundsAvx2(const double * p, int n, int s, double * out)
+    {
+        __m256d lo = pairAvx2(p, p);
+        __m256d hi = lo;
+        int i = 1;
+        for (; i + 1 < n; i += 2)
+        {
+            const double * q = p + (size_t)i * s;
+            __m256d v = pairAvx2(q, q + s);
+            lo = _mm256_min_pd(lo, v);
+            hi = _mm256_max_pd(hi, v);
+        }
+        if (i < n)
+        {
+            const double * q = p + (size_t)i * s;
+            __m256d v = pairAvx2(q, q);
+            lo = _mm256_min_pd(lo, v);
+            hi = _mm256_max_pd(hi, v);
+        }
+        _mm_storeu_pd(out, _mm_min_pd(_mm256_castpd256_pd128(lo),
+                                      _mm256_extractf128_pd(lo, 1)));
+        _mm_storeu_pd(out + 2, _mm_max_pd(_mm256_castpd256_pd128(hi),
+                                          _mm256_extractf128_pd(hi, 1)));
+    }
+
+    SPATIALITECPP_TARGET("avx2")
+    double lengthAvx2(const double * p, int n, int s)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        int i = 0;
+        for (; i + 4 < n; i += 4)
+        {
+            const double * q = p + (size_t)i * s;
+            __m256d a0 = pairAvx2(q, q + s);
+            __m256d b0 = pairAvx2(q + s, q + 2 * s);
+            __m256d a1 = pairAvx2(q + 2 * s, q + 3 * s);
+            __m256d b1 = pairAvx2(q + 3 * s, q + 4 * s);
+            __m256d d0 = _mm256_sub_pd(b0, a0);
+            __m256d d1 = _mm256_sub_pd(b1, a1);
+            d0 = _mm256_mul_pd(d0, d0);
+            d1 = _mm256_mul_pd(d1, d1);
+            acc = _mm256_add_pd(acc, _mm256_sqrt_pd(_mm256_hadd_pd(d0, d1)));
+        }
+        double lanes[4];
+        _mm256_storeu_pd(lanes, acc);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+               lengthScalar(p + (size_t)i * s, n - i, s);
+    }
+
+    SPATIALITECPP_TARGET("avx2")
+    double crossAvx2(const double * p, int n, int s)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        int i = 0;
+        for (; i + 2 < n; i += 2)
+        {
+            const double * q = p + (size_t)i * s;
+            __m256d a = pairAvx2(q, q + s);
+            __m256d b = pairAvx2(q + s, q + 2 * s);
+            __m256d prod = _mm256_mul_pd(a, _mm256_permute_pd(b, 0x5));
+            acc = _mm256_add_pd(acc, _mm256_sub_pd(
+                prod, _mm256_permute_pd(prod, 0x5)));
+        }
+        return sumEvenAvx2(acc) + crossScalar(p + (size_t)i * s, n - i, s);
+    }
+
+    SPATIALITECPP_TARGET("avx2")
+    void centroidAvx2(const double * p, int n, int s, double * out)
+    {
+        __m256d sum = _mm256_setzero_pd();
+        __m256d area = _mm256_setzero_pd();
+        int i = 0;
+        for (; i + 2 < n; i += 2)
+        {
+            const double * q = p + (size_t)i * s;
+            __m256d a = pairAvx2(q, q + s);
+            __m256d b = pairAvx2(q + s, q + 2 * s);
+            __m256d prod = _mm256_mul_pd(a, _mm256_permute_pd(b, 0x5));
+            __m256d c = _mm256_sub_pd(prod, _mm256_permute_pd(prod, 0x5));
+            sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_add_pd(a, b),
+                                                   _mm256_movedup_pd(c)));
+            area = _mm256_add_pd(area, c);
+        }
+        double tail[3];
+        centroidScalar(p + (size_t)i * s, n - i, s, tail);
+        double lanes[4];
+        _mm256_storeu_pd(lanes, sum);
+        out[0] = lanes[0] + lanes[2] + tail[0];
+        out[1] = lanes[1] + lanes[3] + tail[1];
+        out[2] = sumEvenAvx2(area) + tail[2];
+    }
+
+    SPATIALITECPP_TARGET("avx2")
+    void lineCentroidAvx2(const double * p, int n, int s, double * out)
+    {
+        __m256d sum = _mm256_setzero_pd();
+        __m256d total = _mm256_setzero_pd();
+        int i = 0;
+        for (; i + 2 < n; i += 2)
+        {
+            const double * q = p + (size_t)i * s;
+            __m256d a = pairAvx2(q, q + s);
+            __m256d b = pairAvx2(q + s, q + 2 * s);
+            __m256d d = _mm256_sub_pd(b, a);
+            d = _mm256_mul_pd(d, d);
+            __m256d l = _mm256_sqrt_pd(_mm256_add_pd(
+                d, _mm256_permute_pd(d, 0x5)));
+            sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_add_pd(a, b), l));
+            total = _mm256_add_pd(total, l);
+        }
+        double tail[3];
+        lineCentroidScalar(p + (size_t)i * s, n - i, s, tail);
+        double lanes[4];
+        _mm256_storeu_pd(lanes, sum);
+        out[0] = lanes[0] + lanes[2] + tail[0];
+        out[1] = lanes[1] + lanes[3] + tail[1];
+        out[2] = sumEvenAvx2(total) + tail[2];
+    }
+
+    const Kernels AVX2_KERNELS =
+    {
+        boundsAvx2,
+        lengthAvx2,
+        crossAvx2,
+        centroidAvx2,
+        lineCentroidAvx2
+    };
+
+#endif
+
+    // ==================================================
+    // Point distance helpers
+    // --------------------------------------------------
+
+    /**
+     * @brief Squared distance from a point to a segment
+     */
+    double segmentDistance2(double px, double py,
+                            const double * a, const double * b)
+    {
+        double dx = b[0] - a[0];
+        double dy = b[1] - a[1];
+        double t = 0;
+        double d2 = dx * dx + dy * dy;
+        if (d2 > 0)
+        {
+            t = ((px - a[0]) * dx + (py - a[1]) * dy) / d2;
+            t = t < 0 ? 0 : (t > 1 ? 1 : t);
+        }
+        double ex = a[0] + t * dx - px;
+        double ey = a[1] + t * dy - py;
+        return ex * ex + ey * ey;
+    }
+
+    /**
+     * @brief Updates the squared distance to the segments of a path and
+     *        toggles the even-odd state of the point against them
+     */
+    void pathDistance2(const double * p, int n, int s,
+                       double px, double py,
+                       double & best, bool & inside)
+    {
+        if (n == 1)
+        {
+            best = std::min(best, segmentDistance2(px, py, p, p));
+        }
+        for (int i = 0; i + 1 < n; i++)
+        {
+            const double * a = p + (size_t)i * s;
+            const double * b = a + s;
+            best = std::min(best, segmentDistance2(px, py, a, b));
+            if ((a[1] > py) != (b[1] > py) &&
+                px < a[0] + (py - a[1]) * (b[0] - a[0]) / (b[1] - a[1]))
+            {
+                inside = !inside;
+            }
+        }
+    }
+
+    // ==================================================
+    // Run-time dispatch
+    // --------------------------------------------------
+
+    int detectInstructionSet()
+    {
+#if defined(SPATIALITECPP_X86) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maximum = info[0];
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (maximum >= 7 && osxsave && avx &&
+            (_xgetbv(0) & 0x6) == 0x6)
+        {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5)) return SpatiaLite::Measure::AVX2;
+        }
+        if (sse2) return SpatiaLite::Measure::SSE2;
+#elif defined(SPATIALITECPP_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SpatiaLite::Measure::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SpatiaLite::Measure::SSE2;
+#endif
+        return SpatiaLite::Measure::SCALAR;
+    }
+
+    int supportedSet()
+    {
+        static const int supported = detectInstructionSet();
+        return supported;
+    }
+
+    std::atomic<int> activeSet(-1);
+
+    int currentSet()
+    {
+        int set = activeSet.load();
+        if (set < 0)
+        {
+            // Keep a set selected concurrently over the default
+            activeSet.compare_exchange_strong(set, supportedSet());
+            set = activeSet.load();
+        }
+        return set;
+    }
+
+    Kernels const & getKernels()
+    {
+#ifdef SPATIALITECPP_X86
+        const int set = currentSet();
+        if (set == SpatiaLite::Measure::AVX2) return AVX2_KERNELS;
+        if (set == SpatiaLite::Measure::SSE2) return SSE2_KERNELS;
+#endif
+        return SCALAR_KERNELS;
+    }
+
+}
+
+namespace SpatiaLite
+{
+
+    Measure::Measure()
+    {
+    }
+
+    double Measure::getArea(const double * coords,
+                            int points,
+                            int dimensions)
+    {
+        int stride = CoordinateBuffer::getStride(dimensions);
+        if (points < 3) return 0;
+        double sum = getKernels().cross(coords, points, stride);
+        const double * last = coords + (size_t)(points - 1) * stride;
+        sum += last[0] * coords[1] - coords[0] * last[1];
+        return std::fabs(sum) / 2;
+    }
+
+    double Measure::getArea(gaiaGeomCollPtr geometry)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        double area = 0;
+        for (gaiaPolygonPtr pg = geometry->FirstPolygon; pg; pg = pg->Next)
+        {
+            gaiaRingPtr ring = pg->Exterior;
+            area += Measure::getArea(ring->Coords,
+                                     ring->Points,
+                                     ring->DimensionModel);
+            for (int i = 0; i < pg->NumInteriors; i++)
+            {
+                ring = pg->Interiors + i;
+                area -= Measure::getArea(ring->Coords,
+                                         ring->Points,
+                                         ring->DimensionModel);
+            }
+        }
+        return area;
+    }
+
+    bool Measure::getBounds(const double * coords,
+                            int points,
+                            int dimensions,
+                            double & minx,
+                            double & miny,
+                            double & maxx,
+                            double & maxy)
+    {
+        int stride = CoordinateBuffer::getStride(dimensions);
+        if (points < 1) return false;
+        double bounds[4];
+        getKernels().bounds(coords, points, stride, bounds);
+        minx = bounds[0];
+        miny = bounds[1];
+        maxx = bounds[2];
+        maxy = bounds[3];
+        return true;
+    }
+
+    bool Measure::getCentroid(const double * coords,
+                              int points,
+                              int dimensions,
+                              double & x,
+                              double & y)
+    {
+        int stride = CoordinateBuffer::getStride(dimensions);
+        if (points < 3) return false;
+        double sums[3];
+        getKernels().centroid(coords, points, stride, sums);
+
+        // Closing segment
+        const double * last = coords + (size_t)(points - 1) * stride;
+        double c = last[0] * coords[1] - coords[0] * last[1];
+        sums[0] += (last[0] + coords[0]) * c;
+        sums[1] += (last[1] + coords[1]) * c;
+        sums[2] += c;
+
+        if (sums[2] == 0) return false;
+        x = sums[0] / (3 * sums[2]);
+        y = sums[1] / (3 * sums[2]);
+        return true;
+    }
+
+    double Measure::getDistance(gaiaGeomCollPtr geometry,
+                                double x,
+                                double y)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        double best = DBL_MAX;
+        bool inside = false;
+        for (gaiaPointPtr pt = geometry->FirstPoint; pt; pt = pt->Next)
+        {
+            double dx = pt->X - x;
+            double dy = pt->Y - y;
+            best = std::min(best, dx * dx + dy * dy);
+        }
+        for (gaiaLinestringPtr ln = geometry->FirstLinestring; ln; ln = ln->Next)
+        {
+            int stride = CoordinateBuffer::getStride(ln->DimensionModel);
+            pathDistance2(ln->Coords, ln->Points, stride, x, y, best, inside);
+        }
+        for (gaiaPolygonPtr pg = geometry->FirstPolygon; pg; pg = pg->Next)
+        {
+            // Rings are closed so their crossings decide containment
+            inside = false;
+            for (int i = -1; i < pg->NumInteriors; i++)
+            {
+                gaiaRingPtr ring = i < 0 ? pg->Exterior : pg->Interiors + i;
+                int stride = CoordinateBuffer::getStride(ring->DimensionModel);
+                pathDistance2(ring->Coords, ring->Points, stride,
+                              x, y, best, inside);
+            }
+            if (inside) return 0;
+        }
+        return best == DBL_MAX ? DBL_MAX : std::sqrt(best);
+    }
+
+    int Measure::getInstructionSet()
+    {
+        return currentSet();
+    }
+
+    double Measure::getLength(const double * coords,
+                              int points,
+                              int dimensions)
+    {
+        int stride = CoordinateBuffer::getStride(dimensions);
+        if (points < 2) return 0;
+        return getKernels().length(coords, points, stride);
+    }
+
+    double Measure::getLength(gaiaGeomCollPtr geometry)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        double length = 0;
+        for (gaiaLinestringPtr ln = geometry->FirstLinestring; ln; ln = ln->Next)
+        {
+            length += Measure::getLength(ln->Coords,
+                                         ln->Points,
+                                         ln->DimensionModel);
+        }
+        for (gaiaPolygonPtr pg = geometry->FirstPolygon; pg; pg = pg->Next)
+        {
+            gaiaRingPtr ring = pg->Exterior;
+            length += Measure::getLength(ring->Coords,
+                                         ring->Points,
+                                         ring->DimensionModel);
+            for (int i = 0; i < pg->NumInteriors; i++)
+            {
+                ring = pg->Interiors + i;
+                length += Measure::getLength(ring->Coords,
+                                             ring->Points,
+                                             ring->DimensionModel);
+            }
+        }
+        return length;
+    }
+
+    bool Measure::getLineCentroid(const double * coords,
+                                  int points,
+                                  int dimensions,
+                                  double & x,
+                                  double & y)
+    {
+        int stride = CoordinateBuffer::getStride(dimensions);
+        if (points < 1) return false;
+        double sums[3] = {0, 0, 0};
+        if (points > 1)
+        {
+            getKernels().lineCentroid(coords, points, stride, sums);
+        }
+        if (sums[2] == 0)
+        {
+            x = coords[0];
+            y = coords[1];
+            return true;
+        }
+        x = sums[0] / (2 * sums[2]);
+        y = sums[1] / (2 * sums[2]);
+        return true;
+    }
+
+    int Measure::setInstructionSet(int set)
+    {
+        int supported = supportedSet();
+        if (set < SCALAR) set = SCALAR;
+        if (set > supported) set = supported;
+        activeSet.store(set);
+        return set;
+    }
+
+}
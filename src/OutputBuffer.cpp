@@ -25,6 +25,15 @@ namespace SpatiaLite
         }
     }
 
+    void OutputBuffer::clear()
+    {
+        OutputBufferType buffer = this->get();
+        if (!buffer) return;
+        buffer->WriteOffset = 0;
+        buffer->Error = 0;
+        if (buffer->Buffer) buffer->Buffer[0] = '\0';
+    }
+
     void OutputBuffer::clean(OutputBufferType buffer)
     {
         if (buffer)
@@ -33,6 +42,22 @@ namespace SpatiaLite
         }
     }
 
+    size_t OutputBuffer::getCapacity() const
+    {
+        return this->get() ? (size_t)this->get()->BufferSize : 0;
+    }
+
+    const char * OutputBuffer::getData() const
+    {
+        if (!this->get() || !this->get()->Buffer) return "";
+        return this->get()->Buffer;
+    }
+
+    size_t OutputBuffer::getSize() const
+    {
+        return this->get() ? (size_t)this->get()->WriteOffset : 0;
+    }
+
     bool OutputBuffer::isValid() const
     {
         return (this->get() &&
@@ -40,4 +65,12 @@ namespace SpatiaLite
                 this->get()->Buffer != 0);
     }
 
+    void OutputBuffer::shrink()
+    {
+        if (this->get())
+        {
+            gaiaOutBufferReset(this->get());
+        }
+    }
+
 }
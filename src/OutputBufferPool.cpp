@@ -0,0 +1,174 @@
+/**
+ * @file    OutputBufferPool.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main OutputBufferPool class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/OutputBufferPool.h"
+
+#include <stdexcept>
+
+namespace SpatiaLite
+{
+
+    OutputBufferPool::Lease::Lease() noexcept :
+        _buffer(0),
+        _pool(0)
+    {
+    }
+
+    OutputBufferPool::Lease::Lease(OutputBufferPool * pool,
+                                   OutputBuffer * buffer) noexcept :
+        _buffer(buffer),
+        _pool(pool)
+    {
+    }
+
+    OutputBufferPool::Lease::Lease(Lease && other) noexcept :
+        _buffer(other._buffer),
+        _pool(other._pool)
+    {
+        other._buffer = 0;
+        other._pool = 0;
+    }
+
+    OutputBufferPool::Lease &
+    OutputBufferPool::Lease::operator=(Lease && other) noexcept
+    {
+        if (this != &other)
+        {
+            this->reset();
+            this->_buffer = other._buffer;
+            this->_pool = other._pool;
+            other._buffer = 0;
+            other._pool = 0;
+        }
+        return *this;
+    }
+
+    OutputBufferPool::Lease::~Lease()
+    {
+        this->reset();
+    }
+
+    OutputBufferPool::Lease::operator bool() const noexcept
+    {
+        return this->_buffer != 0;
+    }
+
+    OutputBuffer * OutputBufferPool::Lease::get() const noexcept
+    {
+        return this->_buffer;
+    }
+
+    OutputBuffer * OutputBufferPool::Lease::operator->() const noexcept
+    {
+        return this->_buffer;
+    }
+
+    void OutputBufferPool::Lease::reset() noexcept
+    {
+        if (this->_buffer) this->_pool->release(this->_buffer);
+        this->_buffer = 0;
+        this->_pool = 0;
+    }
+
+    OutputBufferPool::OutputBufferPool(size_t maxCapacity, int maxIdle) :
+        _hits(0),
+        _idle(),
+        _maxCapacity(maxCapacity),
+        _maxIdle(maxIdle),
+        _misses(0),
+        _trims(0)
+    {
+        if (maxIdle < 0) throw std::runtime_error("Invalid idle count!");
+        this->_idle.reserve(maxIdle);
+    }
+
+    OutputBufferPool::~OutputBufferPool()
+    {
+        this->clear();
+    }
+
+    OutputBufferPool::Lease OutputBufferPool::acquire()
+    {
+        if (!this->_idle.empty())
+        {
+            OutputBuffer * buffer = this->_idle.back();
+            this->_idle.pop_back();
+            this->_hits++;
+            return Lease(this, buffer);
+        }
+        this->_misses++;
+        return Lease(this, new OutputBuffer(new gaiaOutBuffer()));
+    }
+
+    void OutputBufferPool::clear()
+    {
+        for (size_t i = 0; i < this->_idle.size(); i++)
+        {
+            delete this->_idle[i];
+        }
+        this->_idle.clear();
+    }
+
+    long long OutputBufferPool::getHits() const
+    {
+        return this->_hits;
+    }
+
+    int OutputBufferPool::getIdleCount() const
+    {
+        return (int)this->_idle.size();
+    }
+
+    size_t OutputBufferPool::getMaxCapacity() const
+    {
+        return this->_maxCapacity;
+    }
+
+    int OutputBufferPool::getMaxIdle() const
+    {
+        return this->_maxIdle;
+    }
+
+    long long OutputBufferPool::getMisses() const
+    {
+        return this->_misses;
+    }
+
+    OutputBufferPool & OutputBufferPool::getThreadPool()
+    {
+        static thread_local OutputBufferPool pool;
+        return pool;
+    }
+
+    long long OutputBufferPool::getTrims() const
+    {
+        return this->_trims;
+    }
+
+    void OutputBufferPool::release(OutputBuffer * buffer) noexcept
+    {
+        if ((int)this->_idle.size() >= this->_maxIdle)
+        {
+            delete buffer;
+            return;
+        }
+        if (buffer->getCapacity() > this->_maxCapacity)
+        {
+            buffer->shrink();
+            this->_trims++;
+        }
+        else
+        {
+            buffer->clear();
+        }
+
+        // Storage is reserved for maxIdle entries, so this never allocates
+        this->_idle.push_back(buffer);
+    }
+
+}
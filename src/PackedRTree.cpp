@@ -0,0 +1,701 @@
+/**
+ * @file    PackedRTree.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main PackedRTree class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/PackedRTree.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+extern "C"
+{
+#include "spatialite/gaiageo.h"
+}
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // File signature, format version included
+        const char TREE_MAGIC[8] = {'S', 'L', 'P', 'R', 'T', 'R', '0', '1'};
+
+        // Written in native order to detect foreign byte order
+        const unsigned int TREE_BYTE_ORDER = 0x01020304;
+
+        /**
+         * @brief Tree file header
+         */
+        struct TreeHeader
+        {
+            char magic[8];              ///< TREE_MAGIC
+            unsigned int byteOrder;     ///< TREE_BYTE_ORDER
+            unsigned int nodeSize;      ///< Children per node
+            unsigned long long items;   ///< Number of items
+            unsigned long long nodes;   ///< Number of nodes
+            double extent[4];           ///< minx, miny, maxx, maxy
+        };
+
+        // Bytes per node in a tree file
+        const size_t NODE_BYTES = 4 * sizeof(double) + sizeof(sqlite3_int64);
+
+        // Search queue entry kinds
+        const int TREE_NODE = 0;
+        const int TREE_BOX = 1;
+        const int TREE_EXACT = 2;
+
+        /**
+         * @brief Best-first search queue entry
+         */
+        struct SearchEntry
+        {
+            double distance;  ///< Lower bound or exact distance
+            size_t position;  ///< Node position
+            int kind;         ///< TREE_NODE, TREE_BOX or TREE_EXACT
+
+            /**
+             * @returns True if this entry is popped after another
+             */
+            bool operator<(const SearchEntry & other) const
+            {
+                if (this->distance != other.distance)
+                {
+                    return this->distance > other.distance;
+                }
+                return this->kind < other.kind;
+            }
+        };
+
+        /**
+         * @brief Distance from a point to a box, zero inside
+         */
+        double boxDistance(double x, double y, const double * box)
+        {
+            double dx = std::max(std::max(box[0] - x, x - box[2]), 0.0);
+            double dy = std::max(std::max(box[1] - y, y - box[3]), 0.0);
+            return std::sqrt(dx * dx + dy * dy);
+        }
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Reads the bounding box of a SpatiaLite geometry blob from
+         *        its header (or the point of a TinyPoint blob). Other
+         *        encodings, such as quantized blobs, are decoded.
+         * @returns False if the blob is not a geometry
+         */
+        bool readBlobBounds(const unsigned char * blob, int size, double * box)
+        {
+            if (size > 0 && blob[0] != 0x00)
+            {
+                gaiaGeomCollPtr geometry = BlobEncoding::decode(blob, size);
+                if (!geometry) return false;
+                gaiaMbrGeometry(geometry);
+                box[0] = geometry->MinX;
+                box[1] = geometry->MinY;
+                box[2] = geometry->MaxX;
+                box[3] = geometry->MaxY;
+                gaiaFreeGeomColl(geometry);
+                return box[0] <= box[2] && box[1] <= box[3];
+            }
+            if (size < 24) return false;
+            const int arch = gaiaEndianArch();
+            if (blob[1] == 0x80 || blob[1] == 0x81)
+            {
+                const int little = blob[1] == 0x81;
+                box[0] = box[2] = gaiaImport64(blob + 7, little, arch);
+                box[1] = box[3] = gaiaImport64(blob + 15, little, arch);
+                return true;
+            }
+            if (size < 45 || blob[38] != 0x7C) return false;
+            if (blob[1] != 0x00 && blob[1] != 0x01) return false;
+            const int little = blob[1] == 0x01;
+            for (int i = 0; i < 4; i++)
+            {
+                box[i] = gaiaImport64(blob + 6 + 8 * i, little, arch);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Maps a whole file read-only
+         */
+        void * mapFile(std::string const & filename, size_t & size)
+        {
+#ifdef _WIN32
+            HANDLE file = CreateFileA(filename.c_str(),
+                                      GENERIC_READ,
+                                      FILE_SHARE_READ,
+                                      0,
+                                      OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL,
+                                      0);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error("Failed to open tree file!");
+            }
+            LARGE_INTEGER length;
+            if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+            {
+                CloseHandle(file);
+                throw std::runtime_error("Invalid tree file!");
+            }
+            HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+            CloseHandle(file);
+            if (!mapping) throw std::runtime_error("Failed to map tree file!");
+            void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (!view) throw std::runtime_error("Failed to map tree file!");
+            size = (size_t)length.QuadPart;
+            return view;
+#else
+            int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("Failed to open tree file!");
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0)
+            {
+                close(fd);
+                throw std::runtime_error("Invalid tree file!");
+            }
+            void * view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (view == MAP_FAILED)
+            {
+                throw std::runtime_error("Failed to map tree file!");
+            }
+            size = (size_t)info.st_size;
+            return view;
+#endif
+        }
+
+        /**
+         * @brief Releases a file view
+         */
+        void unmapFile(void * view, size_t size)
+        {
+#ifdef _WIN32
+            (void)size;
+            UnmapViewOfFile(view);
+#else
+            munmap(view, size);
+#endif
+        }
+
+    }
+
+    PackedRTree::PackedRTree(int nodeSize) :
+        _boxes(0),
+        _boxData(),
+        _finished(false),
+        _ids(0),
+        _idData(),
+        _levelBounds(),
+        _mapping(0),
+        _mappingSize(0),
+        _maxx(-DBL_MAX),
+        _maxy(-DBL_MAX),
+        _minx(DBL_MAX),
+        _miny(DBL_MAX),
+        _nodeSize(nodeSize),
+        _numNodes(0),
+        _numItems(0)
+    {
+        if (nodeSize < 2 || nodeSize > 65535)
+        {
+            throw std::runtime_error("Invalid node size!");
+        }
+    }
+
+    PackedRTree::~PackedRTree()
+    {
+        if (this->_mapping) unmapFile(this->_mapping, this->_mappingSize);
+    }
+
+    void PackedRTree::add(sqlite3_int64 id,
+                          double minx,
+                          double miny,
+                          double maxx,
+                          double maxy)
+    {
+        if (this->_finished) throw std::runtime_error("Tree is finished!");
+        this->_idData.push_back(id);
+        this->_boxData.push_back(minx);
+        this->_boxData.push_back(miny);
+        this->_boxData.push_back(maxx);
+        this->_boxData.push_back(maxy);
+        this->_minx = std::min(this->_minx, minx);
+        this->_miny = std::min(this->_miny, miny);
+        this->_maxx = std::max(this->_maxx, maxx);
+        this->_maxy = std::max(this->_maxy, maxy);
+    }
+
+    void PackedRTree::finish()
+    {
+        if (this->_finished) throw std::runtime_error("Tree is finished!");
+        this->_numItems = this->_idData.size();
+        this->initLevels();
+        this->_finished = true;
+        if (this->_numItems == 0) return;
+
+        // ==================================================
+        // Sort the items by the Hilbert value of their centers
+        // --------------------------------------------------
+        const size_t n = this->_numItems;
+        const double width = this->_maxx - this->_minx;
+        const double height = this->_maxy - this->_miny;
+        std::vector<std::pair<unsigned int, size_t> > order(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            const double * box = &this->_boxData[4 * i];
+            unsigned int hx = width > 0 ? (unsigned int)std::floor(
+                65535 * ((box[0] + box[2]) / 2 - this->_minx) / width) : 0;
+            unsigned int hy = height > 0 ? (unsigned int)std::floor(
+                65535 * ((box[1] + box[3]) / 2 - this->_miny) / height) : 0;
+            order[i] = std::make_pair(getHilbertValue(hx, hy), i);
+        }
+        std::sort(order.begin(), order.end());
+
+        std::vector<double> boxes(this->_numNodes * 4);
+        std::vector<sqlite3_int64> ids(this->_numNodes);
+        for (size_t i = 0; i < n; i++)
+        {
+            const size_t from = order[i].second;
+            std::memcpy(&boxes[4 * i], &this->_boxData[4 * from], 4 * sizeof(double));
+            ids[i] = this->_idData[from];
+        }
+
+        // ==================================================
+        // Pack each level into full parents, leaves first
+        // --------------------------------------------------
+        size_t parent = n;
+        size_t pos = 0;
+        for (size_t level = 0; level + 1 < this->_levelBounds.size(); level++)
+        {
+            const size_t end = this->_levelBounds[level];
+            while (pos < end)
+            {
+                const size_t first = pos;
+                double box[4] = {DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX};
+                for (int j = 0; j < this->_nodeSize && pos < end; j++, pos++)
+                {
+                    box[0] = std::min(box[0], boxes[4 * pos]);
+                    box[1] = std::min(box[1], boxes[4 * pos + 1]);
+                    box[2] = std::max(box[2], boxes[4 * pos + 2]);
+                    box[3] = std::max(box[3], boxes[4 * pos + 3]);
+                }
+                std::memcpy(&boxes[4 * parent], box, sizeof(box));
+                ids[parent] = (sqlite3_int64)first;
+                parent++;
+            }
+        }
+
+        this->_boxData.swap(boxes);
+        this->_idData.swap(ids);
+        this->_boxes = &this->_boxData[0];
+        this->_ids = &this->_idData[0];
+    }
+
+    PackedRTree * PackedRTree::fromTable(SpatialDatabase const & database,
+                                         std::string const & table,
+                                         std::string const & geometry,
+                                         int nodeSize)
+    {
+        PackedRTree * tree = new PackedRTree(nodeSize);
+        try
+        {
+            SQLite::Statement query(*database.getDatabase(),
+                                    "SELECT rowid, " + quoteName(geometry) +
+                                    " FROM " + quoteName(table));
+            while (query.executeStep())
+            {
+                SQLite::Column value = query.getColumn(1);
+                if (value.getType() != SQLITE_BLOB) continue;
+                double box[4];
+                if (!readBlobBounds((const unsigned char *)value.getBlob(),
+                                    value.getBytes(),
+                                    box))
+                {
+                    continue;
+                }
+                tree->add(query.getColumn(0).getInt64(),
+                          box[0], box[1], box[2], box[3]);
+            }
+            tree->finish();
+        }
+        catch (...)
+        {
+            delete tree;
+            throw;
+        }
+        return tree;
+    }
+
+    bool PackedRTree::getBounds(double & minx,
+                                double & miny,
+                                double & maxx,
+                                double & maxy) const
+    {
+        if (this->_numItems == 0) return false;
+        minx = this->_minx;
+        miny = this->_miny;
+        maxx = this->_maxx;
+        maxy = this->_maxy;
+        return true;
+    }
+
+    size_t PackedRTree::getCount() const
+    {
+        return this->_finished ? this->_numItems : this->_idData.size();
+    }
+
+    unsigned int PackedRTree::getHilbertValue(unsigned int x, unsigned int y)
+    {
+        unsigned int a = x ^ y;
+        unsigned int b = 0xFFFF ^ a;
+        unsigned int c = 0xFFFF ^ (x | y);
+        unsigned int d = x & (y ^ 0xFFFF);
+
+        unsigned int A = a | (b >> 1);
+        unsigned int B = (a >> 1) ^ a;
+        unsigned int C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+        unsigned int D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+        a = A; b = B; c = C; d = D;
+        A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+        B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+        C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+        D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+        a = A; b = B; c = C; d = D;
+        A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+        B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+        C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+        D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+        a = A; b = B; c = C; d = D;
+        C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+        D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+        a = C ^ (C >> 1);
+        b = D ^ (D >> 1);
+
+        unsigned int i0 = x ^ y;
+        unsigned int i1 = b | (0xFFFF ^ (i0 | a));
+
+        i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+        i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+        i0 = (i0 | (i0 << 2)) & 0x33333333;
+        i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+        i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+        i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+        i1 = (i1 | (i1 << 2)) & 0x33333333;
+        i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+        return (i1 << 1) | i0;
+    }
+
+    int PackedRTree::getNodeSize() const
+    {
+        return this->_nodeSize;
+    }
+
+    void PackedRTree::initLevels()
+    {
+        this->_levelBounds.clear();
+        this->_numNodes = 0;
+        if (this->_numItems == 0) return;
+        size_t count = this->_numItems;
+        size_t nodes = count;
+        this->_levelBounds.push_back(nodes);
+        do
+        {
+            count = (count + this->_nodeSize - 1) / this->_nodeSize;
+            nodes += count;
+            this->_levelBounds.push_back(nodes);
+        }
+        while (count != 1);
+        this->_numNodes = nodes;
+    }
+
+    bool PackedRTree::isFinished() const
+    {
+        return this->_finished;
+    }
+
+    bool PackedRTree::isMapped() const
+    {
+        return this->_mapping != 0;
+    }
+
+    PackedRTree * PackedRTree::load(std::string const & filename)
+    {
+        size_t size = 0;
+        void * view = mapFile(filename, size);
+        PackedRTree * tree = 0;
+        try
+        {
+            // ==================================================
+            // Validate the header against the file size
+            // --------------------------------------------------
+            TreeHeader header;
+            if (size < sizeof(header)) throw std::runtime_error("Invalid tree file!");
+            std::memcpy(&header, view, sizeof(header));
+            if (std::memcmp(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC)) != 0 ||
+                header.byteOrder != TREE_BYTE_ORDER)
+            {
+                throw std::runtime_error("Invalid tree file!");
+            }
+            tree = new PackedRTree((int)header.nodeSize);
+            tree->_mapping = view;
+            tree->_mappingSize = size;
+
+            // Counts are bounded by the file size before any arithmetic
+            const size_t capacity = (size - sizeof(header)) / NODE_BYTES;
+            if (header.items > capacity || header.nodes > capacity)
+            {
+                throw std::runtime_error("Invalid tree file!");
+            }
+            tree->_numItems = (size_t)header.items;
+            tree->initLevels();
+            if (tree->_numNodes != header.nodes ||
+                size != sizeof(header) + tree->_numNodes * NODE_BYTES)
+            {
+                throw std::runtime_error("Invalid tree file!");
+            }
+
+            const char * data = static_cast<const char *>(view) + sizeof(header);
+            tree->_boxes = reinterpret_cast<const double *>(data);
+            tree->_ids = reinterpret_cast<const sqlite3_int64 *>(
+                data + tree->_numNodes * 4 * sizeof(double));
+
+            // ==================================================
+            // Children must sit on the next level down, which also
+            // rules out cycles, so queries can trust the offsets
+            // --------------------------------------------------
+            for (size_t level = 1; level < tree->_levelBounds.size(); level++)
+            {
+                const size_t first = level > 1 ? tree->_levelBounds[level - 2] : 0;
+                const size_t end = tree->_levelBounds[level - 1];
+                for (size_t pos = end; pos < tree->_levelBounds[level]; pos++)
+                {
+                    const sqlite3_int64 child = tree->_ids[pos];
+                    if (child < (sqlite3_int64)first || child >= (sqlite3_int64)end)
+                    {
+                        throw std::runtime_error("Invalid tree file!");
+                    }
+                }
+            }
+            tree->_minx = header.extent[0];
+            tree->_miny = header.extent[1];
+            tree->_maxx = header.extent[2];
+            tree->_maxy = header.extent[3];
+            tree->_finished = true;
+        }
+        catch (...)
+        {
+            if (tree) delete tree;
+            else unmapFile(view, size);
+            throw;
+        }
+        return tree;
+    }
+
+    std::vector<SpatialDatabase::Neighbor> PackedRTree::nearest(
+        double x,
+        double y,
+        int k,
+        double maxDistance,
+        Distance const & distance) const
+    {
+        if (!this->_finished) throw std::runtime_error("Tree is not finished!");
+        std::vector<SpatialDatabase::Neighbor> neighbors;
+        if (k <= 0 || this->_numItems == 0) return neighbors;
+
+        // The heap storage is reused per thread. It is taken rather than
+        // shared so that a distance callback may run its own query.
+        static thread_local std::vector<SearchEntry> spare;
+        std::vector<SearchEntry> queue;
+        queue.swap(spare);
+        queue.clear();
+
+        const size_t root = this->_numNodes - 1;
+        SearchEntry start = {boxDistance(x, y, this->_boxes + 4 * root),
+                             root,
+                             TREE_NODE};
+        queue.push_back(start);
+        while (!queue.empty() && (int)neighbors.size() < k)
+        {
+            std::pop_heap(queue.begin(), queue.end());
+            SearchEntry entry = queue.back();
+            queue.pop_back();
+            if (entry.distance > maxDistance) break;
+
+            if (entry.kind == TREE_EXACT)
+            {
+                SpatialDatabase::Neighbor neighbor =
+                    {this->_ids[entry.position], entry.distance};
+                neighbors.push_back(neighbor);
+            }
+            else if (entry.kind == TREE_BOX)
+            {
+                entry.distance = distance(this->_ids[entry.position]);
+                if (entry.distance > maxDistance) continue;
+                entry.kind = TREE_EXACT;
+                queue.push_back(entry);
+                std::push_heap(queue.begin(), queue.end());
+            }
+            else
+            {
+                const size_t first = (size_t)this->_ids[entry.position];
+                const size_t end = std::min(first + this->_nodeSize,
+                                            this->upperBound(first));
+                for (size_t pos = first; pos < end; pos++)
+                {
+                    SearchEntry child;
+                    child.distance = boxDistance(x, y, this->_boxes + 4 * pos);
+                    if (child.distance > maxDistance) continue;
+                    child.position = pos;
+                    if (pos >= this->_numItems) child.kind = TREE_NODE;
+                    else child.kind = distance ? TREE_BOX : TREE_EXACT;
+                    queue.push_back(child);
+                    std::push_heap(queue.begin(), queue.end());
+                }
+            }
+        }
+
+        spare.swap(queue);
+        return neighbors;
+    }
+
+    void PackedRTree::save(std::string const & filename) const
+    {
+        if (!this->_finished) throw std::runtime_error("Tree is not finished!");
+        TreeHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC));
+        header.byteOrder = TREE_BYTE_ORDER;
+        header.nodeSize = (unsigned int)this->_nodeSize;
+        header.items = this->_numItems;
+        header.nodes = this->_numNodes;
+        header.extent[0] = this->_minx;
+        header.extent[1] = this->_miny;
+        header.extent[2] = this->_maxx;
+        header.extent[3] = this->_maxy;
+
+        // ==================================================
+        // Write a temporary file and move it into place so a
+        // mapped copy of the old file stays valid
+        // --------------------------------------------------
+        const std::string temporary = filename + ".tmp";
+        FILE * file = std::fopen(temporary.c_str(), "wb");
+        if (!file) throw std::runtime_error("Failed to open tree file!");
+        const size_t nodes = this->_numNodes;
+        bool written =
+            std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            (nodes == 0 ||
+             (std::fwrite(this->_boxes, 4 * sizeof(double), nodes, file) == nodes &&
+              std::fwrite(this->_ids, sizeof(sqlite3_int64), nodes, file) == nodes));
+        if (std::fclose(file) != 0 || !written)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Failed to write tree file!");
+        }
+#ifdef _WIN32
+        // rename does not replace an existing file on Windows
+        std::remove(filename.c_str());
+#endif
+        if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Failed to write tree file!");
+        }
+    }
+
+    size_t PackedRTree::search(double minx,
+                               double miny,
+                               double maxx,
+                               double maxy,
+                               std::vector<sqlite3_int64> & results) const
+    {
+        if (!this->_finished) throw std::runtime_error("Tree is not finished!");
+        if (this->_numItems == 0) return 0;
+
+        // Reused per thread so queries do not allocate. Nodes are
+        // stacked with their level to find the level ends directly.
+        static thread_local std::vector<std::pair<size_t, size_t> > stack;
+        stack.clear();
+
+        size_t found = 0;
+        size_t node = this->_numNodes - 1;
+        size_t level = this->_levelBounds.size() - 1;
+        for (;;)
+        {
+            const size_t end = std::min(node + this->_nodeSize,
+                                        this->_levelBounds[level]);
+            for (size_t pos = node; pos < end; pos++)
+            {
+                const double * box = this->_boxes + 4 * pos;
+                if (maxx < box[0] || maxy < box[1] ||
+                    minx > box[2] || miny > box[3])
+                {
+                    continue;
+                }
+                if (pos < this->_numItems)
+                {
+                    results.push_back(this->_ids[pos]);
+                    found++;
+                }
+                else
+                {
+                    stack.push_back(std::make_pair((size_t)this->_ids[pos],
+                                                   level - 1));
+                }
+            }
+            if (stack.empty()) break;
+            node = stack.back().first;
+            level = stack.back().second;
+            stack.pop_back();
+        }
+        return found;
+    }
+
+    size_t PackedRTree::upperBound(size_t node) const
+    {
+        return *std::upper_bound(this->_levelBounds.begin(),
+                                 this->_levelBounds.end(),
+                                 node);
+    }
+
+}
@@ -9,6 +9,7 @@
 #include "SpatiaLiteCpp/Point.h"
 
 #include "SpatiaLiteCpp/Blob.h"
+#include "SpatiaLiteCpp/PointBatch.h"
 
 #include <stdexcept>
 
@@ -48,4 +49,14 @@ namespace SpatiaLite
         return new SpatiaLite::Blob(blob, size);
     }
 
+    SpatiaLite::PointBatch * Point::makePoints(int srid,
+                                               const double * x,
+                                               const double * y,
+                                               int count,
+                                               const double * z,
+                                               const double * m)
+    {
+        return SpatiaLite::PointBatch::create(srid, x, y, count, z, m);
+    }
+
 }
@@ -0,0 +1,220 @@
+/**
+ * @file    PointBatch.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main PointBatch class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/PointBatch.h"
+
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // BLOB-Geometry layout of a point
+        const int POINT_SRID = 2;
+        const int POINT_MBR = 6;
+        const int POINT_MBR_END = 38;
+        const int POINT_CLASS = 39;
+        const int POINT_COORDS = 43;
+
+        /**
+         * @brief Rolls back an open transaction and throws the connection
+         *        error.
+         */
+        void fail(sqlite3 * handle, sqlite3_stmt * statement, bool owner)
+        {
+            std::string error = sqlite3_errmsg(handle);
+            if (statement) sqlite3_finalize(statement);
+            if (owner) sqlite3_exec(handle, "ROLLBACK", 0, 0, 0);
+            throw std::runtime_error("Failed to insert points: " + error + "!");
+        }
+
+    }
+
+    PointBatch::PointBatch(PointBatchType arena, int count, int record) :
+        BufferSized<PointBatchType>(arena, (int)((size_t)count * record), PointBatch::clean),
+        _count(count),
+        _record(record)
+    {
+    }
+
+    void PointBatch::clean(PointBatchType buffer)
+    {
+        if (buffer)
+        {
+            std::free(buffer);
+        }
+    }
+
+    PointBatch * PointBatch::create(int srid,
+                                    const double * x,
+                                    const double * y,
+                                    int count,
+                                    const double * z,
+                                    const double * m)
+    {
+        if (count < 0) throw std::runtime_error("Invalid point count!");
+        if (count > 0 && (!x || !y))
+        {
+            throw std::runtime_error("Invalid coordinates!");
+        }
+
+        // ==================================================
+        // Record size and class type from the dimension model
+        // --------------------------------------------------
+        int type = GAIA_POINT;
+        int values = 2;
+        if (z && m)
+        {
+            type = GAIA_POINTZM;
+            values = 4;
+        }
+        else if (z)
+        {
+            type = GAIA_POINTZ;
+            values = 3;
+        }
+        else if (m)
+        {
+            type = GAIA_POINTM;
+            values = 3;
+        }
+        const int record = POINT_COORDS + values * (int)sizeof(double) + 1;
+
+        // Buffer sizes are int
+        if ((size_t)count > (size_t)INT_MAX / record)
+        {
+            throw std::runtime_error("Too many points!");
+        }
+
+        // ==================================================
+        // Header shared by all records (native byte order)
+        // --------------------------------------------------
+        unsigned char header[POINT_COORDS];
+        std::memset(header, 0, sizeof(header));
+        const int one = 1;
+        const bool little = *(const unsigned char *)&one == 1;
+        header[0] = GAIA_MARK_START;
+        header[1] = little ? GAIA_LITTLE_ENDIAN : GAIA_BIG_ENDIAN;
+        std::memcpy(header + POINT_SRID, &srid, sizeof(int));
+        header[POINT_MBR_END] = GAIA_MARK_MBR;
+        std::memcpy(header + POINT_CLASS, &type, sizeof(int));
+
+        // ==================================================
+        // Fill every record of the arena
+        // --------------------------------------------------
+        PointBatchType arena =
+            (PointBatchType)std::malloc(count > 0 ? (size_t)count * record : 1);
+        if (!arena) throw std::runtime_error("Failed to allocate points!");
+        unsigned char * p = arena;
+        for (int i = 0; i < count; i++, p += record)
+        {
+            std::memcpy(p, header, POINT_COORDS);
+            std::memcpy(p + POINT_MBR, &x[i], sizeof(double));
+            std::memcpy(p + POINT_MBR + 8, &y[i], sizeof(double));
+            std::memcpy(p + POINT_MBR + 16, &x[i], sizeof(double));
+            std::memcpy(p + POINT_MBR + 24, &y[i], sizeof(double));
+            unsigned char * c = p + POINT_COORDS;
+            std::memcpy(c, &x[i], sizeof(double));
+            std::memcpy(c + 8, &y[i], sizeof(double));
+            c += 16;
+            if (z)
+            {
+                std::memcpy(c, &z[i], sizeof(double));
+                c += 8;
+            }
+            if (m)
+            {
+                std::memcpy(c, &m[i], sizeof(double));
+                c += 8;
+            }
+            *c = GAIA_MARK_END;
+        }
+
+        return new PointBatch(arena, count, record);
+    }
+
+    const unsigned char * PointBatch::getBlob(int index) const
+    {
+        if (index < 0 || index >= this->_count)
+        {
+            throw std::runtime_error("Invalid point index!");
+        }
+        return this->get() + (size_t)index * this->_record;
+    }
+
+    int PointBatch::getCount() const
+    {
+        return this->_count;
+    }
+
+    int PointBatch::getRecordSize() const
+    {
+        return this->_record;
+    }
+
+    int PointBatch::insert(SpatialDatabase const & database,
+                           std::string const & sql,
+                           int column) const
+    {
+        sqlite3 * handle = database.getDatabase()->getHandle();
+
+        // ==================================================
+        // Open a transaction unless the caller already has one
+        // --------------------------------------------------
+        const bool owner = sqlite3_get_autocommit(handle) != 0;
+        if (owner && sqlite3_exec(handle, "BEGIN", 0, 0, 0) != SQLITE_OK)
+        {
+            fail(handle, 0, false);
+        }
+
+        sqlite3_stmt * statement = 0;
+        if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &statement, 0) !=
+            SQLITE_OK)
+        {
+            fail(handle, statement, owner);
+        }
+
+        // ==================================================
+        // Bind records in place and step
+        // --------------------------------------------------
+        const unsigned char * p = this->get();
+        for (int i = 0; i < this->_count; i++, p += this->_record)
+        {
+            if (sqlite3_bind_blob(statement,
+                                  column,
+                                  p,
+                                  this->_record,
+                                  SQLITE_STATIC) != SQLITE_OK)
+            {
+                fail(handle, statement, owner);
+            }
+            if (sqlite3_step(statement) != SQLITE_DONE)
+            {
+                fail(handle, statement, owner);
+            }
+            sqlite3_reset(statement);
+        }
+        sqlite3_finalize(statement);
+
+        if (owner && sqlite3_exec(handle, "COMMIT", 0, 0, 0) != SQLITE_OK)
+        {
+            fail(handle, 0, true);
+        }
+        return this->_count;
+    }
+
+}
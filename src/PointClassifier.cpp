@@ -0,0 +1,517 @@
+/**
+ * @file    PointClassifier.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main PointClassifier class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/PointClassifier.h"
+
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/Measure.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || \
+    defined(_M_X64) || defined(_M_IX86)
+    #define SPATIALITECPP_X86 1
+    #include <emmintrin.h>
+    #include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define SPATIALITECPP_TARGET(x) __attribute__((target(x)))
+#else
+    #define SPATIALITECPP_TARGET(x)
+#endif
+
+namespace
+{
+
+    /**
+     * @brief Polygon edge
+     */
+    struct Edge
+    {
+        double x0, y0, x1, y1;
+    };
+
+    /// Counts the edges crossed by the ray from (px, py) towards +x
+    typedef int (*Crossings)(const double * x0,
+                             const double * y0,
+                             const double * y1,
+                             const double * slope,
+                             int n,
+                             double px,
+                             double py);
+
+    // Number of set bits of a 4-bit movemask
+    const int MASK_BITS[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+    // Points per thread below which classification stays on one thread
+    const size_t MIN_CHUNK = 4096;
+
+    // ==================================================
+    // Crossing kernels. An edge is crossed when it spans
+    // py (half-open) and its x at py is right of px.
+    // --------------------------------------------------
+
+    int crossingsScalar(const double * x0,
+                        const double * y0,
+                        const double * y1,
+                        const double * slope,
+                        int n,
+                        double px,
+                        double py)
+    {
+        int count = 0;
+        for (int i = 0; i < n; i++)
+        {
+            double xi = x0[i] + (py - y0[i]) * slope[i];
+            count += ((y0[i] > py) != (y1[i] > py)) & (px < xi);
+        }
+        return count;
+    }
+
+#ifdef SPATIALITECPP_X86
+
+    SPATIALITECPP_TARGET("sse2")
+    int crossingsSse2(const double * x0,
+                      const double * y0,
+                      const double * y1,
+                      const double * slope,
+                      int n,
+                      double px,
+                      double py)
+    {
+        const __m128d vx = _mm_set1_pd(px);
+        const __m128d vy = _mm_set1_pd(py);
+        int count = 0;
+        int i = 0;
+        for (; i + 2 <= n; i += 2)
+        {
+            __m128d a = _mm_loadu_pd(y0 + i);
+            __m128d span = _mm_xor_pd(_mm_cmpgt_pd(a, vy),
+                                      _mm_cmpgt_pd(_mm_loadu_pd(y1 + i), vy));
+            __m128d xi = _mm_add_pd(_mm_loadu_pd(x0 + i),
+                                    _mm_mul_pd(_mm_sub_pd(vy, a),
+                                               _mm_loadu_pd(slope + i)));
+            __m128d hit = _mm_and_pd(span, _mm_cmplt_pd(vx, xi));
+            count += MASK_BITS[_mm_movemask_pd(hit)];
+        }
+        return count + crossingsScalar(x0 + i, y0 + i, y1 + i, slope + i,
+                                       n - i, px, py);
+    }
+
+    SPATIALITECPP_TARGET("avx2")
+    int crossingsAvx2(const double * x0,
+                      const double * y0,
+                      const double * y1,
+                      const double * slope,
+                      int n,
+                      double px,
+                      double py)
+    {
+        const __m256d vx = _mm256_set1_pd(px);
+        const __m256d vy = _mm256_set1_pd(py);
+        int count = 0;
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d a = _mm256_loadu_pd(y0 + i);
+            __m256d span = _mm256_xor_pd(
+                _mm256_cmp_pd(a, vy, _CMP_GT_OQ),
+                _mm256_cmp_pd(_mm256_loadu_pd(y1 + i), vy, _CMP_GT_OQ));
+            __m256d xi = _mm256_add_pd(_mm256_loadu_pd(x0 + i),
+                                       _mm256_mul_pd(_mm256_sub_pd(vy, a),
+                                                     _mm256_loadu_pd(slope + i)));
+            __m256d hit = _mm256_and_pd(span,
+                                        _mm256_cmp_pd(vx, xi, _CMP_LT_OQ));
+            count += MASK_BITS[_mm256_movemask_pd(hit)];
+        }
+        return count + crossingsScalar(x0 + i, y0 + i, y1 + i, slope + i,
+                                       n - i, px, py);
+    }
+
+#endif
+
+    /**
+     * @brief Selects the kernel matching the Measure instruction set
+     */
+    Crossings getCrossings()
+    {
+#ifdef SPATIALITECPP_X86
+        const int set = SpatiaLite::Measure::getInstructionSet();
+        if (set == SpatiaLite::Measure::AVX2) return crossingsAvx2;
+        if (set == SpatiaLite::Measure::SSE2) return crossingsSse2;
+#endif
+        return crossingsScalar;
+    }
+
+    /**
+     * @brief Appends the edges of a ring, closing it if needed
+     */
+    void addRing(std::vector<Edge> & edges, gaiaRingPtr ring)
+    {
+        if (!ring || ring->Points < 2) return;
+        const int stride = SpatiaLite::CoordinateBuffer::getStride(
+            ring->DimensionModel);
+        const double * coords = ring->Coords;
+        const double * last = coords + (size_t)(ring->Points - 1) * stride;
+        for (int i = 0; i + 1 < ring->Points; i++)
+        {
+            const double * a = coords + (size_t)i * stride;
+            const double * b = a + stride;
+            Edge edge = {a[0], a[1], b[0], b[1]};
+            edges.push_back(edge);
+        }
+        if (last[0] != coords[0] || last[1] != coords[1])
+        {
+            Edge edge = {last[0], last[1], coords[0], coords[1]};
+            edges.push_back(edge);
+        }
+    }
+
+    /**
+     * @brief Maps a coordinate to a grid index
+     */
+    int toIndex(double value, double origin, double size, int resolution)
+    {
+        double index = std::floor((value - origin) / size);
+        if (index < 0) return 0;
+        if (index >= resolution) return resolution - 1;
+        return (int)index;
+    }
+
+}
+
+namespace SpatiaLite
+{
+
+    PointClassifier::PointClassifier(std::vector<gaiaGeomCollPtr> const & zones,
+                                     int resolution) :
+        _cells(),
+        _cellHeight(1),
+        _cellWidth(1),
+        _crossings(getCrossings()),
+        _edgeSlope(),
+        _edgeX0(),
+        _edgeY0(),
+        _edgeY1(),
+        _edges(0),
+        _ids(),
+        _maxx(0),
+        _maxy(0),
+        _minx(0),
+        _miny(0),
+        _resolution(0),
+        _rowRuns(),
+        _runs()
+    {
+        for (size_t i = 0; i < zones.size(); i++)
+        {
+            this->_ids.push_back((int)i);
+        }
+        this->build(zones, resolution);
+    }
+
+    PointClassifier::PointClassifier(std::vector<gaiaGeomCollPtr> const & zones,
+                                     std::vector<int> const & ids,
+                                     int resolution) :
+        _cells(),
+        _cellHeight(1),
+        _cellWidth(1),
+        _crossings(getCrossings()),
+        _edgeSlope(),
+        _edgeX0(),
+        _edgeY0(),
+        _edgeY1(),
+        _edges(0),
+        _ids(ids),
+        _maxx(0),
+        _maxy(0),
+        _minx(0),
+        _miny(0),
+        _resolution(0),
+        _rowRuns(),
+        _runs()
+    {
+        if (ids.size() != zones.size())
+        {
+            throw std::runtime_error("Zone and identifier counts differ!");
+        }
+        this->build(zones, resolution);
+    }
+
+    PointClassifier::~PointClassifier()
+    {
+    }
+
+    void PointClassifier::build(std::vector<gaiaGeomCollPtr> const & zones,
+                                int resolution)
+    {
+        if (resolution < 0) throw std::runtime_error("Invalid resolution!");
+
+        // ==================================================
+        // Gather the ring edges of every zone
+        // --------------------------------------------------
+        std::vector<std::vector<Edge> > edges(zones.size());
+        for (size_t z = 0; z < zones.size(); z++)
+        {
+            if (!zones[z]) throw std::runtime_error("Invalid geometry!");
+            for (gaiaPolygonPtr p = zones[z]->FirstPolygon; p; p = p->Next)
+            {
+                addRing(edges[z], p->Exterior);
+                for (int i = 0; i < p->NumInteriors; i++)
+                {
+                    addRing(edges[z], p->Interiors + i);
+                }
+            }
+            this->_edges += (int)edges[z].size();
+        }
+        if (this->_edges == 0) return;
+
+        this->_minx = DBL_MAX;
+        this->_miny = DBL_MAX;
+        this->_maxx = -DBL_MAX;
+        this->_maxy = -DBL_MAX;
+        for (size_t z = 0; z < edges.size(); z++)
+        {
+            for (size_t i = 0; i < edges[z].size(); i++)
+            {
+                Edge const & e = edges[z][i];
+                this->_minx = std::min(this->_minx, std::min(e.x0, e.x1));
+                this->_miny = std::min(this->_miny, std::min(e.y0, e.y1));
+                this->_maxx = std::max(this->_maxx, std::max(e.x0, e.x1));
+                this->_maxy = std::max(this->_maxy, std::max(e.y0, e.y1));
+            }
+        }
+
+        // ==================================================
+        // Size the grid
+        // --------------------------------------------------
+        if (resolution == 0)
+        {
+            resolution = (int)std::ceil(std::sqrt((double)this->_edges));
+            resolution = std::max(1, std::min(resolution, 1024));
+        }
+        const int res = resolution;
+        this->_resolution = res;
+        this->_cellWidth = (this->_maxx - this->_minx) / res;
+        this->_cellHeight = (this->_maxy - this->_miny) / res;
+        if (!(this->_cellWidth > 0)) this->_cellWidth = 1;
+        if (!(this->_cellHeight > 0)) this->_cellHeight = 1;
+        const double w = this->_cellWidth;
+        const double h = this->_cellHeight;
+        this->_cells.assign((size_t)res * res, -1);
+
+        // ==================================================
+        // Bucket the edges into rows and mark the cells they
+        // may cross as mixed
+        // --------------------------------------------------
+        std::vector<std::vector<std::pair<int, Edge> > > rows(res);
+        for (size_t z = 0; z < edges.size(); z++)
+        {
+            for (size_t i = 0; i < edges[z].size(); i++)
+            {
+                Edge const & e = edges[z][i];
+                const double ylo = std::min(e.y0, e.y1);
+                const double yhi = std::max(e.y0, e.y1);
+                const int r0 = toIndex(ylo, this->_miny, h, res);
+                const int r1 = toIndex(yhi, this->_miny, h, res);
+                for (int r = r0; r <= r1; r++)
+                {
+                    if (e.y0 != e.y1)
+                    {
+                        rows[r].push_back(std::make_pair((int)z, e));
+                    }
+
+                    // Clip to the row widened by half a cell
+                    double xa = e.x0;
+                    double xb = e.x1;
+                    if (e.y0 != e.y1)
+                    {
+                        double band0 = this->_miny + (r - 0.5) * h;
+                        double band1 = this->_miny + (r + 1.5) * h;
+                        double ya = std::max(ylo, band0);
+                        double yb = std::min(yhi, band1);
+                        double dxdy = (e.x1 - e.x0) / (e.y1 - e.y0);
+                        xa = e.x0 + (ya - e.y0) * dxdy;
+                        xb = e.x0 + (yb - e.y0) * dxdy;
+                    }
+                    int c0 = toIndex(std::min(xa, xb), this->_minx, w, res);
+                    int c1 = toIndex(std::max(xa, xb), this->_minx, w, res);
+                    c0 = std::max(0, c0 - 1);
+                    c1 = std::min(res - 1, c1 + 1);
+                    for (int c = c0; c <= c1; c++)
+                    {
+                        this->_cells[(size_t)r * res + c] = -2;
+                    }
+                }
+            }
+        }
+
+        // ==================================================
+        // Flatten the rows into per-zone runs of SoA edges
+        // --------------------------------------------------
+        this->_rowRuns.push_back(0);
+        for (int r = 0; r < res; r++)
+        {
+            std::vector<std::pair<int, Edge> > const & row = rows[r];
+            for (size_t i = 0; i < row.size(); i++)
+            {
+                Edge const & e = row[i].second;
+                if (i == 0 || row[i].first != row[i - 1].first)
+                {
+                    Run run;
+                    run.zone = row[i].first;
+                    run.begin = (int)this->_edgeX0.size();
+                    run.end = run.begin;
+                    run.maxx = -DBL_MAX;
+                    this->_runs.push_back(run);
+                }
+                Run & run = this->_runs.back();
+                run.end++;
+                run.maxx = std::max(run.maxx, std::max(e.x0, e.x1));
+                this->_edgeX0.push_back(e.x0);
+                this->_edgeY0.push_back(e.y0);
+                this->_edgeY1.push_back(e.y1);
+                this->_edgeSlope.push_back((e.x1 - e.x0) / (e.y1 - e.y0));
+            }
+            this->_rowRuns.push_back((int)this->_runs.size());
+        }
+
+        // ==================================================
+        // Resolve the cells crossed by no edge at their center
+        // --------------------------------------------------
+        for (int r = 0; r < res; r++)
+        {
+            for (int c = 0; c < res; c++)
+            {
+                int & cell = this->_cells[(size_t)r * res + c];
+                if (cell == -2) continue;
+                cell = this->locate(this->_minx + (c + 0.5) * w,
+                                    this->_miny + (r + 0.5) * h,
+                                    r);
+            }
+        }
+    }
+
+    int PointClassifier::classify(double x, double y) const
+    {
+        if (this->_cells.empty()) return -1;
+        if (!(x >= this->_minx && x <= this->_maxx &&
+              y >= this->_miny && y <= this->_maxy))
+        {
+            return -1;
+        }
+        const int res = this->_resolution;
+        const int r = toIndex(y, this->_miny, this->_cellHeight, res);
+        const int c = toIndex(x, this->_minx, this->_cellWidth, res);
+        int zone = this->_cells[(size_t)r * res + c];
+        if (zone == -2) zone = this->locate(x, y, r);
+        return zone < 0 ? -1 : this->_ids[zone];
+    }
+
+    std::vector<int> PointClassifier::classify(const double * x,
+                                               const double * y,
+                                               size_t count,
+                                               int threads) const
+    {
+        std::vector<int> zones(count, -1);
+        if (count == 0) return zones;
+        if (!x || !y) throw std::runtime_error("Invalid coordinates!");
+        if (threads < 0) throw std::runtime_error("Invalid thread count!");
+        if (threads == 0) threads = (int)std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+
+        // ==================================================
+        // Split into chunks, the calling thread taking the last
+        // --------------------------------------------------
+        size_t chunks = std::min((size_t)threads,
+                                 (count + MIN_CHUNK - 1) / MIN_CHUNK);
+        if (chunks < 1) chunks = 1;
+        const size_t chunk = (count + chunks - 1) / chunks;
+        int * out = &zones[0];
+        std::vector<std::thread> workers;
+        for (size_t begin = 0; begin < count; begin += chunk)
+        {
+            const size_t end = std::min(count, begin + chunk);
+            if (end == count)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    out[i] = this->classify(x[i], y[i]);
+                }
+            }
+            else
+            {
+                workers.push_back(std::thread([this, x, y, out, begin, end]() {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        out[i] = this->classify(x[i], y[i]);
+                    }
+                }));
+            }
+        }
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+        return zones;
+    }
+
+    std::vector<int> PointClassifier::classify(CoordinateBuffer const & points,
+                                               int threads) const
+    {
+        return this->classify(points.getX(),
+                              points.getY(),
+                              (size_t)points.getSize(),
+                              threads);
+    }
+
+    int PointClassifier::getEdgeCount() const
+    {
+        return this->_edges;
+    }
+
+    double PointClassifier::getMixedRatio() const
+    {
+        if (this->_cells.empty()) return 0;
+        size_t mixed = std::count(this->_cells.begin(), this->_cells.end(), -2);
+        return (double)mixed / this->_cells.size();
+    }
+
+    int PointClassifier::getResolution() const
+    {
+        return this->_resolution;
+    }
+
+    int PointClassifier::getZoneCount() const
+    {
+        return (int)this->_ids.size();
+    }
+
+    int PointClassifier::locate(double x, double y, int row) const
+    {
+        Crossings crossings = this->_crossings;
+        for (int k = this->_rowRuns[row]; k < this->_rowRuns[row + 1]; k++)
+        {
+            Run const & run = this->_runs[k];
+            if (x >= run.maxx) continue;
+            int n = crossings(&this->_edgeX0[run.begin],
+                              &this->_edgeY0[run.begin],
+                              &this->_edgeY1[run.begin],
+                              &this->_edgeSlope[run.begin],
+                              run.end - run.begin,
+                              x,
+                              y);
+            if (n & 1) return run.zone;
+        }
+        return -1;
+    }
+
+}
@@ -0,0 +1,295 @@
+/**
+ * @file    PreparedGeometry.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main PreparedGeometry class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/PreparedGeometry.h"
+
+#include "geos_c.h"
+
+#include <mutex>
+#include <stdexcept>
+
+namespace SpatiaLite
+{
+
+    struct PreparedGeometry::State
+    {
+        GEOSContextHandle_t handle;             ///< Reentrant GEOS context
+        GEOSWKBReader * reader;                 ///< Candidate reader
+        GEOSGeometry * geometry;                ///< Prepared source
+        const GEOSPreparedGeometry * prepared;  ///< Prepared state
+
+        ~State()
+        {
+            GEOSPreparedGeom_destroy_r(this->handle, this->prepared);
+            GEOSGeom_destroy_r(this->handle, this->geometry);
+            GEOSWKBReader_destroy_r(this->handle, this->reader);
+            GEOS_finish_r(this->handle);
+        }
+    };
+
+    struct PreparedGeometry::Pool
+    {
+        std::mutex mutex;               ///< Guards the fields below
+        std::vector<State *> idle;      ///< States no thread holds
+        int created;                    ///< States prepared so far
+        bool closed;                    ///< Object destroyed
+
+        Pool() :
+            created(0),
+            closed(false)
+        {
+        }
+
+        ~Pool()
+        {
+            for (size_t i = 0; i < this->idle.size(); i++) delete this->idle[i];
+        }
+
+        /**
+         * @brief Takes back a state from a thread
+         */
+        void release(State * state)
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                if (!this->closed)
+                {
+                    this->idle.push_back(state);
+                    return;
+                }
+            }
+            delete state;
+        }
+    };
+
+    struct PreparedGeometry::Cache
+    {
+        static const int SIZE = 4;      ///< Objects held per thread
+
+        std::shared_ptr<Pool> pools[SIZE];  ///< Pools, most recent first
+        State * states[SIZE];               ///< State taken from each pool
+
+        ~Cache()
+        {
+            for (int i = 0; i < SIZE; i++)
+            {
+                if (this->pools[i]) this->pools[i]->release(this->states[i]);
+            }
+        }
+    };
+
+    namespace
+    {
+
+        /**
+         * @brief Converts a gaia geometry with a thread's GEOS context
+         */
+        GEOSGeometry * toGeos(GEOSContextHandle_t handle,
+                              GEOSWKBReader * reader,
+                              gaiaGeomCollPtr geometry)
+        {
+            if (!geometry) throw std::runtime_error("Invalid geometry!");
+            unsigned char * wkb = 0;
+            int size = 0;
+            gaiaToWkb(geometry, &wkb, &size);
+            if (!wkb) throw std::runtime_error("Failed to convert geometry!");
+            GEOSGeometry * converted =
+                GEOSWKBReader_read_r(handle, reader, wkb, size);
+            gaiaFree(wkb);
+            if (!converted) throw std::runtime_error("Failed to convert geometry!");
+            return converted;
+        }
+
+        /**
+         * @brief Calls the GEOS prepared predicate
+         * @returns 0, 1 or 2 on GEOS exception
+         */
+        char evaluatePrepared(int predicate,
+                              GEOSContextHandle_t handle,
+                              const GEOSPreparedGeometry * prepared,
+                              const GEOSGeometry * candidate)
+        {
+            switch (predicate)
+            {
+            case PreparedGeometry::CONTAINS:
+                return GEOSPreparedContains_r(handle, prepared, candidate);
+            case PreparedGeometry::CONTAINS_PROPERLY:
+                return GEOSPreparedContainsProperly_r(handle, prepared, candidate);
+            case PreparedGeometry::COVERED_BY:
+                return GEOSPreparedCoveredBy_r(handle, prepared, candidate);
+            case PreparedGeometry::COVERS:
+                return GEOSPreparedCovers_r(handle, prepared, candidate);
+            case PreparedGeometry::CROSSES:
+                return GEOSPreparedCrosses_r(handle, prepared, candidate);
+            case PreparedGeometry::DISJOINT:
+                return GEOSPreparedDisjoint_r(handle, prepared, candidate);
+            case PreparedGeometry::INTERSECTS:
+                return GEOSPreparedIntersects_r(handle, prepared, candidate);
+            case PreparedGeometry::OVERLAPS:
+                return GEOSPreparedOverlaps_r(handle, prepared, candidate);
+            case PreparedGeometry::TOUCHES:
+                return GEOSPreparedTouches_r(handle, prepared, candidate);
+            case PreparedGeometry::WITHIN:
+                return GEOSPreparedWithin_r(handle, prepared, candidate);
+            default:
+                return 2;
+            }
+        }
+
+    }
+
+    PreparedGeometry::PreparedGeometry(gaiaGeomCollPtr geometry) :
+        _pool(new Pool()),
+        _wkb()
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        unsigned char * wkb = 0;
+        int size = 0;
+        gaiaToWkb(geometry, &wkb, &size);
+        if (!wkb) throw std::runtime_error("Failed to convert geometry!");
+        this->_wkb.assign(wkb, wkb + size);
+        gaiaFree(wkb);
+    }
+
+    PreparedGeometry::~PreparedGeometry()
+    {
+        std::vector<State *> idle;
+        {
+            std::lock_guard<std::mutex> lock(this->_pool->mutex);
+            this->_pool->closed = true;
+            idle.swap(this->_pool->idle);
+        }
+        for (size_t i = 0; i < idle.size(); i++) delete idle[i];
+    }
+
+    bool PreparedGeometry::contains(gaiaGeomCollPtr candidate) const
+    {
+        return this->evaluate(PreparedGeometry::CONTAINS, candidate);
+    }
+
+    bool PreparedGeometry::covers(gaiaGeomCollPtr candidate) const
+    {
+        return this->evaluate(PreparedGeometry::COVERS, candidate);
+    }
+
+    bool PreparedGeometry::evaluate(int predicate,
+                                    gaiaGeomCollPtr candidate) const
+    {
+        if (predicate < PreparedGeometry::CONTAINS ||
+            predicate > PreparedGeometry::WITHIN)
+        {
+            throw std::runtime_error("Invalid predicate!");
+        }
+        State * state = this->getState();
+        GEOSGeometry * geometry =
+            toGeos(state->handle, state->reader, candidate);
+        char result = evaluatePrepared(predicate,
+                                       state->handle,
+                                       state->prepared,
+                                       geometry);
+        GEOSGeom_destroy_r(state->handle, geometry);
+        if (result == 2) throw std::runtime_error("Failed to evaluate predicate!");
+        return result == 1;
+    }
+
+    std::vector<bool> PreparedGeometry::evaluate(
+        int predicate,
+        std::vector<gaiaGeomCollPtr> const & candidates) const
+    {
+        std::vector<bool> results(candidates.size());
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            results[i] = this->evaluate(predicate, candidates[i]);
+        }
+        return results;
+    }
+
+    PreparedGeometry::State * PreparedGeometry::getState() const
+    {
+        // The cached pools are kept alive, so their addresses are unique
+        static thread_local Cache cache;
+        for (int i = 0; i < Cache::SIZE; i++)
+        {
+            if (cache.pools[i] == this->_pool) return cache.states[i];
+        }
+
+        // ==================================================
+        // First use on this thread: reuse an idle state if any
+        // --------------------------------------------------
+        State * state = 0;
+        {
+            std::lock_guard<std::mutex> lock(this->_pool->mutex);
+            if (!this->_pool->idle.empty())
+            {
+                state = this->_pool->idle.back();
+                this->_pool->idle.pop_back();
+            }
+        }
+        if (!state) state = this->prepare();
+
+        // Hand the oldest entry back to its pool
+        const int last = Cache::SIZE - 1;
+        if (cache.pools[last]) cache.pools[last]->release(cache.states[last]);
+        for (int i = last; i > 0; i--)
+        {
+            cache.pools[i].swap(cache.pools[i - 1]);
+            cache.states[i] = cache.states[i - 1];
+        }
+        cache.pools[0] = this->_pool;
+        cache.states[0] = state;
+        return state;
+    }
+
+    int PreparedGeometry::getThreadCount() const
+    {
+        std::lock_guard<std::mutex> lock(this->_pool->mutex);
+        return this->_pool->created;
+    }
+
+    bool PreparedGeometry::intersects(gaiaGeomCollPtr candidate) const
+    {
+        return this->evaluate(PreparedGeometry::INTERSECTS, candidate);
+    }
+
+    PreparedGeometry::State * PreparedGeometry::prepare() const
+    {
+        GEOSContextHandle_t handle = GEOS_init_r();
+        if (!handle) throw std::runtime_error("Failed to create GEOS context!");
+        GEOSWKBReader * reader = GEOSWKBReader_create_r(handle);
+        GEOSGeometry * geometry = reader ? GEOSWKBReader_read_r(
+            handle, reader, &this->_wkb[0], this->_wkb.size()) : 0;
+        const GEOSPreparedGeometry * prepared =
+            geometry ? GEOSPrepare_r(handle, geometry) : 0;
+        if (!prepared)
+        {
+            if (geometry) GEOSGeom_destroy_r(handle, geometry);
+            if (reader) GEOSWKBReader_destroy_r(handle, reader);
+            GEOS_finish_r(handle);
+            throw std::runtime_error("Failed to prepare geometry!");
+        }
+        State * state = new State();
+        state->handle = handle;
+        state->reader = reader;
+        state->geometry = geometry;
+        state->prepared = prepared;
+        std::lock_guard<std::mutex> lock(this->_pool->mutex);
+        this->_pool->created++;
+        return state;
+    }
+
+    bool PreparedGeometry::touches(gaiaGeomCollPtr candidate) const
+    {
+        return this->evaluate(PreparedGeometry::TOUCHES, candidate);
+    }
+
+    bool PreparedGeometry::within(gaiaGeomCollPtr candidate) const
+    {
+        return this->evaluate(PreparedGeometry::WITHIN, candidate);
+    }
+
+}
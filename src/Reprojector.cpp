@@ -0,0 +1,429 @@
+/**
+ * @file    Reprojector.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main Reprojector class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/Reprojector.h"
+
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/GeometryCollection.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include "proj.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace SpatiaLite
+{
+
+    struct Reprojector::Worker
+    {
+        PJ_CONTEXT * context;       ///< Worker's own PROJ context
+        PJ * transformation;        ///< Transformation in that context
+
+        Worker(std::string const & source, std::string const & target) :
+            context(proj_context_create()),
+            transformation(0)
+        {
+            PJ * created = this->context ?
+                proj_create_crs_to_crs(this->context,
+                                       source.c_str(),
+                                       target.c_str(),
+                                       0) : 0;
+            if (created)
+            {
+                // Keep longitude, latitude order whatever the authority says
+                this->transformation =
+                    proj_normalize_for_visualization(this->context, created);
+                proj_destroy(created);
+            }
+            if (!this->transformation)
+            {
+                if (this->context) proj_context_destroy(this->context);
+                throw std::runtime_error("Failed to create transformation!");
+            }
+        }
+
+        ~Worker()
+        {
+            proj_destroy(this->transformation);
+            proj_context_destroy(this->context);
+        }
+    };
+
+    struct Reprojector::Checkout
+    {
+        Reprojector & owner;        ///< Pool the worker returns to
+        Worker * worker;            ///< Checked out worker, null without PROJ
+
+        explicit Checkout(Reprojector & owner) :
+            owner(owner),
+            worker(0)
+        {
+            if (owner._kind != PROJ) return;
+            {
+                std::lock_guard<std::mutex> lock(owner._mutex);
+                if (!owner._idle.empty())
+                {
+                    this->worker = owner._idle.back();
+                    owner._idle.pop_back();
+                    return;
+                }
+            }
+
+            // Every worker is busy with a concurrent call, add one
+            std::unique_ptr<Worker> created(new Worker(owner._source,
+                                                       owner._target));
+            std::lock_guard<std::mutex> lock(owner._mutex);
+            owner._workers.push_back(created.get());
+            owner._idle.reserve(owner._workers.size());
+            this->worker = created.release();
+        }
+
+        ~Checkout()
+        {
+            if (!this->worker) return;
+            std::lock_guard<std::mutex> lock(this->owner._mutex);
+            this->owner._idle.push_back(this->worker);
+        }
+    };
+
+    namespace
+    {
+
+        const double PI = 3.14159265358979323846;
+        const double RADIANS = PI / 180;
+        const double RADIUS = 6378137;
+
+        /**
+         * @brief Distance from the poles, in radians, that PROJ rejects
+         */
+        const double POLE_TOLERANCE = 1e-10;
+
+        /**
+         * @returns proj4text of an SRID
+         */
+        std::string getDefinition(SQLite::Database & database, int srid)
+        {
+            SQLite::Statement query(database,
+                                    "SELECT proj4text FROM spatial_ref_sys "
+                                    "WHERE srid = ?");
+            query.bind(1, srid);
+            if (!query.executeStep() || query.isColumnNull(0))
+            {
+                throw std::runtime_error("SRID not found!");
+            }
+            return query.getColumn(0).getText();
+        }
+
+        /**
+         * @brief Converts degrees to Web Mercator
+         * @details Like PROJ, latitudes at or beyond the poles are outside
+         *          the domain and set both coordinates to HUGE_VAL.
+         */
+        void toMercator(double * x, double * y, int stride, size_t count)
+        {
+            for (size_t i = 0; i < count; i++, x += stride, y += stride)
+            {
+                const double latitude = *y * RADIANS;
+                if (!(std::fabs(latitude) < PI / 2 - POLE_TOLERANCE))
+                {
+                    *x = HUGE_VAL;
+                    *y = HUGE_VAL;
+                    continue;
+                }
+                *x = RADIUS * RADIANS * *x;
+                *y = RADIUS * std::log(std::tan(PI / 4 + latitude / 2));
+            }
+        }
+
+        /**
+         * @brief Converts Web Mercator to degrees
+         */
+        void fromMercator(double * x, double * y, int stride, size_t count)
+        {
+            for (size_t i = 0; i < count; i++, x += stride, y += stride)
+            {
+                *x = *x / (RADIUS * RADIANS);
+                *y = (2 * std::atan(std::exp(*y / RADIUS)) - PI / 2) / RADIANS;
+            }
+        }
+
+        /**
+         * @brief Runs chunks of a range on up to a number of threads
+         * @param[in] count     Range size
+         * @param[in] chunkSize Items per chunk
+         * @param[in] threads   Maximum number of threads
+         * @param[in] function  Called with a subrange
+         * @throws std::runtime_error if any chunk fails
+         */
+        void dispatch(size_t count,
+                      size_t chunkSize,
+                      size_t threads,
+                      std::function<void(size_t, size_t)> const & function)
+        {
+            const size_t chunks = (count + chunkSize - 1) / chunkSize;
+            if (chunks <= 1 || threads <= 1)
+            {
+                if (count > 0) function(0, count);
+                return;
+            }
+            if (threads > chunks) threads = chunks;
+
+            std::atomic<size_t> next(0);
+            std::mutex mutex;
+            std::string error;
+            bool failed = false;
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; t++)
+            {
+                workers.push_back(std::thread([&]()
+                {
+                    try
+                    {
+                        for (size_t chunk = next++; chunk < chunks; chunk = next++)
+                        {
+                            const size_t begin = chunk * chunkSize;
+                            const size_t end = std::min(count, begin + chunkSize);
+                            function(begin, end);
+                        }
+                    }
+                    catch (std::exception & e)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!failed) error = e.what();
+                        failed = true;
+                        next = chunks;
+                    }
+                }));
+            }
+            for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+            if (failed) throw std::runtime_error(error);
+        }
+
+    }
+
+    Reprojector::Reprojector(SpatialDatabase const & database,
+                             int sourceSrid,
+                             int targetSrid,
+                             int threads,
+                             int chunkSize) :
+        _chunkSize(chunkSize),
+        _idle(),
+        _kind(PROJ),
+        _mutex(),
+        _source(),
+        _sourceSrid(sourceSrid),
+        _target(),
+        _targetSrid(targetSrid),
+        _threads(threads),
+        _workers()
+    {
+        if (threads < 0) throw std::runtime_error("Invalid thread count!");
+        if (chunkSize < 1) throw std::runtime_error("Invalid chunk size!");
+        if (this->_threads == 0)
+        {
+            this->_threads = (int)std::thread::hardware_concurrency();
+        }
+        if (this->_threads == 0) this->_threads = 1;
+
+        SQLite::Database & connection = *database.getDatabase();
+        this->_source = getDefinition(connection, sourceSrid);
+        this->_target = getDefinition(connection, targetSrid);
+        if (sourceSrid == targetSrid || this->_source == this->_target)
+        {
+            this->_kind = IDENTITY;
+            return;
+        }
+        if (sourceSrid == 4326 && targetSrid == 3857)
+        {
+            this->_kind = TO_MERCATOR;
+            return;
+        }
+        if (sourceSrid == 3857 && targetSrid == 4326)
+        {
+            this->_kind = FROM_MERCATOR;
+            return;
+        }
+
+        // ==================================================
+        // PROJ objects are not thread-safe, so each worker builds its own
+        // --------------------------------------------------
+        try
+        {
+            for (int i = 0; i < this->_threads; i++)
+            {
+                std::unique_ptr<Worker> worker(new Worker(this->_source,
+                                                          this->_target));
+                this->_workers.push_back(worker.get());
+                worker.release();
+            }
+        }
+        catch (...)
+        {
+            for (size_t i = 0; i < this->_workers.size(); i++)
+            {
+                delete this->_workers[i];
+            }
+            throw;
+        }
+        this->_idle = this->_workers;
+    }
+
+    Reprojector::~Reprojector()
+    {
+        for (size_t i = 0; i < this->_workers.size(); i++)
+        {
+            delete this->_workers[i];
+        }
+        this->_workers.clear();
+    }
+
+    int Reprojector::getChunkSize() const
+    {
+        return this->_chunkSize;
+    }
+
+    int Reprojector::getSourceSrid() const
+    {
+        return this->_sourceSrid;
+    }
+
+    int Reprojector::getTargetSrid() const
+    {
+        return this->_targetSrid;
+    }
+
+    int Reprojector::getThreadCount() const
+    {
+        return this->_threads;
+    }
+
+    void Reprojector::run(Worker * worker,
+                          double * x,
+                          double * y,
+                          double * z,
+                          int stride,
+                          size_t count)
+    {
+        switch (this->_kind)
+        {
+        case TO_MERCATOR:
+            toMercator(x, y, stride, count);
+            break;
+        case FROM_MERCATOR:
+            fromMercator(x, y, stride, count);
+            break;
+        case PROJ:
+        {
+            const size_t step = stride * sizeof(double);
+            PJ * transformation = worker->transformation;
+            proj_errno_reset(transformation);
+            const size_t done = proj_trans_generic(transformation,
+                                                   PJ_FWD,
+                                                   x, step, count,
+                                                   y, step, count,
+                                                   z, z ? step : 0, z ? count : 0,
+                                                   0, 0, 0);
+
+            // Points outside the domain are only set to HUGE_VAL
+            const int error = proj_errno(transformation);
+            if (done != count ||
+                (error != 0 && !(error & PROJ_ERR_COORD_TRANSFM)))
+            {
+                throw std::runtime_error("Failed to transform coordinates!");
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void Reprojector::run(Worker * worker, gaiaGeomCollPtr geometry)
+    {
+        const bool hasZ = geometry->DimensionModel == GAIA_XY_Z ||
+                          geometry->DimensionModel == GAIA_XY_Z_M;
+        for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+        {
+            this->run(worker, &p->X, &p->Y, hasZ ? &p->Z : 0, 1, 1);
+        }
+        for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+        {
+            this->run(worker, l->Coords, l->Coords + 1,
+                      hasZ ? l->Coords + 2 : 0,
+                      CoordinateBuffer::getStride(l->DimensionModel),
+                      l->Points);
+        }
+        for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+        {
+            for (int i = -1; i < p->NumInteriors; i++)
+            {
+                gaiaRingPtr r = i < 0 ? p->Exterior : p->Interiors + i;
+                this->run(worker, r->Coords, r->Coords + 1,
+                          hasZ ? r->Coords + 2 : 0,
+                          CoordinateBuffer::getStride(r->DimensionModel),
+                          r->Points);
+            }
+        }
+        geometry->Srid = this->_targetSrid;
+        if (this->_kind != IDENTITY) gaiaMbrGeometry(geometry);
+    }
+
+    void Reprojector::transform(double * x, double * y, double * z, size_t count)
+    {
+        if (this->_kind == IDENTITY) return;
+        dispatch(count, this->_chunkSize, this->_threads,
+                 [this, x, y, z](size_t begin, size_t end)
+                 {
+                     Checkout checkout(*this);
+                     this->run(checkout.worker, x + begin, y + begin,
+                               z ? z + begin : 0, 1, end - begin);
+                 });
+    }
+
+    void Reprojector::transform(CoordinateBuffer & buffer)
+    {
+        this->transform(buffer.getX(), buffer.getY(), buffer.getZ(),
+                        buffer.getSize());
+    }
+
+    void Reprojector::transform(gaiaGeomCollPtr geometry)
+    {
+        if (!geometry) throw std::runtime_error("Invalid geometry!");
+        Checkout checkout(*this);
+        this->run(checkout.worker, geometry);
+    }
+
+    void Reprojector::transform(GeometryCollection & geometry)
+    {
+        this->transform(geometry.get());
+    }
+
+    void Reprojector::transform(std::vector<gaiaGeomCollPtr> const & geometries)
+    {
+        dispatch(geometries.size(), this->_chunkSize, this->_threads,
+                 [this, &geometries](size_t begin, size_t end)
+                 {
+                     Checkout checkout(*this);
+                     for (size_t i = begin; i < end; i++)
+                     {
+                         if (geometries[i]) this->run(checkout.worker, geometries[i]);
+                     }
+                 });
+    }
+
+}
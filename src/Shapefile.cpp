@@ -16,4 +16,10 @@ namespace SpatiaLite
     {
     }
 
+    bool Shapefile::readEntity(int row, int srid)
+    {
+        if (!this->get() || !this->get()->Valid) return false;
+        return gaiaReadShpEntity(this->get(), row, srid) != 0;
+    }
+
 }
@@ -0,0 +1,471 @@
+/**
+ * @file    ShapefileIndex.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main ShapefileIndex class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/ShapefileIndex.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+namespace
+{
+
+    /**
+     * @brief Sidecar file signature (includes format version)
+     */
+    const char SIDECAR_MAGIC[4] = {'S', 'Q', 'X', '2'};
+
+    /**
+     * @brief Sidecar byte order mark. Sidecars are written in native order.
+     */
+    const int SIDECAR_ORDER = 0x01020304;
+
+    /**
+     * @brief Size of the .shp/.shx main file header
+     */
+    const int SHAPE_HEADER_SIZE = 100;
+
+    /**
+     * @brief Number of records a leaf is expected to hold
+     */
+    const int SHAPE_LEAF_SIZE = 8;
+
+    /**
+     * @brief Upper bound of the derived quadtree depth
+     */
+    const int SHAPE_MAX_DEPTH = 12;
+
+    /**
+     * @brief Quadtree node used while building the index
+     */
+    struct BuildNode
+    {
+        double bounds[4];
+        std::vector<int> ids;
+        int children[4];
+    };
+
+    int readBigInt32(const unsigned char * p)
+    {
+        return (int)(((unsigned int)p[0] << 24) |
+                     ((unsigned int)p[1] << 16) |
+                     ((unsigned int)p[2] << 8) |
+                      (unsigned int)p[3]);
+    }
+
+    int readLittleInt32(const unsigned char * p)
+    {
+        return (int)(((unsigned int)p[3] << 24) |
+                     ((unsigned int)p[2] << 16) |
+                     ((unsigned int)p[1] << 8) |
+                      (unsigned int)p[0]);
+    }
+
+    double readLittleDouble(const unsigned char * p)
+    {
+        unsigned long long bits = 0;
+        for (int i = 7; i >= 0; i--)
+        {
+            bits = (bits << 8) | p[i];
+        }
+        double value = 0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    long long getFileSize(std::string const & filename)
+    {
+        std::ifstream file(filename.c_str(),
+                           std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file) return -1;
+        return (long long)file.tellg();
+    }
+
+    long long getFileTime(std::string const & filename)
+    {
+#ifdef _WIN32
+        struct _stat64 info;
+        if (_stat64(filename.c_str(), &info) != 0) return -1;
+#else
+        struct stat info;
+        if (stat(filename.c_str(), &info) != 0) return -1;
+#endif
+        return (long long)info.st_mtime;
+    }
+
+    bool intersects(const double * a,
+                    double minx,
+                    double miny,
+                    double maxx,
+                    double maxy)
+    {
+        return !(a[0] > maxx || a[2] < minx || a[1] > maxy || a[3] < miny);
+    }
+
+    template <class T>
+    void writeValue(std::ofstream & file, T const & value)
+    {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <class T>
+    bool readValue(std::ifstream & file, T & value)
+    {
+        file.read(reinterpret_cast<char *>(&value), sizeof(T));
+        return file.good();
+    }
+
+    template <class T>
+    bool readArray(std::ifstream & file, std::vector<T> & values, int count)
+    {
+        if (count < 0) return false;
+        values.resize(count);
+        if (count == 0) return true;
+        file.read(reinterpret_cast<char *>(&values[0]), sizeof(T) * count);
+        return file.good();
+    }
+
+}
+
+namespace SpatiaLite
+{
+
+    ShapefileIndex::ShapefileIndex() :
+        _depth(0),
+        _size(0),
+        _time(0)
+    {
+    }
+
+    ShapefileIndex * ShapefileIndex::create(std::string const & path,
+                                            int depth)
+    {
+
+        // ==================================================
+        // Read record offsets from the .shx file
+        // --------------------------------------------------
+        std::string shxname = path + ".shx";
+        std::ifstream shx(shxname.c_str(), std::ios::in | std::ios::binary);
+        if (!shx) throw std::runtime_error("Failed to open shapefile index!");
+
+        std::vector<unsigned char> header(SHAPE_HEADER_SIZE);
+        shx.read(reinterpret_cast<char *>(&header[0]), SHAPE_HEADER_SIZE);
+        if (!shx) throw std::runtime_error("Invalid shapefile index!");
+        long long shxsize = (long long)readBigInt32(&header[24]) * 2;
+        int count = (int)((shxsize - SHAPE_HEADER_SIZE) / 8);
+        if (count < 0) throw std::runtime_error("Invalid shapefile index!");
+
+        std::vector<unsigned char> offsets(count * 8 + 1);
+        shx.read(reinterpret_cast<char *>(&offsets[0]), count * 8);
+        if (!shx) throw std::runtime_error("Truncated shapefile index!");
+
+        // ==================================================
+        // Read record MBRs from the .shp record headers
+        // --------------------------------------------------
+        std::string shpname = path + ".shp";
+        std::ifstream shp(shpname.c_str(), std::ios::in | std::ios::binary);
+        if (!shp) throw std::runtime_error("Failed to open shapefile!");
+
+        std::vector<double> bounds(count * 4, 0.0);
+        std::vector<bool> valid(count, false);
+        double extent[4] = {0, 0, 0, 0};
+        bool empty = true;
+        unsigned char record[36];
+        for (int i = 0; i < count; i++)
+        {
+            long long offset = (long long)readBigInt32(&offsets[i * 8]) * 2;
+            shp.seekg(offset + 8, std::ios::beg);
+            shp.read(reinterpret_cast<char *>(record), 4);
+            if (!shp) throw std::runtime_error("Truncated shapefile!");
+
+            int type = readLittleInt32(record);
+            double * mbr = &bounds[i * 4];
+            if (type == 0)
+            {
+                continue;
+            }
+            else if (type == 1 || type == 11 || type == 21)
+            {
+                shp.read(reinterpret_cast<char *>(record + 4), 16);
+                if (!shp) throw std::runtime_error("Truncated shapefile!");
+                mbr[0] = mbr[2] = readLittleDouble(record + 4);
+                mbr[1] = mbr[3] = readLittleDouble(record + 12);
+            }
+            else
+            {
+                shp.read(reinterpret_cast<char *>(record + 4), 32);
+                if (!shp) throw std::runtime_error("Truncated shapefile!");
+                for (int j = 0; j < 4; j++)
+                {
+                    mbr[j] = readLittleDouble(record + 4 + j * 8);
+                }
+            }
+            valid[i] = true;
+
+            if (empty)
+            {
+                std::copy(mbr, mbr + 4, extent);
+                empty = false;
+            }
+            extent[0] = std::min(extent[0], mbr[0]);
+            extent[1] = std::min(extent[1], mbr[1]);
+            extent[2] = std::max(extent[2], mbr[2]);
+            extent[3] = std::max(extent[3], mbr[3]);
+        }
+
+        // ==================================================
+        // Derive depth so that leaves hold a few records
+        // --------------------------------------------------
+        if (depth <= 0)
+        {
+            depth = 1;
+            long long leaves = 1;
+            while (depth < SHAPE_MAX_DEPTH &&
+                   leaves * SHAPE_LEAF_SIZE < count)
+            {
+                depth++;
+                leaves *= 4;
+            }
+        }
+
+        // ==================================================
+        // Insert each record into the deepest quadrant that
+        // fully contains its MBR
+        // --------------------------------------------------
+        std::vector<BuildNode> nodes(1);
+        std::copy(extent, extent + 4, nodes[0].bounds);
+        std::fill(nodes[0].children, nodes[0].children + 4, -1);
+        for (int i = 0; i < count; i++)
+        {
+            if (!valid[i]) continue;
+            const double * mbr = &bounds[i * 4];
+            int current = 0;
+            for (int level = 1; level < depth; level++)
+            {
+                const double * b = nodes[current].bounds;
+                double midx = (b[0] + b[2]) / 2;
+                double midy = (b[1] + b[3]) / 2;
+                int quadrant = -1;
+                if (mbr[2] <= midx && mbr[3] <= midy) quadrant = 0;
+                else if (mbr[0] >= midx && mbr[3] <= midy) quadrant = 1;
+                else if (mbr[2] <= midx && mbr[1] >= midy) quadrant = 2;
+                else if (mbr[0] >= midx && mbr[1] >= midy) quadrant = 3;
+                if (quadrant < 0) break;
+
+                int child = nodes[current].children[quadrant];
+                if (child < 0)
+                {
+                    BuildNode node;
+                    node.bounds[0] = (quadrant & 1) ? midx : b[0];
+                    node.bounds[1] = (quadrant & 2) ? midy : b[1];
+                    node.bounds[2] = (quadrant & 1) ? b[2] : midx;
+                    node.bounds[3] = (quadrant & 2) ? b[3] : midy;
+                    std::fill(node.children, node.children + 4, -1);
+                    child = (int)nodes.size();
+                    nodes[current].children[quadrant] = child;
+                    nodes.push_back(node);
+                }
+                current = child;
+            }
+            nodes[current].ids.push_back(i);
+        }
+
+        // ==================================================
+        // Flatten nodes and their record lists
+        // --------------------------------------------------
+        ShapefileIndex * index = new ShapefileIndex();
+        index->_depth = depth;
+        index->_size = getFileSize(shpname);
+        index->_time = getFileTime(shpname);
+        index->_bounds.swap(bounds);
+        index->_nodes.resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            Node & node = index->_nodes[i];
+            std::copy(nodes[i].bounds, nodes[i].bounds + 4, node.bounds);
+            std::copy(nodes[i].children, nodes[i].children + 4, node.children);
+            node.first = (int)index->_entries.size();
+            node.count = (int)nodes[i].ids.size();
+            index->_entries.insert(index->_entries.end(),
+                                   nodes[i].ids.begin(),
+                                   nodes[i].ids.end());
+        }
+
+        // The sidecar only saves rebuilding, so the index is still
+        // usable when it cannot be written (e.g. a read-only directory)
+        try
+        {
+            index->save(ShapefileIndex::getSidecar(path));
+        }
+        catch (std::exception &)
+        {
+        }
+
+        return index;
+
+    }
+
+    int ShapefileIndex::getCount() const
+    {
+        return (int)(this->_bounds.size() / 4);
+    }
+
+    int ShapefileIndex::getDepth() const
+    {
+        return this->_depth;
+    }
+
+    std::string ShapefileIndex::getSidecar(std::string const & path)
+    {
+        return path + ".sqx";
+    }
+
+    bool ShapefileIndex::load(std::string const & filename)
+    {
+        std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+        if (!file) return false;
+
+        char magic[4];
+        file.read(magic, 4);
+        if (!file || std::memcmp(magic, SIDECAR_MAGIC, 4) != 0) return false;
+
+        int order = 0;
+        int count = 0;
+        int numNodes = 0;
+        int numEntries = 0;
+        if (!readValue(file, order) || order != SIDECAR_ORDER) return false;
+        if (!readValue(file, this->_depth)) return false;
+        if (!readValue(file, this->_size)) return false;
+        if (!readValue(file, this->_time)) return false;
+        if (!readValue(file, count)) return false;
+        if (!readValue(file, numNodes)) return false;
+        if (!readValue(file, numEntries)) return false;
+
+        // The arrays must fill the rest of the file exactly
+        if (count < 0 || count > INT_MAX / 4 || numNodes < 0 || numEntries < 0 ||
+            getFileSize(filename) - (long long)file.tellg() !=
+                (long long)count * 4 * (long long)sizeof(double) +
+                (long long)numNodes * (long long)sizeof(Node) +
+                (long long)numEntries * (long long)sizeof(int))
+        {
+            return false;
+        }
+        if (!readArray(file, this->_bounds, count * 4)) return false;
+        if (!readArray(file, this->_nodes, numNodes)) return false;
+        if (!readArray(file, this->_entries, numEntries)) return false;
+
+        // Reject sidecars whose references are out of range. Children
+        // follow their parent and have no other parent, as create() lays
+        // them out, which also rules out cycles.
+        std::vector<char> referenced(this->_nodes.size(), 0);
+        for (size_t i = 0; i < this->_nodes.size(); i++)
+        {
+            Node const & node = this->_nodes[i];
+            if (node.first < 0 || node.count < 0 ||
+                node.count > numEntries - node.first) return false;
+            for (int j = 0; j < 4; j++)
+            {
+                const int child = node.children[j];
+                if (child < 0) continue;
+                if (child <= (int)i || child >= numNodes ||
+                    referenced[child]) return false;
+                referenced[child] = 1;
+            }
+        }
+        for (size_t i = 0; i < this->_entries.size(); i++)
+        {
+            if (this->_entries[i] < 0 ||
+                this->_entries[i] >= count) return false;
+        }
+        return true;
+    }
+
+    ShapefileIndex * ShapefileIndex::open(std::string const & path)
+    {
+        ShapefileIndex * index = new ShapefileIndex();
+        if (index->load(ShapefileIndex::getSidecar(path)) &&
+            index->_size == getFileSize(path + ".shp") &&
+            index->_time == getFileTime(path + ".shp"))
+        {
+            return index;
+        }
+        delete index;
+        return ShapefileIndex::create(path);
+    }
+
+    std::vector<int> ShapefileIndex::query(double minx,
+                                           double miny,
+                                           double maxx,
+                                           double maxy) const
+    {
+        std::vector<int> found;
+        if (this->_nodes.empty()) return found;
+
+        std::vector<int> pending(1, 0);
+        while (!pending.empty())
+        {
+            Node const & node = this->_nodes[pending.back()];
+            pending.pop_back();
+            if (!intersects(node.bounds, minx, miny, maxx, maxy)) continue;
+
+            for (int i = node.first; i < node.first + node.count; i++)
+            {
+                int record = this->_entries[i];
+                if (intersects(&this->_bounds[record * 4],
+                               minx, miny, maxx, maxy))
+                {
+                    found.push_back(record);
+                }
+            }
+            for (int i = 0; i < 4; i++)
+            {
+                if (node.children[i] >= 0) pending.push_back(node.children[i]);
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+
+    void ShapefileIndex::save(std::string const & filename) const
+    {
+        std::ofstream file(filename.c_str(),
+                           std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file) throw std::runtime_error("Failed to create index sidecar!");
+
+        file.write(SIDECAR_MAGIC, 4);
+        writeValue(file, SIDECAR_ORDER);
+        writeValue(file, this->_depth);
+        writeValue(file, this->_size);
+        writeValue(file, this->_time);
+        writeValue(file, this->getCount());
+        writeValue(file, (int)this->_nodes.size());
+        writeValue(file, (int)this->_entries.size());
+        if (!this->_bounds.empty())
+        {
+            file.write(reinterpret_cast<const char *>(&this->_bounds[0]),
+                       sizeof(double) * this->_bounds.size());
+        }
+        if (!this->_nodes.empty())
+        {
+            file.write(reinterpret_cast<const char *>(&this->_nodes[0]),
+                       sizeof(Node) * this->_nodes.size());
+        }
+        if (!this->_entries.empty())
+        {
+            file.write(reinterpret_cast<const char *>(&this->_entries[0]),
+                       sizeof(int) * this->_entries.size());
+        }
+        if (!file) throw std::runtime_error("Failed to write index sidecar!");
+    }
+
+}
@@ -8,18 +8,106 @@
 
 #include "SpatiaLiteCpp/SpatialDatabase.h"
 
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+#include "SpatiaLiteCpp/Measure.h"
+
 extern "C"
 {
 #include "spatialite.h"
+#include "spatialite/gaiageo.h"
 }
 
 #include "SQLiteCpp/SQLiteCpp.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <queue>
 #include <sstream>
+#include <stdexcept>
 
 namespace SpatiaLite
 {
 
+    namespace
+    {
+
+        /**
+         * @brief Last connection identifier handed out
+         */
+        std::atomic<sqlite3_int64> lastId(0);
+
+        // Search queue entry kinds
+        const int KNN_NODE = 0;
+        const int KNN_BOX = 1;
+        const int KNN_EXACT = 2;
+
+        /**
+         * @brief Best-first search queue entry
+         */
+        struct SearchEntry
+        {
+            double distance;     ///< Lower bound or exact distance
+            sqlite3_int64 id;    ///< Node number or row identifier
+            int kind;            ///< KNN_NODE, KNN_BOX or KNN_EXACT
+            int depth;           ///< Node height above the leaves
+
+            /**
+             * @returns True if this entry is popped after another
+             */
+            bool operator<(const SearchEntry & other) const
+            {
+                if (this->distance != other.distance)
+                {
+                    return this->distance > other.distance;
+                }
+                return this->kind < other.kind;
+            }
+        };
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Reads a big-endian integer of an R*Tree node
+         */
+        sqlite3_int64 readBigEndian(const unsigned char * p, int bytes)
+        {
+            sqlite3_int64 value = 0;
+            for (int i = 0; i < bytes; i++) value = (value << 8) | p[i];
+            return value;
+        }
+
+        /**
+         * @brief Reads a big-endian float of an R*Tree node
+         */
+        double readFloat(const unsigned char * p)
+        {
+            unsigned int bits = (unsigned int)readBigEndian(p, 4);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        /**
+         * @brief Distance from a point to a box, zero inside
+         */
+        double boxDistance(double x, double y, const double * box)
+        {
+            double dx = std::max(std::max(box[0] - x, x - box[1]), 0.0);
+            double dy = std::max(std::max(box[2] - y, y - box[3]), 0.0);
+            return std::sqrt(dx * dx + dy * dy);
+        }
+
+    }
+
     SpatialDatabase::SpatialDatabase(const std::string & filename,
                                      const int           flags,
                                      const int           timeout,
@@ -30,6 +118,8 @@ namespace SpatiaLite
         // Open an in-memory database connection
         // --------------------------------------------------
         this->_database = new SQLite::Database(filename, flags, timeout, vfs);
+        this->_id = ++lastId;
+        this->_versionQuery = 0;
 
         // ==================================================
         // Initialize spatialite
@@ -40,6 +130,7 @@ namespace SpatiaLite
 
     SpatialDatabase::~SpatialDatabase()
     {
+        sqlite3_finalize(this->_versionQuery);
         spatialite_cleanup_ex(this->getCache());
         delete this->getDatabase();
     }
@@ -117,6 +208,33 @@ namespace SpatiaLite
         return this->_database;
     }
 
+    sqlite3_int64 SpatialDatabase::getDataVersion() const
+    {
+        // ==================================================
+        // The connection mutex keeps the step and reset of callers on
+        // other threads apart
+        // --------------------------------------------------
+        sqlite3 * handle = this->getDatabase()->getHandle();
+        sqlite3_mutex * mutex = sqlite3_db_mutex(handle);
+        sqlite3_mutex_enter(mutex);
+        if (!this->_versionQuery &&
+            sqlite3_prepare_v2(handle, "PRAGMA data_version", -1,
+                               &this->_versionQuery,
+                               0) != SQLITE_OK)
+        {
+            sqlite3_mutex_leave(mutex);
+            throw std::runtime_error("Failed to read data version!");
+        }
+        sqlite3_int64 version = 0;
+        if (sqlite3_step(this->_versionQuery) == SQLITE_ROW)
+        {
+            version = sqlite3_column_int64(this->_versionQuery, 0);
+        }
+        sqlite3_reset(this->_versionQuery);
+        sqlite3_mutex_leave(mutex);
+        return version;
+    }
+
     std::string
     SpatialDatabase::getGeometryName(int type)
     {
@@ -174,6 +292,11 @@ namespace SpatiaLite
 
     }
 
+    sqlite3_int64 SpatialDatabase::getId() const
+    {
+        return this->_id;
+    }
+
     std::vector<std::string> SpatialDatabase::getTypes(const std::string & name) const
     {
 
@@ -194,6 +317,103 @@ namespace SpatiaLite
 
     }
 
+    std::vector<SpatialDatabase::Neighbor>
+    SpatialDatabase::nearest(const std::string & table,
+                             const std::string & geometry,
+                             double x,
+                             double y,
+                             int k,
+                             double maxDistance) const
+    {
+        std::vector<Neighbor> neighbors;
+        if (k <= 0) return neighbors;
+
+        // ==================================================
+        // Prepare node and row lookups
+        // --------------------------------------------------
+        std::string index = "idx_" + table + "_" + geometry + "_node";
+        SQLite::Database & database = *this->getDatabase();
+        if (!database.tableExists(index))
+        {
+            throw std::runtime_error("Spatial index not found!");
+        }
+        SQLite::Statement nodes(database,
+            "SELECT data FROM " + quoteName(index) + " WHERE nodeno = ?");
+        SQLite::Statement rows(database,
+            "SELECT " + quoteName(geometry) + " FROM " + quoteName(table) +
+            " WHERE rowid = ?");
+
+        // ==================================================
+        // Pop nodes, boxes and exact distances in order
+        // --------------------------------------------------
+        std::priority_queue<SearchEntry> queue;
+        SearchEntry root = {0, 1, KNN_NODE, -1};
+        queue.push(root);
+        while (!queue.empty() && (int)neighbors.size() < k)
+        {
+            SearchEntry entry = queue.top();
+            queue.pop();
+            if (entry.distance > maxDistance) break;
+
+            if (entry.kind == KNN_EXACT)
+            {
+                Neighbor neighbor = {entry.id, entry.distance};
+                neighbors.push_back(neighbor);
+            }
+            else if (entry.kind == KNN_BOX)
+            {
+                rows.reset();
+                rows.bind(1, entry.id);
+                if (!rows.executeStep()) continue;
+                SQLite::Column value = rows.getColumn(0);
+                if (value.getType() != SQLITE_BLOB) continue;
+                gaiaGeomCollPtr decoded = BlobEncoding::decode(
+                    (const unsigned char *)value.getBlob(),
+                    value.getBytes());
+                if (!decoded) continue;
+                entry.distance = Measure::getDistance(decoded, x, y);
+                gaiaFreeGeomColl(decoded);
+                if (entry.distance > maxDistance) continue;
+                entry.kind = KNN_EXACT;
+                queue.push(entry);
+            }
+            else
+            {
+                nodes.reset();
+                nodes.bind(1, entry.id);
+                if (!nodes.executeStep()) continue;
+                SQLite::Column value = nodes.getColumn(0);
+                const unsigned char * data =
+                    (const unsigned char *)value.getBlob();
+                const int bytes = value.getBytes();
+                if (bytes < 4) continue;
+
+                // The tree depth is only stored in the root node
+                int depth = entry.depth < 0 ?
+                    (int)readBigEndian(data, 2) : entry.depth;
+                int cells = (int)readBigEndian(data + 2, 2);
+                for (int i = 0; i < cells && 4 + (i + 1) * 24 <= bytes; i++)
+                {
+                    const unsigned char * cell = data + 4 + i * 24;
+                    double box[4];
+                    for (int j = 0; j < 4; j++)
+                    {
+                        box[j] = readFloat(cell + 8 + 4 * j);
+                    }
+                    SearchEntry child;
+                    child.distance = boxDistance(x, y, box);
+                    if (child.distance > maxDistance) continue;
+                    child.id = readBigEndian(cell, 8);
+                    child.kind = depth > 0 ? KNN_NODE : KNN_BOX;
+                    child.depth = depth - 1;
+                    queue.push(child);
+                }
+            }
+        }
+
+        return neighbors;
+    }
+
     int SpatialDatabase::sanitizeGeometries(const std::string & prefix,
                                             const std::string & directory,
                                             int * numNotRepaired,
@@ -0,0 +1,691 @@
+/**
+ * @file    TilePyramid.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main TilePyramid class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/TilePyramid.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/Checksum.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // Half the width of the Web Mercator world in meters
+        const double WORLD = 20037508.342789244;
+
+        // Tiles written per MBTiles transaction
+        const int BATCH_SIZE = 1000;
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Gets the tiles of a zoom level that cover a box
+         * @param[in]  z      Zoom level
+         * @param[in]  bounds Web Mercator box: minx, miny, maxx, maxy
+         * @param[out] range  First column, first row, last column, last row
+         */
+        void getRange(int z, const double * bounds, int * range)
+        {
+            const int tiles = 1 << z;
+            const double size = 2 * WORLD / tiles;
+            const double edges[4] = {(bounds[0] + WORLD) / size,
+                                     (WORLD - bounds[3]) / size,
+                                     (bounds[2] + WORLD) / size,
+                                     (WORLD - bounds[1]) / size};
+            for (int i = 0; i < 4; i++)
+            {
+                // Boxes ending on a tile edge do not take the next tile
+                const double edge = i < 2 ? std::floor(edges[i]) :
+                                            std::ceil(edges[i]) - 1;
+                range[i] = edge < 0 ? 0 :
+                           edge > tiles - 1 ? tiles - 1 : (int)edge;
+            }
+        }
+
+        /**
+         * @returns Longitude of a Web Mercator x-coordinate
+         */
+        double toLongitude(double x)
+        {
+            return x / WORLD * 180.0;
+        }
+
+        /**
+         * @returns Latitude of a Web Mercator y-coordinate
+         */
+        double toLatitude(double y)
+        {
+            const double pi = 3.14159265358979323846;
+            return std::atan(std::sinh(y / WORLD * pi)) * 180.0 / pi;
+        }
+
+        /**
+         * @brief Escapes a JSON string body
+         */
+        std::string escapeJson(std::string const & text)
+        {
+            std::string escaped;
+            for (size_t i = 0; i < text.size(); i++)
+            {
+                const unsigned char c = text[i];
+                if (c == '"' || c == '\\')
+                {
+                    escaped += '\\';
+                    escaped += (char)c;
+                }
+                else if (c < 0x20)
+                {
+                    char code[8];
+                    std::snprintf(code, sizeof(code), "\\u%04x", c);
+                    escaped += code;
+                }
+                else
+                {
+                    escaped += (char)c;
+                }
+            }
+            return escaped;
+        }
+
+        /**
+         * @brief Finalizes a statement on scope exit
+         */
+        struct StatementGuard
+        {
+            sqlite3_stmt * statement;  ///< Owned statement
+            ~StatementGuard() { sqlite3_finalize(this->statement); }
+        };
+
+        /**
+         * @brief Depth-first walk of the non-empty tiles of a pyramid
+         */
+        struct TileWalk
+        {
+            StatementGuard probe;       ///< Spatial index probe
+            std::vector<int> ranges;    ///< Tile range of every zoom level
+            std::vector<VectorTileEncoder::Tile> stack; ///< Tiles to probe
+            int minZoom;                ///< Lowest zoom level
+            int maxZoom;                ///< Highest zoom level
+            int extent;                 ///< Tile extent
+            int buffer;                 ///< Tile buffer
+        };
+
+        /**
+         * @brief Starts a walk at zoom 0
+         * @throws std::runtime_error if the spatial index is missing
+         */
+        void startWalk(TileWalk & walk,
+                       SpatialDatabase const & database,
+                       std::string const & table,
+                       std::string const & geometry,
+                       int minZoom,
+                       int maxZoom,
+                       const double * bounds,
+                       int extent,
+                       int buffer)
+        {
+            walk.probe.statement = 0;
+            sqlite3 * handle = database.getDatabase()->getHandle();
+            const std::string sql =
+                "SELECT EXISTS (SELECT 1 FROM " +
+                quoteName("idx_" + table + "_" + geometry) +
+                " WHERE xmin <= ? AND xmax >= ? AND ymin <= ? AND ymax >= ?)";
+            if (sqlite3_prepare_v2(handle, sql.c_str(), -1,
+                                   &walk.probe.statement, 0) != SQLITE_OK)
+            {
+                throw std::runtime_error("Spatial index not found!");
+            }
+            walk.ranges.resize(4 * (maxZoom + 1));
+            for (int z = 0; z <= maxZoom; z++)
+            {
+                getRange(z, bounds, &walk.ranges[4 * z]);
+            }
+            VectorTileEncoder::Tile root = {0, 0, 0};
+            walk.stack.push_back(root);
+            walk.minZoom = minZoom;
+            walk.maxZoom = maxZoom;
+            walk.extent = extent;
+            walk.buffer = buffer;
+        }
+
+        /**
+         * @brief Gets the next tile of the zoom range whose buffered bounds
+         *        hold an index entry
+         * @details Only children of such tiles are probed, so at most three
+         *          pending siblings are kept per zoom level.
+         * @returns False once the walk is done
+         * @throws std::runtime_error on failure
+         */
+        bool nextTile(TileWalk & walk, VectorTileEncoder::Tile & tile)
+        {
+            while (!walk.stack.empty())
+            {
+                const VectorTileEncoder::Tile current = walk.stack.back();
+                walk.stack.pop_back();
+                const int * range = &walk.ranges[4 * current.z];
+                if (current.x < range[0] || current.x > range[2] ||
+                    current.y < range[1] || current.y > range[3])
+                {
+                    continue;
+                }
+                double minx = 0;
+                double miny = 0;
+                double maxx = 0;
+                double maxy = 0;
+                VectorTileEncoder::getBounds(current.z, current.x, current.y,
+                                             minx, miny, maxx, maxy);
+                const double margin = (maxx - minx) * walk.buffer /
+                                      walk.extent;
+                sqlite3_stmt * probe = walk.probe.statement;
+                sqlite3_reset(probe);
+                sqlite3_bind_double(probe, 1, maxx + margin);
+                sqlite3_bind_double(probe, 2, minx - margin);
+                sqlite3_bind_double(probe, 3, maxy + margin);
+                sqlite3_bind_double(probe, 4, miny - margin);
+                if (sqlite3_step(probe) != SQLITE_ROW)
+                {
+                    throw std::runtime_error("Failed to query spatial index!");
+                }
+                if (!sqlite3_column_int(probe, 0)) continue;
+
+                // Children are pushed last first so they come out in order
+                if (current.z < walk.maxZoom)
+                {
+                    for (int j = 3; j >= 0; j--)
+                    {
+                        VectorTileEncoder::Tile child = {current.z + 1,
+                                                         2 * current.x + j % 2,
+                                                         2 * current.y + j / 2};
+                        walk.stack.push_back(child);
+                    }
+                }
+                if (current.z >= walk.minZoom)
+                {
+                    tile = current;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @returns True if a tile has a lower zoom level than another
+         */
+        bool isLowerZoom(VectorTileEncoder::Tile const & a,
+                         VectorTileEncoder::Tile const & b)
+        {
+            return a.z < b.z;
+        }
+
+        /**
+         * @brief Encoded tile on its way to the writer
+         */
+        struct EncodedTile
+        {
+            VectorTileEncoder::Tile tile;  ///< Tile address
+            std::string hash;              ///< MD5 of the data
+            std::string data;              ///< Encoded tile
+        };
+
+        /**
+         * @brief State shared by the workers and the writer
+         */
+        struct PyramidState
+        {
+            std::string filename;           ///< Database file, empty if shared
+            SpatialDatabase const * shared; ///< Caller database if no file
+            std::string table;              ///< Table name
+            std::string geometry;           ///< Geometry column name
+            int extent;                     ///< Tile extent
+            int buffer;                     ///< Tile buffer
+            SQLite::Database * output;      ///< MBTiles file
+
+            std::mutex walking;             ///< Guards the walk
+            TileWalk walk;                  ///< Tiles left to encode
+
+            std::mutex mutex;               ///< Guards the fields below
+            std::condition_variable changed;///< Signals any change
+            std::deque<EncodedTile> queue;  ///< Tiles waiting for the writer
+            size_t window;                  ///< Tiles queued at most
+            int workers;                    ///< Workers still running
+            long long empty;                ///< Tiles without features
+            long long duplicates;           ///< Tiles stored before
+            long long written;              ///< Tiles written
+            bool failed;                    ///< Generation aborted
+            std::string error;              ///< First error message
+        };
+
+        /**
+         * @brief Aborts the generation with an error
+         */
+        void fail(PyramidState & state, const char * message)
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.failed) state.error = message;
+            state.failed = true;
+            state.changed.notify_all();
+        }
+
+        /**
+         * @brief Encodes and hashes tiles until none are left
+         */
+        void encodeTiles(PyramidState * state)
+        {
+            try
+            {
+                // ==================================================
+                // Own read-only connection unless the database is in memory
+                // --------------------------------------------------
+                std::unique_ptr<SpatialDatabase> connection;
+                if (!state->shared)
+                {
+                    connection.reset(new SpatialDatabase(state->filename,
+                                                         SQLITE_OPEN_READONLY));
+                }
+                SpatialDatabase const & database =
+                    connection ? *connection : *state->shared;
+                VectorTileEncoder::LayerQuery query(database, state->table,
+                                                    state->geometry);
+                VectorTileEncoder encoder(state->extent, state->buffer);
+
+                for (;;)
+                {
+                    EncodedTile item;
+                    {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        if (state->failed) break;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(state->walking);
+                        if (!nextTile(state->walk, item.tile)) break;
+                    }
+
+                    // ==================================================
+                    // Encode, leaving out tiles clipped to nothing
+                    // --------------------------------------------------
+                    encoder.clear();
+                    encoder.addLayer(query, item.tile.z, item.tile.x,
+                                     item.tile.y);
+                    if (encoder.getData().empty())
+                    {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        state->empty++;
+                        continue;
+                    }
+                    item.data = encoder.getData();
+                    Checksum sum(gaiaCreateMD5Checksum());
+                    sum.update((const unsigned char *)item.data.data(),
+                               (int)item.data.size());
+                    item.hash = sum.finalize();
+
+                    // ==================================================
+                    // Hand over once the writer has room
+                    // --------------------------------------------------
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    while (!state->failed &&
+                           state->queue.size() >= state->window)
+                    {
+                        state->changed.wait(lock);
+                    }
+                    if (state->failed) break;
+                    state->queue.push_back(EncodedTile());
+                    state->queue.back().tile = item.tile;
+                    state->queue.back().hash.swap(item.hash);
+                    state->queue.back().data.swap(item.data);
+                    state->changed.notify_all();
+                }
+            }
+            catch (std::exception & e)
+            {
+                fail(*state, e.what());
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->workers--;
+            state->changed.notify_all();
+        }
+
+        /**
+         * @brief Stores queued tiles until the workers are done
+         */
+        void writeTiles(PyramidState * state)
+        {
+            SQLite::Database & output = *state->output;
+            bool open = false;
+            try
+            {
+                SQLite::Statement image(output,
+                    "INSERT OR IGNORE INTO images (tile_id, tile_data) "
+                    "VALUES (?, ?)");
+                SQLite::Statement map(output,
+                    "INSERT OR REPLACE INTO map "
+                    "(zoom_level, tile_column, tile_row, tile_id) "
+                    "VALUES (?, ?, ?, ?)");
+                std::unordered_set<std::string> stored;
+                int pending = 0;
+                output.exec("BEGIN");
+                open = true;
+
+                // ==================================================
+                // Tiles of an earlier run inside the range are replaced or
+                // dropped
+                // --------------------------------------------------
+                SQLite::Statement clear(output,
+                    "DELETE FROM map WHERE zoom_level = ? AND "
+                    "tile_column BETWEEN ? AND ? AND tile_row BETWEEN ? AND ?");
+                for (int z = state->walk.minZoom; z <= state->walk.maxZoom; z++)
+                {
+                    const int * range = &state->walk.ranges[4 * z];
+                    clear.bind(1, z);
+                    clear.bind(2, range[0]);
+                    clear.bind(3, range[2]);
+                    clear.bind(4, (1 << z) - 1 - range[3]);
+                    clear.bind(5, (1 << z) - 1 - range[1]);
+                    clear.exec();
+                    clear.reset();
+                }
+
+                for (;;)
+                {
+                    EncodedTile item;
+                    {
+                        std::unique_lock<std::mutex> lock(state->mutex);
+                        while (!state->failed && state->queue.empty() &&
+                               state->workers > 0)
+                        {
+                            state->changed.wait(lock);
+                        }
+                        if (state->failed || state->queue.empty()) break;
+                        item.tile = state->queue.front().tile;
+                        item.hash.swap(state->queue.front().hash);
+                        item.data.swap(state->queue.front().data);
+                        state->queue.pop_front();
+                        state->changed.notify_all();
+                    }
+
+                    // ==================================================
+                    // Store the data once per distinct hash
+                    // --------------------------------------------------
+                    if (stored.insert(item.hash).second)
+                    {
+                        image.bind(1, item.hash);
+                        image.bind(2, item.data.data(), (int)item.data.size());
+                        image.exec();
+                        image.reset();
+                    }
+                    else
+                    {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        state->duplicates++;
+                    }
+
+                    // MBTiles rows count from the south
+                    map.bind(1, item.tile.z);
+                    map.bind(2, item.tile.x);
+                    map.bind(3, (1 << item.tile.z) - 1 - item.tile.y);
+                    map.bind(4, item.hash);
+                    map.exec();
+                    map.reset();
+                    state->written++;
+
+                    if (++pending >= BATCH_SIZE)
+                    {
+                        output.exec("COMMIT");
+                        open = false;
+                        output.exec("BEGIN");
+                        open = true;
+                        pending = 0;
+                    }
+                }
+                if (!state->failed)
+                {
+                    // Drop the data of tiles no longer referenced
+                    output.exec("DELETE FROM images WHERE tile_id NOT IN "
+                                "(SELECT tile_id FROM map)");
+                    output.exec("COMMIT");
+                    open = false;
+                }
+            }
+            catch (std::exception & e)
+            {
+                fail(*state, e.what());
+            }
+            if (open)
+            {
+                try { output.exec("ROLLBACK"); } catch (...) {}
+            }
+        }
+
+        /**
+         * @brief Creates the deduplicated MBTiles layout and its metadata
+         */
+        void createMBTiles(SQLite::Database & output,
+                           std::string const & name,
+                           int minZoom,
+                           int maxZoom,
+                           const double * bounds)
+        {
+            output.exec(
+                "CREATE TABLE IF NOT EXISTS metadata (name TEXT, value TEXT);"
+                "CREATE UNIQUE INDEX IF NOT EXISTS name ON metadata (name);"
+                "CREATE TABLE IF NOT EXISTS map (zoom_level INTEGER, "
+                "tile_column INTEGER, tile_row INTEGER, tile_id TEXT);"
+                "CREATE UNIQUE INDEX IF NOT EXISTS map_index ON map "
+                "(zoom_level, tile_column, tile_row);"
+                "CREATE TABLE IF NOT EXISTS images (tile_data BLOB, "
+                "tile_id TEXT);"
+                "CREATE UNIQUE INDEX IF NOT EXISTS images_id ON images "
+                "(tile_id);"
+                "CREATE VIEW IF NOT EXISTS tiles AS SELECT "
+                "map.zoom_level AS zoom_level, "
+                "map.tile_column AS tile_column, "
+                "map.tile_row AS tile_row, "
+                "images.tile_data AS tile_data "
+                "FROM map JOIN images ON images.tile_id = map.tile_id;");
+
+            // ==================================================
+            // Metadata is rewritten on every run
+            // --------------------------------------------------
+            char text[256];
+            const double west = toLongitude(std::max(bounds[0], -WORLD));
+            const double south = toLatitude(std::max(bounds[1], -WORLD));
+            const double east = toLongitude(std::min(bounds[2], WORLD));
+            const double north = toLatitude(std::min(bounds[3], WORLD));
+            std::vector<std::pair<std::string, std::string> > metadata;
+            metadata.push_back(std::make_pair("name", name));
+            metadata.push_back(std::make_pair("format", "pbf"));
+            metadata.push_back(std::make_pair("type", "overlay"));
+            std::snprintf(text, sizeof(text), "%d", minZoom);
+            metadata.push_back(std::make_pair("minzoom", text));
+            std::snprintf(text, sizeof(text), "%d", maxZoom);
+            metadata.push_back(std::make_pair("maxzoom", text));
+            std::snprintf(text, sizeof(text), "%.9g,%.9g,%.9g,%.9g",
+                          west, south, east, north);
+            metadata.push_back(std::make_pair("bounds", text));
+            std::snprintf(text, sizeof(text), "%.9g,%.9g,%d",
+                          (west + east) / 2, (south + north) / 2, minZoom);
+            metadata.push_back(std::make_pair("center", text));
+            std::snprintf(text, sizeof(text),
+                          "\",\"minzoom\":%d,\"maxzoom\":%d,\"fields\":{}}]}",
+                          minZoom, maxZoom);
+            metadata.push_back(std::make_pair("json",
+                "{\"vector_layers\":[{\"id\":\"" + escapeJson(name) + text));
+
+            SQLite::Statement insert(output,
+                "INSERT OR REPLACE INTO metadata (name, value) VALUES (?, ?)");
+            for (size_t i = 0; i < metadata.size(); i++)
+            {
+                insert.bind(1, metadata[i].first);
+                insert.bind(2, metadata[i].second);
+                insert.exec();
+                insert.reset();
+            }
+        }
+
+    }
+
+    TilePyramid::TilePyramid(int minZoom,
+                             int maxZoom,
+                             double minx,
+                             double miny,
+                             double maxx,
+                             double maxy,
+                             int threads,
+                             int extent,
+                             int buffer) :
+        _buffer(buffer),
+        _duplicates(0),
+        _empty(0),
+        _extent(extent),
+        _maxZoom(maxZoom),
+        _minZoom(minZoom),
+        _threads(threads)
+    {
+        if (minZoom < 0 || maxZoom < minZoom || maxZoom > 30)
+        {
+            throw std::runtime_error("Invalid zoom range!");
+        }
+        if (!(minx < maxx && miny < maxy))
+        {
+            throw std::runtime_error("Invalid bounds!");
+        }
+        if (threads < 0) throw std::runtime_error("Invalid thread count!");
+        if (extent < 1) throw std::runtime_error("Invalid tile extent!");
+        if (buffer < 0) throw std::runtime_error("Invalid tile buffer!");
+        this->_bounds[0] = minx;
+        this->_bounds[1] = miny;
+        this->_bounds[2] = maxx;
+        this->_bounds[3] = maxy;
+        if (this->_threads == 0)
+        {
+            this->_threads = (int)std::thread::hardware_concurrency();
+        }
+        if (this->_threads == 0) this->_threads = 1;
+    }
+
+    TilePyramid::~TilePyramid()
+    {
+    }
+
+    std::vector<VectorTileEncoder::Tile> TilePyramid::findTiles(
+        SpatialDatabase const & database,
+        std::string const & table,
+        std::string const & geometry) const
+    {
+        TileWalk walk;
+        startWalk(walk, database, table, geometry, this->_minZoom,
+                  this->_maxZoom, this->_bounds, this->_extent, this->_buffer);
+        std::vector<VectorTileEncoder::Tile> tiles;
+        VectorTileEncoder::Tile tile;
+        while (nextTile(walk, tile)) tiles.push_back(tile);
+        std::stable_sort(tiles.begin(), tiles.end(), isLowerZoom);
+        return tiles;
+    }
+
+    long long TilePyramid::generate(SpatialDatabase const & database,
+                                    std::string const & table,
+                                    std::string const & geometry,
+                                    std::string const & filename)
+    {
+        this->_duplicates = 0;
+        this->_empty = 0;
+        PyramidState state;
+        startWalk(state.walk, database, table, geometry, this->_minZoom,
+                  this->_maxZoom, this->_bounds, this->_extent, this->_buffer);
+        state.table = table;
+        state.geometry = geometry;
+        state.extent = this->_extent;
+        state.buffer = this->_buffer;
+
+        SQLite::Database output(filename,
+                                SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        createMBTiles(output, table, this->_minZoom, this->_maxZoom,
+                      this->_bounds);
+        state.output = &output;
+
+        // ==================================================
+        // Workers need the database file to open their own connections
+        // --------------------------------------------------
+        sqlite3 * handle = database.getDatabase()->getHandle();
+        const char * file = sqlite3_db_filename(handle, "main");
+        int threads = this->_threads;
+        state.shared = 0;
+        if (file && *file) state.filename = file;
+        else
+        {
+            state.shared = &database;
+            threads = 1;
+        }
+        state.window = 4 * (size_t)threads;
+        state.workers = threads;
+        state.empty = 0;
+        state.duplicates = 0;
+        state.written = 0;
+        state.failed = false;
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; i++)
+        {
+            workers.push_back(std::thread(encodeTiles, &state));
+        }
+        std::thread writer(writeTiles, &state);
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+        writer.join();
+        if (state.failed) throw std::runtime_error(state.error);
+        this->_duplicates = state.duplicates;
+        this->_empty = state.empty;
+        return state.written;
+    }
+
+    long long TilePyramid::getDuplicateCount() const
+    {
+        return this->_duplicates;
+    }
+
+    long long TilePyramid::getEmptyCount() const
+    {
+        return this->_empty;
+    }
+
+    int TilePyramid::getMaxZoom() const
+    {
+        return this->_maxZoom;
+    }
+
+    int TilePyramid::getMinZoom() const
+    {
+        return this->_minZoom;
+    }
+
+    int TilePyramid::getThreadCount() const
+    {
+        return this->_threads;
+    }
+
+}
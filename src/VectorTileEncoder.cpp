@@ -0,0 +1,978 @@
+/**
+ * @file    VectorTileEncoder.cpp
+ * @ingroup SpatiaLiteCpp
+ * @brief   Main VectorTileEncoder class.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+
+#include "SpatiaLiteCpp/VectorTileEncoder.h"
+
+#include "SpatiaLiteCpp/Auxiliary.h"
+#include "SpatiaLiteCpp/BlobEncoding.h"
+#include "SpatiaLiteCpp/CoordinateBuffer.h"
+#include "SpatiaLiteCpp/SpatialDatabase.h"
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace SpatiaLite
+{
+
+    namespace
+    {
+
+        // Half the width of the Web Mercator world in meters
+        const double WORLD = 20037508.342789244;
+
+        // Geometry command identifiers
+        const uint32_t MOVE_TO = 1;
+        const uint32_t LINE_TO = 2;
+        const uint32_t CLOSE_PATH = 7;
+
+        // Feature geometry types
+        const int TYPE_POINT = 1;
+        const int TYPE_LINESTRING = 2;
+        const int TYPE_POLYGON = 3;
+
+        // Path kinds
+        const int PATH_LINE = 0;
+        const int PATH_EXTERIOR = 1;
+        const int PATH_INTERIOR = 2;
+
+        /**
+         * @brief Quotes an SQL identifier
+         */
+        std::string quoteName(std::string const & name)
+        {
+            return "\"" + Auxiliary::doubleQuotedSql(name.c_str()) + "\"";
+        }
+
+        /**
+         * @brief Appends a protobuf base 128 varint
+         */
+        void appendVarint(std::string & output, uint64_t value)
+        {
+            char bytes[10];
+            size_t size = 0;
+            while (value >= 0x80)
+            {
+                bytes[size++] = (char)(value | 0x80);
+                value >>= 7;
+            }
+            bytes[size++] = (char)value;
+            output.append(bytes, size);
+        }
+
+        /**
+         * @returns Encoded size of a varint
+         */
+        size_t getVarintSize(uint64_t value)
+        {
+            size_t size = 1;
+            while (value >= 0x80)
+            {
+                value >>= 7;
+                size++;
+            }
+            return size;
+        }
+
+        /**
+         * @brief Appends a field key
+         */
+        void appendKey(std::string & output, int field, int wire)
+        {
+            appendVarint(output, ((uint64_t)field << 3) | wire);
+        }
+
+        /**
+         * @brief Appends a length-delimited field
+         */
+        void appendBytes(std::string & output,
+                         int field,
+                         const char * data,
+                         size_t size)
+        {
+            appendKey(output, field, 2);
+            appendVarint(output, size);
+            output.append(data, size);
+        }
+
+        /**
+         * @brief Appends a packed repeated uint32 field
+         */
+        void appendPacked(std::string & output,
+                          int field,
+                          std::vector<uint32_t> const & values)
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                size += getVarintSize(values[i]);
+            }
+            appendKey(output, field, 2);
+            appendVarint(output, size);
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                appendVarint(output, values[i]);
+            }
+        }
+
+        /**
+         * @returns Zigzag encoding of a parameter
+         */
+        uint32_t zigzag(int value)
+        {
+            return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+        }
+
+        /**
+         * @returns Command integer
+         */
+        uint32_t command(uint32_t id, size_t count)
+        {
+            return (id & 0x7) | ((uint32_t)count << 3);
+        }
+
+        /**
+         * @brief Clips a segment to a square (Liang-Barsky)
+         * @returns False if the segment is outside
+         */
+        bool clipSegment(double & x0, double & y0,
+                         double & x1, double & y1,
+                         double low, double high)
+        {
+            const double dx = x1 - x0;
+            const double dy = y1 - y0;
+            const double p[4] = {-dx, dx, -dy, dy};
+            const double q[4] = {x0 - low, high - x0, y0 - low, high - y0};
+            double t0 = 0;
+            double t1 = 1;
+            for (int i = 0; i < 4; i++)
+            {
+                if (p[i] == 0)
+                {
+                    if (q[i] < 0) return false;
+                    continue;
+                }
+                const double r = q[i] / p[i];
+                if (p[i] < 0)
+                {
+                    if (r > t1) return false;
+                    if (r > t0) t0 = r;
+                }
+                else
+                {
+                    if (r < t0) return false;
+                    if (r < t1) t1 = r;
+                }
+            }
+            const double x = x0;
+            const double y = y0;
+            if (t0 > 0)
+            {
+                x0 = x + t0 * dx;
+                y0 = y + t0 * dy;
+            }
+            if (t1 < 1)
+            {
+                x1 = x + t1 * dx;
+                y1 = y + t1 * dy;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Clips a closed ring against one box edge
+         *        (Sutherland-Hodgman)
+         * @param[in]  input  Ring points as x, y pairs
+         * @param[out] output Clipped ring points
+         * @param[in]  axis   0 for x, 1 for y
+         * @param[in]  value  Edge position
+         * @param[in]  above  True to keep the side greater than the edge
+         */
+        void clipEdge(std::vector<double> const & input,
+                      std::vector<double> & output,
+                      int axis,
+                      double value,
+                      bool above)
+        {
+            output.clear();
+            const size_t count = input.size() / 2;
+            for (size_t i = 0; i < count; i++)
+            {
+                const double * current = &input[2 * i];
+                const double * previous = &input[2 * ((i + count - 1) % count)];
+                const bool currentIn = above ? current[axis] >= value :
+                                               current[axis] <= value;
+                const bool previousIn = above ? previous[axis] >= value :
+                                                previous[axis] <= value;
+                if (currentIn != previousIn)
+                {
+                    const int other = 1 - axis;
+                    const double t = (value - previous[axis]) /
+                                     (current[axis] - previous[axis]);
+                    double point[2];
+                    point[axis] = value;
+                    point[other] = previous[other] +
+                                   t * (current[other] - previous[other]);
+                    output.push_back(point[0]);
+                    output.push_back(point[1]);
+                }
+                if (currentIn)
+                {
+                    output.push_back(current[0]);
+                    output.push_back(current[1]);
+                }
+            }
+        }
+
+        /**
+         * @brief Quantizes a path and appends its commands
+         * @param[in]     path     Pixel coordinates as x, y pairs
+         * @param[out]    work     Scratch array
+         * @param[in]     kind     PATH_LINE, PATH_EXTERIOR or PATH_INTERIOR
+         * @param[in,out] cursor   Pen position
+         * @param[out]    commands Geometry commands
+         * @returns False if the path degenerated
+         */
+        bool appendPath(std::vector<double> const & path,
+                        std::vector<double> & work,
+                        int kind,
+                        int * cursor,
+                        std::vector<uint32_t> & commands)
+        {
+            // ==================================================
+            // Snap to the integer grid, dropping repeated points
+            // --------------------------------------------------
+            work.clear();
+            for (size_t i = 0; i + 1 < path.size(); i += 2)
+            {
+                const double x = std::floor(path[i] + 0.5);
+                const double y = std::floor(path[i + 1] + 0.5);
+                const size_t n = work.size();
+                if (n && work[n - 2] == x && work[n - 1] == y) continue;
+                work.push_back(x);
+                work.push_back(y);
+            }
+            size_t count = work.size() / 2;
+            if (kind == PATH_LINE)
+            {
+                if (count < 2) return false;
+            }
+            else
+            {
+                // Rings are closed by ClosePath, not by a repeated point
+                if (count > 1 && work[0] == work[2 * count - 2] &&
+                    work[1] == work[2 * count - 1])
+                {
+                    count--;
+                    work.resize(2 * count);
+                }
+                if (count < 3) return false;
+
+                // Exterior rings need a positive surveyor's area in tile
+                // coordinates (clockwise with y down), interiors negative
+                double area = 0;
+                for (size_t i = 0; i < count; i++)
+                {
+                    const size_t j = (i + 1) % count;
+                    area += work[2 * i] * work[2 * j + 1] -
+                            work[2 * j] * work[2 * i + 1];
+                }
+                if (area == 0) return false;
+                if ((kind == PATH_EXTERIOR) != (area > 0))
+                {
+                    for (size_t i = 0, j = count - 1; i < j; i++, j--)
+                    {
+                        std::swap(work[2 * i], work[2 * j]);
+                        std::swap(work[2 * i + 1], work[2 * j + 1]);
+                    }
+                }
+            }
+
+            // ==================================================
+            // MoveTo the first point and LineTo the rest
+            // --------------------------------------------------
+            for (size_t i = 0; i < count; i++)
+            {
+                if (i == 0) commands.push_back(command(MOVE_TO, 1));
+                if (i == 1) commands.push_back(command(LINE_TO, count - 1));
+                const int x = (int)work[2 * i];
+                const int y = (int)work[2 * i + 1];
+                commands.push_back(zigzag(x - cursor[0]));
+                commands.push_back(zigzag(y - cursor[1]));
+                cursor[0] = x;
+                cursor[1] = y;
+            }
+            if (kind != PATH_LINE) commands.push_back(command(CLOSE_PATH, 1));
+            return true;
+        }
+
+        /**
+         * @brief Prepares the tile query of a table
+         * @param[in]  handle         Connection
+         * @param[in]  table          Table name
+         * @param[in]  geometry       Geometry column name
+         * @param[out] geometryColumn Index of the geometry column
+         * @returns Statement selecting the rowid and all columns of the rows
+         *          whose index box intersects the four bound parameters
+         */
+        sqlite3_stmt * prepareLayer(sqlite3 * handle,
+                                    std::string const & table,
+                                    std::string const & geometry,
+                                    int & geometryColumn)
+        {
+            const std::string index = "idx_" + table + "_" + geometry;
+            const std::string sql =
+                "SELECT t.rowid, t.* FROM " + quoteName(table) + " AS t "
+                "WHERE t.rowid IN (SELECT pkid FROM " + quoteName(index) +
+                " WHERE xmin <= ? AND xmax >= ? AND ymin <= ? AND ymax >= ?)";
+            sqlite3_stmt * statement = 0;
+            if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &statement, 0) !=
+                SQLITE_OK)
+            {
+                sqlite3_finalize(statement);
+                throw std::runtime_error("Spatial index not found!");
+            }
+            geometryColumn = -1;
+            for (int i = 1; i < sqlite3_column_count(statement); i++)
+            {
+                if (sqlite3_stricmp(sqlite3_column_name(statement, i),
+                                    geometry.c_str()) == 0)
+                {
+                    geometryColumn = i;
+                    break;
+                }
+            }
+            if (geometryColumn < 0)
+            {
+                sqlite3_finalize(statement);
+                throw std::runtime_error("Geometry column not found!");
+            }
+            return statement;
+        }
+
+        /**
+         * @brief Binds the buffered bounds of a tile to a layer query
+         */
+        void bindTile(sqlite3_stmt * statement,
+                      int z, int x, int y,
+                      int extent, int buffer)
+        {
+            double minx = 0;
+            double miny = 0;
+            double maxx = 0;
+            double maxy = 0;
+            VectorTileEncoder::getBounds(z, x, y, minx, miny, maxx, maxy);
+            const double margin = (maxx - minx) * buffer / extent;
+            sqlite3_reset(statement);
+            sqlite3_bind_double(statement, 1, maxx + margin);
+            sqlite3_bind_double(statement, 2, minx - margin);
+            sqlite3_bind_double(statement, 3, maxy + margin);
+            sqlite3_bind_double(statement, 4, miny - margin);
+        }
+
+        /**
+         * @brief Finalizes a statement on scope exit
+         */
+        struct StatementGuard
+        {
+            sqlite3_stmt * statement;  ///< Owned statement
+            ~StatementGuard() { sqlite3_finalize(this->statement); }
+        };
+
+    }
+
+    VectorTileEncoder::LayerQuery::LayerQuery(SpatialDatabase const & database,
+                                              std::string const & table,
+                                              std::string const & geometry) :
+        _geometryColumn(-1),
+        _statement(0),
+        _table(table)
+    {
+        this->_statement = prepareLayer(database.getDatabase()->getHandle(),
+                                        table,
+                                        geometry,
+                                        this->_geometryColumn);
+    }
+
+    VectorTileEncoder::LayerQuery::~LayerQuery()
+    {
+        sqlite3_finalize(this->_statement);
+    }
+
+    VectorTileEncoder::VectorTileEncoder(int extent, int buffer) :
+        _buffer(buffer),
+        _commands(),
+        _data(),
+        _extent(extent),
+        _feature(),
+        _features(0),
+        _keys(),
+        _keyIndex(),
+        _layer(),
+        _layerFeatures(-1),
+        _name(),
+        _tags(),
+        _values(),
+        _valueIndex()
+    {
+        if (extent < 1) throw std::runtime_error("Invalid tile extent!");
+        if (buffer < 0) throw std::runtime_error("Invalid tile buffer!");
+        this->_cursor[0] = 0;
+        this->_cursor[1] = 0;
+        this->_transform[0] = 0;
+        this->_transform[1] = 0;
+        this->_transform[2] = 1;
+    }
+
+    VectorTileEncoder::~VectorTileEncoder()
+    {
+    }
+
+    int VectorTileEncoder::addFeature(gaiaGeomCollPtr geometry,
+                                      sqlite3_int64 id)
+    {
+        if (this->_layerFeatures < 0) throw std::runtime_error("No layer begun!");
+        if (!geometry) return 0;
+        this->_tags.clear();
+        int count = 0;
+        const int types[] = {TYPE_POINT, TYPE_LINESTRING, TYPE_POLYGON};
+        for (int i = 0; i < 3; i++)
+        {
+            if (this->encodeGeometry(geometry, types[i]))
+            {
+                this->writeFeature(types[i], id);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    int VectorTileEncoder::addLayer(SpatialDatabase const & database,
+                                    std::string const & table,
+                                    std::string const & geometry,
+                                    int z,
+                                    int x,
+                                    int y,
+                                    std::string const & name)
+    {
+        LayerQuery query(database, table, geometry);
+        return this->addLayer(query, z, x, y, name);
+    }
+
+    int VectorTileEncoder::addLayer(LayerQuery & query,
+                                    int z,
+                                    int x,
+                                    int y,
+                                    std::string const & name)
+    {
+        this->beginLayer(name.empty() ? query._table : name, z, x, y);
+        bindTile(query._statement, z, x, y, this->_extent, this->_buffer);
+        this->addRows(query._statement, query._geometryColumn);
+        return this->endLayer();
+    }
+
+    int VectorTileEncoder::addRows(sqlite3_stmt * statement, int geometryColumn)
+    {
+        // ==================================================
+        // Key indices are fixed for the statement
+        // --------------------------------------------------
+        const int columns = sqlite3_column_count(statement);
+        std::vector<uint32_t> keys(columns, 0);
+        for (int i = 1; i < columns; i++)
+        {
+            if (i == geometryColumn) continue;
+            const std::string key = sqlite3_column_name(statement, i);
+            std::unordered_map<std::string, uint32_t>::iterator found =
+                this->_keyIndex.find(key);
+            if (found == this->_keyIndex.end())
+            {
+                found = this->_keyIndex.insert(
+                    std::make_pair(key, (uint32_t)this->_keys.size())).first;
+                this->_keys.push_back(key);
+            }
+            keys[i] = found->second;
+        }
+
+        int count = 0;
+        std::string value;
+        int result = SQLITE_ROW;
+        while ((result = sqlite3_step(statement)) == SQLITE_ROW)
+        {
+            if (sqlite3_column_type(statement, geometryColumn) != SQLITE_BLOB)
+            {
+                continue;
+            }
+            gaiaGeomCollPtr geometry = BlobEncoding::decode(
+                (const unsigned char *)sqlite3_column_blob(statement,
+                                                           geometryColumn),
+                sqlite3_column_bytes(statement, geometryColumn));
+            if (!geometry) continue;
+            const sqlite3_int64 id = sqlite3_column_int64(statement, 0);
+            bool tagged = false;
+
+            const int types[] = {TYPE_POINT, TYPE_LINESTRING, TYPE_POLYGON};
+            for (int t = 0; t < 3; t++)
+            {
+                if (!this->encodeGeometry(geometry, types[t])) continue;
+
+                // ==================================================
+                // Tag the feature once something survived clipping
+                // --------------------------------------------------
+                for (int i = 1; i < columns && !tagged; i++)
+                {
+                    if (i == geometryColumn) continue;
+                    value.clear();
+                    switch (sqlite3_column_type(statement, i))
+                    {
+                    case SQLITE_INTEGER:
+                        {
+                            const sqlite3_int64 v =
+                                sqlite3_column_int64(statement, i);
+                            if (v >= 0)
+                            {
+                                appendKey(value, 5, 0);
+                                appendVarint(value, (uint64_t)v);
+                            }
+                            else
+                            {
+                                appendKey(value, 6, 0);
+                                appendVarint(value,
+                                             ((uint64_t)v << 1) ^
+                                             (uint64_t)(v >> 63));
+                            }
+                        }
+                        break;
+                    case SQLITE_FLOAT:
+                        {
+                            const double v = sqlite3_column_double(statement, i);
+                            unsigned char bytes[8];
+                            uint64_t bits = 0;
+                            std::memcpy(&bits, &v, 8);
+                            for (int b = 0; b < 8; b++)
+                            {
+                                bytes[b] = (unsigned char)(bits >> (8 * b));
+                            }
+                            appendKey(value, 3, 1);
+                            value.append((const char *)bytes, 8);
+                        }
+                        break;
+                    case SQLITE_TEXT:
+                        appendBytes(value, 1,
+                                    (const char *)sqlite3_column_text(statement, i),
+                                    sqlite3_column_bytes(statement, i));
+                        break;
+                    default:
+                        continue;
+                    }
+                    std::unordered_map<std::string, uint32_t>::iterator found =
+                        this->_valueIndex.find(value);
+                    if (found == this->_valueIndex.end())
+                    {
+                        found = this->_valueIndex.insert(std::make_pair(
+                            value, (uint32_t)this->_values.size())).first;
+                        this->_values.push_back(value);
+                    }
+                    this->_tags.push_back(keys[i]);
+                    this->_tags.push_back(found->second);
+                }
+                tagged = true;
+                this->writeFeature(types[t], id);
+                count++;
+            }
+            this->_tags.clear();
+            gaiaFreeGeomColl(geometry);
+        }
+        if (result != SQLITE_DONE)
+        {
+            throw std::runtime_error("Failed to read table!");
+        }
+        return count;
+    }
+
+    void VectorTileEncoder::beginLayer(std::string const & name,
+                                       int z,
+                                       int x,
+                                       int y)
+    {
+        if (this->_layerFeatures >= 0)
+        {
+            throw std::runtime_error("Layer already begun!");
+        }
+        double minx = 0;
+        double miny = 0;
+        double maxx = 0;
+        double maxy = 0;
+        VectorTileEncoder::getBounds(z, x, y, minx, miny, maxx, maxy);
+        this->_transform[0] = minx;
+        this->_transform[1] = maxy;
+        this->_transform[2] = this->_extent / (maxx - minx);
+        this->_name = name;
+        this->_layerFeatures = 0;
+    }
+
+    void VectorTileEncoder::clear()
+    {
+        this->_data.clear();
+        this->_layer.clear();
+        this->_keys.clear();
+        this->_keyIndex.clear();
+        this->_values.clear();
+        this->_valueIndex.clear();
+        this->_layerFeatures = -1;
+        this->_features = 0;
+    }
+
+    bool VectorTileEncoder::encodeGeometry(gaiaGeomCollPtr geometry, int type)
+    {
+        this->_commands.clear();
+        this->_cursor[0] = 0;
+        this->_cursor[1] = 0;
+        const double low = -this->_buffer;
+        const double high = this->_extent + this->_buffer;
+
+        if (type == TYPE_POINT)
+        {
+            // One MoveTo with a parameter pair per point
+            this->_commands.push_back(0);
+            size_t count = 0;
+            for (gaiaPointPtr p = geometry->FirstPoint; p; p = p->Next)
+            {
+                const double px = (p->X - this->_transform[0]) * this->_transform[2];
+                const double py = (this->_transform[1] - p->Y) * this->_transform[2];
+                if (!(px >= low && px <= high && py >= low && py <= high))
+                {
+                    continue;
+                }
+                const int x = (int)std::floor(px + 0.5);
+                const int y = (int)std::floor(py + 0.5);
+                this->_commands.push_back(zigzag(x - this->_cursor[0]));
+                this->_commands.push_back(zigzag(y - this->_cursor[1]));
+                this->_cursor[0] = x;
+                this->_cursor[1] = y;
+                count++;
+            }
+            this->_commands[0] = command(MOVE_TO, count);
+            return count > 0;
+        }
+
+        if (type == TYPE_LINESTRING)
+        {
+            int parts = 0;
+            for (gaiaLinestringPtr l = geometry->FirstLinestring; l; l = l->Next)
+            {
+                parts += this->encodeLine(l->Coords, l->Points, l->DimensionModel);
+            }
+            return parts > 0;
+        }
+
+        // ==================================================
+        // Polygons are dropped with their exterior ring
+        // --------------------------------------------------
+        bool any = false;
+        for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+        {
+            const size_t mark = this->_commands.size();
+            const int cursor[2] = {this->_cursor[0], this->_cursor[1]};
+            if (!this->encodeRing(p->Exterior, true))
+            {
+                this->_commands.resize(mark);
+                this->_cursor[0] = cursor[0];
+                this->_cursor[1] = cursor[1];
+                continue;
+            }
+            for (int i = 0; i < p->NumInteriors; i++)
+            {
+                this->encodeRing(p->Interiors + i, false);
+            }
+            any = true;
+        }
+        return any;
+    }
+
+    int VectorTileEncoder::encodeLine(const double * coords,
+                                      int points,
+                                      int dimensions)
+    {
+        const int stride = CoordinateBuffer::getStride(dimensions);
+        const double low = -this->_buffer;
+        const double high = this->_extent + this->_buffer;
+        std::vector<double> & part = this->_scratch[0];
+        part.clear();
+        int parts = 0;
+        for (int i = 0; i + 1 < points; i++)
+        {
+            const double * a = coords + i * stride;
+            const double * b = a + stride;
+            double ax = (a[0] - this->_transform[0]) * this->_transform[2];
+            double ay = (this->_transform[1] - a[1]) * this->_transform[2];
+            double bx = (b[0] - this->_transform[0]) * this->_transform[2];
+            double by = (this->_transform[1] - b[1]) * this->_transform[2];
+            const size_t n = part.size();
+            if (!clipSegment(ax, ay, bx, by, low, high))
+            {
+                // Left the box: finish the current part
+                if (n) parts += appendPath(part, this->_scratch[1], PATH_LINE,
+                                           this->_cursor, this->_commands);
+                part.clear();
+                continue;
+            }
+
+            // Re-entered the box: the clipped start differs from the end
+            if (n && (part[n - 2] != ax || part[n - 1] != ay))
+            {
+                parts += appendPath(part, this->_scratch[1], PATH_LINE,
+                                    this->_cursor, this->_commands);
+                part.clear();
+            }
+            if (part.empty())
+            {
+                part.push_back(ax);
+                part.push_back(ay);
+            }
+            part.push_back(bx);
+            part.push_back(by);
+        }
+        if (!part.empty())
+        {
+            parts += appendPath(part, this->_scratch[1], PATH_LINE,
+                                this->_cursor, this->_commands);
+        }
+        return parts;
+    }
+
+    bool VectorTileEncoder::encodeRing(gaiaRingPtr ring, bool exterior)
+    {
+        const int stride = CoordinateBuffer::getStride(ring->DimensionModel);
+        const double low = -this->_buffer;
+        const double high = this->_extent + this->_buffer;
+        std::vector<double> & input = this->_scratch[0];
+        std::vector<double> & output = this->_scratch[1];
+
+        // ==================================================
+        // Transform, tracking the pixel bounds
+        // --------------------------------------------------
+        input.clear();
+        double bounds[4] = {DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX};
+        for (int i = 0; i < ring->Points; i++)
+        {
+            const double * c = ring->Coords + i * stride;
+            const double x = (c[0] - this->_transform[0]) * this->_transform[2];
+            const double y = (this->_transform[1] - c[1]) * this->_transform[2];
+            if (x < bounds[0]) bounds[0] = x;
+            if (y < bounds[1]) bounds[1] = y;
+            if (x > bounds[2]) bounds[2] = x;
+            if (y > bounds[3]) bounds[3] = y;
+            input.push_back(x);
+            input.push_back(y);
+        }
+        if (bounds[2] < low || bounds[0] > high ||
+            bounds[3] < low || bounds[1] > high)
+        {
+            return false;
+        }
+
+        // ==================================================
+        // Clip to the box only when it crosses an edge
+        // --------------------------------------------------
+        if (bounds[0] < low || bounds[2] > high ||
+            bounds[1] < low || bounds[3] > high)
+        {
+            clipEdge(input, output, 0, low, true);
+            clipEdge(output, input, 0, high, false);
+            clipEdge(input, output, 1, low, true);
+            clipEdge(output, input, 1, high, false);
+        }
+        return appendPath(input, this->_scratch[2],
+                          exterior ? PATH_EXTERIOR : PATH_INTERIOR,
+                          this->_cursor, this->_commands);
+    }
+
+    std::vector<std::string> VectorTileEncoder::encodeTiles(
+        SpatialDatabase const & database,
+        std::string const & table,
+        std::string const & geometry,
+        std::vector<Tile> const & tiles,
+        int threads,
+        int extent,
+        int buffer)
+    {
+        if (threads < 0) throw std::runtime_error("Invalid thread count!");
+        if (threads == 0) threads = (int)std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+        if ((size_t)threads > tiles.size()) threads = (int)tiles.size();
+        for (size_t i = 0; i < tiles.size(); i++)
+        {
+            double bounds[4];
+            getBounds(tiles[i].z, tiles[i].x, tiles[i].y,
+                      bounds[0], bounds[1], bounds[2], bounds[3]);
+        }
+
+        // ==================================================
+        // Workers need the database file to open their own connections
+        // --------------------------------------------------
+        sqlite3 * handle = database.getDatabase()->getHandle();
+        const char * file = sqlite3_db_filename(handle, "main");
+        const std::string filename = file ? file : "";
+        sqlite3 * shared = filename.empty() ? handle : 0;
+        if (shared && threads > 1) threads = 1;
+        {
+            // Fail early on a missing index or column
+            int geometryColumn = -1;
+            StatementGuard guard = {prepareLayer(handle, table, geometry,
+                                                 geometryColumn)};
+        }
+
+        std::vector<std::string> results(tiles.size());
+        std::atomic<size_t> next(0);
+        std::atomic<bool> failed(false);
+        std::mutex mutex;
+        std::string error;
+        auto work = [&]()
+        {
+            try
+            {
+                std::unique_ptr<SQLite::Database> connection;
+                if (!shared)
+                {
+                    connection.reset(new SQLite::Database(filename,
+                                                          SQLITE_OPEN_READONLY));
+                }
+                int geometryColumn = -1;
+                StatementGuard guard = {prepareLayer(
+                    shared ? shared : connection->getHandle(),
+                    table, geometry, geometryColumn)};
+                VectorTileEncoder encoder(extent, buffer);
+                for (;;)
+                {
+                    const size_t i = next++;
+                    if (i >= tiles.size() || failed) break;
+                    Tile const & tile = tiles[i];
+                    encoder.clear();
+                    encoder.beginLayer(table, tile.z, tile.x, tile.y);
+                    bindTile(guard.statement, tile.z, tile.x, tile.y,
+                             extent, buffer);
+                    encoder.addRows(guard.statement, geometryColumn);
+                    encoder.endLayer();
+                    results[i] = encoder.getData();
+                }
+            }
+            catch (std::exception & e)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failed) error = e.what();
+                failed = true;
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; i++) workers.push_back(std::thread(work));
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+        if (failed) throw std::runtime_error(error);
+        return results;
+    }
+
+    int VectorTileEncoder::endLayer()
+    {
+        if (this->_layerFeatures < 0) throw std::runtime_error("No layer begun!");
+        const int count = this->_layerFeatures;
+        if (count > 0)
+        {
+            // ==================================================
+            // Layer: version, name, features, keys, values, extent
+            // --------------------------------------------------
+            std::string & layer = this->_feature;
+            layer.clear();
+            appendKey(layer, 15, 0);
+            appendVarint(layer, 2);
+            appendBytes(layer, 1, this->_name.data(), this->_name.size());
+            layer.append(this->_layer);
+            for (size_t i = 0; i < this->_keys.size(); i++)
+            {
+                appendBytes(layer, 3, this->_keys[i].data(), this->_keys[i].size());
+            }
+            for (size_t i = 0; i < this->_values.size(); i++)
+            {
+                appendBytes(layer, 4, this->_values[i].data(),
+                            this->_values[i].size());
+            }
+            appendKey(layer, 5, 0);
+            appendVarint(layer, this->_extent);
+            appendBytes(this->_data, 3, layer.data(), layer.size());
+        }
+        this->_layer.clear();
+        this->_keys.clear();
+        this->_keyIndex.clear();
+        this->_values.clear();
+        this->_valueIndex.clear();
+        this->_layerFeatures = -1;
+        return count;
+    }
+
+    void VectorTileEncoder::getBounds(int z, int x, int y,
+                                      double & minx, double & miny,
+                                      double & maxx, double & maxy)
+    {
+        if (z < 0 || z > 30) throw std::runtime_error("Invalid tile!");
+        const int tiles = 1 << z;
+        if (x < 0 || x >= tiles || y < 0 || y >= tiles)
+        {
+            throw std::runtime_error("Invalid tile!");
+        }
+        const double size = 2 * WORLD / tiles;
+        minx = -WORLD + x * size;
+        maxx = -WORLD + (x + 1) * size;
+        maxy = WORLD - y * size;
+        miny = WORLD - (y + 1) * size;
+    }
+
+    int VectorTileEncoder::getBuffer() const
+    {
+        return this->_buffer;
+    }
+
+    std::string const & VectorTileEncoder::getData() const
+    {
+        return this->_data;
+    }
+
+    int VectorTileEncoder::getExtent() const
+    {
+        return this->_extent;
+    }
+
+    long long VectorTileEncoder::getFeatureCount() const
+    {
+        return this->_features;
+    }
+
+    void VectorTileEncoder::writeFeature(int type, sqlite3_int64 id)
+    {
+        std::string & feature = this->_feature;
+        feature.clear();
+        if (id >= 0)
+        {
+            appendKey(feature, 1, 0);
+            appendVarint(feature, (uint64_t)id);
+        }
+        if (!this->_tags.empty()) appendPacked(feature, 2, this->_tags);
+        appendKey(feature, 3, 0);
+        appendVarint(feature, type);
+        appendPacked(feature, 4, this->_commands);
+        appendBytes(this->_layer, 2, feature.data(), feature.size());
+        this->_layerFeatures++;
+        this->_features++;
+    }
+
+}
@@ -1,8 +1,114 @@
 #include "gtest/gtest.h"
 #include "SpatiaLiteCpp/SpatiaLiteCpp.h"
 
+#include <cstring>
+#include <vector>
+
 using namespace SpatiaLite;
 
+// Writes SpatiaLite BLOB fields in either byte order
+struct BlobWriter
+{
+    std::vector<unsigned char> bytes;
+    bool little;
+
+    explicit BlobWriter(bool little, int srid, int type, const double * box) :
+        little(little)
+    {
+        this->bytes.push_back(GAIA_MARK_START);
+        this->bytes.push_back(little ? GAIA_LITTLE_ENDIAN : GAIA_BIG_ENDIAN);
+        this->putInt(srid);
+        for (int i = 0; i < 4; i++) this->putDouble(box[i]);
+        this->bytes.push_back(GAIA_MARK_MBR);
+        this->putInt(type);
+    }
+
+    void put(unsigned long long value, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            const int shift = 8 * (this->little ? i : size - 1 - i);
+            this->bytes.push_back((unsigned char)(value >> shift));
+        }
+    }
+
+    void putInt(int value)
+    {
+        this->put((unsigned int)value, 4);
+    }
+
+    void putDouble(double value)
+    {
+        unsigned long long bits;
+        std::memcpy(&bits, &value, 8);
+        this->put(bits, 8);
+    }
+
+    void putCoords(const double * coords, int count)
+    {
+        for (int i = 0; i < count; i++) this->putDouble(coords[i]);
+    }
+
+    void putEntity(int type)
+    {
+        this->bytes.push_back(GAIA_MARK_ENTITY);
+        this->putInt(type);
+    }
+
+    const unsigned char * finish()
+    {
+        this->bytes.push_back(GAIA_MARK_END);
+        return &this->bytes[0];
+    }
+
+    int size() const
+    {
+        return (int)this->bytes.size();
+    }
+};
+
+// Compares the structure and coordinates of two geometries
+static void expectEqual(gaiaGeomCollPtr a, gaiaGeomCollPtr b)
+{
+    ASSERT_TRUE(a != 0);
+    ASSERT_TRUE(b != 0);
+    EXPECT_EQ(a->Srid, b->Srid);
+    EXPECT_EQ(a->DimensionModel, b->DimensionModel);
+    const int stride = CoordinateBuffer::getStride(a->DimensionModel);
+    gaiaPointPtr p = a->FirstPoint;
+    gaiaPointPtr q = b->FirstPoint;
+    for (; p && q; p = p->Next, q = q->Next)
+    {
+        EXPECT_EQ(p->X, q->X);
+        EXPECT_EQ(p->Y, q->Y);
+        EXPECT_EQ(p->Z, q->Z);
+        EXPECT_EQ(p->M, q->M);
+    }
+    EXPECT_TRUE(p == 0 && q == 0);
+    gaiaLinestringPtr l = a->FirstLinestring;
+    gaiaLinestringPtr m = b->FirstLinestring;
+    for (; l && m; l = l->Next, m = m->Next)
+    {
+        ASSERT_EQ(l->Points, m->Points);
+        EXPECT_EQ(std::memcmp(l->Coords, m->Coords, sizeof(double) * stride * l->Points), 0);
+    }
+    EXPECT_TRUE(l == 0 && m == 0);
+    gaiaPolygonPtr s = a->FirstPolygon;
+    gaiaPolygonPtr t = b->FirstPolygon;
+    for (; s && t; s = s->Next, t = t->Next)
+    {
+        ASSERT_EQ(s->NumInteriors, t->NumInteriors);
+        for (int i = -1; i < s->NumInteriors; i++)
+        {
+            gaiaRingPtr r = i < 0 ? s->Exterior : s->Interiors + i;
+            gaiaRingPtr u = i < 0 ? t->Exterior : t->Interiors + i;
+            ASSERT_EQ(r->Points, u->Points);
+            EXPECT_EQ(std::memcmp(r->Coords, u->Coords, sizeof(double) * stride * r->Points), 0);
+        }
+    }
+    EXPECT_TRUE(s == 0 && t == 0);
+}
+
 TEST(Blob, isCompressedBlobWkbValid)
 {
     BlobPtr point(Point::makePoint(4326, 0, 0));
@@ -27,6 +133,140 @@ TEST(Blob, isFgfInvalid)
     EXPECT_THROW(BlobPtr(Blob::toFgf(0, GAIA_XY)), std::runtime_error);
 }
 
+TEST(Blob, isFromSpatiaLiteBlobWkbValid)
+{
+    const double box[4] = {-1, -2, 10, 20};
+    const double ring[10] = {0, 0, 10, 0, 10, 10, 0, 10, 0, 0};
+    const double hole[8] = {1, 1, 2, 1, 2, 2, 1, 1};
+
+    // Same geometries as the gaia decoder
+    BlobPtr point(Point::makePoint(4326, 1.5, -2.5));
+    GeometryCollectionPtr reference(new GeometryCollection(
+        gaiaFromSpatiaLiteBlobWkb(point->get(), point->getSize())));
+    GeometryCollectionPtr decoded(new GeometryCollection(
+        Blob::fromSpatiaLiteBlobWkb(point->get(), point->getSize())));
+    expectEqual(decoded->get(), reference->get());
+    EXPECT_EQ(decoded->get()->DeclaredType, GAIA_POINT);
+
+    BlobWriter line(true, 3857, GAIA_LINESTRING, box);
+    line.putInt(5);
+    line.putCoords(ring, 10);
+    line.finish();
+    reference = GeometryCollectionPtr(new GeometryCollection(
+        gaiaFromSpatiaLiteBlobWkb(&line.bytes[0], line.size())));
+    decoded = GeometryCollectionPtr(new GeometryCollection(
+        Blob::fromSpatiaLiteBlobWkb(&line.bytes[0], line.size())));
+    expectEqual(decoded->get(), reference->get());
+    EXPECT_EQ(decoded->get()->DeclaredType, GAIA_LINESTRING);
+
+    BlobWriter polygon(true, 3857, GAIA_POLYGON, box);
+    polygon.putInt(2);
+    polygon.putInt(5);
+    polygon.putCoords(ring, 10);
+    polygon.putInt(4);
+    polygon.putCoords(hole, 8);
+    polygon.finish();
+    reference = GeometryCollectionPtr(new GeometryCollection(
+        gaiaFromSpatiaLiteBlobWkb(&polygon.bytes[0], polygon.size())));
+    decoded = GeometryCollectionPtr(new GeometryCollection(
+        Blob::fromSpatiaLiteBlobWkb(&polygon.bytes[0], polygon.size())));
+    expectEqual(decoded->get(), reference->get());
+
+    // Both byte orders give the same collection
+    const double zm[16] = {0, 0, 1, 2, 4, 0, 3, 4, 4, 4, 5, 6, 0, 0, 1, 2};
+    GeometryCollectionPtr collections[2];
+    for (int order = 0; order < 2; order++)
+    {
+        BlobWriter writer(order == 0, 4326, GAIA_GEOMETRYCOLLECTIONZM, box);
+        writer.putInt(3);
+        writer.putEntity(GAIA_POINTZM);
+        writer.putCoords(zm + 4, 4);
+        writer.putEntity(GAIA_LINESTRINGZM);
+        writer.putInt(3);
+        writer.putCoords(zm, 12);
+        writer.putEntity(GAIA_POLYGONZM);
+        writer.putInt(1);
+        writer.putInt(4);
+        writer.putCoords(zm, 16);
+        const unsigned char * blob = writer.finish();
+        collections[order] = GeometryCollectionPtr(new GeometryCollection(
+            Blob::fromSpatiaLiteBlobWkb(blob, writer.size())));
+        gaiaGeomCollPtr geometry = collections[order]->get();
+        ASSERT_TRUE(geometry != 0);
+        EXPECT_EQ(geometry->Srid, 4326);
+        EXPECT_EQ(geometry->DimensionModel, GAIA_XY_Z_M);
+        EXPECT_EQ(geometry->DeclaredType, GAIA_GEOMETRYCOLLECTION);
+        EXPECT_EQ(geometry->MinX, -1);
+        EXPECT_EQ(geometry->MaxY, 20);
+        ASSERT_TRUE(geometry->FirstPoint != 0);
+        EXPECT_EQ(geometry->FirstPoint->X, 4);
+        EXPECT_EQ(geometry->FirstPoint->M, 4);
+        ASSERT_TRUE(geometry->FirstLinestring != 0);
+        EXPECT_EQ(geometry->FirstLinestring->Points, 3);
+        EXPECT_EQ(geometry->FirstLinestring->Coords[6], 3);
+        ASSERT_TRUE(geometry->FirstPolygon != 0);
+        EXPECT_EQ(geometry->FirstPolygon->NumInteriors, 0);
+        EXPECT_EQ(geometry->FirstPolygon->Exterior->Coords[11], 6);
+    }
+    expectEqual(collections[0]->get(), collections[1]->get());
+
+    BlobWriter multi(false, 0, GAIA_MULTILINESTRINGM, box);
+    multi.putInt(2);
+    for (int i = 0; i < 2; i++)
+    {
+        multi.putEntity(GAIA_LINESTRINGM);
+        multi.putInt(2);
+        multi.putCoords(ring + 3 * i, 6);
+    }
+    multi.finish();
+    decoded = GeometryCollectionPtr(new GeometryCollection(
+        Blob::fromSpatiaLiteBlobWkb(&multi.bytes[0], multi.size())));
+    ASSERT_TRUE(decoded->get() != 0);
+    EXPECT_EQ(decoded->get()->DimensionModel, GAIA_XY_M);
+    EXPECT_EQ(decoded->get()->DeclaredType, GAIA_MULTILINESTRING);
+    ASSERT_TRUE(decoded->get()->LastLinestring != 0);
+    EXPECT_EQ(decoded->get()->LastLinestring->Coords[1], 10);
+    EXPECT_EQ(decoded->get()->LastLinestring->Coords[2], 10);
+    EXPECT_EQ(decoded->get()->LastLinestring->Coords[5], 0);
+}
+
+TEST(Blob, isFromSpatiaLiteBlobWkbInvalid)
+{
+    const double box[4] = {0, 0, 1, 1};
+    const double coords[3] = {0, 0, 0};
+    EXPECT_TRUE(Blob::fromSpatiaLiteBlobWkb(0, 60) == 0);
+
+    // Blobs that are not fully checked are left to the gaia decoder
+    BlobWriter marker(true, 0, GAIA_MULTIPOINTZ, box);
+    marker.putInt(1);
+    marker.putEntity(GAIA_POINTZ);
+    marker.putCoords(coords, 3);
+    marker.bytes[47] = 0x00;
+    marker.finish();
+    BlobWriter truncated(true, 0, GAIA_MULTILINESTRINGZ, box);
+    truncated.putInt(1);
+    truncated.putEntity(GAIA_LINESTRINGZ);
+    truncated.putInt(1 << 30);
+    truncated.putCoords(coords, 3);
+    truncated.finish();
+    BlobWriter header(true, 0, GAIA_POINT, box);
+    header.putCoords(coords, 2);
+    header.finish();
+    header.bytes[38] = 0x00;
+    BlobWriter * blobs[3] = {&marker, &truncated, &header};
+    for (int i = 0; i < 3; i++)
+    {
+        gaiaGeomCollPtr reference = gaiaFromSpatiaLiteBlobWkb(&blobs[i]->bytes[0],
+                                                              blobs[i]->size());
+        gaiaGeomCollPtr decoded = Blob::fromSpatiaLiteBlobWkb(&blobs[i]->bytes[0],
+                                                              blobs[i]->size());
+        EXPECT_EQ(decoded == 0, reference == 0);
+        if (decoded && reference) expectEqual(decoded, reference);
+        if (decoded) gaiaFreeGeomColl(decoded);
+        if (reference) gaiaFreeGeomColl(reference);
+    }
+}
+
 TEST(Blob, isHexWkbValid)
 {
     BlobPtr point(Point::makePoint(4326, 0, 0));
@@ -51,6 +291,132 @@ TEST(Blob, isSpatiaLiteBlobWkbInvalid)
     EXPECT_THROW(BlobPtr(Blob::toSpatiaLiteBlobWkb(0)), std::runtime_error);
 }
 
+TEST(Blob, isTwkbValid)
+{
+    // Reference encoding of LINESTRING(1 1, 5 5) at precision 0
+    const unsigned char expected[7] = {0x02, 0x00, 0x02, 0x02, 0x02, 0x08, 0x08};
+    GeometryCollectionPtr line(new GeometryCollection(gaiaAllocGeomColl()));
+    gaiaLinestringPtr coords = gaiaAddLinestringToGeomColl(line->get(), 2);
+    coords->Coords[0] = 1;
+    coords->Coords[1] = 1;
+    coords->Coords[2] = 5;
+    coords->Coords[3] = 5;
+    Blob::TwkbOptions options;
+    options.precision = 0;
+    BlobPtr twkb(Blob::toTwkb(line->get(), options));
+    ASSERT_EQ(twkb->getSize(), 7);
+    EXPECT_EQ(std::memcmp(twkb->get(), expected, 7), 0);
+
+    GeometryCollectionPtr decoded(new GeometryCollection(
+        Blob::fromTwkb(twkb->get(), twkb->getSize(), 4326)));
+    ASSERT_TRUE(decoded->get() != 0);
+    EXPECT_EQ(decoded->get()->Srid, 4326);
+    EXPECT_EQ(decoded->get()->DeclaredType, GAIA_LINESTRING);
+    EXPECT_DOUBLE_EQ(decoded->get()->FirstLinestring->Coords[2], 5);
+    EXPECT_DOUBLE_EQ(decoded->get()->MaxY, 5);
+
+    // Multi geometries with a bounding box and ids, appended to one buffer
+    GeometryCollectionPtr points(new GeometryCollection(gaiaAllocGeomCollXYZ()));
+    points->get()->DeclaredType = GAIA_MULTIPOINT;
+    gaiaAddPointToGeomCollXYZ(points->get(), 1.234567, -2.5, 10.25);
+    gaiaAddPointToGeomCollXYZ(points->get(), -3.5, 4.75, -1);
+    options.bbox = true;
+    options.precision = 3;
+    options.precisionZ = 2;
+    options.ids.push_back(42);
+    options.ids.push_back(-7);
+    std::vector<unsigned char> buffer;
+    Blob::toTwkb(points->get(), buffer, options);
+    const int first = (int)buffer.size();
+    options.ids.clear();
+    options.bbox = false;
+    options.precision = 0;
+    Blob::toTwkb(line->get(), buffer, options);
+    options.ids.push_back(1);
+    EXPECT_THROW(Blob::toTwkb(points->get(), buffer, options), std::runtime_error);
+    EXPECT_EQ((int)buffer.size(), first + 7);
+
+    int used = 0;
+    std::vector<sqlite3_int64> ids;
+    EXPECT_TRUE(Blob::fromTwkb(&buffer[0], (int)buffer.size()) == 0);
+    decoded.reset(new GeometryCollection(
+        Blob::fromTwkb(&buffer[0], (int)buffer.size(), 0, &used, &ids)));
+    ASSERT_TRUE(decoded->get() != 0);
+    EXPECT_EQ(used, first);
+    ASSERT_EQ(ids.size(), 2u);
+    EXPECT_EQ(ids[0], 42);
+    EXPECT_EQ(ids[1], -7);
+    EXPECT_EQ(decoded->get()->DeclaredType, GAIA_MULTIPOINT);
+    EXPECT_EQ(decoded->get()->DimensionModel, GAIA_XY_Z);
+    gaiaPointPtr point = decoded->get()->FirstPoint;
+    ASSERT_TRUE(point != 0 && point->Next != 0);
+    EXPECT_DOUBLE_EQ(point->X, 1.235);
+    EXPECT_DOUBLE_EQ(point->Z, 10.25);
+    EXPECT_DOUBLE_EQ(point->Next->Y, 4.75);
+    decoded.reset(new GeometryCollection(
+        Blob::fromTwkb(&buffer[first], (int)buffer.size() - first)));
+    ASSERT_TRUE(decoded->get() != 0);
+    EXPECT_DOUBLE_EQ(decoded->get()->FirstLinestring->Coords[3], 5);
+
+    // Truncated input is rejected
+    for (int size = 0; size < first; size++)
+    {
+        EXPECT_TRUE(Blob::fromTwkb(&buffer[0], size) == 0);
+    }
+}
+
+TEST(Blob, isTwkbCoordinateBufferValid)
+{
+    GeometryCollectionPtr polygon(new GeometryCollection(gaiaAllocGeomColl()));
+    gaiaPolygonPtr coords = gaiaAddPolygonToGeomColl(polygon->get(), 4, 1);
+    gaiaRingPtr hole = gaiaAddInteriorRing(coords, 0, 4);
+    const double exterior[8] = {0, 0, 10, 0, 0, 10, 0, 0};
+    const double interior[8] = {1, 1, 2, 1, 1, 2, 1, 1};
+    for (int i = 0; i < 8; i++)
+    {
+        coords->Exterior->Coords[i] = exterior[i];
+        hole->Coords[i] = interior[i];
+    }
+    gaiaAddPointToGeomColl(polygon->get(), 5, 6);
+    BlobPtr twkb(Blob::toTwkb(polygon->get()));
+
+    // Points land in the SoA arrays, with the start of each part
+    CoordinateBuffer buffer(GAIA_XY_Z);
+    std::vector<int> parts;
+    EXPECT_EQ(Blob::fromTwkb(twkb->get(), twkb->getSize(), buffer, &parts),
+              twkb->getSize());
+    ASSERT_EQ(buffer.getSize(), 9);
+    ASSERT_EQ(parts.size(), 3u);
+    EXPECT_EQ(parts[0], 0);
+    EXPECT_EQ(parts[1], 1);
+    EXPECT_EQ(parts[2], 5);
+    EXPECT_DOUBLE_EQ(buffer.getX()[0], 5);
+    EXPECT_DOUBLE_EQ(buffer.getY()[3], 10);
+    EXPECT_DOUBLE_EQ(buffer.getX()[6], 2);
+    EXPECT_DOUBLE_EQ(buffer.getZ()[6], 0);
+
+    // Failed decodes leave the buffer and parts as they were
+    EXPECT_EQ(Blob::fromTwkb(twkb->get(), twkb->getSize() - 1, buffer, &parts), 0);
+    EXPECT_EQ(buffer.getSize(), 9);
+    EXPECT_EQ(parts.size(), 3u);
+}
+
+TEST(Blob, isTwkbInvalid)
+{
+    EXPECT_THROW(BlobPtr(Blob::toTwkb(0)), std::runtime_error);
+    GeometryCollectionPtr point(new GeometryCollection(gaiaAllocGeomColl()));
+    gaiaAddPointToGeomColl(point->get(), 1, 2);
+    Blob::TwkbOptions options;
+    options.precision = 8;
+    EXPECT_THROW(BlobPtr(Blob::toTwkb(point->get(), options)), std::runtime_error);
+    options.precision = 0;
+    options.precisionZ = -1;
+    EXPECT_THROW(BlobPtr(Blob::toTwkb(point->get(), options)), std::runtime_error);
+    const unsigned char invalid[4] = {0x0F, 0x00, 0x02, 0x04};
+    EXPECT_TRUE(Blob::fromTwkb(invalid, 4) == 0);
+    EXPECT_TRUE(Blob::fromTwkb(0, 4) == 0);
+}
+
 TEST(Blob, isWkbValid)
 {
     BlobPtr point(Point::makePoint(4326, 0, 0));
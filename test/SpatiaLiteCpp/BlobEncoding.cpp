@@ -0,0 +1,195 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace SpatiaLite;
+
+// Square with a square hole, in degrees
+static gaiaGeomCollPtr makePolygon(double x, double y)
+{
+    const double exterior[10] = {x, y, x + 1, y, x + 1, y + 1, x, y + 1, x, y};
+    const double interior[10] = {x + 0.25, y + 0.25, x + 0.25, y + 0.75,
+                                 x + 0.75, y + 0.75, x + 0.75, y + 0.25,
+                                 x + 0.25, y + 0.25};
+    gaiaGeomCollPtr geometry = gaiaAllocGeomColl();
+    geometry->Srid = 4326;
+    geometry->DeclaredType = GAIA_POLYGON;
+    gaiaPolygonPtr polygon = gaiaAddPolygonToGeomColl(geometry, 5, 1);
+    gaiaRingPtr ring = gaiaAddInteriorRing(polygon, 0, 5);
+    for (int i = 0; i < 10; i++)
+    {
+        polygon->Exterior->Coords[i] = exterior[i];
+        ring->Coords[i] = interior[i];
+    }
+    return geometry;
+}
+
+TEST(BlobEncoding, isValid)
+{
+    EXPECT_THROW(BlobEncoding(-1), std::exception);
+    EXPECT_THROW(BlobEncoding(3), std::exception);
+    EXPECT_THROW(BlobEncoding(BlobEncoding::QUANTIZED, 8), std::exception);
+    BlobEncoding encoding(BlobEncoding::QUANTIZED, 5);
+    EXPECT_EQ(encoding.getMode(), BlobEncoding::QUANTIZED);
+    EXPECT_EQ(encoding.getPrecision(), 5);
+    EXPECT_THROW(BlobPtr(encoding.encode(0)), std::exception);
+    EXPECT_TRUE(BlobEncoding::decode(0, 0) == 0);
+}
+
+TEST(BlobEncoding, isQuantizedValid)
+{
+    gaiaGeomCollPtr polygon = makePolygon(12.3456789, -45.6789012);
+    BlobEncoding quantized(BlobEncoding::QUANTIZED, 4);
+    BlobPtr blob(quantized.encode(polygon));
+    BlobPtr plain(BlobEncoding(BlobEncoding::UNCOMPRESSED).encode(polygon));
+    EXPECT_LT(blob->getSize() * 3, plain->getSize());
+
+    // Readers decode quantized BLOBs
+    GeometryCollection decoded(*blob);
+    ASSERT_TRUE(decoded.get() != 0);
+    EXPECT_EQ(decoded.get()->Srid, 4326);
+    EXPECT_EQ(decoded.get()->DeclaredType, GAIA_POLYGON);
+    gaiaPolygonPtr result = decoded.get()->FirstPolygon;
+    ASSERT_TRUE(result != 0);
+    ASSERT_EQ(result->NumInteriors, 1);
+    ASSERT_EQ(result->Exterior->Points, 5);
+    for (int i = 0; i < 10; i++)
+    {
+        EXPECT_NEAR(result->Exterior->Coords[i],
+                    polygon->FirstPolygon->Exterior->Coords[i], 0.5e-4);
+        EXPECT_NEAR(result->Interiors[0].Coords[i],
+                    polygon->FirstPolygon->Interiors[0].Coords[i], 0.5e-4);
+    }
+    EXPECT_NEAR(decoded.get()->MinX, 12.3457, 1e-9);
+
+    // Truncated BLOBs are rejected
+    EXPECT_TRUE(BlobEncoding::decode(blob->get(), blob->getSize() - 1) == 0);
+
+    // So are BLOBs that only share the marker or lack room for the TWKB
+    std::vector<unsigned char> bytes(blob->get(), blob->get() + blob->getSize());
+    bytes.insert(bytes.end() - 1, 0);
+    EXPECT_TRUE(BlobEncoding::decode(&bytes[0], (int)bytes.size()) == 0);
+    const unsigned char shortBlob[4] = {0x80, 0x00, 0x01, 0xFE};
+    EXPECT_TRUE(BlobEncoding::decode(shortBlob, 4) == 0);
+    gaiaFreeGeomColl(polygon);
+
+    // Z values and mixed collections
+    gaiaGeomCollPtr mixed = gaiaAllocGeomCollXYZ();
+    mixed->Srid = 3857;
+    gaiaAddPointToGeomCollXYZ(mixed, 1.5, -2.5, 100);
+    gaiaLinestringPtr line = gaiaAddLinestringToGeomColl(mixed, 2);
+    const double coords[6] = {0, 0, 1, 10, 10, 2};
+    for (int i = 0; i < 6; i++) line->Coords[i] = coords[i];
+    blob = BlobPtr(BlobEncoding(BlobEncoding::QUANTIZED, 1).encode(mixed));
+    gaiaFreeGeomColl(mixed);
+    GeometryCollection collection(*blob);
+    ASSERT_TRUE(collection.get() != 0);
+    EXPECT_EQ(collection.get()->Srid, 3857);
+    EXPECT_EQ(collection.get()->DimensionModel, GAIA_XY_Z);
+    EXPECT_EQ(collection.get()->DeclaredType, GAIA_GEOMETRYCOLLECTION);
+    ASSERT_TRUE(collection.get()->FirstPoint != 0);
+    EXPECT_DOUBLE_EQ(collection.get()->FirstPoint->Z, 100);
+    EXPECT_DOUBLE_EQ(collection.get()->FirstPoint->Y, -2.5);
+    ASSERT_TRUE(collection.get()->FirstLinestring != 0);
+    EXPECT_DOUBLE_EQ(collection.get()->FirstLinestring->Coords[5], 2);
+}
+
+TEST(BlobEncoding, isSelectValid)
+{
+    BlobEncoding::Statistics statistics = {10, {1000, 950, 900}, {0, 0, 0}, 0};
+    EXPECT_EQ(BlobEncoding::select(statistics), BlobEncoding::UNCOMPRESSED);
+    statistics.bytes[BlobEncoding::COMPRESSED] = 700;
+    EXPECT_EQ(BlobEncoding::select(statistics), BlobEncoding::COMPRESSED);
+    statistics.bytes[BlobEncoding::QUANTIZED] = 650;
+    EXPECT_EQ(BlobEncoding::select(statistics), BlobEncoding::COMPRESSED);
+    statistics.bytes[BlobEncoding::QUANTIZED] = 300;
+    EXPECT_EQ(BlobEncoding::select(statistics), BlobEncoding::QUANTIZED);
+    EXPECT_EQ(BlobEncoding::select(statistics, 0.8), BlobEncoding::UNCOMPRESSED);
+
+    // Lossy samples need an error budget
+    statistics.maxError = 1e-3;
+    EXPECT_EQ(BlobEncoding::select(statistics), BlobEncoding::COMPRESSED);
+    EXPECT_EQ(BlobEncoding::select(statistics, 0.1, 1e-4), BlobEncoding::COMPRESSED);
+    EXPECT_EQ(BlobEncoding::select(statistics, 0.1, 1e-3), BlobEncoding::QUANTIZED);
+}
+
+TEST(BlobEncoding, isApplyValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                           "geom BLOB)");
+    SQLite::Statement insert(*db.getDatabase(),
+                             "INSERT INTO test (geom) VALUES (?)");
+    for (int i = 0; i < 2000; i++)
+    {
+        if (i % 10 == 0)
+        {
+            insert.bind(1);
+        }
+        else
+        {
+            gaiaGeomCollPtr polygon = makePolygon(i * 0.01, i * 0.02);
+            BlobPtr blob(Blob::toSpatiaLiteBlobWkb(polygon));
+            gaiaFreeGeomColl(polygon);
+            insert.bind(1, blob->get(), blob->getSize());
+        }
+        insert.exec();
+        insert.reset();
+    }
+
+    BlobEncoding::Statistics statistics =
+        BlobEncoding::measure(db, "test", "geom", 6, 500);
+    EXPECT_EQ(statistics.geometries, 450);
+    EXPECT_LT(statistics.bytes[BlobEncoding::QUANTIZED],
+              statistics.bytes[BlobEncoding::UNCOMPRESSED]);
+    EXPECT_LE(statistics.maxError, 0.5e-6);
+    EXPECT_GE(statistics.decodeTime[BlobEncoding::QUANTIZED], 0);
+    EXPECT_EQ(BlobEncoding::select(statistics, 0.1, 1e-6), BlobEncoding::QUANTIZED);
+
+    BlobEncoding encoding(BlobEncoding::select(statistics, 0.1, 1e-6), 6);
+    BlobEncoding::Report report = encoding.apply(db, "test", "geom");
+    EXPECT_EQ(report.rows, 1800);
+    EXPECT_LT(report.bytesAfter, report.bytesBefore);
+
+    // Rows still read back, and a second pass changes nothing
+    SQLite::Statement select(*db.getDatabase(),
+                             "SELECT geom FROM test WHERE PK = 2");
+    ASSERT_TRUE(select.executeStep());
+    GeometryCollection geometry(select.getColumn(0));
+    ASSERT_TRUE(geometry.get() != 0);
+    EXPECT_NEAR(geometry.get()->FirstPolygon->Exterior->Coords[0], 0.01, 1e-9);
+    select.reset();
+    report = encoding.apply(db, "test", "geom");
+    EXPECT_EQ(report.rows, 1800);
+    EXPECT_EQ(report.bytesAfter, report.bytesBefore);
+
+    EXPECT_THROW(encoding.apply(db, "test", "missing"), std::exception);
+}
+
+TEST(BlobEncoding, isApplyRegisteredInvalid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    db.getDatabase()->exec("SELECT InitSpatialMetadata(1)");
+    db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY)");
+    db.getDatabase()->exec("SELECT AddGeometryColumn('test', 'geom', 4326, 'POLYGON', 2)");
+    db.getDatabase()->exec("SELECT CreateSpatialIndex('test', 'geom')");
+    gaiaGeomCollPtr polygon = makePolygon(1, 2);
+    BlobPtr blob(Blob::toSpatiaLiteBlobWkb(polygon));
+    gaiaFreeGeomColl(polygon);
+    SQLite::Statement insert(*db.getDatabase(), "INSERT INTO test (geom) VALUES (?)");
+    insert.bind(1, blob->get(), blob->getSize());
+    insert.exec();
+
+    // Registered columns keep SpatiaLite BLOBs
+    EXPECT_THROW(BlobEncoding(BlobEncoding::QUANTIZED, 6).apply(db, "test", "GEOM"),
+                 std::runtime_error);
+    EXPECT_EQ(BlobEncoding(BlobEncoding::COMPRESSED).apply(db, "test", "geom").rows, 1);
+    SQLite::Statement indexed(*db.getDatabase(),
+                              "SELECT count(*) FROM idx_test_geom "
+                              "WHERE xmin <= 1.5 AND xmax >= 1.5");
+    ASSERT_TRUE(indexed.executeStep());
+    EXPECT_EQ(indexed.getColumn(0).getInt(), 1);
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+using namespace SpatiaLite;
+
+TEST(CoordinateBuffer, isValid)
+{
+    EXPECT_NO_THROW(CoordinateBufferPtr(new CoordinateBuffer(GAIA_XY_Z_M, 10)));
+}
+
+TEST(CoordinateBuffer, isDimensionsInvalid)
+{
+    EXPECT_THROW(CoordinateBufferPtr(new CoordinateBuffer(-1)), std::runtime_error);
+}
+
+TEST(CoordinateBuffer, isAppendValid)
+{
+    CoordinateBufferPtr buffer(new CoordinateBuffer(GAIA_XY_M));
+    for (int i = 0; i < 100; i++)
+    {
+        buffer->append(i, 2 * i, 3 * i, 4 * i);
+    }
+    EXPECT_EQ(buffer->getSize(), 100);
+    EXPECT_GE(buffer->getCapacity(), 100);
+    EXPECT_EQ(buffer->getX()[99], 99);
+    EXPECT_EQ(buffer->getY()[99], 198);
+    EXPECT_TRUE(buffer->getZ() == 0);
+    EXPECT_EQ(buffer->getM()[99], 396);
+}
+
+TEST(CoordinateBuffer, isTruncateValid)
+{
+    CoordinateBufferPtr buffer(new CoordinateBuffer(GAIA_XY, 8));
+    for (int i = 0; i < 5; i++) buffer->append(i, i);
+    buffer->truncate(10);
+    EXPECT_EQ(buffer->getSize(), 5);
+    buffer->truncate(2);
+    EXPECT_EQ(buffer->getSize(), 2);
+    EXPECT_EQ(buffer->getCapacity(), 8);
+    buffer->append(7, 8);
+    EXPECT_EQ(buffer->getX()[2], 7);
+}
+
+TEST(CoordinateBuffer, isLineStringValid)
+{
+    LineStringPtr line(new LineString(gaiaAllocLinestringXYZ(3)));
+    double coords[] = {0, 0, 1, 3, 4, 2, 3, 0, 3};
+    std::copy(coords, coords + 9, line->get()->Coords);
+    CoordinateBufferPtr buffer(CoordinateBuffer::fromLineString(line->get()));
+    EXPECT_EQ(buffer->getSize(), 3);
+    EXPECT_EQ(buffer->getDimensions(), GAIA_XY_Z);
+    EXPECT_DOUBLE_EQ(buffer->getLength(), 9);
+    LineStringPtr copy(buffer->toLineString());
+    EXPECT_EQ(copy->get()->Points, 3);
+    EXPECT_TRUE(std::equal(coords, coords + 9, copy->get()->Coords));
+}
+
+TEST(CoordinateBuffer, isRingValid)
+{
+    RingPtr ring(new Ring(gaiaAllocRing(5)));
+    double coords[] = {0, 0, 2, 0, 2, 3, 0, 3, 0, 0};
+    std::copy(coords, coords + 10, ring->get()->Coords);
+    CoordinateBufferPtr buffer(CoordinateBuffer::fromRing(ring->get()));
+    EXPECT_DOUBLE_EQ(buffer->getArea(), 6);
+    double minx = 0, miny = 0, maxx = 0, maxy = 0;
+    EXPECT_TRUE(buffer->getBounds(minx, miny, maxx, maxy));
+    EXPECT_EQ(maxx, 2);
+    EXPECT_EQ(maxy, 3);
+    RingPtr copy(buffer->toRing());
+    EXPECT_TRUE(std::equal(coords, coords + 10, copy->get()->Coords));
+}
+
+TEST(CoordinateBuffer, isDynamicLineValid)
+{
+    DynamicLinePtr line(new DynamicLine(gaiaAllocDynamicLine()));
+    gaiaAppendPointToDynamicLine(line->get(), 0, 0);
+    gaiaAppendPointToDynamicLine(line->get(), 3, 4);
+    CoordinateBufferPtr buffer(CoordinateBuffer::fromDynamicLine(line->get()));
+    EXPECT_EQ(buffer->getSize(), 2);
+    EXPECT_DOUBLE_EQ(buffer->getLength(), 5);
+}
+
+TEST(CoordinateBuffer, isTransformValid)
+{
+    CoordinateBufferPtr buffer(new CoordinateBuffer());
+    buffer->append(1, 2);
+    buffer->transform(2, 0, 0, 3, 10, 20);
+    EXPECT_EQ(buffer->getX()[0], 12);
+    EXPECT_EQ(buffer->getY()[0], 26);
+}
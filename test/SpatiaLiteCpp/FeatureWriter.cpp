@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cstdio>
+#include <string>
+
+using namespace SpatiaLite;
+
+static std::string readAll(FILE * file)
+{
+    std::string text;
+    char chunk[256];
+    std::fseek(file, 0, SEEK_SET);
+    size_t count = 0;
+    while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        text.append(chunk, count);
+    }
+    return text;
+}
+
+static void makeTable(SpatialDatabase & db)
+{
+    db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                           "name TEXT, value REAL, geom BLOB)");
+    double x[] = {1, 2};
+    double y[] = {3, 4};
+    PointBatchPtr batch(PointBatch::create(4326, x, y, 2));
+    batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+    db.getDatabase()->exec("UPDATE test SET name = 'a\"<b>', value = 0.5 "
+                           "WHERE PK = 1");
+    db.getDatabase()->exec("INSERT INTO test (name) VALUES ('none')");
+}
+
+TEST(FeatureWriter, isValid)
+{
+    FILE * file = std::tmpfile();
+    ASSERT_TRUE(file != 0);
+    EXPECT_THROW(FeatureWriter(-1, FeatureWriter::GEOJSON), std::exception);
+    EXPECT_THROW(FeatureWriter(fileno(file), 7), std::exception);
+    EXPECT_THROW(FeatureWriter(fileno(file), FeatureWriter::WKT, 6, 0),
+                 std::exception);
+
+    FeatureWriter writer(fileno(file), FeatureWriter::GEOJSON, 1);
+    EXPECT_EQ(writer.getCapacity(), 64u * 1024u);
+    gaiaGeomCollPtr point = gaiaAllocGeomColl();
+    gaiaAddPointToGeomColl(point, 1.25, 2.5);
+    writer.begin();
+    writer.write(point);
+    writer.write(0);
+    writer.finish();
+    gaiaFreeGeomColl(point);
+    EXPECT_EQ(writer.getFeatureCount(), 2);
+    EXPECT_EQ(writer.getWrites(), 1);
+    std::string text = readAll(file);
+    EXPECT_EQ((long long)text.size(), writer.getBytes());
+    EXPECT_EQ(text.find("{\"type\":\"FeatureCollection\",\"features\":["), 0u);
+    EXPECT_NE(text.find("\"coordinates\":[1.2,2.5]"), std::string::npos);
+    EXPECT_NE(text.find(",\n{\"type\":\"Feature\",\"geometry\":null"),
+              std::string::npos);
+    EXPECT_EQ(text.substr(text.size() - 4), "\n]}\n");
+    std::fclose(file);
+}
+
+TEST(FeatureWriter, isTableValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    makeTable(db);
+
+    // GeoJSON with escaped properties
+    FILE * json = std::tmpfile();
+    FeatureWriter geojson(fileno(json), FeatureWriter::GEOJSON);
+    EXPECT_EQ(geojson.writeTable(db, "test", "geom"), 3);
+    std::string text = readAll(json);
+    EXPECT_NE(text.find("\"properties\":{\"PK\":1,\"name\":\"a\\\"<b>\","
+                        "\"value\":0.5}"), std::string::npos);
+    EXPECT_NE(text.find("\"geometry\":null,\"properties\":{\"PK\":3,"
+                        "\"name\":\"none\",\"value\":null}"),
+              std::string::npos);
+    std::fclose(json);
+
+    // KML with extended data
+    FILE * kml = std::tmpfile();
+    FeatureWriter placemarks(fileno(kml), FeatureWriter::KML);
+    EXPECT_EQ(placemarks.writeTable(db, "test", "geom"), 3);
+    text = readAll(kml);
+    EXPECT_NE(text.find("<Document><name>test</name>"), std::string::npos);
+    EXPECT_NE(text.find("<Data name=\"name\"><value>a&quot;&lt;b&gt;</value>"),
+              std::string::npos);
+    EXPECT_NE(text.find("<Point><coordinates>2.000000,4.000000"),
+              std::string::npos);
+    EXPECT_NE(text.find("</Document></kml>"), std::string::npos);
+    std::fclose(kml);
+
+    // GML feature members
+    FILE * gml = std::tmpfile();
+    FeatureWriter members(fileno(gml), FeatureWriter::GML);
+    EXPECT_EQ(members.writeTable(db, "test", "geom"), 3);
+    text = readAll(gml);
+    EXPECT_NE(text.find("<gml:featureMember><test><geometryProperty>"
+                        "<gml:Point>"), std::string::npos);
+    EXPECT_NE(text.find("<PK>1</PK><name>a&quot;&lt;b&gt;</name>"
+                        "<value>0.5</value></test>"), std::string::npos);
+    std::fclose(gml);
+
+    // WKT table
+    FILE * wkt = std::tmpfile();
+    FeatureWriter rows(fileno(wkt), FeatureWriter::WKT, 1);
+    EXPECT_EQ(rows.writeTable(db, "test", "GEOM"), 3);
+    text = readAll(wkt);
+    EXPECT_EQ(text, "WKT\tPK\tname\tvalue\n"
+                    "POINT(1.0 3.0)\t1\ta\"<b>\t0.5\n"
+                    "POINT(2.0 4.0)\t2\t\t\n"
+                    "\t3\tnone\t\n");
+    EXPECT_THROW(rows.writeTable(db, "test", "none"), std::exception);
+    EXPECT_THROW(rows.writeTable(db, "none", "geom"), std::exception);
+    std::fclose(wkt);
+}
+
+TEST(FeatureWriter, isStreamValid)
+{
+    // A tiny buffer forces many flushes and direct writes of large pieces
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    makeTable(db);
+    FILE * large = std::tmpfile();
+    FeatureWriter reference(fileno(large), FeatureWriter::KML);
+    reference.writeTable(db, "test", "geom");
+    FILE * small = std::tmpfile();
+    FeatureWriter streamed(fileno(small), FeatureWriter::KML, 6, 16);
+    streamed.writeTable(db, "test", "geom");
+    EXPECT_EQ(readAll(large), readAll(small));
+    EXPECT_EQ(reference.getWrites(), 1);
+    EXPECT_GT(streamed.getWrites(), 10);
+    EXPECT_EQ(streamed.getBytes(), reference.getBytes());
+    std::fclose(large);
+    std::fclose(small);
+}
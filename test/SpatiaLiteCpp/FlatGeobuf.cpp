@@ -0,0 +1,349 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace SpatiaLite;
+
+// Table of 500 squares, points and NULL geometries with properties
+static void makeTable(SpatialDatabase & db)
+{
+    db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                           "name TEXT, value REAL, geom BLOB)");
+    SQLite::Statement insert(*db.getDatabase(),
+                             "INSERT INTO test (name, value, geom) "
+                             "VALUES (?, ?, ?)");
+    for (int i = 0; i < 500; i++)
+    {
+        const double x = (i * 37) % 100;
+        const double y = (i * 61) % 100;
+        if (i % 7 == 0)
+        {
+            insert.bind(1);
+        }
+        else
+        {
+            insert.bind(1, "feature " + std::to_string(i));
+        }
+        insert.bind(2, i * 0.5);
+        if (i % 50 == 0)
+        {
+            insert.bind(3);
+        }
+        else
+        {
+            gaiaGeomCollPtr geometry = gaiaAllocGeomColl();
+            geometry->Srid = 3857;
+            if (i % 2)
+            {
+                geometry->DeclaredType = GAIA_POINT;
+                gaiaAddPointToGeomColl(geometry, x, y);
+            }
+            else
+            {
+                const double coords[10] = {x, y, x + 2, y, x + 2, y + 2, x, y + 2, x, y};
+                geometry->DeclaredType = GAIA_POLYGON;
+                gaiaPolygonPtr polygon = gaiaAddPolygonToGeomColl(geometry, 5, 0);
+                for (int j = 0; j < 10; j++) polygon->Exterior->Coords[j] = coords[j];
+            }
+            BlobPtr blob(Blob::toSpatiaLiteBlobWkb(geometry));
+            gaiaFreeGeomColl(geometry);
+            insert.bind(3, blob->get(), blob->getSize());
+        }
+        insert.exec();
+        insert.reset();
+    }
+}
+
+// Searches a window and compares with the feature geometries
+static void expectSearch(FlatGeobuf const & file,
+                         double minx, double miny, double maxx, double maxy)
+{
+    std::vector<unsigned long long> found;
+    std::vector<unsigned long long> expected;
+    for (unsigned long long feature = 0; feature < file.getFeaturesSize();
+         feature = file.next(feature))
+    {
+        gaiaGeomCollPtr geometry = file.getGeometry(feature);
+        if (!geometry) continue;
+        if (geometry->MinX <= maxx && geometry->MinY <= maxy &&
+            geometry->MaxX >= minx && geometry->MaxY >= miny)
+        {
+            expected.push_back(feature);
+        }
+        gaiaFreeGeomColl(geometry);
+    }
+    EXPECT_EQ(file.search(minx, miny, maxx, maxy, found), expected.size());
+    EXPECT_EQ(found, expected);
+}
+
+TEST(FlatGeobuf, isExportValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    makeTable(db);
+    EXPECT_EQ(FlatGeobuf::exportTable(db, "test", "geom", "flatgeobuf.fgb", 8), 500);
+
+    FILE * raw = std::fopen("flatgeobuf.fgb", "rb");
+    ASSERT_TRUE(raw != 0);
+    unsigned char magic[8] = {0};
+    EXPECT_EQ(std::fread(magic, 1, 8, raw), 8u);
+    std::fclose(raw);
+    EXPECT_EQ(std::memcmp(magic, "fgb\3fgb", 8), 0);
+
+    FlatGeobufPtr file(FlatGeobuf::open("flatgeobuf.fgb"));
+    EXPECT_EQ(file->getName(), "test");
+    EXPECT_EQ(file->getCount(), 500u);
+    EXPECT_EQ(file->getNodeSize(), 8);
+    EXPECT_EQ(file->getSrid(), 3857);
+    EXPECT_EQ(file->getDimensions(), GAIA_XY);
+    EXPECT_EQ(file->getGeometryType(), 0);
+    ASSERT_EQ(file->getColumns().size(), 3u);
+    EXPECT_EQ(file->getColumns()[0].name, "PK");
+    EXPECT_EQ(file->getColumns()[0].type, FlatGeobuf::LONG);
+    EXPECT_EQ(file->getColumns()[1].type, FlatGeobuf::STRING);
+    EXPECT_EQ(file->getColumns()[2].type, FlatGeobuf::DOUBLE);
+    double minx = 0, miny = 0, maxx = 0, maxy = 0;
+    ASSERT_TRUE(file->getBounds(minx, miny, maxx, maxy));
+    EXPECT_DOUBLE_EQ(minx, 1);
+    EXPECT_DOUBLE_EQ(maxx, 100);
+
+    size_t features = 0;
+    size_t empty = 0;
+    for (unsigned long long feature = 0; feature < file->getFeaturesSize();
+         feature = file->next(feature))
+    {
+        gaiaGeomCollPtr geometry = file->getGeometry(feature);
+        features++;
+        if (!geometry)
+        {
+            empty++;
+            continue;
+        }
+        EXPECT_EQ(geometry->Srid, 3857);
+        EXPECT_TRUE(geometry->DeclaredType == GAIA_POINT ||
+                    geometry->DeclaredType == GAIA_POLYGON);
+        gaiaFreeGeomColl(geometry);
+    }
+    EXPECT_EQ(features, 500u);
+    EXPECT_EQ(empty, 10u);
+
+    expectSearch(*file, 10, 10, 30, 40);
+    expectSearch(*file, 99.5, 99.5, 200, 200);
+    expectSearch(*file, -10, -10, -5, -5);
+    expectSearch(*file, -1000, -1000, 1000, 1000);
+    file = FlatGeobufPtr();
+
+    // Without an index every feature is scanned
+    EXPECT_EQ(FlatGeobuf::exportTable(db, "test", "geom", "flatgeobuf.fgb", 0), 500);
+    file = FlatGeobufPtr(FlatGeobuf::open("flatgeobuf.fgb"));
+    EXPECT_EQ(file->getNodeSize(), 0);
+    expectSearch(*file, 10, 10, 30, 40);
+
+    EXPECT_THROW(FlatGeobuf::exportTable(db, "test", "missing", "flatgeobuf.fgb"),
+                 std::runtime_error);
+    EXPECT_THROW(FlatGeobuf::exportTable(db, "test", "geom", "flatgeobuf.fgb", 1),
+                 std::runtime_error);
+    file = FlatGeobufPtr();
+    std::remove("flatgeobuf.fgb");
+}
+
+TEST(FlatGeobuf, isImportValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    makeTable(db);
+    EXPECT_EQ(FlatGeobuf::exportTable(db, "test", "geom", "flatgeobuf.fgb"), 500);
+    FlatGeobufPtr file(FlatGeobuf::open("flatgeobuf.fgb"));
+    EXPECT_EQ(file->importTable(db, "copy", "shape"), 500);
+
+    SQLite::Statement select(*db.getDatabase(),
+                             "SELECT t.name, t.value, t.geom, c.name, c.value, c.shape "
+                             "FROM test AS t JOIN copy AS c ON c.PK = t.PK");
+    int rows = 0;
+    while (select.executeStep())
+    {
+        rows++;
+        EXPECT_EQ(select.getColumn(0).isNull(), select.getColumn(3).isNull());
+        if (!select.getColumn(0).isNull())
+        {
+            EXPECT_STREQ(select.getColumn(0).getText(), select.getColumn(3).getText());
+        }
+        EXPECT_DOUBLE_EQ(select.getColumn(1).getDouble(), select.getColumn(4).getDouble());
+        ASSERT_EQ(select.getColumn(2).isNull(), select.getColumn(5).isNull());
+        if (select.getColumn(2).isNull()) continue;
+        GeometryCollection source(select.getColumn(2));
+        GeometryCollection copy(select.getColumn(5));
+        ASSERT_TRUE(source.get() != 0);
+        ASSERT_TRUE(copy.get() != 0);
+        EXPECT_EQ(copy.get()->Srid, 3857);
+        EXPECT_DOUBLE_EQ(copy.get()->MinX, source.get()->MinX);
+        EXPECT_DOUBLE_EQ(copy.get()->MaxY, source.get()->MaxY);
+    }
+    EXPECT_EQ(rows, 500);
+    file = FlatGeobufPtr();
+    std::remove("flatgeobuf.fgb");
+}
+
+TEST(FlatGeobuf, isImportRegistered)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    db.getDatabase()->exec("SELECT InitSpatialMetadata(1)");
+    makeTable(db);
+    EXPECT_EQ(FlatGeobuf::exportTable(db, "test", "geom", "flatgeobuf.fgb"), 500);
+    FlatGeobufPtr file(FlatGeobuf::open("flatgeobuf.fgb"));
+    EXPECT_EQ(file->importTable(db, "copy", "shape"), 500);
+
+    SQLite::Statement registered(*db.getDatabase(),
+                                 "SELECT srid FROM geometry_columns WHERE "
+                                 "f_table_name = 'copy' AND "
+                                 "f_geometry_column = 'shape'");
+    ASSERT_TRUE(registered.executeStep());
+    EXPECT_EQ(registered.getColumn(0).getInt(), 3857);
+    EXPECT_TRUE(db.getDatabase()->tableExists("idx_copy_shape"));
+    SQLite::Statement indexed(*db.getDatabase(),
+                              "SELECT count(*) FROM idx_copy_shape");
+    ASSERT_TRUE(indexed.executeStep());
+    EXPECT_EQ(indexed.getColumn(0).getInt(), 490);
+    file = FlatGeobufPtr();
+    std::remove("flatgeobuf.fgb");
+}
+
+// Compares the points of two geometries
+static void expectEqual(gaiaGeomCollPtr actual, gaiaGeomCollPtr expected)
+{
+    ASSERT_TRUE(actual != 0);
+    EXPECT_EQ(actual->DimensionModel, expected->DimensionModel);
+    const int stride = CoordinateBuffer::getStride(expected->DimensionModel);
+    gaiaPointPtr p = actual->FirstPoint;
+    for (gaiaPointPtr q = expected->FirstPoint; q; q = q->Next, p = p->Next)
+    {
+        ASSERT_TRUE(p != 0);
+        EXPECT_DOUBLE_EQ(p->X, q->X);
+        EXPECT_DOUBLE_EQ(p->Z, q->Z);
+    }
+    EXPECT_TRUE(p == 0);
+    gaiaLinestringPtr l = actual->FirstLinestring;
+    for (gaiaLinestringPtr m = expected->FirstLinestring; m; m = m->Next, l = l->Next)
+    {
+        ASSERT_TRUE(l != 0);
+        ASSERT_EQ(l->Points, m->Points);
+        for (int i = 0; i < m->Points * stride; i++)
+        {
+            EXPECT_DOUBLE_EQ(l->Coords[i], m->Coords[i]);
+        }
+    }
+    EXPECT_TRUE(l == 0);
+    gaiaPolygonPtr a = actual->FirstPolygon;
+    for (gaiaPolygonPtr b = expected->FirstPolygon; b; b = b->Next, a = a->Next)
+    {
+        ASSERT_TRUE(a != 0);
+        ASSERT_EQ(a->NumInteriors, b->NumInteriors);
+        for (int r = -1; r < b->NumInteriors; r++)
+        {
+            gaiaRingPtr x = r < 0 ? a->Exterior : a->Interiors + r;
+            gaiaRingPtr y = r < 0 ? b->Exterior : b->Interiors + r;
+            ASSERT_EQ(x->Points, y->Points);
+            for (int i = 0; i < y->Points * stride; i++)
+            {
+                EXPECT_DOUBLE_EQ(x->Coords[i], y->Coords[i]);
+            }
+        }
+    }
+    EXPECT_TRUE(a == 0);
+}
+
+// Z geometry with consecutive integer coordinates
+static void fill(double * coords, int values, double first)
+{
+    for (int i = 0; i < values; i++) coords[i] = first + i;
+}
+
+TEST(FlatGeobuf, isQueryValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+
+    // Z geometries of every kind, including a mixed collection
+    std::vector<GeometryCollectionPtr> sources;
+    gaiaGeomCollPtr lines = gaiaAllocGeomCollXYZ();
+    lines->DeclaredType = GAIA_MULTILINESTRING;
+    fill(gaiaAddLinestringToGeomColl(lines, 2)->Coords, 6, 0);
+    fill(gaiaAddLinestringToGeomColl(lines, 3)->Coords, 9, 10);
+    sources.push_back(GeometryCollectionPtr(new GeometryCollection(lines)));
+    gaiaGeomCollPtr polygons = gaiaAllocGeomCollXYZ();
+    polygons->DeclaredType = GAIA_MULTIPOLYGON;
+    gaiaPolygonPtr polygon = gaiaAddPolygonToGeomColl(polygons, 4, 1);
+    fill(polygon->Exterior->Coords, 12, 20);
+    fill(gaiaAddInteriorRing(polygon, 0, 4)->Coords, 12, 40);
+    fill(gaiaAddPolygonToGeomColl(polygons, 4, 0)->Exterior->Coords, 12, 60);
+    sources.push_back(GeometryCollectionPtr(new GeometryCollection(polygons)));
+    gaiaGeomCollPtr mixed = gaiaAllocGeomCollXYZ();
+    mixed->DeclaredType = GAIA_GEOMETRYCOLLECTION;
+    gaiaAddPointToGeomCollXYZ(mixed, 9, 9, 9);
+    fill(gaiaAddLinestringToGeomColl(mixed, 2)->Coords, 6, 80);
+    sources.push_back(GeometryCollectionPtr(new GeometryCollection(mixed)));
+    gaiaGeomCollPtr points = gaiaAllocGeomCollXYZ();
+    points->DeclaredType = GAIA_MULTIPOINT;
+    gaiaAddPointToGeomCollXYZ(points, 1, 2, 3);
+    gaiaAddPointToGeomCollXYZ(points, 4, 5, 6);
+    sources.push_back(GeometryCollectionPtr(new GeometryCollection(points)));
+
+    db.getDatabase()->exec("CREATE TABLE source (geom BLOB)");
+    SQLite::Statement insert(*db.getDatabase(), "INSERT INTO source VALUES (?)");
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        sources[i]->get()->Srid = 4326;
+        BlobPtr blob(BlobEncoding(BlobEncoding::QUANTIZED, 3).encode(sources[i]->get()));
+        insert.bind(1, blob->get(), blob->getSize());
+        insert.exec();
+        insert.reset();
+    }
+
+    sqlite3_stmt * cursor = 0;
+    ASSERT_EQ(sqlite3_prepare_v2(db.getDatabase()->getHandle(),
+                                 "SELECT rowid * 2 AS id, geom FROM source",
+                                 -1, &cursor, 0), SQLITE_OK);
+    EXPECT_EQ(FlatGeobuf::exportQuery(cursor, 1, "flatgeobuf.fgb", "mixed", 2), 4);
+    sqlite3_finalize(cursor);
+
+    FlatGeobufPtr file(FlatGeobuf::open("flatgeobuf.fgb"));
+    EXPECT_EQ(file->getName(), "mixed");
+    EXPECT_EQ(file->getDimensions(), GAIA_XY_Z);
+    EXPECT_EQ(file->getSrid(), 4326);
+    EXPECT_EQ(file->getGeometryType(), 0);
+    ASSERT_EQ(file->getColumns().size(), 1u);
+    EXPECT_EQ(file->getColumns()[0].type, FlatGeobuf::LONG);
+    std::vector<unsigned long long> features;
+    EXPECT_EQ(file->search(-100, -100, 100, 100, features), 4u);
+    for (size_t i = 0; i < features.size(); i++)
+    {
+        sqlite3_stmt * statement = 0;
+        ASSERT_EQ(sqlite3_prepare_v2(db.getDatabase()->getHandle(),
+                                     "SELECT ?", -1, &statement, 0), SQLITE_OK);
+        file->bindProperties(features[i], statement);
+        ASSERT_EQ(sqlite3_step(statement), SQLITE_ROW);
+        const int id = sqlite3_column_int(statement, 0);
+        sqlite3_finalize(statement);
+        ASSERT_TRUE(id >= 2 && id <= 8);
+
+        GeometryCollection decoded(file->getGeometry(features[i]));
+        gaiaGeomCollPtr source = sources[id / 2 - 1]->get();
+        EXPECT_EQ(decoded.get()->DeclaredType, source->DeclaredType);
+        EXPECT_EQ(decoded.get()->DimensionModel, GAIA_XY_Z);
+        EXPECT_EQ(decoded.get()->Srid, 4326);
+        expectEqual(decoded.get(), source);
+    }
+    expectSearch(*file, 39.5, 40.5, 45, 45);
+    expectSearch(*file, 0, 0, 4.5, 4.5);
+    file = FlatGeobufPtr();
+
+    // Not a FlatGeobuf file
+    const unsigned char header[12] = {'f', 'g', 'b', 3, 'f', 'g', 'b', 0, 0xFF, 0xFF, 0, 0};
+    FILE * raw = std::fopen("flatgeobuf.fgb", "wb");
+    std::fwrite(header, 1, sizeof(header), raw);
+    std::fclose(raw);
+    EXPECT_THROW(FlatGeobuf::open("flatgeobuf.fgb"), std::runtime_error);
+    std::remove("flatgeobuf.fgb");
+    EXPECT_THROW(FlatGeobuf::open("flatgeobuf.fgb"), std::runtime_error);
+}
@@ -0,0 +1,188 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <clocale>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace SpatiaLite;
+
+static std::string readAll(FILE * file)
+{
+    std::string text;
+    char chunk[4096];
+    std::fseek(file, 0, SEEK_SET);
+    size_t count = 0;
+    while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        text.append(chunk, count);
+    }
+    return text;
+}
+
+static std::string format(double value, int precision)
+{
+    char text[32];
+    return std::string(text, GeoJsonExporter::formatNumber(value, precision, text));
+}
+
+static std::string exportTable(SpatialDatabase const & db,
+                               GeoJsonExporter const & exporter,
+                               long long & count)
+{
+    FILE * file = std::tmpfile();
+    count = exporter.exportTable(db, "test", "geom", fileno(file));
+    std::string text = readAll(file);
+    std::fclose(file);
+    return text;
+}
+
+TEST(GeoJsonExporter, isFormatValid)
+{
+    EXPECT_EQ(format(0, 6), "0");
+    EXPECT_EQ(format(-0.0000001, 6), "0");
+    EXPECT_EQ(format(1.5, 6), "1.5");
+    EXPECT_EQ(format(-12.25, 1), "-12.3");
+    EXPECT_EQ(format(0.000123, 6), "0.000123");
+    EXPECT_EQ(format(123456.0, 3), "123456");
+    EXPECT_EQ(format(2.0000004, 6), "2");
+    EXPECT_EQ(format(0.1, -1), "0.1");
+    EXPECT_EQ(format(1.0 / 3.0, -1), "0.3333333333333333");
+    EXPECT_EQ(format(1e300, 6), "1e+300");
+    EXPECT_EQ(format(1e-7, -1), "1e-07");
+    EXPECT_EQ(format(123456789.123456789, -1), "123456789.12345679");
+    EXPECT_EQ(format(5e-324, -1), "5e-324");
+    EXPECT_EQ(format(1.7976931348623157e308, -1), "1.7976931348623157e+308");
+    EXPECT_EQ(format(12345678901.987654, 2), "12345678901.99");
+    EXPECT_EQ(format(99999999999999.99, 1), "100000000000000");
+    EXPECT_EQ(format(900000000000000.12, 1), "900000000000000.1");
+    EXPECT_EQ(format(123456789012345.67, 1), "123456789012345.7");
+    EXPECT_EQ(format(1.0 / 0.0, 6), "null");
+    EXPECT_THROW(GeoJsonExporter(-1), std::exception);
+    EXPECT_THROW(GeoJsonExporter(1, 16), std::exception);
+    EXPECT_THROW(GeoJsonExporter(1, 6, 0), std::exception);
+}
+
+TEST(GeoJsonExporter, isExportValid)
+{
+    const char * filename = "geojsonexporter.sqlite";
+    std::remove(filename);
+    {
+        SpatialDatabase db(filename, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                               "name TEXT, geom BLOB)");
+        std::vector<double> x;
+        std::vector<double> y;
+        for (int i = 0; i < 1000; i++)
+        {
+            x.push_back(i * 0.5);
+            y.push_back(-i * 0.25);
+        }
+        PointBatchPtr batch(PointBatch::create(4326, &x[0], &y[0], x.size()));
+        batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+        db.getDatabase()->exec("UPDATE test SET name = 'row\"' || PK");
+        db.getDatabase()->exec("DELETE FROM test WHERE PK BETWEEN 100 AND 399");
+        db.getDatabase()->exec("INSERT INTO test (name) VALUES ('empty')");
+
+        // Reference single worker, one chunk
+        long long count = 0;
+        GeoJsonExporter single(1, 2, 1000000);
+        std::string reference = exportTable(db, single, count);
+        EXPECT_EQ(count, 701);
+        EXPECT_EQ(reference.find("{\"type\":\"FeatureCollection\",\"features\":[\n"
+                                 "{\"type\":\"Feature\",\"geometry\":"
+                                 "{\"type\":\"Point\",\"coordinates\":[0,0]},"
+                                 "\"properties\":{\"PK\":1,\"name\":\"row\\\"1\"}},\n"),
+                  0u);
+        EXPECT_NE(reference.find("\"coordinates\":[0.5,-0.25]},"
+                                 "\"properties\":{\"PK\":2,"), std::string::npos);
+        EXPECT_NE(reference.find("\"geometry\":null,\"properties\":{\"PK\":1001,"
+                                 "\"name\":\"empty\"}}\n]}\n"), std::string::npos);
+        EXPECT_EQ(reference.find("\"PK\":100,"), std::string::npos);
+
+        // Many small chunks over several workers keep the same order
+        GeoJsonExporter parallel(4, 2, 7);
+        EXPECT_EQ(parallel.getThreadCount(), 4);
+        EXPECT_EQ(exportTable(db, parallel, count), reference);
+        EXPECT_EQ(count, 701);
+
+        // Rowids spanning the whole 64-bit range split by row count
+        db.getDatabase()->exec("INSERT INTO test (PK, name) VALUES "
+                               "(-9223372036854775807, 'low'), "
+                               "(9223372036854775807, 'high')");
+        reference = exportTable(db, single, count);
+        EXPECT_EQ(count, 703);
+        EXPECT_EQ(exportTable(db, parallel, count), reference);
+        EXPECT_EQ(count, 703);
+        EXPECT_NE(reference.find("\"PK\":9223372036854775807,"), std::string::npos);
+
+        // Empty tables still produce a collection
+        db.getDatabase()->exec("DELETE FROM test");
+        EXPECT_EQ(exportTable(db, parallel, count),
+                  "{\"type\":\"FeatureCollection\",\"features\":[\n]}\n");
+        EXPECT_EQ(count, 0);
+        EXPECT_THROW(parallel.exportTable(db, "test", "none", 1), std::exception);
+        EXPECT_THROW(parallel.exportTable(db, "none", "geom", 1), std::exception);
+    }
+    std::remove(filename);
+}
+
+TEST(GeoJsonExporter, isMemoryValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.getDatabase()->exec("CREATE TABLE test (geom BLOB, value REAL)");
+    double x[] = {1.125, 2};
+    double y[] = {3, 4.75};
+    PointBatchPtr batch(PointBatch::create(4326, x, y, 2));
+    batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+    db.getDatabase()->exec("UPDATE test SET value = rowid / 4.0");
+    long long count = 0;
+    GeoJsonExporter exporter(8, -1, 1);
+    std::string text = exportTable(db, exporter, count);
+    EXPECT_EQ(count, 2);
+    EXPECT_NE(text.find("[1.125,3]},\"properties\":{\"value\":0.25}},\n"
+                        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\","
+                        "\"coordinates\":[2,4.75]},\"properties\":{\"value\":0.5}}"),
+              std::string::npos);
+}
+
+TEST(GeoJsonExporter, isLocaleValid)
+{
+    // Numbers stay valid JSON under a comma decimal locale
+    const char * names[] = {"de_DE.UTF-8", "de_DE.utf8", "de_DE",
+                            "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR"};
+    const std::string previous = std::setlocale(LC_NUMERIC, 0);
+    bool comma = false;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]) && !comma; i++)
+    {
+        comma = std::setlocale(LC_NUMERIC, names[i]) &&
+                *std::localeconv()->decimal_point == ',';
+    }
+    if (!comma)
+    {
+        // No comma locale installed
+        std::setlocale(LC_NUMERIC, previous.c_str());
+        return;
+    }
+    EXPECT_EQ(format(1.5, -1), "1.5");
+    EXPECT_EQ(format(-0.001953125, -1), "-0.001953125");
+    EXPECT_EQ(format(2.5e-10, -1), "2.5e-10");
+    EXPECT_EQ(format(1.25e20, 2), "1.25e+20");
+
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.getDatabase()->exec("CREATE TABLE test (geom BLOB, value REAL)");
+    double x[] = {1.5};
+    double y[] = {-2.25};
+    PointBatchPtr batch(PointBatch::create(4326, x, y, 1));
+    batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+    db.getDatabase()->exec("UPDATE test SET value = 0.1");
+    long long count = 0;
+    GeoJsonExporter exporter(1, -1);
+    std::string text = exportTable(db, exporter, count);
+    std::setlocale(LC_NUMERIC, previous.c_str());
+    EXPECT_EQ(count, 1);
+    EXPECT_NE(text.find("\"coordinates\":[1.5,-2.25]},"
+                        "\"properties\":{\"value\":0.1}}"),
+              std::string::npos);
+}
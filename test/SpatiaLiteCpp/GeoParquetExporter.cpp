@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace SpatiaLite;
+
+static std::string readFile(const char * filename)
+{
+    std::string bytes;
+    FILE * file = std::fopen(filename, "rb");
+    if (!file) return bytes;
+    char chunk[4096];
+    size_t count = 0;
+    while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        bytes.append(chunk, count);
+    }
+    std::fclose(file);
+    return bytes;
+}
+
+TEST(GeoParquetExporter, isValid)
+{
+    EXPECT_THROW(GeoParquetExporter(-1), std::exception);
+    EXPECT_THROW(GeoParquetExporter(1, 0), std::exception);
+    GeoParquetExporter exporter(3, 100);
+    EXPECT_EQ(exporter.getThreadCount(), 3);
+    EXPECT_EQ(exporter.getRowGroupSize(), 100);
+    EXPECT_GT(GeoParquetExporter().getThreadCount(), 0);
+}
+
+TEST(GeoParquetExporter, isExportValid)
+{
+    const char * filename = "geoparquetexporter.sqlite";
+    const char * output = "geoparquetexporter.parquet";
+    std::remove(filename);
+    {
+        SpatialDatabase db(filename, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                               "name TEXT, geom BLOB, value REAL)");
+        std::vector<double> x;
+        std::vector<double> y;
+        for (int i = 0; i < 1000; i++)
+        {
+            x.push_back(i * 0.5);
+            y.push_back(-i * 0.25);
+        }
+        PointBatchPtr batch(PointBatch::create(3857, &x[0], &y[0], x.size()));
+        batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+        db.getDatabase()->exec("UPDATE test SET name = 'row' || PK, value = PK / 2.0");
+        db.getDatabase()->exec("DELETE FROM test WHERE PK BETWEEN 100 AND 399");
+        db.getDatabase()->exec("INSERT INTO test (name) VALUES ('empty')");
+
+        // Reference single worker, one row group
+        EXPECT_EQ(GeoParquetExporter(1, 1000000).exportTable(db, "test", "geom", output),
+                  701);
+        GeoParquetScannerPtr scanner(GeoParquetScanner::open(output));
+        EXPECT_EQ(scanner->getRowCount(), 701);
+        EXPECT_EQ(scanner->getRowGroupCount(), 1);
+        ASSERT_EQ(scanner->getColumns().size(), 8u);
+        EXPECT_EQ(scanner->getColumns()[0].name, "PK");
+        EXPECT_EQ(scanner->getColumns()[0].type, GeoParquetScanner::INT64);
+        EXPECT_EQ(scanner->getColumns()[1].type, GeoParquetScanner::BYTE_ARRAY);
+        EXPECT_EQ(scanner->getColumns()[2].name, "geom");
+        EXPECT_EQ(scanner->getColumns()[3].type, GeoParquetScanner::DOUBLE);
+        EXPECT_EQ(scanner->getColumns()[4].name, "bbox.xmin");
+        EXPECT_EQ(scanner->getGeometryColumn(), 2);
+        const std::string & geo = scanner->getGeoMetadata();
+        EXPECT_NE(geo.find("\"primary_column\":\"geom\""), std::string::npos);
+        EXPECT_NE(geo.find("\"encoding\":\"WKB\""), std::string::npos);
+        EXPECT_NE(geo.find("\"bbox\":[0,-249.75,499.5,0]"), std::string::npos);
+        EXPECT_NE(geo.find("\"crs\":null,\"srid\":3857"), std::string::npos);
+        scanner = GeoParquetScannerPtr();
+
+        // Many small row groups over several workers
+        EXPECT_EQ(GeoParquetExporter(1, 64).exportTable(db, "test", "geom", output), 701);
+        const std::string reference = readFile(output);
+        GeoParquetExporter parallel(4, 64);
+        EXPECT_EQ(parallel.exportTable(db, "test", "geom", output), 701);
+        EXPECT_EQ(readFile(output), reference);
+        scanner = GeoParquetScannerPtr(GeoParquetScanner::open(output));
+        EXPECT_EQ(scanner->getRowCount(), 701);
+
+        // Row groups hold equal row counts despite the rowid gap
+        EXPECT_EQ(scanner->getRowGroupCount(), 11);
+        EXPECT_EQ(scanner->getRowGroupRows(0), 64);
+        EXPECT_EQ(scanner->getRowGroupRows(10), 61);
+        long long rows = 0;
+        double sum = 0;
+        sqlite3_int64 previous = 0;
+        GeoParquetScanner::ColumnData data;
+        for (int g = 0; g < scanner->getRowGroupCount(); g++)
+        {
+            rows += scanner->getRowGroupRows(g);
+            scanner->readColumn(g, 0, data);
+            for (size_t i = 0; i < data.integers.size(); i++)
+            {
+                EXPECT_GT(data.integers[i], previous);
+                previous = data.integers[i];
+            }
+            scanner->readColumn(g, 3, data);
+            for (size_t i = 0; i < data.doubles.size(); i++) sum += data.doubles[i];
+        }
+        EXPECT_EQ(rows, 701);
+        EXPECT_EQ(previous, 1001);
+        SQLite::Statement total(*db.getDatabase(), "SELECT SUM(value) FROM test");
+        ASSERT_TRUE(total.executeStep());
+        EXPECT_DOUBLE_EQ(sum, total.getColumn(0).getDouble());
+        scanner = GeoParquetScannerPtr();
+
+        // Empty tables still produce a valid file
+        db.getDatabase()->exec("DELETE FROM test");
+        EXPECT_EQ(parallel.exportTable(db, "test", "geom", output), 0);
+        scanner = GeoParquetScannerPtr(GeoParquetScanner::open(output));
+        EXPECT_EQ(scanner->getRowCount(), 0);
+        EXPECT_EQ(scanner->getRowGroupCount(), 0);
+        EXPECT_NE(scanner->getGeoMetadata().find("\"crs\":null"), std::string::npos);
+        scanner = GeoParquetScannerPtr();
+        EXPECT_THROW(parallel.exportTable(db, "test", "none", output), std::exception);
+        EXPECT_THROW(parallel.exportTable(db, "none", "geom", output), std::exception);
+    }
+    std::remove(filename);
+    std::remove(output);
+}
+
+TEST(GeoParquetExporter, isMemoryValid)
+{
+    const char * output = "geoparquetexporter.parquet";
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.getDatabase()->exec("CREATE TABLE test (geom BLOB, value REAL)");
+    double x[] = {1.125, 2};
+    double y[] = {3, 4.75};
+    PointBatchPtr batch(PointBatch::create(4326, x, y, 2));
+    batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+    db.getDatabase()->exec("UPDATE test SET value = rowid / 4.0");
+    EXPECT_EQ(GeoParquetExporter(8, 1).exportTable(db, "test", "geom", output), 2);
+    GeoParquetScannerPtr scanner(GeoParquetScanner::open(output));
+    EXPECT_EQ(scanner->getRowGroupCount(), 2);
+    EXPECT_EQ(scanner->getGeometryColumn(), 0);
+
+    // EPSG:4326 is the default CRS and is not written
+    EXPECT_EQ(scanner->getGeoMetadata().find("\"crs\""), std::string::npos);
+    double minx = 0, miny = 0, maxx = 0, maxy = 0;
+    ASSERT_TRUE(scanner->getRowGroupBounds(1, minx, miny, maxx, maxy));
+    EXPECT_DOUBLE_EQ(minx, 2);
+    EXPECT_DOUBLE_EQ(maxy, 4.75);
+    GeoParquetScanner::ColumnData data;
+    scanner->readColumn(1, 1, data);
+    ASSERT_EQ(data.doubles.size(), 1u);
+    EXPECT_DOUBLE_EQ(data.doubles[0], 0.5);
+    scanner = GeoParquetScannerPtr();
+    std::remove(output);
+}
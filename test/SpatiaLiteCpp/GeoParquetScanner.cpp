@@ -0,0 +1,167 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace SpatiaLite;
+
+// Exports 300 rows of every column type in row groups of 50
+static void makeFile(const char * output)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                           "name VARCHAR(20), value DOUBLE, data BLOB, "
+                           "created DATE, geom BLOB)");
+    SQLite::Statement insert(*db.getDatabase(),
+                             "INSERT INTO test (name, value, data, created, geom) "
+                             "VALUES (?, ?, ?, ?, ?)");
+    for (int i = 0; i < 300; i++)
+    {
+        if (i % 4 == 0) insert.bind(1);
+        else insert.bind(1, "name" + std::to_string(i));
+        if (i % 5 == 0) insert.bind(2);
+        else insert.bind(2, i * 0.25);
+        const unsigned char bytes[3] = {(unsigned char)i, 0, 7};
+        insert.bind(3, bytes, 3);
+        insert.bind(4, "2015-01-01");
+        if (i % 9 == 0)
+        {
+            insert.bind(5);
+        }
+        else
+        {
+            double x = i;
+            double y = 100 - i;
+            PointBatchPtr point(PointBatch::create(3857, &x, &y, 1));
+            insert.bind(5, point->getBlob(0), point->getRecordSize());
+        }
+        insert.exec();
+        insert.reset();
+    }
+    EXPECT_EQ(GeoParquetExporter(2, 50).exportTable(db, "test", "geom", output), 300);
+}
+
+TEST(GeoParquetScanner, isReadValid)
+{
+    const char * output = "geoparquetscanner.parquet";
+    makeFile(output);
+    GeoParquetScannerPtr scanner(GeoParquetScanner::open(output));
+    EXPECT_EQ(scanner->getRowCount(), 300);
+    ASSERT_EQ(scanner->getRowGroupCount(), 6);
+    EXPECT_EQ(scanner->findColumn("name"), 1);
+    EXPECT_EQ(scanner->findColumn("bbox.ymax"), 9);
+    EXPECT_EQ(scanner->findColumn("missing"), -1);
+    std::vector<GeoParquetScanner::Column> const & columns = scanner->getColumns();
+    ASSERT_EQ(columns.size(), 10u);
+    EXPECT_EQ(columns[1].type, GeoParquetScanner::BYTE_ARRAY);
+    EXPECT_EQ(columns[2].type, GeoParquetScanner::DOUBLE);
+    EXPECT_EQ(columns[3].type, GeoParquetScanner::BYTE_ARRAY);
+    EXPECT_EQ(columns[4].type, GeoParquetScanner::BYTE_ARRAY);
+    EXPECT_EQ(columns[0].maxLevel, 1);
+    EXPECT_EQ(columns[6].maxLevel, 1);
+
+    GeoParquetScanner::ColumnData data;
+    for (int g = 0; g < scanner->getRowGroupCount(); g++)
+    {
+        EXPECT_EQ(scanner->getRowGroupRows(g), 50);
+        scanner->readColumn(g, 1, data);
+        ASSERT_EQ(data.valid.size(), 50u);
+        ASSERT_EQ(data.bytes.size(), 50u);
+        for (int i = 0; i < 50; i++)
+        {
+            const int row = g * 50 + i;
+            EXPECT_EQ(data.valid[i] != 0, row % 4 != 0);
+            if (!data.valid[i]) continue;
+            EXPECT_EQ(std::string((const char *)data.bytes[i], data.sizes[i]),
+                      "name" + std::to_string(row));
+        }
+        scanner->readColumn(g, 2, data);
+        ASSERT_EQ(data.doubles.size(), 50u);
+        for (int i = 0; i < 50; i++)
+        {
+            const int row = g * 50 + i;
+            EXPECT_EQ(data.valid[i] != 0, row % 5 != 0);
+            if (data.valid[i])
+            {
+                EXPECT_DOUBLE_EQ(data.doubles[i], row * 0.25);
+            }
+        }
+        scanner->readColumn(g, 3, data);
+        ASSERT_EQ(data.sizes.size(), 50u);
+        EXPECT_EQ(data.sizes[7], 3u);
+        EXPECT_EQ(data.bytes[7][0], (unsigned char)(g * 50 + 7));
+        scanner->readColumn(g, 5, data);
+        for (int i = 0; i < 50; i++)
+        {
+            EXPECT_EQ(data.valid[i] != 0, (g * 50 + i) % 9 != 0);
+        }
+    }
+    EXPECT_THROW(scanner->readColumn(6, 0, data), std::exception);
+    EXPECT_THROW(scanner->readColumn(0, 10, data), std::exception);
+    EXPECT_THROW(scanner->getRowGroupRows(-1), std::exception);
+    scanner = GeoParquetScannerPtr();
+    std::remove(output);
+}
+
+TEST(GeoParquetScanner, isSelectValid)
+{
+    const char * output = "geoparquetscanner.parquet";
+    makeFile(output);
+    GeoParquetScannerPtr scanner(GeoParquetScanner::open(output));
+
+    // Row groups whose boxes hold a row inside the window
+    const double window[4] = {120, -90, 160, 0};
+    std::vector<int> expected;
+    GeoParquetScanner::ColumnData bbox[4];
+    for (int g = 0; g < scanner->getRowGroupCount(); g++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            scanner->readColumn(g, scanner->findColumn(i % 2 ? (i < 2 ? "bbox.ymin" : "bbox.ymax")
+                                                             : (i < 2 ? "bbox.xmin" : "bbox.xmax")),
+                                bbox[i]);
+        }
+        for (size_t r = 0; r < bbox[0].valid.size(); r++)
+        {
+            if (bbox[0].valid[r] &&
+                bbox[0].doubles[r] <= window[2] && bbox[1].doubles[r] <= window[3] &&
+                bbox[2].doubles[r] >= window[0] && bbox[3].doubles[r] >= window[1])
+            {
+                expected.push_back(g);
+                break;
+            }
+        }
+    }
+    std::vector<int> groups;
+    EXPECT_EQ(scanner->selectRowGroups(window[0], window[1], window[2], window[3], groups),
+              expected.size());
+    EXPECT_EQ(groups, expected);
+    EXPECT_EQ(groups.size(), 2u);
+    groups.clear();
+    EXPECT_EQ(scanner->selectRowGroups(-10, -1000, 1000, 1000, groups), 6u);
+    groups.clear();
+    EXPECT_EQ(scanner->selectRowGroups(500, 500, 600, 600, groups), 0u);
+
+    double minx = 0, miny = 0, maxx = 0, maxy = 0;
+    ASSERT_TRUE(scanner->getRowGroupBounds(0, minx, miny, maxx, maxy));
+    EXPECT_DOUBLE_EQ(minx, 1);
+    EXPECT_DOUBLE_EQ(maxx, 49);
+    EXPECT_DOUBLE_EQ(miny, 51);
+    EXPECT_DOUBLE_EQ(maxy, 99);
+    scanner = GeoParquetScannerPtr();
+
+    // Not Parquet, or cut short
+    FILE * file = std::fopen(output, "wb");
+    std::fputs("PAR1 not a footer PAR1", file);
+    std::fclose(file);
+    EXPECT_THROW(GeoParquetScanner::open(output), std::runtime_error);
+    file = std::fopen(output, "wb");
+    std::fputs("not parquet", file);
+    std::fclose(file);
+    EXPECT_THROW(GeoParquetScanner::open(output), std::runtime_error);
+    std::remove(output);
+    EXPECT_THROW(GeoParquetScanner::open(output), std::runtime_error);
+}
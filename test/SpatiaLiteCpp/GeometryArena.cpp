@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+using namespace SpatiaLite;
+
+static void setSquare(double * coords, double size)
+{
+    double square[] = {0, 0, size, 0, size, size, 0, size, 0, 0};
+    for (int i = 0; i < 10; i++) coords[i] = square[i];
+}
+
+TEST(GeometryArena, isValid)
+{
+    GeometryArena arena;
+    EXPECT_EQ(arena.getBlockCount(), 0);
+    EXPECT_EQ(arena.getBytesUsed(), 0u);
+    gaiaGeomCollPtr geometry = arena.allocGeomColl(GAIA_XY, 4326);
+    EXPECT_EQ(geometry->Srid, 4326);
+    EXPECT_EQ(geometry->DimensionModel, GAIA_XY);
+    EXPECT_TRUE(geometry->FirstPoint == 0);
+    EXPECT_EQ(arena.getBlockCount(), 1);
+    EXPECT_THROW(arena.allocGeomColl(-1), std::runtime_error);
+}
+
+TEST(GeometryArena, isTreeValid)
+{
+    GeometryArena arena;
+    gaiaGeomCollPtr geometry = arena.allocGeomColl(GAIA_XY_Z_M);
+    gaiaPointPtr point = arena.addPoint(geometry, 1, 2, 3, 4);
+    arena.addPoint(geometry, 5, 6, 7, 8);
+    EXPECT_EQ(point->Z, 3);
+    EXPECT_EQ(point->M, 4);
+    EXPECT_EQ(geometry->LastPoint->Prev, point);
+    gaiaLinestringPtr line = arena.addLinestring(geometry, 3);
+    EXPECT_EQ(line->Points, 3);
+    EXPECT_EQ(line->DimensionModel, GAIA_XY_Z_M);
+    EXPECT_EQ(geometry->FirstLinestring, line);
+    gaiaPolygonPtr polygon = arena.addPolygon(geometry, 5, 2);
+    EXPECT_EQ(polygon->Exterior->Link, polygon);
+    EXPECT_EQ(polygon->NumInteriors, 2);
+    gaiaRingPtr ring = arena.addInteriorRing(polygon, 1, 4);
+    EXPECT_EQ(ring, polygon->Interiors + 1);
+    EXPECT_EQ(ring->Points, 4);
+    EXPECT_THROW(arena.addInteriorRing(polygon, 2, 4), std::runtime_error);
+    EXPECT_THROW(arena.addLinestring(0, 4), std::runtime_error);
+}
+
+TEST(GeometryArena, isMeasureValid)
+{
+    GeometryArena arena;
+    gaiaGeomCollPtr geometry = arena.allocGeomColl();
+    gaiaPolygonPtr polygon = arena.addPolygon(geometry, 5, 1);
+    setSquare(polygon->Exterior->Coords, 4);
+    setSquare(arena.addInteriorRing(polygon, 0, 5)->Coords, 1);
+    EXPECT_DOUBLE_EQ(Measure::getArea(geometry), 15);
+    CoordinateBuffer buffer;
+    buffer.append(0, 0);
+    buffer.append(3, 4);
+    buffer.toCoords(arena.addLinestring(geometry, buffer.getSize())->Coords);
+    EXPECT_DOUBLE_EQ(Measure::getLength(geometry), 16 + 4 + 5);
+}
+
+TEST(GeometryArena, isBlockValid)
+{
+    GeometryArena arena(1024);
+    for (int i = 0; i < 1000; i++) arena.allocate(24);
+    EXPECT_GT(arena.getBlockCount(), 1);
+    EXPECT_EQ(arena.getBytesUsed(), 1000u * 32);
+    arena.allocate(100000);
+    int blocks = arena.getBlockCount();
+    arena.reset();
+    EXPECT_EQ(arena.getBlockCount(), 1);
+    EXPECT_EQ(arena.getBytesUsed(), 0u);
+    for (int i = 0; i < 10; i++) arena.allocate(24);
+    EXPECT_EQ(arena.getBlockCount(), 1);
+    EXPECT_LT(arena.getBlockCount(), blocks);
+}
+
+TEST(GeometryArena, isToHeapValid)
+{
+    GeometryCollectionPtr heap;
+    {
+        GeometryArena arena;
+        gaiaGeomCollPtr geometry = arena.allocGeomColl(GAIA_XY, 3857);
+        gaiaPolygonPtr polygon = arena.addPolygon(geometry, 5, 1);
+        setSquare(polygon->Exterior->Coords, 2);
+        setSquare(arena.addInteriorRing(polygon, 0, 5)->Coords, 1);
+        arena.addPoint(geometry, 1, 1);
+        heap = GeometryCollectionPtr(GeometryArena::toHeap(geometry));
+    }
+    EXPECT_EQ(heap->get()->Srid, 3857);
+    EXPECT_EQ(heap->get()->FirstPoint->X, 1);
+    EXPECT_DOUBLE_EQ(Measure::getArea(heap->get()), 3);
+}
+
+TEST(GeometryArena, isDecodeValid)
+{
+    gaiaGeomCollPtr source = gaiaAllocGeomColl();
+    source->Srid = 3857;
+    gaiaPolygonPtr polygon = gaiaAddPolygonToGeomColl(source, 5, 1);
+    setSquare(polygon->Exterior->Coords, 4);
+    setSquare(gaiaAddInteriorRing(polygon, 0, 5)->Coords, 1);
+    BlobPtr plain(Blob::toSpatiaLiteBlobWkb(source));
+    BlobPtr compressed(Blob::toCompressedBlobWkb(source));
+    BlobPtr quantized(BlobEncoding(BlobEncoding::QUANTIZED, 3).encode(source));
+    BlobPtr twkb(Blob::toTwkb(source));
+    gaiaFreeGeomColl(source);
+
+    // Every decoder builds the same geometry out of the arena
+    GeometryArena arena;
+    gaiaGeomCollPtr decoded[4] = {
+        Blob::fromSpatiaLiteBlobWkb(plain->get(), plain->getSize(), arena),
+        BlobEncoding::decode(compressed->get(), compressed->getSize(), arena),
+        BlobEncoding::decode(quantized->get(), quantized->getSize(), arena),
+        Blob::fromTwkb(twkb->get(), twkb->getSize(), arena, 3857)};
+    EXPECT_GT(arena.getBytesUsed(), 4 * 10 * sizeof(double));
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_TRUE(decoded[i] != 0);
+        EXPECT_EQ(decoded[i]->Srid, 3857);
+        ASSERT_TRUE(decoded[i]->FirstPolygon != 0);
+        EXPECT_EQ(decoded[i]->FirstPolygon->NumInteriors, 1);
+        EXPECT_DOUBLE_EQ(Measure::getArea(decoded[i]), 15);
+    }
+    EXPECT_TRUE(Blob::fromTwkb(twkb->get(), 1, arena) == 0);
+    EXPECT_TRUE(BlobEncoding::decode(quantized->get(), quantized->getSize() - 1, arena) == 0);
+}
+
+TEST(GeometryArena, isCloneValid)
+{
+    gaiaGeomCollPtr source = gaiaAllocGeomCollXYZ();
+    source->Srid = 4326;
+    source->DeclaredType = GAIA_GEOMETRYCOLLECTION;
+    gaiaAddPointToGeomCollXYZ(source, 1, 2, 3);
+    gaiaLinestringPtr line = gaiaAddLinestringToGeomColl(source, 2);
+    const double coords[6] = {0, 0, 1, 3, 4, 2};
+    for (int i = 0; i < 6; i++) line->Coords[i] = coords[i];
+    gaiaMbrGeometry(source);
+
+    GeometryArena arena;
+    gaiaGeomCollPtr copy = arena.clone(source);
+    gaiaFreeGeomColl(source);
+    EXPECT_EQ(copy->Srid, 4326);
+    EXPECT_EQ(copy->DimensionModel, GAIA_XY_Z);
+    EXPECT_EQ(copy->DeclaredType, GAIA_GEOMETRYCOLLECTION);
+    EXPECT_EQ(copy->FirstPoint->Z, 3);
+    EXPECT_EQ(copy->FirstLinestring->Coords[5], 2);
+    EXPECT_EQ(copy->MaxY, 4);
+    EXPECT_DOUBLE_EQ(Measure::getLength(copy), 5);
+    EXPECT_THROW(arena.clone(0), std::runtime_error);
+}
@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <vector>
+
+using namespace SpatiaLite;
+
+static void createPoints(SpatialDatabase & db, int count)
+{
+    std::vector<double> x(count), y(count);
+    for (int i = 0; i < count; i++)
+    {
+        x[i] = i;
+        y[i] = -i;
+    }
+    PointBatchPtr batch(Point::makePoints(4326, &x[0], &y[0], count));
+    db.getDatabase()->exec("CREATE TABLE test (pk INTEGER PRIMARY KEY, geom BLOB)");
+    batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+}
+
+TEST(GeometryCache, isValid)
+{
+    GeometryCache cache(1024);
+    EXPECT_EQ(cache.getBudget(), 1024u);
+    EXPECT_EQ(cache.getCount(), 0);
+    EXPECT_EQ(cache.getBytes(), 0u);
+}
+
+TEST(GeometryCache, isHitValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    createPoints(db, 3);
+    GeometryCache cache;
+    GeometryCache::Entry first = cache.get(db, "test", "geom", 2);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first->get()->FirstPoint->X, 1);
+    GeometryCache::Entry second = cache.get(db, "test", "geom", 2);
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(cache.getHits(), 1);
+    EXPECT_EQ(cache.getMisses(), 1);
+    EXPECT_EQ(cache.getCount(), 1);
+    EXPECT_EQ(cache.getBytes(), GeometryCache::getSize(first->get()));
+    EXPECT_FALSE(cache.get(db, "test", "geom", 99));
+    EXPECT_FALSE(cache.get(db, "test", "pk", 1));
+    EXPECT_THROW(cache.get(db, "missing", "geom", 1), std::exception);
+}
+
+TEST(GeometryCache, isStaleValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    createPoints(db, 3);
+    GeometryCache cache;
+    GeometryCache::Entry first = cache.get(db, "test", "geom", 1);
+    db.getDatabase()->exec("UPDATE test SET geom = (SELECT geom FROM test WHERE pk = 3) WHERE pk = 1");
+    GeometryCache::Entry second = cache.get(db, "test", "geom", 1);
+    EXPECT_EQ(cache.getStale(), 1);
+    EXPECT_EQ(cache.getMisses(), 2);
+    EXPECT_EQ(first->get()->FirstPoint->X, 0);
+    EXPECT_EQ(second->get()->FirstPoint->X, 2);
+}
+
+TEST(GeometryCache, isReopenValid)
+{
+    GeometryCache cache;
+    sqlite3_int64 id = 0;
+    {
+        SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        createPoints(db, 3);
+        id = db.getId();
+        EXPECT_EQ(cache.get(db, "test", "geom", 2)->get()->FirstPoint->X, 1);
+    }
+
+    // A new connection, possibly at the same address, has its own entries
+    for (int i = 0; i < 3; i++)
+    {
+        SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        EXPECT_GT(db.getId(), id);
+        id = db.getId();
+        createPoints(db, 3 + i);
+        db.getDatabase()->exec("UPDATE test SET geom = (SELECT geom FROM test WHERE pk = 3) WHERE pk = 2");
+        EXPECT_EQ(cache.get(db, "test", "geom", 2)->get()->FirstPoint->X, 2);
+        EXPECT_EQ(db.getDataVersion(), db.getDataVersion());
+    }
+    EXPECT_EQ(cache.getHits(), 0);
+}
+
+TEST(GeometryCache, isEvictionValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    createPoints(db, 10);
+    GeometryCache::Entry kept;
+    {
+        GeometryCache probe;
+        kept = probe.get(db, "test", "geom", 1);
+    }
+    size_t size = GeometryCache::getSize(kept->get());
+    GeometryCache cache(size * 3);
+    for (int i = 1; i <= 10; i++) cache.get(db, "test", "geom", i);
+    EXPECT_EQ(cache.getCount(), 3);
+    EXPECT_EQ(cache.getEvictions(), 7);
+    cache.get(db, "test", "geom", 10);
+    EXPECT_EQ(cache.getHits(), 1);
+    cache.get(db, "test", "geom", 1);
+    EXPECT_EQ(cache.getEvictions(), 8);
+    cache.setBudget(size);
+    EXPECT_EQ(cache.getCount(), 1);
+    EXPECT_EQ(kept->get()->FirstPoint->X, 0);
+    cache.clear();
+    EXPECT_EQ(cache.getCount(), 0);
+    EXPECT_EQ(cache.getBytes(), 0u);
+}
+
+TEST(GeometryCache, isThreadCacheValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    createPoints(db, 2);
+    GeometryCache & cache = GeometryCache::getThreadCache();
+    EXPECT_EQ(cache.getBudget(), 0u);
+    EXPECT_TRUE(cache.get(db, "test", "geom", 1));
+    EXPECT_EQ(cache.getCount(), 0);
+    cache.setBudget(1024);
+    cache.get(db, "test", "geom", 1);
+    EXPECT_EQ(cache.getCount(), 1);
+    cache.setBudget(0);
+    EXPECT_EQ(cache.getCount(), 0);
+}
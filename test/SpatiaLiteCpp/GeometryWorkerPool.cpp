@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+#include "TestGeometry.h"
+
+#include <cmath>
+
+#if SPATIALITECPP_USE_GEOS
+
+using namespace SpatiaLite;
+
+static GeometryWorkerPool::Task makeTask(gaiaGeomCollPtr first,
+                                         gaiaGeomCollPtr second,
+                                         int operation)
+{
+    GeometryWorkerPool::Task task;
+    task.first = first;
+    task.second = second;
+    task.operation = operation;
+    return task;
+}
+
+TEST(GeometryWorkerPool, isValid)
+{
+    GeometryWorkerPool pool(2, 1);
+    EXPECT_EQ(pool.getThreadCount(), 2);
+    EXPECT_EQ(pool.getChunkSize(), 1);
+    EXPECT_GE(GeometryWorkerPool().getThreadCount(), 1);
+    EXPECT_THROW(GeometryWorkerPool(-1), std::runtime_error);
+    EXPECT_TRUE(pool.evaluate(std::vector<GeometryWorkerPool::Task>()).empty());
+
+    GeometryArena arena;
+    gaiaGeomCollPtr big = makeSquare(arena, 0, 0, 4);
+    gaiaGeomCollPtr small = makeSquare(arena, 1, 1, 1);
+    gaiaGeomCollPtr far = makeSquare(arena, 5, 5, 1);
+    std::vector<GeometryWorkerPool::Task> tasks;
+    tasks.push_back(makeTask(big, small, PreparedGeometry::CONTAINS));
+    tasks.push_back(makeTask(big, small, PreparedGeometry::CONTAINS_PROPERLY));
+    tasks.push_back(makeTask(small, big, PreparedGeometry::WITHIN));
+    tasks.push_back(makeTask(big, far, PreparedGeometry::INTERSECTS));
+    tasks.push_back(makeTask(big, far, PreparedGeometry::DISJOINT));
+    tasks.push_back(makeTask(big, big, GeometryWorkerPool::EQUALS));
+    tasks.push_back(makeTask(big, 0, GeometryWorkerPool::IS_VALID));
+    std::vector<char> results = pool.evaluate(tasks);
+    ASSERT_EQ(results.size(), tasks.size());
+    EXPECT_EQ(results[0], 1);
+    EXPECT_EQ(results[1], 1);
+    EXPECT_EQ(results[2], 1);
+    EXPECT_EQ(results[3], 0);
+    EXPECT_EQ(results[4], 1);
+    EXPECT_EQ(results[5], 1);
+    EXPECT_EQ(results[6], 1);
+
+    tasks.push_back(makeTask(big, 0, PreparedGeometry::TOUCHES));
+    EXPECT_THROW(pool.evaluate(tasks), std::runtime_error);
+    tasks.back() = makeTask(big, small, GeometryWorkerPool::IS_VALID + 1);
+    EXPECT_THROW(pool.evaluate(tasks), std::runtime_error);
+    tasks.pop_back();
+    EXPECT_EQ(pool.evaluate(tasks), results);
+}
+
+TEST(GeometryWorkerPool, isOrderValid)
+{
+    GeometryArena arena;
+    gaiaGeomCollPtr zone = makeSquare(arena, 0, 0, 100);
+    std::vector<GeometryWorkerPool::Task> tasks;
+    for (int i = 0; i < 10000; i++)
+    {
+        gaiaGeomCollPtr cell = makeSquare(arena, i % 200, i % 7, 0.5);
+        tasks.push_back(makeTask(zone, cell, PreparedGeometry::CONTAINS));
+    }
+    GeometryWorkerPool pool(4, 16);
+    for (int k = 0; k < 3; k++)
+    {
+        std::vector<char> results = pool.evaluate(tasks);
+        ASSERT_EQ(results.size(), tasks.size());
+        for (int i = 0; i < 10000; i++)
+        {
+            ASSERT_EQ(results[i], (i % 200) < 100 ? 1 : 0) << i;
+        }
+    }
+}
+
+TEST(GeometryWorkerPool, isStealValid)
+{
+    // Polygon with many vertices, slow to validate
+    GeometryArena arena;
+    const int points = 4001;
+    gaiaGeomCollPtr heavy = arena.allocGeomColl();
+    gaiaPolygonPtr polygon = arena.addPolygon(heavy, points, 0);
+    for (int i = 0; i < points; i++)
+    {
+        const double angle = 2 * 3.14159265358979323846 * (i % (points - 1)) /
+                             (points - 1);
+        polygon->Exterior->Coords[2 * i] = 100 * std::cos(angle);
+        polygon->Exterior->Coords[2 * i + 1] = 100 * std::sin(angle);
+    }
+    gaiaGeomCollPtr small = makeSquare(arena, 0, 0, 1);
+
+    // Chunks of one task are dealt round-robin to two workers, so the first
+    // gets all the slow tasks and the second runs dry and steals from it
+    std::vector<GeometryWorkerPool::Task> tasks;
+    for (int i = 0; i < 64; i++)
+    {
+        tasks.push_back(makeTask(heavy, 0, GeometryWorkerPool::IS_VALID));
+        tasks.push_back(makeTask(small, 0, GeometryWorkerPool::IS_VALID));
+    }
+    GeometryWorkerPool pool(2, 1);
+    for (int k = 0; k < 100 && pool.getSteals() == 0; k++)
+    {
+        std::vector<char> results = pool.evaluate(tasks);
+        ASSERT_EQ(results.size(), tasks.size());
+        EXPECT_EQ(results[0], 1);
+        EXPECT_EQ(results[1], 1);
+    }
+    EXPECT_GT(pool.getSteals(), 0);
+}
+
+#endif
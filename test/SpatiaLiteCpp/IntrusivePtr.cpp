@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace SpatiaLite;
+
+static int numDeleted = 0;
+
+class Counted : public RefCounted
+{
+public:
+    explicit Counted(int value) : value(value) {}
+    ~Counted() { numDeleted++; }
+    int value;
+};
+
+TEST(IntrusivePtr, isValid)
+{
+    IntrusivePtr<Counted> handle(new Counted(1));
+    EXPECT_EQ(handle.use_count(), 1);
+    EXPECT_EQ(handle->value, 1);
+    IntrusivePtr<Counted> empty;
+    EXPECT_FALSE(empty);
+    EXPECT_EQ(empty.use_count(), 0);
+    bool implicit = std::is_convertible<Counted *, IntrusivePtr<Counted> >::value;
+    EXPECT_FALSE(implicit);
+}
+
+TEST(IntrusivePtr, isShareValid)
+{
+    numDeleted = 0;
+    {
+        IntrusivePtr<Counted> first = makeIntrusive<Counted>(7);
+        {
+            IntrusivePtr<Counted> second(first);
+            IntrusivePtr<Counted> third;
+            third = second;
+            EXPECT_EQ(first.use_count(), 3);
+            EXPECT_TRUE(first == third);
+            EXPECT_EQ((*third).value, 7);
+        }
+        EXPECT_EQ(first.use_count(), 1);
+        EXPECT_EQ(numDeleted, 0);
+    }
+    EXPECT_EQ(numDeleted, 1);
+}
+
+TEST(IntrusivePtr, isMoveValid)
+{
+    numDeleted = 0;
+    {
+        IntrusivePtr<Counted> first = makeIntrusive<Counted>(1);
+        IntrusivePtr<Counted> second(std::move(first));
+        EXPECT_FALSE(first);
+        EXPECT_EQ(second.use_count(), 1);
+        std::vector<IntrusivePtr<Counted> > handles(4, second);
+        EXPECT_EQ(second.use_count(), 5);
+    }
+    EXPECT_EQ(numDeleted, 1);
+}
+
+TEST(IntrusivePtr, isResetValid)
+{
+    numDeleted = 0;
+    IntrusivePtr<Counted> handle = makeIntrusive<Counted>(1);
+    handle.reset(new Counted(2));
+    EXPECT_EQ(numDeleted, 1);
+    EXPECT_EQ(handle->value, 2);
+    IntrusivePtr<Counted> & alias = handle;
+    handle = alias;
+    EXPECT_EQ(handle.use_count(), 1);
+    handle.reset();
+    EXPECT_EQ(numDeleted, 2);
+}
+
+TEST(IntrusivePtr, isCopyCountValid)
+{
+    IntrusivePtr<Counted> handle = makeIntrusive<Counted>(1);
+    Counted copy(*handle);
+    EXPECT_EQ(copy.getRefCount(), 0);
+    EXPECT_EQ(handle->getRefCount(), 1);
+}
+
+TEST(IntrusivePtr, isPtrBaseValid)
+{
+    bool counted = std::is_base_of<RefCounted, Point>::value;
+    EXPECT_EQ(counted, SPATIALITECPP_PTRTYPE == 5);
+}
+
+TEST(IntrusivePtr, isMakePtrValid)
+{
+    BlobPtr blob = makePtr<Blob>(static_cast<BlobType>(0), 0);
+    EXPECT_EQ(blob->getSize(), 0);
+    CoordinateBufferPtr buffer = makePtr<CoordinateBuffer>(GAIA_XY_Z, 4);
+    EXPECT_EQ(buffer->getCapacity(), 4);
+}
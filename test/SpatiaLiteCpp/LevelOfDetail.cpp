@@ -0,0 +1,238 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace SpatiaLite;
+
+// Zig-zag line with small and large teeth
+static gaiaGeomCollPtr makeLine()
+{
+    const double coords[14] = {0, 0, 1, 0.1, 2, 0, 3, 5, 4, 0, 5, 0.1, 6, 0};
+    gaiaGeomCollPtr geometry = gaiaAllocGeomColl();
+    gaiaLinestringPtr line = gaiaAddLinestringToGeomColl(geometry, 7);
+    for (int i = 0; i < 14; i++) line->Coords[i] = coords[i];
+    return geometry;
+}
+
+// Square with a small notch on each edge
+static gaiaGeomCollPtr makePolygon()
+{
+    const double coords[18] = {0, 0, 5, 0.1, 10, 0, 9.9, 5, 10, 10,
+                               5, 9.9, 0, 10, 0.1, 5, 0, 0};
+    gaiaGeomCollPtr geometry = gaiaAllocGeomColl();
+    gaiaPolygonPtr polygon = gaiaAddPolygonToGeomColl(geometry, 9, 0);
+    for (int i = 0; i < 18; i++) polygon->Exterior->Coords[i] = coords[i];
+    return geometry;
+}
+
+static std::string toBlob(gaiaGeomCollPtr geometry)
+{
+    unsigned char * blob = 0;
+    int size = 0;
+    gaiaToSpatiaLiteBlobWkb(geometry, &blob, &size);
+    std::string result((const char *)blob, size);
+    gaiaFree(blob);
+    return result;
+}
+
+TEST(LevelOfDetail, isValid)
+{
+    EXPECT_THROW(LevelOfDetail(std::vector<double>()), std::exception);
+    EXPECT_THROW(LevelOfDetail(std::vector<double>(1, 0.0)), std::exception);
+    EXPECT_THROW(LevelOfDetail(std::vector<double>(1, 1.0), 3), std::exception);
+    EXPECT_THROW(LevelOfDetail(std::vector<double>(1, 1.0),
+                               LevelOfDetail::VISVALINGAM, -1), std::exception);
+    EXPECT_THROW(LevelOfDetail(std::vector<double>(1, 1.0),
+                               LevelOfDetail::VISVALINGAM, 1, 0), std::exception);
+
+    std::vector<double> tolerances;
+    tolerances.push_back(10);
+    tolerances.push_back(1);
+    tolerances.push_back(100);
+    tolerances.push_back(1);
+    LevelOfDetail lod(tolerances, LevelOfDetail::VISVALINGAM, 2);
+    ASSERT_EQ(lod.getTolerances().size(), 3u);
+    EXPECT_EQ(lod.getTolerances()[0], 1);
+    EXPECT_EQ(lod.getTolerances()[2], 100);
+    EXPECT_EQ(lod.getMethod(), LevelOfDetail::VISVALINGAM);
+#if SPATIALITECPP_USE_GEOS
+    EXPECT_EQ(LevelOfDetail(tolerances, LevelOfDetail::PRESERVE_TOPOLOGY).getMethod(),
+              LevelOfDetail::PRESERVE_TOPOLOGY);
+#else
+    EXPECT_THROW(LevelOfDetail(tolerances, LevelOfDetail::PRESERVE_TOPOLOGY),
+                 std::runtime_error);
+#endif
+    EXPECT_EQ(lod.getThreadCount(), 2);
+    EXPECT_GT(LevelOfDetail(tolerances).getThreadCount(), 0);
+
+    // The largest tolerance not above the resolution is chosen
+    EXPECT_EQ(lod.getLevel(0.5), -1);
+    EXPECT_EQ(lod.getLevel(1), 0);
+    EXPECT_EQ(lod.getLevel(50), 1);
+    EXPECT_EQ(lod.getLevel(1000), 2);
+    EXPECT_EQ(LevelOfDetail::getTableName("roads", "geom"), "roads_geom_lod");
+    EXPECT_EQ(lod.getQuery("roads", "geom", 0.5),
+              "SELECT t.rowid, t.\"geom\" FROM \"roads\" AS t");
+    EXPECT_EQ(lod.getQuery("roads", "geom", 50),
+              "SELECT pkid, geometry FROM \"roads_geom_lod\" WHERE tolerance = ?");
+    EXPECT_EQ(lod.getTolerances()[lod.getLevel(50)], 10);
+}
+
+TEST(LevelOfDetail, isDouglasPeuckerValid)
+{
+    gaiaGeomCollPtr line = makeLine();
+
+    // Small teeth go first, then the sides of the large one
+    gaiaGeomCollPtr result = LevelOfDetail::simplify(line, 0.5);
+    ASSERT_TRUE(result != 0);
+    ASSERT_TRUE(result->FirstLinestring != 0);
+    EXPECT_EQ(result->FirstLinestring->Points, 5);
+    EXPECT_EQ(result->FirstLinestring->Coords[2], 2);
+    gaiaFreeGeomColl(result);
+    result = LevelOfDetail::simplify(line, 2);
+    ASSERT_TRUE(result != 0);
+    EXPECT_EQ(result->FirstLinestring->Points, 3);
+    EXPECT_EQ(result->FirstLinestring->Coords[2], 3);
+    gaiaFreeGeomColl(result);
+    result = LevelOfDetail::simplify(line, 10);
+    ASSERT_TRUE(result != 0);
+    EXPECT_EQ(result->FirstLinestring->Points, 2);
+    EXPECT_EQ(result->FirstLinestring->Coords[2], 6);
+    gaiaFreeGeomColl(result);
+    result = LevelOfDetail::simplify(line, 0.01);
+    ASSERT_TRUE(result != 0);
+    EXPECT_EQ(result->FirstLinestring->Points, 7);
+    gaiaFreeGeomColl(result);
+    gaiaFreeGeomColl(line);
+
+    // Notches go, the corners stay, and a thin polygon vanishes
+    gaiaGeomCollPtr polygon = makePolygon();
+    result = LevelOfDetail::simplify(polygon, 1);
+    ASSERT_TRUE(result != 0);
+    ASSERT_TRUE(result->FirstPolygon != 0);
+    EXPECT_EQ(result->FirstPolygon->Exterior->Points, 5);
+    gaiaFreeGeomColl(result);
+    EXPECT_TRUE(LevelOfDetail::simplify(polygon, 100) == 0);
+    gaiaFreeGeomColl(polygon);
+}
+
+TEST(LevelOfDetail, isVisvalingamValid)
+{
+    gaiaGeomCollPtr line = makeLine();
+    gaiaGeomCollPtr result =
+        LevelOfDetail::simplify(line, 1, LevelOfDetail::VISVALINGAM);
+    ASSERT_TRUE(result != 0);
+    EXPECT_EQ(result->FirstLinestring->Points, 5);
+    EXPECT_EQ(result->FirstLinestring->Coords[2], 2);
+    gaiaFreeGeomColl(result);
+    result = LevelOfDetail::simplify(line, 3, LevelOfDetail::VISVALINGAM);
+    ASSERT_TRUE(result != 0);
+    EXPECT_EQ(result->FirstLinestring->Points, 3);
+    EXPECT_EQ(result->FirstLinestring->Coords[2], 3);
+    gaiaFreeGeomColl(result);
+    result = LevelOfDetail::simplify(line, 100, LevelOfDetail::VISVALINGAM);
+    ASSERT_TRUE(result != 0);
+    EXPECT_EQ(result->FirstLinestring->Points, 2);
+    gaiaFreeGeomColl(result);
+    gaiaFreeGeomColl(line);
+
+    // Rings keep four vertices
+    gaiaGeomCollPtr polygon = makePolygon();
+    result = LevelOfDetail::simplify(polygon, 1, LevelOfDetail::VISVALINGAM);
+    ASSERT_TRUE(result != 0);
+    EXPECT_EQ(result->FirstPolygon->Exterior->Points, 5);
+    gaiaFreeGeomColl(result);
+    result = LevelOfDetail::simplify(polygon, 100, LevelOfDetail::VISVALINGAM);
+    ASSERT_TRUE(result != 0);
+    EXPECT_EQ(result->FirstPolygon->Exterior->Points, 4);
+    gaiaFreeGeomColl(result);
+    gaiaFreeGeomColl(polygon);
+}
+
+TEST(LevelOfDetail, isBuildValid)
+{
+    const char * filename = "levelofdetail.sqlite";
+    std::remove(filename);
+    {
+        SpatialDatabase db(filename, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                               "geom BLOB)");
+        gaiaGeomCollPtr line = makeLine();
+        gaiaGeomCollPtr polygon = makePolygon();
+        const std::string lineBlob = toBlob(line);
+        const std::string polygonBlob = toBlob(polygon);
+        gaiaFreeGeomColl(line);
+        gaiaFreeGeomColl(polygon);
+        SQLite::Statement insert(*db.getDatabase(),
+                                 "INSERT INTO test (geom) VALUES (?)");
+        for (int i = 0; i < 1000; i++)
+        {
+            std::string const & blob = i % 2 ? polygonBlob : lineBlob;
+            if (i % 100 == 99)
+            {
+                insert.bind(1);
+            }
+            else
+            {
+                insert.bind(1, blob.data(), (int)blob.size());
+            }
+            insert.exec();
+            insert.reset();
+        }
+
+        std::vector<double> tolerances;
+        tolerances.push_back(0.01);
+        tolerances.push_back(1);
+        tolerances.push_back(100);
+        LevelOfDetail lod(tolerances, LevelOfDetail::DOUGLAS_PEUCKER, 3, 16);
+        EXPECT_EQ(lod.build(db, "test", "geom"), 1000);
+        {
+            SQLite::Statement count(*db.getDatabase(),
+                                    "SELECT COUNT(*) FROM test_geom_lod");
+            ASSERT_TRUE(count.executeStep());
+            EXPECT_EQ(count.getColumn(0).getInt(), 3000);
+        }
+
+        // Unchanged geometries are stored as they are
+        {
+            SQLite::Statement same(*db.getDatabase(),
+                                   "SELECT geometry FROM test_geom_lod "
+                                   "WHERE pkid = 1 AND tolerance = 0.01");
+            ASSERT_TRUE(same.executeStep());
+            EXPECT_EQ(std::string((const char *)same.getColumn(0).getBlob(),
+                                  same.getColumn(0).getBytes()),
+                      lineBlob);
+        }
+
+        // Reads pick the level of the resolution
+        gaiaGeomCollPtr result = lod.read(db, "test", "geom", 1, 0.001);
+        ASSERT_TRUE(result != 0);
+        EXPECT_EQ(result->FirstLinestring->Points, 7);
+        gaiaFreeGeomColl(result);
+        result = lod.read(db, "test", "geom", 1, 2);
+        ASSERT_TRUE(result != 0);
+        EXPECT_EQ(result->FirstLinestring->Points, 5);
+        gaiaFreeGeomColl(result);
+        result = lod.read(db, "test", "geom", 2, 2);
+        ASSERT_TRUE(result != 0);
+        EXPECT_EQ(result->FirstPolygon->Exterior->Points, 5);
+        gaiaFreeGeomColl(result);
+        EXPECT_TRUE(lod.read(db, "test", "geom", 2, 500) == 0);
+        EXPECT_TRUE(lod.read(db, "test", "geom", 100, 2) == 0);
+
+        // A second build replaces its levels
+        EXPECT_EQ(lod.build(db, "test", "geom"), 1000);
+        {
+            SQLite::Statement count(*db.getDatabase(),
+                                    "SELECT COUNT(*) FROM test_geom_lod");
+            ASSERT_TRUE(count.executeStep());
+            EXPECT_EQ(count.getColumn(0).getInt(), 3000);
+        }
+
+        EXPECT_THROW(lod.build(db, "test", "missing"), std::exception);
+    }
+    std::remove(filename);
+}
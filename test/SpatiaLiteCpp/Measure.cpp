@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace SpatiaLite;
+
+namespace
+{
+    std::vector<double> makeRing(int points, int stride)
+    {
+        std::vector<double> coords(points * stride, 7.0);
+        for (int i = 0; i < points - 1; i++)
+        {
+            double angle = 2 * 3.14159265358979 * i / (points - 1);
+            double radius = 100 + std::rand() % 50;
+            coords[i * stride] = 5000 + radius * std::cos(angle);
+            coords[i * stride + 1] = -300 + radius * std::sin(angle);
+        }
+        coords[(points - 1) * stride] = coords[0];
+        coords[(points - 1) * stride + 1] = coords[1];
+        return coords;
+    }
+}
+
+TEST(Measure, isDimensionsInvalid)
+{
+    double coords[] = {0, 0, 1, 1};
+    EXPECT_THROW(Measure::getLength(coords, 2, -1), std::runtime_error);
+}
+
+TEST(Measure, isGeometryInvalid)
+{
+    EXPECT_THROW(Measure::getArea(0), std::runtime_error);
+    EXPECT_THROW(Measure::getLength(0), std::runtime_error);
+}
+
+TEST(Measure, isSquareValid)
+{
+    double coords[] = {0, 0, 2, 0, 2, 2, 0, 2, 0, 0};
+    double minx = 0, miny = 0, maxx = 0, maxy = 0, x = 0, y = 0;
+    EXPECT_DOUBLE_EQ(Measure::getArea(coords, 5, GAIA_XY), 4);
+    EXPECT_DOUBLE_EQ(Measure::getLength(coords, 5, GAIA_XY), 8);
+    EXPECT_TRUE(Measure::getBounds(coords, 5, GAIA_XY, minx, miny, maxx, maxy));
+    EXPECT_EQ(maxx, 2);
+    EXPECT_EQ(maxy, 2);
+    EXPECT_TRUE(Measure::getCentroid(coords, 5, GAIA_XY, x, y));
+    EXPECT_DOUBLE_EQ(x, 1);
+    EXPECT_DOUBLE_EQ(y, 1);
+    EXPECT_TRUE(Measure::getLineCentroid(coords, 3, GAIA_XY, x, y));
+    EXPECT_DOUBLE_EQ(x, 1.5);
+    EXPECT_DOUBLE_EQ(y, 0.5);
+}
+
+TEST(Measure, isInstructionSetValid)
+{
+    int best = Measure::setInstructionSet(Measure::AVX2);
+    EXPECT_EQ(Measure::getInstructionSet(), best);
+    EXPECT_EQ(Measure::setInstructionSet(Measure::SCALAR), Measure::SCALAR);
+    Measure::setInstructionSet(best);
+}
+
+TEST(Measure, isDispatchConsistent)
+{
+    const int models[] = {GAIA_XY, GAIA_XY_Z, GAIA_XY_M, GAIA_XY_Z_M};
+    const int sizes[] = {2, 3, 4, 5, 8, 1001};
+    int best = Measure::setInstructionSet(Measure::AVX2);
+    for (int m = 0; m < 4; m++)
+    {
+        for (int k = 0; k < 6; k++)
+        {
+            int stride = CoordinateBuffer::getStride(models[m]);
+            std::vector<double> coords = makeRing(sizes[k], stride);
+            double expected[9];
+            double actual[9];
+            for (int set = Measure::SCALAR; set <= best; set++)
+            {
+                double * r = set == Measure::SCALAR ? expected : actual;
+                Measure::setInstructionSet(set);
+                r[0] = Measure::getArea(&coords[0], sizes[k], models[m]);
+                r[1] = Measure::getLength(&coords[0], sizes[k], models[m]);
+                Measure::getBounds(&coords[0], sizes[k], models[m], r[2], r[3], r[4], r[5]);
+                r[6] = r[7] = 0;
+                Measure::getCentroid(&coords[0], sizes[k], models[m], r[6], r[7]);
+                r[8] = 0;
+                Measure::getLineCentroid(&coords[0], sizes[k], models[m], r[8], r[8]);
+                if (set == Measure::SCALAR) continue;
+                for (int i = 0; i < 9; i++)
+                {
+                    EXPECT_NEAR(actual[i], expected[i], 1e-9 * (1 + std::fabs(expected[i])));
+                }
+            }
+        }
+    }
+    Measure::setInstructionSet(best);
+}
+
+TEST(Measure, isGeometryValid)
+{
+    GeometryCollectionPtr collection(new GeometryCollection(gaiaAllocGeomColl()));
+    gaiaPolygonPtr polygon = gaiaAddPolygonToGeomColl(collection->get(), 5, 1);
+    double exterior[] = {0, 0, 4, 0, 4, 4, 0, 4, 0, 0};
+    std::copy(exterior, exterior + 10, polygon->Exterior->Coords);
+    gaiaRingPtr interior = gaiaAddInteriorRing(polygon, 0, 5);
+    double hole[] = {1, 1, 2, 1, 2, 2, 1, 2, 1, 1};
+    std::copy(hole, hole + 10, interior->Coords);
+    EXPECT_DOUBLE_EQ(Measure::getArea(collection->get()), 15);
+    EXPECT_DOUBLE_EQ(Measure::getLength(collection->get()), 20);
+}
+
+TEST(Measure, isDistanceValid)
+{
+    GeometryCollectionPtr collection(new GeometryCollection(gaiaAllocGeomColl()));
+    EXPECT_EQ(Measure::getDistance(collection->get(), 0, 0), DBL_MAX);
+    gaiaPolygonPtr polygon = gaiaAddPolygonToGeomColl(collection->get(), 5, 1);
+    double exterior[] = {0, 0, 4, 0, 4, 4, 0, 4, 0, 0};
+    std::copy(exterior, exterior + 10, polygon->Exterior->Coords);
+    gaiaRingPtr interior = gaiaAddInteriorRing(polygon, 0, 5);
+    double hole[] = {1, 1, 3, 1, 3, 3, 1, 3, 1, 1};
+    std::copy(hole, hole + 10, interior->Coords);
+    EXPECT_DOUBLE_EQ(Measure::getDistance(collection->get(), 0.5, 0.5), 0);
+    EXPECT_DOUBLE_EQ(Measure::getDistance(collection->get(), 2, 1.5), 0.5);
+    EXPECT_DOUBLE_EQ(Measure::getDistance(collection->get(), 7, 8), 5);
+    gaiaAddPointToGeomColl(collection->get(), 10, 10);
+    EXPECT_DOUBLE_EQ(Measure::getDistance(collection->get(), 10, 11), 1);
+    EXPECT_THROW(Measure::getDistance(0, 0, 0), std::runtime_error);
+}
@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "SpatiaLiteCpp/SpatiaLiteCpp.h"
 
+#include <string>
+
 using namespace SpatiaLite;
 
 TEST(OutputBuffer, isValid)
@@ -18,3 +20,32 @@ TEST(OutputBuffer, isValidValid)
     gaiaOutWkt(buffer->get(), collection->get());
     EXPECT_TRUE(buffer->isValid());
 }
+
+TEST(OutputBuffer, isClearValid)
+{
+    GeometryCollectionPtr collection(new GeometryCollection(gaiaAllocGeomColl()));
+    gaiaAddPointToGeomColl(collection->get(), 1.0, 2.0);
+    OutputBufferPtr buffer(new OutputBuffer(new gaiaOutBuffer()));
+    EXPECT_STREQ(buffer->getData(), "");
+    EXPECT_EQ(buffer->getSize(), 0u);
+    gaiaOutWkt(buffer->get(), collection->get());
+    const size_t size = buffer->getSize();
+    const size_t capacity = buffer->getCapacity();
+    EXPECT_GT(size, 0u);
+    EXPECT_GE(capacity, size);
+    EXPECT_EQ(std::string(buffer->getData(), size), buffer->get()->Buffer);
+#if __cplusplus >= 201703L
+    EXPECT_EQ(buffer->getView(), buffer->get()->Buffer);
+#endif
+
+    // Clearing keeps the storage, shrinking frees it
+    buffer->clear();
+    EXPECT_EQ(buffer->getSize(), 0u);
+    EXPECT_STREQ(buffer->getData(), "");
+    EXPECT_EQ(buffer->getCapacity(), capacity);
+    gaiaOutWkt(buffer->get(), collection->get());
+    EXPECT_EQ(buffer->getSize(), size);
+    buffer->shrink();
+    EXPECT_EQ(buffer->getCapacity(), 0u);
+    EXPECT_EQ(buffer->getSize(), 0u);
+}
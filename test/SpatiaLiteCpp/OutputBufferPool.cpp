@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <string>
+#include <utility>
+
+using namespace SpatiaLite;
+
+TEST(OutputBufferPool, isValid)
+{
+    OutputBufferPool pool(1024, 2);
+    EXPECT_EQ(pool.getMaxCapacity(), 1024u);
+    EXPECT_EQ(pool.getMaxIdle(), 2);
+    EXPECT_THROW(OutputBufferPool(1024, -1), std::exception);
+
+    const char * storage = 0;
+    {
+        OutputBufferPool::Lease lease = pool.acquire();
+        ASSERT_TRUE((bool)lease);
+        gaiaAppendToOutBuffer(lease->get(), "POINT(1 2)");
+        EXPECT_EQ(std::string(lease->getData(), lease->getSize()), "POINT(1 2)");
+        storage = lease->getData();
+    }
+    EXPECT_EQ(pool.getMisses(), 1);
+    EXPECT_EQ(pool.getIdleCount(), 1);
+
+    // The returned buffer comes back empty with its storage
+    OutputBufferPool::Lease reused = pool.acquire();
+    EXPECT_EQ(pool.getHits(), 1);
+    EXPECT_EQ(reused->getSize(), 0u);
+    EXPECT_GT(reused->getCapacity(), 0u);
+    gaiaAppendToOutBuffer(reused->get(), "LINESTRING");
+    EXPECT_EQ(reused->getData(), storage);
+
+    // Leases move and return once
+    OutputBufferPool::Lease moved(std::move(reused));
+    EXPECT_FALSE((bool)reused);
+    moved.reset();
+    EXPECT_FALSE((bool)moved);
+    EXPECT_EQ(pool.getIdleCount(), 1);
+}
+
+TEST(OutputBufferPool, isTrimValid)
+{
+    OutputBufferPool pool(64, 1);
+    OutputBufferPool::Lease large = pool.acquire();
+    OutputBufferPool::Lease small = pool.acquire();
+    gaiaAppendToOutBuffer(large->get(), std::string(1000, 'x').c_str());
+    gaiaAppendToOutBuffer(small->get(), "x");
+
+    // Storage past the high-water mark is freed on return
+    large.reset();
+    EXPECT_EQ(pool.getTrims(), 1);
+    EXPECT_EQ(pool.getIdleCount(), 1);
+
+    // Idle buffers beyond the limit are deleted
+    small.reset();
+    EXPECT_EQ(pool.getIdleCount(), 1);
+    EXPECT_EQ(pool.acquire()->getCapacity(), 0u);
+    pool.clear();
+    EXPECT_EQ(pool.getIdleCount(), 0);
+
+    OutputBufferPool & thread = OutputBufferPool::getThreadPool();
+    EXPECT_EQ(&thread, &OutputBufferPool::getThreadPool());
+}
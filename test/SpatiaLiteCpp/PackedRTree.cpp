@@ -0,0 +1,212 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace SpatiaLite;
+
+static std::vector<double> makeBoxes(int count)
+{
+    std::vector<double> boxes;
+    std::srand(11);
+    for (int i = 0; i < count; i++)
+    {
+        double x = std::rand() % 10000 / 10.0;
+        double y = std::rand() % 10000 / 10.0;
+        boxes.push_back(x);
+        boxes.push_back(y);
+        boxes.push_back(x + std::rand() % 50 / 10.0);
+        boxes.push_back(y + std::rand() % 50 / 10.0);
+    }
+    return boxes;
+}
+
+static PackedRTree * makeTree(std::vector<double> const & boxes, int nodeSize)
+{
+    PackedRTree * tree = new PackedRTree(nodeSize);
+    for (size_t i = 0; i < boxes.size() / 4; i++)
+    {
+        tree->add(i + 1, boxes[4 * i], boxes[4 * i + 1],
+                  boxes[4 * i + 2], boxes[4 * i + 3]);
+    }
+    tree->finish();
+    return tree;
+}
+
+static void expectSearch(PackedRTree const & tree,
+                         std::vector<double> const & boxes)
+{
+    for (int q = 0; q < 50; q++)
+    {
+        double x = q * 20.0;
+        double y = 1000 - q * 20.0;
+        std::vector<sqlite3_int64> expected;
+        for (size_t i = 0; i < boxes.size() / 4; i++)
+        {
+            if (boxes[4 * i] <= x + 30 && boxes[4 * i + 1] <= y + 30 &&
+                boxes[4 * i + 2] >= x && boxes[4 * i + 3] >= y)
+            {
+                expected.push_back(i + 1);
+            }
+        }
+        std::vector<sqlite3_int64> found;
+        EXPECT_EQ(tree.search(x, y, x + 30, y + 30, found), expected.size());
+        std::sort(found.begin(), found.end());
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST(PackedRTree, isValid)
+{
+    EXPECT_THROW(PackedRTree(1), std::runtime_error);
+    PackedRTree tree(4);
+    std::vector<sqlite3_int64> found;
+    EXPECT_THROW(tree.search(0, 0, 1, 1, found), std::runtime_error);
+    EXPECT_THROW(tree.nearest(0, 0, 1), std::runtime_error);
+    tree.add(7, 0, 0, 1, 1);
+    EXPECT_EQ(tree.getCount(), 1u);
+    tree.finish();
+    EXPECT_TRUE(tree.isFinished());
+    EXPECT_FALSE(tree.isMapped());
+    EXPECT_THROW(tree.add(8, 0, 0, 1, 1), std::runtime_error);
+    EXPECT_THROW(tree.finish(), std::runtime_error);
+    EXPECT_EQ(tree.search(0.5, 0.5, 2, 2, found), 1u);
+    EXPECT_EQ(found.at(0), 7);
+    EXPECT_EQ(tree.search(2, 2, 3, 3, found), 0u);
+    double minx, miny, maxx, maxy;
+    EXPECT_TRUE(tree.getBounds(minx, miny, maxx, maxy));
+    EXPECT_EQ(maxx, 1);
+
+    PackedRTree empty;
+    empty.finish();
+    EXPECT_EQ(empty.search(0, 0, 1, 1, found), 0u);
+    EXPECT_TRUE(empty.nearest(0, 0, 1).empty());
+    EXPECT_FALSE(empty.getBounds(minx, miny, maxx, maxy));
+}
+
+TEST(PackedRTree, isSearchValid)
+{
+    std::vector<double> boxes = makeBoxes(5000);
+    PackedRTreePtr tree(makeTree(boxes, 16));
+    EXPECT_EQ(tree->getCount(), 5000u);
+    EXPECT_EQ(tree->getNodeSize(), 16);
+    expectSearch(*tree, boxes);
+    PackedRTreePtr small(makeTree(boxes, 2));
+    expectSearch(*small, boxes);
+}
+
+TEST(PackedRTree, isNearestValid)
+{
+    std::vector<double> boxes = makeBoxes(3000);
+    PackedRTreePtr tree(makeTree(boxes, 8));
+    std::vector<SpatialDatabase::Neighbor> neighbors =
+        tree->nearest(500, 500, 10);
+    ASSERT_EQ(neighbors.size(), 10u);
+    std::vector<double> distances;
+    for (size_t i = 0; i < boxes.size() / 4; i++)
+    {
+        double dx = std::max(std::max(boxes[4 * i] - 500, 500 - boxes[4 * i + 2]), 0.0);
+        double dy = std::max(std::max(boxes[4 * i + 1] - 500, 500 - boxes[4 * i + 3]), 0.0);
+        distances.push_back(std::sqrt(dx * dx + dy * dy));
+    }
+    std::vector<double> sorted(distances);
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < 10; i++)
+    {
+        EXPECT_DOUBLE_EQ(neighbors[i].distance, sorted[i]);
+        EXPECT_DOUBLE_EQ(distances[neighbors[i].id - 1], sorted[i]);
+    }
+    EXPECT_EQ(tree->nearest(500, 500, 100, sorted[4]).size(),
+              (size_t)(std::upper_bound(sorted.begin(), sorted.end(), sorted[4]) -
+                       sorted.begin()));
+
+    // Refine with the distance to the box corners
+    std::vector<SpatialDatabase::Neighbor> refined = tree->nearest(
+        500, 500, 5, DBL_MAX, [&boxes](sqlite3_int64 id) {
+            return std::hypot(boxes[4 * (id - 1)] - 500,
+                              boxes[4 * (id - 1) + 1] - 500);
+        });
+    ASSERT_EQ(refined.size(), 5u);
+    for (size_t i = 1; i < refined.size(); i++)
+    {
+        EXPECT_LE(refined[i - 1].distance, refined[i].distance);
+    }
+}
+
+TEST(PackedRTree, isFileValid)
+{
+    std::vector<double> boxes = makeBoxes(2000);
+    PackedRTreePtr tree(makeTree(boxes, 16));
+    tree->save("packedrtree.bin");
+    PackedRTreePtr mapped(PackedRTree::load("packedrtree.bin"));
+    EXPECT_TRUE(mapped->isMapped());
+    EXPECT_EQ(mapped->getCount(), 2000u);
+    EXPECT_EQ(mapped->getNodeSize(), 16);
+    expectSearch(*mapped, boxes);
+    EXPECT_EQ(mapped->nearest(10, 10, 3)[0].id, tree->nearest(10, 10, 3)[0].id);
+    mapped->save("packedrtree.bin");
+    expectSearch(*mapped, boxes);
+    PackedRTreePtr remapped(PackedRTree::load("packedrtree.bin"));
+    expectSearch(*remapped, boxes);
+    remapped = PackedRTreePtr();
+    mapped = PackedRTreePtr();
+
+    // A root pointing outside the level below is rejected
+    FILE * file = std::fopen("packedrtree.bin", "r+b");
+    unsigned long long nodes = 0;
+    std::fseek(file, 24, SEEK_SET);
+    ASSERT_EQ(std::fread(&nodes, sizeof(nodes), 1, file), 1u);
+    const sqlite3_int64 root = (sqlite3_int64)nodes - 1;
+    std::fseek(file, (long)(64 + nodes * 32 + (nodes - 1) * 8), SEEK_SET);
+    std::fwrite(&root, sizeof(root), 1, file);
+    std::fclose(file);
+    EXPECT_THROW(PackedRTree::load("packedrtree.bin"), std::runtime_error);
+
+    // So are counts the file cannot hold
+    tree->save("packedrtree.bin");
+    file = std::fopen("packedrtree.bin", "r+b");
+    const unsigned long long items = 1ULL << 62;
+    std::fseek(file, 16, SEEK_SET);
+    std::fwrite(&items, sizeof(items), 1, file);
+    std::fclose(file);
+    EXPECT_THROW(PackedRTree::load("packedrtree.bin"), std::runtime_error);
+
+    file = std::fopen("packedrtree.bin", "wb");
+    std::fputs("not a tree", file);
+    std::fclose(file);
+    EXPECT_THROW(PackedRTree::load("packedrtree.bin"), std::runtime_error);
+    std::remove("packedrtree.bin");
+    EXPECT_THROW(PackedRTree::load("packedrtree.bin"), std::runtime_error);
+    EXPECT_THROW(PackedRTree().save("packedrtree.bin"), std::runtime_error);
+}
+
+TEST(PackedRTree, isTableValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, geom BLOB)");
+    double x[] = {1, 2, 3, 4};
+    double y[] = {5, 6, 7, 8};
+    PointBatchPtr batch(PointBatch::create(4326, x, y, 4));
+    batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+    db.getDatabase()->exec("INSERT INTO test (geom) VALUES (NULL)");
+    db.getDatabase()->exec("INSERT INTO test (geom) VALUES (x'0102')");
+    PackedRTreePtr tree(PackedRTree::fromTable(db, "test", "geom"));
+    EXPECT_EQ(tree->getCount(), 4u);
+    std::vector<sqlite3_int64> found;
+    EXPECT_EQ(tree->search(1.5, 5.5, 3.5, 7.5, found), 2u);
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found.at(0), 2);
+    EXPECT_EQ(found.at(1), 3);
+    EXPECT_EQ(tree->nearest(4.1, 8.1, 1).at(0).id, 4);
+
+    // Quantized rows are decoded for their bounds
+    BlobEncoding(BlobEncoding::QUANTIZED, 3).apply(db, "test", "geom");
+    tree = PackedRTreePtr(PackedRTree::fromTable(db, "test", "geom"));
+    EXPECT_EQ(tree->getCount(), 4u);
+    found.clear();
+    EXPECT_EQ(tree->search(1.5, 5.5, 3.5, 7.5, found), 2u);
+    EXPECT_THROW(PackedRTree::fromTable(db, "none", "geom"), std::exception);
+}
@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <climits>
+#include <cstring>
+
+using namespace SpatiaLite;
+
+TEST(PointBatch, isValid)
+{
+    double x[] = {0, 1, 2};
+    double y[] = {3, 4, 5};
+    PointBatchPtr batch(PointBatch::create(4326, x, y, 3));
+    EXPECT_EQ(batch->getCount(), 3);
+    EXPECT_EQ(batch->getRecordSize(), 60);
+    EXPECT_EQ(batch->getSize(), 180);
+}
+
+TEST(PointBatch, isEmptyValid)
+{
+    PointBatchPtr batch(PointBatch::create(4326, 0, 0, 0));
+    EXPECT_EQ(batch->getCount(), 0);
+    EXPECT_THROW(batch->getBlob(0), std::runtime_error);
+}
+
+TEST(PointBatch, isInvalid)
+{
+    double x[] = {0};
+    EXPECT_THROW(PointBatch::create(4326, x, 0, 1), std::runtime_error);
+    EXPECT_THROW(PointBatch::create(4326, x, x, -1), std::runtime_error);
+
+    // Arena sizes must fit in an int
+    EXPECT_THROW(PointBatch::create(4326, x, x, INT_MAX / 60 + 1), std::runtime_error);
+    EXPECT_THROW(PointBatch::create(4326, x, x, INT_MAX / 76 + 1, x, x), std::runtime_error);
+}
+
+TEST(PointBatch, isRecordSizeValid)
+{
+    double v[] = {1, 2};
+    EXPECT_EQ(PointBatchPtr(PointBatch::create(0, v, v, 2, v))->getRecordSize(), 68);
+    EXPECT_EQ(PointBatchPtr(PointBatch::create(0, v, v, 2, 0, v))->getRecordSize(), 68);
+    EXPECT_EQ(PointBatchPtr(PointBatch::create(0, v, v, 2, v, v))->getRecordSize(), 76);
+}
+
+static void expectRecordEqual(Blob * point, PointBatch const & batch, int index)
+{
+    BlobPtr blob(point);
+    ASSERT_EQ(blob->getSize(), batch.getRecordSize());
+    EXPECT_EQ(std::memcmp(blob->get(), batch.getBlob(index), blob->getSize()), 0);
+}
+
+TEST(PointBatch, isMakePointEqual)
+{
+    double x[] = {1.5, -2.25, 1e6};
+    double y[] = {-7, 0.125, 3e-3};
+    double z[] = {10, 20, 30};
+    double m[] = {-1, -2, -3};
+    PointBatchPtr xy(Point::makePoints(4326, x, y, 3));
+    PointBatchPtr xyz(Point::makePoints(4326, x, y, 3, z));
+    PointBatchPtr xym(Point::makePoints(4326, x, y, 3, 0, m));
+    PointBatchPtr xyzm(Point::makePoints(4326, x, y, 3, z, m));
+    for (int i = 0; i < 3; i++)
+    {
+        expectRecordEqual(Point::makePoint(4326, x[i], y[i]), *xy, i);
+        expectRecordEqual(Point::makePoint(4326, x[i], y[i], &z[i]), *xyz, i);
+        expectRecordEqual(Point::makePoint(4326, x[i], y[i], 0, &m[i]), *xym, i);
+        expectRecordEqual(Point::makePoint(4326, x[i], y[i], &z[i], &m[i]), *xyzm, i);
+    }
+}
+
+TEST(PointBatch, isInsertValid)
+{
+    double x[] = {0, 1, 2, 3};
+    double y[] = {4, 5, 6, 7};
+    PointBatchPtr batch(PointBatch::create(4326, x, y, 4));
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.getDatabase()->exec("CREATE TABLE test (pk INTEGER PRIMARY KEY, geom BLOB)");
+    EXPECT_EQ(batch->insert(db, "INSERT INTO test (geom) VALUES (?)"), 4);
+    SQLite::Statement query(*db.getDatabase(), "SELECT geom FROM test ORDER BY pk");
+    int row = 0;
+    while (query.executeStep())
+    {
+        SQLite::Column column = query.getColumn(0);
+        ASSERT_EQ(column.getBytes(), batch->getRecordSize());
+        EXPECT_EQ(std::memcmp(column.getBlob(), batch->getBlob(row), batch->getRecordSize()), 0);
+        row++;
+    }
+    EXPECT_EQ(row, 4);
+    EXPECT_THROW(batch->insert(db, "INSERT INTO missing (geom) VALUES (?)"), std::runtime_error);
+    EXPECT_EQ(db.getCount("test"), 4);
+}
@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace SpatiaLite;
+
+static void setSquare(double * coords, double x, double y, double size)
+{
+    double square[] = {x, y, x + size, y, x + size, y + size, x, y + size, x, y};
+    for (int i = 0; i < 10; i++) coords[i] = square[i];
+}
+
+static gaiaGeomCollPtr makeZone(GeometryArena & arena,
+                                double x,
+                                double y,
+                                double size,
+                                bool hole)
+{
+    gaiaGeomCollPtr geometry = arena.allocGeomColl();
+    gaiaPolygonPtr polygon = arena.addPolygon(geometry, 5, hole ? 1 : 0);
+    setSquare(polygon->Exterior->Coords, x, y, size);
+    if (hole)
+    {
+        setSquare(arena.addInteriorRing(polygon, 0, 5)->Coords,
+                  x + size / 4, y + size / 4, size / 2);
+    }
+    return geometry;
+}
+
+static gaiaGeomCollPtr makeStar(GeometryArena & arena, int spikes)
+{
+    gaiaGeomCollPtr geometry = arena.allocGeomColl(GAIA_XY_Z);
+    gaiaPolygonPtr polygon = arena.addPolygon(geometry, 2 * spikes + 1, 0);
+    double * coords = polygon->Exterior->Coords;
+    for (int i = 0; i < 2 * spikes; i++)
+    {
+        double angle = 3.14159265358979 * i / spikes;
+        double radius = (i % 2) ? 20 : 45;
+        coords[3 * i] = 50 + radius * std::cos(angle);
+        coords[3 * i + 1] = 50 + radius * std::sin(angle);
+        coords[3 * i + 2] = 0;
+    }
+    for (int k = 0; k < 3; k++) coords[6 * spikes + k] = coords[k];
+    return geometry;
+}
+
+// Reference even-odd test over all rings of a geometry
+static bool isInside(gaiaGeomCollPtr geometry, double x, double y)
+{
+    bool inside = false;
+    for (gaiaPolygonPtr p = geometry->FirstPolygon; p; p = p->Next)
+    {
+        for (int k = -1; k < p->NumInteriors; k++)
+        {
+            gaiaRingPtr ring = k < 0 ? p->Exterior : p->Interiors + k;
+            int s = CoordinateBuffer::getStride(ring->DimensionModel);
+            for (int i = 0; i + 1 < ring->Points; i++)
+            {
+                const double * a = ring->Coords + i * s;
+                const double * b = a + s;
+                if ((a[1] > y) != (b[1] > y) &&
+                    x < a[0] + (y - a[1]) * (b[0] - a[0]) / (b[1] - a[1]))
+                {
+                    inside = !inside;
+                }
+            }
+        }
+    }
+    return inside;
+}
+
+TEST(PointClassifier, isValid)
+{
+    GeometryArena arena;
+    std::vector<gaiaGeomCollPtr> zones;
+    zones.push_back(makeZone(arena, 0, 0, 8, true));
+    zones.push_back(makeZone(arena, 10, 0, 4, false));
+    std::vector<int> ids;
+    ids.push_back(100);
+    ids.push_back(200);
+    PointClassifier classifier(zones, ids, 4);
+    EXPECT_EQ(classifier.getZoneCount(), 2);
+    EXPECT_EQ(classifier.getEdgeCount(), 12);
+    EXPECT_EQ(classifier.getResolution(), 4);
+    EXPECT_GT(classifier.getMixedRatio(), 0);
+    EXPECT_LE(classifier.getMixedRatio(), 1);
+    EXPECT_EQ(classifier.classify(1, 1), 100);
+    EXPECT_EQ(classifier.classify(4, 4), -1);
+    EXPECT_EQ(classifier.classify(11, 3), 200);
+    EXPECT_EQ(classifier.classify(9, 1), -1);
+    EXPECT_EQ(classifier.classify(-1, 1), -1);
+    EXPECT_EQ(classifier.classify(1, 100), -1);
+
+    ids.pop_back();
+    EXPECT_THROW(PointClassifier(zones, ids), std::runtime_error);
+    EXPECT_THROW(PointClassifier(zones, -1), std::runtime_error);
+    zones.push_back(0);
+    EXPECT_THROW(PointClassifier(zones, 0), std::runtime_error);
+    zones.clear();
+    PointClassifier empty(zones);
+    EXPECT_EQ(empty.classify(0, 0), -1);
+    EXPECT_EQ(empty.getResolution(), 0);
+}
+
+TEST(PointClassifier, isBatchValid)
+{
+    GeometryArena arena;
+    std::vector<gaiaGeomCollPtr> zones;
+    zones.push_back(makeStar(arena, 37));
+    zones.push_back(makeZone(arena, 100, 0, 50, true));
+    PointClassifier classifier(zones);
+
+    CoordinateBuffer points;
+    std::srand(7);
+    for (int i = 0; i < 20000; i++)
+    {
+        points.append(-10 + 170.0 * std::rand() / RAND_MAX,
+                      -10 + 120.0 * std::rand() / RAND_MAX);
+    }
+    std::vector<int> expected(points.getSize(), -1);
+    for (int i = 0; i < points.getSize(); i++)
+    {
+        double x = points.getX()[i];
+        double y = points.getY()[i];
+        if (isInside(zones[0], x, y)) expected[i] = 0;
+        else if (isInside(zones[1], x, y)) expected[i] = 1;
+    }
+
+    const int supported = Measure::getInstructionSet();
+    for (int set = Measure::SCALAR; set <= supported; set++)
+    {
+        Measure::setInstructionSet(set);
+        EXPECT_EQ(classifier.classify(points, 1), expected) << set;
+        EXPECT_EQ(classifier.classify(points, 4), expected) << set;
+    }
+    Measure::setInstructionSet(supported);
+    EXPECT_TRUE(classifier.classify(0, 0, 0).empty());
+    EXPECT_THROW(classifier.classify(0, 0, 1), std::runtime_error);
+}
@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+#include "TestGeometry.h"
+
+#include <thread>
+
+#if SPATIALITECPP_USE_GEOS
+
+using namespace SpatiaLite;
+
+TEST(PreparedGeometry, isValid)
+{
+    GeometryArena arena;
+    PreparedGeometry prepared(makeSquare(arena, 0, 0, 4));
+    EXPECT_EQ(prepared.getThreadCount(), 0);
+    EXPECT_TRUE(prepared.contains(makeSquare(arena, 1, 1, 1)));
+    EXPECT_TRUE(prepared.covers(makeSquare(arena, 1, 1, 1)));
+    EXPECT_TRUE(prepared.intersects(makeSquare(arena, 3, 3, 2)));
+    EXPECT_FALSE(prepared.contains(makeSquare(arena, 3, 3, 2)));
+    EXPECT_FALSE(prepared.intersects(makeSquare(arena, 5, 5, 1)));
+    EXPECT_TRUE(prepared.within(makeSquare(arena, -1, -1, 6)));
+    EXPECT_TRUE(prepared.evaluate(PreparedGeometry::DISJOINT,
+                                  makeSquare(arena, 5, 5, 1)));
+    EXPECT_EQ(prepared.getThreadCount(), 1);
+    EXPECT_THROW(PreparedGeometry(0), std::runtime_error);
+    EXPECT_THROW(prepared.contains(0), std::runtime_error);
+    EXPECT_THROW(prepared.evaluate(-1, makeSquare(arena, 1, 1, 1)),
+                 std::runtime_error);
+    EXPECT_THROW(prepared.evaluate(PreparedGeometry::WITHIN + 1,
+                                   makeSquare(arena, 1, 1, 1)),
+                 std::runtime_error);
+}
+
+TEST(PreparedGeometry, isBatchValid)
+{
+    GeometryArena arena;
+    PreparedGeometry prepared(makeSquare(arena, 0, 0, 4));
+    std::vector<gaiaGeomCollPtr> candidates;
+    for (int i = 0; i < 8; i++)
+    {
+        candidates.push_back(makeSquare(arena, i, i, 0.5));
+    }
+    std::vector<bool> results =
+        prepared.evaluate(PreparedGeometry::INTERSECTS, candidates);
+    ASSERT_EQ(results.size(), candidates.size());
+    for (int i = 0; i < 8; i++) EXPECT_EQ(results[i], i <= 4);
+    EXPECT_TRUE(prepared.evaluate(PreparedGeometry::INTERSECTS,
+                                  std::vector<gaiaGeomCollPtr>()).empty());
+}
+
+TEST(PreparedGeometry, isThreadSafe)
+{
+    GeometryArena arena;
+    PreparedGeometryPtr prepared(new PreparedGeometry(makeSquare(arena, 0, 0, 4)));
+    std::vector<gaiaGeomCollPtr> candidates;
+    for (int i = 0; i < 64; i++)
+    {
+        candidates.push_back(makeSquare(arena, i % 8, i % 8, 0.5));
+    }
+    std::vector<int> counts(4, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([&, t]() {
+            for (int k = 0; k < 10; k++)
+            {
+                std::vector<bool> results =
+                    prepared->evaluate(PreparedGeometry::CONTAINS, candidates);
+                for (size_t i = 0; i < results.size(); i++)
+                {
+                    if (results[i]) counts[t]++;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+    for (int t = 0; t < 4; t++) EXPECT_EQ(counts[t], 10 * 32);
+    EXPECT_GE(prepared->getThreadCount(), 1);
+    EXPECT_LE(prepared->getThreadCount(), 4);
+}
+
+TEST(PreparedGeometry, isStateReused)
+{
+    GeometryArena arena;
+    PreparedGeometry prepared(makeSquare(arena, 0, 0, 4));
+    gaiaGeomCollPtr candidate = makeSquare(arena, 1, 1, 1);
+
+    // Threads that come and go hand their state on
+    for (int t = 0; t < 8; t++)
+    {
+        std::thread thread([&]() { EXPECT_TRUE(prepared.contains(candidate)); });
+        thread.join();
+    }
+    EXPECT_EQ(prepared.getThreadCount(), 1);
+
+    // Objects used after it push its state out of this thread's cache
+    EXPECT_TRUE(prepared.contains(candidate));
+    for (int i = 0; i < 8; i++)
+    {
+        PreparedGeometry other(makeSquare(arena, 0, 0, 4 + i));
+        EXPECT_TRUE(other.intersects(candidate));
+    }
+    EXPECT_TRUE(prepared.contains(candidate));
+    EXPECT_EQ(prepared.getThreadCount(), 1);
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#if SPATIALITECPP_USE_PROJ
+
+using namespace SpatiaLite;
+
+static const double WORLD = 20037508.342789244;
+
+static void createReferences(SpatialDatabase & db)
+{
+    db.getDatabase()->exec("CREATE TABLE spatial_ref_sys (srid INTEGER "
+                           "PRIMARY KEY, auth_name TEXT, auth_srid INTEGER, "
+                           "ref_sys_name TEXT, proj4text TEXT)");
+    db.getDatabase()->exec("INSERT INTO spatial_ref_sys VALUES "
+                           "(4326, 'epsg', 4326, 'WGS 84', "
+                           "'+proj=longlat +datum=WGS84 +no_defs'), "
+                           "(3857, 'epsg', 3857, 'WGS 84 / Pseudo-Mercator', "
+                           "'+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 "
+                           "+lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m "
+                           "+nadgrids=@null +wktext +no_defs'), "
+                           "(32631, 'epsg', 32631, 'WGS 84 / UTM zone 31N', "
+                           "'+proj=utm +zone=31 +datum=WGS84 +units=m +no_defs')");
+}
+
+TEST(Reprojector, isValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    createReferences(db);
+    EXPECT_THROW(Reprojector(db, 4326, 1234), std::exception);
+    EXPECT_THROW(Reprojector(db, 4326, 3857, -1), std::exception);
+    EXPECT_THROW(Reprojector(db, 4326, 3857, 1, 0), std::exception);
+    Reprojector reprojector(db, 4326, 3857, 2, 100);
+    EXPECT_EQ(reprojector.getSourceSrid(), 4326);
+    EXPECT_EQ(reprojector.getTargetSrid(), 3857);
+    EXPECT_EQ(reprojector.getThreadCount(), 2);
+    EXPECT_EQ(reprojector.getChunkSize(), 100);
+    EXPECT_GT(Reprojector(db, 4326, 4326).getThreadCount(), 0);
+}
+
+TEST(Reprojector, isMercatorValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    createReferences(db);
+    Reprojector forward(db, 4326, 3857, 4, 100);
+    Reprojector inverse(db, 3857, 4326, 4, 100);
+
+    // Chunks over several workers give the same result as one point
+    std::vector<double> x;
+    std::vector<double> y;
+    for (int i = 0; i < 1000; i++)
+    {
+        x.push_back(-180 + i * 0.36);
+        y.push_back(-80 + i * 0.16);
+    }
+    std::vector<double> mx(x);
+    std::vector<double> my(y);
+    forward.transform(&mx[0], &my[0], 0, mx.size());
+    EXPECT_NEAR(mx[0], -WORLD, 1e-6);
+    double px = 180;
+    double py = 0;
+    forward.transform(&px, &py, 0, 1);
+    EXPECT_NEAR(px, WORLD, 1e-6);
+    EXPECT_NEAR(py, 0, 1e-6);
+
+    // Latitudes past the square are projected and the poles fail like PROJ
+    px = 0;
+    py = 89;
+    forward.transform(&px, &py, 0, 1);
+    EXPECT_GT(py, WORLD);
+    px = 0;
+    py = 90;
+    forward.transform(&px, &py, 0, 1);
+    EXPECT_EQ(px, HUGE_VAL);
+    EXPECT_EQ(py, HUGE_VAL);
+
+    inverse.transform(&mx[0], &my[0], 0, mx.size());
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        EXPECT_NEAR(mx[i], x[i], 1e-9);
+        EXPECT_NEAR(my[i], y[i], 1e-9);
+    }
+
+    // Coordinate buffers keep their Z values
+    CoordinateBufferPtr buffer(new CoordinateBuffer(GAIA_XY_Z));
+    buffer->append(90, 0, 5);
+    forward.transform(*buffer);
+    EXPECT_NEAR(buffer->getX()[0], WORLD / 2, 1e-6);
+    EXPECT_EQ(buffer->getZ()[0], 5);
+}
+
+TEST(Reprojector, isGeometryValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    createReferences(db);
+    Reprojector reprojector(db, 4326, 32631, 3, 10);
+
+    // UTM zone 31 is centered on 3 degrees east
+    std::vector<gaiaGeomCollPtr> geometries;
+    for (int i = 0; i < 100; i++)
+    {
+        gaiaGeomCollPtr geometry = gaiaAllocGeomColl();
+        geometry->Srid = 4326;
+        gaiaAddPointToGeomColl(geometry, 3, 0);
+        gaiaLinestringPtr line = gaiaAddLinestringToGeomColl(geometry, 2);
+        line->Coords[0] = 3;
+        line->Coords[1] = 0;
+        line->Coords[2] = 3;
+        line->Coords[3] = 0;
+        geometries.push_back(geometry);
+    }
+    geometries.push_back(0);
+    reprojector.transform(geometries);
+    for (size_t i = 0; i < 100; i++)
+    {
+        gaiaGeomCollPtr geometry = geometries[i];
+        EXPECT_EQ(geometry->Srid, 32631);
+        EXPECT_NEAR(geometry->FirstPoint->X, 500000, 1e-3);
+        EXPECT_NEAR(geometry->FirstPoint->Y, 0, 1e-3);
+        EXPECT_NEAR(geometry->FirstLinestring->Coords[2], 500000, 1e-3);
+        EXPECT_NEAR(geometry->MinX, 500000, 1e-3);
+        gaiaFreeGeomColl(geometry);
+    }
+
+    // Back again through a single geometry
+    Reprojector inverse(db, 32631, 4326);
+    GeometryCollection geometry(gaiaAllocGeomColl());
+    gaiaAddPointToGeomColl(geometry.get(), 500000, 0);
+    inverse.transform(geometry);
+    EXPECT_EQ(geometry.get()->Srid, 4326);
+    EXPECT_NEAR(geometry.get()->FirstPoint->X, 3, 1e-9);
+    EXPECT_NEAR(geometry.get()->FirstPoint->Y, 0, 1e-9);
+}
+
+TEST(Reprojector, isConcurrentValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    createReferences(db);
+    Reprojector reprojector(db, 4326, 32631, 2, 10);
+
+    // Callers sharing the object outnumber its workers
+    std::vector<std::vector<double> > xs(4, std::vector<double>(100, 3));
+    std::vector<std::vector<double> > ys(4, std::vector<double>(100, 0));
+    std::vector<std::thread> callers;
+    for (size_t c = 0; c < xs.size(); c++)
+    {
+        callers.push_back(std::thread([&, c]()
+        {
+            for (int pass = 0; pass < 10; pass++)
+            {
+                std::vector<double> & x = xs[c];
+                std::vector<double> & y = ys[c];
+                std::fill(x.begin(), x.end(), 3.0);
+                std::fill(y.begin(), y.end(), 0.0);
+                reprojector.transform(&x[0], &y[0], 0, x.size());
+            }
+        }));
+    }
+    for (size_t c = 0; c < callers.size(); c++) callers[c].join();
+    for (size_t c = 0; c < xs.size(); c++)
+    {
+        for (size_t i = 0; i < xs[c].size(); i++)
+        {
+            EXPECT_NEAR(xs[c][i], 500000, 1e-3);
+            EXPECT_NEAR(ys[c][i], 0, 1e-3);
+        }
+    }
+}
+
+#endif
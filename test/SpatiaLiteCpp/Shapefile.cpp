@@ -3,7 +3,22 @@
 
 using namespace SpatiaLite;
 
+#ifndef SPATIALITECPP_TEST_EX_DIR
+    #define SPATIALITECPP_TEST_EX_DIR "../../examples"
+#endif
+const std::string SHAPEFILE_EX_DIR = SPATIALITECPP_TEST_EX_DIR;
+
 TEST(Shapefile, isValid)
 {
     EXPECT_NO_THROW(ShapefilePtr(new Shapefile(gaiaAllocShapefile())));
 }
+
+TEST(Shapefile, isReadEntityValid)
+{
+    const std::string path = SHAPEFILE_EX_DIR + "/states/states";
+    ShapefilePtr shapefile(new Shapefile(gaiaAllocShapefile()));
+    gaiaOpenShpRead(shapefile->get(), path.c_str(), "UTF-8", "UTF-8");
+    EXPECT_TRUE(shapefile->readEntity(0, 4326));
+    EXPECT_TRUE(shapefile->get()->Dbf->Geometry != 0);
+    EXPECT_FALSE(shapefile->readEntity(1000, 4326));
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <fstream>
+
+using namespace SpatiaLite;
+
+#ifndef SPATIALITECPP_TEST_EX_DIR
+    #define SPATIALITECPP_TEST_EX_DIR "../../examples"
+#endif
+const std::string SHAPEFILEINDEX_EX_DIR = SPATIALITECPP_TEST_EX_DIR;
+
+TEST(ShapefileIndex, isInvalid)
+{
+    EXPECT_THROW(ShapefileIndexPtr(ShapefileIndex::create("")), std::runtime_error);
+}
+
+TEST(ShapefileIndex, isCreateValid)
+{
+    const std::string path = SHAPEFILEINDEX_EX_DIR + "/states/states";
+    ShapefileIndexPtr index(ShapefileIndex::create(path));
+    EXPECT_EQ(index->getCount(), 51);
+    EXPECT_GT(index->getDepth(), 0);
+}
+
+TEST(ShapefileIndex, isQueryValid)
+{
+    const std::string path = SHAPEFILEINDEX_EX_DIR + "/states/states";
+    ShapefileIndexPtr index(ShapefileIndex::create(path));
+    EXPECT_EQ(index->query(-180, -90, 180, 90).size(), 51);
+    EXPECT_EQ(index->query(0, 0, 1, 1).size(), 0);
+    std::vector<int> records = index->query(-125, 30, -115, 40);
+    EXPECT_GT(records.size(), 0);
+    EXPECT_LT(records.size(), 51);
+}
+
+TEST(ShapefileIndex, isOpenValid)
+{
+    const std::string path = SHAPEFILEINDEX_EX_DIR + "/states/states";
+    ShapefileIndexPtr created(ShapefileIndex::create(path, 3));
+    ShapefileIndexPtr opened(ShapefileIndex::open(path));
+    EXPECT_EQ(opened->getDepth(), 3);
+    EXPECT_EQ(opened->getCount(), created->getCount());
+    EXPECT_EQ(opened->query(-125, 30, -115, 40),
+              created->query(-125, 30, -115, 40));
+}
+
+TEST(ShapefileIndex, isStaleRebuilt)
+{
+    const std::string path = SHAPEFILEINDEX_EX_DIR + "/states/states";
+    ShapefileIndexPtr created(ShapefileIndex::create(path, 5));
+    const std::string sidecar = ShapefileIndex::getSidecar(path);
+
+    // Record another modification time for a .shp file of the same size
+    std::fstream file(sidecar.c_str(),
+                      std::ios::in | std::ios::out | std::ios::binary);
+    ASSERT_TRUE(file.good());
+    const long long time = 1;
+    file.seekp(4 + 2 * sizeof(int) + sizeof(long long));
+    file.write(reinterpret_cast<const char *>(&time), sizeof(time));
+    file.close();
+
+    // The index is rebuilt with the derived depth
+    ShapefileIndexPtr opened(ShapefileIndex::open(path));
+    EXPECT_NE(opened->getDepth(), 5);
+    EXPECT_EQ(opened->getCount(), created->getCount());
+}
+
+TEST(ShapefileIndex, isSidecarInvalid)
+{
+    const std::string path = SHAPEFILEINDEX_EX_DIR + "/states/states";
+    ShapefileIndexPtr created(ShapefileIndex::create(path, 3));
+    const std::string sidecar = ShapefileIndex::getSidecar(path);
+
+    // Point the first child of the root back at the root
+    std::fstream file(sidecar.c_str(),
+                      std::ios::in | std::ios::out | std::ios::binary);
+    ASSERT_TRUE(file.good());
+    const long long header = 4 + 3 * sizeof(int) + 2 * sizeof(long long) + 2 * sizeof(int);
+    const long long nodes = header + created->getCount() * 4 * sizeof(double);
+    const int root = 0;
+    file.seekp(nodes + 4 * sizeof(double) + 2 * sizeof(int));
+    file.write(reinterpret_cast<const char *>(&root), sizeof(root));
+    file.close();
+
+    // The cycle is detected and the index rebuilt
+    ShapefileIndexPtr opened(ShapefileIndex::open(path));
+    EXPECT_EQ(opened->query(-125, 30, -115, 40),
+              created->query(-125, 30, -115, 40));
+}
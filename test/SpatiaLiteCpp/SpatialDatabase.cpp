@@ -1,6 +1,9 @@
 #include "gtest/gtest.h"
 #include "SpatiaLiteCpp/SpatiaLiteCpp.h"
 
+#include <cmath>
+#include <sstream>
+
 using namespace SpatiaLite;
 
 TEST(SpatialDatabase, isValid)
@@ -102,6 +105,34 @@ TEST(SpatialDatabase, isTypesValid)
     EXPECT_EQ(types.at(1), "POINT");
 }
 
+TEST(SpatialDatabase, isNearestValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.getDatabase()->exec("SELECT InitSpatialMetadata(1)");
+    db.getDatabase()->exec("CREATE TABLE test (PK INTEGER NOT NULL PRIMARY KEY)");
+    db.getDatabase()->exec("SELECT AddGeometryColumn('test', 'geom', 4326, 'POINT', 2)");
+    db.getDatabase()->exec("SELECT CreateSpatialIndex('test', 'geom')");
+    for (int i = 0; i < 100; i++)
+    {
+        std::stringstream sql;
+        sql << "INSERT INTO test (pk, geom) VALUES (NULL, MakePoint("
+            << i % 10 << ", " << i / 10 << ", 4326))";
+        db.getDatabase()->exec(sql.str());
+    }
+    std::vector<SpatialDatabase::Neighbor> neighbors =
+        db.nearest("test", "geom", 2.2, 3.1, 3);
+    ASSERT_EQ(neighbors.size(), 3u);
+    EXPECT_EQ(neighbors[0].id, 33);
+    EXPECT_EQ(neighbors[1].id, 34);
+    EXPECT_EQ(neighbors[2].id, 43);
+    EXPECT_NEAR(neighbors[0].distance, std::sqrt(0.05), 1e-9);
+    EXPECT_EQ(db.nearest("test", "geom", 2.2, 3.1, 10, 0.5).size(), 1u);
+    EXPECT_EQ(db.nearest("test", "geom", 50, 50, 5, 1).size(), 0u);
+    EXPECT_EQ(db.nearest("test", "geom", 0, 0, 1000).size(), 100u);
+    EXPECT_TRUE(db.nearest("test", "geom", 0, 0, 0).empty());
+    EXPECT_THROW(db.nearest("test", "none", 0, 0, 1), std::runtime_error);
+}
+
 TEST(SpatialDatabase, isSanitizeGeometriesValid)
 {
     SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
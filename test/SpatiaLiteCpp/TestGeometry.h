@@ -0,0 +1,29 @@
+/**
+ * @file    TestGeometry.h
+ * @brief   Geometry builders shared by the unit tests.
+ * @license MIT License (http://opensource.org/licenses/MIT)
+ * @copyright Copyright (c) 2015 Daniel Pulido (dpmcmlxxvi@gmail.com)
+ */
+#pragma once
+
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+/**
+ * @brief Builds an axis aligned square polygon in an arena
+ * @param[in] arena Arena that owns the geometry
+ * @param[in] x Lower left X coordinate
+ * @param[in] y Lower left Y coordinate
+ * @param[in] size Side length
+ * @returns Square geometry owned by the arena
+ */
+inline gaiaGeomCollPtr makeSquare(SpatiaLite::GeometryArena & arena,
+                                  double x,
+                                  double y,
+                                  double size)
+{
+    gaiaGeomCollPtr geometry = arena.allocGeomColl();
+    gaiaPolygonPtr polygon = arena.addPolygon(geometry, 5, 0);
+    double square[] = {x, y, x + size, y, x + size, y + size, x, y + size, x, y};
+    for (int i = 0; i < 10; i++) polygon->Exterior->Coords[i] = square[i];
+    return geometry;
+}
@@ -0,0 +1,198 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace SpatiaLite;
+
+static const double WORLD = 20037508.342789244;
+
+// Points on a 20 x 20 grid over the north-west quarter of the world
+static void createTable(SpatialDatabase & db)
+{
+    db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                           "name TEXT, geom BLOB)");
+    db.getDatabase()->exec("CREATE VIRTUAL TABLE idx_test_geom USING "
+                           "rtree(pkid, xmin, xmax, ymin, ymax)");
+    std::vector<double> x;
+    std::vector<double> y;
+    for (int i = 0; i < 400; i++)
+    {
+        x.push_back(-WORLD + (i % 20 + 0.5) * WORLD / 20);
+        y.push_back(WORLD - (i / 20 + 0.5) * WORLD / 20);
+    }
+    PointBatchPtr batch(PointBatch::create(3857, &x[0], &y[0], x.size()));
+    batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+    db.getDatabase()->exec("UPDATE test SET name = 'same'");
+    SQLite::Statement insert(*db.getDatabase(),
+                             "INSERT INTO idx_test_geom VALUES (?, ?, ?, ?, ?)");
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        insert.bind(1, (long long)(i + 1));
+        insert.bind(2, x[i]);
+        insert.bind(3, x[i]);
+        insert.bind(4, y[i]);
+        insert.bind(5, y[i]);
+        insert.exec();
+        insert.reset();
+    }
+}
+
+// Little-endian SpatiaLite BLOB of a rectangle polygon
+static std::string makeRectangle(double minx, double miny,
+                                 double maxx, double maxy)
+{
+    const double coords[10] = {minx, miny, maxx, miny, maxx, maxy,
+                               minx, maxy, minx, miny};
+    const double mbr[4] = {minx, miny, maxx, maxy};
+    const int srid = 3857;
+    const int type = 3;
+    const int rings = 1;
+    const int points = 5;
+    std::string blob(1, '\x00');
+    blob += '\x01';
+    blob.append((const char *)&srid, 4);
+    blob.append((const char *)mbr, 32);
+    blob += '\x7C';
+    blob.append((const char *)&type, 4);
+    blob.append((const char *)&rings, 4);
+    blob.append((const char *)&points, 4);
+    blob.append((const char *)coords, 80);
+    blob += '\xFE';
+    return blob;
+}
+
+static long long getCount(SQLite::Database & db, std::string const & sql)
+{
+    SQLite::Statement query(db, sql);
+    query.executeStep();
+    return query.getColumn(0).getInt64();
+}
+
+TEST(TilePyramid, isValid)
+{
+    EXPECT_THROW(TilePyramid(-1, 2, -1, -1, 1, 1), std::exception);
+    EXPECT_THROW(TilePyramid(3, 2, -1, -1, 1, 1), std::exception);
+    EXPECT_THROW(TilePyramid(0, 31, -1, -1, 1, 1), std::exception);
+    EXPECT_THROW(TilePyramid(0, 2, 1, -1, -1, 1), std::exception);
+    EXPECT_THROW(TilePyramid(0, 2, -1, -1, 1, 1, -1), std::exception);
+    TilePyramid pyramid(1, 4, -WORLD, -WORLD, WORLD, WORLD, 2);
+    EXPECT_EQ(pyramid.getMinZoom(), 1);
+    EXPECT_EQ(pyramid.getMaxZoom(), 4);
+    EXPECT_EQ(pyramid.getThreadCount(), 2);
+    EXPECT_GT(TilePyramid(0, 0, -1, -1, 1, 1).getThreadCount(), 0);
+}
+
+TEST(TilePyramid, isFindValid)
+{
+    SpatialDatabase db(":memory:", SQLITE_OPEN_READWRITE);
+    createTable(db);
+
+    // Only the north-west quarter holds points, so each level has a
+    // quarter of its tiles non-empty (buffer 0)
+    TilePyramid pyramid(1, 3, -WORLD, -WORLD, WORLD, WORLD, 1, 4096, 0);
+    std::vector<VectorTileEncoder::Tile> tiles =
+        pyramid.findTiles(db, "test", "geom");
+    ASSERT_EQ(tiles.size(), 1u + 4u + 16u);
+    EXPECT_EQ(tiles[0].z, 1);
+    EXPECT_EQ(tiles[0].x, 0);
+    EXPECT_EQ(tiles[0].y, 0);
+    EXPECT_EQ(tiles.back().z, 3);
+
+    // Bounds restrict the tiles
+    TilePyramid corner(2, 2, -WORLD, WORLD / 2, -WORLD / 2, WORLD, 1, 4096, 0);
+    tiles = corner.findTiles(db, "test", "geom");
+    ASSERT_EQ(tiles.size(), 1u);
+    EXPECT_EQ(tiles[0].x, 0);
+    EXPECT_EQ(tiles[0].y, 0);
+
+    EXPECT_THROW(pyramid.findTiles(db, "test", "missing"), std::exception);
+}
+
+TEST(TilePyramid, isGenerateValid)
+{
+    const char * filename = "tilepyramid.sqlite";
+    const char * mbtiles = "tilepyramid.mbtiles";
+    std::remove(filename);
+    std::remove(mbtiles);
+    {
+        SpatialDatabase db(filename, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        createTable(db);
+
+        // Every tile holds points, and at zoom 5 their layout repeats every
+        // four tiles, so those tiles encode identically
+        TilePyramid pyramid(0, 5, -WORLD, -WORLD, WORLD, WORLD, 3, 4096, 0);
+        const long long count = pyramid.generate(db, "test", "geom", mbtiles);
+        EXPECT_EQ(count, 1 + 1 + 4 + 16 + 64 + 256);
+        EXPECT_EQ(pyramid.getEmptyCount(), 0);
+        EXPECT_EQ(pyramid.getDuplicateCount(), 0);
+        {
+            SQLite::Database output(mbtiles);
+            EXPECT_EQ(getCount(output, "SELECT COUNT(*) FROM tiles"), count);
+            EXPECT_EQ(getCount(output, "SELECT COUNT(*) FROM tiles WHERE "
+                                       "zoom_level = 1 AND tile_column = 0 "
+                                       "AND tile_row = 1"), 1);
+            SQLite::Statement format(output, "SELECT value FROM metadata "
+                                             "WHERE name = 'format'");
+            ASSERT_TRUE(format.executeStep());
+            EXPECT_EQ(std::string(format.getColumn(0).getText()), "pbf");
+
+            // Tile data matches the encoder
+            VectorTileEncoder encoder(4096, 0);
+            encoder.addLayer(db, "test", "geom", 2, 1, 0);
+            SQLite::Statement tile(output, "SELECT tile_data FROM tiles WHERE "
+                                           "zoom_level = 2 AND tile_column = 1 "
+                                           "AND tile_row = 3");
+            ASSERT_TRUE(tile.executeStep());
+            EXPECT_EQ(std::string((const char *)tile.getColumn(0).getBlob(),
+                                  tile.getColumn(0).getBytes()),
+                      encoder.getData());
+        }
+
+        // A second run replaces the tiles and drops stale ones
+        {
+            SQLite::Database output(mbtiles, SQLITE_OPEN_READWRITE);
+            output.exec("INSERT INTO map VALUES (5, 20, 0, 'stale')");
+            output.exec("INSERT INTO images VALUES (x'00', 'stale')");
+        }
+        EXPECT_EQ(pyramid.generate(db, "test", "geom", mbtiles), count);
+        {
+            SQLite::Database output(mbtiles);
+            EXPECT_EQ(getCount(output, "SELECT COUNT(*) FROM map"), count);
+            EXPECT_EQ(getCount(output, "SELECT COUNT(*) FROM images WHERE "
+                                       "tile_id = 'stale'"), 0);
+        }
+
+        // ==================================================
+        // Tiles inside one large polygon are stored once, and tiles that
+        // only touch its edge are left out
+        // --------------------------------------------------
+        db.getDatabase()->exec("CREATE TABLE area (geom BLOB)");
+        db.getDatabase()->exec("CREATE VIRTUAL TABLE idx_area_geom USING "
+                               "rtree(pkid, xmin, xmax, ymin, ymax)");
+        const std::string rectangle = makeRectangle(-WORLD, 0, 0, WORLD);
+        SQLite::Statement insert(*db.getDatabase(),
+                                 "INSERT INTO area (geom) VALUES (?)");
+        insert.bind(1, rectangle.data(), (int)rectangle.size());
+        insert.exec();
+        db.getDatabase()->exec("INSERT INTO idx_area_geom VALUES "
+                               "(1, -20037508.342789244, 0, "
+                               "0, 20037508.342789244)");
+        std::remove(mbtiles);
+        TilePyramid area(0, 4, -WORLD, -WORLD, WORLD, WORLD, 2, 4096, 0);
+        const long long areaCount = area.generate(db, "area", "geom", mbtiles);
+        EXPECT_EQ(areaCount, 1 + 1 + 4 + 16 + 64);
+        EXPECT_GT(area.getEmptyCount(), 0);
+        EXPECT_GT(area.getDuplicateCount(), 0);
+        {
+            SQLite::Database output(mbtiles);
+            EXPECT_EQ(getCount(output, "SELECT COUNT(*) FROM tiles"), areaCount);
+            EXPECT_EQ(getCount(output, "SELECT COUNT(*) FROM images"),
+                      areaCount - area.getDuplicateCount());
+        }
+    }
+    std::remove(filename);
+    std::remove(mbtiles);
+}
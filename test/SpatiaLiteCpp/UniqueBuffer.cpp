@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <utility>
+#include <vector>
+
+using namespace SpatiaLite;
+
+static int numCleaned = 0;
+
+static void countClean(int * buffer)
+{
+    numCleaned++;
+    delete buffer;
+}
+
+typedef UniqueBuffer<int *, BufferDeleter<int *, countClean> > UniqueInt;
+
+TEST(UniqueBuffer, isValid)
+{
+    UniquePoint point(gaiaAllocPoint(0, 0));
+    UniqueRing ring(gaiaAllocRing(4));
+    UniqueLineString line(gaiaAllocLinestring(2));
+    UniqueGeometryCollection collection(gaiaAllocGeomColl());
+    UniqueDynamicLine dynamic(gaiaAllocDynamicLine());
+    UniqueGeometryCollection empty;
+    EXPECT_TRUE(point);
+    EXPECT_TRUE(ring);
+    EXPECT_TRUE(line);
+    EXPECT_TRUE(collection);
+    EXPECT_TRUE(dynamic);
+    EXPECT_FALSE(empty);
+}
+
+TEST(UniqueBuffer, isCleanValid)
+{
+    numCleaned = 0;
+    {
+        UniqueInt empty;
+        EXPECT_FALSE(empty);
+        UniqueInt value(new int(1));
+        EXPECT_TRUE(value);
+        EXPECT_EQ(*value.get(), 1);
+    }
+    EXPECT_EQ(numCleaned, 1);
+}
+
+TEST(UniqueBuffer, isMoveValid)
+{
+    numCleaned = 0;
+    {
+        UniqueInt first(new int(1));
+        UniqueInt second(std::move(first));
+        EXPECT_FALSE(first);
+        EXPECT_EQ(*second.get(), 1);
+        UniqueInt third(new int(3));
+        third = std::move(second);
+        EXPECT_EQ(numCleaned, 1);
+        EXPECT_EQ(*third.get(), 1);
+        std::vector<UniqueInt> buffers;
+        buffers.push_back(std::move(third));
+        buffers.push_back(UniqueInt(new int(4)));
+        EXPECT_EQ(*buffers[0].get(), 1);
+    }
+    EXPECT_EQ(numCleaned, 3);
+}
+
+TEST(UniqueBuffer, isReleaseValid)
+{
+    numCleaned = 0;
+    int * raw = 0;
+    {
+        UniqueInt value(new int(1));
+        raw = value.release();
+        EXPECT_FALSE(value);
+    }
+    EXPECT_EQ(numCleaned, 0);
+    delete raw;
+}
+
+TEST(UniqueBuffer, isResetValid)
+{
+    numCleaned = 0;
+    {
+        UniqueInt value(new int(1));
+        value.reset(new int(2));
+        EXPECT_EQ(numCleaned, 1);
+        EXPECT_EQ(*value.get(), 2);
+        value.reset();
+        EXPECT_EQ(numCleaned, 2);
+        EXPECT_FALSE(value);
+    }
+    EXPECT_EQ(numCleaned, 2);
+}
@@ -0,0 +1,375 @@
+#include "gtest/gtest.h"
+#include "SpatiaLiteCpp/SpatiaLiteCpp.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace SpatiaLite;
+
+static const double WORLD = 20037508.342789244;
+
+static uint64_t readVarint(std::string const & data, size_t & offset)
+{
+    uint64_t value = 0;
+    for (int shift = 0; offset < data.size(); shift += 7)
+    {
+        const unsigned char byte = data[offset++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    return value;
+}
+
+// Returns the payloads of the length-delimited fields with a number and the
+// value of the last varint field with the number in scalar
+static std::vector<std::string> readFields(std::string const & data,
+                                           int field,
+                                           uint64_t * scalar = 0)
+{
+    std::vector<std::string> fields;
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        const uint64_t key = readVarint(data, offset);
+        const int wire = (int)(key & 7);
+        uint64_t value = 0;
+        if (wire == 0)
+        {
+            value = readVarint(data, offset);
+            if ((int)(key >> 3) == field && scalar) *scalar = value;
+        }
+        else if (wire == 1)
+        {
+            offset += 8;
+        }
+        else if (wire == 2)
+        {
+            value = readVarint(data, offset);
+            if ((int)(key >> 3) == field)
+            {
+                fields.push_back(data.substr(offset, (size_t)value));
+            }
+            offset += (size_t)value;
+        }
+    }
+    return fields;
+}
+
+static std::vector<uint32_t> readPacked(std::string const & data)
+{
+    std::vector<uint32_t> values;
+    size_t offset = 0;
+    while (offset < data.size()) values.push_back((uint32_t)readVarint(data, offset));
+    return values;
+}
+
+static int unzigzag(uint32_t value)
+{
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+// Decodes geometry commands into paths of absolute pixel coordinates
+static std::vector<std::vector<int> > readPaths(std::vector<uint32_t> const & commands)
+{
+    std::vector<std::vector<int> > paths;
+    int x = 0;
+    int y = 0;
+    for (size_t i = 0; i < commands.size();)
+    {
+        const uint32_t id = commands[i] & 7;
+        const uint32_t count = commands[i] >> 3;
+        i++;
+        if (id == 7) continue;
+        for (uint32_t j = 0; j < count; j++)
+        {
+            if (id == 1) paths.push_back(std::vector<int>());
+            x += unzigzag(commands[i++]);
+            y += unzigzag(commands[i++]);
+            paths.back().push_back(x);
+            paths.back().push_back(y);
+        }
+    }
+    return paths;
+}
+
+static double getArea(std::vector<int> const & ring)
+{
+    double area = 0;
+    const size_t count = ring.size() / 2;
+    for (size_t i = 0; i < count; i++)
+    {
+        const size_t j = (i + 1) % count;
+        area += (double)ring[2 * i] * ring[2 * j + 1] -
+                (double)ring[2 * j] * ring[2 * i + 1];
+    }
+    return area;
+}
+
+static std::vector<std::string> getFeatures(std::string const & tile)
+{
+    std::vector<std::string> layers = readFields(tile, 3);
+    if (layers.empty()) return std::vector<std::string>();
+    return readFields(layers[0], 2);
+}
+
+static std::vector<uint32_t> getCommands(std::string const & feature)
+{
+    return readPacked(readFields(feature, 4)[0]);
+}
+
+TEST(VectorTileEncoder, isBoundsValid)
+{
+    double minx = 0;
+    double miny = 0;
+    double maxx = 0;
+    double maxy = 0;
+    VectorTileEncoder::getBounds(0, 0, 0, minx, miny, maxx, maxy);
+    EXPECT_DOUBLE_EQ(minx, -WORLD);
+    EXPECT_DOUBLE_EQ(maxy, WORLD);
+    EXPECT_DOUBLE_EQ(maxx, WORLD);
+    EXPECT_DOUBLE_EQ(miny, -WORLD);
+    VectorTileEncoder::getBounds(1, 1, 0, minx, miny, maxx, maxy);
+    EXPECT_DOUBLE_EQ(minx, 0);
+    EXPECT_DOUBLE_EQ(miny, 0);
+    EXPECT_THROW(VectorTileEncoder::getBounds(1, 2, 0, minx, miny, maxx, maxy),
+                 std::exception);
+    EXPECT_THROW(VectorTileEncoder::getBounds(-1, 0, 0, minx, miny, maxx, maxy),
+                 std::exception);
+    EXPECT_THROW(VectorTileEncoder(0), std::exception);
+    EXPECT_THROW(VectorTileEncoder(4096, -1), std::exception);
+}
+
+TEST(VectorTileEncoder, isPointValid)
+{
+    VectorTileEncoder encoder;
+    EXPECT_THROW(encoder.addFeature(0), std::exception);
+    encoder.beginLayer("points", 0, 0, 0);
+    EXPECT_THROW(encoder.beginLayer("points", 0, 0, 0), std::exception);
+
+    gaiaGeomCollPtr geometry = gaiaAllocGeomColl();
+    gaiaAddPointToGeomColl(geometry, 0, 0);
+    gaiaAddPointToGeomColl(geometry, -WORLD, WORLD);
+    gaiaAddPointToGeomColl(geometry, 2 * WORLD, 0);
+    EXPECT_EQ(encoder.addFeature(geometry, 7), 1);
+    gaiaFreeGeomColl(geometry);
+    EXPECT_EQ(encoder.endLayer(), 1);
+
+    // Layer: version 2, name, one feature, extent
+    std::string const & tile = encoder.getData();
+    std::vector<std::string> layers = readFields(tile, 3);
+    ASSERT_EQ(layers.size(), 1u);
+    uint64_t version = 0;
+    EXPECT_EQ(readFields(layers[0], 1)[0], "points");
+    readFields(layers[0], 15, &version);
+    EXPECT_EQ(version, 2u);
+    uint64_t extent = 0;
+    readFields(layers[0], 5, &extent);
+    EXPECT_EQ(extent, 4096u);
+
+    // Feature: id, type and MoveTo(2) with zigzag deltas, last point clipped
+    std::vector<std::string> features = getFeatures(tile);
+    ASSERT_EQ(features.size(), 1u);
+    uint64_t id = 0;
+    readFields(features[0], 1, &id);
+    EXPECT_EQ(id, 7u);
+    uint64_t type = 0;
+    readFields(features[0], 3, &type);
+    EXPECT_EQ(type, 1u);
+    std::vector<uint32_t> commands = getCommands(features[0]);
+    ASSERT_EQ(commands.size(), 5u);
+    EXPECT_EQ(commands[0], 17u);
+    EXPECT_EQ(commands[1], 4096u);
+    EXPECT_EQ(commands[2], 4096u);
+    EXPECT_EQ(commands[3], 4095u);
+    EXPECT_EQ(commands[4], 4095u);
+    EXPECT_EQ(encoder.getFeatureCount(), 1);
+
+    // Empty layers are left out
+    encoder.clear();
+    encoder.beginLayer("empty", 0, 0, 0);
+    EXPECT_EQ(encoder.endLayer(), 0);
+    EXPECT_TRUE(encoder.getData().empty());
+}
+
+TEST(VectorTileEncoder, isLineClipped)
+{
+    VectorTileEncoder encoder(256, 8);
+    encoder.beginLayer("lines", 0, 0, 0);
+
+    // Crosses the tile from far west to the center, then leaves and
+    // re-enters through the north edge
+    gaiaGeomCollPtr geometry = gaiaAllocGeomColl();
+    gaiaLinestringPtr line = gaiaAddLinestringToGeomColl(geometry, 5);
+    gaiaSetPoint(line->Coords, 0, -3 * WORLD, 0);
+    gaiaSetPoint(line->Coords, 1, 0, 0);
+    gaiaSetPoint(line->Coords, 2, 0, 3 * WORLD);
+    gaiaSetPoint(line->Coords, 3, WORLD / 2, 3 * WORLD);
+    gaiaSetPoint(line->Coords, 4, WORLD / 2, WORLD / 2);
+    EXPECT_EQ(encoder.addFeature(geometry), 1);
+    gaiaFreeGeomColl(geometry);
+    encoder.endLayer();
+
+    std::vector<std::string> features = getFeatures(encoder.getData());
+    ASSERT_EQ(features.size(), 1u);
+    std::vector<std::vector<int> > paths = readPaths(getCommands(features[0]));
+    ASSERT_EQ(paths.size(), 2u);
+    const int first[] = {-8, 128, 128, 128, 128, -8};
+    EXPECT_EQ(paths[0], std::vector<int>(first, first + 6));
+    const int second[] = {192, -8, 192, 64};
+    EXPECT_EQ(paths[1], std::vector<int>(second, second + 4));
+
+    // Entirely outside
+    encoder.clear();
+    encoder.beginLayer("lines", 1, 0, 0);
+    geometry = gaiaAllocGeomColl();
+    line = gaiaAddLinestringToGeomColl(geometry, 2);
+    gaiaSetPoint(line->Coords, 0, WORLD / 2, -WORLD / 2);
+    gaiaSetPoint(line->Coords, 1, WORLD, -WORLD);
+    EXPECT_EQ(encoder.addFeature(geometry), 0);
+    gaiaFreeGeomColl(geometry);
+    EXPECT_EQ(encoder.endLayer(), 0);
+}
+
+TEST(VectorTileEncoder, isPolygonValid)
+{
+    VectorTileEncoder encoder(256, 0);
+    encoder.beginLayer("polygons", 0, 0, 0);
+
+    // Counterclockwise exterior larger than the tile, clockwise interior
+    gaiaGeomCollPtr geometry = gaiaAllocGeomColl();
+    gaiaPolygonPtr polygon = gaiaAddPolygonToGeomColl(geometry, 5, 1);
+    gaiaRingPtr ring = polygon->Exterior;
+    gaiaSetPoint(ring->Coords, 0, -2 * WORLD, -2 * WORLD);
+    gaiaSetPoint(ring->Coords, 1, 2 * WORLD, -2 * WORLD);
+    gaiaSetPoint(ring->Coords, 2, 2 * WORLD, 2 * WORLD);
+    gaiaSetPoint(ring->Coords, 3, -2 * WORLD, 2 * WORLD);
+    gaiaSetPoint(ring->Coords, 4, -2 * WORLD, -2 * WORLD);
+    ring = gaiaAddInteriorRing(polygon, 0, 4);
+    gaiaSetPoint(ring->Coords, 0, 0, 0);
+    gaiaSetPoint(ring->Coords, 1, 0, WORLD / 2);
+    gaiaSetPoint(ring->Coords, 2, WORLD / 2, 0);
+    gaiaSetPoint(ring->Coords, 3, 0, 0);
+
+    // Wholly outside the tile, dropped with its interior
+    polygon = gaiaAddPolygonToGeomColl(geometry, 4, 0);
+    ring = polygon->Exterior;
+    gaiaSetPoint(ring->Coords, 0, 3 * WORLD, 0);
+    gaiaSetPoint(ring->Coords, 1, 4 * WORLD, 0);
+    gaiaSetPoint(ring->Coords, 2, 4 * WORLD, WORLD);
+    gaiaSetPoint(ring->Coords, 3, 3 * WORLD, 0);
+    EXPECT_EQ(encoder.addFeature(geometry, 1), 1);
+    gaiaFreeGeomColl(geometry);
+    encoder.endLayer();
+
+    std::vector<std::string> features = getFeatures(encoder.getData());
+    ASSERT_EQ(features.size(), 1u);
+    uint64_t type = 0;
+    readFields(features[0], 3, &type);
+    EXPECT_EQ(type, 3u);
+    std::vector<uint32_t> commands = getCommands(features[0]);
+    EXPECT_EQ(commands.back(), 15u);
+    std::vector<std::vector<int> > paths = readPaths(commands);
+    ASSERT_EQ(paths.size(), 2u);
+
+    // Clipped to the tile, without the closing point
+    EXPECT_EQ(paths[0].size(), 8u);
+    EXPECT_DOUBLE_EQ(getArea(paths[0]), 2.0 * 256 * 256);
+    EXPECT_EQ(paths[1].size(), 6u);
+    EXPECT_DOUBLE_EQ(getArea(paths[1]), -2.0 * 64 * 64 / 2);
+}
+
+TEST(VectorTileEncoder, isLayerValid)
+{
+    const char * filename = "vectortileencoder.sqlite";
+    std::remove(filename);
+    {
+        SpatialDatabase db(filename, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        db.getDatabase()->exec("CREATE TABLE test (PK INTEGER PRIMARY KEY, "
+                               "name TEXT, value REAL, rank INTEGER, geom BLOB)");
+        db.getDatabase()->exec("CREATE VIRTUAL TABLE idx_test_geom USING "
+                               "rtree(pkid, xmin, xmax, ymin, ymax)");
+        std::vector<double> x;
+        std::vector<double> y;
+        for (int i = 0; i < 400; i++)
+        {
+            x.push_back(-WORLD + (i % 20 + 0.5) * WORLD / 10);
+            y.push_back(WORLD - (i / 20 + 0.5) * WORLD / 10);
+        }
+        PointBatchPtr batch(PointBatch::create(3857, &x[0], &y[0], x.size()));
+        batch->insert(db, "INSERT INTO test (geom) VALUES (?)");
+        db.getDatabase()->exec("UPDATE test SET name = 'n' || (PK % 3), "
+                               "value = PK * 0.5, rank = 200 - PK");
+        SQLite::Statement insert(*db.getDatabase(),
+                                 "INSERT INTO idx_test_geom VALUES "
+                                 "(?, ?, ?, ?, ?)");
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            insert.bind(1, (long long)(i + 1));
+            insert.bind(2, x[i]);
+            insert.bind(3, x[i]);
+            insert.bind(4, y[i]);
+            insert.bind(5, y[i]);
+            insert.exec();
+            insert.reset();
+        }
+
+        // Top-left quadrant holds 100 points
+        VectorTileEncoder encoder(4096, 0);
+        EXPECT_EQ(encoder.addLayer(db, "test", "geom", 1, 0, 0), 100);
+        std::vector<std::string> layers = readFields(encoder.getData(), 3);
+        ASSERT_EQ(layers.size(), 1u);
+        EXPECT_EQ(readFields(layers[0], 1)[0], "test");
+        std::vector<std::string> keys = readFields(layers[0], 3);
+        ASSERT_EQ(keys.size(), 4u);
+        EXPECT_EQ(keys[0], "PK");
+        EXPECT_EQ(keys[3], "rank");
+
+        // Names repeat and are stored once; ranks go negative past 200
+        std::vector<std::string> values = readFields(layers[0], 4);
+        EXPECT_LT(values.size(), 100u * 4);
+        std::vector<std::string> features = readFields(layers[0], 2);
+        ASSERT_EQ(features.size(), 100u);
+        std::vector<uint32_t> tags = readPacked(readFields(features[0], 2)[0]);
+        EXPECT_EQ(tags.size(), 8u);
+
+        // Parallel tiles match the single encoder
+        std::vector<VectorTileEncoder::Tile> tiles;
+        for (int i = 0; i < 4; i++)
+        {
+            VectorTileEncoder::Tile tile = {1, i % 2, i / 2};
+            tiles.push_back(tile);
+        }
+        VectorTileEncoder::Tile far = {3, 7, 7};
+        tiles.push_back(far);
+        std::vector<std::string> results =
+            VectorTileEncoder::encodeTiles(db, "test", "geom", tiles, 3, 4096, 0);
+        ASSERT_EQ(results.size(), tiles.size());
+        EXPECT_EQ(results[0], encoder.getData());
+        for (size_t i = 1; i < 4; i++)
+        {
+            encoder.clear();
+            encoder.addLayer(db, "test", "geom", tiles[i].z, tiles[i].x, tiles[i].y);
+            EXPECT_EQ(results[i], encoder.getData());
+            EXPECT_EQ(getFeatures(results[i]).size(), 100u);
+        }
+        EXPECT_EQ(getFeatures(results[4]).size(), 9u);
+
+        // A prepared query is rebound for every tile
+        VectorTileEncoder::LayerQuery query(db, "test", "geom");
+        for (size_t i = 0; i < tiles.size(); i++)
+        {
+            encoder.clear();
+            encoder.addLayer(query, tiles[i].z, tiles[i].x, tiles[i].y);
+            EXPECT_EQ(results[i], encoder.getData());
+        }
+
+        EXPECT_THROW(encoder.addLayer(db, "test", "missing", 0, 0, 0),
+                     std::exception);
+        EXPECT_THROW(VectorTileEncoder::LayerQuery(db, "test", "missing"),
+                     std::exception);
+        EXPECT_THROW(VectorTileEncoder::encodeTiles(db, "missing", "geom", tiles),
+                     std::exception);
+    }
+    std::remove(filename);
+}